@@ -32,6 +32,9 @@ extern const u32 sha256_ce_offsetof_finalize;
 
 asmlinkage int sha2_ce_transform(struct sha256_ce_state *sst, u8 const *src,
 				 int blocks);
+asmlinkage void sha2_ce_transform_2x(u32 state[2][SHA256_DIGEST_SIZE / 4],
+				     u8 const *src1, u8 const *src2,
+				     int blocks);
 
 static void __sha2_ce_transform(struct sha256_state *sst, u8 const *src,
 				int blocks)
@@ -102,6 +105,78 @@ static int sha256_ce_finup(struct shash_desc *desc, const u8 *data,
 	return sha256_base_finish(desc, out);
 }
 
+/*
+ * Builds the final block(s) of a message of @count bytes in total from its
+ * last @len < SHA256_BLOCK_SIZE bytes, and returns the number of blocks.
+ */
+static int sha256_ce_pad(u8 buf[2 * SHA256_BLOCK_SIZE], unsigned int len,
+			 u64 count)
+{
+	int blocks = len + 1 + sizeof(__be64) > SHA256_BLOCK_SIZE ? 2 : 1;
+	unsigned int end = blocks * SHA256_BLOCK_SIZE - sizeof(__be64);
+
+	buf[len] = 0x80;
+	memset(buf + len + 1, 0, end - len - 1);
+	put_unaligned_be64(count << 3, buf + end);
+	return blocks;
+}
+
+static int sha256_ce_finup_mb(struct shash_desc *desc, const u8 * const data[],
+			      unsigned int len, u8 * const outs[],
+			      unsigned int num_msgs)
+{
+	struct sha256_ce_state *sctx = shash_desc_ctx(desc);
+	unsigned int partial = sctx->sst.count % SHA256_BLOCK_SIZE;
+	unsigned int ds = crypto_shash_digestsize(desc->tfm);
+	u64 count = sctx->sst.count + len;
+	u32 state[2][SHA256_DIGEST_SIZE / 4];
+	u8 buf[2][2 * SHA256_BLOCK_SIZE];
+	unsigned int off = 0, n, i, j;
+	int blocks;
+
+	if (num_msgs != 2 || !crypto_simd_usable())
+		return -EOPNOTSUPP;
+
+	memcpy(state[0], sctx->sst.state, sizeof(state[0]));
+	memcpy(state[1], sctx->sst.state, sizeof(state[1]));
+
+	kernel_neon_begin();
+
+	/* complete the partial block buffered in the state */
+	if (partial && len >= SHA256_BLOCK_SIZE - partial) {
+		off = SHA256_BLOCK_SIZE - partial;
+		for (i = 0; i < 2; i++) {
+			memcpy(buf[i], sctx->sst.buf, partial);
+			memcpy(buf[i] + partial, data[i], off);
+		}
+		sha2_ce_transform_2x(state, buf[0], buf[1], 1);
+		partial = 0;
+	}
+
+	blocks = (len - off) / SHA256_BLOCK_SIZE;
+	if (blocks)
+		sha2_ce_transform_2x(state, data[0] + off, data[1] + off,
+				     blocks);
+	off += blocks * SHA256_BLOCK_SIZE;
+
+	for (i = 0; i < 2; i++) {
+		memcpy(buf[i], sctx->sst.buf, partial);
+		memcpy(buf[i] + partial, data[i] + off, len - off);
+		n = partial + len - off;
+		blocks = sha256_ce_pad(buf[i], n, count);
+	}
+	sha2_ce_transform_2x(state, buf[0], buf[1], blocks);
+
+	kernel_neon_end();
+
+	for (i = 0; i < 2; i++)
+		for (j = 0; j < ds / sizeof(__be32); j++)
+			put_unaligned_be32(state[i][j], outs[i] + j * 4);
+	memzero_explicit(buf, sizeof(buf));
+	memzero_explicit(state, sizeof(state));
+	return 0;
+}
+
 static int sha256_ce_final(struct shash_desc *desc, u8 *out)
 {
 	struct sha256_ce_state *sctx = shash_desc_ctx(desc);
@@ -138,9 +213,11 @@ static struct shash_alg algs[] = { {
 	.update			= sha256_ce_update,
 	.final			= sha256_ce_final,
 	.finup			= sha256_ce_finup,
+	.finup_mb		= sha256_ce_finup_mb,
 	.export			= sha256_ce_export,
 	.import			= sha256_ce_import,
 	.descsize		= sizeof(struct sha256_ce_state),
+	.mb_max_msgs		= 2,
 	.statesize		= sizeof(struct sha256_state),
 	.digestsize		= SHA224_DIGEST_SIZE,
 	.base			= {
@@ -155,9 +232,11 @@ static struct shash_alg algs[] = { {
 	.update			= sha256_ce_update,
 	.final			= sha256_ce_final,
 	.finup			= sha256_ce_finup,
+	.finup_mb		= sha256_ce_finup_mb,
 	.export			= sha256_ce_export,
 	.import			= sha256_ce_import,
 	.descsize		= sizeof(struct sha256_ce_state),
+	.mb_max_msgs		= 2,
 	.statesize		= sizeof(struct sha256_state),
 	.digestsize		= SHA256_DIGEST_SIZE,
 	.base			= {
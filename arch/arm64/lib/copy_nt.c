@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Size above which memcpy() and copy_to_user() use non-temporal accesses
+ *
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+
+#include <linux/cache.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/minmax.h>
+#include <linux/sizes.h>
+
+#include <asm/cputype.h>
+
+/* read by the large copy paths of memcpy.S and copy_template.S */
+unsigned long memcpy_nt_threshold __read_mostly = ULONG_MAX;
+static bool memcpy_nt_threshold_set __initdata;
+
+static int __init memcpy_nt_threshold_setup(char *str)
+{
+	unsigned long long val = memparse(str, &str);
+
+	/* 0 disables them, tiny values would only slow down small copies */
+	memcpy_nt_threshold = val ? max_t(unsigned long long, val, SZ_4K) :
+				    ULONG_MAX;
+	memcpy_nt_threshold_set = true;
+	return 0;
+}
+early_param("memcpy_nt_threshold", memcpy_nt_threshold_setup);
+
+/*
+ * Cores whose L2 is small next to the page cache reads of large files and
+ * fastrpc buffers: streaming those copies keeps the working set of the
+ * other tasks in the caches.
+ */
+static const struct midr_range memcpy_nt_cpus[] __initconst = {
+	MIDR_ALL_VERSIONS(MIDR_CORTEX_A55),
+	MIDR_ALL_VERSIONS(MIDR_CORTEX_A78),
+	MIDR_ALL_VERSIONS(MIDR_CORTEX_A78C),
+	{},
+};
+
+static int __init memcpy_nt_init(void)
+{
+	if (!memcpy_nt_threshold_set &&
+	    is_midr_in_range_list(read_cpuid_id(), memcpy_nt_cpus))
+		WRITE_ONCE(memcpy_nt_threshold, SZ_256K);
+
+	return 0;
+}
+early_initcall(memcpy_nt_init);
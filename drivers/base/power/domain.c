@@ -242,9 +242,14 @@ static void genpd_update_accounting(struct generic_pm_domain *genpd)
 	 * out of off and so update the idle time and vice
 	 * versa.
 	 */
-	if (genpd->status == GENPD_STATE_ON)
-		genpd->states[genpd->state_idx].idle_time += delta;
-	else
+	if (genpd->status == GENPD_STATE_ON) {
+		struct genpd_power_state *state = &genpd->states[genpd->state_idx];
+
+		state->idle_time += delta;
+		/* woken up before the state paid off */
+		if (delta < state->residency_ns + state->power_off_latency_ns)
+			state->residency_miss++;
+	} else
 		genpd->on_time += delta;
 
 	genpd->accounting_time = now;
@@ -3258,7 +3263,7 @@ static int idle_states_show(struct seq_file *s, void *data)
 	if (ret)
 		return -ERESTARTSYS;
 
-	seq_puts(s, "State          Time Spent(ms) Usage          Rejected\n");
+	seq_puts(s, "State          Time Spent(ms) Usage          Rejected       Misses\n");
 
 	for (i = 0; i < genpd->state_count; i++) {
 		idle_time += genpd->states[i].idle_time;
@@ -3272,8 +3277,10 @@ static int idle_states_show(struct seq_file *s, void *data)
 		}
 
 		do_div(idle_time, NSEC_PER_MSEC);
-		seq_printf(s, "S%-13i %-14llu %-14llu %llu\n", i, idle_time,
-			   genpd->states[i].usage, genpd->states[i].rejected);
+		seq_printf(s, "S%-13i %-14llu %-14llu %-14llu %llu\n", i,
+			   idle_time, genpd->states[i].usage,
+			   genpd->states[i].rejected,
+			   genpd->states[i].residency_miss);
 	}
 
 	genpd_unlock(genpd);
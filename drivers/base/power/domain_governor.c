@@ -343,7 +343,7 @@ static bool cpu_power_down_ok(struct dev_pm_domain *pd)
 {
 	struct generic_pm_domain *genpd = pd_to_genpd(pd);
 	struct cpuidle_device *dev;
-	ktime_t domain_wakeup, next_hrtimer;
+	ktime_t domain_wakeup, next_hrtimer, irq_wakeup, next_irq;
 	ktime_t now = ktime_get();
 	s64 idle_duration_ns;
 	int cpu, i;
@@ -361,12 +361,17 @@ static bool cpu_power_down_ok(struct dev_pm_domain *pd)
 	 * contains a mask of all CPUs from subdomains.
 	 */
 	domain_wakeup = ktime_set(KTIME_SEC_MAX, 0);
+	irq_wakeup = KTIME_MAX;
 	for_each_cpu_and(cpu, genpd->cpus, cpu_online_mask) {
 		dev = per_cpu(cpuidle_devices, cpu);
 		if (dev) {
 			next_hrtimer = READ_ONCE(dev->next_hrtimer);
 			if (ktime_before(next_hrtimer, domain_wakeup))
 				domain_wakeup = next_hrtimer;
+			next_irq = READ_ONCE(dev->next_irq);
+			if (ktime_after(next_irq, now) &&
+			    ktime_before(next_irq, irq_wakeup))
+				irq_wakeup = next_irq;
 		}
 	}
 
@@ -378,6 +383,14 @@ static bool cpu_power_down_ok(struct dev_pm_domain *pd)
 	/* Store the next domain_wakeup to allow consumers to use it. */
 	genpd->gd->next_hrtimer = domain_wakeup;
 
+	/*
+	 * An interrupt predicted from the recent interrupt history of the
+	 * CPUs shortens the idle duration too, but is only a guess and no
+	 * wakeup to program.
+	 */
+	if (ktime_before(irq_wakeup, domain_wakeup))
+		idle_duration_ns = ktime_to_ns(ktime_sub(irq_wakeup, now));
+
 	/*
 	 * Find the deepest idle state that has its residency value satisfied
 	 * and by also taking into account the power off latency for the state.
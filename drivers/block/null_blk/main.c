@@ -9,6 +9,9 @@
 #include <linux/sched.h>
 #include <linux/fs.h>
 #include <linux/init.h>
+#include <linux/math64.h>
+#include <linux/random.h>
+#include <linux/string.h>
 #include "null_blk.h"
 
 #undef pr_fmt
@@ -403,6 +406,7 @@ static int nullb_apply_poll_queues(struct nullb_device *dev,
 
 NULLB_DEVICE_ATTR(size, ulong, NULL);
 NULLB_DEVICE_ATTR(completion_nsec, ulong, NULL);
+NULLB_DEVICE_ATTR(completion_slack_nsec, ulong, NULL);
 NULLB_DEVICE_ATTR(submit_queues, uint, nullb_apply_submit_queues);
 NULLB_DEVICE_ATTR(poll_queues, uint, nullb_apply_poll_queues);
 NULLB_DEVICE_ATTR(home_node, uint, NULL);
@@ -523,6 +527,122 @@ static ssize_t nullb_device_badblocks_store(struct config_item *item,
 }
 CONFIGFS_ATTR(nullb_device_, badblocks);
 
+static const char * const nullb_lat_names[NULLB_LAT_NR] = {
+	[NULLB_LAT_READ]	= "read",
+	[NULLB_LAT_WRITE]	= "write",
+	[NULLB_LAT_OTHER]	= "other",
+};
+
+static ssize_t nullb_device_latency_profile_show(struct config_item *item,
+						 char *page)
+{
+	struct nullb_device *dev = to_nullb_device(item);
+	ssize_t len = 0;
+	int op, i;
+
+	for (op = 0; op < NULLB_LAT_NR; op++) {
+		struct nullb_lat_profile *lp = dev->lat_profile[op];
+		u32 prev = 0;
+
+		if (!lp)
+			continue;
+		len += sysfs_emit_at(page, len, "%s", nullb_lat_names[op]);
+		for (i = 0; i < lp->nr_buckets; i++) {
+			len += sysfs_emit_at(page, len, " %llu:%u",
+					     lp->buckets[i].nsec,
+					     lp->buckets[i].weight - prev);
+			prev = lp->buckets[i].weight;
+		}
+		len += sysfs_emit_at(page, len, "\n");
+	}
+	return len;
+}
+
+/*
+ * Set the latency profile of an operation with "<op> <nsec>:<weight> ...",
+ * e.g. "read 100000:90 1000000:10", with the bucket bounds in increasing
+ * order, or clear it with "<op>" alone.  <op> is one of read, write and
+ * other.  Requests of an operation with a profile complete after a time
+ * drawn from it instead of completion_nsec, with irqmode=2.
+ */
+static ssize_t nullb_device_latency_profile_store(struct config_item *item,
+						  const char *page, size_t count)
+{
+	struct nullb_device *dev = to_nullb_device(item);
+	struct nullb_lat_profile *lp = NULL;
+	char *orig, *buf, *tok;
+	u64 total = 0;
+	int op, ret;
+
+	if (test_bit(NULLB_DEV_FL_CONFIGURED, &dev->flags))
+		return -EBUSY;
+
+	orig = kstrndup(page, count, GFP_KERNEL);
+	if (!orig)
+		return -ENOMEM;
+
+	buf = strim(orig);
+	tok = strsep(&buf, " ");
+	op = match_string(nullb_lat_names, NULLB_LAT_NR, tok);
+	if (op < 0) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	while (buf && (tok = strsep(&buf, " ")) != NULL) {
+		char *weight;
+		u64 nsec;
+		u32 w;
+		int i;
+
+		if (!*tok)
+			continue;
+		if (!lp) {
+			lp = kzalloc(struct_size(lp, buckets,
+						 NULLB_LAT_MAX_BUCKETS),
+				     GFP_KERNEL);
+			if (!lp) {
+				ret = -ENOMEM;
+				goto out;
+			}
+		}
+
+		ret = -EINVAL;
+		weight = strchr(tok, ':');
+		if (!weight)
+			goto out;
+		*weight++ = '\0';
+		if (kstrtou64(tok, 0, &nsec) || kstrtou32(weight, 0, &w))
+			goto out;
+
+		i = lp->nr_buckets;
+		if (i == NULLB_LAT_MAX_BUCKETS ||
+		    (i && nsec <= lp->buckets[i - 1].nsec))
+			goto out;
+		total += w;
+		if (total > U32_MAX)
+			goto out;
+		lp->buckets[i].nsec = nsec;
+		lp->buckets[i].weight = total;
+		lp->nr_buckets++;
+	}
+
+	if (lp && !total) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	kfree(dev->lat_profile[op]);
+	dev->lat_profile[op] = lp;
+	lp = NULL;
+	ret = count;
+out:
+	kfree(lp);
+	kfree(orig);
+	return ret;
+}
+CONFIGFS_ATTR(nullb_device_, latency_profile);
+
 static ssize_t nullb_device_zone_readonly_store(struct config_item *item,
 						const char *page, size_t count)
 {
@@ -544,6 +664,7 @@ CONFIGFS_ATTR_WO(nullb_device_, zone_offline);
 static struct configfs_attribute *nullb_device_attrs[] = {
 	&nullb_device_attr_size,
 	&nullb_device_attr_completion_nsec,
+	&nullb_device_attr_completion_slack_nsec,
 	&nullb_device_attr_submit_queues,
 	&nullb_device_attr_poll_queues,
 	&nullb_device_attr_home_node,
@@ -561,6 +682,7 @@ static struct configfs_attribute *nullb_device_attrs[] = {
 	&nullb_device_attr_mbps,
 	&nullb_device_attr_cache_size,
 	&nullb_device_attr_badblocks,
+	&nullb_device_attr_latency_profile,
 	&nullb_device_attr_zoned,
 	&nullb_device_attr_zone_size,
 	&nullb_device_attr_zone_capacity,
@@ -651,8 +773,9 @@ static ssize_t memb_group_features_show(struct config_item *item, char *page)
 {
 	return snprintf(page, PAGE_SIZE,
 			"badblocks,blocking,blocksize,cache_size,"
-			"completion_nsec,discard,home_node,hw_queue_depth,"
-			"irqmode,max_sectors,mbps,memory_backed,no_sched,"
+			"completion_nsec,completion_slack_nsec,discard,"
+			"home_node,hw_queue_depth,irqmode,latency_profile,"
+			"max_sectors,mbps,memory_backed,no_sched,"
 			"poll_queues,power,queue_mode,shared_tag_bitmap,size,"
 			"submit_queues,use_per_node_hctx,virt_boundary,zoned,"
 			"zone_capacity,zone_max_active,zone_max_open,"
@@ -744,9 +867,13 @@ static struct nullb_device *null_alloc_dev(void)
 
 static void null_free_dev(struct nullb_device *dev)
 {
+	int op;
+
 	if (!dev)
 		return;
 
+	for (op = 0; op < NULLB_LAT_NR; op++)
+		kfree(dev->lat_profile[op]);
 	null_free_zoned_dev(dev);
 	badblocks_exit(&dev->badblocks);
 	kfree(dev);
@@ -847,11 +974,56 @@ static enum hrtimer_restart null_cmd_timer_expired(struct hrtimer *timer)
 	return HRTIMER_NORESTART;
 }
 
+static int null_cmd_lat_op(struct nullb_cmd *cmd)
+{
+	enum req_op op;
+
+	if (cmd->nq->dev->queue_mode == NULL_Q_MQ)
+		op = req_op(cmd->rq);
+	else
+		op = bio_op(cmd->bio);
+
+	switch (op) {
+	case REQ_OP_READ:
+		return NULLB_LAT_READ;
+	case REQ_OP_WRITE:
+	case REQ_OP_ZONE_APPEND:
+		return NULLB_LAT_WRITE;
+	default:
+		return NULLB_LAT_OTHER;
+	}
+}
+
+static u64 null_lat_profile_sample(const struct nullb_lat_profile *lp)
+{
+	u32 r = get_random_u32_below(lp->buckets[lp->nr_buckets - 1].weight);
+	unsigned int lo = 0, hi = lp->nr_buckets - 1;
+	u64 low;
+
+	while (lo < hi) {
+		unsigned int mid = (lo + hi) / 2;
+
+		if (r < lp->buckets[mid].weight)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	/* spread the times evenly over the bucket */
+	low = lo ? lp->buckets[lo - 1].nsec : 0;
+	return low + mul_u64_u32_shr(lp->buckets[lo].nsec - low,
+				     get_random_u32(), 32);
+}
+
 static void null_cmd_end_timer(struct nullb_cmd *cmd)
 {
-	ktime_t kt = cmd->nq->dev->completion_nsec;
+	struct nullb_device *dev = cmd->nq->dev;
+	struct nullb_lat_profile *lp = dev->lat_profile[null_cmd_lat_op(cmd)];
+	ktime_t kt = lp ? null_lat_profile_sample(lp) : dev->completion_nsec;
 
-	hrtimer_start(&cmd->timer, kt, HRTIMER_MODE_REL);
+	/* the slack lets the timers of close completions expire together */
+	hrtimer_start_range_ns(&cmd->timer, kt, dev->completion_slack_nsec,
+			       HRTIMER_MODE_REL);
 }
 
 static void null_complete_rq(struct request *rq)
@@ -27,6 +27,29 @@ struct nullb_cmd {
 	struct hrtimer timer;
 };
 
+/* kinds of operations with a latency profile of their own */
+enum {
+	NULLB_LAT_READ,
+	NULLB_LAT_WRITE,
+	NULLB_LAT_OTHER,
+	NULLB_LAT_NR,
+};
+
+#define NULLB_LAT_MAX_BUCKETS	64
+
+/*
+ * Histogram of completion times.  A bucket holds the times above the bound
+ * of the previous bucket up to its own, and is picked with a probability in
+ * proportion to its weight.
+ */
+struct nullb_lat_profile {
+	unsigned int nr_buckets;
+	struct {
+		u64 nsec;	/* upper bound of the bucket */
+		u32 weight;	/* weight of the buckets up to this one */
+	} buckets[];
+};
+
 struct nullb_queue {
 	unsigned long *tag_map;
 	wait_queue_head_t wait;
@@ -93,6 +116,8 @@ struct nullb_device {
 
 	unsigned long size; /* device size in MB */
 	unsigned long completion_nsec; /* time in ns to complete a request */
+	unsigned long completion_slack_nsec; /* completion timer slack in ns */
+	struct nullb_lat_profile *lat_profile[NULLB_LAT_NR];
 	unsigned long cache_size; /* disk cache size in MB */
 	unsigned long zone_size; /* zone size in MB if device is zoned */
 	unsigned long zone_capacity; /* zone capacity in MB if device is zoned */
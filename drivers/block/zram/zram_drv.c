@@ -42,6 +42,7 @@ static DEFINE_MUTEX(zram_index_mutex);
 
 static int zram_major;
 static const char *default_compressor = CONFIG_ZRAM_DEF_COMP;
+static struct workqueue_struct *zram_async_wq;
 
 /* Module params (documentation at end) */
 static unsigned int num_devices = 1;
@@ -950,6 +951,52 @@ static void zram_debugfs_unregister(struct zram *zram) {};
  *    altered' attrs, so max_comp_streams need to wait for the next
  *    layoff cycle.
  */
+static ssize_t async_write_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+
+	down_read(&zram->init_lock);
+	val = zram->async_write;
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", val);
+}
+
+/*
+ * A synchronous device gets its writes from swap with submit_bio_wait(), so
+ * async writes only help when the device doesn't claim to be synchronous.
+ * That in turn makes swap-in go through the swap cache, hence the knob.
+ */
+static ssize_t async_write_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+	int ret;
+
+	ret = kstrtobool(buf, &val);
+	if (ret)
+		return ret;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change async_write for initialized device\n");
+		return -EBUSY;
+	}
+
+	zram->async_write = val;
+	if (val)
+		blk_queue_flag_clear(QUEUE_FLAG_SYNCHRONOUS, zram->disk->queue);
+	else
+		blk_queue_flag_set(QUEUE_FLAG_SYNCHRONOUS, zram->disk->queue);
+	up_write(&zram->init_lock);
+
+	return len;
+}
+
 static ssize_t max_comp_streams_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -1199,10 +1246,11 @@ static ssize_t debug_stat_show(struct device *dev,
 
 	down_read(&zram->init_lock);
 	ret = scnprintf(buf, PAGE_SIZE,
-			"version: %d\n%8llu %8llu\n",
+			"version: %d\n%8llu %8llu %8llu\n",
 			version,
 			(u64)atomic64_read(&zram->stats.writestall),
-			(u64)atomic64_read(&zram->stats.miss_free));
+			(u64)atomic64_read(&zram->stats.miss_free),
+			(u64)atomic64_read(&zram->stats.async_writes));
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -1899,6 +1947,63 @@ static void zram_bio_read(struct zram *zram, struct bio *bio)
 	bio_endio(bio);
 }
 
+static void zram_bio_write(struct zram *zram, struct bio *bio);
+
+static void zram_async_work(struct work_struct *work)
+{
+	struct zram_async_queue *q =
+		container_of(work, struct zram_async_queue, work);
+	struct bio_list bios;
+	struct bio *bio;
+
+	spin_lock(&q->lock);
+	bios = q->bios;
+	bio_list_init(&q->bios);
+	q->nr_bios = 0;
+	spin_unlock(&q->lock);
+
+	while ((bio = bio_list_pop(&bios))) {
+		zram_bio_write(q->zram, bio);
+		atomic64_inc(&q->zram->stats.async_writes);
+	}
+}
+
+/*
+ * Hand a write over to the worker of this CPU, so that reclaim swapping out
+ * to zram doesn't wait for the compression.  Once the worker falls behind,
+ * writers compress synchronously again, which throttles them.
+ */
+static bool zram_queue_async_write(struct zram *zram, struct bio *bio)
+{
+	struct zram_async_queue *q;
+	bool queued = false;
+
+	if (!zram->async_write)
+		return false;
+
+	q = get_cpu_ptr(zram->async_queues);
+	spin_lock(&q->lock);
+	if (q->nr_bios < ZRAM_ASYNC_QUEUE_DEPTH) {
+		bio_list_add(&q->bios, bio);
+		q->nr_bios++;
+		queued = true;
+	}
+	spin_unlock(&q->lock);
+	if (queued)
+		queue_work_on(smp_processor_id(), zram_async_wq, &q->work);
+	put_cpu_ptr(zram->async_queues);
+
+	return queued;
+}
+
+static void zram_flush_async_writes(struct zram *zram)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		flush_work(&per_cpu_ptr(zram->async_queues, cpu)->work);
+}
+
 static void zram_bio_write(struct zram *zram, struct bio *bio)
 {
 	unsigned long start_time = bio_start_io_acct(bio);
@@ -1941,7 +2046,8 @@ static void zram_submit_bio(struct bio *bio)
 		zram_bio_read(zram, bio);
 		break;
 	case REQ_OP_WRITE:
-		zram_bio_write(zram, bio);
+		if (!zram_queue_async_write(zram, bio))
+			zram_bio_write(zram, bio);
 		break;
 	case REQ_OP_DISCARD:
 	case REQ_OP_WRITE_ZEROES:
@@ -1999,6 +2105,8 @@ static void zram_reset_device(struct zram *zram)
 	set_capacity_and_notify(zram->disk, 0);
 	part_stat_set_all(zram->disk->part0, 0);
 
+	zram_flush_async_writes(zram);
+
 	/* I/O operation under all of CPU are done so let's free */
 	zram_meta_free(zram, zram->disksize);
 	zram->disksize = 0;
@@ -2132,6 +2240,7 @@ static DEVICE_ATTR_WO(mem_limit);
 static DEVICE_ATTR_WO(mem_used_max);
 static DEVICE_ATTR_WO(idle);
 static DEVICE_ATTR_RW(max_comp_streams);
+static DEVICE_ATTR_RW(async_write);
 static DEVICE_ATTR_RW(comp_algorithm);
 #ifdef CONFIG_ZRAM_WRITEBACK
 static DEVICE_ATTR_RW(backing_dev);
@@ -2153,6 +2262,7 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_mem_used_max.attr,
 	&dev_attr_idle.attr,
 	&dev_attr_max_comp_streams.attr,
+	&dev_attr_async_write.attr,
 	&dev_attr_comp_algorithm.attr,
 #ifdef CONFIG_ZRAM_WRITEBACK
 	&dev_attr_backing_dev.attr,
@@ -2182,15 +2292,29 @@ ATTRIBUTE_GROUPS(zram_disk);
 static int zram_add(void)
 {
 	struct zram *zram;
-	int ret, device_id;
+	int ret, device_id, cpu;
 
 	zram = kzalloc(sizeof(struct zram), GFP_KERNEL);
 	if (!zram)
 		return -ENOMEM;
 
+	zram->async_queues = alloc_percpu(struct zram_async_queue);
+	if (!zram->async_queues) {
+		ret = -ENOMEM;
+		goto out_free_dev;
+	}
+	for_each_possible_cpu(cpu) {
+		struct zram_async_queue *q = per_cpu_ptr(zram->async_queues, cpu);
+
+		spin_lock_init(&q->lock);
+		bio_list_init(&q->bios);
+		INIT_WORK(&q->work, zram_async_work);
+		q->zram = zram;
+	}
+
 	ret = idr_alloc(&zram_index_idr, zram, 0, 0, GFP_KERNEL);
 	if (ret < 0)
-		goto out_free_dev;
+		goto out_free_queues;
 	device_id = ret;
 
 	init_rwsem(&zram->init_lock);
@@ -2259,6 +2383,8 @@ static int zram_add(void)
 	put_disk(zram->disk);
 out_free_idr:
 	idr_remove(&zram_index_idr, device_id);
+out_free_queues:
+	free_percpu(zram->async_queues);
 out_free_dev:
 	kfree(zram);
 	return ret;
@@ -2308,6 +2434,7 @@ static int zram_remove(struct zram *zram)
 	zram_reset_device(zram);
 
 	put_disk(zram->disk);
+	free_percpu(zram->async_queues);
 	kfree(zram);
 	return 0;
 }
@@ -2395,6 +2522,7 @@ static void destroy_devices(void)
 	idr_destroy(&zram_index_idr);
 	unregister_blkdev(zram_major, "zram");
 	cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
+	destroy_workqueue(zram_async_wq);
 }
 
 static int __init zram_init(void)
@@ -2403,15 +2531,24 @@ static int __init zram_init(void)
 
 	BUILD_BUG_ON(__NR_ZRAM_PAGEFLAGS > BITS_PER_LONG);
 
+	/* Writes come from reclaim, the workers must make forward progress */
+	zram_async_wq = alloc_workqueue("zram_async",
+					WQ_HIGHPRI | WQ_MEM_RECLAIM, 0);
+	if (!zram_async_wq)
+		return -ENOMEM;
+
 	ret = cpuhp_setup_state_multi(CPUHP_ZCOMP_PREPARE, "block/zram:prepare",
 				      zcomp_cpu_up_prepare, zcomp_cpu_dead);
-	if (ret < 0)
+	if (ret < 0) {
+		destroy_workqueue(zram_async_wq);
 		return ret;
+	}
 
 	ret = class_register(&zram_control_class);
 	if (ret) {
 		pr_err("Unable to register zram-control class\n");
 		cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
+		destroy_workqueue(zram_async_wq);
 		return ret;
 	}
 
@@ -2421,6 +2558,7 @@ static int __init zram_init(void)
 		pr_err("Unable to get major number\n");
 		class_unregister(&zram_control_class);
 		cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
+		destroy_workqueue(zram_async_wq);
 		return -EBUSY;
 	}
 
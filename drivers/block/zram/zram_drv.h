@@ -28,6 +28,9 @@
 #define ZRAM_SECTOR_PER_LOGICAL_BLOCK	\
 	(1 << (ZRAM_LOGICAL_BLOCK_SHIFT - SECTOR_SHIFT))
 
+/* Write bios queued per CPU before writers compress synchronously again */
+#define ZRAM_ASYNC_QUEUE_DEPTH	32
+
 
 /*
  * ZRAM is mainly used for memory efficiency so we want to keep memory
@@ -86,6 +89,7 @@ struct zram_stats {
 	atomic_long_t max_used_pages;	/* no. of maximum pages stored */
 	atomic64_t writestall;		/* no. of write slow paths */
 	atomic64_t miss_free;		/* no. of missed free */
+	atomic64_t async_writes;	/* no. of bios compressed by workers */
 #ifdef	CONFIG_ZRAM_WRITEBACK
 	atomic64_t bd_count;		/* no. of pages in backing device */
 	atomic64_t bd_reads;		/* no. of reads from backing device */
@@ -93,6 +97,15 @@ struct zram_stats {
 #endif
 };
 
+/* Write bios waiting to be compressed by a per-CPU worker */
+struct zram_async_queue {
+	spinlock_t lock;
+	struct bio_list bios;
+	unsigned int nr_bios;
+	struct work_struct work;
+	struct zram *zram;
+};
+
 #ifdef CONFIG_ZRAM_MULTI_COMP
 #define ZRAM_PRIMARY_COMP	0U
 #define ZRAM_SECONDARY_COMP	1U
@@ -127,6 +140,11 @@ struct zram {
 	 * zram is claimed so open request will be failed
 	 */
 	bool claim; /* Protected by disk->open_mutex */
+	/*
+	 * Compress writes in per-CPU workers, changed before init only
+	 */
+	bool async_write;
+	struct zram_async_queue __percpu *async_queues;
 #ifdef CONFIG_ZRAM_WRITEBACK
 	struct file *backing_dev;
 	spinlock_t wb_limit_lock;
@@ -137,9 +137,30 @@ struct qca_dump_size {
 	__le32 dump_size;
 } __packed;
 
+/* HCI packet types received in batches */
+enum qca_rx_type {
+	QCA_RX_ACL,
+	QCA_RX_SCO,
+	QCA_RX_EVENT,
+	QCA_RX_TYPES,
+};
+
+/*
+ * Receive latency of a packet type, from the arrival of the first byte of
+ * a packet to its delivery to the HCI core.
+ */
+struct qca_rx_stats {
+	u64 pkts;
+	u64 lat_total_us;
+	u32 lat_max_us;
+};
+
 struct qca_data {
 	struct hci_uart *hu;
 	struct sk_buff *rx_skb;
+	ktime_t rx_time;	/* arrival of the buffer being parsed */
+	ktime_t rx_pkt_start;	/* arrival of the first byte of rx_skb */
+	struct sk_buff_head rx_batch;	/* packets of the current receive */
 	struct sk_buff_head txq;
 	struct sk_buff_head tx_wait_q;	/* HCI_IBS wait queue	*/
 	struct sk_buff_head rx_memdump_q;	/* Memdump wait queue	*/
@@ -184,6 +205,9 @@ struct qca_data {
 	u64 rx_votes_off;
 	u64 votes_on;
 	u64 votes_off;
+	struct qca_rx_stats rx_stats[QCA_RX_TYPES];
+	u64 rx_batches;
+	u32 rx_batch_max;
 };
 
 enum qca_speed_type {
@@ -577,6 +601,7 @@ static int qca_open(struct hci_uart *hu)
 	skb_queue_head_init(&qca->txq);
 	skb_queue_head_init(&qca->tx_wait_q);
 	skb_queue_head_init(&qca->rx_memdump_q);
+	skb_queue_head_init(&qca->rx_batch);
 	spin_lock_init(&qca->hci_ibs_lock);
 	mutex_init(&qca->hci_memdump_lock);
 	qca->workqueue = alloc_ordered_workqueue("qca_wq", 0);
@@ -638,6 +663,34 @@ static int qca_open(struct hci_uart *hu)
 	return 0;
 }
 
+static int qca_rx_stats_show(struct seq_file *s, void *unused)
+{
+	static const char * const names[QCA_RX_TYPES] = {
+		[QCA_RX_ACL] = "acl",
+		[QCA_RX_SCO] = "sco",
+		[QCA_RX_EVENT] = "event",
+	};
+	struct qca_data *qca = s->private;
+	struct qca_rx_stats *st;
+	u64 pkts = 0;
+	int i;
+
+	seq_puts(s, "type   packets avg_lat_us max_lat_us\n");
+	for (i = 0; i < QCA_RX_TYPES; i++) {
+		st = &qca->rx_stats[i];
+		pkts += st->pkts;
+		seq_printf(s, "%-5s %8llu %10llu %10u\n", names[i], st->pkts,
+			   st->pkts ? div64_u64(st->lat_total_us, st->pkts) : 0,
+			   st->lat_max_us);
+	}
+	seq_printf(s, "batches: %llu\n", qca->rx_batches);
+	seq_printf(s, "avg_batch: %llu\n",
+		   qca->rx_batches ? div64_u64(pkts, qca->rx_batches) : 0);
+	seq_printf(s, "max_batch: %u\n", qca->rx_batch_max);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(qca_rx_stats);
+
 static void qca_debugfs_init(struct hci_dev *hdev)
 {
 	struct hci_uart *hu = hci_get_drvdata(hdev);
@@ -685,6 +738,9 @@ static void qca_debugfs_init(struct hci_dev *hdev)
 	debugfs_create_u32("wake_retrans", mode, ibs_dir, &qca->wake_retrans);
 	debugfs_create_u32("tx_idle_delay", mode, ibs_dir,
 			   &qca->tx_idle_delay);
+
+	debugfs_create_file("rx_stats", 0444, hdev->debugfs, qca,
+			    &qca_rx_stats_fops);
 }
 
 /* Flush protocol data */
@@ -1255,15 +1311,78 @@ static int qca_recv_event(struct hci_dev *hdev, struct sk_buff *skb)
 	.lsize = 0, \
 	.maxlen = HCI_MAX_IBS_SIZE
 
+/* Queues a packet for delivery once the whole receive buffer is parsed */
+static int qca_recv_queue(struct hci_dev *hdev, struct sk_buff *skb)
+{
+	struct hci_uart *hu = hci_get_drvdata(hdev);
+	struct qca_data *qca = hu->priv;
+
+	/* cleared before the packet is delivered */
+	skb->tstamp = qca->rx_pkt_start;
+	/* the next packet started in this buffer */
+	qca->rx_pkt_start = qca->rx_time;
+	__skb_queue_tail(&qca->rx_batch, skb);
+	return 0;
+}
+
+/* Delivers the packets of a receive buffer, in the order they arrived */
+static void qca_recv_flush(struct hci_uart *hu)
+{
+	struct qca_data *qca = hu->priv;
+	struct hci_dev *hdev = hu->hdev;
+	struct qca_rx_stats *st;
+	struct sk_buff *skb;
+	ktime_t now;
+	u32 lat;
+
+	if (skb_queue_empty(&qca->rx_batch))
+		return;
+
+	qca->rx_batches++;
+	qca->rx_batch_max = max(qca->rx_batch_max,
+				skb_queue_len(&qca->rx_batch));
+
+	now = ktime_get();
+	while ((skb = __skb_dequeue(&qca->rx_batch))) {
+		lat = ktime_us_delta(now, skb->tstamp);
+		skb->tstamp = 0;
+
+		switch (hci_skb_pkt_type(skb)) {
+		case HCI_ACLDATA_PKT:
+			st = &qca->rx_stats[QCA_RX_ACL];
+			qca_recv_acl_data(hdev, skb);
+			break;
+		case HCI_SCODATA_PKT:
+			st = &qca->rx_stats[QCA_RX_SCO];
+			hci_recv_frame(hdev, skb);
+			break;
+		default:
+			st = &qca->rx_stats[QCA_RX_EVENT];
+			qca_recv_event(hdev, skb);
+			break;
+		}
+
+		st->pkts++;
+		st->lat_total_us += lat;
+		st->lat_max_us = max(st->lat_max_us, lat);
+	}
+}
+
 static const struct h4_recv_pkt qca_recv_pkts[] = {
-	{ H4_RECV_ACL,             .recv = qca_recv_acl_data },
-	{ H4_RECV_SCO,             .recv = hci_recv_frame    },
-	{ H4_RECV_EVENT,           .recv = qca_recv_event    },
+	{ H4_RECV_ACL,             .recv = qca_recv_queue    },
+	{ H4_RECV_SCO,             .recv = qca_recv_queue    },
+	{ H4_RECV_EVENT,           .recv = qca_recv_queue    },
 	{ QCA_IBS_WAKE_IND_EVENT,  .recv = qca_ibs_wake_ind  },
 	{ QCA_IBS_WAKE_ACK_EVENT,  .recv = qca_ibs_wake_ack  },
 	{ QCA_IBS_SLEEP_IND_EVENT, .recv = qca_ibs_sleep_ind },
 };
 
+/*
+ * The HCI packets of a receive buffer are parsed in one pass and then
+ * delivered together, so that at high baud rates and with DMA receive the
+ * HCI core gets a batch of packets instead of work for every packet. The
+ * IBS indications are still handled as they are parsed.
+ */
 static int qca_recv(struct hci_uart *hu, const void *data, int count)
 {
 	struct qca_data *qca = hu->priv;
@@ -1271,8 +1390,14 @@ static int qca_recv(struct hci_uart *hu, const void *data, int count)
 	if (!test_bit(HCI_UART_REGISTERED, &hu->flags))
 		return -EUNATCH;
 
+	/* a packet continued from the previous buffer started with it */
+	qca->rx_time = ktime_get();
+	if (!qca->rx_skb)
+		qca->rx_pkt_start = qca->rx_time;
+
 	qca->rx_skb = h4_recv_buf(hu->hdev, qca->rx_skb, data, count,
 				  qca_recv_pkts, ARRAY_SIZE(qca_recv_pkts));
+	qca_recv_flush(hu);
 	if (IS_ERR(qca->rx_skb)) {
 		int err = PTR_ERR(qca->rx_skb);
 		bt_dev_err(hu->hdev, "Frame reassembly failed (%d)", err);
@@ -8,6 +8,7 @@
 #include <linux/device.h>
 #include <linux/interrupt.h>
 #include <linux/list.h>
+#include <linux/math64.h>
 #include <linux/mhi.h>
 #include <linux/module.h>
 #include "internal.h"
@@ -71,8 +72,14 @@ static int mhi_debugfs_events_show(struct seq_file *m, void *d)
 		seq_printf(m, " rp: 0x%llx wp: 0x%llx", le64_to_cpu(er_ctxt->rp),
 			   le64_to_cpu(er_ctxt->wp));
 
-		seq_printf(m, " local rp: 0x%pK db: 0x%pad\n", ring->rp,
+		seq_printf(m, " local rp: 0x%pK db: 0x%pad", ring->rp,
 			   &mhi_event->db_cfg.db_val);
+
+		seq_printf(m, " irqs: %llu latency avg: %llu max: %llu ns resched: %llu\n",
+			   mhi_event->irq_count,
+			   mhi_event->irq_count ?
+			   div64_u64(mhi_event->lat_total_ns, mhi_event->irq_count) : 0,
+			   mhi_event->lat_max_ns, mhi_event->budget_exhausted);
 	}
 
 	return 0;
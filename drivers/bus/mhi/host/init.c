@@ -155,6 +155,9 @@ void mhi_deinit_free_irq(struct mhi_controller *mhi_cntrl)
 		if (mhi_event->offload_ev)
 			continue;
 
+		if (mhi_event->data_type != MHI_ER_CTRL)
+			irq_update_affinity_hint(mhi_cntrl->irq[mhi_event->irq],
+						 NULL);
 		free_irq(mhi_cntrl->irq[mhi_event->irq], mhi_event);
 	}
 
@@ -166,6 +169,8 @@ int mhi_init_irq_setup(struct mhi_controller *mhi_cntrl)
 	struct mhi_event *mhi_event = mhi_cntrl->mhi_event;
 	struct device *dev = &mhi_cntrl->mhi_dev->dev;
 	unsigned long irq_flags = IRQF_SHARED | IRQF_NO_SUSPEND;
+	int node = dev_to_node(mhi_cntrl->cntrl_dev);
+	unsigned int cpu = 0;
 	int i, ret;
 
 	/* if controller driver has set irq_flags, use it */
@@ -207,6 +212,14 @@ int mhi_init_irq_setup(struct mhi_controller *mhi_cntrl)
 			goto error_request;
 		}
 
+		/*
+		 * Spread the vectors of data event rings over the CPUs, so
+		 * that the tasklets processing them do not all run on one.
+		 */
+		if (mhi_event->data_type != MHI_ER_CTRL)
+			irq_update_affinity_hint(mhi_cntrl->irq[mhi_event->irq],
+						 cpumask_of(cpumask_local_spread(cpu++, node)));
+
 		disable_irq(mhi_cntrl->irq[mhi_event->irq]);
 	}
 
@@ -217,6 +230,9 @@ int mhi_init_irq_setup(struct mhi_controller *mhi_cntrl)
 		if (mhi_event->offload_ev)
 			continue;
 
+		if (mhi_event->data_type != MHI_ER_CTRL)
+			irq_update_affinity_hint(mhi_cntrl->irq[mhi_event->irq],
+						 NULL);
 		free_irq(mhi_cntrl->irq[mhi_event->irq], mhi_event);
 	}
 	free_irq(mhi_cntrl->irq[0], mhi_cntrl);
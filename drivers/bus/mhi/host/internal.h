@@ -211,6 +211,12 @@ struct mhi_event {
 	bool hw_ring;
 	bool cl_manage;
 	bool offload_ev; /* managed by a device driver */
+	/* IRQ to tasklet latency stats, updated under lock */
+	atomic64_t irq_ts; /* first IRQ not handled yet, 0 if none */
+	u64 irq_count;
+	u64 lat_total_ns;
+	u64 lat_max_ns;
+	u64 budget_exhausted;
 };
 
 struct mhi_chan {
@@ -360,6 +366,13 @@ void mhi_reset_chan(struct mhi_controller *mhi_cntrl,
 		    struct mhi_chan *mhi_chan);
 
 /* Event processing methods */
+/*
+ * Max number of transfer events handled by one run of a data event ring
+ * tasklet.  If there are more, the tasklet is rescheduled so that other
+ * rings and softirqs on the same CPU get to run in between.
+ */
+#define MHI_EV_BUDGET 128
+
 void mhi_ctrl_ev_task(unsigned long data);
 void mhi_ev_task(unsigned long data);
 int mhi_process_data_event_ring(struct mhi_controller *mhi_cntrl,
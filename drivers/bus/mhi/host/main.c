@@ -470,6 +470,7 @@ irqreturn_t mhi_irq_handler(int irq_number, void *dev)
 		if (mhi_dev)
 			mhi_notify(mhi_dev, MHI_CB_PENDING_DATA);
 	} else {
+		atomic64_cmpxchg(&mhi_event->irq_ts, 0, ktime_get_ns());
 		tasklet_schedule(&mhi_event->task);
 	}
 
@@ -1050,10 +1051,25 @@ void mhi_ev_task(unsigned long data)
 {
 	struct mhi_event *mhi_event = (struct mhi_event *)data;
 	struct mhi_controller *mhi_cntrl = mhi_event->mhi_cntrl;
+	u64 irq_ts, lat;
+	int ret;
 
-	/* process all pending events */
 	spin_lock_bh(&mhi_event->lock);
-	mhi_event->process_event(mhi_cntrl, mhi_event, U32_MAX);
+	irq_ts = atomic64_xchg(&mhi_event->irq_ts, 0);
+	if (irq_ts) {
+		lat = ktime_get_ns() - irq_ts;
+		mhi_event->irq_count++;
+		mhi_event->lat_total_ns += lat;
+		if (lat > mhi_event->lat_max_ns)
+			mhi_event->lat_max_ns = lat;
+	}
+
+	/* process up to a budget of events, and come back for the rest */
+	ret = mhi_event->process_event(mhi_cntrl, mhi_event, MHI_EV_BUDGET);
+	if (ret >= MHI_EV_BUDGET) {
+		mhi_event->budget_exhausted++;
+		tasklet_schedule(&mhi_event->task);
+	}
 	spin_unlock_bh(&mhi_event->lock);
 }
 
@@ -1149,7 +1165,7 @@ static int mhi_queue(struct mhi_device *mhi_dev, struct mhi_buf_info *buf_info,
 	if (mhi_chan->dir == DMA_TO_DEVICE)
 		atomic_inc(&mhi_cntrl->pending_pkts);
 
-	if (likely(MHI_DB_ACCESS_VALID(mhi_cntrl)))
+	if (likely(MHI_DB_ACCESS_VALID(mhi_cntrl)) && !(mflags & MHI_DEFER_DB))
 		mhi_ring_chan_db(mhi_cntrl, mhi_chan);
 
 	if (dir == DMA_FROM_DEVICE)
@@ -1160,6 +1176,31 @@ static int mhi_queue(struct mhi_device *mhi_dev, struct mhi_buf_info *buf_info,
 	return ret;
 }
 
+void mhi_queue_flush(struct mhi_device *mhi_dev, enum dma_data_direction dir)
+{
+	struct mhi_controller *mhi_cntrl = mhi_dev->mhi_cntrl;
+	struct mhi_chan *mhi_chan = (dir == DMA_TO_DEVICE) ? mhi_dev->ul_chan :
+							     mhi_dev->dl_chan;
+	unsigned long flags;
+
+	read_lock_irqsave(&mhi_cntrl->pm_lock, flags);
+
+	mhi_cntrl->runtime_get(mhi_cntrl);
+	mhi_cntrl->wake_toggle(mhi_cntrl);
+
+	/*
+	 * If the doorbell can't be rung right now, it is for all channels
+	 * once the device is back in M0.
+	 */
+	if (likely(MHI_DB_ACCESS_VALID(mhi_cntrl)))
+		mhi_ring_chan_db(mhi_cntrl, mhi_chan);
+
+	mhi_cntrl->runtime_put(mhi_cntrl);
+
+	read_unlock_irqrestore(&mhi_cntrl->pm_lock, flags);
+}
+EXPORT_SYMBOL_GPL(mhi_queue_flush);
+
 int mhi_queue_skb(struct mhi_device *mhi_dev, enum dma_data_direction dir,
 		  struct sk_buff *skb, size_t len, enum mhi_flags mflags)
 {
@@ -143,6 +143,10 @@ static inline bool has_state_changed(struct clk_rpmh *c, u32 state)
 static int clk_rpmh_send(struct clk_rpmh *c, enum rpmh_state state,
 			 struct tcs_cmd *cmd, bool wait)
 {
+	/* Sent, and waited for, by the commit of the caller's transaction */
+	if (rpmh_txn_queue(c->dev, state, cmd, 1))
+		return 0;
+
 	if (wait)
 		return rpmh_write(c->dev, state, cmd, 1);
 
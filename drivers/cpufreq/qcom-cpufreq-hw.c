@@ -386,12 +386,17 @@ static irqreturn_t qcom_lmh_dcvs_handle_irq(int irq, void *data)
 
 	/* Disable interrupt and enable polling */
 	disable_irq_nosync(c_data->throttle_irq);
-	schedule_delayed_work(&c_data->throttle_work, 0);
 
 	if (qcom_cpufreq.soc_data->reg_intr_clr)
 		writel_relaxed(GT_IRQ_STATUS,
 			       c_data->base + qcom_cpufreq.soc_data->reg_intr_clr);
 
+	/*
+	 * This already runs in the IRQ thread, update the thermal pressure
+	 * right away rather than from system_wq.
+	 */
+	qcom_lmh_dcvs_notify(c_data);
+
 	return IRQ_HANDLED;
 }
 
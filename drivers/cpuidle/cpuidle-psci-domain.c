@@ -11,6 +11,7 @@
 
 #include <linux/cpu.h>
 #include <linux/device.h>
+#include <linux/interrupt.h>
 #include <linux/kernel.h>
 #include <linux/platform_device.h>
 #include <linux/pm_domain.h>
@@ -175,6 +176,10 @@ static int psci_cpuidle_domain_probe(struct platform_device *pdev)
 	if (ret)
 		goto remove_pd;
 
+#ifdef CONFIG_ARM_PSCI_CPUIDLE_DOMAIN_IRQ_TIMINGS
+	irq_timings_enable();
+#endif
+
 	pr_info("Initialized CPU PM domain topology using %s mode\n",
 		use_osi ? "OSI" : "PC");
 	return 0;
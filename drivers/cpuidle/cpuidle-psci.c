@@ -13,6 +13,7 @@
 #include <linux/cpuidle.h>
 #include <linux/cpumask.h>
 #include <linux/cpu_pm.h>
+#include <linux/interrupt.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/of.h>
@@ -20,6 +21,7 @@
 #include <linux/psci.h>
 #include <linux/pm_domain.h>
 #include <linux/pm_runtime.h>
+#include <linux/sched/clock.h>
 #include <linux/slab.h>
 #include <linux/string.h>
 #include <linux/syscore_ops.h>
@@ -48,6 +50,23 @@ static inline u32 psci_get_domain_state(void)
 	return __this_cpu_read(domain_state);
 }
 
+#ifdef CONFIG_ARM_PSCI_CPUIDLE_DOMAIN_IRQ_TIMINGS
+/* Tell the domain governor when the next interrupt is expected on this CPU */
+static __cpuidle void psci_set_next_irq(struct cpuidle_device *dev)
+{
+	u64 now = local_clock();
+	u64 next = irq_timings_next_event(now);
+
+	if (next == U64_MAX)
+		WRITE_ONCE(dev->next_irq, KTIME_MAX);
+	else
+		WRITE_ONCE(dev->next_irq,
+			   ktime_add_ns(ktime_get(), next > now ? next - now : 0));
+}
+#else
+static inline void psci_set_next_irq(struct cpuidle_device *dev) { }
+#endif
+
 static __cpuidle int __psci_enter_domain_idle_state(struct cpuidle_device *dev,
 						    struct cpuidle_driver *drv, int idx,
 						    bool s2idle)
@@ -63,10 +82,12 @@ static __cpuidle int __psci_enter_domain_idle_state(struct cpuidle_device *dev,
 		return -1;
 
 	/* Do runtime PM to manage a hierarchical CPU toplogy. */
-	if (s2idle)
+	if (s2idle) {
 		dev_pm_genpd_suspend(pd_dev);
-	else
+	} else {
+		psci_set_next_irq(dev);
 		pm_runtime_put_sync_suspend(pd_dev);
+	}
 
 	state = psci_get_domain_state();
 	if (!state)
@@ -622,6 +622,7 @@ static void __cpuidle_device_init(struct cpuidle_device *dev)
 	memset(dev->states_usage, 0, sizeof(dev->states_usage));
 	dev->last_residency_ns = 0;
 	dev->next_hrtimer = 0;
+	dev->next_irq = KTIME_MAX;
 }
 
 /**
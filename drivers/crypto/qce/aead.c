@@ -531,6 +531,7 @@ static int qce_aead_crypt(struct aead_request *req, int encrypt)
 	if (ctx->need_fallback) {
 		/* Reset need_fallback in case the same ctx is used for another transaction */
 		ctx->need_fallback = false;
+		atomic_inc(&tmpl->qce->sw_reqs);
 
 		aead_request_set_tfm(&rctx->fallback_req, ctx->fallback);
 		aead_request_set_callback(&rctx->fallback_req, req->base.flags,
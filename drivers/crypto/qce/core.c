@@ -4,6 +4,7 @@
  */
 
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/dma-mapping.h>
 #include <linux/interconnect.h>
 #include <linux/interrupt.h>
@@ -22,7 +23,7 @@
 #include "aead.h"
 
 #define QCE_MAJOR_VERSION5	0x05
-#define QCE_QUEUE_LENGTH	1
+#define QCE_QUEUE_LENGTH	64
 
 #define QCE_DEFAULT_MEM_BANDWIDTH	393600
 
@@ -101,8 +102,10 @@ static int qce_handle_queue(struct qce_device *qce,
 
 	backlog = crypto_get_backlog(&qce->queue);
 	async_req = crypto_dequeue_request(&qce->queue);
-	if (async_req)
+	if (async_req) {
 		qce->req = async_req;
+		atomic_inc(&qce->hw_reqs);
+	}
 
 	spin_unlock_irqrestore(&qce->lock, flags);
 
@@ -129,16 +132,23 @@ static void qce_tasklet_req_done(unsigned long data)
 	struct qce_device *qce = (struct qce_device *)data;
 	struct crypto_async_request *req;
 	unsigned long flags;
+	int result;
 
 	spin_lock_irqsave(&qce->lock, flags);
 	req = qce->req;
 	qce->req = NULL;
+	result = qce->result;
 	spin_unlock_irqrestore(&qce->lock, flags);
 
-	if (req)
-		crypto_request_complete(req, qce->result);
-
+	/*
+	 * The done callbacks are finished with the engine and the shared
+	 * result buffer, so keep the engine busy with the next request while
+	 * this one is completed.
+	 */
 	qce_handle_queue(qce, NULL);
+
+	if (req)
+		crypto_request_complete(req, result);
 }
 
 static int qce_async_request_enqueue(struct qce_device *qce,
@@ -280,6 +290,13 @@ static int qce_crypto_probe(struct platform_device *pdev)
 	if (ret)
 		goto err_dma;
 
+	qce->debugfs = debugfs_create_dir(dev_name(dev), NULL);
+	debugfs_create_u32("queued", 0444, qce->debugfs, &qce->queue.qlen);
+	debugfs_create_atomic_t("hw_requests", 0444, qce->debugfs,
+				&qce->hw_reqs);
+	debugfs_create_atomic_t("sw_requests", 0444, qce->debugfs,
+				&qce->sw_reqs);
+
 	return 0;
 
 err_dma:
@@ -301,6 +318,7 @@ static int qce_crypto_remove(struct platform_device *pdev)
 	struct qce_device *qce = platform_get_drvdata(pdev);
 	int ret = 0;
 
+	debugfs_remove_recursive(qce->debugfs);
 	tasklet_kill(&qce->done_tasklet);
 	qce_unregister_algs(qce);
 	ret = icc_set_bw(qce->mem_path, qce->icc_bw, qce->icc_bw);
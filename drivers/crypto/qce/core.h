@@ -25,6 +25,9 @@
  * @pipe_pair_id: which pipe pair id the device using
  * @async_req_enqueue: invoked by every algorithm to enqueue a request
  * @async_req_done: invoked by every algorithm to finish its request
+ * @debugfs: debugfs directory of the device
+ * @hw_reqs: number of requests handled by the engine
+ * @sw_reqs: number of requests handed to the software fallbacks
  */
 struct qce_device {
 	struct crypto_queue queue;
@@ -47,6 +50,9 @@ struct qce_device {
 	__le32 *reg_read_buf;
 	dma_addr_t reg_buf_phys;
 	bool qce_cmd_desc_enable;
+	struct dentry *debugfs;
+	atomic_t hw_reqs;
+	atomic_t sw_reqs;
 };
 
 /**
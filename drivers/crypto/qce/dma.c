@@ -237,6 +237,13 @@ static struct qce_bam_transaction *qce_alloc_bam_txn(struct qce_dma_data *dma)
 int qce_dma_request(struct device *dev, struct qce_dma_data *dma)
 {
 	struct qce_device *qce = container_of(dma, struct qce_device, dma);
+	struct bam_slave_config bam_cfg = {
+		.flags = BAM_CONFIG_IRQ_MODERATION,
+	};
+	struct dma_slave_config cfg = {
+		.peripheral_config = &bam_cfg,
+		.peripheral_size = sizeof(bam_cfg),
+	};
 	int ret;
 
 	dma->txchan = dma_request_chan(dev, "tx");
@@ -249,6 +256,16 @@ int qce_dma_request(struct device *dev, struct qce_dma_data *dma)
 		goto error_rx;
 	}
 
+	/*
+	 * Only the last transaction of a request has a callback, and the
+	 * command descriptors ahead of it don't need an interrupt either.
+	 */
+	ret = dmaengine_slave_config(dma->txchan, &cfg);
+	if (!ret)
+		ret = dmaengine_slave_config(dma->rxchan, &cfg);
+	if (ret)
+		goto error_nomem;
+
 	dma->result_buf = kmalloc(QCE_RESULT_BUF_SZ + QCE_IGNORE_BUF_SZ,
 				  GFP_KERNEL);
 	if (!dma->result_buf) {
@@ -22,6 +22,12 @@ MODULE_PARM_DESC(aes_sw_max_len,
 		 "[0=always use hardware; anything <16 breaks AES-GCM; default="
 		 __stringify(CONFIG_CRYPTO_DEV_QCE_SW_MAX_LEN)"]");
 
+static unsigned int aes_sw_queue_depth;
+module_param(aes_sw_queue_depth, uint, 0644);
+MODULE_PARM_DESC(aes_sw_queue_depth,
+		 "Use software for AES requests while this many requests are "
+		 "waiting for the hardware [0=never; default=0]");
+
 static LIST_HEAD(skcipher_algs);
 
 static void qce_skcipher_done(void *data)
@@ -292,12 +298,17 @@ static int qce_skcipher_crypt(struct skcipher_request *req, int encrypt)
 	 * AES-XTS request with len > QCE_SECTOR_SIZE and
 	 * is not a multiple of it.(Revisit this condition to check if it is
 	 * needed in all versions of CE)
+	 * AES request while the hardware queue is at least aes_sw_queue_depth
+	 * deep, the CPU is likely to finish it sooner.
 	 */
 	if (IS_AES(rctx->flags) &&
 	    ((keylen != AES_KEYSIZE_128 && keylen != AES_KEYSIZE_256) ||
 	    (IS_XTS(rctx->flags) && ((req->cryptlen <= aes_sw_max_len) ||
 	    (req->cryptlen > QCE_SECTOR_SIZE &&
-	    req->cryptlen % QCE_SECTOR_SIZE))))) {
+	    req->cryptlen % QCE_SECTOR_SIZE))) ||
+	    (aes_sw_queue_depth &&
+	     READ_ONCE(tmpl->qce->queue.qlen) >= aes_sw_queue_depth))) {
+		atomic_inc(&tmpl->qce->sw_reqs);
 		skcipher_request_set_tfm(&rctx->fallback_req, ctx->fallback);
 		skcipher_request_set_callback(&rctx->fallback_req,
 					      req->base.flags,
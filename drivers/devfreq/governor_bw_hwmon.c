@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ *  linux/drivers/devfreq/governor_bw_hwmon.c
+ *
+ *  Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Scales a memory bus (DDR, LLCC) with the traffic measured by a hardware
+ * bandwidth monitor.  The device reports the bytes that went over the bus
+ * in busy_time and the length of the window they were counted over, in
+ * microseconds, in total_time.  The frequency goes up as soon as more
+ * bandwidth is measured and only comes down once the traffic has stayed
+ * low for hyst_ms, so that bursts don't stall while idle periods still end
+ * up at the lowest level.  Floors requested by clients through the devfreq
+ * min_freq PM QoS requests are applied on top by the devfreq core.
+ */
+
+#include <linux/errno.h>
+#include <linux/jiffies.h>
+#include <linux/module.h>
+#include <linux/devfreq.h>
+#include <linux/math64.h>
+#include "governor.h"
+
+/* Default constants for the bandwidth monitor governor */
+#define BW_HWMON_IO_PERCENT	(80)
+#define BW_HWMON_HYST_MS	(100)
+
+static int devfreq_bw_hwmon_func(struct devfreq *df, unsigned long *freq)
+{
+	int err;
+	struct devfreq_dev_status *stat;
+	struct devfreq_bw_hwmon_data *data = df->data;
+	unsigned int io_percent = BW_HWMON_IO_PERCENT;
+	unsigned int hyst_ms = BW_HWMON_HYST_MS;
+	u64 bw;
+
+	if (!data || !data->bytes_per_cycle)
+		return -EINVAL;
+
+	if (data->io_percent)
+		io_percent = data->io_percent;
+	if (data->hyst_ms)
+		hyst_ms = data->hyst_ms;
+	if (io_percent > 100)
+		return -EINVAL;
+
+	err = devfreq_update_stats(df);
+	if (err)
+		return err;
+
+	stat = &df->last_status;
+
+	/* Assume MAX if there is no measurement */
+	if (stat->total_time == 0) {
+		*freq = DEVFREQ_MAX_FREQ;
+		data->last_high = jiffies;
+		return 0;
+	}
+
+	/* Bytes per second, then cycles per second needed to carry them */
+	bw = div_u64((u64)stat->busy_time * USEC_PER_SEC, stat->total_time);
+	bw = div_u64(bw * 100, data->bytes_per_cycle * io_percent);
+	*freq = (unsigned long)min_t(u64, bw, DEVFREQ_MAX_FREQ);
+
+	/* Ramp up right away */
+	if (*freq >= stat->current_frequency) {
+		data->last_high = jiffies;
+		return 0;
+	}
+
+	/* Only go down once the traffic has been low for long enough */
+	if (time_before(jiffies, data->last_high + msecs_to_jiffies(hyst_ms)))
+		*freq = stat->current_frequency;
+
+	return 0;
+}
+
+static int devfreq_bw_hwmon_handler(struct devfreq *devfreq,
+				unsigned int event, void *data)
+{
+	struct devfreq_bw_hwmon_data *hw_data = devfreq->data;
+
+	switch (event) {
+	case DEVFREQ_GOV_START:
+		if (!hw_data || !hw_data->bytes_per_cycle)
+			return -EINVAL;
+		hw_data->last_high = jiffies;
+		devfreq_monitor_start(devfreq);
+		break;
+
+	case DEVFREQ_GOV_STOP:
+		devfreq_monitor_stop(devfreq);
+		break;
+
+	case DEVFREQ_GOV_UPDATE_INTERVAL:
+		devfreq_update_interval(devfreq, (unsigned int *)data);
+		break;
+
+	case DEVFREQ_GOV_SUSPEND:
+		devfreq_monitor_suspend(devfreq);
+		break;
+
+	case DEVFREQ_GOV_RESUME:
+		/* Start from the current frequency, not from before suspend */
+		hw_data->last_high = jiffies;
+		devfreq_monitor_resume(devfreq);
+		break;
+
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+static struct devfreq_governor devfreq_bw_hwmon = {
+	.name = DEVFREQ_GOV_BW_HWMON,
+	.attrs = DEVFREQ_GOV_ATTR_POLLING_INTERVAL
+		| DEVFREQ_GOV_ATTR_TIMER,
+	.get_target_freq = devfreq_bw_hwmon_func,
+	.event_handler = devfreq_bw_hwmon_handler,
+};
+
+static int __init devfreq_bw_hwmon_init(void)
+{
+	return devfreq_add_governor(&devfreq_bw_hwmon);
+}
+subsys_initcall(devfreq_bw_hwmon_init);
+
+static void __exit devfreq_bw_hwmon_exit(void)
+{
+	int ret;
+
+	ret = devfreq_remove_governor(&devfreq_bw_hwmon);
+	if (ret)
+		pr_err("%s: failed remove governor %d\n", __func__, ret);
+}
+module_exit(devfreq_bw_hwmon_exit);
+MODULE_DESCRIPTION("DEVFREQ bandwidth monitor governor");
+MODULE_LICENSE("GPL");
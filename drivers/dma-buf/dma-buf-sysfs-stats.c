@@ -8,8 +8,12 @@
 #include <linux/dma-buf.h>
 #include <linux/dma-resv.h>
 #include <linux/kobject.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
 #include <linux/printk.h>
 #include <linux/slab.h>
+#include <linux/string.h>
 #include <linux/sysfs.h>
 
 #include "dma-buf-sysfs-stats.h"
@@ -41,6 +45,19 @@
  * * ``/sys/kernel/dmabuf/buffers/<inode_number>/exporter_name``
  * * ``/sys/kernel/dmabuf/buffers/<inode_number>/size``
  *
+ * Counters of the operations on the buffers of each exporter are exposed at
+ * ``/sys/kernel/dmabuf/exporters/<exporter_name>``:
+ *
+ * * ``attach`` and ``detach``: calls to dma_buf_attach() and dma_buf_detach()
+ * * ``attachments``: attachments currently alive
+ * * ``map`` and ``unmap``: mappings created and torn down by the exporter
+ * * ``map_time_ns``: total time the exporter spent creating mappings
+ * * ``begin_cpu_access_bytes`` and ``end_cpu_access_bytes``: bytes handed to
+ *   the exporter for cache maintenance around CPU access
+ *
+ * The counters are per-CPU, so keeping them enabled costs one local add per
+ * operation.
+ *
  * The information in the interface can also be used to derive per-exporter
  * statistics. The data from the interface can be gathered on error conditions
  * or other important events to provide a snapshot of DMA-BUF usage.
@@ -104,6 +121,106 @@ static struct attribute *dma_buf_stats_default_attrs[] = {
 };
 ATTRIBUTE_GROUPS(dma_buf_stats_default);
 
+/**
+ * struct dma_buf_exporter_stats - counters shared by the buffers of an exporter
+ * @kobj: the exporters/<name> directory
+ * @node: entry in dma_buf_exporters
+ * @name: copy of &dma_buf.exp_name
+ * @counters: per-CPU counters, indexed by enum dma_buf_stat
+ *
+ * These are created with the first buffer of an exporter and stay around
+ * until the statistics are torn down, so that counters are not lost while an
+ * exporter has no buffers.
+ */
+struct dma_buf_exporter_stats {
+	struct kobject kobj;
+	struct list_head node;
+	const char *name;
+	u64 __percpu *counters;
+};
+#define to_dma_buf_exporter_stats(x) container_of(x, struct dma_buf_exporter_stats, kobj)
+
+static LIST_HEAD(dma_buf_exporters);
+static DEFINE_MUTEX(dma_buf_exporters_lock);
+
+static u64 dma_buf_exporter_stat(struct dma_buf_exporter_stats *exporter,
+				 enum dma_buf_stat stat)
+{
+	u64 sum = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		sum += per_cpu_ptr(exporter->counters, cpu)[stat];
+
+	return sum;
+}
+
+#define DMA_BUF_EXPORTER_ATTR(_name, _stat)					\
+static ssize_t _name##_show(struct kobject *kobj,				\
+			    struct kobj_attribute *attr, char *buf)		\
+{										\
+	return sysfs_emit(buf, "%llu\n",					\
+			  dma_buf_exporter_stat(to_dma_buf_exporter_stats(kobj),	\
+						_stat));			\
+}										\
+static struct kobj_attribute _name##_attribute = __ATTR_RO(_name)
+
+DMA_BUF_EXPORTER_ATTR(attach, DMA_BUF_STAT_ATTACH);
+DMA_BUF_EXPORTER_ATTR(detach, DMA_BUF_STAT_DETACH);
+DMA_BUF_EXPORTER_ATTR(map, DMA_BUF_STAT_MAP);
+DMA_BUF_EXPORTER_ATTR(unmap, DMA_BUF_STAT_UNMAP);
+DMA_BUF_EXPORTER_ATTR(map_time_ns, DMA_BUF_STAT_MAP_NS);
+DMA_BUF_EXPORTER_ATTR(begin_cpu_access_bytes, DMA_BUF_STAT_BEGIN_CPU_ACCESS_BYTES);
+DMA_BUF_EXPORTER_ATTR(end_cpu_access_bytes, DMA_BUF_STAT_END_CPU_ACCESS_BYTES);
+
+static ssize_t attachments_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	struct dma_buf_exporter_stats *exporter = to_dma_buf_exporter_stats(kobj);
+
+	/* Summed without a lock, so don't show a transient underflow */
+	return sysfs_emit(buf, "%lld\n",
+			  max_t(s64, 0, dma_buf_exporter_stat(exporter, DMA_BUF_STAT_ATTACH) -
+				dma_buf_exporter_stat(exporter, DMA_BUF_STAT_DETACH)));
+}
+static struct kobj_attribute attachments_attribute = __ATTR_RO(attachments);
+
+static struct attribute *dma_buf_exporter_attrs[] = {
+	&attach_attribute.attr,
+	&detach_attribute.attr,
+	&attachments_attribute.attr,
+	&map_attribute.attr,
+	&unmap_attribute.attr,
+	&map_time_ns_attribute.attr,
+	&begin_cpu_access_bytes_attribute.attr,
+	&end_cpu_access_bytes_attribute.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(dma_buf_exporter);
+
+static void dma_buf_exporter_release(struct kobject *kobj)
+{
+	struct dma_buf_exporter_stats *exporter = to_dma_buf_exporter_stats(kobj);
+
+	free_percpu(exporter->counters);
+	kfree_const(exporter->name);
+	kfree(exporter);
+}
+
+static const struct kobj_type dma_buf_exporter_ktype = {
+	.sysfs_ops = &kobj_sysfs_ops,
+	.release = dma_buf_exporter_release,
+	.default_groups = dma_buf_exporter_groups,
+};
+
+void dma_buf_stats_add(struct dma_buf *dmabuf, enum dma_buf_stat stat, u64 val)
+{
+	struct dma_buf_sysfs_entry *sysfs_entry = dmabuf->sysfs_entry;
+
+	if (sysfs_entry && sysfs_entry->exporter)
+		this_cpu_add(sysfs_entry->exporter->counters[stat], val);
+}
+
 static void dma_buf_sysfs_release(struct kobject *kobj)
 {
 	struct dma_buf_sysfs_entry *sysfs_entry;
@@ -143,6 +260,49 @@ static const struct kset_uevent_ops dmabuf_sysfs_no_uevent_ops = {
 
 static struct kset *dma_buf_stats_kset;
 static struct kset *dma_buf_per_buffer_stats_kset;
+static struct kset *dma_buf_per_exporter_stats_kset;
+
+static struct dma_buf_exporter_stats *dma_buf_exporter_get(const char *name)
+{
+	struct dma_buf_exporter_stats *exporter;
+	int ret;
+
+	mutex_lock(&dma_buf_exporters_lock);
+
+	list_for_each_entry(exporter, &dma_buf_exporters, node)
+		if (!strcmp(exporter->name, name))
+			goto unlock;
+
+	exporter = kzalloc(sizeof(*exporter), GFP_KERNEL);
+	if (!exporter)
+		goto unlock;
+
+	exporter->name = kstrdup_const(name, GFP_KERNEL);
+	exporter->counters = __alloc_percpu(DMA_BUF_STAT_COUNT * sizeof(u64),
+					    sizeof(u64));
+	if (!exporter->name || !exporter->counters) {
+		free_percpu(exporter->counters);
+		kfree_const(exporter->name);
+		kfree(exporter);
+		exporter = NULL;
+		goto unlock;
+	}
+
+	exporter->kobj.kset = dma_buf_per_exporter_stats_kset;
+	ret = kobject_init_and_add(&exporter->kobj, &dma_buf_exporter_ktype,
+				   NULL, "%s", exporter->name);
+	if (ret) {
+		kobject_put(&exporter->kobj);
+		exporter = NULL;
+		goto unlock;
+	}
+
+	list_add(&exporter->node, &dma_buf_exporters);
+unlock:
+	mutex_unlock(&dma_buf_exporters_lock);
+	return exporter;
+}
+
 int dma_buf_init_sysfs_statistics(void)
 {
 	dma_buf_stats_kset = kset_create_and_add("dmabuf",
@@ -159,11 +319,31 @@ int dma_buf_init_sysfs_statistics(void)
 		return -ENOMEM;
 	}
 
+	dma_buf_per_exporter_stats_kset = kset_create_and_add("exporters",
+							      &dmabuf_sysfs_no_uevent_ops,
+							      &dma_buf_stats_kset->kobj);
+	if (!dma_buf_per_exporter_stats_kset) {
+		kset_unregister(dma_buf_per_buffer_stats_kset);
+		kset_unregister(dma_buf_stats_kset);
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
 void dma_buf_uninit_sysfs_statistics(void)
 {
+	struct dma_buf_exporter_stats *exporter, *tmp;
+
+	mutex_lock(&dma_buf_exporters_lock);
+	list_for_each_entry_safe(exporter, tmp, &dma_buf_exporters, node) {
+		list_del(&exporter->node);
+		kobject_del(&exporter->kobj);
+		kobject_put(&exporter->kobj);
+	}
+	mutex_unlock(&dma_buf_exporters_lock);
+
+	kset_unregister(dma_buf_per_exporter_stats_kset);
 	kset_unregister(dma_buf_per_buffer_stats_kset);
 	kset_unregister(dma_buf_stats_kset);
 }
@@ -193,6 +373,9 @@ int dma_buf_stats_setup(struct dma_buf *dmabuf, struct file *file)
 	if (ret)
 		goto err_sysfs_dmabuf;
 
+	/* The per-exporter counters are best effort, the buffer works without */
+	sysfs_entry->exporter = dma_buf_exporter_get(dmabuf->exp_name);
+
 	return 0;
 
 err_sysfs_dmabuf:
@@ -8,6 +8,23 @@
 #ifndef _DMA_BUF_SYSFS_STATS_H
 #define _DMA_BUF_SYSFS_STATS_H
 
+/*
+ * Per-exporter counters, exposed under /sys/kernel/dmabuf/exporters/<name>/.
+ * DMA_BUF_STAT_MAP_NS accumulates the time spent in &dma_buf_ops.map_dma_buf,
+ * the CPU_ACCESS counters the bytes passed to the exporter's begin and end
+ * CPU access hooks.
+ */
+enum dma_buf_stat {
+	DMA_BUF_STAT_ATTACH,
+	DMA_BUF_STAT_DETACH,
+	DMA_BUF_STAT_MAP,
+	DMA_BUF_STAT_UNMAP,
+	DMA_BUF_STAT_MAP_NS,
+	DMA_BUF_STAT_BEGIN_CPU_ACCESS_BYTES,
+	DMA_BUF_STAT_END_CPU_ACCESS_BYTES,
+	DMA_BUF_STAT_COUNT,
+};
+
 #ifdef CONFIG_DMABUF_SYSFS_STATS
 
 int dma_buf_init_sysfs_statistics(void);
@@ -16,6 +33,8 @@ void dma_buf_uninit_sysfs_statistics(void);
 int dma_buf_stats_setup(struct dma_buf *dmabuf, struct file *file);
 
 void dma_buf_stats_teardown(struct dma_buf *dmabuf);
+
+void dma_buf_stats_add(struct dma_buf *dmabuf, enum dma_buf_stat stat, u64 val);
 #else
 
 static inline int dma_buf_init_sysfs_statistics(void)
@@ -31,5 +50,8 @@ static inline int dma_buf_stats_setup(struct dma_buf *dmabuf, struct file *file)
 }
 
 static inline void dma_buf_stats_teardown(struct dma_buf *dmabuf) {}
+
+static inline void dma_buf_stats_add(struct dma_buf *dmabuf,
+				     enum dma_buf_stat stat, u64 val) {}
 #endif
 #endif // _DMA_BUF_SYSFS_STATS_H
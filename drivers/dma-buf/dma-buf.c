@@ -26,6 +26,7 @@
 #include <linux/sync_file.h>
 #include <linux/poll.h>
 #include <linux/dma-resv.h>
+#include <linux/ktime.h>
 #include <linux/mm.h>
 #include <linux/mount.h>
 #include <linux/pseudo_fs.h>
@@ -742,6 +743,25 @@ struct dma_buf *dma_buf_get(int fd)
 }
 EXPORT_SYMBOL_NS_GPL(dma_buf_get, DMA_BUF);
 
+/**
+ * dma_buf_get_file - returns the struct dma_buf behind a file
+ * @file:	[in]	file that may be the file of a struct dma_buf
+ *
+ * This is for callers that find a buffer through a mapping of it, e.g. from
+ * vma->vm_file, rather than through an fd.  On success, returns the struct
+ * dma_buf of @file with a reference taken on it, which is dropped with
+ * dma_buf_put().  Returns ERR_PTR(-EINVAL) if @file is not a dma_buf file.
+ */
+struct dma_buf *dma_buf_get_file(struct file *file)
+{
+	if (!is_dma_buf_file(file))
+		return ERR_PTR(-EINVAL);
+
+	get_file(file);
+	return file->private_data;
+}
+EXPORT_SYMBOL_NS_GPL(dma_buf_get_file, DMA_BUF);
+
 /**
  * dma_buf_put - decreases refcount of the buffer
  * @dmabuf:	[in]	buffer to reduce refcount of
@@ -781,11 +801,17 @@ static struct sg_table * __map_dma_buf(struct dma_buf_attachment *attach,
 {
 	struct sg_table *sg_table;
 	signed long ret;
+	u64 start;
 
+	start = ktime_get_ns();
 	sg_table = attach->dmabuf->ops->map_dma_buf(attach, direction);
 	if (IS_ERR_OR_NULL(sg_table))
 		return sg_table;
 
+	dma_buf_stats_add(attach->dmabuf, DMA_BUF_STAT_MAP_NS,
+			  ktime_get_ns() - start);
+	dma_buf_stats_add(attach->dmabuf, DMA_BUF_STAT_MAP, 1);
+
 	if (!dma_buf_attachment_is_dynamic(attach)) {
 		ret = dma_resv_wait_timeout(attach->dmabuf->resv,
 					    DMA_RESV_USAGE_KERNEL, true,
@@ -793,6 +819,7 @@ static struct sg_table * __map_dma_buf(struct dma_buf_attachment *attach,
 		if (ret < 0) {
 			attach->dmabuf->ops->unmap_dma_buf(attach, sg_table,
 							   direction);
+			dma_buf_stats_add(attach->dmabuf, DMA_BUF_STAT_UNMAP, 1);
 			return ERR_PTR(ret);
 		}
 	}
@@ -920,6 +947,7 @@ dma_buf_dynamic_attach(struct dma_buf *dmabuf, struct device *dev,
 	dma_resv_lock(dmabuf->resv, NULL);
 	list_add(&attach->node, &dmabuf->attachments);
 	dma_resv_unlock(dmabuf->resv);
+	dma_buf_stats_add(dmabuf, DMA_BUF_STAT_ATTACH, 1);
 
 	/* When either the importer or the exporter can't handle dynamic
 	 * mappings we cache the mapping here to avoid issues with the
@@ -989,6 +1017,7 @@ static void __unmap_dma_buf(struct dma_buf_attachment *attach,
 	mangle_sg_table(sg_table);
 
 	attach->dmabuf->ops->unmap_dma_buf(attach, sg_table, direction);
+	dma_buf_stats_add(attach->dmabuf, DMA_BUF_STAT_UNMAP, 1);
 }
 
 /**
@@ -1020,6 +1049,7 @@ void dma_buf_detach(struct dma_buf *dmabuf, struct dma_buf_attachment *attach)
 
 	if (dmabuf->ops->detach)
 		dmabuf->ops->detach(dmabuf, attach);
+	dma_buf_stats_add(dmabuf, DMA_BUF_STAT_DETACH, 1);
 
 	kfree(attach);
 }
@@ -1400,8 +1430,12 @@ int dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
 
 	might_lock(&dmabuf->resv->lock.base);
 
-	if (dmabuf->ops->begin_cpu_access)
+	if (dmabuf->ops->begin_cpu_access) {
 		ret = dmabuf->ops->begin_cpu_access(dmabuf, direction);
+		if (!ret)
+			dma_buf_stats_add(dmabuf, DMA_BUF_STAT_BEGIN_CPU_ACCESS_BYTES,
+					  dmabuf->size);
+	}
 
 	/* Ensure that all fences are waited upon - but we first allow
 	 * the native handler the chance to do so more efficiently if it
@@ -1422,9 +1456,13 @@ int dma_buf_begin_cpu_access_partial(struct dma_buf *dmabuf,
 
 	if (WARN_ON(!dmabuf))
 		return -EINVAL;
-	if (dmabuf->ops->begin_cpu_access_partial)
+	if (dmabuf->ops->begin_cpu_access_partial) {
 		ret = dmabuf->ops->begin_cpu_access_partial(dmabuf, direction,
 				offset, len);
+		if (!ret)
+			dma_buf_stats_add(dmabuf, DMA_BUF_STAT_BEGIN_CPU_ACCESS_BYTES,
+					  len);
+	}
 	/* Ensure that all fences are waited upon - but we first allow
 	 * the native handler the chance to do so more efficiently if it
 	 * chooses. A double invocation here will be reasonably cheap no-op.
@@ -1456,8 +1494,12 @@ int dma_buf_end_cpu_access(struct dma_buf *dmabuf,
 
 	might_lock(&dmabuf->resv->lock.base);
 
-	if (dmabuf->ops->end_cpu_access)
+	if (dmabuf->ops->end_cpu_access) {
 		ret = dmabuf->ops->end_cpu_access(dmabuf, direction);
+		if (!ret)
+			dma_buf_stats_add(dmabuf, DMA_BUF_STAT_END_CPU_ACCESS_BYTES,
+					  dmabuf->size);
+	}
 
 	return ret;
 }
@@ -1470,9 +1512,13 @@ int dma_buf_end_cpu_access_partial(struct dma_buf *dmabuf,
 	int ret = 0;
 
 	WARN_ON(!dmabuf);
-	if (dmabuf->ops->end_cpu_access_partial)
+	if (dmabuf->ops->end_cpu_access_partial) {
 		ret = dmabuf->ops->end_cpu_access_partial(dmabuf, direction,
 				offset, len);
+		if (!ret)
+			dma_buf_stats_add(dmabuf, DMA_BUF_STAT_END_CPU_ACCESS_BYTES,
+					  len);
+	}
 	return ret;
 }
 EXPORT_SYMBOL_GPL(dma_buf_end_cpu_access_partial);
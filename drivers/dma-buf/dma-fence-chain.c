@@ -28,6 +28,49 @@ static struct dma_fence *dma_fence_chain_get_prev(struct dma_fence_chain *chain)
 	return prev;
 }
 
+/**
+ * dma_fence_chain_get_skip - use RCU to get a reference to the skip node
+ * @chain: chain node to get the skip node from
+ *
+ * Returns NULL if the node has no skip node (any more).
+ */
+static struct dma_fence *dma_fence_chain_get_skip(struct dma_fence_chain *chain)
+{
+	struct dma_fence *skip;
+
+	if (!rcu_access_pointer(chain->skip))
+		return NULL;
+
+	rcu_read_lock();
+	skip = dma_fence_get_rcu_safe(&chain->skip);
+	rcu_read_unlock();
+	return skip;
+}
+
+/*
+ * A skip node is only useful while there are unsignaled nodes behind it, so
+ * it is dropped as soon as its own fence is signaled.  Otherwise it would
+ * keep already garbage collected parts of the chain alive.
+ */
+static void dma_fence_chain_gc_skip(struct dma_fence_chain *chain)
+{
+	struct dma_fence *skip, *tmp;
+
+	skip = dma_fence_chain_get_skip(chain);
+	if (!skip)
+		return;
+
+	if (dma_fence_is_signaled(to_dma_fence_chain(skip)->fence)) {
+		tmp = unrcu_pointer(cmpxchg(&chain->skip, RCU_INITIALIZER(skip),
+					    NULL));
+		if (tmp == skip) {
+			WRITE_ONCE(chain->skip_span, 1);
+			dma_fence_put(tmp);
+		}
+	}
+	dma_fence_put(skip);
+}
+
 /**
  * dma_fence_chain_walk - chain walking function
  * @fence: current chain node
@@ -47,6 +90,8 @@ struct dma_fence *dma_fence_chain_walk(struct dma_fence *fence)
 		return NULL;
 	}
 
+	dma_fence_chain_gc_skip(chain);
+
 	while ((prev = dma_fence_chain_get_prev(chain))) {
 
 		prev_chain = to_dma_fence_chain(prev);
@@ -84,12 +129,17 @@ EXPORT_SYMBOL(dma_fence_chain_walk);
  * Advance the fence pointer to the chain node which will signal this sequence
  * number. If no sequence number is provided then this is a no-op.
  *
+ * Runs of nodes which are all later than @seqno are leapt over through their
+ * skip nodes, so the search takes a logarithmic rather than linear number of
+ * steps in the number of pending points.
+ *
  * Returns EINVAL if the fence is not a chain node or the sequence number has
  * not yet advanced far enough.
  */
 int dma_fence_chain_find_seqno(struct dma_fence **pfence, uint64_t seqno)
 {
 	struct dma_fence_chain *chain;
+	struct dma_fence *fence;
 
 	if (!seqno)
 		return 0;
@@ -98,12 +148,30 @@ int dma_fence_chain_find_seqno(struct dma_fence **pfence, uint64_t seqno)
 	if (!chain || chain->base.seqno < seqno)
 		return -EINVAL;
 
-	dma_fence_chain_for_each(*pfence, &chain->base) {
-		if ((*pfence)->context != chain->base.context ||
-		    to_dma_fence_chain(*pfence)->prev_seqno < seqno)
+	/* Everything up to here is signaled, so is @seqno: */
+	if (test_bit(DMA_FENCE_FLAG_SIGNALED_BIT, &chain->base.flags))
+		return 0;
+
+	fence = dma_fence_get(&chain->base);
+	while (fence) {
+		struct dma_fence *skip;
+
+		if (fence->context != chain->base.context ||
+		    to_dma_fence_chain(fence)->prev_seqno < seqno)
 			break;
+
+		skip = dma_fence_chain_get_skip(to_dma_fence_chain(fence));
+		if (skip && skip->seqno >= seqno) {
+			dma_fence_put(fence);
+			fence = skip;
+			continue;
+		}
+		dma_fence_put(skip);
+
+		fence = dma_fence_chain_walk(fence);
 	}
 	dma_fence_put(&chain->base);
+	*pfence = fence;
 
 	return 0;
 }
@@ -175,32 +243,52 @@ static bool dma_fence_chain_signaled(struct dma_fence *fence)
 	return true;
 }
 
+/*
+ * Drop the references @chain holds on older nodes.  Nodes for which that
+ * would be the last reference are pushed on @stack instead, for the caller to
+ * unlink in turn.
+ */
+static void dma_fence_chain_unlink(struct dma_fence_chain *chain,
+				   struct dma_fence_chain **stack)
+{
+	struct dma_fence *links[] = {
+		rcu_replace_pointer(chain->prev, NULL, true),
+		rcu_replace_pointer(chain->skip, NULL, true),
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(links); i++) {
+		struct dma_fence_chain *link = to_dma_fence_chain(links[i]);
+
+		if (link && kref_read(&link->base.refcount) == 1) {
+			link->release_next = *stack;
+			*stack = link;
+		} else {
+			dma_fence_put(links[i]);
+		}
+	}
+}
+
 static void dma_fence_chain_release(struct dma_fence *fence)
 {
 	struct dma_fence_chain *chain = to_dma_fence_chain(fence);
-	struct dma_fence *prev;
+	struct dma_fence_chain *stack = NULL;
 
 	/* Manually unlink the chain as much as possible to avoid recursion
-	 * and potential stack overflow.
+	 * and potential stack overflow. Both the previous and the skip node
+	 * can hold the last reference to a long run of older nodes.
 	 */
-	while ((prev = rcu_dereference_protected(chain->prev, true))) {
-		struct dma_fence_chain *prev_chain;
-
-		if (kref_read(&prev->refcount) > 1)
-		       break;
-
-		prev_chain = to_dma_fence_chain(prev);
-		if (!prev_chain)
-			break;
+	dma_fence_chain_unlink(chain, &stack);
+	while (stack) {
+		struct dma_fence_chain *next = stack;
 
 		/* No need for atomic operations since we hold the last
-		 * reference to prev_chain.
+		 * reference to next.
 		 */
-		chain->prev = prev_chain->prev;
-		RCU_INIT_POINTER(prev_chain->prev, NULL);
-		dma_fence_put(prev);
+		stack = next->release_next;
+		dma_fence_chain_unlink(next, &stack);
+		dma_fence_put(&next->base);
 	}
-	dma_fence_put(prev);
 
 	dma_fence_put(chain->fence);
 	dma_fence_free(fence);
@@ -228,6 +316,37 @@ const struct dma_fence_ops dma_fence_chain_ops = {
 };
 EXPORT_SYMBOL(dma_fence_chain_ops);
 
+/*
+ * Skip nodes follow Myers' skew-binary jump pointers: a node leaps over
+ * twice what its predecessor's skip leaps over whenever that predecessor and
+ * its own skip node leap over as much as each other, and to its immediate
+ * predecessor otherwise.  That keeps any node in reach in O(log n) steps with
+ * a single extra pointer per node.
+ */
+static void dma_fence_chain_init_skip(struct dma_fence_chain *chain,
+				      struct dma_fence_chain *prev_chain)
+{
+	u32 span = READ_ONCE(prev_chain->skip_span);
+	struct dma_fence *jump, *jump2 = NULL;
+	struct dma_fence_chain *jump_chain;
+
+	jump = dma_fence_chain_get_skip(prev_chain) ?:
+	       dma_fence_chain_get_prev(prev_chain);
+	jump_chain = to_dma_fence_chain(jump);
+	if (jump_chain && jump->context == prev_chain->base.context &&
+	    READ_ONCE(jump_chain->skip_span) == span) {
+		jump2 = dma_fence_chain_get_skip(jump_chain) ?:
+			dma_fence_chain_get_prev(jump_chain);
+		if (jump2 && jump2->context == prev_chain->base.context) {
+			RCU_INIT_POINTER(chain->skip, jump2);
+			chain->skip_span = 1 + span + jump_chain->skip_span;
+			jump2 = NULL;
+		}
+	}
+	dma_fence_put(jump2);
+	dma_fence_put(jump);
+}
+
 /**
  * dma_fence_chain_init - initialize a fence chain
  * @chain: the chain node to initialize
@@ -250,11 +369,14 @@ void dma_fence_chain_init(struct dma_fence_chain *chain,
 	rcu_assign_pointer(chain->prev, prev);
 	chain->fence = fence;
 	chain->prev_seqno = 0;
+	RCU_INIT_POINTER(chain->skip, NULL);
+	chain->skip_span = 1;
 
 	/* Try to reuse the context of the previous chain node. */
 	if (prev_chain && __dma_fence_is_later(seqno, prev->seqno, prev->ops)) {
 		context = prev->context;
 		chain->prev_seqno = prev->seqno;
+		dma_fence_chain_init_skip(chain, prev_chain);
 	} else {
 		context = dma_fence_context_alloc(1);
 		/* Make sure that we always have a valid sequence number. */
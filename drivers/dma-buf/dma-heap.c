@@ -21,6 +21,7 @@
 #include <linux/syscalls.h>
 #include <linux/dma-heap.h>
 #include <uapi/linux/dma-heap.h>
+#include <uapi/linux/dma-heap-prefetch.h>
 
 #define DEVNAME "dma_heap"
 
@@ -135,8 +136,29 @@ static long dma_heap_ioctl_allocate(struct file *file, void *data)
 	return 0;
 }
 
+static long dma_heap_ioctl_prefetch(struct file *file, void *data, bool drain)
+{
+	struct dma_heap_prefetch_data *prefetch = data;
+	struct dma_heap *heap = file->private_data;
+	unsigned long len;
+
+	if (prefetch->flags)
+		return -EINVAL;
+
+	len = PAGE_ALIGN(prefetch->len);
+	if (!len || len < prefetch->len)
+		return -EINVAL;
+
+	if (drain)
+		return heap->ops->drain ? heap->ops->drain(heap, len) : -EOPNOTSUPP;
+
+	return heap->ops->prefetch ? heap->ops->prefetch(heap, len) : -EOPNOTSUPP;
+}
+
 static unsigned int dma_heap_ioctl_cmds[] = {
 	DMA_HEAP_IOCTL_ALLOC,
+	DMA_HEAP_IOCTL_PREFETCH,
+	DMA_HEAP_IOCTL_DRAIN,
 };
 
 static long dma_heap_ioctl(struct file *file, unsigned int ucmd,
@@ -186,6 +208,12 @@ static long dma_heap_ioctl(struct file *file, unsigned int ucmd,
 	case DMA_HEAP_IOCTL_ALLOC:
 		ret = dma_heap_ioctl_allocate(file, kdata);
 		break;
+	case DMA_HEAP_IOCTL_PREFETCH:
+		ret = dma_heap_ioctl_prefetch(file, kdata, false);
+		break;
+	case DMA_HEAP_IOCTL_DRAIN:
+		ret = dma_heap_ioctl_prefetch(file, kdata, true);
+		break;
 	default:
 		ret = -ENOTTY;
 		goto err;
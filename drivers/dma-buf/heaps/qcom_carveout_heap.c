@@ -10,9 +10,9 @@
  * Copyright (c) 2022-2024 Qualcomm Innovation Center, Inc. All rights reserved.
  */
 
+#include <linux/debugfs.h>
 #include <linux/dma-mapping.h>
 #include <linux/err.h>
-#include <linux/genalloc.h>
 #include <linux/io.h>
 #include <linux/mm.h>
 #include <linux/scatterlist.h>
@@ -29,6 +29,7 @@
 #include "qcom_dma_heap_secure_utils.h"
 #include "qcom_sg_ops.h"
 #include "qcom_carveout_heap.h"
+#include "qcom_carveout_pool.h"
 
 #define CARVEOUT_ALLOCATE_FAIL -1
 
@@ -46,7 +47,7 @@
 struct carveout_heap {
 	struct dma_heap *heap;
 	struct rw_semaphore mem_sem;
-	struct gen_pool *pool;
+	struct carveout_pool *pool;
 	struct device *dev;
 	bool is_secure;
 	phys_addr_t base;
@@ -82,7 +83,7 @@ static phys_addr_t carveout_allocate(struct carveout_heap *carveout_heap,
 
 	down_read(&carveout_heap->mem_sem);
 	if (carveout_heap->pool) {
-		offset = gen_pool_alloc(carveout_heap->pool, size);
+		offset = carveout_pool_alloc(carveout_heap->pool, size);
 		if (!offset) {
 			offset = CARVEOUT_ALLOCATE_FAIL;
 			goto unlock;
@@ -102,7 +103,7 @@ static void carveout_free(struct carveout_heap *carveout_heap,
 
 	down_read(&carveout_heap->mem_sem);
 	if (carveout_heap->pool)
-		gen_pool_free(carveout_heap->pool, addr, size);
+		carveout_pool_free(carveout_heap->pool, addr, size);
 	up_read(&carveout_heap->mem_sem);
 }
 
@@ -155,6 +156,8 @@ static struct dma_buf *__carveout_heap_allocate(struct carveout_heap *carveout_h
 
 	/* Initialize the buffer */
 	INIT_LIST_HEAD(&buffer->attachments);
+	INIT_LIST_HEAD(&buffer->map_cache);
+	INIT_LIST_HEAD(&buffer->mapped_node);
 	mutex_init(&buffer->lock);
 	buffer->heap = carveout_heap->heap;
 	buffer->len = len;
@@ -248,24 +251,41 @@ static int carveout_pages_zero(struct page *page, size_t size)
 	return 0;
 }
 
-static int carveout_init_heap_memory(struct carveout_heap *co_heap,
-				     phys_addr_t base, ssize_t size)
+static int carveout_add_heap_memory(struct carveout_heap *co_heap,
+				    phys_addr_t base, ssize_t size)
 {
 	struct page *page = pfn_to_page(PFN_DOWN(base));
-	int ret = 0;
+	int ret;
 
 	ret = carveout_pages_zero(page, size);
 	if (ret)
 		return ret;
 
-	co_heap->pool = gen_pool_create(PAGE_SHIFT, -1);
+	return carveout_pool_add(co_heap->pool, base, size);
+}
+
+static int carveout_init_heap_memory(struct carveout_heap *co_heap,
+				     struct platform_heap *heap_data)
+{
+	int i, ret;
+
+	co_heap->pool = carveout_pool_create();
 	if (!co_heap->pool)
 		return -ENOMEM;
 
-	co_heap->base = base;
-	gen_pool_add(co_heap->pool, co_heap->base, size, -1);
+	co_heap->base = heap_data->base;
+	ret = carveout_add_heap_memory(co_heap, heap_data->base,
+				       heap_data->size);
+	for (i = 0; !ret && i < heap_data->nr_ranges; i++)
+		ret = carveout_add_heap_memory(co_heap,
+					       heap_data->ranges[i].base,
+					       heap_data->ranges[i].size);
+	if (ret) {
+		carveout_pool_destroy(co_heap->pool);
+		co_heap->pool = NULL;
+	}
 
-	return 0;
+	return ret;
 }
 
 static int __carveout_heap_init(struct platform_heap *heap_data,
@@ -275,15 +295,54 @@ static int __carveout_heap_init(struct platform_heap *heap_data,
 	int ret = 0;
 
 	carveout_heap->dev = dev;
-	ret = carveout_init_heap_memory(carveout_heap,
-					heap_data->base,
-					heap_data->size);
+	ret = carveout_init_heap_memory(carveout_heap, heap_data);
 
 	init_rwsem(&carveout_heap->mem_sem);
 
 	return ret;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int carveout_heap_stats_show(struct seq_file *s, void *unused)
+{
+	struct carveout_heap *carveout_heap = s->private;
+	struct carveout_pool_stats stats;
+
+	down_read(&carveout_heap->mem_sem);
+	if (!carveout_heap->pool) {
+		up_read(&carveout_heap->mem_sem);
+		return 0;
+	}
+	carveout_pool_get_stats(carveout_heap->pool, &stats);
+	up_read(&carveout_heap->mem_sem);
+
+	seq_printf(s, "total: %zu\n", stats.total);
+	seq_printf(s, "free: %zu\n", stats.free);
+	seq_printf(s, "largest_free: %zu\n", stats.largest);
+	seq_printf(s, "free_extents: %lu\n", stats.nr_extents);
+	seq_printf(s, "fragmentation: %u.%u%%\n", stats.fragmentation / 10,
+		   stats.fragmentation % 10);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(carveout_heap_stats);
+
+static void carveout_heap_debugfs_add(struct carveout_heap *carveout_heap)
+{
+	static struct dentry *root;
+
+	if (!root)
+		root = debugfs_create_dir("qcom_carveout_heap", NULL);
+
+	debugfs_create_file(dma_heap_get_name(carveout_heap->heap), 0400, root,
+			    carveout_heap, &carveout_heap_stats_fops);
+}
+#else
+static inline void carveout_heap_debugfs_add(struct carveout_heap *carveout_heap)
+{
+}
+#endif
+
 static const struct dma_heap_ops carveout_heap_ops = {
 	.allocate = carveout_heap_allocate,
 };
@@ -320,6 +379,7 @@ int qcom_carveout_heap_create(struct platform_heap *heap_data)
 		ret = PTR_ERR(carveout_heap->heap);
 		goto destroy_heap;
 	}
+	carveout_heap_debugfs_add(carveout_heap);
 
 	return 0;
 
@@ -334,8 +394,8 @@ int qcom_carveout_heap_create(struct platform_heap *heap_data)
 static void carveout_heap_destroy(struct carveout_heap *carveout_heap)
 {
 	down_write(&carveout_heap->mem_sem);
-	if (carveout_heap->pool)
-		gen_pool_destroy(carveout_heap->pool);
+	carveout_pool_destroy(carveout_heap->pool);
+	carveout_heap->pool = NULL;
 	up_write(&carveout_heap->mem_sem);
 	carveout_heap = NULL;
 }
@@ -376,7 +436,7 @@ int qcom_secure_carveout_heap_create(struct platform_heap *heap_data)
 {
 	struct dma_heap_export_info exp_info;
 	struct secure_carveout_heap *sc_heap;
-	int ret;
+	int i, ret;
 
 	if (!heap_data->is_nomap) {
 		pr_err("secure carveout heap memory regions need to be created with no-map\n");
@@ -393,6 +453,10 @@ int qcom_secure_carveout_heap_create(struct platform_heap *heap_data)
 
 	ret = hyp_assign_from_flags(heap_data->base, heap_data->size,
 				    heap_data->token);
+	for (i = 0; !ret && i < heap_data->nr_ranges; i++)
+		ret = hyp_assign_from_flags(heap_data->ranges[i].base,
+					    heap_data->ranges[i].size,
+					    heap_data->token);
 	if (ret) {
 		pr_err("secure_carveout_heap: Assign token 0x%x failed\n",
 		       heap_data->token);
@@ -411,6 +475,7 @@ int qcom_secure_carveout_heap_create(struct platform_heap *heap_data)
 		ret = PTR_ERR(sc_heap->carveout_heap.heap);
 		goto destroy_heap;
 	}
+	carveout_heap_debugfs_add(&sc_heap->carveout_heap);
 
 	return 0;
 
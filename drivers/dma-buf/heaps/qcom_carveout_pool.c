@@ -0,0 +1,286 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Best-fit extent allocator for the carveout heaps.
+ *
+ * Copyright (c) 2022-2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+
+#include <linux/err.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+
+#include "qcom_carveout_pool.h"
+
+struct carveout_extent {
+	struct rb_node addr_node;
+	struct rb_node size_node;
+	phys_addr_t base;
+	size_t size;
+	unsigned int range;
+};
+
+static inline struct carveout_extent *addr_to_extent(struct rb_node *node)
+{
+	return rb_entry(node, struct carveout_extent, addr_node);
+}
+
+static inline struct carveout_extent *size_to_extent(struct rb_node *node)
+{
+	return rb_entry(node, struct carveout_extent, size_node);
+}
+
+static bool extent_addr_less(struct rb_node *a, const struct rb_node *b)
+{
+	return addr_to_extent(a)->base <
+	       rb_entry(b, struct carveout_extent, addr_node)->base;
+}
+
+static bool extent_size_less(struct rb_node *a, const struct rb_node *b)
+{
+	struct carveout_extent *ea = size_to_extent(a);
+	const struct carveout_extent *eb = rb_entry(b, struct carveout_extent,
+						    size_node);
+
+	if (ea->size != eb->size)
+		return ea->size < eb->size;
+	return ea->base < eb->base;
+}
+
+static int carveout_pool_find_range(struct carveout_pool *pool,
+				    phys_addr_t addr, size_t size)
+{
+	unsigned int i;
+
+	for (i = 0; i < pool->nr_ranges; i++) {
+		if (addr >= pool->ranges[i].base &&
+		    addr + size <= pool->ranges[i].base + pool->ranges[i].size)
+			return i;
+	}
+
+	return -EINVAL;
+}
+
+struct carveout_pool *carveout_pool_create(void)
+{
+	struct carveout_pool *pool;
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return NULL;
+
+	mutex_init(&pool->lock);
+	pool->addr_root = RB_ROOT;
+	pool->size_root = RB_ROOT;
+
+	return pool;
+}
+
+void carveout_pool_destroy(struct carveout_pool *pool)
+{
+	struct carveout_extent *extent, *tmp;
+
+	if (!pool)
+		return;
+
+	WARN(pool->free != pool->total,
+	     "carveout pool destroyed with %zu bytes still allocated\n",
+	     pool->total - pool->free);
+
+	rbtree_postorder_for_each_entry_safe(extent, tmp, &pool->addr_root,
+					     addr_node)
+		kfree(extent);
+	mutex_destroy(&pool->lock);
+	kfree(pool);
+}
+
+int carveout_pool_add(struct carveout_pool *pool, phys_addr_t base, size_t size)
+{
+	struct carveout_extent *extent;
+	unsigned int i;
+	int ret = 0;
+
+	if (!size || !PAGE_ALIGNED(base) || !PAGE_ALIGNED(size))
+		return -EINVAL;
+
+	extent = kzalloc(sizeof(*extent), GFP_KERNEL);
+	if (!extent)
+		return -ENOMEM;
+
+	mutex_lock(&pool->lock);
+	if (pool->nr_ranges == CARVEOUT_POOL_MAX_RANGES) {
+		ret = -ENOSPC;
+		goto err;
+	}
+
+	for (i = 0; i < pool->nr_ranges; i++) {
+		if (base < pool->ranges[i].base + pool->ranges[i].size &&
+		    pool->ranges[i].base < base + size) {
+			ret = -EINVAL;
+			goto err;
+		}
+	}
+
+	pool->ranges[pool->nr_ranges].base = base;
+	pool->ranges[pool->nr_ranges].size = size;
+
+	extent->base = base;
+	extent->size = size;
+	extent->range = pool->nr_ranges++;
+	rb_add(&extent->addr_node, &pool->addr_root, extent_addr_less);
+	rb_add(&extent->size_node, &pool->size_root, extent_size_less);
+
+	pool->total += size;
+	pool->free += size;
+	pool->nr_extents++;
+	mutex_unlock(&pool->lock);
+
+	return 0;
+
+err:
+	mutex_unlock(&pool->lock);
+	kfree(extent);
+	return ret;
+}
+
+/*
+ * Returns the physical address of a free region of @size bytes, taken from
+ * the smallest free extent that fits it, or 0 on failure.
+ */
+phys_addr_t carveout_pool_alloc(struct carveout_pool *pool, size_t size)
+{
+	struct carveout_extent *extent, *best = NULL;
+	struct rb_node *node;
+	phys_addr_t addr;
+
+	size = PAGE_ALIGN(size);
+	if (!size)
+		return 0;
+
+	mutex_lock(&pool->lock);
+	node = pool->size_root.rb_node;
+	while (node) {
+		extent = size_to_extent(node);
+		if (extent->size >= size) {
+			best = extent;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+
+	if (!best) {
+		mutex_unlock(&pool->lock);
+		return 0;
+	}
+
+	addr = best->base;
+	rb_erase(&best->size_node, &pool->size_root);
+	if (best->size == size) {
+		rb_erase(&best->addr_node, &pool->addr_root);
+		pool->nr_extents--;
+		kfree(best);
+	} else {
+		/* The remainder keeps its place in the address tree */
+		best->base += size;
+		best->size -= size;
+		rb_add(&best->size_node, &pool->size_root, extent_size_less);
+	}
+	pool->free -= size;
+	mutex_unlock(&pool->lock);
+
+	return addr;
+}
+
+void carveout_pool_free(struct carveout_pool *pool, phys_addr_t addr, size_t size)
+{
+	struct carveout_extent *extent, *prev = NULL, *next = NULL;
+	struct rb_node *node;
+	bool merge_prev, merge_next;
+	int range;
+
+	size = PAGE_ALIGN(size);
+	if (!size)
+		return;
+
+	/* Freeing must not fail, so set aside an extent before locking */
+	extent = kzalloc(sizeof(*extent), GFP_KERNEL | __GFP_NOFAIL);
+
+	mutex_lock(&pool->lock);
+	range = carveout_pool_find_range(pool, addr, size);
+	if (WARN(range < 0, "%pa is not in the carveout pool\n", &addr))
+		goto out;
+
+	node = pool->addr_root.rb_node;
+	while (node) {
+		struct carveout_extent *cur = addr_to_extent(node);
+
+		if (addr < cur->base) {
+			next = cur;
+			node = node->rb_left;
+		} else {
+			prev = cur;
+			node = node->rb_right;
+		}
+	}
+
+	if (WARN((prev && prev->base + prev->size > addr) ||
+		 (next && addr + size > next->base),
+		 "%pa is already free in the carveout pool\n", &addr))
+		goto out;
+
+	merge_prev = prev && prev->range == range &&
+		     prev->base + prev->size == addr;
+	merge_next = next && next->range == range &&
+		     addr + size == next->base;
+
+	if (merge_prev) {
+		rb_erase(&prev->size_node, &pool->size_root);
+		prev->size += size;
+		if (merge_next) {
+			rb_erase(&next->size_node, &pool->size_root);
+			rb_erase(&next->addr_node, &pool->addr_root);
+			prev->size += next->size;
+			pool->nr_extents--;
+			kfree(next);
+		}
+		rb_add(&prev->size_node, &pool->size_root, extent_size_less);
+	} else if (merge_next) {
+		rb_erase(&next->size_node, &pool->size_root);
+		next->base = addr;
+		next->size += size;
+		rb_add(&next->size_node, &pool->size_root, extent_size_less);
+	} else {
+		extent->base = addr;
+		extent->size = size;
+		extent->range = range;
+		rb_add(&extent->addr_node, &pool->addr_root, extent_addr_less);
+		rb_add(&extent->size_node, &pool->size_root, extent_size_less);
+		pool->nr_extents++;
+		extent = NULL;
+	}
+	pool->free += size;
+
+out:
+	mutex_unlock(&pool->lock);
+	kfree(extent);
+}
+
+void carveout_pool_get_stats(struct carveout_pool *pool,
+			     struct carveout_pool_stats *stats)
+{
+	struct rb_node *node;
+
+	mutex_lock(&pool->lock);
+	node = rb_last(&pool->size_root);
+	stats->total = pool->total;
+	stats->free = pool->free;
+	stats->largest = node ? size_to_extent(node)->size : 0;
+	stats->nr_extents = pool->nr_extents;
+	mutex_unlock(&pool->lock);
+
+	stats->fragmentation = 0;
+	if (stats->free)
+		stats->fragmentation = div64_u64((u64)(stats->free - stats->largest) * 1000,
+						 stats->free);
+}
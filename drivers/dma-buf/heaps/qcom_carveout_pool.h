@@ -0,0 +1,72 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Copyright (c) 2022-2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+
+#ifndef _QCOM_CARVEOUT_POOL_H
+#define _QCOM_CARVEOUT_POOL_H
+
+#include <linux/mutex.h>
+#include <linux/rbtree.h>
+#include <linux/types.h>
+
+#define CARVEOUT_POOL_MAX_RANGES	8
+
+/**
+ * struct carveout_pool - best-fit allocator for carveout memory
+ * @lock:		protects every other field
+ * @addr_root:		free extents ordered by base address, for coalescing
+ * @size_root:		free extents ordered by size then base address, for
+ *			best-fit lookups
+ * @ranges:		physical ranges added with carveout_pool_add()
+ * @nr_ranges:		number of entries in @ranges
+ * @total:		bytes in all ranges
+ * @free:		free bytes in all ranges
+ * @nr_extents:		number of free extents
+ *
+ * The carveout memory itself is never touched, so that the pool can manage
+ * regions that are no-map or assigned away from HLOS; all metadata is kept
+ * in kernel memory. Allocation and free are O(log n) in the number of free
+ * extents, and freed extents are merged with their free neighbours within
+ * the same range.
+ */
+struct carveout_pool {
+	struct mutex lock;
+	struct rb_root addr_root;
+	struct rb_root size_root;
+	struct {
+		phys_addr_t base;
+		size_t size;
+	} ranges[CARVEOUT_POOL_MAX_RANGES];
+	unsigned int nr_ranges;
+	size_t total;
+	size_t free;
+	unsigned long nr_extents;
+};
+
+/**
+ * struct carveout_pool_stats - snapshot of a carveout pool
+ * @total:		bytes managed by the pool
+ * @free:		free bytes
+ * @largest:		size of the largest free extent
+ * @nr_extents:		number of free extents
+ * @fragmentation:	share of the free memory, in permille, that lies
+ *			outside the largest free extent
+ */
+struct carveout_pool_stats {
+	size_t total;
+	size_t free;
+	size_t largest;
+	unsigned long nr_extents;
+	unsigned int fragmentation;
+};
+
+struct carveout_pool *carveout_pool_create(void);
+void carveout_pool_destroy(struct carveout_pool *pool);
+int carveout_pool_add(struct carveout_pool *pool, phys_addr_t base, size_t size);
+phys_addr_t carveout_pool_alloc(struct carveout_pool *pool, size_t size);
+void carveout_pool_free(struct carveout_pool *pool, phys_addr_t addr, size_t size);
+void carveout_pool_get_stats(struct carveout_pool *pool,
+			     struct carveout_pool_stats *stats);
+
+#endif /* _QCOM_CARVEOUT_POOL_H */
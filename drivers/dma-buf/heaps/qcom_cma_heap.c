@@ -11,6 +11,7 @@
  */
 
 #include <linux/cma.h>
+#include <linux/debugfs.h>
 #include <linux/device.h>
 #include <linux/dma-buf.h>
 #include <linux/dma-heap.h>
@@ -23,17 +24,31 @@
 #include <linux/scatterlist.h>
 #include <linux/sched/signal.h>
 #include <linux/list.h>
+#include <linux/of.h>
+#include <linux/qcom_dma_heap.h>
 
 #include "qcom_cma_heap.h"
 #include "qcom_sg_ops.h"
 
+/*
+ * @dev:		device of the heap's DT node, whose
+ *			"qcom,skip-zero-consumers" property lists the devices
+ *			allowed to receive unzeroed buffers
+ * @skip_zero_bytes:	bytes handed out without being zeroed
+ */
 struct cma_heap {
 	struct cma *cma;
 	/* max_align is in units of page_order, similar to CONFIG_CMA_ALIGNMENT */
 	u32 max_align;
 	bool uncached;
+	struct dma_heap *heap;
+	struct device *dev;
+	struct list_head list;
+	atomic64_t skip_zero_bytes;
 };
 
+static LIST_HEAD(cma_heaps);
+
 static void cma_heap_free(struct qcom_sg_buffer *buffer)
 {
 	struct cma_heap *cma_heap;
@@ -49,11 +64,10 @@ static void cma_heap_free(struct qcom_sg_buffer *buffer)
 	kfree(buffer);
 }
 
-/* dmabuf heap CMA operations functions */
-struct dma_buf *cma_heap_allocate(struct dma_heap *heap,
-				  unsigned long len,
-				  unsigned long fd_flags,
-				  unsigned long heap_flags)
+static struct dma_buf *__cma_heap_allocate(struct dma_heap *heap,
+					   unsigned long len,
+					   unsigned long fd_flags,
+					   struct device *consumer)
 {
 	struct cma_heap *cma_heap;
 	struct qcom_sg_buffer *helper_buffer;
@@ -76,6 +90,8 @@ struct dma_buf *cma_heap_allocate(struct dma_heap *heap,
 
 	helper_buffer->heap = heap;
 	INIT_LIST_HEAD(&helper_buffer->attachments);
+	INIT_LIST_HEAD(&helper_buffer->map_cache);
+	INIT_LIST_HEAD(&helper_buffer->mapped_node);
 	mutex_init(&helper_buffer->lock);
 	helper_buffer->len = size;
 	helper_buffer->uncached = cma_heap->uncached;
@@ -85,7 +101,11 @@ struct dma_buf *cma_heap_allocate(struct dma_heap *heap,
 	if (!cma_pages)
 		goto free_buf;
 
-	if (PageHighMem(cma_pages)) {
+	if (consumer) {
+		/* Cleared in qcom_sg_ops if anyone else gets to see it first */
+		helper_buffer->unwritten_for = get_device(consumer);
+		atomic64_add(size, &cma_heap->skip_zero_bytes);
+	} else if (PageHighMem(cma_pages)) {
 		unsigned long nr_clear_pages = nr_pages;
 		struct page *page = cma_pages;
 
@@ -144,11 +164,112 @@ struct dma_buf *cma_heap_allocate(struct dma_heap *heap,
 	sg_free_table(&helper_buffer->sg_table);
 free_cma:
 	cma_release(cma_heap->cma, cma_pages, nr_pages);
+	if (helper_buffer->unwritten_for) {
+		atomic64_sub(size, &cma_heap->skip_zero_bytes);
+		put_device(helper_buffer->unwritten_for);
+	}
 free_buf:
 	kfree(helper_buffer);
 	return ERR_PTR(ret);
 }
 
+/* dmabuf heap CMA operations functions */
+struct dma_buf *cma_heap_allocate(struct dma_heap *heap,
+				  unsigned long len,
+				  unsigned long fd_flags,
+				  unsigned long heap_flags)
+{
+	return __cma_heap_allocate(heap, len, fd_flags, NULL);
+}
+
+static bool cma_heap_skip_zero_allowed(struct cma_heap *cma_heap,
+				       struct device *consumer)
+{
+	struct device_node *node;
+	bool found = false;
+	int i = 0;
+
+	if (!consumer->of_node)
+		return false;
+
+	while (!found) {
+		node = of_parse_phandle(cma_heap->dev->of_node,
+					"qcom,skip-zero-consumers", i++);
+		if (!node)
+			break;
+		found = node == consumer->of_node;
+		of_node_put(node);
+	}
+
+	return found;
+}
+
+/**
+ * qcom_cma_heap_alloc_unzeroed() - allocate a CMA heap buffer without zeroing
+ * @heap:	a qcom CMA heap
+ * @len:	size of the buffer in bytes
+ * @fd_flags:	flags for the dma-buf file
+ * @consumer:	device that fully overwrites the buffer by DMA
+ *
+ * For buffers that a hardware producer always overwrites, clearing them at
+ * allocation only costs DDR bandwidth. @consumer must be listed in the
+ * heap's "qcom,skip-zero-consumers" DT property. Until the producer calls
+ * qcom_dma_heap_mark_written(), the buffer is zeroed before it can be
+ * mmapped, vmapped, or mapped by any other device.
+ *
+ * Return: the buffer, or an ERR_PTR on failure. -EPERM if @consumer is not
+ * allowed to skip zeroing on @heap.
+ */
+struct dma_buf *qcom_cma_heap_alloc_unzeroed(struct dma_heap *heap, size_t len,
+					     u32 fd_flags, struct device *consumer)
+{
+	struct cma_heap *cma_heap;
+
+	if (!consumer)
+		return ERR_PTR(-EINVAL);
+
+	list_for_each_entry(cma_heap, &cma_heaps, list) {
+		if (cma_heap->heap != heap)
+			continue;
+
+		if (!cma_heap_skip_zero_allowed(cma_heap, consumer))
+			return ERR_PTR(-EPERM);
+
+		return __cma_heap_allocate(heap, len, fd_flags, consumer);
+	}
+
+	return ERR_PTR(-EINVAL);
+}
+EXPORT_SYMBOL_GPL(qcom_cma_heap_alloc_unzeroed);
+
+#ifdef CONFIG_DEBUG_FS
+static int cma_heap_stats_show(struct seq_file *s, void *unused)
+{
+	struct cma_heap *cma_heap = s->private;
+
+	seq_printf(s, "skip_zero_bytes: %lld\n",
+		   atomic64_read(&cma_heap->skip_zero_bytes));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(cma_heap_stats);
+
+static void cma_heap_debugfs_add(struct cma_heap *cma_heap)
+{
+	static struct dentry *root;
+
+	if (!root)
+		root = debugfs_create_dir("qcom_cma_heap", NULL);
+
+	debugfs_create_file(dma_heap_get_name(cma_heap->heap), 0400, root,
+			    cma_heap, &cma_heap_stats_fops);
+}
+#else
+static inline void cma_heap_debugfs_add(struct cma_heap *cma_heap)
+{
+}
+#endif
+
 static const struct dma_heap_ops cma_heap_ops = {
 	.allocate = cma_heap_allocate,
 };
@@ -173,6 +294,8 @@ static int __add_cma_heap(struct platform_heap *heap_data, void *data)
 	if (heap_data->max_align)
 		cma_heap->max_align = heap_data->max_align;
 	cma_heap->uncached = heap_data->is_uncached;
+	cma_heap->dev = heap_data->dev;
+	atomic64_set(&cma_heap->skip_zero_bytes, 0);
 
 	exp_info.name = heap_data->name;
 	exp_info.ops = &cma_heap_ops;
@@ -185,6 +308,9 @@ static int __add_cma_heap(struct platform_heap *heap_data, void *data)
 		kfree(cma_heap);
 		return ret;
 	}
+	cma_heap->heap = heap;
+	list_add(&cma_heap->list, &cma_heaps);
+	cma_heap_debugfs_add(cma_heap);
 
 	if (cma_heap->uncached)
 		dma_coerce_mask_and_coherent(dma_heap_get_dev(heap),
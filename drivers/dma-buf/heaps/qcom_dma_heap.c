@@ -16,6 +16,7 @@
 #include "qcom_carveout_heap.h"
 #include "qcom_secure_system_heap.h"
 #include "qcom_dma_heap_priv.h"
+#include "qcom_sg_ops.h"
 
 /*
  * We cache the file ops used by DMA-BUFs so that a user with a struct file
@@ -53,7 +54,10 @@ static int qcom_dma_heap_probe(struct platform_device *pdev)
 			break;
 #endif
 		case HEAP_TYPE_CMA:
-			ret = qcom_add_cma_heap(heap_data);
+			if (heap_data->is_contig_backing)
+				ret = qcom_system_heap_create_contig(heap_data);
+			else
+				ret = qcom_add_cma_heap(heap_data);
 			break;
 		default:
 			pr_err("%s: Unknown heap type %u\n", __func__, heap_data->type);
@@ -103,6 +107,12 @@ static struct platform_driver qcom_dma_heap_driver = {
 
 static int __init init_heap_driver(void)
 {
+	int ret;
+
+	ret = qcom_sg_init_shrinker();
+	if (ret)
+		return ret;
+
 	return platform_driver_register(&qcom_dma_heap_driver);
 }
 module_init(init_heap_driver);
@@ -39,6 +39,7 @@ static int populate_heap(struct device_node *node,
 
 	/* Optional properties */
 	heap->is_uncached = of_property_read_bool(node, "qcom,uncached-heap");
+	heap->is_contig_backing = of_property_read_bool(node, "qcom,system-contig-backing");
 
 	ret = of_property_read_u32(node, "qcom,token", &heap->token);
 	if (ret && ret != -EINVAL)
@@ -59,6 +60,10 @@ static int populate_heap(struct device_node *node,
 
 void free_pdata(const struct platform_data *pdata)
 {
+	int i;
+
+	for (i = 0; i < pdata->nr && pdata->heaps; i++)
+		kfree(pdata->heaps[i].ranges);
 	kfree(pdata->heaps);
 	kfree(pdata);
 }
@@ -115,6 +120,57 @@ static int heap_dt_init(struct device_node *mem_node,
 	return ret;
 }
 
+/*
+ * Carveout heaps may list several no-map regions in memory-region. The
+ * first one is described by heap->base and heap->size, the others are
+ * collected in heap->ranges.
+ */
+static int heap_dt_init_ranges(struct device_node *node,
+			       struct platform_heap *heap)
+{
+	struct device_node *mem_node;
+	struct reserved_mem *rmem;
+	int i, count, ret = 0;
+
+	count = of_count_phandle_with_args(node, "memory-region", NULL);
+	if (count <= 1)
+		return 0;
+
+	heap->ranges = kcalloc(count - 1, sizeof(*heap->ranges), GFP_KERNEL);
+	if (!heap->ranges)
+		return -ENOMEM;
+
+	for (i = 1; i < count; i++) {
+		mem_node = of_parse_phandle(node, "memory-region", i);
+		if (!mem_node) {
+			ret = -EINVAL;
+			break;
+		}
+
+		rmem = of_reserved_mem_lookup(mem_node);
+		if (!rmem || !of_property_read_bool(mem_node, "no-map")) {
+			dev_err(heap->dev, "memory-region %d must be a no-map reserved region\n",
+				i);
+			of_node_put(mem_node);
+			ret = -EINVAL;
+			break;
+		}
+		of_node_put(mem_node);
+
+		heap->ranges[heap->nr_ranges].base = rmem->base;
+		heap->ranges[heap->nr_ranges].size = rmem->size;
+		heap->nr_ranges++;
+	}
+
+	if (ret) {
+		kfree(heap->ranges);
+		heap->ranges = NULL;
+		heap->nr_ranges = 0;
+	}
+
+	return ret;
+}
+
 static void release_reserved_memory_regions(struct platform_heap *heaps,
 					    int idx)
 {
@@ -186,6 +242,10 @@ struct platform_data *parse_heap_dt(struct platform_device *pdev)
 				goto free_heaps;
 
 			of_node_put(mem_node);
+
+			ret = heap_dt_init_ranges(node, &pdata->heaps[idx]);
+			if (ret)
+				goto free_heaps;
 		}
 
 		++idx;
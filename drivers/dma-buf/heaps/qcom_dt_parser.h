@@ -10,6 +10,16 @@
 #include <linux/device.h>
 #include <linux/platform_device.h>
 
+/**
+ * struct platform_heap_range - an additional memory region of a heap
+ * @base:	base address of the region in physical memory
+ * @size:	size of the region in bytes
+ */
+struct platform_heap_range {
+	phys_addr_t base;
+	size_t size;
+};
+
 /**
  * struct platform_heap - defines a heap in the given platform
  * @type:	type of the heap
@@ -24,6 +34,11 @@
  * @token:	the end points to which memory for secure carveout memory is
  *		assigned to
  * @max_align:  page order of the maximum alignment. Used by cma heap.
+ * @is_contig_backing: indicates that a CMA region backs a system heap with
+ *		physically contiguous runs instead of being a heap of its own
+ * @ranges:	memory regions listed after the first one in memory-region.
+ *		Used by carveout heaps.
+ * @nr_ranges:	number of entries in @ranges
  *
  * Provided by the board file.
  */
@@ -37,6 +52,9 @@ struct platform_heap {
 	bool is_nomap;
 	u32 token;
 	u32 max_align;
+	bool is_contig_backing;
+	struct platform_heap_range *ranges;
+	u32 nr_ranges;
 };
 
 /**
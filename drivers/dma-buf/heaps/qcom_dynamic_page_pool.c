@@ -15,7 +15,10 @@
  * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
  */
 
+#include <linux/debugfs.h>
 #include <linux/list.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/swap.h>
 #include <linux/spinlock.h>
@@ -27,11 +30,8 @@
 static LIST_HEAD(pool_list);
 static DEFINE_MUTEX(pool_list_lock);
 
-void dynamic_page_pool_add(struct dynamic_page_pool *pool, struct page *page)
+static void __dynamic_page_pool_add(struct dynamic_page_pool *pool, struct page *page)
 {
-	unsigned long flags;
-
-	spin_lock_irqsave(&pool->lock, flags);
 	if (PageHighMem(page)) {
 		list_add_tail(&page->lru, &pool->high_items);
 		pool->high_count++;
@@ -39,14 +39,9 @@ void dynamic_page_pool_add(struct dynamic_page_pool *pool, struct page *page)
 		list_add_tail(&page->lru, &pool->low_items);
 		pool->low_count++;
 	}
-
-	atomic_inc(&pool->count);
-	mod_node_page_state(page_pgdat(page), NR_KERNEL_MISC_RECLAIMABLE,
-			    1 << pool->order);
-	spin_unlock_irqrestore(&pool->lock, flags);
 }
 
-struct page *dynamic_page_pool_remove(struct dynamic_page_pool *pool, bool high)
+static struct page *__dynamic_page_pool_remove(struct dynamic_page_pool *pool, bool high)
 {
 	struct page *page;
 
@@ -60,23 +55,317 @@ struct page *dynamic_page_pool_remove(struct dynamic_page_pool *pool, bool high)
 		pool->low_count--;
 	}
 
-	atomic_dec(&pool->count);
 	list_del(&page->lru);
+	return page;
+}
+
+void dynamic_page_pool_add(struct dynamic_page_pool *pool, struct page *page)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	__dynamic_page_pool_add(pool, page);
+	atomic_inc(&pool->count);
+	mod_node_page_state(page_pgdat(page), NR_KERNEL_MISC_RECLAIMABLE,
+			    1 << pool->order);
+	spin_unlock_irqrestore(&pool->lock, flags);
+}
+
+struct page *dynamic_page_pool_remove(struct dynamic_page_pool *pool, bool high)
+{
+	struct page *page = __dynamic_page_pool_remove(pool, high);
+
+	atomic_dec(&pool->count);
 	mod_node_page_state(page_pgdat(page), NR_KERNEL_MISC_RECLAIMABLE,
 			    -(1 << pool->order));
 	return page;
 }
 
+/**
+ * dynamic_page_pool_add_dirty() - park a freed item until it has been zeroed
+ * @pool: the pool the item belongs to
+ * @page: the item, still holding its previous contents
+ *
+ * Dirty items are reclaimable but are never returned by the allocation
+ * helpers; the owner of the pool zeroes them through
+ * dynamic_page_pool_remove_dirty() and hands them back with
+ * dynamic_page_pool_add().
+ */
+void dynamic_page_pool_add_dirty(struct dynamic_page_pool *pool, struct page *page)
+{
+	unsigned long flags;
+
+	BUG_ON(pool->order != compound_order(page));
+
+	spin_lock_irqsave(&pool->lock, flags);
+	list_add_tail(&page->lru, &pool->dirty_items);
+	pool->dirty_count++;
+	mod_node_page_state(page_pgdat(page), NR_KERNEL_MISC_RECLAIMABLE,
+			    1 << pool->order);
+	spin_unlock_irqrestore(&pool->lock, flags);
+}
+
+struct page *dynamic_page_pool_remove_dirty(struct dynamic_page_pool *pool)
+{
+	struct page *page = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	if (pool->dirty_count) {
+		page = list_first_entry(&pool->dirty_items, struct page, lru);
+		list_del(&page->lru);
+		pool->dirty_count--;
+		mod_node_page_state(page_pgdat(page), NR_KERNEL_MISC_RECLAIMABLE,
+				    -(1 << pool->order));
+	}
+	spin_unlock_irqrestore(&pool->lock, flags);
+
+	return page;
+}
+
+/*
+ * Move up to pool->pcp_batch items from the shared lists into a per-CPU
+ * cache. The items stay accounted in pool->count. Called with pcp->lock held
+ * and interrupts disabled.
+ */
+static void dynamic_page_pool_pcp_refill(struct dynamic_page_pool *pool,
+					 struct dynamic_page_pool_pcp *pcp)
+{
+	struct page *page;
+	int i;
+
+	spin_lock(&pool->lock);
+	for (i = 0; i < pool->pcp_batch; i++) {
+		if (pool->high_count)
+			page = __dynamic_page_pool_remove(pool, true);
+		else if (pool->low_count)
+			page = __dynamic_page_pool_remove(pool, false);
+		else
+			break;
+
+		list_add_tail(&page->lru, &pcp->items);
+		pcp->count++;
+	}
+	spin_unlock(&pool->lock);
+}
+
+/*
+ * Return the nr_items coldest items of a per-CPU cache to the shared lists.
+ * Called with pcp->lock held and interrupts disabled.
+ */
+static void dynamic_page_pool_pcp_flush(struct dynamic_page_pool *pool,
+					struct dynamic_page_pool_pcp *pcp,
+					int nr_items)
+{
+	struct page *page;
+
+	spin_lock(&pool->lock);
+	while (nr_items-- && pcp->count) {
+		page = list_last_entry(&pcp->items, struct page, lru);
+		list_del(&page->lru);
+		pcp->count--;
+		__dynamic_page_pool_add(pool, page);
+	}
+	spin_unlock(&pool->lock);
+}
+
+/**
+ * dynamic_page_pool_drain_pcp() - return every per-CPU cached item of a pool
+ * to its shared lists
+ * @pool: the pool to drain
+ *
+ * After this returns, high_count and low_count account for all items of the
+ * pool, apart from those freed concurrently.
+ */
+void dynamic_page_pool_drain_pcp(struct dynamic_page_pool *pool)
+{
+	struct dynamic_page_pool_pcp *pcp;
+	unsigned long flags;
+	int cpu;
+
+	if (!pool->pcp)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		pcp = per_cpu_ptr(pool->pcp, cpu);
+
+		spin_lock_irqsave(&pcp->lock, flags);
+		if (pcp->count)
+			dynamic_page_pool_pcp_flush(pool, pcp, pcp->count);
+		spin_unlock_irqrestore(&pcp->lock, flags);
+	}
+}
+
+/**
+ * dynamic_page_pool_alloc() - take an item out of the pool
+ * @pool: the pool to allocate from
+ *
+ * The local CPU's front cache is tried first, so the common case does not
+ * touch pool->lock. On a miss, the cache is refilled with a batch of items
+ * from the shared lists.
+ *
+ * Return: a page of order pool->order, or NULL if the pool is empty.
+ */
+struct page *dynamic_page_pool_alloc(struct dynamic_page_pool *pool)
+{
+	struct dynamic_page_pool_pcp *pcp;
+	struct page *page = NULL;
+	unsigned long flags;
+
+	if (!pool->pcp) {
+		spin_lock_irqsave(&pool->lock, flags);
+		if (pool->high_count)
+			page = dynamic_page_pool_remove(pool, true);
+		else if (pool->low_count)
+			page = dynamic_page_pool_remove(pool, false);
+		spin_unlock_irqrestore(&pool->lock, flags);
+
+		return page;
+	}
+
+	local_irq_save(flags);
+	pcp = this_cpu_ptr(pool->pcp);
+	spin_lock(&pcp->lock);
+
+	if (pcp->count) {
+		pcp->hits++;
+	} else {
+		pcp->misses++;
+		dynamic_page_pool_pcp_refill(pool, pcp);
+	}
+
+	if (pcp->count) {
+		page = list_first_entry(&pcp->items, struct page, lru);
+		list_del(&page->lru);
+		pcp->count--;
+
+		atomic_dec(&pool->count);
+		mod_node_page_state(page_pgdat(page), NR_KERNEL_MISC_RECLAIMABLE,
+				    -(1 << pool->order));
+	}
+
+	spin_unlock(&pcp->lock);
+	local_irq_restore(flags);
+
+	return page;
+}
+
+/**
+ * dynamic_page_pool_alloc_bulk() - take several items out of the pool at once
+ * @pool: the pool to allocate from
+ * @nr_items: number of items wanted
+ * @list: list the items are appended to, linked through page->lru
+ *
+ * Drains the local CPU's front cache and then the shared lists, taking
+ * pool->lock at most once regardless of @nr_items.
+ *
+ * Return: the number of items appended to @list, which may be less than
+ * @nr_items if the pool runs dry.
+ */
+int dynamic_page_pool_alloc_bulk(struct dynamic_page_pool *pool, int nr_items,
+				 struct list_head *list)
+{
+	struct dynamic_page_pool_pcp *pcp;
+	struct page *page;
+	unsigned long flags;
+	int nr = 0;
+
+	if (pool->pcp) {
+		local_irq_save(flags);
+		pcp = this_cpu_ptr(pool->pcp);
+		spin_lock(&pcp->lock);
+
+		while (nr < nr_items && pcp->count) {
+			page = list_first_entry(&pcp->items, struct page, lru);
+			list_move_tail(&page->lru, list);
+			pcp->count--;
+			nr++;
+
+			atomic_dec(&pool->count);
+			mod_node_page_state(page_pgdat(page), NR_KERNEL_MISC_RECLAIMABLE,
+					    -(1 << pool->order));
+		}
+
+		if (nr == nr_items)
+			pcp->hits++;
+		else
+			pcp->misses++;
+
+		spin_unlock(&pcp->lock);
+		local_irq_restore(flags);
+	}
+
+	if (nr == nr_items)
+		return nr;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	while (nr < nr_items) {
+		if (pool->high_count)
+			page = dynamic_page_pool_remove(pool, true);
+		else if (pool->low_count)
+			page = dynamic_page_pool_remove(pool, false);
+		else
+			break;
+
+		list_add_tail(&page->lru, list);
+		nr++;
+	}
+	spin_unlock_irqrestore(&pool->lock, flags);
+
+	return nr;
+}
+
 void dynamic_page_pool_free(struct dynamic_page_pool *pool, struct page *page)
 {
+	struct dynamic_page_pool_pcp *pcp;
+	unsigned long flags;
+
 	BUG_ON(pool->order != compound_order(page));
 
-	dynamic_page_pool_add(pool, page);
+	if (!pool->pcp) {
+		dynamic_page_pool_add(pool, page);
+		return;
+	}
+
+	local_irq_save(flags);
+	pcp = this_cpu_ptr(pool->pcp);
+	spin_lock(&pcp->lock);
+
+	list_add(&page->lru, &pcp->items);
+	pcp->count++;
+	atomic_inc(&pool->count);
+	mod_node_page_state(page_pgdat(page), NR_KERNEL_MISC_RECLAIMABLE,
+			    1 << pool->order);
+
+	if (pcp->count > pool->pcp_high)
+		dynamic_page_pool_pcp_flush(pool, pcp, pool->pcp_batch);
+
+	spin_unlock(&pcp->lock);
+	local_irq_restore(flags);
+}
+
+static int dynamic_page_pool_pcp_count(struct dynamic_page_pool *pool)
+{
+	int cpu, count = 0;
+
+	if (!pool->pcp)
+		return 0;
+
+	for_each_possible_cpu(cpu)
+		count += READ_ONCE(per_cpu_ptr(pool->pcp, cpu)->count);
+
+	return count;
 }
 
+/*
+ * Items parked in the per-CPU caches are reported as reclaimable, since the
+ * shrinker drains them back to the shared lists before scanning. Dirty items
+ * are reclaimable too and are the first to go.
+ */
 int dynamic_page_pool_total(struct dynamic_page_pool *pool, bool high)
 {
-	int count = pool->low_count;
+	int count = pool->low_count + pool->dirty_count +
+		    dynamic_page_pool_pcp_count(pool);
 
 	if (high)
 		count += pool->high_count;
@@ -84,6 +373,30 @@ int dynamic_page_pool_total(struct dynamic_page_pool *pool, bool high)
 	return count << pool->order;
 }
 
+static int dynamic_page_pool_pcp_init(struct dynamic_page_pool *pool)
+{
+	struct dynamic_page_pool_pcp *pcp;
+	int cpu;
+
+	pool->pcp = alloc_percpu(struct dynamic_page_pool_pcp);
+	if (!pool->pcp)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		pcp = per_cpu_ptr(pool->pcp, cpu);
+		spin_lock_init(&pcp->lock);
+		INIT_LIST_HEAD(&pcp->items);
+		pcp->count = 0;
+		pcp->hits = 0;
+		pcp->misses = 0;
+	}
+
+	pool->pcp_high = max_t(int, DYNAMIC_POOL_PCP_HIGH_BYTES >> (PAGE_SHIFT + pool->order), 2);
+	pool->pcp_batch = clamp_t(int, pool->pcp_high / 2, 1, DYNAMIC_POOL_PCP_MAX_BATCH);
+
+	return 0;
+}
+
 struct dynamic_page_pool *dynamic_page_pool_create(gfp_t gfp_mask, unsigned int order)
 {
 	struct dynamic_page_pool *pool = kmalloc(sizeof(*pool), GFP_KERNEL);
@@ -94,10 +407,25 @@ struct dynamic_page_pool *dynamic_page_pool_create(gfp_t gfp_mask, unsigned int
 	pool->low_count = 0;
 	INIT_LIST_HEAD(&pool->low_items);
 	INIT_LIST_HEAD(&pool->high_items);
+	INIT_LIST_HEAD(&pool->dirty_items);
+	pool->dirty_count = 0;
+	pool->nr_zeroed = 0;
+	pool->zero_time_ns = 0;
+	pool->refill_worker = NULL;
+	atomic_set(&pool->nr_allocated, 0);
+	ewma_dynamic_pool_rate_init(&pool->alloc_rate);
+	pool->rate_window_start = ktime_get();
+	pool->fillmark = 0;
+	atomic_set(&pool->reserve, 0);
 	pool->gfp_mask = gfp_mask | __GFP_COMP;
 	pool->order = order;
 	spin_lock_init(&pool->lock);
 
+	if (dynamic_page_pool_pcp_init(pool)) {
+		kfree(pool);
+		return NULL;
+	}
+
 	mutex_lock(&pool_list_lock);
 	list_add(&pool->list, &pool_list);
 	mutex_unlock(&pool_list_lock);
@@ -119,6 +447,12 @@ void dynamic_page_pool_destroy(struct dynamic_page_pool *pool)
 	mutex_unlock(&pool_list_lock);
 
 	/* Free any remaining pages in the pool */
+	dynamic_page_pool_drain_pcp(pool);
+	while ((page = dynamic_page_pool_remove_dirty(pool))) {
+		list_add(&page->lru, &pages);
+		num_pages++;
+	}
+
 	spin_lock_irqsave(&pool->lock, flags);
 	while (true) {
 		if (pool->low_count)
@@ -146,11 +480,16 @@ void dynamic_page_pool_destroy(struct dynamic_page_pool *pool)
 		__free_pages(page, pool->order);
 	}
 
+	free_percpu(pool->pcp);
 	kfree(pool);
 }
 
+/*
+ * Free up to nr_to_scan base pages from the pool, leaving at least keep items
+ * in its clean lists.
+ */
 static int dynamic_page_pool_do_shrink(struct dynamic_page_pool *pool, gfp_t gfp_mask,
-				       int nr_to_scan)
+				       int nr_to_scan, int keep)
 {
 	int freed = 0;
 	bool high;
@@ -166,9 +505,22 @@ static int dynamic_page_pool_do_shrink(struct dynamic_page_pool *pool, gfp_t gfp
 	if (nr_to_scan == 0)
 		return dynamic_page_pool_total(pool, high);
 
+	dynamic_page_pool_drain_pcp(pool);
+
 	while (freed < nr_to_scan) {
 		unsigned long flags;
 
+		/* Dirty items would have had to be zeroed, drop them first */
+		page = dynamic_page_pool_remove_dirty(pool);
+		if (page) {
+			list_add(&page->lru, &pages);
+			freed += (1 << pool->order);
+			continue;
+		}
+
+		if (keep && atomic_read(&pool->count) <= keep)
+			break;
+
 		spin_lock_irqsave(&pool->lock, flags);
 		if (pool->low_count) {
 			page = dynamic_page_pool_remove(pool, false);
@@ -207,7 +559,7 @@ void dynamic_page_pool_shrink_high_and_low(struct dynamic_page_pool **pools_list
 	mutex_lock(&pool_list_lock);
 	for (i = 0; i < num_pools; i++) {
 		remaining -= dynamic_page_pool_do_shrink(pools_list[i], __GFP_HIGHMEM,
-							 remaining);
+							 remaining, 0);
 
 		if (remaining <= 0) {
 			mutex_unlock(&pool_list_lock);
@@ -222,27 +574,31 @@ static int dynamic_page_pool_shrink(gfp_t gfp_mask, int nr_to_scan)
 	struct dynamic_page_pool *pool;
 	int nr_total = 0;
 	int nr_freed;
-	int only_scan = 0;
-
-	if (!nr_to_scan)
-		only_scan = 1;
+	int pass;
 
 	mutex_lock(&pool_list_lock);
-	list_for_each_entry(pool, &pool_list, list) {
-		if (only_scan) {
-			nr_total += dynamic_page_pool_do_shrink(pool,
-								gfp_mask,
-								nr_to_scan);
-		} else {
-			nr_freed = dynamic_page_pool_do_shrink(pool,
-							       gfp_mask,
-							       nr_to_scan);
+	if (!nr_to_scan) {
+		list_for_each_entry(pool, &pool_list, list)
+			nr_total += dynamic_page_pool_do_shrink(pool, gfp_mask, 0, 0);
+		goto out;
+	}
+
+	/*
+	 * Take what the pools hold above their current fill targets first, and
+	 * only eat into the targets themselves if that was not enough.
+	 */
+	for (pass = 0; pass < 2; pass++) {
+		list_for_each_entry(pool, &pool_list, list) {
+			nr_freed = dynamic_page_pool_do_shrink(pool, gfp_mask, nr_to_scan,
+							       pass ? 0 : READ_ONCE(pool->fillmark));
 			nr_to_scan -= nr_freed;
 			nr_total += nr_freed;
 			if (nr_to_scan <= 0)
-				break;
+				goto out;
 		}
 	}
+
+out:
 	mutex_unlock(&pool_list_lock);
 
 	return nr_total;
@@ -279,11 +635,6 @@ struct dynamic_page_pool **dynamic_page_pool_create_pools(int vmid,
 	for (i = 0; i < NUM_ORDERS; i++) {
 		pool_list[i] = dynamic_page_pool_create(order_flags[i],
 							orders[i]);
-		pool_list[i]->vmid = vmid;
-		pool_list[i]->prerelease_callback = callback;
-		atomic_set(&pool_list[i]->count, 0);
-		pool_list[i]->last_low_watermark_ktime = 0;
-
 		if (IS_ERR_OR_NULL(pool_list[i])) {
 			int j;
 
@@ -295,6 +646,11 @@ struct dynamic_page_pool **dynamic_page_pool_create_pools(int vmid,
 			ret = -ENOMEM;
 			goto free_pool_arr;
 		}
+
+		pool_list[i]->vmid = vmid;
+		pool_list[i]->prerelease_callback = callback;
+		atomic_set(&pool_list[i]->count, 0);
+		pool_list[i]->last_low_watermark_ktime = 0;
 	}
 
 	return pool_list;
@@ -322,6 +678,73 @@ static struct shrinker pool_shrinker = {
 	.batch = 0,
 };
 
+#ifdef CONFIG_DEBUG_FS
+static int dynamic_page_pool_pcp_stats_show(struct seq_file *s, void *unused)
+{
+	struct dynamic_page_pool *pool;
+	struct dynamic_page_pool_pcp *pcp;
+	int cpu, i = 0;
+
+	mutex_lock(&pool_list_lock);
+	list_for_each_entry(pool, &pool_list, list) {
+		seq_printf(s, "pool%d vmid %d order %u: count %d high %d batch %d\n",
+			   i++, pool->vmid, pool->order, atomic_read(&pool->count),
+			   pool->pcp_high, pool->pcp_batch);
+
+		if (!pool->pcp)
+			continue;
+
+		for_each_possible_cpu(cpu) {
+			pcp = per_cpu_ptr(pool->pcp, cpu);
+			seq_printf(s, "  cpu%d: count %d hits %lu misses %lu\n", cpu,
+				   READ_ONCE(pcp->count), READ_ONCE(pcp->hits),
+				   READ_ONCE(pcp->misses));
+		}
+	}
+	mutex_unlock(&pool_list_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(dynamic_page_pool_pcp_stats);
+
+static int dynamic_page_pool_zero_stats_show(struct seq_file *s, void *unused)
+{
+	struct dynamic_page_pool *pool;
+	int i = 0;
+
+	mutex_lock(&pool_list_lock);
+	list_for_each_entry(pool, &pool_list, list) {
+		unsigned long nr_zeroed = READ_ONCE(pool->nr_zeroed);
+		u64 zero_time_ns = READ_ONCE(pool->zero_time_ns);
+		int dirty_count = READ_ONCE(pool->dirty_count);
+
+		seq_printf(s, "pool%d vmid %d order %u: backlog %d (%lu KB) zeroed %lu time %llu us avg %llu ns\n",
+			   i++, pool->vmid, pool->order, dirty_count,
+			   ((unsigned long)dirty_count << (PAGE_SHIFT + pool->order)) / SZ_1K,
+			   nr_zeroed, div_u64(zero_time_ns, NSEC_PER_USEC),
+			   nr_zeroed ? div64_ul(zero_time_ns, nr_zeroed) : 0);
+	}
+	mutex_unlock(&pool_list_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(dynamic_page_pool_zero_stats);
+
+static void dynamic_page_pool_debugfs_init(void)
+{
+	struct dentry *root = debugfs_create_dir("dynamic_page_pool", NULL);
+
+	debugfs_create_file("pcp_stats", 0400, root, NULL,
+			    &dynamic_page_pool_pcp_stats_fops);
+	debugfs_create_file("zero_stats", 0400, root, NULL,
+			    &dynamic_page_pool_zero_stats_fops);
+}
+#else
+static inline void dynamic_page_pool_debugfs_init(void)
+{
+}
+#endif
+
 int dynamic_page_pool_init_shrinker(void)
 {
 	int ret;
@@ -334,6 +757,9 @@ int dynamic_page_pool_init_shrinker(void)
 	if (ret)
 		return ret;
 
+	/* Both system heap flavours funnel through here exactly once */
+	dynamic_page_pool_debugfs_init();
+
 	registered = true;
 	return 0;
 }
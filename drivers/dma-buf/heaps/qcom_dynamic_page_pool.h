@@ -17,11 +17,14 @@
 #ifndef _DYN_PAGE_POOL_H
 #define _DYN_PAGE_POOL_H
 
+#include <linux/average.h>
 #include <linux/device.h>
 #include <linux/kref.h>
 #include <linux/mm_types.h>
 #include <linux/mutex.h>
+#include <linux/percpu.h>
 #include <linux/shrinker.h>
+#include <linux/sizes.h>
 #include <linux/types.h>
 
 #define HIGH_ORDER_GFP  (((GFP_HIGHUSER | __GFP_ZERO | __GFP_NOWARN \
@@ -42,17 +45,44 @@ static const unsigned int orders[] = {9, 4, 0};
 #endif
 #define NUM_ORDERS ARRAY_SIZE(orders)
 
+/*
+ * Upper bound, in bytes, on what a single CPU may park in the front cache of
+ * one pool, and on the number of items moved between a per-CPU cache and
+ * the shared lists in one critical section.
+ */
+#define DYNAMIC_POOL_PCP_HIGH_BYTES	SZ_4M
+#define DYNAMIC_POOL_PCP_MAX_BATCH	64
+
 enum dynamic_pool_callback_ret {
 	DYNAMIC_POOL_SUCCESS,
 	DYNAMIC_POOL_FAILURE,
 };
 
+/* Recent allocation rate of a pool, in items per rate window */
+DECLARE_EWMA(dynamic_pool_rate, 8, 8)
+
 struct dynamic_page_pool;
 
 typedef enum dynamic_pool_callback_ret (*prerelease_callback)(struct dynamic_page_pool *pool,
 							      struct list_head *pages,
 							      int num_pages);
 
+/**
+ * struct dynamic_page_pool_pcp - per-CPU front cache of a pagepool
+ * @lock:	lock protecting this CPU's cache; only contended by remote drains
+ * @items:	list of cached items
+ * @count:	number of items in @items
+ * @hits:	number of allocations served from @items
+ * @misses:	number of allocations that had to go to the shared lists
+ */
+struct dynamic_page_pool_pcp {
+	spinlock_t lock;
+	struct list_head items;
+	int count;
+	unsigned long hits;
+	unsigned long misses;
+};
+
 /**
  * struct dynamic_page_pool - pagepool struct
  * @high_count:			number of highmem items in the pool
@@ -71,6 +101,24 @@ typedef enum dynamic_pool_callback_ret (*prerelease_callback)(struct dynamic_pag
  * @vmid:			the vmid used for this pool
  * @prerelease_callback:	preprocessing function called before pages are
  *				released to buddy
+ * @pcp:			per-CPU front caches, served without taking @lock
+ * @pcp_high:			number of items above which a per-CPU cache is
+ *				drained back to the shared lists
+ * @pcp_batch:			number of items moved between a per-CPU cache and
+ *				the shared lists at a time
+ * @dirty_count:		number of items waiting to be zeroed
+ * @dirty_items:		list of freed items that still hold the previous
+ *				owner's data; never handed out for allocation
+ * @nr_zeroed:			number of dirty items zeroed so far
+ * @zero_time_ns:		total time spent zeroing dirty items
+ * @nr_allocated:		number of items handed out in the current rate
+ *				window
+ * @alloc_rate:			moving average of @nr_allocated over past windows
+ * @rate_window_start:		start time of the current rate window
+ * @fillmark:			number of items the shrinker should try to leave
+ *				in the pool, or 0 if it may take everything
+ * @reserve:			number of items requested ahead of time through the
+ *				heap's prefetch interface, on top of the fillmark
  *
  * Allows you to keep a pool of pre allocated pages to use
  * Keeping a pool of pages that is ready for dma, ie any cached mapping have
@@ -91,6 +139,18 @@ struct dynamic_page_pool {
 	struct list_head list;
 	int vmid;
 	prerelease_callback prerelease_callback;
+	struct dynamic_page_pool_pcp __percpu *pcp;
+	int pcp_high;
+	int pcp_batch;
+	int dirty_count;
+	struct list_head dirty_items;
+	unsigned long nr_zeroed;
+	u64 zero_time_ns;
+	atomic_t nr_allocated;
+	struct ewma_dynamic_pool_rate alloc_rate;
+	ktime_t rate_window_start;
+	int fillmark;
+	atomic_t reserve;
 };
 
 struct dynamic_page_pool **dynamic_page_pool_create_pools(int vmid,
@@ -98,6 +158,8 @@ struct dynamic_page_pool **dynamic_page_pool_create_pools(int vmid,
 void dynamic_page_pool_release_pools(struct dynamic_page_pool **pool_list);
 
 struct page *dynamic_page_pool_alloc(struct dynamic_page_pool *pool);
+int dynamic_page_pool_alloc_bulk(struct dynamic_page_pool *pool, int nr_items,
+				 struct list_head *list);
 void dynamic_page_pool_free(struct dynamic_page_pool *pool, struct page *page);
 
 int dynamic_page_pool_init_shrinker(void);
@@ -107,5 +169,9 @@ int dynamic_page_pool_total(struct dynamic_page_pool *pool, bool high);
 
 struct page *dynamic_page_pool_remove(struct dynamic_page_pool *pool, bool high);
 void dynamic_page_pool_add(struct dynamic_page_pool *pool, struct page *page);
+void dynamic_page_pool_drain_pcp(struct dynamic_page_pool *pool);
+
+void dynamic_page_pool_add_dirty(struct dynamic_page_pool *pool, struct page *page);
+struct page *dynamic_page_pool_remove_dirty(struct dynamic_page_pool *pool);
 
 #endif /* _DYN_PAGE_POOL_H */
@@ -455,20 +455,12 @@ static struct page *alloc_largest_available(struct dynamic_page_pool **pools,
 	*page_from_secure_pool = true;
 
 	for (i = 0; i < NUM_ORDERS; i++) {
-		unsigned long flags;
-
 		if (size <  (PAGE_SIZE << orders[i]))
 			continue;
 		if (max_order < orders[i])
 			continue;
 
-		spin_lock_irqsave(&pools[i]->lock, flags);
-		if (pools[i]->high_count)
-			page = dynamic_page_pool_remove(pools[i], true);
-		else if (pools[i]->low_count)
-			page = dynamic_page_pool_remove(pools[i], false);
-		spin_unlock_irqrestore(&pools[i]->lock, flags);
-
+		page = dynamic_page_pool_alloc(pools[i]);
 		if (!page)
 			continue;
 		return page;
@@ -511,6 +503,8 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 	sys_heap = dma_heap_get_drvdata(heap);
 
 	INIT_LIST_HEAD(&buffer->attachments);
+	INIT_LIST_HEAD(&buffer->map_cache);
+	INIT_LIST_HEAD(&buffer->mapped_node);
 	mutex_init(&buffer->lock);
 	buffer->heap = heap;
 	buffer->len = len;
@@ -622,9 +616,24 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 	return ERR_PTR(ret);
 }
 
+static int system_heap_prefetch(struct dma_heap *heap, unsigned long len)
+{
+	struct dma_buf_heap_prefetch_region region = { .size = len, .heap = heap };
+
+	return qcom_secure_system_heap_prefetch(&region, 1);
+}
+
+static int system_heap_drain(struct dma_heap *heap, unsigned long len)
+{
+	struct dma_buf_heap_prefetch_region region = { .size = len, .heap = heap };
+
+	return qcom_secure_system_heap_drain(&region, 1);
+}
 
 static const struct dma_heap_ops system_heap_ops = {
 	.allocate = system_heap_allocate,
+	.prefetch = system_heap_prefetch,
+	.drain = system_heap_drain,
 };
 
 static int create_prefetch_workqueue(void)
@@ -17,6 +17,7 @@
  * Copyright (c) 2022-2023 Qualcomm Innovation Center, Inc. All rights reserved.
  */
 
+#include <linux/bitmap.h>
 #include <linux/dma-buf.h>
 #include <linux/dma-mapping.h>
 #include <linux/dma-heap.h>
@@ -25,6 +26,7 @@
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/scatterlist.h>
+#include <linux/shrinker.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
 #include <linux/of.h>
@@ -35,6 +37,9 @@
 
 #include "qcom_sg_ops.h"
 
+#define CREATE_TRACE_POINTS
+#include "trace-qcom-sg.h"
+
 int proxy_invalid_map(struct device *dev, struct sg_table *table,
 		      struct dma_buf *dmabuf)
 {
@@ -53,6 +58,81 @@ static struct smmu_proxy_callbacks smmu_proxy_callback_ops = {
 	.unmap_sgtable = proxy_invalid_unmap,
 };
 
+/*
+ * When set, cached buffers mapped to userspace track CPU writes at page
+ * granularity through write faults. Cache cleans on end_cpu_access and
+ * map_dma_buf then only cover the pages written since the previous clean.
+ * The choice is made per buffer on its first mmap.
+ */
+static bool dirty_tracking;
+module_param(dirty_tracking, bool, 0644);
+MODULE_PARM_DESC(dirty_tracking, "Clean only the CPU-dirtied pages of mmapped cached buffers");
+
+static atomic64_t cmo_bytes_cleaned = ATOMIC64_INIT(0);
+static atomic64_t cmo_bytes_skipped = ATOMIC64_INIT(0);
+
+static int cmo_stats_get(char *buf, const struct kernel_param *kp)
+{
+	return scnprintf(buf, PAGE_SIZE, "cleaned %lld skipped %lld\n",
+			 atomic64_read(&cmo_bytes_cleaned),
+			 atomic64_read(&cmo_bytes_skipped));
+}
+
+static const struct kernel_param_ops cmo_stats_ops = {
+	.get = cmo_stats_get,
+};
+module_param_cb(cmo_stats, &cmo_stats_ops, NULL, 0444);
+MODULE_PARM_DESC(cmo_stats, "Bytes cleaned and skipped by dirty-range tracking");
+
+/*
+ * When set, the device mapping of an attachment outlives
+ * dma_buf_unmap_attachment() and dma_buf_detach(), so that mapping the
+ * buffer to the same device again reuses it instead of remapping. Cached
+ * mappings are dropped when the buffer is released or its VM permissions
+ * are about to change.
+ */
+static bool map_caching;
+module_param(map_caching, bool, 0644);
+MODULE_PARM_DESC(map_caching, "Keep device mappings for reuse until release");
+
+/*
+ * Devices that map large buffers at a high rate, such as camera and video
+ * frames, can opt in to the mapping cache for buffers of at least the size
+ * given by their "qcom,dma-buf-map-cache-min-size" property. Those buffers
+ * then never go back to the IOVA allocator, whose per-CPU caches only cover
+ * small sizes, until they are released.
+ */
+static bool qcom_sg_keep_mapping(struct device *dev,
+				 struct qcom_sg_buffer *buffer)
+{
+	u32 min_size;
+
+	if (of_property_read_u32(dev->of_node, "qcom,dma-buf-map-cache-min-size",
+				 &min_size))
+		return false;
+
+	return buffer->len >= min_size;
+}
+
+static bool qcom_sg_caching_mapping(struct dma_heap_attachment *a)
+{
+	return map_caching || a->keep_mapping;
+}
+
+/*
+ * Buffers holding device mappings that are kept across unmap, whether for
+ * reuse after detach or through DMA_ATTR_QTI_PERSISTENT_MAP. Under memory
+ * pressure the shrinker tears down those that no device is using.
+ */
+static LIST_HEAD(mapped_buffers);
+static DEFINE_MUTEX(mapped_buffers_lock);
+static unsigned long nr_mapped_buffers;
+
+static int sgl_sync_range(struct device *dev, struct scatterlist *sgl,
+			  unsigned int nents, unsigned long offset,
+			  unsigned long length,
+			  enum dma_data_direction dir, bool for_cpu);
+
 static struct sg_table *dup_sg_table(struct sg_table *table)
 {
 	struct sg_table *new_table;
@@ -78,6 +158,64 @@ static struct sg_table *dup_sg_table(struct sg_table *table)
 	return new_table;
 }
 
+static void qcom_sg_free_attachment(struct dma_heap_attachment *a)
+{
+	sg_free_table(a->table);
+	kfree(a->table);
+	kfree(a);
+}
+
+/*
+ * Drops the cached device mapping of @a. The CPU side was already synced
+ * when the attachment was last unmapped. Caller must hold buffer->lock.
+ */
+static void qcom_sg_drop_mapping(struct qcom_sg_buffer *buffer,
+				 struct dma_heap_attachment *a)
+{
+	dma_unmap_sgtable(a->dev, a->table, a->dir,
+			  a->attrs | DMA_ATTR_SKIP_CPU_SYNC);
+	a->dma_mapped = false;
+	mem_buf_vmperm_unpin(buffer->vmperm);
+}
+
+/* Caller must hold buffer->lock */
+static bool qcom_sg_keeps_mapping(struct qcom_sg_buffer *buffer)
+{
+	struct dma_heap_attachment *a;
+
+	if (!list_empty(&buffer->map_cache))
+		return true;
+
+	list_for_each_entry(a, &buffer->attachments, list) {
+		if (a->dma_mapped)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Puts @buffer on the shrinker list while it keeps a device mapping, and takes
+ * it off once it doesn't. Caller must hold buffer->lock.
+ */
+static void qcom_sg_update_mapped(struct qcom_sg_buffer *buffer)
+{
+	bool kept = qcom_sg_keeps_mapping(buffer);
+
+	if (kept == !list_empty(&buffer->mapped_node))
+		return;
+
+	mutex_lock(&mapped_buffers_lock);
+	if (kept) {
+		list_add_tail(&buffer->mapped_node, &mapped_buffers);
+		nr_mapped_buffers++;
+	} else {
+		list_del_init(&buffer->mapped_node);
+		nr_mapped_buffers--;
+	}
+	mutex_unlock(&mapped_buffers_lock);
+}
+
 int qcom_sg_attach(struct dma_buf *dmabuf,
 		   struct dma_buf_attachment *attachment)
 {
@@ -85,6 +223,20 @@ int qcom_sg_attach(struct dma_buf *dmabuf,
 	struct dma_heap_attachment *a;
 	struct sg_table *table;
 
+	mutex_lock(&buffer->lock);
+	list_for_each_entry(a, &buffer->map_cache, list) {
+		if (a->dev != attachment->dev)
+			continue;
+
+		list_move(&a->list, &buffer->attachments);
+		mutex_unlock(&buffer->lock);
+
+		put_device(a->dev);
+		attachment->priv = a;
+		return 0;
+	}
+	mutex_unlock(&buffer->lock);
+
 	a = kzalloc(sizeof(*a), GFP_KERNEL);
 	if (!a)
 		return -ENOMEM;
@@ -99,6 +251,7 @@ int qcom_sg_attach(struct dma_buf *dmabuf,
 	a->dev = attachment->dev;
 	INIT_LIST_HEAD(&a->list);
 	a->mapped = false;
+	a->keep_mapping = qcom_sg_keep_mapping(a->dev, buffer);
 
 	attachment->priv = a;
 
@@ -116,14 +269,247 @@ void qcom_sg_detach(struct dma_buf *dmabuf,
 	struct dma_heap_attachment *a = attachment->priv;
 
 	mutex_lock(&buffer->lock);
+	if (a->dma_mapped && qcom_sg_caching_mapping(a)) {
+		get_device(a->dev);
+		list_move(&a->list, &buffer->map_cache);
+		mutex_unlock(&buffer->lock);
+		return;
+	}
+
+	if (a->dma_mapped)
+		qcom_sg_drop_mapping(buffer, a);
 	list_del(&a->list);
+	qcom_sg_update_mapped(buffer);
 	mutex_unlock(&buffer->lock);
 
-	sg_free_table(a->table);
-	kfree(a->table);
-	kfree(a);
+	qcom_sg_free_attachment(a);
 }
 
+/* Caller must hold buffer->lock */
+static void __qcom_sg_invalidate(struct qcom_sg_buffer *buffer)
+{
+	struct dma_heap_attachment *a, *tmp;
+
+	list_for_each_entry(a, &buffer->attachments, list) {
+		if (a->dma_mapped && !a->mapped)
+			qcom_sg_drop_mapping(buffer, a);
+	}
+
+	list_for_each_entry_safe(a, tmp, &buffer->map_cache, list) {
+		qcom_sg_drop_mapping(buffer, a);
+		list_del(&a->list);
+		put_device(a->dev);
+		qcom_sg_free_attachment(a);
+	}
+}
+
+/*
+ * Drops every device mapping kept for reuse. Called on release and, through
+ * mem_buf, before the VM permissions of the buffer change.
+ */
+void qcom_sg_invalidate(struct dma_buf *dmabuf)
+{
+	struct qcom_sg_buffer *buffer = dmabuf->priv;
+
+	mutex_lock(&buffer->lock);
+	__qcom_sg_invalidate(buffer);
+	qcom_sg_update_mapped(buffer);
+	mutex_unlock(&buffer->lock);
+}
+
+static unsigned long qcom_sg_shrink_count(struct shrinker *shrinker,
+					  struct shrink_control *sc)
+{
+	return READ_ONCE(nr_mapped_buffers);
+}
+
+/*
+ * Buffers being mapped or synced are skipped rather than waited for, since
+ * mapping may itself allocate and end up here.
+ */
+static unsigned long qcom_sg_shrink_scan(struct shrinker *shrinker,
+					 struct shrink_control *sc)
+{
+	struct qcom_sg_buffer *buffer, *tmp;
+	unsigned long freed = 0;
+
+	mutex_lock(&mapped_buffers_lock);
+	list_for_each_entry_safe(buffer, tmp, &mapped_buffers, mapped_node) {
+		if (freed >= sc->nr_to_scan)
+			break;
+
+		if (!mutex_trylock(&buffer->lock))
+			continue;
+
+		__qcom_sg_invalidate(buffer);
+		if (!qcom_sg_keeps_mapping(buffer)) {
+			list_del_init(&buffer->mapped_node);
+			nr_mapped_buffers--;
+			freed++;
+		}
+		mutex_unlock(&buffer->lock);
+	}
+	mutex_unlock(&mapped_buffers_lock);
+
+	return freed ? freed : SHRINK_STOP;
+}
+
+static struct shrinker qcom_sg_shrinker = {
+	.count_objects = qcom_sg_shrink_count,
+	.scan_objects = qcom_sg_shrink_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
+int qcom_sg_init_shrinker(void)
+{
+	return register_shrinker(&qcom_sg_shrinker, "qcom_sg_mappings");
+}
+
+/*
+ * Dirty tracking only covers CPU writes made through userspace mappings, so
+ * a kernel mapping of the buffer makes every page potentially dirty.
+ */
+static bool qcom_sg_tracking_dirty(struct qcom_sg_buffer *buffer)
+{
+	return buffer->track_dirty && !buffer->vmap_cnt;
+}
+
+static bool qcom_sg_sync_target(struct dma_heap_attachment *a,
+				struct dma_heap_attachment *only)
+{
+	return only ? a == only : a->mapped;
+}
+
+/*
+ * Clean the CPU caches for @only, or for every mapped attachment when @only
+ * is NULL. Called with buffer->lock held and qcom_sg_tracking_dirty() true.
+ *
+ * Once a clean is known to reach memory, the written pages are write
+ * protected again before their range is synced, so that any later CPU write
+ * faults and is recorded for the next clean. If the caches may hold dirty
+ * lines outside the bitmap, or a device mapping spans several IOVA segments,
+ * the whole buffer is cleaned instead.
+ */
+static void qcom_sg_sync_dirty_for_device(struct dma_buf *dmabuf,
+					  struct dma_heap_attachment *only,
+					  enum dma_data_direction dir)
+{
+	struct qcom_sg_buffer *buffer = dmabuf->priv;
+	struct address_space *mapping = dmabuf->file->f_mapping;
+	unsigned long npages = buffer->len >> PAGE_SHIFT;
+	struct dma_heap_attachment *a;
+	unsigned long start, end, offset, len, nr_dirty = 0;
+	bool partial = buffer->cmo_clean;
+	bool clean = false;
+
+	list_for_each_entry(a, &buffer->attachments, list) {
+		if (!qcom_sg_sync_target(a, only) || dev_is_dma_coherent(a->dev))
+			continue;
+		clean = true;
+		if (a->table->nents != 1)
+			partial = false;
+	}
+
+	if (!clean || !partial) {
+		if (clean) {
+			bitmap_zero(buffer->dirty, npages);
+			unmap_mapping_range(mapping, 0, buffer->len, 1);
+		}
+
+		list_for_each_entry(a, &buffer->attachments, list) {
+			if (qcom_sg_sync_target(a, only))
+				dma_sync_sgtable_for_device(a->dev, a->table, dir);
+		}
+
+		if (clean) {
+			buffer->cmo_clean = true;
+			atomic64_add(buffer->len, &cmo_bytes_cleaned);
+		}
+		return;
+	}
+
+	for_each_set_bitrange(start, end, buffer->dirty, npages) {
+		offset = start << PAGE_SHIFT;
+		len = (end - start) << PAGE_SHIFT;
+
+		bitmap_clear(buffer->dirty, start, end - start);
+		unmap_mapping_range(mapping, offset, len, 1);
+
+		list_for_each_entry(a, &buffer->attachments, list) {
+			if (!qcom_sg_sync_target(a, only) ||
+			    dev_is_dma_coherent(a->dev))
+				continue;
+			sgl_sync_range(a->dev, a->table->sgl, a->table->orig_nents,
+				       offset, len, dir, false);
+		}
+		nr_dirty += end - start;
+	}
+
+	/* Coherent devices still need their bounce buffers, if any, synced */
+	list_for_each_entry(a, &buffer->attachments, list) {
+		if (qcom_sg_sync_target(a, only) && dev_is_dma_coherent(a->dev))
+			dma_sync_sgtable_for_device(a->dev, a->table, dir);
+	}
+
+	atomic64_add(nr_dirty << PAGE_SHIFT, &cmo_bytes_cleaned);
+	atomic64_add(buffer->len - (nr_dirty << PAGE_SHIFT), &cmo_bytes_skipped);
+}
+
+/*
+ * Zeroes a buffer that was allocated without clearing before anyone but its
+ * producer device can see it. Caller must hold buffer->lock.
+ */
+static void qcom_sg_clear_unwritten(struct qcom_sg_buffer *buffer)
+{
+	struct sg_page_iter piter;
+
+	if (!buffer->unwritten_for)
+		return;
+
+	for_each_sgtable_page(&buffer->sg_table, &piter, 0)
+		clear_highpage(sg_page_iter_page(&piter));
+
+	if (buffer->uncached) {
+		dma_map_sgtable(dma_heap_get_dev(buffer->heap), &buffer->sg_table,
+				DMA_BIDIRECTIONAL, 0);
+		dma_unmap_sgtable(dma_heap_get_dev(buffer->heap), &buffer->sg_table,
+				  DMA_BIDIRECTIONAL, 0);
+	}
+	buffer->cmo_clean = false;
+
+	put_device(buffer->unwritten_for);
+	buffer->unwritten_for = NULL;
+}
+
+/**
+ * qcom_dma_heap_mark_written() - mark an unzeroed buffer as initialized
+ * @dmabuf: buffer allocated with qcom_cma_heap_alloc_unzeroed()
+ *
+ * To be called by the producer once its DMA has overwritten the whole
+ * buffer. Afterwards the buffer can be mapped by the CPU and other devices
+ * without being cleared first.
+ *
+ * Return: 0 on success, -EINVAL if @dmabuf is not a qcom_sg buffer.
+ */
+int qcom_dma_heap_mark_written(struct dma_buf *dmabuf)
+{
+	struct qcom_sg_buffer *buffer;
+
+	if (dmabuf->ops != &qcom_sg_buf_ops.dma_ops)
+		return -EINVAL;
+
+	buffer = dmabuf->priv;
+	mutex_lock(&buffer->lock);
+	if (buffer->unwritten_for) {
+		put_device(buffer->unwritten_for);
+		buffer->unwritten_for = NULL;
+	}
+	mutex_unlock(&buffer->lock);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(qcom_dma_heap_mark_written);
+
 struct sg_table *qcom_sg_map_dma_buf(struct dma_buf_attachment *attachment,
 				     enum dma_data_direction direction)
 {
@@ -147,6 +533,10 @@ struct sg_table *qcom_sg_map_dma_buf(struct dma_buf_attachment *attachment,
 	/* Prevent map/unmap during begin/end_cpu_access */
 	mutex_lock(&buffer->lock);
 
+	if (buffer->unwritten_for && buffer->unwritten_for != attachment->dev &&
+	    mem_buf_vmperm_can_cmo(vmperm))
+		qcom_sg_clear_unwritten(buffer);
+
 	/* Ensure VM permissions are constant while the buffer is mapped */
 	mem_buf_vmperm_pin(vmperm);
 	if (buffer->uncached || !mem_buf_vmperm_can_cmo(vmperm))
@@ -155,11 +545,48 @@ struct sg_table *qcom_sg_map_dma_buf(struct dma_buf_attachment *attachment,
 	if (attrs & DMA_ATTR_DELAYED_UNMAP) {
 		ret = msm_dma_map_sgtable(attachment->dev, table, direction,
 					  attachment->dmabuf, attrs);
-	} else if (!a->mapped) {
-		ret = dma_map_sgtable(attachment->dev, table, direction, attrs);
-	} else {
+	} else if (a->mapped) {
 		dev_err(attachment->dev, "Error: Dma-buf is already mapped!\n");
 		ret = -EBUSY;
+	} else if (a->dma_mapped && a->dir == direction &&
+		   a->attrs == (attrs & ~DMA_ATTR_SKIP_CPU_SYNC)) {
+		/* The cached mapping already holds a vmperm pin */
+		mem_buf_vmperm_unpin(vmperm);
+		if (!(attrs & DMA_ATTR_SKIP_CPU_SYNC)) {
+			if (qcom_sg_tracking_dirty(buffer))
+				qcom_sg_sync_dirty_for_device(attachment->dmabuf,
+							      a, direction);
+			else
+				dma_sync_sgtable_for_device(attachment->dev,
+							    table, direction);
+		}
+		trace_qcom_sg_map_cache_hit(attachment->dmabuf, attachment->dev);
+		ret = 0;
+	} else {
+		if (a->dma_mapped)
+			qcom_sg_drop_mapping(buffer, a);
+
+		if (!(attrs & DMA_ATTR_SKIP_CPU_SYNC) &&
+		    qcom_sg_tracking_dirty(buffer)) {
+			ret = dma_map_sgtable(attachment->dev, table, direction,
+					      attrs | DMA_ATTR_SKIP_CPU_SYNC);
+			if (!ret)
+				qcom_sg_sync_dirty_for_device(attachment->dmabuf,
+							      a, direction);
+		} else {
+			ret = dma_map_sgtable(attachment->dev, table, direction,
+					      attrs);
+		}
+
+		if (!ret && (qcom_sg_caching_mapping(a) ||
+			     (attrs & DMA_ATTR_QTI_PERSISTENT_MAP))) {
+			a->dma_mapped = true;
+			a->dir = direction;
+			a->attrs = attrs & ~DMA_ATTR_SKIP_CPU_SYNC;
+			trace_qcom_sg_map_cache_miss(attachment->dmabuf,
+						     attachment->dev);
+		}
+		qcom_sg_update_mapped(buffer);
 	}
 
 	if (ret) {
@@ -207,6 +634,12 @@ void qcom_sg_unmap_dma_buf(struct dma_buf_attachment *attachment,
 	if (attrs & DMA_ATTR_DELAYED_UNMAP) {
 		msm_dma_unmap_sgtable(attachment->dev, table, direction,
 				      attachment->dmabuf, attrs);
+	} else if (a->dma_mapped) {
+		/* Keep the mapping, and its vmperm pin, for the next map */
+		if (!(attrs & DMA_ATTR_SKIP_CPU_SYNC))
+			dma_sync_sgtable_for_cpu(attachment->dev, table, direction);
+		mutex_unlock(&buffer->lock);
+		return;
 	} else {
 		dma_unmap_sgtable(attachment->dev, table, direction, attrs);
 	}
@@ -265,6 +698,12 @@ int qcom_sg_dma_buf_end_cpu_access(struct dma_buf *dmabuf,
 	if (buffer->vmap_cnt)
 		flush_kernel_vmap_range(buffer->vaddr, buffer->len);
 
+	if (qcom_sg_tracking_dirty(buffer)) {
+		qcom_sg_sync_dirty_for_device(dmabuf, NULL, direction);
+		mutex_unlock(&buffer->lock);
+		return 0;
+	}
+
 	list_for_each_entry(a, &buffer->attachments, list) {
 		if (!a->mapped)
 			continue;
@@ -423,6 +862,90 @@ static const struct vm_operations_struct qcom_sg_vm_ops = {
 	.close = qcom_sg_vm_ops_close,
 };
 
+static vm_fault_t qcom_sg_vm_ops_fault(struct vm_fault *vmf)
+{
+	struct vm_area_struct *vma = vmf->vma;
+	struct dma_buf *dmabuf = vma->vm_file->private_data;
+	struct qcom_sg_buffer *buffer = dmabuf->priv;
+	pgprot_t prot;
+
+	if (vmf->pgoff >= buffer->len >> PAGE_SHIFT)
+		return VM_FAULT_SIGBUS;
+
+	/* Read faults map the page read-only so the first write is seen */
+	if (vmf->flags & FAULT_FLAG_WRITE) {
+		set_bit(vmf->pgoff, buffer->dirty);
+		prot = vma->vm_page_prot;
+	} else {
+		prot = vm_get_page_prot(vma->vm_flags & ~VM_SHARED);
+	}
+
+	return vmf_insert_pfn_prot(vma, vmf->address,
+				   page_to_pfn(buffer->pages[vmf->pgoff]), prot);
+}
+
+static vm_fault_t qcom_sg_vm_ops_pfn_mkwrite(struct vm_fault *vmf)
+{
+	struct dma_buf *dmabuf = vmf->vma->vm_file->private_data;
+	struct qcom_sg_buffer *buffer = dmabuf->priv;
+
+	set_bit(vmf->pgoff, buffer->dirty);
+	return 0;
+}
+
+static const struct vm_operations_struct qcom_sg_tracked_vm_ops = {
+	.open = qcom_sg_vm_ops_open,
+	.close = qcom_sg_vm_ops_close,
+	.fault = qcom_sg_vm_ops_fault,
+	.pfn_mkwrite = qcom_sg_vm_ops_pfn_mkwrite,
+};
+
+/*
+ * Decide on the first mmap of @buffer whether its CPU writes are tracked.
+ * A buffer that was ever mapped untracked stays untracked, as its earlier
+ * mappings could write to it without faulting.
+ */
+static bool qcom_sg_init_dirty_tracking(struct qcom_sg_buffer *buffer)
+{
+	unsigned long npages = buffer->len >> PAGE_SHIFT;
+	struct sg_page_iter piter;
+	struct page **tmp;
+	bool ret = true;
+
+	mutex_lock(&buffer->lock);
+	if (buffer->track_dirty)
+		goto out;
+
+	ret = false;
+	if (buffer->mmap_untracked || buffer->uncached || !dirty_tracking ||
+	    !PAGE_ALIGNED(buffer->len))
+		goto untracked;
+
+	buffer->dirty = bitmap_zalloc(npages, GFP_KERNEL);
+	buffer->pages = kvmalloc_array(npages, sizeof(*buffer->pages), GFP_KERNEL);
+	if (!buffer->dirty || !buffer->pages) {
+		bitmap_free(buffer->dirty);
+		kvfree(buffer->pages);
+		buffer->dirty = NULL;
+		buffer->pages = NULL;
+		goto untracked;
+	}
+
+	tmp = buffer->pages;
+	for_each_sgtable_page(&buffer->sg_table, &piter, 0)
+		*tmp++ = sg_page_iter_page(&piter);
+
+	buffer->track_dirty = true;
+	ret = true;
+	goto out;
+
+untracked:
+	buffer->mmap_untracked = true;
+out:
+	mutex_unlock(&buffer->lock);
+	return ret;
+}
+
 int qcom_sg_mmap(struct dma_buf *dmabuf, struct vm_area_struct *vma)
 {
 	struct qcom_sg_buffer *buffer = dmabuf->priv;
@@ -439,8 +962,19 @@ int qcom_sg_mmap(struct dma_buf *dmabuf, struct vm_area_struct *vma)
 		return -EPERM;
 	}
 
-	vma->vm_ops = &qcom_sg_vm_ops;
+	mutex_lock(&buffer->lock);
+	qcom_sg_clear_unwritten(buffer);
+	mutex_unlock(&buffer->lock);
+
 	vma->vm_private_data = buffer->vmperm;
+	/* Private mappings never write to the buffer and need no tracking */
+	if ((vma->vm_flags & VM_SHARED) && qcom_sg_init_dirty_tracking(buffer)) {
+		vma->vm_ops = &qcom_sg_tracked_vm_ops;
+		vm_flags_set(vma, VM_PFNMAP | VM_DONTEXPAND | VM_DONTDUMP);
+		return 0;
+	}
+
+	vma->vm_ops = &qcom_sg_vm_ops;
 	if (buffer->uncached)
 		vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
 
@@ -514,6 +1048,7 @@ int qcom_sg_vmap(struct dma_buf *dmabuf, struct iosys_map *map)
 	}
 
 	mutex_lock(&buffer->lock);
+	qcom_sg_clear_unwritten(buffer);
 	if (buffer->vmap_cnt) {
 		buffer->vmap_cnt++;
 		iosys_map_set_vaddr(map, buffer->vaddr);
@@ -529,6 +1064,8 @@ int qcom_sg_vmap(struct dma_buf *dmabuf, struct iosys_map *map)
 
 	buffer->vaddr = vaddr;
 	buffer->vmap_cnt++;
+	/* Writes through the kernel mapping are not tracked */
+	buffer->cmo_clean = false;
 	iosys_map_set_vaddr(map, buffer->vaddr);
 out:
 	mutex_unlock(&buffer->lock);
@@ -554,10 +1091,15 @@ void qcom_sg_release(struct dma_buf *dmabuf)
 {
 	struct qcom_sg_buffer *buffer = dmabuf->priv;
 
+	qcom_sg_invalidate(dmabuf);
 	if (mem_buf_vmperm_release(buffer->vmperm))
 		return;
 
 	msm_dma_buf_freed(buffer);
+	if (buffer->unwritten_for)
+		put_device(buffer->unwritten_for);
+	bitmap_free(buffer->dirty);
+	kvfree(buffer->pages);
 	buffer->free(buffer);
 }
 
@@ -571,6 +1113,7 @@ struct mem_buf_vmperm *qcom_sg_lookup_vmperm(struct dma_buf *dmabuf)
 struct mem_buf_dma_buf_ops qcom_sg_buf_ops = {
 	.attach = qcom_sg_attach,
 	.lookup = qcom_sg_lookup_vmperm,
+	.invalidate = qcom_sg_invalidate,
 	.dma_ops = {
 		.attach = NULL, /* Will be set by mem_buf_dma_buf_export */
 		.detach = qcom_sg_detach,
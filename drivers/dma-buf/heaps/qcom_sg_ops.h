@@ -22,6 +22,10 @@
 struct qcom_sg_buffer {
 	struct dma_heap *heap;
 	struct list_head attachments;
+	/* Detached attachments whose device mapping is kept for reuse */
+	struct list_head map_cache;
+	/* On the shrinker list while any device mapping is kept */
+	struct list_head mapped_node;
 	struct mutex lock;
 	unsigned long len;
 	struct sg_table sg_table;
@@ -30,6 +34,26 @@ struct qcom_sg_buffer {
 	bool uncached;
 	struct mem_buf_vmperm *vmperm;
 	void (*free)(struct qcom_sg_buffer *buffer);
+
+	/*
+	 * Dirty-range tracking: when track_dirty is set, CPU writes through
+	 * mmap are recorded in the dirty bitmap, one bit per page, and pages
+	 * is the lookup table used by the fault handler. cmo_clean means the
+	 * CPU caches hold no dirty lines for the buffer outside that bitmap.
+	 * mmap_untracked is set once the buffer has been mapped without
+	 * tracking, after which it can never be tracked.
+	 */
+	bool track_dirty;
+	bool mmap_untracked;
+	bool cmo_clean;
+	unsigned long *dirty;
+	struct page **pages;
+
+	/*
+	 * Set while the buffer was handed out without being zeroed and has
+	 * not been written yet. Until then only this device may access it.
+	 */
+	struct device *unwritten_for;
 };
 
 struct dma_heap_attachment {
@@ -37,6 +61,18 @@ struct dma_heap_attachment {
 	struct sg_table *table;
 	struct list_head list;
 	bool mapped;
+
+	/*
+	 * Set while table holds a device mapping that is kept across
+	 * dma_buf_unmap_attachment() for reuse, together with the direction
+	 * and attributes it was created with.
+	 */
+	bool dma_mapped;
+	enum dma_data_direction dir;
+	unsigned long attrs;
+
+	/* The device opted in to mapping caching for buffers this large */
+	bool keep_mapping;
 };
 
 int qcom_sg_attach(struct dma_buf *dmabuf,
@@ -45,6 +81,8 @@ int qcom_sg_attach(struct dma_buf *dmabuf,
 void qcom_sg_detach(struct dma_buf *dmabuf,
 		    struct dma_buf_attachment *attachment);
 
+void qcom_sg_invalidate(struct dma_buf *dmabuf);
+
 struct sg_table *qcom_sg_map_dma_buf(struct dma_buf_attachment *attachment,
 				     enum dma_data_direction direction);
 
@@ -80,6 +118,8 @@ void qcom_sg_release(struct dma_buf *dmabuf);
 
 struct mem_buf_vmperm *qcom_sg_lookup_vmperm(struct dma_buf *dmabuf);
 
+int qcom_sg_init_shrinker(void);
+
 extern struct mem_buf_dma_buf_ops qcom_sg_buf_ops;
 
 #endif /* _QCOM_SG_OPS_H */
@@ -40,6 +40,8 @@
  * Copyright (c) 2022-2023 Qualcomm Innovation Center, Inc. All rights reserved.
  */
 
+#include <linux/cma.h>
+#include <linux/debugfs.h>
 #include <linux/dma-buf.h>
 #include <linux/dma-mapping.h>
 #include <linux/dma-heap.h>
@@ -48,6 +50,7 @@
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/scatterlist.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
 #include <linux/kthread.h>
@@ -60,17 +63,92 @@
 #include "qcom_system_heap.h"
 #include "../../../mm/internal.h"
 
+static LIST_HEAD(system_heaps);
+
+/* Physically contiguous run sizes tried from a heap's CMA region */
+static const unsigned long contig_run_sizes[] = {SZ_2M, SZ_1M};
+
+static const unsigned long granules[SYSTEM_HEAP_NR_GRANULES] = {
+	SZ_2M, SZ_1M, SZ_64K, PAGE_SIZE
+};
+
 #if IS_ENABLED(CONFIG_QCOM_DMABUF_HEAPS_PAGE_POOL_REFILL)
 #define DYNAMIC_POOL_FILL_MARK (100 * SZ_1M)
 #define DYNAMIC_POOL_LOW_MARK_PERCENT 40UL
-#define DYNAMIC_POOL_LOW_MARK ((DYNAMIC_POOL_FILL_MARK * DYNAMIC_POOL_LOW_MARK_PERCENT) / 100)
 
 #define DYNAMIC_POOL_REFILL_DEFER_WINDOW_MS 10
 #define DYNAMIC_POOL_KTHREAD_NICE_VAL 10
 
+/*
+ * In adaptive mode a pool aims to hold what it handed out over the last
+ * DYNAMIC_POOL_RATE_HORIZON rate windows, averaged, and is trimmed by the
+ * refill thread once it holds half as much again.
+ */
+#define DYNAMIC_POOL_RATE_WINDOW_MS 100
+#define DYNAMIC_POOL_RATE_HORIZON 10
+#define DYNAMIC_POOL_RATE_MAX_IDLE_WINDOWS 64
+#define DYNAMIC_POOL_TRIM_INTERVAL_MS 1000
+
+static bool adaptive_fillmark;
+module_param(adaptive_fillmark, bool, 0644);
+MODULE_PARM_DESC(adaptive_fillmark, "Size the page pool fillmarks from the recent allocation rate");
+
+static unsigned int fillmark_min_mb = 8;
+module_param(fillmark_min_mb, uint, 0644);
+MODULE_PARM_DESC(fillmark_min_mb, "Lower bound of an adaptive page pool fillmark, in MB");
+
+static unsigned int fillmark_max_mb = DYNAMIC_POOL_FILL_MARK / SZ_1M;
+module_param(fillmark_max_mb, uint, 0644);
+MODULE_PARM_DESC(fillmark_max_mb, "Upper bound of an adaptive page pool fillmark, in MB");
+
+static void dynamic_pool_account_alloc(struct dynamic_page_pool *pool, int nr)
+{
+	atomic_add(nr, &pool->nr_allocated);
+}
+
+/* Fold the allocations of every rate window that has elapsed into the average */
+static void dynamic_pool_update_rate(struct dynamic_page_pool *pool)
+{
+	ktime_t now = ktime_get();
+	unsigned long flags;
+	s64 windows;
+
+	if (ktime_ms_delta(now, pool->rate_window_start) < DYNAMIC_POOL_RATE_WINDOW_MS)
+		return;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	windows = ktime_ms_delta(now, pool->rate_window_start) / DYNAMIC_POOL_RATE_WINDOW_MS;
+	if (windows > 0) {
+		windows = min_t(s64, windows, DYNAMIC_POOL_RATE_MAX_IDLE_WINDOWS);
+		ewma_dynamic_pool_rate_add(&pool->alloc_rate,
+					   atomic_xchg(&pool->nr_allocated, 0));
+		while (--windows)
+			ewma_dynamic_pool_rate_add(&pool->alloc_rate, 0);
+		pool->rate_window_start = now;
+	}
+	spin_unlock_irqrestore(&pool->lock, flags);
+}
+
 static int get_dynamic_pool_fillmark(struct dynamic_page_pool *pool)
 {
-	return DYNAMIC_POOL_FILL_MARK / (PAGE_SIZE << pool->order);
+	unsigned long item_size = PAGE_SIZE << pool->order;
+	unsigned long min_items, max_items, target;
+	int reserve = atomic_read(&pool->reserve);
+
+	if (!READ_ONCE(adaptive_fillmark)) {
+		WRITE_ONCE(pool->fillmark, reserve);
+		return DYNAMIC_POOL_FILL_MARK / item_size + reserve;
+	}
+
+	dynamic_pool_update_rate(pool);
+
+	min_items = ((unsigned long)READ_ONCE(fillmark_min_mb) * SZ_1M) / item_size;
+	max_items = ((unsigned long)READ_ONCE(fillmark_max_mb) * SZ_1M) / item_size;
+	target = ewma_dynamic_pool_rate_read(&pool->alloc_rate) * DYNAMIC_POOL_RATE_HORIZON;
+	target = clamp(target, min_items, max(min_items, max_items)) + reserve;
+
+	WRITE_ONCE(pool->fillmark, target);
+	return target;
 }
 
 static bool dynamic_pool_fillmark_reached(struct dynamic_page_pool *pool)
@@ -80,7 +158,7 @@ static bool dynamic_pool_fillmark_reached(struct dynamic_page_pool *pool)
 
 static int get_dynamic_pool_lowmark(struct dynamic_page_pool *pool)
 {
-	return DYNAMIC_POOL_LOW_MARK / (PAGE_SIZE << pool->order);
+	return (get_dynamic_pool_fillmark(pool) * DYNAMIC_POOL_LOW_MARK_PERCENT) / 100;
 }
 
 static bool dynamic_pool_count_below_lowmark(struct dynamic_page_pool *pool)
@@ -88,6 +166,135 @@ static bool dynamic_pool_count_below_lowmark(struct dynamic_page_pool *pool)
 	return atomic_read(&pool->count) < get_dynamic_pool_lowmark(pool);
 }
 
+/*
+ * Give back what an adaptive pool holds well above its target. Returns true
+ * while the target may still decay, so the caller knows to check again.
+ */
+static bool dynamic_pool_trim(struct dynamic_page_pool *pool)
+{
+	struct dynamic_page_pool *pools[] = { pool };
+	int fillmark, count;
+
+	if (!READ_ONCE(adaptive_fillmark))
+		return false;
+
+	fillmark = get_dynamic_pool_fillmark(pool);
+	count = atomic_read(&pool->count);
+	if (count > fillmark + fillmark / 2)
+		dynamic_page_pool_shrink_high_and_low(pools, 1,
+						      (count - fillmark) << pool->order);
+
+	return ewma_dynamic_pool_rate_read(&pool->alloc_rate) &&
+	       atomic_read(&pool->count) > fillmark;
+}
+
+static int dynamic_pool_targets_get(char *buf, const struct kernel_param *kp)
+{
+	struct qcom_system_heap *sys_heap;
+	struct dynamic_page_pool *pool;
+	int i, len = 0;
+
+	list_for_each_entry(sys_heap, &system_heaps, list) {
+		for (i = 0; i < NUM_ORDERS; i++) {
+			unsigned long item_kb;
+
+			pool = sys_heap->pool_list[i];
+			item_kb = (PAGE_SIZE << pool->order) / SZ_1K;
+			len += scnprintf(buf + len, PAGE_SIZE - len,
+					 "%s order %u: fillmark %lu KB lowmark %lu KB count %lu KB rate %lu KB/s\n",
+					 sys_heap->name, pool->order,
+					 get_dynamic_pool_fillmark(pool) * item_kb,
+					 get_dynamic_pool_lowmark(pool) * item_kb,
+					 atomic_read(&pool->count) * item_kb,
+					 ewma_dynamic_pool_rate_read(&pool->alloc_rate) * item_kb *
+					 (MSEC_PER_SEC / DYNAMIC_POOL_RATE_WINDOW_MS));
+		}
+	}
+
+	return len;
+}
+
+/*
+ * Bytes the system heaps may be asked to hold on behalf of prefetch requests,
+ * as a fraction of total RAM.
+ */
+#define SYSTEM_HEAP_PREFETCH_MAX_DIVISOR 4
+
+static unsigned long system_heap_reserved_bytes(void)
+{
+	struct qcom_system_heap *sys_heap;
+	unsigned long bytes = 0;
+	int i;
+
+	list_for_each_entry(sys_heap, &system_heaps, list)
+		for (i = 0; i < NUM_ORDERS; i++)
+			bytes += (unsigned long)atomic_read(&sys_heap->pool_list[i]->reserve) <<
+				 (PAGE_SHIFT + orders[i]);
+
+	return bytes;
+}
+
+/*
+ * Split len into the largest items that fit and move the pools' reserves
+ * accordingly. Order-0 pools are never refilled, so any remainder is rounded
+ * up to the smallest non-zero order. Growing a reserve only raises the target
+ * the refill thread works towards; shrinking it also gives back whatever the
+ * pool now holds above its target.
+ */
+static int system_heap_resize(struct qcom_system_heap *sys_heap, unsigned long len,
+			      bool shrink)
+{
+	unsigned long limit = (totalram_pages() << PAGE_SHIFT) / SYSTEM_HEAP_PREFETCH_MAX_DIVISOR;
+	struct dynamic_page_pool *pool;
+	int i, nr, excess;
+
+	if (!sys_heap->pool_list[0]->refill_worker)
+		return -EOPNOTSUPP;
+
+	if (!shrink && system_heap_reserved_bytes() + len > limit)
+		return -ENOMEM;
+
+	for (i = 0; i < NUM_ORDERS && orders[i] && len; i++) {
+		unsigned int shift = PAGE_SHIFT + orders[i];
+
+		pool = sys_heap->pool_list[i];
+		if (i + 1 == NUM_ORDERS || !orders[i + 1])
+			nr = DIV_ROUND_UP(len, 1UL << shift);
+		else
+			nr = len >> shift;
+		if (!nr)
+			continue;
+		len -= min(len, (unsigned long)nr << shift);
+
+		if (!shrink) {
+			atomic_add(nr, &pool->reserve);
+			continue;
+		}
+
+		nr = min(nr, atomic_read(&pool->reserve));
+		atomic_sub(nr, &pool->reserve);
+
+		excess = atomic_read(&pool->count) - get_dynamic_pool_fillmark(pool);
+		if (excess > 0) {
+			struct dynamic_page_pool *pools[] = { pool };
+
+			dynamic_page_pool_shrink_high_and_low(pools, 1,
+							      min(nr, excess) << pool->order);
+		}
+	}
+
+	if (!shrink)
+		wake_up_process(sys_heap->pool_list[0]->refill_worker);
+
+	return 0;
+}
+
+static const struct kernel_param_ops dynamic_pool_targets_ops = {
+	.get = dynamic_pool_targets_get,
+};
+module_param_cb(fillmark_targets, &dynamic_pool_targets_ops, NULL, 0444);
+MODULE_PARM_DESC(fillmark_targets, "Current page pool fill targets of each system heap");
+
 /* Based on gfp_zone() in mm/mmzone.c since it is not exported. */
 enum zone_type dynamic_pool_gfp_zone(gfp_t flags)
 {
@@ -234,15 +441,54 @@ static bool dynamic_pool_needs_refill(struct dynamic_page_pool *pool)
 	return pool->order && dynamic_pool_count_below_lowmark(pool);
 }
 
+static void dynamic_page_pool_zero_page(struct page *page, unsigned int order)
+{
+	int i;
+
+	for (i = 0; i < (1 << order); i++)
+		clear_highpage(nth_page(page, i));
+}
+
+/*
+ * Zero the items freed into the pool's dirty list and make them available
+ * for allocation. This runs at the refill thread's reduced priority, so it
+ * mostly happens when nothing more important wants the CPU.
+ */
+static void dynamic_page_pool_zero_dirty(struct dynamic_page_pool *pool)
+{
+	struct page *page;
+	ktime_t start;
+
+	while ((page = dynamic_page_pool_remove_dirty(pool))) {
+		start = ktime_get();
+		dynamic_page_pool_zero_page(page, pool->order);
+		pool->zero_time_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+		pool->nr_zeroed++;
+
+		dynamic_page_pool_add(pool, page);
+		cond_resched();
+	}
+}
+
+static bool system_heap_defer_zeroing(struct qcom_system_heap *sys_heap)
+{
+	return !!sys_heap->pool_list[0]->refill_worker;
+}
+
 static int system_heap_refill_worker(void *data)
 {
 	struct dynamic_page_pool **pool_list = data;
+	bool recheck;
 	int i;
 
 	for (;;) {
+		recheck = false;
 		for (i = 0; i < NUM_ORDERS; i++) {
+			if (READ_ONCE(pool_list[i]->dirty_count))
+				dynamic_page_pool_zero_dirty(pool_list[i]);
 			if (dynamic_pool_count_below_lowmark(pool_list[i]))
 				dynamic_page_pool_refill(pool_list[i]);
+			recheck |= dynamic_pool_trim(pool_list[i]);
 		}
 
 		set_current_state(TASK_INTERRUPTIBLE);
@@ -250,7 +496,8 @@ static int system_heap_refill_worker(void *data)
 			set_current_state(TASK_RUNNING);
 			break;
 		}
-		schedule();
+		schedule_timeout(recheck ? msecs_to_jiffies(DYNAMIC_POOL_TRIM_INTERVAL_MS) :
+				 MAX_SCHEDULE_TIMEOUT);
 
 		set_current_state(TASK_RUNNING);
 	}
@@ -292,11 +539,26 @@ static void system_heap_destroy_refill_worker(struct qcom_system_heap *sys_heap)
 	kthread_stop(sys_heap->pool_list[0]->refill_worker);
 }
 #else
+static void dynamic_pool_account_alloc(struct dynamic_page_pool *pool, int nr)
+{
+}
+
+static int system_heap_resize(struct qcom_system_heap *sys_heap, unsigned long len,
+			      bool shrink)
+{
+	return -EOPNOTSUPP;
+}
+
 static bool dynamic_pool_needs_refill(struct dynamic_page_pool *pool)
 {
 	return false;
 }
 
+static bool system_heap_defer_zeroing(struct qcom_system_heap *sys_heap)
+{
+	return false;
+}
+
 static int system_heap_create_refill_worker(struct qcom_system_heap *sys_heap, const char *name)
 {
 	return 0;
@@ -346,17 +608,29 @@ void qcom_system_heap_free(struct qcom_sg_buffer *buffer)
 	struct qcom_system_heap *sys_heap;
 	struct sg_table *table;
 	struct scatterlist *sg;
+	bool defer_zeroing;
 	int i, j;
 
 	sys_heap = dma_heap_get_drvdata(buffer->heap);
 	table = &buffer->sg_table;
 
-	/* Zero the buffer pages before adding back to the pool */
-	system_heap_zero_buffer(buffer);
+	/*
+	 * Zero the buffer pages before adding back to the pool, or leave that
+	 * to the refill thread so the last dma-buf reference drop stays cheap.
+	 */
+	defer_zeroing = system_heap_defer_zeroing(sys_heap);
+	if (!defer_zeroing)
+		system_heap_zero_buffer(buffer);
 
 	for_each_sg(table->sgl, sg, table->nents, i) {
 		struct page *page = sg_page(sg);
 
+		/* Contiguous runs are the only entries larger than their page */
+		if (IS_ENABLED(CONFIG_CMA) && sys_heap->cma && sg->length > page_size(page)) {
+			cma_release(sys_heap->cma, page, sg->length >> PAGE_SHIFT);
+			continue;
+		}
+
 		for (j = 0; j < NUM_ORDERS; j++) {
 			if (compound_order(page) == orders[j])
 				break;
@@ -367,12 +641,17 @@ void qcom_system_heap_free(struct qcom_sg_buffer *buffer)
 			/* Unpin the page before freeing page back to buddy */
 			put_page(page);
 			__free_pages(page, compound_order(page));
+		} else if (defer_zeroing) {
+			dynamic_page_pool_add_dirty(sys_heap->pool_list[j], page);
 		} else {
 			dynamic_page_pool_free(sys_heap->pool_list[j], page);
 		}
 	}
 	sg_free_table(table);
 	kfree(buffer);
+
+	if (defer_zeroing)
+		wake_up_process(sys_heap->pool_list[0]->refill_worker);
 }
 
 struct page *qcom_sys_heap_alloc_largest_available(struct dynamic_page_pool **pools,
@@ -384,25 +663,18 @@ struct page *qcom_sys_heap_alloc_largest_available(struct dynamic_page_pool **po
 	int i;
 
 	for (i = 0; i < NUM_ORDERS; i++) {
-		unsigned long flags;
-
 		if (size <  (PAGE_SIZE << orders[i]))
 			continue;
 		if (max_order < orders[i])
 			continue;
 
-		spin_lock_irqsave(&pools[i]->lock, flags);
-		if (pools[i]->high_count)
-			page = dynamic_page_pool_remove(pools[i], true);
-		else if (pools[i]->low_count)
-			page = dynamic_page_pool_remove(pools[i], false);
-		spin_unlock_irqrestore(&pools[i]->lock, flags);
-
+		page = dynamic_page_pool_alloc(pools[i]);
 		if (!page)
 			page = alloc_pages(pools[i]->gfp_mask, pools[i]->order);
 		if (!page)
 			continue;
 
+		dynamic_pool_account_alloc(pools[i], 1);
 		if (dynamic_pool_needs_refill(pools[i]))
 			wake_up_process(pools[i]->refill_worker);
 
@@ -411,6 +683,130 @@ struct page *qcom_sys_heap_alloc_largest_available(struct dynamic_page_pool **po
 	return NULL;
 }
 
+/*
+ * Append up to nr_items pages of the pool's order to @pages. Pages are taken
+ * from the pool in a single critical section and, once it runs dry, from
+ * buddy, using the bulk allocator for order-0 pages.
+ */
+static int qcom_sys_heap_alloc_bulk(struct dynamic_page_pool *pool,
+				    int nr_items,
+				    struct list_head *pages)
+{
+	struct page *page;
+	LIST_HEAD(bulk);
+	int nr;
+
+	nr = dynamic_page_pool_alloc_bulk(pool, nr_items, pages);
+
+	/* __alloc_pages_bulk() adds to the head of the list, keep our order */
+	if (nr < nr_items && !pool->order) {
+		nr += alloc_pages_bulk_list(pool->gfp_mask, nr_items - nr, &bulk);
+		list_splice_tail(&bulk, pages);
+	}
+
+	while (nr < nr_items) {
+		if (fatal_signal_pending(current))
+			break;
+
+		page = alloc_pages(pool->gfp_mask, pool->order);
+		if (!page)
+			break;
+
+		list_add_tail(&page->lru, pages);
+		nr++;
+	}
+
+	dynamic_pool_account_alloc(pool, nr);
+	if (dynamic_pool_needs_refill(pool))
+		wake_up_process(pool->refill_worker);
+
+	return nr;
+}
+
+/*
+ * Take as much of size_remaining as possible from the heap's CMA region, in
+ * physically contiguous, naturally aligned runs the IOMMU can map with block
+ * descriptors. The run length is stashed in page->private until the sg_table
+ * is built.
+ */
+static int system_heap_alloc_contig(struct qcom_system_heap *sys_heap,
+				    unsigned long *size_remaining,
+				    struct list_head *pages)
+{
+	unsigned long run, count;
+	struct page *page;
+	int i, j, nr = 0;
+
+	if (!IS_ENABLED(CONFIG_CMA) || !sys_heap->cma)
+		return 0;
+
+	for (i = 0; i < ARRAY_SIZE(contig_run_sizes); i++) {
+		run = contig_run_sizes[i];
+		count = run >> PAGE_SHIFT;
+
+		while (*size_remaining >= run) {
+			if (fatal_signal_pending(current))
+				return nr;
+
+			page = cma_alloc(sys_heap->cma, count, get_order(run), true);
+			if (!page)
+				break;
+
+			for (j = 0; j < count; j++)
+				clear_highpage(nth_page(page, j));
+
+			set_page_private(page, run);
+			list_add_tail(&page->lru, pages);
+			*size_remaining -= run;
+			nr++;
+		}
+	}
+
+	return nr;
+}
+
+static unsigned long system_heap_page_len(struct page *page)
+{
+	return page_private(page) ? page_private(page) : page_size(page);
+}
+
+static void system_heap_free_page(struct qcom_system_heap *sys_heap, struct page *page)
+{
+	if (IS_ENABLED(CONFIG_CMA) && page_private(page)) {
+		unsigned long count = page_private(page) >> PAGE_SHIFT;
+
+		set_page_private(page, 0);
+		cma_release(sys_heap->cma, page, count);
+		return;
+	}
+
+	/* Unpin the memory first if it was borrowed from movable zone */
+	if (is_zone_movable_page(page))
+		put_page(page);
+	__free_pages(page, compound_order(page));
+}
+
+/* Bucket each sg entry by the largest granule it can be mapped with */
+static void system_heap_account_granules(struct qcom_system_heap *sys_heap,
+					 struct sg_table *table)
+{
+	struct scatterlist *sg;
+	int i, g;
+
+	for_each_sgtable_sg(table, sg, i) {
+		for (g = 0; g < SYSTEM_HEAP_NR_GRANULES - 1; g++) {
+			if (IS_ALIGNED(sg_phys(sg), granules[g]) &&
+			    IS_ALIGNED(sg->length, granules[g]))
+				break;
+		}
+
+		atomic64_inc(&sys_heap->granule_entries[g]);
+		atomic64_add(sg->length, &sys_heap->granule_bytes[g]);
+	}
+
+	atomic64_inc(&sys_heap->nr_buffers);
+}
+
 int system_qcom_sg_buffer_alloc(struct dma_heap *heap,
 				struct qcom_sg_buffer *buffer,
 				unsigned long len,
@@ -418,16 +814,17 @@ int system_qcom_sg_buffer_alloc(struct dma_heap *heap,
 {
 	struct qcom_system_heap *sys_heap;
 	unsigned long size_remaining = len;
-	unsigned int max_order = orders[0];
 	struct sg_table *table;
 	struct scatterlist *sg;
 	struct list_head pages;
 	struct page *page, *tmp_page;
-	int i, ret = -ENOMEM;
+	int i, o, ret = -ENOMEM;
 
 	sys_heap = dma_heap_get_drvdata(heap);
 
 	INIT_LIST_HEAD(&buffer->attachments);
+	INIT_LIST_HEAD(&buffer->map_cache);
+	INIT_LIST_HEAD(&buffer->mapped_node);
 	mutex_init(&buffer->lock);
 	buffer->heap = heap;
 	buffer->len = len;
@@ -435,8 +832,11 @@ int system_qcom_sg_buffer_alloc(struct dma_heap *heap,
 	buffer->free = qcom_system_heap_free;
 
 	INIT_LIST_HEAD(&pages);
-	i = 0;
-	while (size_remaining > 0) {
+	i = system_heap_alloc_contig(sys_heap, &size_remaining, &pages);
+	for (o = 0; o < NUM_ORDERS && size_remaining > 0; o++) {
+		unsigned int shift = PAGE_SHIFT + orders[o];
+		int nr;
+
 		/*
 		 * Avoid trying to allocate memory if the process
 		 * has been killed by SIGKILL
@@ -444,30 +844,32 @@ int system_qcom_sg_buffer_alloc(struct dma_heap *heap,
 		if (fatal_signal_pending(current))
 			goto free_mem;
 
-		page = qcom_sys_heap_alloc_largest_available(sys_heap->pool_list,
-							     size_remaining,
-							     max_order,
-							     movable);
-		if (!page)
-			goto free_mem;
+		if (!(size_remaining >> shift))
+			continue;
 
-		list_add_tail(&page->lru, &pages);
-		size_remaining -= page_size(page);
-		max_order = compound_order(page);
-		i++;
+		nr = qcom_sys_heap_alloc_bulk(sys_heap->pool_list[o],
+					      size_remaining >> shift, &pages);
+		size_remaining -= (unsigned long)nr << shift;
+		i += nr;
 	}
 
+	if (size_remaining)
+		goto free_mem;
+
 	table = &buffer->sg_table;
 	if (sg_alloc_table(table, i, GFP_KERNEL))
 		goto free_mem;
 
 	sg = table->sgl;
 	list_for_each_entry_safe(page, tmp_page, &pages, lru) {
-		sg_set_page(sg, page, page_size(page), 0);
+		sg_set_page(sg, page, system_heap_page_len(page), 0);
+		set_page_private(page, 0);
 		sg = sg_next(sg);
 		list_del(&page->lru);
 	}
 
+	system_heap_account_granules(sys_heap, table);
+
 	/*
 	 * For uncached buffers, we need to initially flush cpu cache, since
 	 * the __GFP_ZERO on the allocation means the zeroing was done by the
@@ -482,12 +884,8 @@ int system_qcom_sg_buffer_alloc(struct dma_heap *heap,
 	return 0;
 
 free_mem:
-	list_for_each_entry_safe(page, tmp_page, &pages, lru) {
-		/* Unpin the memory first if it was borrowed from movable zone */
-		if (is_zone_movable_page(page))
-			put_page(page);
-		__free_pages(page, compound_order(page));
-	}
+	list_for_each_entry_safe(page, tmp_page, &pages, lru)
+		system_heap_free_page(sys_heap, page);
 
 	return ret;
 }
@@ -540,11 +938,103 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 	return ERR_PTR(ret);
 }
 
+static int __qcom_system_heap_resize(struct dma_buf_heap_prefetch_region *regions,
+				     size_t nr_regions, bool shrink)
+{
+	struct qcom_system_heap *sys_heap;
+	int i, ret;
+
+	if (!regions)
+		return -EINVAL;
+
+	for (i = 0; i < nr_regions; i++) {
+		list_for_each_entry(sys_heap, &system_heaps, list)
+			if (sys_heap == dma_heap_get_drvdata(regions[i].heap))
+				break;
+
+		if (list_entry_is_head(sys_heap, &system_heaps, list)) {
+			pr_err("%s: %s is not a system heap!\n", __func__,
+			       dma_heap_get_name(regions[i].heap));
+			return -EINVAL;
+		}
+
+		ret = system_heap_resize(sys_heap, PAGE_ALIGN(regions[i].size), shrink);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+int qcom_system_heap_prefetch(struct dma_buf_heap_prefetch_region *regions,
+			      size_t nr_regions)
+{
+	return __qcom_system_heap_resize(regions, nr_regions, false);
+}
+EXPORT_SYMBOL_GPL(qcom_system_heap_prefetch);
+
+int qcom_system_heap_drain(struct dma_buf_heap_prefetch_region *regions,
+			   size_t nr_regions)
+{
+	return __qcom_system_heap_resize(regions, nr_regions, true);
+}
+EXPORT_SYMBOL_GPL(qcom_system_heap_drain);
+
+static int system_heap_prefetch(struct dma_heap *heap, unsigned long len)
+{
+	struct dma_buf_heap_prefetch_region region = { .size = len, .heap = heap };
+
+	return qcom_system_heap_prefetch(&region, 1);
+}
+
+static int system_heap_drain(struct dma_heap *heap, unsigned long len)
+{
+	struct dma_buf_heap_prefetch_region region = { .size = len, .heap = heap };
+
+	return qcom_system_heap_drain(&region, 1);
+}
+
 static const struct dma_heap_ops system_heap_ops = {
 	.allocate = system_heap_allocate,
+	.prefetch = system_heap_prefetch,
+	.drain = system_heap_drain,
 };
 
-void qcom_system_heap_create(const char *name, const char *system_alias, bool uncached)
+#ifdef CONFIG_DEBUG_FS
+static int system_heap_granules_show(struct seq_file *s, void *unused)
+{
+	struct qcom_system_heap *sys_heap = s->private;
+	int g;
+
+	seq_printf(s, "buffers: %lld\n", atomic64_read(&sys_heap->nr_buffers));
+	seq_printf(s, "%10s %12s %16s\n", "granule", "entries", "bytes");
+	for (g = 0; g < SYSTEM_HEAP_NR_GRANULES; g++)
+		seq_printf(s, "%9luK %12lld %16lld\n", granules[g] / SZ_1K,
+			   atomic64_read(&sys_heap->granule_entries[g]),
+			   atomic64_read(&sys_heap->granule_bytes[g]));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(system_heap_granules);
+
+static void system_heap_debugfs_add(struct qcom_system_heap *sys_heap)
+{
+	static struct dentry *root;
+
+	if (!root)
+		root = debugfs_create_dir("qcom_system_heap", NULL);
+
+	debugfs_create_file(sys_heap->name, 0400, root, sys_heap,
+			    &system_heap_granules_fops);
+}
+#else
+static inline void system_heap_debugfs_add(struct qcom_system_heap *sys_heap)
+{
+}
+#endif
+
+static int __qcom_system_heap_create(const char *name, const char *system_alias,
+				     bool uncached, struct cma *cma)
 {
 	struct dma_heap_export_info exp_info;
 	struct dma_heap *heap;
@@ -566,6 +1056,7 @@ void qcom_system_heap_create(const char *name, const char *system_alias, bool un
 	exp_info.priv = sys_heap;
 
 	sys_heap->uncached = uncached;
+	sys_heap->cma = cma;
 
 	sys_heap->pool_list = dynamic_page_pool_create_pools(0, NULL);
 	if (IS_ERR(sys_heap->pool_list)) {
@@ -587,6 +1078,10 @@ void qcom_system_heap_create(const char *name, const char *system_alias, bool un
 		dma_coerce_mask_and_coherent(dma_heap_get_dev(heap),
 					     DMA_BIT_MASK(64));
 
+	sys_heap->name = name;
+	list_add_tail(&sys_heap->list, &system_heaps);
+	system_heap_debugfs_add(sys_heap);
+
 	pr_info("%s: DMA-BUF Heap: Created '%s'\n", __func__, name);
 
 	if (system_alias != NULL) {
@@ -596,7 +1091,7 @@ void qcom_system_heap_create(const char *name, const char *system_alias, bool un
 		if (IS_ERR(heap)) {
 			pr_err("%s: Failed to create '%s', error is %ld\n", __func__,
 			       system_alias, PTR_ERR(heap));
-			return;
+			return 0;
 		}
 
 		dma_coerce_mask_and_coherent(dma_heap_get_dev(heap), DMA_BIT_MASK(64));
@@ -604,7 +1099,7 @@ void qcom_system_heap_create(const char *name, const char *system_alias, bool un
 		pr_info("%s: DMA-BUF Heap: Created '%s'\n", __func__, system_alias);
 	}
 
-	return;
+	return 0;
 
 stop_worker:
 	system_heap_destroy_refill_worker(sys_heap);
@@ -617,4 +1112,26 @@ void qcom_system_heap_create(const char *name, const char *system_alias, bool un
 
 out:
 	pr_err("%s: Failed to create '%s', error is %d\n", __func__, name, ret);
+	return ret;
+}
+
+void qcom_system_heap_create(const char *name, const char *system_alias, bool uncached)
+{
+	__qcom_system_heap_create(name, system_alias, uncached, NULL);
+}
+
+/*
+ * Create a system heap that prefers physically contiguous runs out of the
+ * CMA region of heap_data, for clients whose IOMMU mappings benefit from
+ * block descriptors.
+ */
+int qcom_system_heap_create_contig(struct platform_heap *heap_data)
+{
+	if (!IS_ENABLED(CONFIG_CMA) || !heap_data->dev->cma_area) {
+		pr_err("%s: CMA area for device uninitialized!\n", __func__);
+		return -EINVAL;
+	}
+
+	return __qcom_system_heap_create(heap_data->name, NULL, heap_data->is_uncached,
+					 heap_data->dev->cma_area);
 }
@@ -11,15 +11,44 @@
 #include <linux/err.h>
 #include "qcom_sg_ops.h"
 #include "qcom_dynamic_page_pool.h"
+#include "qcom_dt_parser.h"
 #include "qcom_sg_ops.h"
 
+/*
+ * Granules, from largest to smallest, used to bucket the sg entries of the
+ * system heap buffers.
+ */
+#define SYSTEM_HEAP_NR_GRANULES 4
+
+struct cma;
+
+/**
+ * struct qcom_system_heap - system heap private data
+ * @uncached:		whether the heap hands out uncached buffers
+ * @pool_list:		page pools, one per entry of orders[]
+ * @name:		name of the heap
+ * @list:		node in the list of system heaps
+ * @cma:		optional CMA region physically contiguous runs are
+ *			tried from before falling back to the page pools
+ * @nr_buffers:		number of buffers allocated so far
+ * @granule_entries:	histogram of the sg entries of those buffers, by the
+ *			largest granule each entry can be mapped with
+ * @granule_bytes:	same histogram, in bytes
+ */
 struct qcom_system_heap {
 	int uncached;
 	struct dynamic_page_pool **pool_list;
+	const char *name;
+	struct list_head list;
+	struct cma *cma;
+	atomic64_t nr_buffers;
+	atomic64_t granule_entries[SYSTEM_HEAP_NR_GRANULES];
+	atomic64_t granule_bytes[SYSTEM_HEAP_NR_GRANULES];
 };
 
 #ifdef CONFIG_QCOM_DMABUF_HEAPS_SYSTEM
 void qcom_system_heap_create(const char *name, const char *system_alias, bool uncached);
+int qcom_system_heap_create_contig(struct platform_heap *heap_data);
 void qcom_system_heap_free(struct qcom_sg_buffer *buffer);
 struct page *qcom_sys_heap_alloc_largest_available(struct dynamic_page_pool **pools,
 						   unsigned long size,
@@ -38,6 +67,10 @@ static inline void qcom_system_heap_create(const char *name, const char *system_
 					   bool uncached)
 {
 
+}
+static inline int qcom_system_heap_create_contig(struct platform_heap *heap_data)
+{
+	return -EOPNOTSUPP;
 }
 static inline void qcom_system_heap_free(struct qcom_sg_buffer *buffer)
 {
@@ -0,0 +1,62 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Copyright (c) 2022-2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM qcom_sg
+
+#if !defined(_TRACE_QCOM_SG_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_QCOM_SG_H
+#include <linux/types.h>
+#include <linux/tracepoint.h>
+#include <linux/device.h>
+#include <linux/dma-buf.h>
+
+DECLARE_EVENT_CLASS(qcom_sg_map_cache_class,
+
+	TP_PROTO(struct dma_buf *dmabuf, struct device *dev),
+
+	TP_ARGS(dmabuf, dev),
+
+	TP_STRUCT__entry(
+		__field(unsigned long, ino)
+		__field(size_t, size)
+		__string(dev_name, dev_name(dev))
+	),
+
+	TP_fast_assign(
+		__entry->ino = file_inode(dmabuf->file)->i_ino;
+		__entry->size = dmabuf->size;
+		__assign_str(dev_name, dev_name(dev));
+	),
+
+	TP_printk("ino: %lu size: 0x%lx dev: %s",
+		  __entry->ino, __entry->size, __get_str(dev_name)
+	)
+);
+
+DEFINE_EVENT(qcom_sg_map_cache_class, qcom_sg_map_cache_hit,
+
+	TP_PROTO(struct dma_buf *dmabuf, struct device *dev),
+
+	TP_ARGS(dmabuf, dev)
+);
+
+DEFINE_EVENT(qcom_sg_map_cache_class, qcom_sg_map_cache_miss,
+
+	TP_PROTO(struct dma_buf *dmabuf, struct device *dev),
+
+	TP_ARGS(dmabuf, dev)
+);
+
+#endif /* _TRACE_QCOM_SG_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH ../../drivers/dma-buf/heaps
+
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE trace-qcom-sg
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -9,6 +9,7 @@
 #include <linux/dma-fence-chain.h>
 #include <linux/kernel.h>
 #include <linux/kthread.h>
+#include <linux/ktime.h>
 #include <linux/mm.h>
 #include <linux/sched/signal.h>
 #include <linux/slab.h>
@@ -439,6 +440,88 @@ static int __find_race(void *arg)
 	return err;
 }
 
+static int find_long(void *arg)
+{
+	struct fence_chains fc;
+	struct dma_fence *fence;
+	ktime_t start, elapsed;
+	int err;
+	int i;
+
+	err = fence_chains_init(&fc, CHAIN_SZ, seqno_inc);
+	if (err)
+		return err;
+
+	start = ktime_get();
+	for (i = 0; i < fc.chain_length; i++) {
+		fence = dma_fence_get(fc.tail);
+		err = dma_fence_chain_find_seqno(&fence, i + 1);
+		dma_fence_put(fence);
+		if (err) {
+			pr_err("Reported %d for find_seqno(%d:%d)!\n",
+			       err, fc.chain_length + 1, i + 1);
+			goto err;
+		}
+		if (fence != fc.chains[i]) {
+			pr_err("Incorrect fence.seqno:%lld reported by find_seqno(%d:%d)\n",
+			       fence ? fence->seqno : 0,
+			       fc.chain_length + 1, i + 1);
+			err = -EINVAL;
+			goto err;
+		}
+	}
+	elapsed = ktime_sub(ktime_get(), start);
+
+	pr_info("%s: %u lookups from the tail of %u pending points in %lluns (%lluns each)\n",
+		__func__, fc.chain_length, fc.chain_length,
+		ktime_to_ns(elapsed),
+		div_u64(ktime_to_ns(elapsed), fc.chain_length));
+
+	/*
+	 * With every other point signaled, the fence found may be an earlier
+	 * one, as signaled nodes get garbage collected, but waiting on it must
+	 * still cover the point asked for.
+	 */
+	for (i = 0; i < fc.chain_length; i += 2)
+		dma_fence_signal(fc.fences[i]);
+
+	for (i = fc.chain_length; i--; ) {
+		unsigned int j;
+
+		fence = dma_fence_get(fc.tail);
+		err = dma_fence_chain_find_seqno(&fence, i + 1);
+		dma_fence_put(fence);
+		if (err) {
+			pr_err("Reported %d for find_seqno(%d:%d) after signaling!\n",
+			       err, fc.chain_length + 1, i + 1);
+			goto err;
+		}
+		if (!fence)
+			continue;
+
+		if (fence->context != fc.tail->context) {
+			pr_err("Fence from another timeline reported by find_seqno(%d:%d)\n",
+			       fc.chain_length + 1, i + 1);
+			err = -EINVAL;
+			goto err;
+		}
+
+		for (j = fence->seqno; j <= i; j++) {
+			if (!dma_fence_is_signaled(fc.fences[j])) {
+				pr_err("Fence.seqno:%lld reported by find_seqno(%d:%d) does not cover point %d\n",
+				       fence->seqno, fc.chain_length + 1,
+				       i + 1, j + 1);
+				err = -EINVAL;
+				goto err;
+			}
+		}
+	}
+
+err:
+	fence_chains_fini(&fc);
+	return err;
+}
+
 static int find_race(void *arg)
 {
 	struct find_race data;
@@ -681,6 +764,7 @@ int dma_fence_chain(void)
 		SUBTEST(find_signaled),
 		SUBTEST(find_out_of_order),
 		SUBTEST(find_gap),
+		SUBTEST(find_long),
 		SUBTEST(find_race),
 		SUBTEST(signal_forward),
 		SUBTEST(signal_backward),
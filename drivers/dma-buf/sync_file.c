@@ -17,6 +17,7 @@
 #include <linux/anon_inodes.h>
 #include <linux/sync_file.h>
 #include <uapi/linux/sync_file.h>
+#include <uapi/linux/sync_file_batch.h>
 
 static const struct file_operations sync_file_fops;
 
@@ -259,6 +260,173 @@ static long sync_file_ioctl_merge(struct sync_file *sync_file,
 	return err;
 }
 
+/*
+ * Look up the fences of @num_fds sync_file fds from userspace.  Returns an
+ * array the caller releases with sync_file_put_fences(), or an ERR_PTR().
+ */
+static struct dma_fence **sync_file_get_fences(u64 ufds, u32 num_fds)
+{
+	struct dma_fence **fences;
+	s32 __user *fds = u64_to_user_ptr(ufds);
+	int err;
+	u32 i;
+
+	if (!num_fds || num_fds > SYNC_FILE_BATCH_MAX_FDS)
+		return ERR_PTR(-EINVAL);
+
+	fences = kcalloc(num_fds, sizeof(*fences), GFP_KERNEL);
+	if (!fences)
+		return ERR_PTR(-ENOMEM);
+
+	for (i = 0; i < num_fds; i++) {
+		s32 fd;
+
+		if (get_user(fd, &fds[i])) {
+			err = -EFAULT;
+			goto err_put_fences;
+		}
+
+		fences[i] = sync_file_get_fence(fd);
+		if (!fences[i]) {
+			err = -ENOENT;
+			goto err_put_fences;
+		}
+	}
+
+	return fences;
+
+err_put_fences:
+	while (i--)
+		dma_fence_put(fences[i]);
+	kfree(fences);
+	return ERR_PTR(err);
+}
+
+static void sync_file_put_fences(struct dma_fence **fences, u32 num_fds)
+{
+	u32 i;
+
+	for (i = 0; i < num_fds; i++)
+		dma_fence_put(fences[i]);
+	kfree(fences);
+}
+
+static long sync_file_ioctl_merge_array(unsigned long arg)
+{
+	struct sync_merge_array_data data;
+	struct dma_fence_unwrap *cursors;
+	struct dma_fence **fences, **pos;
+	struct sync_file *sync_file;
+	int fd, err;
+
+	if (copy_from_user(&data, (void __user *)arg, sizeof(data)))
+		return -EFAULT;
+
+	if (data.flags || data.pad)
+		return -EINVAL;
+
+	fences = sync_file_get_fences(data.fds, data.num_fds);
+	if (IS_ERR(fences))
+		return PTR_ERR(fences);
+
+	/* The merge reuses the fence array it is given as scratch space: */
+	pos = kmemdup(fences, data.num_fds * sizeof(*fences), GFP_KERNEL);
+	cursors = kcalloc(data.num_fds, sizeof(*cursors), GFP_KERNEL);
+	sync_file = sync_file_alloc();
+	if (!pos || !cursors || !sync_file) {
+		err = -ENOMEM;
+		goto err_free;
+	}
+
+	sync_file->fence = __dma_fence_unwrap_merge(data.num_fds, pos, cursors);
+	if (!sync_file->fence) {
+		err = -ENOMEM;
+		goto err_free;
+	}
+
+	data.name[sizeof(data.name) - 1] = '\0';
+	strscpy(sync_file->user_name, data.name, sizeof(sync_file->user_name));
+
+	fd = get_unused_fd_flags(O_CLOEXEC);
+	if (fd < 0) {
+		err = fd;
+		goto err_free;
+	}
+
+	data.fence = fd;
+	if (copy_to_user((void __user *)arg, &data, sizeof(data))) {
+		put_unused_fd(fd);
+		err = -EFAULT;
+		goto err_free;
+	}
+
+	fd_install(fd, sync_file->file);
+	kfree(cursors);
+	kfree(pos);
+	sync_file_put_fences(fences, data.num_fds);
+	return 0;
+
+err_free:
+	if (sync_file)
+		fput(sync_file->file);
+	kfree(cursors);
+	kfree(pos);
+	sync_file_put_fences(fences, data.num_fds);
+	return err;
+}
+
+static long sync_file_ioctl_wait(unsigned long arg)
+{
+	struct sync_wait_data data;
+	struct dma_fence **fences;
+	signed long timeout;
+	long ret = 0;
+	u32 i;
+
+	if (copy_from_user(&data, (void __user *)arg, sizeof(data)))
+		return -EFAULT;
+
+	if ((data.flags & ~SYNC_WAIT_ANY) || data.pad)
+		return -EINVAL;
+
+	if (data.timeout_ns < 0)
+		timeout = MAX_SCHEDULE_TIMEOUT;
+	else
+		timeout = nsecs_to_jiffies(data.timeout_ns);
+
+	fences = sync_file_get_fences(data.fds, data.num_fds);
+	if (IS_ERR(fences))
+		return PTR_ERR(fences);
+
+	if (data.flags & SYNC_WAIT_ANY) {
+		ret = dma_fence_wait_any_timeout(fences, data.num_fds, true,
+						 timeout, &data.first_signaled);
+	} else {
+		for (i = 0; i < data.num_fds; i++) {
+			ret = dma_fence_wait_timeout(fences[i], true, timeout);
+			if (ret <= 0)
+				break;
+
+			/* Don't turn a poll into a wait for the rest: */
+			if (timeout != MAX_SCHEDULE_TIMEOUT && timeout)
+				timeout = ret;
+		}
+	}
+
+	sync_file_put_fences(fences, data.num_fds);
+
+	if (ret < 0)
+		return ret;
+	if (!ret)
+		return -ETIME;
+
+	if ((data.flags & SYNC_WAIT_ANY) &&
+	    copy_to_user((void __user *)arg, &data, sizeof(data)))
+		return -EFAULT;
+
+	return 0;
+}
+
 static int sync_fill_fence_info(struct dma_fence *fence,
 				 struct sync_fence_info *info)
 {
@@ -359,6 +527,12 @@ static long sync_file_ioctl(struct file *file, unsigned int cmd,
 	case SYNC_IOC_FILE_INFO:
 		return sync_file_ioctl_fence_info(sync_file, arg);
 
+	case SYNC_IOC_MERGE_ARRAY:
+		return sync_file_ioctl_merge_array(arg);
+
+	case SYNC_IOC_WAIT:
+		return sync_file_ioctl_wait(arg);
+
 	default:
 		return -ENOTTY;
 	}
@@ -4,11 +4,13 @@
 #include <linux/dma-buf.h>
 #include <linux/dma-resv.h>
 #include <linux/highmem.h>
+#include <linux/hugetlb.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
 #include <linux/memfd.h>
 #include <linux/miscdevice.h>
 #include <linux/module.h>
+#include <linux/pagemap.h>
 #include <linux/shmem_fs.h>
 #include <linux/slab.h>
 #include <linux/udmabuf.h>
@@ -23,9 +25,22 @@ static int size_limit_mb = 64;
 module_param(size_limit_mb, int, 0644);
 MODULE_PARM_DESC(size_limit_mb, "Max size of a dmabuf, in megabytes. Default is 64.");
 
+/* largest sg entry, as for sg_alloc_table_from_pages() */
+#define UDMABUF_MAX_SEG		(UINT_MAX & PAGE_MASK)
+
+/* pages of a folio in a udmabuf, holding a reference on the folio */
+struct udmabuf_range {
+	struct folio *folio;
+	pgoff_t offset;		/* first page of the range in the folio */
+	pgoff_t pagecount;
+};
+
 struct udmabuf {
 	pgoff_t pagecount;
 	struct page **pages;
+	pgoff_t nr_ranges;
+	pgoff_t max_ranges;
+	struct udmabuf_range *ranges;
 	struct sg_table *sg;
 	struct miscdevice *device;
 };
@@ -83,6 +98,42 @@ static void vunmap_udmabuf(struct dma_buf *buf, struct iosys_map *map)
 	vm_unmap_ram(map->vaddr, ubuf->pagecount);
 }
 
+/*
+ * Fills @sg, if not NULL, with one entry per physically contiguous run of
+ * ranges, that is at most one per folio, and returns the number of entries.
+ */
+static unsigned int udmabuf_fill_sg(struct udmabuf *ubuf, struct sg_table *sg)
+{
+	struct scatterlist *sgl = NULL;
+	unsigned long pfn = 0, len = 0, size;
+	unsigned int nents = 0;
+	struct page *page;
+	pgoff_t i;
+
+	for (i = 0; i < ubuf->nr_ranges; i++) {
+		page = folio_page(ubuf->ranges[i].folio, ubuf->ranges[i].offset);
+		size = ubuf->ranges[i].pagecount << PAGE_SHIFT;
+
+		if (nents && page_to_pfn(page) == pfn + (len >> PAGE_SHIFT) &&
+		    len + size <= UDMABUF_MAX_SEG) {
+			len += size;
+			if (sgl)
+				sgl->length = len;
+			continue;
+		}
+
+		nents++;
+		pfn = page_to_pfn(page);
+		len = size;
+		if (sg) {
+			sgl = sgl ? sg_next(sgl) : sg->sgl;
+			sg_set_page(sgl, page, len, 0);
+		}
+	}
+
+	return nents;
+}
+
 static struct sg_table *get_sg_table(struct device *dev, struct dma_buf *buf,
 				     enum dma_data_direction direction)
 {
@@ -93,11 +144,10 @@ static struct sg_table *get_sg_table(struct device *dev, struct dma_buf *buf,
 	sg = kzalloc(sizeof(*sg), GFP_KERNEL);
 	if (!sg)
 		return ERR_PTR(-ENOMEM);
-	ret = sg_alloc_table_from_pages(sg, ubuf->pages, ubuf->pagecount,
-					0, ubuf->pagecount << PAGE_SHIFT,
-					GFP_KERNEL);
+	ret = sg_alloc_table(sg, udmabuf_fill_sg(ubuf, NULL), GFP_KERNEL);
 	if (ret < 0)
 		goto err;
+	udmabuf_fill_sg(ubuf, sg);
 	ret = dma_map_sgtable(dev, sg, direction, 0);
 	if (ret < 0)
 		goto err;
@@ -134,14 +184,15 @@ static void release_udmabuf(struct dma_buf *buf)
 {
 	struct udmabuf *ubuf = buf->priv;
 	struct device *dev = ubuf->device->this_device;
-	pgoff_t pg;
+	pgoff_t i;
 
 	if (ubuf->sg)
 		put_sg_table(dev, ubuf->sg, DMA_BIDIRECTIONAL);
 
-	for (pg = 0; pg < ubuf->pagecount; pg++)
-		put_page(ubuf->pages[pg]);
-	kfree(ubuf->pages);
+	for (i = 0; i < ubuf->nr_ranges; i++)
+		folio_put(ubuf->ranges[i].folio);
+	kvfree(ubuf->ranges);
+	kvfree(ubuf->pages);
 	kfree(ubuf);
 }
 
@@ -194,6 +245,63 @@ static const struct dma_buf_ops udmabuf_ops = {
 #define SEALS_WANTED (F_SEAL_SHRINK)
 #define SEALS_DENIED (F_SEAL_WRITE)
 
+/*
+ * Returns a reference on the folio of @memfd backing page @pgoff, which is
+ * page @subpgoff of the folio. Huge pages of hugetlbfs must already have
+ * been faulted in or fallocated.
+ */
+static struct folio *udmabuf_get_folio(struct file *memfd, pgoff_t pgoff,
+				       pgoff_t *subpgoff)
+{
+	struct address_space *mapping = memfd->f_mapping;
+	struct folio *folio;
+
+	if (is_file_hugepages(memfd)) {
+		unsigned int order = huge_page_order(hstate_file(memfd));
+
+		/* the hugetlb page cache is indexed in huge pages */
+		folio = __filemap_get_folio(mapping, pgoff >> order,
+					    FGP_ACCESSED, 0);
+		if (IS_ERR(folio))
+			return ERR_PTR(-EINVAL);
+		*subpgoff = pgoff & ((1UL << order) - 1);
+		return folio;
+	}
+
+	folio = shmem_read_folio(mapping, pgoff);
+	if (!IS_ERR(folio))
+		*subpgoff = pgoff - folio->index;
+	return folio;
+}
+
+/* Adds @nr pages of @folio from @subpgoff, taking over its reference */
+static int udmabuf_add_range(struct udmabuf *ubuf, struct folio *folio,
+			     pgoff_t subpgoff, pgoff_t nr, pgoff_t *pgbuf)
+{
+	struct udmabuf_range *range;
+	pgoff_t i;
+
+	if (ubuf->nr_ranges == ubuf->max_ranges) {
+		range = kvrealloc(ubuf->ranges,
+				  ubuf->max_ranges * sizeof(*range),
+				  2 * ubuf->max_ranges * sizeof(*range),
+				  GFP_KERNEL);
+		if (!range)
+			return -ENOMEM;
+		ubuf->ranges = range;
+		ubuf->max_ranges *= 2;
+	}
+
+	range = &ubuf->ranges[ubuf->nr_ranges++];
+	range->folio = folio;
+	range->offset = subpgoff;
+	range->pagecount = nr;
+
+	for (i = 0; i < nr; i++)
+		ubuf->pages[(*pgbuf)++] = folio_page(folio, subpgoff + i);
+	return 0;
+}
+
 static long udmabuf_create(struct miscdevice *device,
 			   struct udmabuf_create_list *head,
 			   struct udmabuf_create_item *list)
@@ -203,8 +311,8 @@ static long udmabuf_create(struct miscdevice *device,
 	struct address_space *mapping = NULL;
 	struct udmabuf *ubuf;
 	struct dma_buf *buf;
-	pgoff_t pgoff, pgcnt, pgidx, pgbuf = 0, pglimit;
-	struct page *page;
+	pgoff_t pgoff, pgcnt, subpgoff, nr, pgbuf = 0, pglimit;
+	struct folio *folio;
 	int seals, ret = -EINVAL;
 	u32 i, flags;
 
@@ -226,9 +334,13 @@ static long udmabuf_create(struct miscdevice *device,
 	if (!ubuf->pagecount)
 		goto err;
 
-	ubuf->pages = kmalloc_array(ubuf->pagecount, sizeof(*ubuf->pages),
-				    GFP_KERNEL);
-	if (!ubuf->pages) {
+	ubuf->pages = kvmalloc_array(ubuf->pagecount, sizeof(*ubuf->pages),
+				     GFP_KERNEL);
+	/* grown as needed, one per item is enough for huge pages */
+	ubuf->max_ranges = head->count;
+	ubuf->ranges = kvmalloc_array(ubuf->max_ranges, sizeof(*ubuf->ranges),
+				      GFP_KERNEL);
+	if (!ubuf->pages || !ubuf->ranges) {
 		ret = -ENOMEM;
 		goto err;
 	}
@@ -240,7 +352,7 @@ static long udmabuf_create(struct miscdevice *device,
 		if (!memfd)
 			goto err;
 		mapping = memfd->f_mapping;
-		if (!shmem_mapping(mapping))
+		if (!shmem_mapping(mapping) && !is_file_hugepages(memfd))
 			goto err;
 		seals = memfd_fcntl(memfd, F_GET_SEALS, 0);
 		if (seals == -EINVAL)
@@ -251,13 +363,23 @@ static long udmabuf_create(struct miscdevice *device,
 			goto err;
 		pgoff = list[i].offset >> PAGE_SHIFT;
 		pgcnt = list[i].size   >> PAGE_SHIFT;
-		for (pgidx = 0; pgidx < pgcnt; pgidx++) {
-			page = shmem_read_mapping_page(mapping, pgoff + pgidx);
-			if (IS_ERR(page)) {
-				ret = PTR_ERR(page);
+		/* look up each folio once, THPs and huge pages as a whole */
+		while (pgcnt) {
+			folio = udmabuf_get_folio(memfd, pgoff, &subpgoff);
+			if (IS_ERR(folio)) {
+				ret = PTR_ERR(folio);
+				goto err;
+			}
+			nr = min3(pgcnt, folio_nr_pages(folio) - subpgoff,
+				  (pgoff_t)UDMABUF_MAX_SEG >> PAGE_SHIFT);
+			ret = udmabuf_add_range(ubuf, folio, subpgoff, nr,
+						&pgbuf);
+			if (ret) {
+				folio_put(folio);
 				goto err;
 			}
-			ubuf->pages[pgbuf++] = page;
+			pgoff += nr;
+			pgcnt -= nr;
 		}
 		fput(memfd);
 		memfd = NULL;
@@ -281,11 +403,12 @@ static long udmabuf_create(struct miscdevice *device,
 	return dma_buf_fd(buf, flags);
 
 err:
-	while (pgbuf > 0)
-		put_page(ubuf->pages[--pgbuf]);
+	while (ubuf->nr_ranges > 0)
+		folio_put(ubuf->ranges[--ubuf->nr_ranges].folio);
 	if (memfd)
 		fput(memfd);
-	kfree(ubuf->pages);
+	kvfree(ubuf->ranges);
+	kvfree(ubuf->pages);
 	kfree(ubuf);
 	return ret;
 }
@@ -38,6 +38,7 @@
 #include <linux/of_irq.h>
 #include <linux/of_dma.h>
 #include <linux/circ_buf.h>
+#include <linux/delay.h>
 #include <linux/clk.h>
 #include <linux/dma/qcom_bam_dma.h>
 #include <linux/dmaengine.h>
@@ -337,6 +338,7 @@ static const struct reg_offset_data bam_v1_7_reg_info[] = {
 #define P_ERR_EN		BIT(4)
 #define P_TRNSFR_END_EN		BIT(5)
 #define P_DEFAULT_IRQS_EN	(P_PRCSD_DESC_EN | P_ERR_EN | P_TRNSFR_END_EN)
+#define P_MODERATED_IRQS_EN	(P_PRCSD_DESC_EN | P_ERR_EN)
 
 /* BAM_P_SW_OFSTS */
 #define P_SW_OFSTS_MASK		0xffff
@@ -372,6 +374,7 @@ struct bam_chan {
 	unsigned int initialized;	/* is the channel hw initialized? */
 	unsigned int paused;		/* is the channel paused? */
 	unsigned int reconfigure;	/* new slave config? */
+	unsigned int moderate_irqs;	/* interrupt at batch tails only? */
 	/* list of descriptors currently processed */
 	struct list_head desc_list;
 
@@ -530,9 +533,13 @@ static void bam_chan_init_hw(struct bam_chan *bchan,
 	writel_relaxed(BAM_FIFO_SIZE,
 		       bam_addr(bdev, bchan->id, BAM_P_FIFO_SIZES));
 
-	/* enable the per pipe interrupts, enable EOT, ERR, and INT irqs */
-	writel_relaxed(P_DEFAULT_IRQS_EN,
-			bam_addr(bdev, bchan->id, BAM_P_IRQ_EN));
+	/*
+	 * enable the per pipe interrupts, enable EOT, ERR, and INT irqs. With
+	 * moderation, EOT is only signalled through the INT of the batch tail
+	 */
+	writel_relaxed(bchan->moderate_irqs ? P_MODERATED_IRQS_EN :
+		       P_DEFAULT_IRQS_EN,
+		       bam_addr(bdev, bchan->id, BAM_P_IRQ_EN));
 
 	/* unmask the specific pipe and EE combo */
 	val = readl_relaxed(bam_addr(bdev, 0, BAM_IRQ_SRCS_MSK_EE));
@@ -669,10 +676,19 @@ static int bam_slave_config(struct dma_chan *chan,
 			    struct dma_slave_config *cfg)
 {
 	struct bam_chan *bchan = to_bam_chan(chan);
+	struct bam_slave_config *bam_cfg = cfg->peripheral_config;
 	unsigned long flag;
 
+	if (bam_cfg && cfg->peripheral_size < sizeof(*bam_cfg))
+		return -EINVAL;
+
 	spin_lock_irqsave(&bchan->vc.lock, flag);
 	memcpy(&bchan->slave, cfg, sizeof(*cfg));
+	bchan->slave.peripheral_config = NULL;
+	bchan->slave.peripheral_size = 0;
+	if (bam_cfg)
+		bchan->moderate_irqs =
+			!!(bam_cfg->flags & BAM_CONFIG_IRQ_MODERATION);
 	bchan->reconfigure = 1;
 	spin_unlock_irqrestore(&bchan->vc.lock, flag);
 
@@ -867,6 +883,59 @@ static int bam_resume(struct dma_chan *chan)
 	return 0;
 }
 
+/**
+ * bam_chan_complete - completes the transactions the hardware is done with
+ * @bchan: bam channel
+ *
+ * Called with the channel lock held, from the interrupt or when polling
+ */
+static void bam_chan_complete(struct bam_chan *bchan)
+{
+	struct bam_device *bdev = bchan->bdev;
+	struct bam_async_desc *async_desc, *tmp;
+	u32 offset, avail;
+
+	lockdep_assert_held(&bchan->vc.lock);
+
+	offset = readl_relaxed(bam_addr(bdev, bchan->id, BAM_P_SW_OFSTS)) &
+			       P_SW_OFSTS_MASK;
+	offset /= sizeof(struct bam_desc_hw);
+
+	/* Number of bytes available to read */
+	avail = CIRC_CNT(offset, bchan->head, MAX_DESCRIPTORS + 1);
+
+	if (offset < bchan->head)
+		avail--;
+
+	list_for_each_entry_safe(async_desc, tmp,
+				 &bchan->desc_list, desc_node) {
+		/* Not enough data to read */
+		if (avail < async_desc->xfer_len)
+			break;
+
+		/* manage FIFO */
+		bchan->head += async_desc->xfer_len;
+		bchan->head %= MAX_DESCRIPTORS;
+
+		async_desc->num_desc -= async_desc->xfer_len;
+		async_desc->curr_desc += async_desc->xfer_len;
+		avail -= async_desc->xfer_len;
+
+		/*
+		 * if complete, process cookie. Otherwise
+		 * push back to front of desc_issued so that
+		 * it gets restarted by the tasklet
+		 */
+		if (!async_desc->num_desc) {
+			vchan_cookie_complete(&async_desc->vd);
+		} else {
+			list_add(&async_desc->vd.node,
+				 &bchan->vc.desc_issued);
+		}
+		list_del(&async_desc->desc_node);
+	}
+}
+
 /**
  * process_channel_irqs - processes the channel interrupts
  * @bdev: bam controller
@@ -876,9 +945,8 @@ static int bam_resume(struct dma_chan *chan)
  */
 static u32 process_channel_irqs(struct bam_device *bdev)
 {
-	u32 i, srcs, pipe_stts, offset, avail;
+	u32 i, srcs, pipe_stts;
 	unsigned long flags;
-	struct bam_async_desc *async_desc, *tmp;
 
 	srcs = readl_relaxed(bam_addr(bdev, 0, BAM_IRQ_SRCS_EE));
 
@@ -898,45 +966,7 @@ static u32 process_channel_irqs(struct bam_device *bdev)
 		writel_relaxed(pipe_stts, bam_addr(bdev, i, BAM_P_IRQ_CLR));
 
 		spin_lock_irqsave(&bchan->vc.lock, flags);
-
-		offset = readl_relaxed(bam_addr(bdev, i, BAM_P_SW_OFSTS)) &
-				       P_SW_OFSTS_MASK;
-		offset /= sizeof(struct bam_desc_hw);
-
-		/* Number of bytes available to read */
-		avail = CIRC_CNT(offset, bchan->head, MAX_DESCRIPTORS + 1);
-
-		if (offset < bchan->head)
-			avail--;
-
-		list_for_each_entry_safe(async_desc, tmp,
-					 &bchan->desc_list, desc_node) {
-			/* Not enough data to read */
-			if (avail < async_desc->xfer_len)
-				break;
-
-			/* manage FIFO */
-			bchan->head += async_desc->xfer_len;
-			bchan->head %= MAX_DESCRIPTORS;
-
-			async_desc->num_desc -= async_desc->xfer_len;
-			async_desc->curr_desc += async_desc->xfer_len;
-			avail -= async_desc->xfer_len;
-
-			/*
-			 * if complete, process cookie. Otherwise
-			 * push back to front of desc_issued so that
-			 * it gets restarted by the tasklet
-			 */
-			if (!async_desc->num_desc) {
-				vchan_cookie_complete(&async_desc->vd);
-			} else {
-				list_add(&async_desc->vd.node,
-					 &bchan->vc.desc_issued);
-			}
-			list_del(&async_desc->desc_node);
-		}
-
+		bam_chan_complete(bchan);
 		spin_unlock_irqrestore(&bchan->vc.lock, flags);
 	}
 
@@ -1052,8 +1082,14 @@ static void bam_apply_new_config(struct bam_chan *bchan,
 		else
 			maxburst = bchan->slave.dst_maxburst;
 
-		writel_relaxed(maxburst,
-			       bam_addr(bdev, 0, BAM_DESC_CNT_TRSHLD));
+		/* a config only setting BAM flags keeps the threshold */
+		if (maxburst)
+			writel_relaxed(maxburst,
+				       bam_addr(bdev, 0, BAM_DESC_CNT_TRSHLD));
+
+		writel_relaxed(bchan->moderate_irqs ? P_MODERATED_IRQS_EN :
+			       P_DEFAULT_IRQS_EN,
+			       bam_addr(bdev, bchan->id, BAM_P_IRQ_EN));
 	}
 
 	bchan->reconfigure = 0;
@@ -1122,12 +1158,21 @@ static void bam_start_dma(struct bam_chan *bchan)
 		 *  - If a callback completion was requested for this DESC,
 		 *     In this case, BAM will deliver the completion callback
 		 *     for this desc and continue processing the next desc.
+		 *
+		 * With interrupt moderation, only the first two apply and the
+		 * EOT interrupt is disabled, so that a batch of transactions
+		 * written to the FIFO together completes with one interrupt.
 		 */
-		if (((avail <= async_desc->xfer_len) || !vd ||
-		     dmaengine_desc_callback_valid(&cb)) &&
-		    !(async_desc->flags & DESC_FLAG_EOT))
+		if (bchan->moderate_irqs) {
+			if (avail <= async_desc->xfer_len || !vd)
+				desc[async_desc->xfer_len - 1].flags |=
+					cpu_to_le16(DESC_FLAG_INT);
+		} else if (((avail <= async_desc->xfer_len) || !vd ||
+			    dmaengine_desc_callback_valid(&cb)) &&
+			   !(async_desc->flags & DESC_FLAG_EOT)) {
 			desc[async_desc->xfer_len - 1].flags |=
 				cpu_to_le16(DESC_FLAG_INT);
+		}
 
 		if (bchan->tail + async_desc->xfer_len > MAX_DESCRIPTORS) {
 			u32 partial = MAX_DESCRIPTORS - bchan->tail;
@@ -1182,6 +1227,67 @@ static void dma_tasklet(struct tasklet_struct *t)
 
 }
 
+/**
+ * bam_dma_poll - poll for the completion of a transaction
+ * @chan: dma channel
+ * @cookie: transaction cookie
+ * @timeout_us: how long to poll for
+ *
+ * Completes the transactions the hardware is done with and starts the next
+ * issued ones without waiting for the interrupt, until the transaction of
+ * @cookie completes or @timeout_us elapses. This is meant for synchronous
+ * clients with short transactions, which would otherwise spend more time
+ * waiting for the interrupt and the tasklet than for the hardware, and may
+ * be used from atomic context. Callbacks still run from the vchan tasklet.
+ *
+ * Return DMA_COMPLETE, DMA_IN_PROGRESS on timeout, or DMA_ERROR if the
+ * controller is suspended.
+ */
+enum dma_status bam_dma_poll(struct dma_chan *chan, dma_cookie_t cookie,
+			     unsigned int timeout_us)
+{
+	struct bam_chan *bchan = to_bam_chan(chan);
+	struct bam_device *bdev = bchan->bdev;
+	enum dma_status status;
+	unsigned long flags;
+	ktime_t timeout;
+	int active;
+
+	status = dma_cookie_status(chan, cookie, NULL);
+	if (status == DMA_COMPLETE)
+		return status;
+
+	/*
+	 * transactions in flight keep the controller active, it is always
+	 * active without runtime PM
+	 */
+	active = pm_runtime_get_if_active(bdev->dev, true);
+	if (!active)
+		return DMA_ERROR;
+
+	timeout = ktime_add_us(ktime_get(), timeout_us);
+	for (;;) {
+		spin_lock_irqsave(&bchan->vc.lock, flags);
+		bam_chan_complete(bchan);
+		if (!list_empty(&bchan->vc.desc_issued) && !IS_BUSY(bchan))
+			bam_start_dma(bchan);
+		spin_unlock_irqrestore(&bchan->vc.lock, flags);
+
+		status = dma_cookie_status(chan, cookie, NULL);
+		if (status == DMA_COMPLETE || ktime_after(ktime_get(), timeout))
+			break;
+		udelay(1);
+	}
+
+	if (active > 0) {
+		pm_runtime_mark_last_busy(bdev->dev);
+		pm_runtime_put_autosuspend(bdev->dev);
+	}
+
+	return status;
+}
+EXPORT_SYMBOL_GPL(bam_dma_poll);
+
 /**
  * bam_issue_pending - starts pending transactions
  * @chan: dma channel
@@ -9,12 +9,16 @@
 #include <linux/bitfield.h>
 #include <linux/dma-mapping.h>
 #include <linux/dmaengine.h>
+#include <linux/ktime.h>
+#include <linux/kthread.h>
 #include <linux/module.h>
 #include <linux/of_dma.h>
 #include <linux/platform_device.h>
 #include <linux/dma/qcom-gpi-dma.h>
 #include <linux/scatterlist.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <uapi/linux/sched/types.h>
 #include "../dmaengine.h"
 #include "../virt-dma.h"
 
@@ -124,6 +128,10 @@
 	 FIELD_PREP(GPII_n_EV_k_CNTXT_0_INTYPE, inttype)  |	\
 	 FIELD_PREP(GPII_n_EV_k_CNTXT_0_CHTYPE, chtype))
 
+/* EV Context 8, interrupt moderation */
+#define GPII_n_EV_k_CNTXT_8_INTMODT	GENMASK(15, 0)
+#define GPII_n_EV_k_CNTXT_8_INTMODC	GENMASK(23, 16)
+
 #define GPI_INTTYPE_IRQ		(1)
 #define GPI_CHTYPE_GPI_EV	(0x2)
 
@@ -475,6 +483,22 @@ struct gpi_ring {
 	bool configured;
 };
 
+static unsigned int ev_budget = 64;
+module_param(ev_budget, uint, 0644);
+MODULE_PARM_DESC(ev_budget, "Events processed per GPII before yielding to others, 0 for no limit");
+
+static unsigned int ev_thread_prio;
+module_param(ev_thread_prio, uint, 0444);
+MODULE_PARM_DESC(ev_thread_prio, "SCHED_FIFO priority of the event thread, 0 to process events in a tasklet");
+
+static unsigned int ev_int_modt_us;
+module_param(ev_int_modt_us, uint, 0444);
+MODULE_PARM_DESC(ev_int_modt_us, "Event interrupt moderation time in us, 0 to disable");
+
+static unsigned int ev_int_modc;
+module_param(ev_int_modc, uint, 0444);
+MODULE_PARM_DESC(ev_int_modc, "Events coalesced per interrupt while moderating, up to 255");
+
 struct gpi_dev {
 	struct dma_device dma_device;
 	struct device *dev;
@@ -485,6 +509,7 @@ struct gpi_dev {
 	u32 gpii_mask; /* gpii instances available for apps */
 	u32 ev_factor; /* ev ring length factor */
 	struct gpii *gpiis;
+	struct kthread_worker *ev_worker; /* event thread, NULL for tasklets */
 };
 
 struct reg_info {
@@ -507,6 +532,11 @@ struct gchan {
 	u32 dir;
 	struct gpi_ring ch_ring;
 	void *config;
+	/* completion latency of the descriptors, from issue to callback */
+	u64 xfers;
+	u64 lat_total_us;
+	u32 lat_last_us;
+	u32 lat_max_us;
 };
 
 struct gpii {
@@ -527,6 +557,10 @@ struct gpii {
 	rwlock_t pm_lock;
 	struct gpi_ring ev_ring;
 	struct tasklet_struct ev_task; /* event processing tasklet */
+	struct kthread_work ev_work; /* event processing in the event thread */
+	bool ev_more; /* events left after using up the budget */
+	u64 events;
+	u64 budget_yields;
 	struct completion cmd_completion;
 	enum gpi_cmd gpi_cmd;
 	u32 cntxt_type_irq_msk;
@@ -539,6 +573,7 @@ struct gpi_desc {
 	struct virt_dma_desc vd;
 	size_t len;
 	void *db; /* DB register to program */
+	ktime_t issued;
 	struct gchan *gchan;
 	struct gpi_tre tre[MAX_TRE];
 	u32 num_tre;
@@ -551,7 +586,7 @@ static const u32 GPII_CHAN_DIR[MAX_CHANNELS_PER_GPII] = {
 static irqreturn_t gpi_handle_irq(int irq, void *data);
 static void gpi_ring_recycle_ev_element(struct gpi_ring *ring);
 static int gpi_ring_add_element(struct gpi_ring *ring, void **wp);
-static void gpi_process_events(struct gpii *gpii);
+static bool gpi_process_events(struct gpii *gpii, unsigned int budget);
 
 static inline struct gchan *to_gchan(struct dma_chan *dma_chan)
 {
@@ -760,13 +795,34 @@ static inline void gpi_write_ev_db(struct gpii *gpii,
 	gpi_write_reg(gpii, gpii->ev_cntxt_db_reg, p_wp);
 }
 
+static void gpi_schedule_events(struct gpii *gpii)
+{
+	if (gpii->gpi_dev->ev_worker)
+		kthread_queue_work(gpii->gpi_dev->ev_worker, &gpii->ev_work);
+	else
+		tasklet_hi_schedule(&gpii->ev_task);
+}
+
+/* wait for the event processing of @gpii to finish, including requeues */
+static void gpi_sync_events(struct gpii *gpii)
+{
+	if (!gpii->gpi_dev->ev_worker) {
+		tasklet_kill(&gpii->ev_task);
+		return;
+	}
+
+	do {
+		kthread_flush_work(&gpii->ev_work);
+	} while (READ_ONCE(gpii->ev_more));
+}
+
 /* process transfer completion interrupt */
 static void gpi_process_ieob(struct gpii *gpii)
 {
 	gpi_write_reg(gpii, gpii->ieob_clr_reg, BIT(0));
 
 	gpi_config_interrupts(gpii, MASK_IEOB_SETTINGS, 0);
-	tasklet_hi_schedule(&gpii->ev_task);
+	gpi_schedule_events(gpii);
 }
 
 /* process channel control interrupt */
@@ -937,6 +993,37 @@ static irqreturn_t gpi_handle_irq(int irq, void *data)
 }
 
 /* process DMA Immediate completion data events */
+static void gpi_desc_latency(struct gchan *gchan, struct gpi_desc *gpi_desc)
+{
+	u32 us = min_t(s64, ktime_us_delta(ktime_get(), gpi_desc->issued),
+		       U32_MAX);
+
+	gchan->xfers++;
+	gchan->lat_total_us += us;
+	gchan->lat_last_us = us;
+	gchan->lat_max_us = max(gchan->lat_max_us, us);
+}
+
+/*
+ * Take a finished descriptor off the issued list.  A reusable one goes back
+ * to the allocated list before its callback runs, as the client may submit
+ * it again from there on.  Returns true if the descriptor must not be freed.
+ */
+static bool gpi_desc_detach(struct gchan *gchan, struct virt_dma_desc *vd)
+{
+	bool reuse = dmaengine_desc_test_reuse(&vd->tx);
+	unsigned long flags;
+
+	spin_lock_irqsave(&gchan->vc.lock, flags);
+	if (reuse)
+		list_move(&vd->node, &gchan->vc.desc_allocated);
+	else
+		list_del(&vd->node);
+	spin_unlock_irqrestore(&gchan->vc.lock, flags);
+
+	return reuse;
+}
+
 static void gpi_process_imed_data_event(struct gchan *gchan,
 					struct immediate_data_event *imed_event)
 {
@@ -947,6 +1034,7 @@ static void gpi_process_imed_data_event(struct gchan *gchan,
 	struct gpi_desc *gpi_desc;
 	struct virt_dma_desc *vd;
 	unsigned long flags;
+	bool reuse;
 	u32 chid;
 
 	/*
@@ -1007,15 +1095,17 @@ static void gpi_process_imed_data_event(struct gchan *gchan,
 		result.result = DMA_TRANS_NOERROR;
 	result.residue = gpi_desc->len - imed_event->length;
 
+	gpi_desc_latency(gchan, gpi_desc);
 	dma_cookie_complete(&vd->tx);
+	reuse = gpi_desc_detach(gchan, vd);
 	dmaengine_desc_get_callback_invoke(&vd->tx, &result);
+	if (!reuse)
+		kfree(gpi_desc);
+	return;
 
 gpi_free_desc:
-	spin_lock_irqsave(&gchan->vc.lock, flags);
-	list_del(&vd->node);
-	spin_unlock_irqrestore(&gchan->vc.lock, flags);
-	kfree(gpi_desc);
-	gpi_desc = NULL;
+	if (!gpi_desc_detach(gchan, vd))
+		kfree(gpi_desc);
 }
 
 /* processing transfer completion events */
@@ -1029,6 +1119,7 @@ static void gpi_process_xfer_compl_event(struct gchan *gchan,
 	struct gpi_desc *gpi_desc;
 	struct dmaengine_result result;
 	unsigned long flags;
+	bool reuse;
 	u32 chid;
 
 	/* only process events on active channel */
@@ -1086,7 +1177,9 @@ static void gpi_process_xfer_compl_event(struct gchan *gchan,
 	result.residue = gpi_desc->len - compl_event->length;
 	dev_dbg(gpii->gpi_dev->dev, "Residue %d\n", result.residue);
 
+	gpi_desc_latency(gchan, gpi_desc);
 	dma_cookie_complete(&vd->tx);
+	reuse = gpi_desc_detach(gchan, vd);
 	if (gchan->protocol == QCOM_GPI_I2C) {
 		struct dmaengine_desc_callback cb;
 		struct gpi_i2c_config *i2c;
@@ -1098,22 +1191,27 @@ static void gpi_process_xfer_compl_event(struct gchan *gchan,
 	} else {
 		dmaengine_desc_get_callback_invoke(&vd->tx, &result);
 	}
+	if (!reuse)
+		kfree(gpi_desc);
+	return;
+
 gpi_free_desc:
-	spin_lock_irqsave(&gchan->vc.lock, flags);
-	list_del(&vd->node);
-	spin_unlock_irqrestore(&gchan->vc.lock, flags);
-	kfree(gpi_desc);
-	gpi_desc = NULL;
+	if (!gpi_desc_detach(gchan, vd))
+		kfree(gpi_desc);
 }
 
-/* process all events */
-static void gpi_process_events(struct gpii *gpii)
+/*
+ * Process the events, up to @budget of them if it isn't 0.  Returns false
+ * if events are left, the caller must then come back to them later.
+ */
+static bool gpi_process_events(struct gpii *gpii, unsigned int budget)
 {
 	struct gpi_ring *ev_ring = &gpii->ev_ring;
 	phys_addr_t cntxt_rp;
 	void *rp;
 	union gpi_event *gpi_event;
 	struct gchan *gchan;
+	unsigned int done = 0;
 	u32 chid, type;
 
 	cntxt_rp = gpi_read_reg(gpii, gpii->ev_ring_rp_lsb_reg);
@@ -1121,6 +1219,14 @@ static void gpi_process_events(struct gpii *gpii)
 
 	do {
 		while (rp != ev_ring->rp) {
+			if (budget && done == budget) {
+				gpi_write_ev_db(gpii, ev_ring, ev_ring->wp);
+				gpii->events += done;
+				gpii->budget_yields++;
+				return false;
+			}
+			done++;
+
 			gpi_event = ev_ring->rp;
 			chid = gpi_event->xfer_compl_event.chid;
 			type = gpi_event->xfer_compl_event.type;
@@ -1163,29 +1269,54 @@ static void gpi_process_events(struct gpii *gpii)
 		rp = to_virtual(ev_ring, cntxt_rp);
 
 	} while (rp != ev_ring->rp);
+
+	gpii->events += done;
+	return true;
 }
 
-/* processing events using tasklet */
-static void gpi_ev_tasklet(unsigned long data)
+/*
+ * Process events until the ring is empty, or until ev_budget of them were
+ * processed.  In the latter case IEOB stays masked and the processing is
+ * queued again behind the other GPIIs, so that a burst on one engine can't
+ * hold off the completions of the others.
+ */
+static void gpi_handle_events(struct gpii *gpii)
 {
-	struct gpii *gpii = (struct gpii *)data;
+	bool done;
 
 	read_lock(&gpii->pm_lock);
 	if (!REG_ACCESS_VALID(gpii->pm_state)) {
 		read_unlock(&gpii->pm_lock);
+		WRITE_ONCE(gpii->ev_more, false);
 		dev_err(gpii->gpi_dev->dev, "not processing any events, pm_state:%s\n",
 			TO_GPI_PM_STR(gpii->pm_state));
 		return;
 	}
 
 	/* process the events */
-	gpi_process_events(gpii);
+	done = gpi_process_events(gpii, READ_ONCE(ev_budget));
+	WRITE_ONCE(gpii->ev_more, !done);
 
-	/* enable IEOB, switching back to interrupts */
-	gpi_config_interrupts(gpii, MASK_IEOB_SETTINGS, 1);
+	if (done)
+		/* enable IEOB, switching back to interrupts */
+		gpi_config_interrupts(gpii, MASK_IEOB_SETTINGS, 1);
+	else
+		gpi_schedule_events(gpii);
 	read_unlock(&gpii->pm_lock);
 }
 
+/* processing events using tasklet */
+static void gpi_ev_tasklet(unsigned long data)
+{
+	gpi_handle_events((struct gpii *)data);
+}
+
+/* processing events in the event thread */
+static void gpi_ev_work(struct kthread_work *work)
+{
+	gpi_handle_events(container_of(work, struct gpii, ev_work));
+}
+
 /* marks all pending events for the channel as stale */
 static void gpi_mark_stale_events(struct gchan *gchan)
 {
@@ -1323,6 +1454,28 @@ static int gpi_alloc_chan(struct gchan *chan, bool send_alloc_cmd)
 	return 0;
 }
 
+/*
+ * Interrupt moderation of the event ring: once an event is written, the
+ * interrupt is held back until INTMODC more ones are, or INTMODT ticks of
+ * the 32 kHz clock have passed.
+ */
+static u32 gpi_ev_int_mod(void)
+{
+	u32 modt;
+
+	if (!ev_int_modt_us)
+		return 0;
+
+	modt = min_t(u64, DIV_ROUND_UP_ULL((u64)ev_int_modt_us * 32768,
+					   USEC_PER_SEC),
+		     FIELD_MAX(GPII_n_EV_k_CNTXT_8_INTMODT));
+
+	return FIELD_PREP(GPII_n_EV_k_CNTXT_8_INTMODT, modt) |
+	       FIELD_PREP(GPII_n_EV_k_CNTXT_8_INTMODC,
+			  min_t(u32, ev_int_modc,
+				FIELD_MAX(GPII_n_EV_k_CNTXT_8_INTMODC)));
+}
+
 /* allocate and configure event ring */
 static int gpi_alloc_ev_chan(struct gpii *gpii)
 {
@@ -1345,10 +1498,9 @@ static int gpi_alloc_ev_chan(struct gpii *gpii)
 	gpi_write_reg(gpii, base + CNTXT_3_RING_BASE_MSB, upper_32_bits(ring->phys_addr));
 	gpi_write_reg(gpii, gpii->ev_cntxt_db_reg + CNTXT_5_RING_RP_MSB - CNTXT_4_RING_RP_LSB,
 		      upper_32_bits(ring->phys_addr));
-	gpi_write_reg(gpii, base + CNTXT_8_RING_INT_MOD, 0);
 	gpi_write_reg(gpii, base + CNTXT_10_RING_MSI_LSB, 0);
 	gpi_write_reg(gpii, base + CNTXT_11_RING_MSI_MSB, 0);
-	gpi_write_reg(gpii, base + CNTXT_8_RING_INT_MOD, 0);
+	gpi_write_reg(gpii, base + CNTXT_8_RING_INT_MOD, gpi_ev_int_mod());
 	gpi_write_reg(gpii, base + CNTXT_12_RING_RP_UPDATE_LSB, 0);
 	gpi_write_reg(gpii, base + CNTXT_13_RING_RP_UPDATE_MSB, 0);
 
@@ -1585,7 +1737,7 @@ static int gpi_pause(struct dma_chan *chan)
 	disable_irq(gpii->irq);
 
 	/* Wait for threads to complete out */
-	tasklet_kill(&gpii->ev_task);
+	gpi_sync_events(gpii);
 
 	write_lock_irq(&gpii->pm_lock);
 	gpii->pm_state = PAUSE_STATE;
@@ -1917,14 +2069,18 @@ gpi_prep_slave_sg(struct dma_chan *chan, struct scatterlist *sgl,
 	return vchan_tx_prep(&gchan->vc, &gpi_desc->vd, flags);
 }
 
-/* rings transfer ring db to being transfer */
+/*
+ * Rings transfer ring db to begin transfer.  All descriptors submitted since
+ * the last call are copied to the ring, even reused ones whose TREs were
+ * built long ago, and the doorbell is rung once for them.
+ */
 static void gpi_issue_pending(struct dma_chan *chan)
 {
 	struct gchan *gchan = to_gchan(chan);
 	struct gpii *gpii = gchan->gpii;
 	unsigned long flags, pm_lock_flags;
-	struct virt_dma_desc *vd = NULL;
-	struct gpi_desc *gpi_desc;
+	struct virt_dma_desc *vd;
+	struct gpi_desc *gpi_desc = NULL;
 	struct gpi_ring *ch_ring = &gchan->ch_ring;
 	void *tre, *wp = NULL;
 	int i;
@@ -1933,25 +2089,24 @@ static void gpi_issue_pending(struct dma_chan *chan)
 
 	/* move all submitted discriptors to issued list */
 	spin_lock_irqsave(&gchan->vc.lock, flags);
-	if (vchan_issue_pending(&gchan->vc))
-		vd = list_last_entry(&gchan->vc.desc_issued,
-				     struct virt_dma_desc, node);
-	spin_unlock_irqrestore(&gchan->vc.lock, flags);
-
-	/* nothing to do list is empty */
-	if (!vd) {
-		read_unlock_irqrestore(&gpii->pm_lock, pm_lock_flags);
-		return;
-	}
-
-	gpi_desc = to_gpi_desc(vd);
-	for (i = 0; i < gpi_desc->num_tre; i++) {
-		tre = &gpi_desc->tre[i];
-		gpi_queue_xfer(gpii, gchan, tre, &wp);
+	vd = list_first_entry_or_null(&gchan->vc.desc_submitted,
+				      struct virt_dma_desc, node);
+	if (vd && vchan_issue_pending(&gchan->vc)) {
+		list_for_each_entry_from(vd, &gchan->vc.desc_issued, node) {
+			gpi_desc = to_gpi_desc(vd);
+			for (i = 0; i < gpi_desc->num_tre; i++) {
+				tre = &gpi_desc->tre[i];
+				gpi_queue_xfer(gpii, gchan, tre, &wp);
+			}
+			gpi_desc->db = ch_ring->wp;
+			gpi_desc->issued = ktime_get();
+		}
 	}
+	spin_unlock_irqrestore(&gchan->vc.lock, flags);
 
-	gpi_desc->db = ch_ring->wp;
-	gpi_write_ch_db(gchan, &gchan->ch_ring, gpi_desc->db);
+	/* nothing to do if list is empty */
+	if (gpi_desc)
+		gpi_write_ch_db(gchan, &gchan->ch_ring, gpi_desc->db);
 	read_unlock_irqrestore(&gpii->pm_lock, pm_lock_flags);
 }
 
@@ -2086,7 +2241,7 @@ static void gpi_free_chan_resources(struct dma_chan *chan)
 	write_unlock_irq(&gpii->pm_lock);
 
 	/* wait for threads to complete out */
-	tasklet_kill(&gpii->ev_task);
+	gpi_sync_events(gpii);
 
 	/* send command to de allocate event ring */
 	if (cur_state == ACTIVE_STATE)
@@ -2216,6 +2371,55 @@ static struct dma_chan *gpi_of_dma_xlate(struct of_phandle_args *args,
 	return dma_get_slave_channel(&gchan->vc.chan);
 }
 
+static void gpi_dbg_summary_show(struct seq_file *s, struct dma_device *dma_dev)
+{
+	struct gpi_dev *gpi_dev = container_of(dma_dev, struct gpi_dev, dma_device);
+	unsigned int i, j;
+
+	for (i = 0; i < gpi_dev->max_gpii; i++) {
+		struct gpii *gpii = &gpi_dev->gpiis[i];
+
+		if (!((gpi_dev->gpii_mask >> i) & 0x1))
+			continue;
+
+		seq_printf(s, " gpii%u: events: %llu, budget yields: %llu\n",
+			   i, READ_ONCE(gpii->events),
+			   READ_ONCE(gpii->budget_yields));
+		for (j = 0; j < MAX_CHANNELS_PER_GPII; j++) {
+			struct gchan *gchan = &gpii->gchan[j];
+			u64 xfers = READ_ONCE(gchan->xfers);
+
+			seq_printf(s, "  ch%u: xfers: %llu, latency us: last %u avg %llu max %u\n",
+				   j, xfers, READ_ONCE(gchan->lat_last_us),
+				   xfers ? div64_u64(READ_ONCE(gchan->lat_total_us),
+						     xfers) : 0,
+				   READ_ONCE(gchan->lat_max_us));
+		}
+	}
+}
+
+static int gpi_create_ev_worker(struct gpi_dev *gpi_dev)
+{
+	struct sched_attr attr = {
+		.size = sizeof(attr),
+		.sched_policy = SCHED_FIFO,
+		.sched_priority = min_t(u32, ev_thread_prio, MAX_RT_PRIO - 1),
+	};
+	struct kthread_worker *worker;
+
+	if (!ev_thread_prio)
+		return 0;
+
+	worker = kthread_create_worker(0, "gpi-%s", dev_name(gpi_dev->dev));
+	if (IS_ERR(worker))
+		return PTR_ERR(worker);
+
+	sched_setattr_nocheck(worker->task, &attr);
+	gpi_dev->ev_worker = worker;
+
+	return 0;
+}
+
 static int gpi_probe(struct platform_device *pdev)
 {
 	struct gpi_dev *gpi_dev;
@@ -2307,6 +2511,7 @@ static int gpi_probe(struct platform_device *pdev)
 		rwlock_init(&gpii->pm_lock);
 		tasklet_init(&gpii->ev_task, gpi_ev_tasklet,
 			     (unsigned long)gpii);
+		kthread_init_work(&gpii->ev_work, gpi_ev_work);
 		init_completion(&gpii->cmd_completion);
 		gpii->gpii_id = i;
 		gpii->regs = gpi_dev->ee_base;
@@ -2322,6 +2527,7 @@ static int gpi_probe(struct platform_device *pdev)
 	/* configure dmaengine apis */
 	gpi_dev->dma_device.directions = BIT(DMA_DEV_TO_MEM) | BIT(DMA_MEM_TO_DEV);
 	gpi_dev->dma_device.residue_granularity = DMA_RESIDUE_GRANULARITY_DESCRIPTOR;
+	gpi_dev->dma_device.descriptor_reuse = true;
 	gpi_dev->dma_device.src_addr_widths = DMA_SLAVE_BUSWIDTH_8_BYTES;
 	gpi_dev->dma_device.dst_addr_widths = DMA_SLAVE_BUSWIDTH_8_BYTES;
 	gpi_dev->dma_device.device_alloc_chan_resources = gpi_alloc_chan_resources;
@@ -2334,11 +2540,18 @@ static int gpi_probe(struct platform_device *pdev)
 	gpi_dev->dma_device.dev = gpi_dev->dev;
 	gpi_dev->dma_device.device_pause = gpi_pause;
 	gpi_dev->dma_device.device_resume = gpi_resume;
+	gpi_dev->dma_device.dbg_summary_show = gpi_dbg_summary_show;
+
+	ret = gpi_create_ev_worker(gpi_dev);
+	if (ret)
+		return ret;
 
 	/* register with dmaengine framework */
 	ret = dma_async_device_register(&gpi_dev->dma_device);
 	if (ret) {
 		dev_err(gpi_dev->dev, "async_device_register failed ret:%d", ret);
+		if (gpi_dev->ev_worker)
+			kthread_destroy_worker(gpi_dev->ev_worker);
 		return ret;
 	}
 
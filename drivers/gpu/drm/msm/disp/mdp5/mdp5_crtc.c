@@ -11,6 +11,7 @@
 #include <drm/drm_blend.h>
 #include <drm/drm_mode.h>
 #include <drm/drm_crtc.h>
+#include <drm/drm_damage_helper.h>
 #include <drm/drm_flip_work.h>
 #include <drm/drm_fourcc.h>
 #include <drm/drm_probe_helper.h>
@@ -22,6 +23,10 @@
 #define CURSOR_WIDTH	64
 #define CURSOR_HEIGHT	64
 
+static bool partial_update;
+MODULE_PARM_DESC(partial_update, "Only send the damaged rows to DSI command mode panels (default off)");
+module_param(partial_update, bool, 0600);
+
 struct mdp5_crtc {
 	struct drm_crtc base;
 	int id;
@@ -692,6 +697,114 @@ static enum mdp_mixer_stage_id get_start_stage(struct drm_crtc *crtc,
 	return STAGE_BASE;
 }
 
+static bool lm_cursor_visible(struct mdp5_crtc *mdp5_crtc)
+{
+	return mdp5_crtc->lm_cursor_enabled && READ_ONCE(mdp5_crtc->cursor.iova);
+}
+
+static void add_damage(struct drm_rect *damage, const struct drm_rect *r)
+{
+	if (!drm_rect_visible(damage)) {
+		*damage = *r;
+		return;
+	}
+
+	damage->x1 = min(damage->x1, r->x1);
+	damage->y1 = min(damage->y1, r->y1);
+	damage->x2 = max(damage->x2, r->x2);
+	damage->y2 = max(damage->y2, r->y2);
+}
+
+static bool plane_moved(const struct drm_plane_state *old_state,
+			const struct drm_plane_state *new_state)
+{
+	return !drm_rect_equals(&old_state->dst, &new_state->dst) ||
+		old_state->normalized_zpos != new_state->normalized_zpos ||
+		old_state->alpha != new_state->alpha ||
+		old_state->pixel_blend_mode != new_state->pixel_blend_mode;
+}
+
+/*
+ * Work out which rows of a command mode panel a commit changes, as the union
+ * of the plane damage clips in crtc coordinates, widened to full rows.  The
+ * panel only gets those rows, the rest of its frame memory keeps what was
+ * sent before.  Anything the region can't represent, such as a plane which
+ * would need lines outside it, means sending the whole frame.
+ */
+static void mdp5_crtc_compute_roi(struct drm_crtc *crtc,
+				  struct drm_atomic_state *state,
+				  struct drm_crtc_state *crtc_state)
+{
+	struct mdp5_crtc_state *mdp5_cstate = to_mdp5_crtc_state(crtc_state);
+	const struct drm_display_mode *mode = &crtc_state->adjusted_mode;
+	struct drm_rect full = DRM_RECT_INIT(0, 0, mode->hdisplay, mode->vdisplay);
+	struct drm_plane_state *old_pstate, *new_pstate;
+	const struct drm_plane_state *pstate;
+	struct drm_rect damage = { }, clip, r;
+	struct drm_plane *plane;
+	struct msm_dsi *dsi;
+	int i;
+
+	if (!READ_ONCE(partial_update) || !mdp5_cstate->cmd_mode)
+		return;
+
+	if (drm_atomic_crtc_needs_modeset(crtc_state) ||
+	    crtc_state->color_mgmt_changed ||
+	    mdp5_cstate->pipeline.r_mixer ||
+	    lm_cursor_visible(to_mdp5_crtc(crtc)))
+		return;
+
+	dsi = mdp5_kms_get_dsi(get_kms(crtc), mdp5_cstate->pipeline.intf);
+	if (!dsi || msm_dsi_is_bonded_dsi(dsi) || msm_dsi_get_dsc_config(dsi))
+		return;
+
+	drm_atomic_crtc_state_for_each_plane_state(plane, pstate, crtc_state)
+		if (pstate->visible && !mdp5_plane_can_crop_rows(pstate))
+			return;
+
+	for_each_oldnew_plane_in_state(state, plane, old_pstate, new_pstate, i) {
+		bool was_on = old_pstate->crtc == crtc && old_pstate->visible;
+		bool is_on = new_pstate->crtc == crtc && new_pstate->visible;
+
+		if (was_on && (!is_on || plane_moved(old_pstate, new_pstate)))
+			add_damage(&damage, &old_pstate->dst);
+
+		if (!is_on)
+			continue;
+
+		if (!was_on || plane_moved(old_pstate, new_pstate)) {
+			add_damage(&damage, &new_pstate->dst);
+			continue;
+		}
+
+		/* damage clips are in framebuffer coordinates: */
+		if (!drm_atomic_helper_damage_merged(old_pstate, new_pstate, &clip))
+			continue;
+
+		r = clip;
+		drm_rect_translate(&r,
+				   new_pstate->dst.x1 - (new_pstate->src.x1 >> 16),
+				   new_pstate->dst.y1 - (new_pstate->src.y1 >> 16));
+		add_damage(&damage, &r);
+	}
+
+	if (!drm_rect_visible(&damage))
+		return;
+
+	r = DRM_RECT_INIT(0, damage.y1, mode->hdisplay, drm_rect_height(&damage));
+	if (!drm_rect_intersect(&r, &full) || drm_rect_equals(&r, &full))
+		return;
+
+	/* Every visible plane has to have something inside the region: */
+	drm_atomic_crtc_state_for_each_plane_state(plane, pstate, crtc_state) {
+		clip = pstate->dst;
+		if (pstate->visible && !drm_rect_intersect(&clip, &r))
+			return;
+	}
+
+	mdp5_cstate->roi = r;
+}
+
 static int mdp5_crtc_atomic_check(struct drm_crtc *crtc,
 		struct drm_atomic_state *state)
 {
@@ -714,6 +827,9 @@ static int mdp5_crtc_atomic_check(struct drm_crtc *crtc,
 
 	DBG("%s: check", crtc->name);
 
+	/* whole frame, unless mdp5_crtc_compute_roi() finds a smaller region: */
+	mdp5_cstate->roi = (struct drm_rect){ };
+
 	drm_atomic_crtc_state_for_each_plane_state(plane, pstate, crtc_state) {
 		struct mdp5_plane_state *mdp5_pstate =
 				to_mdp5_plane_state(pstate);
@@ -786,6 +902,8 @@ static int mdp5_crtc_atomic_check(struct drm_crtc *crtc,
 				pstates[i].state->stage);
 	}
 
+	mdp5_crtc_compute_roi(crtc, state, crtc_state);
+
 	return 0;
 }
 
@@ -795,6 +913,68 @@ static void mdp5_crtc_atomic_begin(struct drm_crtc *crtc,
 	DBG("%s: begin", crtc->name);
 }
 
+/*
+ * Program the region computed by mdp5_crtc_compute_roi() into the DSI host,
+ * the mixer and the hwpipes of the crtc, or go back to full frames after a
+ * partial update.  Planes which are not part of this commit still carry the
+ * programming for the previous region, so all of them are redone.
+ */
+static void mdp5_crtc_set_roi(struct drm_crtc *crtc,
+			      struct drm_atomic_state *state)
+{
+	struct mdp5_crtc *mdp5_crtc = to_mdp5_crtc(crtc);
+	struct mdp5_crtc_state *mdp5_cstate = to_mdp5_crtc_state(crtc->state);
+	struct drm_crtc_state *old_state = drm_atomic_get_old_crtc_state(state, crtc);
+	const struct drm_display_mode *mode = &crtc->state->adjusted_mode;
+	struct drm_rect full = DRM_RECT_INIT(0, 0, mode->hdisplay, mode->vdisplay);
+	struct mdp5_kms *mdp5_kms = get_kms(crtc);
+	struct drm_rect *roi = &mdp5_cstate->roi;
+	struct drm_plane *plane;
+	unsigned long flags;
+	struct msm_dsi *dsi;
+	bool was_partial;
+
+	was_partial = old_state &&
+		drm_rect_visible(&to_mdp5_crtc_state(old_state)->roi);
+
+	/* The LM cursor may have been turned on since atomic_check(): */
+	if (lm_cursor_visible(mdp5_crtc))
+		*roi = (struct drm_rect){ };
+
+	if (!drm_rect_visible(roi) && !was_partial)
+		return;
+
+	dsi = mdp5_kms_get_dsi(mdp5_kms, mdp5_cstate->pipeline.intf);
+
+	if (drm_rect_visible(roi) && msm_dsi_set_roi(dsi, roi)) {
+		*roi = (struct drm_rect){ };
+		if (!was_partial)
+			return;
+	}
+
+	if (!drm_rect_visible(roi) && msm_dsi_set_roi(dsi, &full))
+		DRM_DEV_ERROR(crtc->dev->dev, "%s: failed to restore full frame updates\n",
+			      crtc->name);
+
+	spin_lock_irqsave(&mdp5_crtc->lm_lock, flags);
+	mdp5_write(mdp5_kms, REG_MDP5_LM_OUT_SIZE(mdp5_cstate->pipeline.mixer->lm),
+		   MDP5_LM_OUT_SIZE_WIDTH(mode->hdisplay) |
+		   MDP5_LM_OUT_SIZE_HEIGHT(drm_rect_visible(roi) ?
+					   drm_rect_height(roi) : mode->vdisplay));
+	spin_unlock_irqrestore(&mdp5_crtc->lm_lock, flags);
+
+	drm_atomic_crtc_for_each_plane(plane, crtc) {
+		if (!plane->state->visible)
+			continue;
+
+		/* already programmed for the whole frame by atomic_update(): */
+		if (!drm_rect_visible(roi) && drm_atomic_get_new_plane_state(state, plane))
+			continue;
+
+		mdp5_plane_set_roi(plane, drm_rect_visible(roi) ? roi : &full);
+	}
+}
+
 static void mdp5_crtc_atomic_flush(struct drm_crtc *crtc,
 				   struct drm_atomic_state *state)
 {
@@ -823,6 +1003,9 @@ static void mdp5_crtc_atomic_flush(struct drm_crtc *crtc,
 
 	blend_setup(crtc);
 
+	if (mdp5_cstate->cmd_mode)
+		mdp5_crtc_set_roi(crtc, state);
+
 	/* PP_DONE irq is only used by command mode for now.
 	 * It is better to request pending before FLUSH and START trigger
 	 * to make sure no pp_done irq missed.
@@ -351,6 +351,23 @@ static int get_dsi_id_from_intf(const struct mdp5_cfg_hw *hw_cfg, int intf_num)
 	return -EINVAL;
 }
 
+struct msm_dsi *mdp5_kms_get_dsi(struct mdp5_kms *mdp5_kms,
+				 struct mdp5_interface *intf)
+{
+	struct msm_drm_private *priv = mdp5_kms->dev->dev_private;
+	int dsi_id;
+
+	if (intf->type != INTF_DSI)
+		return NULL;
+
+	dsi_id = get_dsi_id_from_intf(mdp5_cfg_get_hw_config(mdp5_kms->cfg),
+				      intf->num);
+	if (dsi_id < 0 || dsi_id >= ARRAY_SIZE(priv->dsi))
+		return NULL;
+
+	return priv->dsi[dsi_id];
+}
+
 static int modeset_init_intf(struct mdp5_kms *mdp5_kms,
 			     struct mdp5_interface *intf)
 {
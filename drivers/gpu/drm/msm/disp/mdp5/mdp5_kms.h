@@ -135,6 +135,11 @@ struct mdp5_crtc_state {
 	 * writing CTL[n].START until encoder->enable()
 	 */
 	bool defer_start;
+
+	/* full width rows a command mode flush sends to the panel, when not
+	 * the whole frame (an empty rect means the whole frame):
+	 */
+	struct drm_rect roi;
 };
 #define to_mdp5_crtc_state(x) \
 		container_of(x, struct mdp5_crtc_state, base)
@@ -275,9 +280,14 @@ void mdp5_irq_domain_fini(struct mdp5_kms *mdp5_kms);
 uint32_t mdp5_plane_get_flush(struct drm_plane *plane);
 enum mdp5_pipe mdp5_plane_pipe(struct drm_plane *plane);
 enum mdp5_pipe mdp5_plane_right_pipe(struct drm_plane *plane);
+bool mdp5_plane_can_crop_rows(const struct drm_plane_state *state);
+void mdp5_plane_set_roi(struct drm_plane *plane, const struct drm_rect *roi);
 struct drm_plane *mdp5_plane_init(struct drm_device *dev,
 				  enum drm_plane_type type);
 
+struct msm_dsi *mdp5_kms_get_dsi(struct mdp5_kms *mdp5_kms,
+				 struct mdp5_interface *intf);
+
 struct mdp5_ctl *mdp5_crtc_get_ctl(struct drm_crtc *crtc);
 uint32_t mdp5_crtc_vblank(struct drm_crtc *crtc);
 
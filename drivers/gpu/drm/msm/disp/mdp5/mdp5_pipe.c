@@ -151,6 +151,34 @@ int mdp5_pipe_release(struct drm_atomic_state *s, struct mdp5_hw_pipe *hwpipe)
 	return 0;
 }
 
+int mdp5_pipe_resize(struct drm_atomic_state *s, struct mdp5_hw_pipe *hwpipe,
+		     uint32_t blkcfg)
+{
+	struct msm_drm_private *priv = s->dev->dev_private;
+	struct mdp5_kms *mdp5_kms = to_mdp5_kms(to_mdp_kms(priv->kms));
+	struct mdp5_global_state *state;
+	int ret;
+
+	if (!mdp5_kms->smp || hwpipe->blkcfg == blkcfg)
+		return 0;
+
+	state = mdp5_get_global_state(s);
+	if (IS_ERR(state))
+		return PTR_ERR(state);
+
+	if (WARN_ON(!state->hwpipe.hwpipe_to_plane[hwpipe->idx]))
+		return -EINVAL;
+
+	DBG("%s: resize SMP blocks", hwpipe->name);
+	ret = mdp5_smp_resize(mdp5_kms->smp, &state->smp, hwpipe->pipe, blkcfg);
+	if (ret)
+		return -ENOMEM;
+
+	hwpipe->blkcfg = blkcfg;
+
+	return 0;
+}
+
 void mdp5_pipe_destroy(struct mdp5_hw_pipe *hwpipe)
 {
 	kfree(hwpipe);
@@ -15,6 +15,10 @@
 
 #include "mdp5_kms.h"
 
+static bool smp_realloc;
+MODULE_PARM_DESC(smp_realloc, "Move planes to a new hwpipe, instead of resizing in place, when their SMP needs change");
+module_param(smp_realloc, bool, 0600);
+
 struct mdp5_plane {
 	struct drm_plane base;
 
@@ -277,7 +281,13 @@ static int mdp5_plane_atomic_check_with_state(struct drm_crtc_state *crtc_state,
 			blkcfg = mdp5_smp_calculate(mdp5_kms->smp, format,
 					state->src_w >> 16, false);
 
-			if (mdp5_state->hwpipe && (mdp5_state->hwpipe->blkcfg != blkcfg))
+			/*
+			 * Unless smp_realloc is set, the pipe we have gets
+			 * its SMP blocks resized below instead, which keeps
+			 * it staged on the mixer:
+			 */
+			if (smp_realloc && mdp5_state->hwpipe &&
+			    (mdp5_state->hwpipe->blkcfg != blkcfg))
 				new_hwpipe = true;
 		}
 
@@ -323,6 +333,13 @@ static int mdp5_plane_atomic_check_with_state(struct drm_crtc_state *crtc_state,
 			if (ret)
 				return ret;
 
+		} else if (mdp5_state->hwpipe) {
+			ret = mdp5_pipe_resize(state->state, mdp5_state->hwpipe,
+					       blkcfg);
+			if (ret) {
+				DBG("%s: failed to resize hwpipe!", plane->name);
+				return ret;
+			}
 		}
 	} else {
 		ret = mdp5_pipe_release(state->state, mdp5_state->hwpipe);
@@ -991,6 +1008,71 @@ enum mdp5_pipe mdp5_plane_right_pipe(struct drm_plane *plane)
 	return pstate->r_hwpipe->pipe;
 }
 
+/*
+ * Whether a partial update can fetch just some of the rows of the plane:
+ * only for planes fetched as is by a single hwpipe, as scaling, flipping
+ * and chroma upsampling all need lines from outside the region.
+ */
+bool mdp5_plane_can_crop_rows(const struct drm_plane_state *state)
+{
+	const struct mdp_format *format;
+
+	if (to_mdp5_plane_state(state)->r_hwpipe)
+		return false;
+
+	if (state->rotation != DRM_MODE_ROTATE_0)
+		return false;
+
+	if ((drm_rect_width(&state->src) >> 16) != drm_rect_width(&state->dst) ||
+	    (drm_rect_height(&state->src) >> 16) != drm_rect_height(&state->dst))
+		return false;
+
+	format = to_mdp_format(msm_framebuffer_format(state->fb));
+
+	return !MDP_FORMAT_IS_YUV(format);
+}
+
+/*
+ * Reprogram the hwpipe of a plane for which mdp5_plane_can_crop_rows() is
+ * true to fetch only the part of it inside @roi, placed relative to the
+ * top left of @roi.  Called for partial updates after the plane has been
+ * programmed for the whole frame, and with the whole frame as @roi to undo
+ * that again.
+ */
+void mdp5_plane_set_roi(struct drm_plane *plane, const struct drm_rect *roi)
+{
+	struct drm_plane_state *pstate = plane->state;
+	struct mdp5_hw_pipe *hwpipe = to_mdp5_plane_state(pstate)->hwpipe;
+	struct mdp5_kms *mdp5_kms = get_kms(plane);
+	struct drm_rect dst = pstate->dst;
+	u32 src_x, src_y;
+	enum mdp5_pipe pipe;
+
+	if (WARN_ON(!hwpipe) || !drm_rect_intersect(&dst, roi))
+		return;
+
+	pipe = hwpipe->pipe;
+	src_x = (pstate->src.x1 >> 16) + dst.x1 - pstate->dst.x1;
+	src_y = (pstate->src.y1 >> 16) + dst.y1 - pstate->dst.y1;
+	drm_rect_translate(&dst, -roi->x1, -roi->y1);
+
+	mdp5_write(mdp5_kms, REG_MDP5_PIPE_SRC_SIZE(pipe),
+			MDP5_PIPE_SRC_SIZE_WIDTH(drm_rect_width(&dst)) |
+			MDP5_PIPE_SRC_SIZE_HEIGHT(drm_rect_height(&dst)));
+
+	mdp5_write(mdp5_kms, REG_MDP5_PIPE_SRC_XY(pipe),
+			MDP5_PIPE_SRC_XY_X(src_x) |
+			MDP5_PIPE_SRC_XY_Y(src_y));
+
+	mdp5_write(mdp5_kms, REG_MDP5_PIPE_OUT_SIZE(pipe),
+			MDP5_PIPE_OUT_SIZE_WIDTH(drm_rect_width(&dst)) |
+			MDP5_PIPE_OUT_SIZE_HEIGHT(drm_rect_height(&dst)));
+
+	mdp5_write(mdp5_kms, REG_MDP5_PIPE_OUT_XY(pipe),
+			MDP5_PIPE_OUT_XY_X(dst.x1) |
+			MDP5_PIPE_OUT_XY_Y(dst.y1));
+}
+
 uint32_t mdp5_plane_get_flush(struct drm_plane *plane)
 {
 	struct mdp5_plane_state *pstate = to_mdp5_plane_state(plane->state);
@@ -58,6 +58,21 @@ static inline u32 pipe2client(enum mdp5_pipe pipe, int plane)
 	return mdp5_cfg->smp.clients[pipe] + plane;
 }
 
+/*
+ * Blocks parked by mdp5_smp_resize() may still be scanned out of, so until
+ * _complete_commit() they count as busy even though no client owns them.
+ * Returns the number of blocks which can be handed out.
+ */
+static int smp_avail_blocks(struct mdp5_smp *smp, struct mdp5_smp_state *state,
+		mdp5_smp_state_t *busy)
+{
+	int cnt = smp->blk_cnt;
+
+	bitmap_or(*busy, state->state, state->pending, cnt);
+
+	return cnt - bitmap_weight(*busy, cnt);
+}
+
 /* allocate blocks for the specified request: */
 static int smp_request_block(struct mdp5_smp *smp,
 		struct mdp5_smp_state *state,
@@ -65,6 +80,7 @@ static int smp_request_block(struct mdp5_smp *smp,
 {
 	void *cs = state->client_state[cid];
 	int i, avail, cnt = smp->blk_cnt;
+	mdp5_smp_state_t busy;
 	uint8_t reserved;
 
 	/* we shouldn't be requesting blocks for an in-use client: */
@@ -77,7 +93,7 @@ static int smp_request_block(struct mdp5_smp *smp,
 		DBG("%d MMBs allocated (%d reserved)", nblks, reserved);
 	}
 
-	avail = cnt - bitmap_weight(state->state, cnt);
+	avail = smp_avail_blocks(smp, state, &busy);
 	if (nblks > avail) {
 		DRM_DEV_ERROR(smp->dev->dev, "out of blks (req=%d > avail=%d)\n",
 				nblks, avail);
@@ -85,7 +101,8 @@ static int smp_request_block(struct mdp5_smp *smp,
 	}
 
 	for (i = 0; i < nblks; i++) {
-		int blk = find_first_zero_bit(state->state, cnt);
+		int blk = find_first_zero_bit(busy, cnt);
+		set_bit(blk, busy);
 		set_bit(blk, cs);
 		set_bit(blk, state->state);
 	}
@@ -93,6 +110,32 @@ static int smp_request_block(struct mdp5_smp *smp,
 	return 0;
 }
 
+/* resize a client's blocks in place, keeping the ones it already has: */
+static void smp_resize_block(struct mdp5_smp *smp,
+		struct mdp5_smp_state *state, mdp5_smp_state_t *busy,
+		u32 cid, int nblks)
+{
+	void *cs = state->client_state[cid];
+	int cnt = smp->blk_cnt;
+	int have = bitmap_weight(cs, cnt);
+
+	while (have > nblks) {
+		int blk = find_last_bit(cs, cnt);
+		clear_bit(blk, cs);
+		clear_bit(blk, state->state);
+		set_bit(blk, state->pending);
+		have--;
+	}
+
+	while (have < nblks) {
+		int blk = find_first_zero_bit(*busy, cnt);
+		set_bit(blk, *busy);
+		set_bit(blk, cs);
+		set_bit(blk, state->state);
+		have++;
+	}
+}
+
 static void set_fifo_thresholds(struct mdp5_smp *smp,
 		enum mdp5_pipe pipe, int nblks)
 {
@@ -191,6 +234,55 @@ int mdp5_smp_assign(struct mdp5_smp *smp, struct mdp5_smp_state *state,
 	return 0;
 }
 
+/**
+ * mdp5_smp_resize - Change the allocation of a pipe which keeps scanning out
+ * @smp: the SMP
+ * @state: the new global SMP state
+ * @pipe: pipe previously set up with mdp5_smp_assign()
+ * @blkcfg: the new requirements, from mdp5_smp_calculate()
+ *
+ * Unlike releasing the pipe and assigning a new one, this leaves the blocks
+ * the pipe keeps where they are, so the plane does not have to move to
+ * another pipe.  Fails with -ENOSPC, leaving @state untouched, if the free
+ * pool cannot cover the blocks the pipe gains.
+ */
+int mdp5_smp_resize(struct mdp5_smp *smp, struct mdp5_smp_state *state,
+		enum mdp5_pipe pipe, uint32_t blkcfg)
+{
+	int nclients = pipe2nclients(pipe);
+	int i, avail, need = 0, cnt = smp->blk_cnt;
+	mdp5_smp_state_t busy;
+	int nblks[3];
+
+	if (WARN_ON(nclients > ARRAY_SIZE(nblks)))
+		return -EINVAL;
+
+	for (i = 0; i < nclients; i++) {
+		u32 cid = pipe2client(pipe, i);
+		int have = bitmap_weight(state->client_state[cid], cnt);
+
+		nblks[i] = max(0, (int)((blkcfg >> (8 * i)) & 0xff) -
+				  smp->reserved[cid]);
+		need += max(0, nblks[i] - have);
+	}
+
+	avail = smp_avail_blocks(smp, state, &busy);
+	if (need > avail) {
+		DRM_DEV_ERROR(smp->dev->dev, "%s: out of blks (req=%d > avail=%d)\n",
+				pipe2name(pipe), need, avail);
+		return -ENOSPC;
+	}
+
+	for (i = 0; i < nclients; i++) {
+		DBG("%s[%d]: resize to %d SMP blocks", pipe2name(pipe), i, nblks[i]);
+		smp_resize_block(smp, state, &busy, pipe2client(pipe, i), nblks[i]);
+	}
+
+	state->assigned |= (1 << pipe);
+
+	return 0;
+}
+
 /* Release SMP blocks for all clients of the pipe */
 void mdp5_smp_release(struct mdp5_smp *smp, struct mdp5_smp_state *state,
 		enum mdp5_pipe pipe)
@@ -322,6 +414,9 @@ void mdp5_smp_complete_commit(struct mdp5_smp *smp, struct mdp5_smp_state *state
 
 	write_smp_fifo_regs(smp);
 
+	/* old configurations are done scanning out of parked blocks: */
+	bitmap_zero(state->pending, smp->blk_cnt);
+
 	state->released = 0;
 }
 
@@ -333,8 +428,8 @@ void mdp5_smp_dump(struct mdp5_smp *smp, struct drm_printer *p)
 	struct mdp5_global_state *global_state;
 	int total = 0, i, j;
 
-	drm_printf(p, "name\tinuse\tplane\n");
-	drm_printf(p, "----\t-----\t-----\n");
+	drm_printf(p, "name\tinuse\tplane\tblocks\n");
+	drm_printf(p, "----\t-----\t-----\t------\n");
 
 	if (drm_can_sleep())
 		drm_modeset_lock(&mdp5_kms->glob_state_lock, NULL);
@@ -354,9 +449,10 @@ void mdp5_smp_dump(struct mdp5_smp *smp, struct drm_printer *p)
 			void *cs = state->client_state[cid];
 			int inuse = bitmap_weight(cs, smp->blk_cnt);
 
-			drm_printf(p, "%s:%d\t%d\t%s\n",
+			drm_printf(p, "%s:%d\t%d\t%s\t%*pbl\n",
 				pipe2name(pipe), j, inuse,
-				plane ? plane->name : NULL);
+				plane ? plane->name : NULL,
+				smp->blk_cnt, cs);
 
 			total += inuse;
 		}
@@ -365,6 +461,9 @@ void mdp5_smp_dump(struct mdp5_smp *smp, struct drm_printer *p)
 	drm_printf(p, "TOTAL:\t%d\t(of %d)\n", total, smp->blk_cnt);
 	drm_printf(p, "AVAIL:\t%d\n", smp->blk_cnt -
 			bitmap_weight(state->state, smp->blk_cnt));
+	drm_printf(p, "PENDING:\t%d\t%*pbl\n",
+			bitmap_weight(state->pending, smp->blk_cnt),
+			smp->blk_cnt, state->pending);
 
 	if (drm_can_sleep())
 		drm_modeset_unlock(&mdp5_kms->glob_state_lock);
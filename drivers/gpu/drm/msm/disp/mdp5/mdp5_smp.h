@@ -42,6 +42,15 @@
  * 2) in _complete_commit(), after vblank/etc, we clear things for the
  *    released clients, since at that point old pipes are no longer
  *    scanning out.
+ *
+ * A pipe which stays on the same plane but needs a different number of
+ * blocks (new width or format) is resized in place with _resize(), rather
+ * than moved to a fresh pipe.  Blocks it gains are taken from the free
+ * pool and programmed in step 1, so the new allocation is a superset of
+ * the old one while the old configuration is still scanning out.  Blocks
+ * it gives up are parked in the pending mask, and only go back to the
+ * free pool in step 2, once the smaller configuration has latched.  So
+ * blocks move from a shrinking pipe to a growing one over two commits.
  */
 struct mdp5_smp_state {
 	/* global state of what blocks are in use: */
@@ -55,6 +64,9 @@ struct mdp5_smp_state {
 
 	/* released pipes (hw updated at _complete_commit()): */
 	unsigned long released;
+
+	/* blocks dropped by _resize(), free again after _complete_commit(): */
+	mdp5_smp_state_t pending;
 };
 
 struct mdp5_kms;
@@ -80,6 +92,8 @@ int mdp5_smp_assign(struct mdp5_smp *smp, struct mdp5_smp_state *state,
 		enum mdp5_pipe pipe, uint32_t blkcfg);
 void mdp5_smp_release(struct mdp5_smp *smp, struct mdp5_smp_state *state,
 		enum mdp5_pipe pipe);
+int mdp5_smp_resize(struct mdp5_smp *smp, struct mdp5_smp_state *state,
+		enum mdp5_pipe pipe, uint32_t blkcfg);
 
 void mdp5_smp_prepare_commit(struct mdp5_smp *smp, struct mdp5_smp_state *state);
 void mdp5_smp_complete_commit(struct mdp5_smp *smp, struct mdp5_smp_state *state);
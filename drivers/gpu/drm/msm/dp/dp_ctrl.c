@@ -8,11 +8,13 @@
 #include <linux/types.h>
 #include <linux/completion.h>
 #include <linux/delay.h>
+#include <linux/jhash.h>
 #include <linux/phy/phy.h>
 #include <linux/phy/phy-dp.h>
 #include <linux/pm_opp.h>
 
 #include <drm/display/drm_dp_helper.h>
+#include <drm/drm_edid.h>
 #include <drm/drm_fixed.h>
 #include <drm/drm_print.h>
 
@@ -20,6 +22,10 @@
 #include "dp_ctrl.h"
 #include "dp_link.h"
 
+static bool link_train_cache = true;
+module_param(link_train_cache, bool, 0644);
+MODULE_PARM_DESC(link_train_cache, "retry the last good link settings of a sink before full link training");
+
 #define DP_KHZ_TO_HZ 1000
 #define IDLE_PATTERN_COMPLETION_TIMEOUT_JIFFIES	(30 * HZ / 1000) /* 30 ms */
 #define PSR_OPERATION_COMPLETION_TIMEOUT_JIFFIES       (300 * HZ / 1000) /* 300 ms */
@@ -34,6 +40,8 @@
 #define MR_LINK_CUSTOM80 0x200
 #define MR_LINK_TRAINING4  0x40
 
+#define DP_LINK_CACHE_ENTRIES	4
+
 enum {
 	DP_TRAINING_NONE,
 	DP_TRAINING_1,
@@ -69,6 +77,21 @@ struct dp_vc_tu_mapping_table {
 	u8 tu_size_minus1;
 };
 
+/*
+ * Settings a sink last trained successfully with, keyed by a hash of its
+ * EDID.  max_rate/max_lanes are the capabilities it reported at the time,
+ * so an entry is not reused if the sink (or a dock in between) changed.
+ */
+struct dp_link_cache_entry {
+	u32 sink_hash;
+	u32 max_rate;
+	u32 max_lanes;
+	u32 rate;
+	u32 num_lanes;
+	u8 v_level;
+	u8 p_level;
+};
+
 struct dp_ctrl_private {
 	struct dp_ctrl dp_ctrl;
 	struct drm_device *drm_dev;
@@ -83,6 +106,9 @@ struct dp_ctrl_private {
 	struct completion idle_comp;
 	struct completion psr_op_comp;
 	struct completion video_comp;
+
+	struct dp_link_cache_entry link_cache[DP_LINK_CACHE_ENTRIES];
+	unsigned int link_cache_next;
 };
 
 static int dp_aux_link_configure(struct drm_dp_aux *aux,
@@ -1239,7 +1265,7 @@ static int dp_ctrl_link_train_2(struct dp_ctrl_private *ctrl,
 }
 
 static int dp_ctrl_link_train(struct dp_ctrl_private *ctrl,
-			int *training_step)
+			int *training_step, bool preset_levels)
 {
 	int ret = 0;
 	const u8 *dpcd = ctrl->panel->dpcd;
@@ -1253,7 +1279,8 @@ static int dp_ctrl_link_train(struct dp_ctrl_private *ctrl,
 	link_info.rate = ctrl->link->link_params.rate;
 	link_info.capabilities = DP_LINK_CAP_ENHANCED_FRAMING;
 
-	dp_link_reset_phy_params_vx_px(ctrl->link);
+	if (!preset_levels)
+		dp_link_reset_phy_params_vx_px(ctrl->link);
 
 	dp_aux_link_configure(ctrl->aux, &link_info);
 
@@ -1309,7 +1336,7 @@ static int dp_ctrl_setup_main_link(struct dp_ctrl_private *ctrl,
 	 * a link training pattern, we have to first do soft reset.
 	 */
 
-	ret = dp_ctrl_link_train(ctrl, training_step);
+	ret = dp_ctrl_link_train(ctrl, training_step, false);
 
 	return ret;
 }
@@ -1730,6 +1757,91 @@ static bool dp_ctrl_channel_eq_ok(struct dp_ctrl_private *ctrl)
 	return drm_dp_channel_eq_ok(link_status, num_lanes);
 }
 
+static u32 dp_ctrl_sink_hash(struct dp_ctrl_private *ctrl)
+{
+	const struct edid *edid = ctrl->panel->edid;
+
+	if (!link_train_cache || !edid)
+		return 0;
+
+	return jhash(edid, EDID_LENGTH * (edid->extensions + 1), 0);
+}
+
+static struct dp_link_cache_entry *
+dp_ctrl_link_cache_find(struct dp_ctrl_private *ctrl, u32 sink_hash)
+{
+	int i;
+
+	if (!sink_hash)
+		return NULL;
+
+	for (i = 0; i < DP_LINK_CACHE_ENTRIES; i++) {
+		struct dp_link_cache_entry *entry = &ctrl->link_cache[i];
+
+		if (entry->sink_hash == sink_hash &&
+		    entry->max_rate == ctrl->panel->link_info.rate &&
+		    entry->max_lanes == ctrl->panel->link_info.num_lanes)
+			return entry;
+	}
+
+	return NULL;
+}
+
+static void dp_ctrl_link_cache_store(struct dp_ctrl_private *ctrl,
+		u32 sink_hash)
+{
+	struct dp_link_cache_entry *entry;
+
+	if (!sink_hash)
+		return;
+
+	entry = dp_ctrl_link_cache_find(ctrl, sink_hash);
+	if (!entry) {
+		entry = &ctrl->link_cache[ctrl->link_cache_next];
+		ctrl->link_cache_next = (ctrl->link_cache_next + 1) %
+					DP_LINK_CACHE_ENTRIES;
+	}
+
+	entry->sink_hash = sink_hash;
+	entry->max_rate = ctrl->panel->link_info.rate;
+	entry->max_lanes = ctrl->panel->link_info.num_lanes;
+	entry->rate = ctrl->link->link_params.rate;
+	entry->num_lanes = ctrl->link->link_params.num_lanes;
+	entry->v_level = ctrl->link->phy_params.v_level;
+	entry->p_level = ctrl->link->phy_params.p_level;
+}
+
+/*
+ * Train once at the cached rate and lane count, starting from the cached
+ * swing and pre-emphasis levels.  A sink that accepted them before will
+ * normally lock after a single clock recovery and channel eq interval,
+ * rather than going through the level search and the rate/lane fallback
+ * steps, each of which costs a mainlink reinit.
+ */
+static int dp_ctrl_link_train_cached(struct dp_ctrl_private *ctrl,
+		struct dp_link_cache_entry *entry)
+{
+	int training_step = DP_TRAINING_NONE;
+	int ret;
+
+	ctrl->link->phy_params.v_level = entry->v_level;
+	ctrl->link->phy_params.p_level = entry->p_level;
+
+	dp_catalog_ctrl_mainlink_ctrl(ctrl->catalog, true);
+
+	ret = dp_ctrl_link_train(ctrl, &training_step, true);
+	if (ret) {
+		drm_dbg_dp(ctrl->drm_dev,
+			"cached link training failed at step %d, ret=%d\n",
+			training_step, ret);
+		return ret;
+	}
+
+	drm_dbg_dp(ctrl->drm_dev, "cached link training successful\n");
+
+	return 0;
+}
+
 int dp_ctrl_on_link(struct dp_ctrl *dp_ctrl)
 {
 	int rc = 0;
@@ -1738,8 +1850,10 @@ int dp_ctrl_on_link(struct dp_ctrl *dp_ctrl)
 	int link_train_max_retries = 5;
 	u32 const phy_cts_pixel_clk_khz = 148500;
 	u8 link_status[DP_LINK_STATUS_SIZE];
+	struct dp_link_cache_entry *cached = NULL;
 	unsigned int training_step;
 	unsigned long pixel_rate;
+	u32 sink_hash = 0;
 
 	if (!dp_ctrl)
 		return -EINVAL;
@@ -1760,6 +1874,13 @@ int dp_ctrl_on_link(struct dp_ctrl *dp_ctrl)
 		ctrl->link->link_params.rate = rate;
 		ctrl->link->link_params.num_lanes =
 			ctrl->panel->link_info.num_lanes;
+
+		sink_hash = dp_ctrl_sink_hash(ctrl);
+		cached = dp_ctrl_link_cache_find(ctrl, sink_hash);
+		if (cached) {
+			ctrl->link->link_params.rate = cached->rate;
+			ctrl->link->link_params.num_lanes = cached->num_lanes;
+		}
 	}
 
 	drm_dbg_dp(ctrl->drm_dev, "rate=%d, num_lanes=%d, pixel_rate=%lu\n",
@@ -1770,6 +1891,25 @@ int dp_ctrl_on_link(struct dp_ctrl *dp_ctrl)
 	if (rc)
 		return rc;
 
+	if (cached) {
+		rc = dp_ctrl_link_train_cached(ctrl, cached);
+		if (!rc)
+			goto done;
+
+		/* start over with the full sequence from the sink's maximum: */
+		cached->sink_hash = 0;
+		dp_ctrl_clear_training_pattern(ctrl);
+		ctrl->link->link_params.rate = rate;
+		ctrl->link->link_params.num_lanes =
+			ctrl->panel->link_info.num_lanes;
+
+		rc = dp_ctrl_reinitialize_mainlink(ctrl);
+		if (rc) {
+			DRM_ERROR("Failed to reinitialize mainlink. rc=%d\n", rc);
+			goto done;
+		}
+	}
+
 	while (--link_train_max_retries) {
 		training_step = DP_TRAINING_NONE;
 		rc = dp_ctrl_setup_main_link(ctrl, &training_step);
@@ -1833,7 +1973,10 @@ int dp_ctrl_on_link(struct dp_ctrl *dp_ctrl)
 	if (ctrl->link->sink_request & DP_TEST_LINK_PHY_TEST_PATTERN)
 		return rc;
 
+done:
 	if (rc == 0) {  /* link train successfully */
+		dp_ctrl_link_cache_store(ctrl, sink_hash);
+
 		/*
 		 * do not stop train pattern here
 		 * stop link training at on_stream
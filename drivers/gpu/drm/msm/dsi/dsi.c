@@ -17,6 +17,11 @@ struct drm_dsc_config *msm_dsi_get_dsc_config(struct msm_dsi *msm_dsi)
 	return msm_dsi_host_get_dsc_config(msm_dsi->host);
 }
 
+int msm_dsi_set_roi(struct msm_dsi *msm_dsi, const struct drm_rect *roi)
+{
+	return msm_dsi_host_set_roi(msm_dsi->host, roi);
+}
+
 static int dsi_get_phy(struct msm_dsi *msm_dsi)
 {
 	struct platform_device *pdev = msm_dsi->pdev;
@@ -177,6 +177,9 @@ struct msm_dsi_host {
 
 	u32 dma_cmd_ctrl_restore;
 
+	/* rows the panel's page address is set to, in command mode */
+	struct drm_rect roi;
+
 	bool registered;
 	bool power_on;
 	bool enabled;
@@ -994,6 +997,8 @@ static void dsi_timing_setup(struct msm_dsi_host *msm_host, bool is_bonded_dsi)
 		dsi_write(msm_host, REG_DSI_CMD_MDP_STREAM0_TOTAL,
 			DSI_CMD_MDP_STREAM0_TOTAL_H_TOTAL(hdisplay) |
 			DSI_CMD_MDP_STREAM0_TOTAL_V_TOTAL(mode->vdisplay));
+
+		msm_host->roi = DRM_RECT_INIT(0, 0, mode->hdisplay, mode->vdisplay);
 	}
 }
 
@@ -2487,6 +2492,54 @@ unsigned long msm_dsi_host_get_mode_flags(struct mipi_dsi_host *host)
 	return to_msm_dsi_host(host)->mode_flags;
 }
 
+/*
+ * Limit the next command mode frames to the full width rows in @roi.  The
+ * panel's page address is moved to those rows and the MDP stream is
+ * shortened to match, so that the frame the MDP sends next is written to
+ * them instead of to the top of the panel.
+ */
+int msm_dsi_host_set_roi(struct mipi_dsi_host *host, const struct drm_rect *roi)
+{
+	struct msm_dsi_host *msm_host = to_msm_dsi_host(host);
+	const struct drm_display_mode *mode = msm_host->mode;
+	u16 first = roi->y1, last = roi->y2 - 1;
+	u8 buf[5] = {
+		MIPI_DCS_SET_PAGE_ADDRESS,
+		first >> 8, first & 0xff,
+		last >> 8, last & 0xff,
+	};
+	struct mipi_dsi_msg msg = {
+		.channel = msm_host->channel,
+		.type = MIPI_DSI_DCS_LONG_WRITE,
+		.tx_len = sizeof(buf),
+		.tx_buf = buf,
+	};
+	ssize_t ret;
+
+	if (!mode || (msm_host->mode_flags & MIPI_DSI_MODE_VIDEO) ||
+	    msm_host->dsc)
+		return -EINVAL;
+
+	if (roi->x1 || roi->x2 != mode->hdisplay ||
+	    roi->y1 < 0 || roi->y2 > mode->vdisplay || drm_rect_height(roi) <= 0)
+		return -EINVAL;
+
+	if (drm_rect_equals(roi, &msm_host->roi))
+		return 0;
+
+	ret = dsi_host_transfer(host, &msg);
+	if (ret < 0)
+		return ret;
+
+	dsi_write(msm_host, REG_DSI_CMD_MDP_STREAM0_TOTAL,
+		DSI_CMD_MDP_STREAM0_TOTAL_H_TOTAL(mode->hdisplay) |
+		DSI_CMD_MDP_STREAM0_TOTAL_V_TOTAL(drm_rect_height(roi)));
+
+	msm_host->roi = *roi;
+
+	return 0;
+}
+
 void msm_dsi_host_snapshot(struct msm_disp_state *disp_state, struct mipi_dsi_host *host)
 {
 	struct msm_dsi_host *msm_host = to_msm_dsi_host(host);
@@ -4,7 +4,9 @@
  * Author: Rob Clark <robdclark@gmail.com>
  */
 
+#include <drm/drm_atomic_helper.h>
 #include <drm/drm_atomic_uapi.h>
+#include <drm/drm_self_refresh_helper.h>
 #include <drm/drm_vblank.h>
 
 #include "msm_atomic_trace.h"
@@ -12,6 +14,10 @@
 #include "msm_gem.h"
 #include "msm_kms.h"
 
+static bool queue_commits;
+MODULE_PARM_DESC(queue_commits, "Let a nonblocking commit queue behind one still waiting for its flip (default off)");
+module_param(queue_commits, bool, 0600);
+
 /*
  * Helpers to control vblanks while we flush.. basically just to ensure
  * that vblank accounting is switched on, so we get valid seqn/timestamp
@@ -169,6 +175,31 @@ static bool can_do_async(struct drm_atomic_state *state,
  * can be used with for_each_crtc_mask() iterator, to iterate
  * effected crtcs without needing to preserve the atomic state.
  */
+/* Report the DMA-buf backed framebuffers the planes of @state flip to */
+static void trace_flips(struct drm_atomic_state *state, bool async)
+{
+	struct drm_plane_state *new_state;
+	struct drm_plane *plane;
+	struct dma_buf *dmabuf;
+	int i;
+
+	if (!trace_msm_atomic_flip_enabled())
+		return;
+
+	for_each_new_plane_in_state(state, plane, new_state, i) {
+		if (!new_state->fb || !new_state->crtc)
+			continue;
+
+		dmabuf = msm_gem_dmabuf(new_state->fb->obj[0]);
+		if (dmabuf)
+			trace_msm_atomic_flip(async,
+					      drm_crtc_index(new_state->crtc),
+					      plane->base.id,
+					      new_state->fb->base.id,
+					      dma_buf_trace_id(dmabuf));
+	}
+}
+
 static unsigned get_crtc_mask(struct drm_atomic_state *state)
 {
 	struct drm_crtc_state *crtc_state;
@@ -262,6 +293,7 @@ void msm_atomic_commit_tail(struct drm_atomic_state *state)
 
 		kms->funcs->disable_commit(kms);
 		unlock_crtcs(kms, crtc_mask);
+		trace_flips(state, true);
 		/*
 		 * At this point, from drm core's perspective, we
 		 * are done with the atomic update, so we can just
@@ -296,6 +328,7 @@ void msm_atomic_commit_tail(struct drm_atomic_state *state)
 	trace_msm_atomic_wait_flush_start(crtc_mask);
 	kms->funcs->wait_flush(kms, crtc_mask);
 	trace_msm_atomic_wait_flush_finish(crtc_mask);
+	trace_flips(state, false);
 
 	vblank_put(kms, crtc_mask);
 
@@ -309,3 +342,138 @@ void msm_atomic_commit_tail(struct drm_atomic_state *state)
 
 	trace_msm_atomic_commit_tail_finish(async, crtc_mask);
 }
+
+static void msm_atomic_commit_work(struct work_struct *work)
+{
+	struct drm_atomic_state *state = container_of(work,
+			struct drm_atomic_state, commit_work);
+	struct drm_crtc_state *new_crtc_state;
+	unsigned int i, self_refresh_mask = 0;
+	struct drm_crtc *crtc;
+	ktime_t start = ktime_get();
+	s64 commit_time_ms;
+
+	drm_atomic_helper_wait_for_fences(state->dev, state, false);
+
+	/*
+	 * For a queued commit this is where it waits for the previous one to
+	 * flip, which the crtc signals from its vblank irq, so the update is
+	 * programmed right at the start of the frame it is meant for:
+	 */
+	drm_atomic_helper_wait_for_dependencies(state);
+
+	for_each_new_crtc_in_state(state, crtc, new_crtc_state, i)
+		if (new_crtc_state->self_refresh_active)
+			self_refresh_mask |= BIT(i);
+
+	msm_atomic_commit_tail(state);
+
+	commit_time_ms = ktime_ms_delta(ktime_get(), start);
+	if (commit_time_ms > 0)
+		drm_self_refresh_helper_update_avg_times(state,
+				(unsigned long)commit_time_ms,
+				self_refresh_mask);
+
+	drm_atomic_helper_commit_cleanup_done(state);
+	drm_atomic_state_put(state);
+}
+
+static unsigned pending_flips(struct drm_crtc *crtc)
+{
+	struct drm_crtc_commit *commit;
+	unsigned n = 0;
+
+	spin_lock(&crtc->commit_lock);
+	list_for_each_entry(commit, &crtc->commit_list, commit_entry)
+		if (!try_wait_for_completion(&commit->flip_done))
+			n++;
+	spin_unlock(&crtc->commit_lock);
+
+	return n;
+}
+
+/*
+ * A nonblocking commit can be queued behind at most one commit that is still
+ * waiting for its flip, on each crtc it touches.  Anything which could need
+ * more than a plane update (modesets, connector changes) or which touches a
+ * plane still busy flipping on some other crtc goes through the helper, which
+ * returns -EBUSY as usual.
+ */
+static bool can_queue(struct drm_atomic_state *state)
+{
+	struct drm_connector_state *connector_state;
+	struct drm_plane_state *old_plane_state;
+	struct drm_crtc_state *crtc_state;
+	struct drm_connector *connector;
+	struct drm_plane *plane;
+	struct drm_crtc *crtc;
+	unsigned crtc_mask = get_crtc_mask(state);
+	int i;
+
+	for_each_new_connector_in_state(state, connector, connector_state, i)
+		return false;
+
+	for_each_new_crtc_in_state(state, crtc, crtc_state, i) {
+		if (drm_atomic_crtc_needs_modeset(crtc_state))
+			return false;
+		if (pending_flips(crtc) > 1)
+			return false;
+	}
+
+	for_each_old_plane_in_state(state, plane, old_plane_state, i) {
+		struct drm_crtc_commit *commit = old_plane_state->commit;
+
+		if (commit && !try_wait_for_completion(&commit->flip_done) &&
+		    !(crtc_mask & drm_crtc_mask(commit->crtc)))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Same as drm_atomic_helper_commit(), except that with queue_commits set a
+ * nonblocking commit doesn't fail with -EBUSY just because the previous one
+ * on the same crtc hasn't flipped yet.  That soaks up compositor jitter: a
+ * frame which comes in late in the previous frame's vblank period can still
+ * make the next one, instead of the compositor having to wait for the flip
+ * event before it can even submit it.
+ */
+int msm_atomic_commit(struct drm_device *dev,
+		struct drm_atomic_state *state, bool nonblock)
+{
+	int ret;
+
+	if (!nonblock || !READ_ONCE(queue_commits) || state->async_update ||
+	    !can_queue(state))
+		return drm_atomic_helper_commit(dev, state, nonblock);
+
+	/*
+	 * The stall checks for blocking commits don't care whether the last
+	 * commit has flipped, they only wait for cleanup of the one before
+	 * it.  That one has flipped already (see can_queue()), so this won't
+	 * stall for more than its cleanup.
+	 */
+	ret = drm_atomic_helper_setup_commit(state, false);
+	if (ret)
+		return ret;
+
+	INIT_WORK(&state->commit_work, msm_atomic_commit_work);
+
+	ret = drm_atomic_helper_prepare_planes(dev, state);
+	if (ret)
+		return ret;
+
+	ret = drm_atomic_helper_swap_state(state, true);
+	if (ret) {
+		drm_atomic_helper_unprepare_planes(dev, state);
+		return ret;
+	}
+
+	trace_msm_atomic_commit_queued(get_crtc_mask(state));
+
+	drm_atomic_state_get(state);
+	queue_work(system_unbound_wq, &state->commit_work);
+
+	return 0;
+}
@@ -64,6 +64,19 @@ TRACE_EVENT(msm_atomic_async_commit_finish,
 		    __entry->crtc_mask)
 );
 
+TRACE_EVENT(msm_atomic_commit_queued,
+	    TP_PROTO(unsigned crtc_mask),
+	    TP_ARGS(crtc_mask),
+	    TP_STRUCT__entry(
+		    __field(u32, crtc_mask)
+		    ),
+	    TP_fast_assign(
+		    __entry->crtc_mask = crtc_mask;
+		    ),
+	    TP_printk("crtc_mask=%x",
+		    __entry->crtc_mask)
+);
+
 TRACE_EVENT(msm_atomic_wait_flush_start,
 	    TP_PROTO(unsigned crtc_mask),
 	    TP_ARGS(crtc_mask),
@@ -103,6 +116,34 @@ TRACE_EVENT(msm_atomic_flush_commit,
 		    __entry->crtc_mask)
 );
 
+/*
+ * A framebuffer shared through a DMA-buf, identified as by dma_buf_trace_id(),
+ * being flipped to on a plane. For synchronous commits this is emitted once
+ * the flush has completed, for async ones when the update is programmed, the
+ * flush then follows with msm_atomic_flush_commit for the crtc.
+ */
+TRACE_EVENT(msm_atomic_flip,
+	    TP_PROTO(bool async, u32 crtc, u32 plane, u32 fb, u64 dmabuf),
+	    TP_ARGS(async, crtc, plane, fb, dmabuf),
+	    TP_STRUCT__entry(
+		    __field(bool, async)
+		    __field(u32, crtc)
+		    __field(u32, plane)
+		    __field(u32, fb)
+		    __field(u64, dmabuf)
+		    ),
+	    TP_fast_assign(
+		    __entry->async = async;
+		    __entry->crtc = crtc;
+		    __entry->plane = plane;
+		    __entry->fb = fb;
+		    __entry->dmabuf = dmabuf;
+		    ),
+	    TP_printk("async=%d crtc=%u plane=%u fb=%u dmabuf=%llu",
+		    __entry->async, __entry->crtc, __entry->plane,
+		    __entry->fb, __entry->dmabuf)
+);
+
 #endif
 
 #undef TRACE_INCLUDE_PATH
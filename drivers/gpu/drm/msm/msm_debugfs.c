@@ -227,6 +227,57 @@ static int msm_gem_show(struct seq_file *m, void *arg)
 	return 0;
 }
 
+static int msm_submit_latency_show(struct seq_file *m, void *arg)
+{
+	struct drm_info_node *node = m->private;
+	struct drm_device *dev = node->minor->dev;
+	struct drm_file *file;
+	int ret;
+
+	ret = mutex_lock_interruptible(&dev->filelist_mutex);
+	if (ret)
+		return ret;
+
+	list_for_each_entry(file, &dev->filelist, lhead) {
+		struct msm_file_private *ctx = file->driver_priv;
+		struct task_struct *task;
+
+		rcu_read_lock();
+		task = pid_task(file->pid, PIDTYPE_TGID);
+		seq_printf(m, "client %s[%d]:\n", task ? task->comm : "?",
+			   pid_vnr(file->pid));
+		rcu_read_unlock();
+
+		msm_submitqueue_show_latency(ctx, m);
+	}
+
+	mutex_unlock(&dev->filelist_mutex);
+
+	return 0;
+}
+
+static int msm_zcomp_show(struct seq_file *m, void *arg)
+{
+	struct drm_info_node *node = m->private;
+	struct drm_device *dev = node->minor->dev;
+
+	msm_gem_zcomp_describe(dev, m);
+
+	return 0;
+}
+
+static int msm_suballoc_show(struct seq_file *m, void *arg)
+{
+	struct drm_info_node *node = m->private;
+	struct drm_device *dev = node->minor->dev;
+	struct msm_drm_private *priv = dev->dev_private;
+
+	if (priv->gpu)
+		msm_suballoc_pool_describe(&priv->gpu->suballoc, m);
+
+	return 0;
+}
+
 static int msm_mm_show(struct seq_file *m, void *arg)
 {
 	struct drm_info_node *node = m->private;
@@ -267,6 +318,9 @@ static struct drm_info_list msm_debugfs_list[] = {
 		{"gem", msm_gem_show},
 		{ "mm", msm_mm_show },
 		{ "fb", msm_fb_show },
+		{ "zcomp", msm_zcomp_show },
+		{ "suballoc", msm_suballoc_show },
+		{ "submit_latency", msm_submit_latency_show },
 };
 
 static int late_init_minor(struct drm_minor *minor)
@@ -305,7 +359,7 @@ void msm_debugfs_init(struct drm_minor *minor)
 {
 	struct drm_device *dev = minor->dev;
 	struct msm_drm_private *priv = dev->dev_private;
-	struct dentry *gpu_devfreq;
+	struct dentry *gpu_devfreq, *bg_evict;
 
 	drm_debugfs_create_files(msm_debugfs_list,
 				 ARRAY_SIZE(msm_debugfs_list),
@@ -326,6 +380,11 @@ void msm_debugfs_init(struct drm_minor *minor)
 	debugfs_create_file("shrink", S_IRWXU, minor->debugfs_root,
 		dev, &shrink_fops);
 
+	bg_evict = debugfs_create_dir("bg_evict", minor->debugfs_root);
+	debugfs_create_ulong("runs", 0400, bg_evict, &priv->bg_evict.runs);
+	debugfs_create_ulong("purged", 0400, bg_evict, &priv->bg_evict.purged);
+	debugfs_create_ulong("evicted", 0400, bg_evict, &priv->bg_evict.evicted);
+
 	gpu_devfreq = debugfs_create_dir("devfreq", minor->debugfs_root);
 
 	debugfs_create_bool("idle_clamp",0600, gpu_devfreq,
@@ -59,7 +59,7 @@ static void msm_deinit_vram(struct drm_device *ddev);
 static const struct drm_mode_config_funcs mode_config_funcs = {
 	.fb_create = msm_framebuffer_create,
 	.atomic_check = msm_atomic_check,
-	.atomic_commit = drm_atomic_helper_commit,
+	.atomic_commit = msm_atomic_commit,
 };
 
 static const struct drm_mode_config_helper_funcs mode_config_helper_funcs = {
@@ -229,6 +229,7 @@ static int msm_drm_uninit(struct device *dev)
 	}
 
 	msm_gem_shrinker_cleanup(ddev);
+	msm_gemfs_cleanup(ddev);
 
 	drm_kms_helper_poll_fini(ddev);
 
@@ -452,6 +453,9 @@ static int msm_drm_init(struct device *dev, const struct drm_driver *drv)
 
 	dma_set_max_seg_size(dev, UINT_MAX);
 
+	/* Before the sub-components allocate their objects: */
+	msm_gemfs_init(ddev);
+
 	/* Bind all our sub-components: */
 	ret = component_bind_all(dev, ddev);
 	if (ret)
@@ -556,6 +560,7 @@ static int msm_drm_init(struct device *dev, const struct drm_driver *drv)
 	return ret;
 
 err_deinit_vram:
+	msm_gemfs_cleanup(ddev);
 	msm_deinit_vram(ddev);
 err_cleanup_mode_config:
 	drm_mode_config_cleanup(ddev);
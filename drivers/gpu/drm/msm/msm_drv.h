@@ -213,6 +213,28 @@ struct msm_drm_private {
 	struct notifier_block vmap_notifier;
 	struct shrinker shrinker;
 
+	/**
+	 * bg_evict:
+	 *
+	 * Background reclaim of dontneed and willneed objects, kicked by the
+	 * shrinker so that direct reclaim doesn't have to wait for the GPU
+	 * to be done with an object, or unmap and release its pages, itself.
+	 * The counters, in pages, are only updated by the worker.
+	 */
+	struct {
+		struct kthread_worker *worker;
+		struct kthread_work work;
+		unsigned long runs;
+		unsigned long purged;
+		unsigned long evicted;
+	} bg_evict;
+
+	/* Compressed backing for evicted objects, see msm_gem_zcomp.c */
+	struct msm_gem_zcomp *zcomp;
+
+	/* Private tmpfs mount backing objects with huge pages, or NULL */
+	struct vfsmount *gemfs;
+
 	struct drm_atomic_state *pm_state;
 
 	/**
@@ -252,6 +274,8 @@ int msm_atomic_init_pending_timer(struct msm_pending_timer *timer,
 		struct msm_kms *kms, int crtc_idx);
 void msm_atomic_destroy_pending_timer(struct msm_pending_timer *timer);
 void msm_atomic_commit_tail(struct drm_atomic_state *state);
+int msm_atomic_commit(struct drm_device *dev,
+		struct drm_atomic_state *state, bool nonblock);
 int msm_atomic_check(struct drm_device *dev, struct drm_atomic_state *state);
 struct drm_atomic_state *msm_atomic_state_alloc(struct drm_device *dev);
 void msm_atomic_state_clear(struct drm_atomic_state *state);
@@ -276,6 +300,9 @@ unsigned long msm_gem_shrinker_shrink(struct drm_device *dev, unsigned long nr_t
 void msm_gem_shrinker_init(struct drm_device *dev);
 void msm_gem_shrinker_cleanup(struct drm_device *dev);
 
+void msm_gemfs_init(struct drm_device *dev);
+void msm_gemfs_cleanup(struct drm_device *dev);
+
 struct sg_table *msm_gem_prime_get_sg_table(struct drm_gem_object *obj);
 int msm_gem_prime_vmap(struct drm_gem_object *obj, struct iosys_map *map);
 void msm_gem_prime_vunmap(struct drm_gem_object *obj, struct iosys_map *map);
@@ -334,6 +361,7 @@ bool msm_dsi_is_cmd_mode(struct msm_dsi *msm_dsi);
 bool msm_dsi_is_bonded_dsi(struct msm_dsi *msm_dsi);
 bool msm_dsi_is_master_dsi(struct msm_dsi *msm_dsi);
 struct drm_dsc_config *msm_dsi_get_dsc_config(struct msm_dsi *msm_dsi);
+int msm_dsi_set_roi(struct msm_dsi *msm_dsi, const struct drm_rect *roi);
 #else
 static inline void __init msm_dsi_register(void)
 {
@@ -367,6 +395,11 @@ static inline struct drm_dsc_config *msm_dsi_get_dsc_config(struct msm_dsi *msm_
 {
 	return NULL;
 }
+
+static inline int msm_dsi_set_roi(struct msm_dsi *msm_dsi, const struct drm_rect *roi)
+{
+	return -ENODEV;
+}
 #endif
 
 #ifdef CONFIG_DRM_MSM_DP
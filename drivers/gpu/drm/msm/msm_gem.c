@@ -5,9 +5,13 @@
  */
 
 #include <linux/dma-map-ops.h>
+#include <linux/fs.h>
+#include <linux/huge_mm.h>
+#include <linux/mount.h>
 #include <linux/vmalloc.h>
 #include <linux/spinlock.h>
 #include <linux/shmem_fs.h>
+#include <linux/swap.h>
 #include <linux/dma-buf.h>
 #include <linux/pfn_t.h>
 
@@ -19,6 +23,10 @@
 #include "msm_gpu.h"
 #include "msm_mmu.h"
 
+static bool enable_thp = true;
+MODULE_PARM_DESC(enable_thp, "Back GEM objects with transparent huge pages when possible");
+module_param(enable_thp, bool, 0400);
+
 static dma_addr_t physaddr(struct drm_gem_object *obj)
 {
 	struct msm_gem_object *msm_obj = to_msm_bo(obj);
@@ -158,6 +166,14 @@ static struct page **get_pages(struct drm_gem_object *obj)
 
 		msm_obj->pages = p;
 
+		/* Bring back the contents of a compressed evicted object.  This
+		 * has to happen before the sync below, as it writes the pages
+		 * through the kernel's cached mapping:
+		 */
+		if (msm_gem_zcomp_load(obj))
+			DRM_DEV_ERROR(dev->dev, "could not decompress %s\n",
+					msm_obj->name);
+
 		msm_obj->sgt = drm_prime_pages_to_sg(obj->dev, p, npages);
 		if (IS_ERR(msm_obj->sgt)) {
 			void *ptr = ERR_CAST(msm_obj->sgt);
@@ -828,6 +844,8 @@ void msm_gem_purge(struct drm_gem_object *obj)
 
 	put_iova_vmas(obj);
 
+	msm_gem_zcomp_free(obj);
+
 	mutex_lock(&priv->lru.lock);
 	/* A one-way transition: */
 	msm_obj->madv = __MSM_MADV_PURGED;
@@ -848,21 +866,43 @@ void msm_gem_purge(struct drm_gem_object *obj)
 
 /*
  * Unpin the backing pages and make them available to be swapped out.
+ *
+ * Returns false if the object was left alone.
  */
-void msm_gem_evict(struct drm_gem_object *obj)
+bool msm_gem_evict(struct drm_gem_object *obj)
 {
 	struct drm_device *dev = obj->dev;
 	struct msm_gem_object *msm_obj = to_msm_bo(obj);
+	bool compressed = false;
 
 	msm_gem_assert_locked(obj);
 	GEM_WARN_ON(is_unevictable(msm_obj));
 
+	/* With nowhere to swap to, keep a compressed copy and drop the pages
+	 * for real, or else evicting gains nothing.  The copy is read through
+	 * the kernel's cached mapping, so make sure it sees what the GPU wrote
+	 * first:
+	 */
+	if (use_pages(obj) && msm_gem_zcomp_enabled(dev) &&
+	    get_nr_swap_pages() <= 0) {
+		if (msm_obj->flags & MSM_BO_WC)
+			sync_for_cpu(msm_obj);
+		if (msm_gem_zcomp_store(obj))
+			return false;
+		compressed = true;
+	}
+
 	/* Get rid of any iommu mapping(s): */
 	put_iova_spaces(obj, false);
 
 	drm_vma_node_unmap(&obj->vma_node, dev->anon_inode->i_mapping);
 
 	put_pages(obj);
+
+	if (compressed)
+		shmem_truncate_range(file_inode(obj->filp), 0, (loff_t)-1);
+
+	return true;
 }
 
 void msm_gem_vunmap(struct drm_gem_object *obj)
@@ -1054,6 +1094,7 @@ static void msm_gem_free_object(struct drm_gem_object *obj)
 		msm_gem_vunmap(obj);
 		put_pages(obj);
 		put_iova_vmas(obj);
+		msm_gem_zcomp_free(obj);
 	}
 
 	drm_gem_object_release(obj);
@@ -1164,6 +1205,68 @@ static int msm_gem_new_impl(struct drm_device *dev,
 	return 0;
 }
 
+/*
+ * Objects are allocated from a private tmpfs mount, which unlike the kernel's
+ * internal shmem mount can ask for huge pages, so that objects of 2MB and
+ * more are backed by PMD sized folios where memory allows.  Those come out
+ * of drm_gem_get_pages() as physically contiguous runs of pages, which
+ * drm_prime_pages_to_sg() coalesces into a single sg entry and the IOMMU
+ * then maps with block mappings instead of 4K pages.
+ */
+void msm_gemfs_init(struct drm_device *dev)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	char huge_opt[] = "huge=within_size";
+	struct file_system_type *type;
+	struct vfsmount *gemfs;
+
+	if (!enable_thp || !has_transparent_hugepage())
+		return;
+
+	type = get_fs_type("tmpfs");
+	if (!type)
+		return;
+
+	gemfs = vfs_kern_mount(type, SB_KERNMOUNT, type->name, huge_opt);
+	if (IS_ERR(gemfs)) {
+		DRM_DEV_INFO(dev->dev, "no huge page backing for GEM objects: %ld\n",
+			     PTR_ERR(gemfs));
+		return;
+	}
+
+	priv->gemfs = gemfs;
+}
+
+void msm_gemfs_cleanup(struct drm_device *dev)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+
+	if (priv->gemfs)
+		kern_unmount(priv->gemfs);
+	priv->gemfs = NULL;
+}
+
+static int msm_gem_object_init(struct drm_device *dev,
+		struct drm_gem_object *obj, size_t size)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	struct file *filp;
+
+	if (!priv->gemfs)
+		return drm_gem_object_init(dev, obj, size);
+
+	drm_gem_private_object_init(dev, obj, size);
+
+	filp = shmem_file_setup_with_mnt(priv->gemfs, "drm mm object", size,
+					 VM_NORESERVE);
+	if (IS_ERR(filp))
+		return PTR_ERR(filp);
+
+	obj->filp = filp;
+
+	return 0;
+}
+
 struct drm_gem_object *msm_gem_new(struct drm_device *dev, uint32_t size, uint32_t flags)
 {
 	struct msm_drm_private *priv = dev->dev_private;
@@ -1221,7 +1324,7 @@ struct drm_gem_object *msm_gem_new(struct drm_device *dev, uint32_t size, uint32
 
 		vma->iova = physaddr(obj);
 	} else {
-		ret = drm_gem_object_init(dev, obj, size);
+		ret = msm_gem_object_init(dev, obj, size);
 		if (ret)
 			goto fail;
 		/*
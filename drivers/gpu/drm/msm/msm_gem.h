@@ -8,7 +8,9 @@
 #define __MSM_GEM_H__
 
 #include <linux/kref.h>
+#include <linux/dma-buf.h>
 #include <linux/dma-resv.h>
+#include <drm/drm_suballoc.h>
 #include "drm/gpu_scheduler.h"
 #include "msm_drv.h"
 
@@ -108,6 +110,13 @@ struct msm_gem_object {
 
 	char name[32]; /* Identifier to print for the debugfs files */
 
+	/**
+	 * zpages: Compressed copy of the pages of an evicted object
+	 *
+	 * Protected by obj lock.
+	 */
+	struct msm_gem_zpage *zpages;
+
 	/**
 	 * pin_count: Number of times the pages are pinned
 	 *
@@ -239,14 +248,71 @@ static inline bool is_unevictable(struct msm_gem_object *msm_obj)
 	return is_unpurgeable(msm_obj) || msm_obj->vaddr;
 }
 
+/* the DMA-buf the object is imported from or exported as, if any: */
+static inline struct dma_buf *msm_gem_dmabuf(struct drm_gem_object *obj)
+{
+	return obj->import_attach ? obj->import_attach->dmabuf : obj->dma_buf;
+}
+
 void msm_gem_purge(struct drm_gem_object *obj);
-void msm_gem_evict(struct drm_gem_object *obj);
+bool msm_gem_evict(struct drm_gem_object *obj);
+
+#ifdef CONFIG_DRM_MSM_GEM_ZCOMP
+bool msm_gem_zcomp_enabled(struct drm_device *dev);
+int msm_gem_zcomp_store(struct drm_gem_object *obj);
+int msm_gem_zcomp_load(struct drm_gem_object *obj);
+void msm_gem_zcomp_free(struct drm_gem_object *obj);
+void msm_gem_zcomp_describe(struct drm_device *dev, struct seq_file *m);
+void msm_gem_zcomp_init(struct drm_device *dev);
+void msm_gem_zcomp_cleanup(struct drm_device *dev);
+#else
+static inline bool msm_gem_zcomp_enabled(struct drm_device *dev) { return false; }
+static inline int msm_gem_zcomp_store(struct drm_gem_object *obj) { return -EOPNOTSUPP; }
+static inline int msm_gem_zcomp_load(struct drm_gem_object *obj) { return 0; }
+static inline void msm_gem_zcomp_free(struct drm_gem_object *obj) {}
+static inline void msm_gem_zcomp_describe(struct drm_device *dev, struct seq_file *m) {}
+static inline void msm_gem_zcomp_init(struct drm_device *dev) {}
+static inline void msm_gem_zcomp_cleanup(struct drm_device *dev) {}
+#endif
 void msm_gem_vunmap(struct drm_gem_object *obj);
 
+/* A slab small GPU buffers are sub-allocated from, see msm_gem_suballoc.c */
+struct msm_suballoc_pool {
+	struct drm_suballoc_manager manager;
+	struct drm_gem_object *bo;
+	struct msm_gem_address_space *aspace;
+	void *vaddr;
+	uint64_t iova;
+};
+
+int msm_suballoc_pool_init(struct msm_suballoc_pool *pool,
+		struct drm_device *dev, uint32_t size, uint32_t flags,
+		struct msm_gem_address_space *aspace, const char *name);
+void msm_suballoc_pool_fini(struct msm_suballoc_pool *pool);
+struct drm_suballoc *msm_suballoc_new(struct msm_suballoc_pool *pool,
+		size_t size, void **vaddr, uint64_t *iova);
+void msm_suballoc_free(struct drm_suballoc *sa, struct dma_fence *fence);
+#ifdef CONFIG_DEBUG_FS
+void msm_suballoc_pool_describe(struct msm_suballoc_pool *pool,
+		struct seq_file *m);
+#endif
+
 /* Created per submit-ioctl, to track bo's and cmdstream bufs, etc,
  * associated with the cmdstream submission for synchronization (and
  * make it easier to unwind when things go wrong, etc).
  */
+/* Points in a submit's life at which it is timestamped, see submit->ts[]: */
+enum msm_submit_ts {
+	MSM_SUBMIT_TS_CREATE,	/* submit ioctl allocated the submit */
+	MSM_SUBMIT_TS_LOOKUP,	/* bos and cmds copied in and looked up */
+	MSM_SUBMIT_TS_LOCKED,	/* bos locked, implicit fences collected */
+	MSM_SUBMIT_TS_PINNED,	/* bos pinned */
+	MSM_SUBMIT_TS_QUEUED,	/* pushed to the scheduler */
+	MSM_SUBMIT_TS_RUN,	/* dependencies signaled, msm_job_run() called */
+	MSM_SUBMIT_TS_FLUSHED,	/* written to the ringbuffer and flushed */
+	MSM_SUBMIT_TS_COUNT,
+};
+
 struct msm_gem_submit {
 	struct drm_sched_job base;
 	struct kref ref;
@@ -277,6 +343,8 @@ struct msm_gem_submit {
 	unsigned int nr_cmds;
 	unsigned int nr_bos;
 	u32 ident;	   /* A "identifier" for the submit for logging */
+	ktime_t ts[MSM_SUBMIT_TS_COUNT];
+	ktime_t deadline;  /* fence deadline we boosted for, or zero */
 	struct {
 		uint32_t type;
 		uint32_t size;  /* in dwords */
@@ -19,9 +19,24 @@ static bool enable_eviction = true;
 MODULE_PARM_DESC(enable_eviction, "Enable swappable GEM buffers");
 module_param(enable_eviction, bool, 0600);
 
-static bool can_swap(void)
+/* Free memory, in KiB, which the background evictor tries to maintain.  When
+ * set, direct reclaim only purges idle dontneed objects and leaves the
+ * expensive eviction work to the background worker:
+ */
+static unsigned int background_evict_kb;
+MODULE_PARM_DESC(background_evict_kb, "Free memory target (KiB) for background GEM eviction, 0 to disable");
+module_param(background_evict_kb, uint, 0600);
+
+/* Pages reclaimed per LRU scan by the background evictor */
+#define BG_EVICT_BATCH	512
+
+static bool can_swap(struct msm_drm_private *priv)
 {
-	return enable_eviction && get_nr_swap_pages() > 0;
+	if (!enable_eviction)
+		return false;
+
+	/* Without swap, evicted objects can still be compressed in memory: */
+	return get_nr_swap_pages() > 0 || msm_gem_zcomp_enabled(priv->dev);
 }
 
 static bool can_block(struct shrink_control *sc)
@@ -38,7 +53,7 @@ msm_gem_shrinker_count(struct shrinker *shrinker, struct shrink_control *sc)
 		container_of(shrinker, struct msm_drm_private, shrinker);
 	unsigned count = priv->lru.dontneed.count;
 
-	if (can_swap())
+	if (can_swap(priv))
 		count += priv->lru.willneed.count;
 
 	return count;
@@ -67,9 +82,7 @@ evict(struct drm_gem_object *obj)
 	if (msm_gem_active(obj))
 		return false;
 
-	msm_gem_evict(obj);
-
-	return true;
+	return msm_gem_evict(obj);
 }
 
 static bool
@@ -97,6 +110,55 @@ active_evict(struct drm_gem_object *obj)
 	return evict(obj);
 }
 
+static bool bg_evict_enabled(struct msm_drm_private *priv)
+{
+	return priv->bg_evict.worker && READ_ONCE(background_evict_kb);
+}
+
+static bool bg_evict_below_target(void)
+{
+	unsigned long target = READ_ONCE(background_evict_kb) >> (PAGE_SHIFT - 10);
+
+	return global_zone_page_state(NR_FREE_PAGES) < target;
+}
+
+static void
+msm_gem_bg_evict_work(struct kthread_work *work)
+{
+	struct msm_drm_private *priv =
+		container_of(work, struct msm_drm_private, bg_evict.work);
+	struct {
+		struct drm_gem_lru *lru;
+		bool (*shrink)(struct drm_gem_object *obj);
+		bool cond;
+		unsigned long *count;
+	} stages[] = {
+		/* Unlike direct reclaim, waiting for the GPU is fine here: */
+		{ &priv->lru.dontneed, active_purge, true,       &priv->bg_evict.purged },
+		{ &priv->lru.willneed, active_evict, can_swap(priv), &priv->bg_evict.evicted },
+	};
+	unsigned long freed, remaining;
+
+	WRITE_ONCE(priv->bg_evict.runs, priv->bg_evict.runs + 1);
+
+	for (unsigned i = 0; i < ARRAY_SIZE(stages); i++) {
+		if (!stages[i].cond)
+			continue;
+
+		/* Work in batches, so objects don't stay locked out for long: */
+		while (bg_evict_below_target()) {
+			remaining = 0;
+			freed = drm_gem_lru_scan(stages[i].lru, BG_EVICT_BATCH,
+						 &remaining, stages[i].shrink);
+			if (!freed)
+				break;
+
+			WRITE_ONCE(*stages[i].count, *stages[i].count + freed);
+			cond_resched();
+		}
+	}
+}
+
 static unsigned long
 msm_gem_shrinker_scan(struct shrinker *shrinker, struct shrink_control *sc)
 {
@@ -111,14 +173,23 @@ msm_gem_shrinker_scan(struct shrinker *shrinker, struct shrink_control *sc)
 	} stages[] = {
 		/* Stages of progressively more aggressive/expensive reclaim: */
 		{ &priv->lru.dontneed, purge,        true },
-		{ &priv->lru.willneed, evict,        can_swap() },
+		{ &priv->lru.willneed, evict,        can_swap(priv) },
 		{ &priv->lru.dontneed, active_purge, can_block(sc) },
-		{ &priv->lru.willneed, active_evict, can_swap() && can_block(sc) },
+		{ &priv->lru.willneed, active_evict, can_swap(priv) && can_block(sc) },
 	};
 	long nr = sc->nr_to_scan;
 	unsigned long freed = 0;
 	unsigned long remaining = 0;
 
+	/* Hand everything but cheap purging off to the background worker, so
+	 * that an allocating task isn't stalled behind eviction:
+	 */
+	if (bg_evict_enabled(priv) && !current_is_kswapd()) {
+		kthread_queue_work(priv->bg_evict.worker, &priv->bg_evict.work);
+		for (unsigned i = 1; i < ARRAY_SIZE(stages); i++)
+			stages[i].cond = false;
+	}
+
 	for (unsigned i = 0; (nr > 0) && (i < ARRAY_SIZE(stages)); i++) {
 		if (!stages[i].cond)
 			continue;
@@ -213,6 +284,16 @@ msm_gem_shrinker_vmap(struct notifier_block *nb, unsigned long event, void *ptr)
 void msm_gem_shrinker_init(struct drm_device *dev)
 {
 	struct msm_drm_private *priv = dev->dev_private;
+
+	msm_gem_zcomp_init(dev);
+
+	kthread_init_work(&priv->bg_evict.work, msm_gem_bg_evict_work);
+	priv->bg_evict.worker = kthread_create_worker(0, "msm-evict");
+	if (IS_ERR(priv->bg_evict.worker)) {
+		DRM_DEV_ERROR(dev->dev, "failed to create evict worker\n");
+		priv->bg_evict.worker = NULL;
+	}
+
 	priv->shrinker.count_objects = msm_gem_shrinker_count;
 	priv->shrinker.scan_objects = msm_gem_shrinker_scan;
 	priv->shrinker.seeks = DEFAULT_SEEKS;
@@ -236,4 +317,11 @@ void msm_gem_shrinker_cleanup(struct drm_device *dev)
 		WARN_ON(unregister_vmap_purge_notifier(&priv->vmap_notifier));
 		unregister_shrinker(&priv->shrinker);
 	}
+
+	if (priv->bg_evict.worker) {
+		kthread_destroy_worker(priv->bg_evict.worker);
+		priv->bg_evict.worker = NULL;
+	}
+
+	msm_gem_zcomp_cleanup(dev);
 }
@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+
+/*
+ * Sub-allocation of small GPU buffers from a shared slab.
+ *
+ * Every buffer object costs a GEM object, a VMA with its own IOMMU mapping,
+ * and an entry in the BO list of the submits using it.  Small buffers that
+ * live in the same address space are instead carved out of one slab BO,
+ * which is pinned and mapped for the CPU and the GPU once, with drm_suballoc
+ * tracking the free space.  A range freed with a fence is only handed out
+ * again once the fence has signaled, so a buffer can be released while the
+ * GPU may still be using it.
+ */
+
+#include <drm/drm_print.h>
+
+#include "msm_drv.h"
+#include "msm_gem.h"
+
+/* Enough for the GPU's 128 bit accesses to a sub-allocation */
+#define MSM_SUBALLOC_ALIGN	16
+
+int msm_suballoc_pool_init(struct msm_suballoc_pool *pool,
+		struct drm_device *dev, uint32_t size, uint32_t flags,
+		struct msm_gem_address_space *aspace, const char *name)
+{
+	void *vaddr;
+
+	vaddr = msm_gem_kernel_new(dev, size, flags, aspace, &pool->bo,
+			&pool->iova);
+	if (IS_ERR(vaddr)) {
+		pool->bo = NULL;
+		return PTR_ERR(vaddr);
+	}
+
+	msm_gem_object_set_name(pool->bo, "%s", name);
+
+	pool->vaddr = vaddr;
+	pool->aspace = aspace;
+	drm_suballoc_manager_init(&pool->manager, size, MSM_SUBALLOC_ALIGN);
+
+	return 0;
+}
+
+void msm_suballoc_pool_fini(struct msm_suballoc_pool *pool)
+{
+	if (!pool->bo)
+		return;
+
+	drm_suballoc_manager_fini(&pool->manager);
+	msm_gem_kernel_put(pool->bo, pool->aspace);
+	pool->bo = NULL;
+}
+
+/**
+ * msm_suballoc_new - allocate a small buffer from a pool
+ * @pool: the pool to allocate from
+ * @size: size of the buffer
+ * @vaddr: returns the kernel address of the buffer, if not NULL
+ * @iova: returns the GPU address of the buffer, if not NULL
+ *
+ * Waits, interruptibly, for the fences of freed buffers if the pool is
+ * full.
+ */
+struct drm_suballoc *msm_suballoc_new(struct msm_suballoc_pool *pool,
+		size_t size, void **vaddr, uint64_t *iova)
+{
+	struct drm_suballoc *sa;
+
+	sa = drm_suballoc_new(&pool->manager, size, GFP_KERNEL, true, 0);
+	if (IS_ERR(sa))
+		return sa;
+
+	if (vaddr)
+		*vaddr = pool->vaddr + drm_suballoc_soffset(sa);
+	if (iova)
+		*iova = pool->iova + drm_suballoc_soffset(sa);
+
+	return sa;
+}
+
+/**
+ * msm_suballoc_free - free a buffer allocated with msm_suballoc_new()
+ * @sa: the buffer, may be NULL
+ * @fence: fence after which the GPU no longer uses the buffer, or NULL
+ */
+void msm_suballoc_free(struct drm_suballoc *sa, struct dma_fence *fence)
+{
+	if (!IS_ERR_OR_NULL(sa))
+		drm_suballoc_free(sa, fence);
+}
+
+#ifdef CONFIG_DEBUG_FS
+void msm_suballoc_pool_describe(struct msm_suballoc_pool *pool,
+		struct seq_file *m)
+{
+	struct drm_printer p = drm_seq_file_printer(m);
+
+	if (pool->bo)
+		drm_suballoc_dump_debug_info(&pool->manager, &p, pool->iova);
+}
+#endif
@@ -56,6 +56,7 @@ static struct msm_gem_submit *submit_create(struct drm_device *dev,
 	}
 
 	kref_init(&submit->ref);
+	submit->ts[MSM_SUBMIT_TS_CREATE] = ktime_get();
 	submit->dev = dev;
 	submit->aspace = queue->ctx->aspace;
 	submit->gpu = gpu;
@@ -112,42 +113,51 @@ void __msm_gem_submit_destroy(struct kref *kref)
 static int submit_lookup_objects(struct msm_gem_submit *submit,
 		struct drm_msm_gem_submit *args, struct drm_file *file)
 {
+	struct drm_msm_gem_submit_bo *submit_bos;
 	unsigned i;
 	int ret = 0;
 
-	for (i = 0; i < args->nr_bos; i++) {
-		struct drm_msm_gem_submit_bo submit_bo;
-		void __user *userptr =
-			u64_to_user_ptr(args->bos + (i * sizeof(submit_bo)));
-
-		/* make sure we don't have garbage flags, in case we hit
-		 * error path before flags is initialized:
-		 */
+	/* make sure we don't have garbage flags, in case we hit
+	 * error path before flags is initialized:
+	 */
+	for (i = 0; i < args->nr_bos; i++)
 		submit->bos[i].flags = 0;
 
-		if (copy_from_user(&submit_bo, userptr, sizeof(submit_bo))) {
-			ret = -EFAULT;
-			i = 0;
-			goto out;
-		}
+	/*
+	 * Large submits carry hundreds of bos, so pull the whole table in
+	 * with a single copy rather than one copy_from_user() per entry:
+	 */
+	submit_bos = vmemdup_user(u64_to_user_ptr(args->bos),
+				  array_size(args->nr_bos, sizeof(*submit_bos)));
+	if (IS_ERR(submit_bos)) {
+		ret = PTR_ERR(submit_bos);
+		i = 0;
+		goto out;
+	}
+
+	for (i = 0; i < args->nr_bos; i++) {
+		struct drm_msm_gem_submit_bo *submit_bo = &submit_bos[i];
 
 /* at least one of READ and/or WRITE flags should be set: */
 #define MANDATORY_FLAGS (MSM_SUBMIT_BO_READ | MSM_SUBMIT_BO_WRITE)
 
-		if ((submit_bo.flags & ~MSM_SUBMIT_BO_FLAGS) ||
-			!(submit_bo.flags & MANDATORY_FLAGS)) {
-			DRM_ERROR("invalid flags: %x\n", submit_bo.flags);
+		if ((submit_bo->flags & ~MSM_SUBMIT_BO_FLAGS) ||
+			!(submit_bo->flags & MANDATORY_FLAGS)) {
+			DRM_ERROR("invalid flags: %x\n", submit_bo->flags);
+			kvfree(submit_bos);
 			ret = -EINVAL;
 			i = 0;
 			goto out;
 		}
 
-		submit->bos[i].handle = submit_bo.handle;
-		submit->bos[i].flags = submit_bo.flags;
+		submit->bos[i].handle = submit_bo->handle;
+		submit->bos[i].flags = submit_bo->flags;
 		/* in validate_objects() we figure out if this is true: */
-		submit->bos[i].iova  = submit_bo.presumed;
+		submit->bos[i].iova  = submit_bo->presumed;
 	}
 
+	kvfree(submit_bos);
+
 	spin_lock(&file->table_lock);
 
 	for (i = 0; i < args->nr_bos; i++) {
@@ -177,6 +187,24 @@ static int submit_lookup_objects(struct msm_gem_submit *submit,
 	return ret;
 }
 
+/* Report the DMA-bufs used by a submit, to follow them through the GPU */
+static void submit_trace_dmabufs(struct msm_gem_submit *submit)
+{
+	unsigned i;
+
+	if (!trace_msm_gpu_submit_dmabuf_enabled())
+		return;
+
+	for (i = 0; i < submit->nr_bos; i++) {
+		struct dma_buf *dmabuf = msm_gem_dmabuf(submit->bos[i].obj);
+
+		if (dmabuf)
+			trace_msm_gpu_submit_dmabuf(submit,
+						    dma_buf_trace_id(dmabuf),
+						    submit->bos[i].flags);
+	}
+}
+
 static int submit_lookup_cmds(struct msm_gem_submit *submit,
 		struct drm_msm_gem_submit *args, struct drm_file *file)
 {
@@ -850,10 +878,14 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 	if (ret)
 		goto out;
 
+	submit_trace_dmabufs(submit);
+
 	ret = submit_lookup_cmds(submit, args, file);
 	if (ret)
 		goto out;
 
+	submit->ts[MSM_SUBMIT_TS_LOOKUP] = ktime_get();
+
 	/* copy_*_user while holding a ww ticket upsets lockdep */
 	ww_acquire_init(&submit->ticket, &reservation_ww_class);
 	has_ww_ticket = true;
@@ -865,10 +897,14 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 	if (ret)
 		goto out;
 
+	submit->ts[MSM_SUBMIT_TS_LOCKED] = ktime_get();
+
 	ret = submit_pin_objects(submit);
 	if (ret)
 		goto out;
 
+	submit->ts[MSM_SUBMIT_TS_PINNED] = ktime_get();
+
 	for (i = 0; i < args->nr_cmds; i++) {
 		struct drm_gem_object *obj;
 		uint64_t iova;
@@ -981,6 +1017,7 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 
 	msm_rd_dump_submit(priv->rd, submit, NULL);
 
+	submit->ts[MSM_SUBMIT_TS_QUEUED] = ktime_get();
 	drm_sched_entity_push_job(&submit->base);
 
 	args->fence = submit->fence_id;
@@ -0,0 +1,318 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+
+/*
+ * Compressed in-memory backing for evicted GEM objects.
+ *
+ * Without swap, evicting a willneed object would only move its pages from
+ * the GPU's hands into shmem, where nothing can reclaim them.  When enabled,
+ * msm_gem_evict() instead compresses the pages with lz4 into a zsmalloc pool
+ * and drops the shmem copy, and get_pages() decompresses them into freshly
+ * allocated pages the next time the object is needed.
+ */
+
+#include <linux/highmem.h>
+#include <linux/lz4.h>
+#include <linux/seq_file.h>
+#include <linux/string.h>
+#include <linux/zsmalloc.h>
+
+#include "msm_drv.h"
+#include "msm_gem.h"
+
+static bool enable_zcomp;
+MODULE_PARM_DESC(enable_zcomp, "Compress evicted GEM buffers in memory when there is no swap");
+module_param(enable_zcomp, bool, 0600);
+
+/* Don't bother keeping objects that compress to more than 3/4 of their size */
+#define ZCOMP_MAX_RATIO_NUM	3
+#define ZCOMP_MAX_RATIO_DEN	4
+
+/**
+ * struct msm_gem_zpage - one compressed page of an evicted object
+ * @handle: zsmalloc handle of the data, 0 for a page of zeroes
+ * @len: bytes stored at @handle, PAGE_SIZE if stored uncompressed
+ */
+struct msm_gem_zpage {
+	unsigned long handle;
+	unsigned int len;
+};
+
+struct msm_gem_zcomp {
+	struct zs_pool *pool;
+
+	/* Protects the compression scratch buffers: */
+	struct mutex lock;
+	void *wrkmem;
+	void *buf;
+
+	atomic64_t stored_objs;
+	atomic64_t stored_pages;
+	atomic64_t zero_pages;
+	atomic64_t stored_bytes;
+	atomic64_t evicted;
+	atomic64_t faulted;
+	atomic64_t rejected;
+};
+
+bool msm_gem_zcomp_enabled(struct drm_device *dev)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+
+	return READ_ONCE(enable_zcomp) && priv->zcomp;
+}
+
+static void zcomp_free_zpages(struct msm_gem_zcomp *zcomp,
+		struct msm_gem_zpage *zpages, int npages)
+{
+	int i;
+
+	for (i = 0; i < npages; i++)
+		if (zpages[i].handle)
+			zs_free(zcomp->pool, zpages[i].handle);
+	kvfree(zpages);
+}
+
+static void zcomp_account(struct msm_gem_zcomp *zcomp,
+		struct msm_gem_zpage *zpages, int npages, int sign)
+{
+	long pages = 0, zero = 0, bytes = 0;
+	int i;
+
+	for (i = 0; i < npages; i++) {
+		if (zpages[i].handle) {
+			pages++;
+			bytes += zpages[i].len;
+		} else {
+			zero++;
+		}
+	}
+
+	atomic64_add(sign, &zcomp->stored_objs);
+	atomic64_add(sign * pages, &zcomp->stored_pages);
+	atomic64_add(sign * zero, &zcomp->zero_pages);
+	atomic64_add(sign * bytes, &zcomp->stored_bytes);
+}
+
+/**
+ * msm_gem_zcomp_store - Compress the pages of an object about to be evicted
+ * @obj: the object, which must have its pages attached
+ *
+ * Called from reclaim, so nothing here may recurse into it.  On success the
+ * caller drops the pages, and their contents are restored by
+ * msm_gem_zcomp_load() when the object gets new pages.
+ *
+ * Returns 0 on success, or -errno if the object should be evicted as usual.
+ */
+int msm_gem_zcomp_store(struct drm_gem_object *obj)
+{
+	struct msm_drm_private *priv = obj->dev->dev_private;
+	struct msm_gem_object *msm_obj = to_msm_bo(obj);
+	struct msm_gem_zcomp *zcomp = priv->zcomp;
+	int npages = obj->size >> PAGE_SHIFT;
+	struct msm_gem_zpage *zpages;
+	size_t bytes = 0;
+	int i, ret = 0;
+
+	msm_gem_assert_locked(obj);
+
+	if (GEM_WARN_ON(!msm_obj->pages || msm_obj->zpages))
+		return -EINVAL;
+
+	zpages = kvcalloc(npages, sizeof(*zpages), GFP_NOWAIT | __GFP_NOWARN);
+	if (!zpages)
+		return -ENOMEM;
+
+	mutex_lock(&zcomp->lock);
+	for (i = 0; i < npages; i++) {
+		void *src = kmap_local_page(msm_obj->pages[i]);
+		const void *data = zcomp->buf;
+		unsigned long handle;
+		unsigned int len;
+		void *dst;
+
+		if (!memchr_inv(src, 0, PAGE_SIZE)) {
+			kunmap_local(src);
+			continue;
+		}
+
+		len = LZ4_compress_default(src, zcomp->buf, PAGE_SIZE,
+				LZ4_COMPRESSBOUND(PAGE_SIZE), zcomp->wrkmem);
+		if (!len || len >= PAGE_SIZE) {
+			len = PAGE_SIZE;
+			data = src;
+		}
+
+		handle = zs_malloc(zcomp->pool, len,
+				__GFP_KSWAPD_RECLAIM | __GFP_NOWARN |
+				__GFP_HIGHMEM | __GFP_MOVABLE);
+		if (IS_ERR_VALUE(handle)) {
+			kunmap_local(src);
+			ret = -ENOMEM;
+			break;
+		}
+
+		dst = zs_map_object(zcomp->pool, handle, ZS_MM_WO);
+		memcpy(dst, data, len);
+		zs_unmap_object(zcomp->pool, handle);
+		kunmap_local(src);
+
+		zpages[i].handle = handle;
+		zpages[i].len = len;
+		bytes += len;
+	}
+	mutex_unlock(&zcomp->lock);
+
+	if (!ret && bytes * ZCOMP_MAX_RATIO_DEN > obj->size * ZCOMP_MAX_RATIO_NUM)
+		ret = -E2BIG;
+
+	if (ret) {
+		zcomp_free_zpages(zcomp, zpages, npages);
+		atomic64_inc(&zcomp->rejected);
+		return ret;
+	}
+
+	msm_obj->zpages = zpages;
+	zcomp_account(zcomp, zpages, npages, 1);
+	atomic64_inc(&zcomp->evicted);
+
+	return 0;
+}
+
+/**
+ * msm_gem_zcomp_load - Restore the contents of a compressed object
+ * @obj: the object, whose newly allocated pages are attached
+ *
+ * Does nothing for objects which weren't compressed when evicted.  Either
+ * way the compressed copy is gone afterwards.
+ */
+int msm_gem_zcomp_load(struct drm_gem_object *obj)
+{
+	struct msm_drm_private *priv = obj->dev->dev_private;
+	struct msm_gem_object *msm_obj = to_msm_bo(obj);
+	struct msm_gem_zcomp *zcomp = priv->zcomp;
+	int npages = obj->size >> PAGE_SHIFT;
+	struct msm_gem_zpage *zpages = msm_obj->zpages;
+	int i, ret = 0;
+
+	msm_gem_assert_locked(obj);
+
+	if (!zpages)
+		return 0;
+
+	for (i = 0; i < npages; i++) {
+		void *src, *dst;
+
+		/* New shmem pages are already zeroed: */
+		if (!zpages[i].handle)
+			continue;
+
+		dst = kmap_local_page(msm_obj->pages[i]);
+		src = zs_map_object(zcomp->pool, zpages[i].handle, ZS_MM_RO);
+		if (zpages[i].len == PAGE_SIZE)
+			memcpy(dst, src, PAGE_SIZE);
+		else if (LZ4_decompress_safe(src, dst, zpages[i].len,
+					     PAGE_SIZE) != PAGE_SIZE)
+			ret = -EIO;
+		zs_unmap_object(zcomp->pool, zpages[i].handle);
+		kunmap_local(dst);
+
+		if (ret)
+			break;
+	}
+
+	zcomp_account(zcomp, zpages, npages, -1);
+	atomic64_inc(&zcomp->faulted);
+	zcomp_free_zpages(zcomp, zpages, npages);
+	msm_obj->zpages = NULL;
+
+	return ret;
+}
+
+/**
+ * msm_gem_zcomp_free - Drop the compressed copy of an object, if any
+ * @obj: the object
+ */
+void msm_gem_zcomp_free(struct drm_gem_object *obj)
+{
+	struct msm_drm_private *priv = obj->dev->dev_private;
+	struct msm_gem_object *msm_obj = to_msm_bo(obj);
+	int npages = obj->size >> PAGE_SHIFT;
+
+	if (!msm_obj->zpages)
+		return;
+
+	/* The pool, and all its allocations, may already be gone: */
+	if (priv->zcomp) {
+		zcomp_account(priv->zcomp, msm_obj->zpages, npages, -1);
+		zcomp_free_zpages(priv->zcomp, msm_obj->zpages, npages);
+	} else {
+		kvfree(msm_obj->zpages);
+	}
+	msm_obj->zpages = NULL;
+}
+
+void msm_gem_zcomp_describe(struct drm_device *dev, struct seq_file *m)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	struct msm_gem_zcomp *zcomp = priv->zcomp;
+
+	if (!zcomp) {
+		seq_puts(m, "disabled\n");
+		return;
+	}
+
+	seq_printf(m, "enabled:      %d\n", READ_ONCE(enable_zcomp));
+	seq_printf(m, "objects:      %lld\n", atomic64_read(&zcomp->stored_objs));
+	seq_printf(m, "pages:        %lld\n", atomic64_read(&zcomp->stored_pages));
+	seq_printf(m, "zero pages:   %lld\n", atomic64_read(&zcomp->zero_pages));
+	seq_printf(m, "stored bytes: %lld\n", atomic64_read(&zcomp->stored_bytes));
+	seq_printf(m, "pool pages:   %lu\n", zs_get_total_pages(zcomp->pool));
+	seq_printf(m, "evicted:      %lld\n", atomic64_read(&zcomp->evicted));
+	seq_printf(m, "faulted in:   %lld\n", atomic64_read(&zcomp->faulted));
+	seq_printf(m, "rejected:     %lld\n", atomic64_read(&zcomp->rejected));
+}
+
+void msm_gem_zcomp_init(struct drm_device *dev)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	struct msm_gem_zcomp *zcomp;
+
+	zcomp = kzalloc(sizeof(*zcomp), GFP_KERNEL);
+	if (!zcomp)
+		return;
+
+	mutex_init(&zcomp->lock);
+	zcomp->wrkmem = kvmalloc(LZ4_MEM_COMPRESS, GFP_KERNEL);
+	zcomp->buf = kvmalloc(LZ4_COMPRESSBOUND(PAGE_SIZE), GFP_KERNEL);
+	zcomp->pool = zs_create_pool(dev_name(dev->dev));
+	if (!zcomp->wrkmem || !zcomp->buf || !zcomp->pool) {
+		DRM_DEV_ERROR(dev->dev, "failed to set up compressed eviction\n");
+		if (zcomp->pool)
+			zs_destroy_pool(zcomp->pool);
+		kvfree(zcomp->buf);
+		kvfree(zcomp->wrkmem);
+		kfree(zcomp);
+		return;
+	}
+
+	priv->zcomp = zcomp;
+}
+
+void msm_gem_zcomp_cleanup(struct drm_device *dev)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	struct msm_gem_zcomp *zcomp = priv->zcomp;
+
+	if (!zcomp)
+		return;
+
+	priv->zcomp = NULL;
+	zs_destroy_pool(zcomp->pool);
+	kvfree(zcomp->buf);
+	kvfree(zcomp->wrkmem);
+	mutex_destroy(&zcomp->lock);
+	kfree(zcomp);
+}
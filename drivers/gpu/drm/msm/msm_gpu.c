@@ -18,6 +18,10 @@
 #include <linux/devcoredump.h>
 #include <linux/sched/task.h>
 
+static uint preempt_latency_us;
+MODULE_PARM_DESC(preempt_latency_us, "Max time higher priority work waits before preempting a lower priority ring, in us (default 0)");
+module_param(preempt_latency_us, uint, 0600);
+
 /*
  * Power Management:
  */
@@ -130,6 +134,7 @@ int msm_gpu_pm_suspend(struct msm_gpu *gpu)
 	trace_msm_gpu_suspend(0);
 
 	msm_devfreq_suspend(gpu);
+	hrtimer_cancel(&gpu->preempt_timer);
 
 	ret = disable_axi(gpu);
 	if (ret)
@@ -642,6 +647,48 @@ int msm_gpu_perfcntr_sample(struct msm_gpu *gpu, uint32_t *activetime,
  * Cmdstream submission/retirement:
  */
 
+static u64 ts_delta(ktime_t end, ktime_t start)
+{
+	s64 delta = ktime_to_ns(ktime_sub(end, start));
+
+	return max_t(s64, delta, 0);
+}
+
+static void account_submit_latency(struct msm_gpu *gpu,
+		struct msm_gem_submit *submit, u64 gpu_ns)
+{
+	ktime_t *ts = submit->ts;
+	ktime_t irq = READ_ONCE(gpu->retire_irq_time);
+	u64 phase_ns[MSM_SUBMIT_PHASE_COUNT];
+	u64 hw_ns;
+
+	/* Submits that never went through the ioctl (ie. sudo/internal): */
+	if (!ts[MSM_SUBMIT_TS_CREATE])
+		return;
+
+	/* A late retire irq for an earlier submit can predate the flush: */
+	if (ktime_before(irq, ts[MSM_SUBMIT_TS_FLUSHED]))
+		irq = ktime_get();
+
+	/* The GPU only reports how long it executed the submit, so the rest
+	 * of the time between flush and retire irq is spent queued behind
+	 * other work in the ringbuffer:
+	 */
+	hw_ns = ts_delta(irq, ts[MSM_SUBMIT_TS_FLUSHED]);
+
+	phase_ns[MSM_SUBMIT_PHASE_PARSE] = ts_delta(ts[MSM_SUBMIT_TS_LOOKUP], ts[MSM_SUBMIT_TS_CREATE]);
+	phase_ns[MSM_SUBMIT_PHASE_LOCK] = ts_delta(ts[MSM_SUBMIT_TS_LOCKED], ts[MSM_SUBMIT_TS_LOOKUP]);
+	phase_ns[MSM_SUBMIT_PHASE_PIN] = ts_delta(ts[MSM_SUBMIT_TS_PINNED], ts[MSM_SUBMIT_TS_LOCKED]);
+	phase_ns[MSM_SUBMIT_PHASE_SCHED] = ts_delta(ts[MSM_SUBMIT_TS_RUN], ts[MSM_SUBMIT_TS_QUEUED]);
+	phase_ns[MSM_SUBMIT_PHASE_RING] = ts_delta(ts[MSM_SUBMIT_TS_FLUSHED], ts[MSM_SUBMIT_TS_RUN]);
+	phase_ns[MSM_SUBMIT_PHASE_GPU_QUEUE] = hw_ns > gpu_ns ? hw_ns - gpu_ns : 0;
+	phase_ns[MSM_SUBMIT_PHASE_GPU] = gpu_ns;
+	phase_ns[MSM_SUBMIT_PHASE_RETIRE] = ts_delta(ktime_get(), irq);
+
+	trace_msm_gpu_submit_latency(submit, phase_ns);
+	msm_submitqueue_account_latency(submit->queue, phase_ns);
+}
+
 static void retire_submit(struct msm_gpu *gpu, struct msm_ringbuffer *ring,
 		struct msm_gem_submit *submit)
 {
@@ -669,6 +716,17 @@ static void retire_submit(struct msm_gpu *gpu, struct msm_ringbuffer *ring,
 	trace_msm_gpu_submit_retired(submit, elapsed, clock,
 		stats->alwayson_start, stats->alwayson_end);
 
+	account_submit_latency(gpu, submit, elapsed);
+
+	if (submit->deadline) {
+		struct msm_gpu_submitqueue *queue = submit->queue;
+
+		if (ktime_after(READ_ONCE(gpu->retire_irq_time), submit->deadline))
+			WRITE_ONCE(queue->deadlines_missed, queue->deadlines_missed + 1);
+		else
+			WRITE_ONCE(queue->deadlines_met, queue->deadlines_met + 1);
+	}
+
 	msm_submit_retire(submit);
 
 	pm_runtime_mark_last_busy(&gpu->pdev->dev);
@@ -736,6 +794,8 @@ void msm_gpu_retire(struct msm_gpu *gpu)
 {
 	int i;
 
+	WRITE_ONCE(gpu->retire_irq_time, ktime_get());
+
 	for (i = 0; i < gpu->nr_rings; i++)
 		msm_update_fence(gpu->rb[i]->fctx, gpu->rb[i]->memptrs->fence);
 
@@ -743,6 +803,65 @@ void msm_gpu_retire(struct msm_gpu *gpu)
 	update_sw_cntrs(gpu);
 }
 
+static bool ring_pending(struct msm_ringbuffer *ring)
+{
+	return !msm_fence_completed(ring->fctx, ring->fctx->last_fence);
+}
+
+static enum hrtimer_restart preempt_timer(struct hrtimer *t)
+{
+	struct msm_gpu *gpu = container_of(t, struct msm_gpu, preempt_timer);
+	struct msm_ringbuffer *cur = gpu->funcs->active_ring(gpu);
+	struct msm_gem_submit *submit;
+	unsigned long flags;
+	int i;
+
+	for (i = 0; i < cur->id; i++)
+		if (ring_pending(gpu->rb[i]))
+			break;
+
+	/* Either caught up by itself, or the urgent work already retired: */
+	if (i == cur->id || !ring_pending(cur))
+		return HRTIMER_NORESTART;
+
+	/* Charge the preemption to the submit which gets switched out: */
+	spin_lock_irqsave(&cur->submit_lock, flags);
+	list_for_each_entry(submit, &cur->submits, node) {
+		if (msm_fence_completed(cur->fctx, submit->seqno))
+			continue;
+		WRITE_ONCE(submit->queue->preemptions,
+			   submit->queue->preemptions + 1);
+		break;
+	}
+	spin_unlock_irqrestore(&cur->submit_lock, flags);
+
+	gpu->funcs->preempt(gpu);
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * Higher priority work is allowed to wait behind the active ring for at most
+ * preempt_latency_us.  This gives a short lower priority submit the chance
+ * to finish, which is cheaper than saving and restoring its state, while
+ * bounding how long a long running one can hold up urgent work.
+ */
+static void preempt_timer_arm(struct msm_gpu *gpu, struct msm_ringbuffer *ring)
+{
+	if (!gpu->funcs->preempt || gpu->nr_rings < 2)
+		return;
+
+	if (ring->id >= gpu->funcs->active_ring(gpu)->id)
+		return;
+
+	if (hrtimer_active(&gpu->preempt_timer))
+		return;
+
+	hrtimer_start(&gpu->preempt_timer,
+		      us_to_ktime(READ_ONCE(preempt_latency_us)),
+		      HRTIMER_MODE_REL);
+}
+
 /* add bo's to gpu's ring, and kick gpu: */
 void msm_gpu_submit(struct msm_gpu *gpu, struct msm_gem_submit *submit)
 {
@@ -781,6 +900,8 @@ void msm_gpu_submit(struct msm_gpu *gpu, struct msm_gem_submit *submit)
 	gpu->funcs->submit(gpu, submit);
 	gpu->cur_ctx_seqno = submit->queue->ctx->seqno;
 
+	preempt_timer_arm(gpu, ring);
+
 	pm_runtime_put(&gpu->pdev->dev);
 	hangcheck_timer_reset(gpu);
 }
@@ -855,6 +976,10 @@ int msm_gpu_init(struct drm_device *drm, struct platform_device *pdev,
 	gpu->funcs = funcs;
 	gpu->name = name;
 
+	/* Before anything can fail, msm_gpu_cleanup() cancels it: */
+	hrtimer_init(&gpu->preempt_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	gpu->preempt_timer.function = preempt_timer;
+
 	gpu->worker = kthread_create_worker(0, "gpu-worker");
 	if (IS_ERR(gpu->worker)) {
 		ret = PTR_ERR(gpu->worker);
@@ -942,18 +1067,22 @@ int msm_gpu_init(struct drm_device *drm, struct platform_device *pdev,
 		goto fail;
 	}
 
-	memptrs = msm_gem_kernel_new(drm,
-		sizeof(struct msm_rbmemptrs) * nr_rings,
-		check_apriv(gpu, MSM_BO_WC), gpu->aspace, &gpu->memptrs_bo,
-		&memptrs_iova);
+	ret = msm_suballoc_pool_init(&gpu->suballoc, drm, MSM_GPU_SUBALLOC_SZ,
+		check_apriv(gpu, MSM_BO_WC), gpu->aspace, "suballoc");
+	if (ret) {
+		DRM_DEV_ERROR(drm->dev, "could not allocate suballoc pool: %d\n", ret);
+		goto fail;
+	}
 
-	if (IS_ERR(memptrs)) {
-		ret = PTR_ERR(memptrs);
+	gpu->memptrs = msm_suballoc_new(&gpu->suballoc,
+		sizeof(struct msm_rbmemptrs) * nr_rings, &memptrs, &memptrs_iova);
+	if (IS_ERR(gpu->memptrs)) {
+		ret = PTR_ERR(gpu->memptrs);
+		gpu->memptrs = NULL;
 		DRM_DEV_ERROR(drm->dev, "could not allocate memptrs: %d\n", ret);
 		goto fail;
 	}
-
-	msm_gem_object_set_name(gpu->memptrs_bo, "memptrs");
+	memset(memptrs, 0, sizeof(struct msm_rbmemptrs) * nr_rings);
 
 	if (nr_rings > ARRAY_SIZE(gpu->rb)) {
 		DRM_DEV_INFO_ONCE(drm->dev, "Only creating %zu ringbuffers\n",
@@ -988,7 +1117,9 @@ int msm_gpu_init(struct drm_device *drm, struct platform_device *pdev,
 		gpu->rb[i] = NULL;
 	}
 
-	msm_gem_kernel_put(gpu->memptrs_bo, gpu->aspace);
+	msm_suballoc_free(gpu->memptrs, NULL);
+	gpu->memptrs = NULL;
+	msm_suballoc_pool_fini(&gpu->suballoc);
 
 	platform_set_drvdata(pdev, NULL);
 	return ret;
@@ -1000,12 +1131,16 @@ void msm_gpu_cleanup(struct msm_gpu *gpu)
 
 	DBG("%s", gpu->name);
 
+	hrtimer_cancel(&gpu->preempt_timer);
+
 	for (i = 0; i < ARRAY_SIZE(gpu->rb); i++) {
 		msm_ringbuffer_destroy(gpu->rb[i]);
 		gpu->rb[i] = NULL;
 	}
 
-	msm_gem_kernel_put(gpu->memptrs_bo, gpu->aspace);
+	msm_suballoc_free(gpu->memptrs, NULL);
+	gpu->memptrs = NULL;
+	msm_suballoc_pool_fini(&gpu->suballoc);
 
 	if (!IS_ERR_OR_NULL(gpu->aspace)) {
 		gpu->aspace->mmu->funcs->detach(gpu->aspace->mmu);
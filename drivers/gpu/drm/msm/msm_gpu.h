@@ -92,6 +92,17 @@ struct msm_gpu_funcs {
 	 * for cmdstream that is buffered in this FIFO upstream of the CP fw.
 	 */
 	bool (*progress)(struct msm_gpu *gpu, struct msm_ringbuffer *ring);
+
+	/**
+	 * preempt: Optional hook to switch to a higher priority ring
+	 *
+	 * Called when a higher priority ring than the active one has had work
+	 * pending for longer than the preemption latency, to make the GPU
+	 * switch to the highest priority ring with pending work.  Can be
+	 * called from hardirq context, so must not sleep.  Both this and
+	 * active_ring() must be safe to call without gpu->lock.
+	 */
+	void (*preempt)(struct msm_gpu *gpu);
 };
 
 /* Additional state for iommu faults: */
@@ -159,6 +170,16 @@ struct msm_gpu_devfreq {
 	 */
 	struct msm_hrtimer_work boost_work;
 
+	/**
+	 * deadline_boost:
+	 *
+	 * The current boost was requested for a fence deadline, rather than
+	 * because we came out of a long idle period.  Such a boost is only
+	 * needed until the work it was for retires, so it is dropped as soon
+	 * as the GPU goes idle instead of lasting the whole boost period.
+	 */
+	bool deadline_boost;
+
 	/** suspended: tracks if we're suspended */
 	bool suspended;
 };
@@ -256,6 +277,13 @@ struct msm_gpu {
 #define DRM_MSM_HANGCHECK_PROGRESS_RETRIES 3
 	struct timer_list hangcheck_timer;
 
+	/*
+	 * Armed when work is written to a higher priority ring than the one
+	 * the GPU is executing, fires msm_gpu_funcs::preempt if the GPU hasn't
+	 * switched over by itself within the preemption latency:
+	 */
+	struct hrtimer preempt_timer;
+
 	/* Fault info for most recent iova fault: */
 	struct msm_gpu_fault_info fault_info;
 
@@ -271,10 +299,16 @@ struct msm_gpu {
 	/* work for handling active-list retiring: */
 	struct kthread_work retire_work;
 
+	/* time of the last retire irq, for submit latency accounting: */
+	ktime_t retire_irq_time;
+
 	/* worker for retire/recover: */
 	struct kthread_worker *worker;
 
-	struct drm_gem_object *memptrs_bo;
+	/* small kernel buffers in the GPU's address space: */
+	struct msm_suballoc_pool suballoc;
+
+	struct drm_suballoc *memptrs;
 
 	struct msm_gpu_devfreq devfreq;
 
@@ -309,6 +343,7 @@ static inline struct msm_gpu *dev_to_gpu(struct device *dev)
 
 /* It turns out that all targets use the same ringbuffer size */
 #define MSM_GPU_RINGBUFFER_SZ SZ_32K
+#define MSM_GPU_SUBALLOC_SZ SZ_64K
 #define MSM_GPU_RINGBUFFER_BLKSIZE 32
 
 #define MSM_GPU_RB_CNTL_DEFAULT \
@@ -476,6 +511,22 @@ static inline int msm_gpu_convert_priority(struct msm_gpu *gpu, int prio,
 	return 0;
 }
 
+/* The phases of a submit's life that the latency histograms break down: */
+enum msm_submit_phase {
+	MSM_SUBMIT_PHASE_PARSE,		/* ioctl argument parsing and bo lookup */
+	MSM_SUBMIT_PHASE_LOCK,		/* bo locking and implicit fence setup */
+	MSM_SUBMIT_PHASE_PIN,		/* bo pinning */
+	MSM_SUBMIT_PHASE_SCHED,		/* scheduler waiting on dependencies */
+	MSM_SUBMIT_PHASE_RING,		/* writing the ringbuffer */
+	MSM_SUBMIT_PHASE_GPU_QUEUE,	/* flushed, until the GPU starts it */
+	MSM_SUBMIT_PHASE_GPU,		/* executing on the GPU */
+	MSM_SUBMIT_PHASE_RETIRE,	/* retire irq until the retire worker */
+	MSM_SUBMIT_PHASE_COUNT,
+};
+
+/* Bucket n counts durations under 2^n us, the last one everything longer */
+#define MSM_SUBMIT_LATENCY_BUCKETS	24
+
 /**
  * struct msm_gpu_submitqueues - Userspace created context.
  *
@@ -500,6 +551,16 @@ static inline int msm_gpu_convert_priority(struct msm_gpu *gpu, int prio,
  * @lock:      submitqueue lock for serializing submits on a queue
  * @ref:       reference count
  * @entity:    the submit job-queue
+ * @latency:   histograms of the time retired submits spent in each phase,
+ *             in log2 microsecond buckets, updated by the retire worker
+ * @boosts:    the number of times a fence deadline on one of this queue's
+ *             submits boosted the GPU freq
+ * @deadlines_met: the number of boosted submits retired before the deadline
+ * @deadlines_missed: the number of boosted submits retired after it
+ * @preemptions: the number of times this queue's submits were preempted
+ *             for higher priority work
+ * @wait_ns:   total time this queue's submits spent flushed to the ring but
+ *             not yet executing, ie. waiting behind other work on the GPU
  */
 struct msm_gpu_submitqueue {
 	int id;
@@ -514,6 +575,12 @@ struct msm_gpu_submitqueue {
 	struct mutex lock;
 	struct kref ref;
 	struct drm_sched_entity *entity;
+	u32 latency[MSM_SUBMIT_PHASE_COUNT][MSM_SUBMIT_LATENCY_BUCKETS];
+	u32 boosts;
+	u32 deadlines_met;
+	u32 deadlines_missed;
+	u32 preemptions;
+	u64 wait_ns;
 };
 
 struct msm_gpu_state_bo {
@@ -617,6 +684,10 @@ int msm_submitqueue_remove(struct msm_file_private *ctx, u32 id);
 void msm_submitqueue_close(struct msm_file_private *ctx);
 
 void msm_submitqueue_destroy(struct kref *kref);
+void msm_submitqueue_account_latency(struct msm_gpu_submitqueue *queue,
+		const u64 *phase_ns);
+void msm_submitqueue_show_latency(struct msm_file_private *ctx,
+		struct seq_file *m);
 
 int msm_file_private_set_sysprof(struct msm_file_private *ctx,
 				 struct msm_gpu *gpu, int sysprof);
@@ -639,6 +710,7 @@ void msm_devfreq_cleanup(struct msm_gpu *gpu);
 void msm_devfreq_resume(struct msm_gpu *gpu);
 void msm_devfreq_suspend(struct msm_gpu *gpu);
 void msm_devfreq_boost(struct msm_gpu *gpu, unsigned factor);
+void msm_devfreq_boost_deadline(struct msm_gpu *gpu, struct msm_fence_context *fctx);
 void msm_devfreq_active(struct msm_gpu *gpu);
 void msm_devfreq_idle(struct msm_gpu *gpu);
 
@@ -258,6 +258,7 @@ static void msm_devfreq_boost_work(struct kthread_work *work)
 	struct msm_gpu_devfreq *df = container_of(work,
 			struct msm_gpu_devfreq, boost_work.work);
 
+	df->deadline_boost = false;
 	dev_pm_qos_update_request(&df->boost_freq, 0);
 }
 
@@ -278,6 +279,7 @@ void msm_devfreq_boost(struct msm_gpu *gpu, unsigned factor)
 	 */
 	do_div(freq, HZ_PER_KHZ);
 
+	df->deadline_boost = false;
 	dev_pm_qos_update_request(&df->boost_freq, freq);
 
 	msm_hrtimer_queue_work(&df->boost_work,
@@ -285,6 +287,60 @@ void msm_devfreq_boost(struct msm_gpu *gpu, unsigned factor)
 			       HRTIMER_MODE_REL);
 }
 
+/*
+ * Called shortly before a fence deadline, if the fence hasn't signaled yet.
+ * Ring 0 carries the highest priority submitqueues, so the closer a ring is
+ * to it the harder we boost: the lowest priority ring gets the same 2x boost
+ * as when coming out of idle, while ring 0 of a four ring GPU goes to 8x
+ * (which in practice means fmax).
+ */
+void msm_devfreq_boost_deadline(struct msm_gpu *gpu, struct msm_fence_context *fctx)
+{
+	struct msm_gpu_devfreq *df = &gpu->devfreq;
+	struct msm_ringbuffer *ring = NULL;
+	struct msm_gem_submit *submit;
+	unsigned long flags;
+	uint32_t fence;
+	ktime_t deadline;
+	int i;
+
+	if (!has_devfreq(gpu))
+		return;
+
+	for (i = 0; i < gpu->nr_rings; i++) {
+		if (gpu->rb[i]->fctx == fctx) {
+			ring = gpu->rb[i];
+			break;
+		}
+	}
+
+	if (GEM_WARN_ON(!ring))
+		return;
+
+	spin_lock_irqsave(&fctx->spinlock, flags);
+	fence = fctx->next_deadline_fence;
+	deadline = fctx->next_deadline;
+	spin_unlock_irqrestore(&fctx->spinlock, flags);
+
+	/*
+	 * Remember the deadline in the submit, so that retire_submit() can
+	 * tell whether the boost was enough:
+	 */
+	spin_lock_irqsave(&ring->submit_lock, flags);
+	list_for_each_entry(submit, &ring->submits, node) {
+		if (submit->seqno != fence)
+			continue;
+		if (!submit->deadline)
+			WRITE_ONCE(submit->queue->boosts, submit->queue->boosts + 1);
+		submit->deadline = deadline;
+		break;
+	}
+	spin_unlock_irqrestore(&ring->submit_lock, flags);
+
+	msm_devfreq_boost(gpu, 2 * (gpu->nr_rings - ring->id));
+	df->deadline_boost = true;
+}
+
 void msm_devfreq_active(struct msm_gpu *gpu)
 {
 	struct msm_gpu_devfreq *df = &gpu->devfreq;
@@ -355,6 +411,16 @@ static void msm_devfreq_idle_work(struct kthread_work *work)
 	df->idle_freq = idle_freq;
 
 	mutex_unlock(&df->devfreq->lock);
+
+	/*
+	 * Everything a deadline boost was for has retired, don't keep the
+	 * clock up across the idle gap:
+	 */
+	if (df->deadline_boost) {
+		hrtimer_cancel(&df->boost_work.timer);
+		df->deadline_boost = false;
+		dev_pm_qos_update_request(&df->boost_freq, 0);
+	}
 }
 
 void msm_devfreq_idle(struct msm_gpu *gpu)
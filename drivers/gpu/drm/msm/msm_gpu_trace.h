@@ -30,6 +30,32 @@ TRACE_EVENT(msm_gpu_submit,
 		    __entry->nr_bos, __entry->nr_cmds)
 );
 
+/*
+ * A BO of a submit that is shared through a DMA-buf, identified as by
+ * dma_buf_trace_id(), emitted once the BOs of the submit are looked up.
+ */
+TRACE_EVENT(msm_gpu_submit_dmabuf,
+	    TP_PROTO(struct msm_gem_submit *submit, u64 dmabuf, u32 flags),
+	    TP_ARGS(submit, dmabuf, flags),
+	    TP_STRUCT__entry(
+		    __field(pid_t, pid)
+		    __field(u32, id)
+		    __field(u32, ringid)
+		    __field(u32, flags)
+		    __field(u64, dmabuf)
+		    ),
+	    TP_fast_assign(
+		    __entry->pid = pid_nr(submit->pid);
+		    __entry->id = submit->ident;
+		    __entry->ringid = submit->ring->id;
+		    __entry->flags = flags;
+		    __entry->dmabuf = dmabuf;
+		    ),
+	    TP_printk("id=%d pid=%d ring=%d dmabuf=%llu flags=%x",
+		    __entry->id, __entry->pid, __entry->ringid,
+		    __entry->dmabuf, __entry->flags)
+);
+
 TRACE_EVENT(msm_gpu_submit_flush,
 	    TP_PROTO(struct msm_gem_submit *submit, u64 ticks),
 	    TP_ARGS(submit, ticks),
@@ -84,6 +110,37 @@ TRACE_EVENT(msm_gpu_submit_retired,
 );
 
 
+TRACE_EVENT(msm_gpu_submit_latency,
+	    TP_PROTO(struct msm_gem_submit *submit, const u64 *phase_ns),
+	    TP_ARGS(submit, phase_ns),
+	    TP_STRUCT__entry(
+		    __field(pid_t, pid)
+		    __field(u32, id)
+		    __field(u32, ringid)
+		    __field(u32, queueid)
+		    __array(u64, phase_ns, MSM_SUBMIT_PHASE_COUNT)
+		    ),
+	    TP_fast_assign(
+		    __entry->pid = pid_nr(submit->pid);
+		    __entry->id = submit->ident;
+		    __entry->ringid = submit->ring->id;
+		    __entry->queueid = submit->queue->id;
+		    memcpy(__entry->phase_ns, phase_ns,
+			   sizeof(__entry->phase_ns));
+		    ),
+	    TP_printk("id=%d pid=%d ring=%d queue=%d parse=%lld lock=%lld pin=%lld sched=%lld ring=%lld gpu_queue=%lld gpu=%lld retire=%lld",
+		    __entry->id, __entry->pid, __entry->ringid, __entry->queueid,
+		    __entry->phase_ns[MSM_SUBMIT_PHASE_PARSE],
+		    __entry->phase_ns[MSM_SUBMIT_PHASE_LOCK],
+		    __entry->phase_ns[MSM_SUBMIT_PHASE_PIN],
+		    __entry->phase_ns[MSM_SUBMIT_PHASE_SCHED],
+		    __entry->phase_ns[MSM_SUBMIT_PHASE_RING],
+		    __entry->phase_ns[MSM_SUBMIT_PHASE_GPU_QUEUE],
+		    __entry->phase_ns[MSM_SUBMIT_PHASE_GPU],
+		    __entry->phase_ns[MSM_SUBMIT_PHASE_RETIRE])
+);
+
+
 TRACE_EVENT(msm_gpu_freq_change,
 		TP_PROTO(u32 freq),
 		TP_ARGS(freq),
@@ -1,5 +1,6 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "msm_gem.h"
+#include "msm_gpu.h"
 #include "msm_ringbuffer.h"
 
 #define CREATE_TRACE_POINTS
@@ -19,6 +19,8 @@ static struct dma_fence *msm_job_run(struct drm_sched_job *job)
 	struct msm_drm_private *priv = gpu->dev->dev_private;
 	int i;
 
+	submit->ts[MSM_SUBMIT_TS_RUN] = ktime_get();
+
 	msm_fence_init(submit->hw_fence, fctx);
 
 	mutex_lock(&priv->lru.lock);
@@ -36,6 +38,7 @@ static struct dma_fence *msm_job_run(struct drm_sched_job *job)
 	mutex_lock(&gpu->lock);
 
 	msm_gpu_submit(gpu, submit);
+	submit->ts[MSM_SUBMIT_TS_FLUSHED] = ktime_get();
 
 	mutex_unlock(&gpu->lock);
 
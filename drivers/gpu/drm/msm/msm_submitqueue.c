@@ -3,6 +3,8 @@
  */
 
 #include <linux/kref.h>
+#include <linux/log2.h>
+#include <linux/seq_file.h>
 #include <linux/uaccess.h>
 
 #include "msm_gpu.h"
@@ -66,6 +68,71 @@ void __msm_file_private_destroy(struct kref *kref)
 	kfree(ctx);
 }
 
+void msm_submitqueue_account_latency(struct msm_gpu_submitqueue *queue,
+		const u64 *phase_ns)
+{
+	int i;
+
+	WRITE_ONCE(queue->wait_ns,
+		   queue->wait_ns + phase_ns[MSM_SUBMIT_PHASE_GPU_QUEUE]);
+
+	for (i = 0; i < MSM_SUBMIT_PHASE_COUNT; i++) {
+		u64 us = div_u64(phase_ns[i], NSEC_PER_USEC);
+		int bucket = us ? ilog2(us) + 1 : 0;
+
+		bucket = min(bucket, MSM_SUBMIT_LATENCY_BUCKETS - 1);
+		WRITE_ONCE(queue->latency[i][bucket],
+			   queue->latency[i][bucket] + 1);
+	}
+}
+
+static const char *msm_submit_phase_names[MSM_SUBMIT_PHASE_COUNT] = {
+	[MSM_SUBMIT_PHASE_PARSE]     = "parse",
+	[MSM_SUBMIT_PHASE_LOCK]      = "lock",
+	[MSM_SUBMIT_PHASE_PIN]       = "pin",
+	[MSM_SUBMIT_PHASE_SCHED]     = "sched",
+	[MSM_SUBMIT_PHASE_RING]      = "ring",
+	[MSM_SUBMIT_PHASE_GPU_QUEUE] = "gpu_queue",
+	[MSM_SUBMIT_PHASE_GPU]       = "gpu",
+	[MSM_SUBMIT_PHASE_RETIRE]    = "retire",
+};
+
+void msm_submitqueue_show_latency(struct msm_file_private *ctx,
+		struct seq_file *m)
+{
+	struct msm_gpu_submitqueue *queue;
+	int i, j;
+
+	read_lock(&ctx->queuelock);
+	list_for_each_entry(queue, &ctx->submitqueues, node) {
+		seq_printf(m, "queue %d (ring %u):\n", queue->id, queue->ring_nr);
+		seq_printf(m, "  deadline boosts: %u, met: %u, missed: %u\n",
+			   READ_ONCE(queue->boosts),
+			   READ_ONCE(queue->deadlines_met),
+			   READ_ONCE(queue->deadlines_missed));
+		seq_printf(m, "  preemptions: %u, gpu wait: %llu us\n",
+			   READ_ONCE(queue->preemptions),
+			   div_u64(READ_ONCE(queue->wait_ns), NSEC_PER_USEC));
+
+		seq_printf(m, "  %-10s", "<us");
+		for (j = 0; j < MSM_SUBMIT_LATENCY_BUCKETS; j++) {
+			if (j == MSM_SUBMIT_LATENCY_BUCKETS - 1)
+				seq_puts(m, "      more");
+			else
+				seq_printf(m, " %9lu", 1ul << j);
+		}
+		seq_puts(m, "\n");
+
+		for (i = 0; i < MSM_SUBMIT_PHASE_COUNT; i++) {
+			seq_printf(m, "  %-10s", msm_submit_phase_names[i]);
+			for (j = 0; j < MSM_SUBMIT_LATENCY_BUCKETS; j++)
+				seq_printf(m, " %9u", READ_ONCE(queue->latency[i][j]));
+			seq_puts(m, "\n");
+		}
+	}
+	read_unlock(&ctx->queuelock);
+}
+
 void msm_submitqueue_destroy(struct kref *kref)
 {
 	struct msm_gpu_submitqueue *queue = container_of(kref,
@@ -82,6 +82,31 @@ TRACE_EVENT(drm_sched_process_job,
 	    TP_printk("fence=%p signaled", __entry->fence)
 );
 
+/*
+ * The finished fence's context identifies the entity the job came from, so
+ * per-entity miss counts can be had by aggregating on it.
+ */
+TRACE_EVENT(drm_sched_job_deadline_miss,
+	    TP_PROTO(struct drm_sched_fence *fence, s64 late_ns),
+	    TP_ARGS(fence, late_ns),
+	    TP_STRUCT__entry(
+			     __string(name, fence->sched->name)
+			     __field(uint64_t, ctx)
+			     __field(unsigned, seqno)
+			     __field(s64, late_ns)
+			     ),
+
+	    TP_fast_assign(
+			   __assign_str(name, fence->sched->name);
+			   __entry->ctx = fence->finished.context;
+			   __entry->seqno = fence->finished.seqno;
+			   __entry->late_ns = late_ns;
+			   ),
+	    TP_printk("ring=%s, context=%llu, seq=%u, late=%lld ns",
+		      __get_str(name), __entry->ctx,
+		      __entry->seqno, __entry->late_ns)
+);
+
 TRACE_EVENT(drm_sched_job_wait_dep,
 	    TP_PROTO(struct drm_sched_job *sched_job, struct dma_fence *fence),
 	    TP_ARGS(sched_job, fence),
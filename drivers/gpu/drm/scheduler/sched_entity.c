@@ -449,6 +449,28 @@ drm_sched_job_dependency(struct drm_sched_job *job,
 	return NULL;
 }
 
+/*
+ * Whatever has to finish before a job with a deadline runs is needed by
+ * that deadline too, so pass it on to the fence being waited for.
+ */
+static void drm_sched_job_pass_deadline(struct drm_sched_job *job,
+					struct dma_fence *fence)
+{
+	struct drm_sched_fence *s_fence = job->s_fence;
+	unsigned long flags;
+	ktime_t deadline;
+
+	if (!test_bit(DRM_SCHED_FENCE_FLAG_HAS_DEADLINE_BIT,
+		      &s_fence->finished.flags))
+		return;
+
+	spin_lock_irqsave(&s_fence->lock, flags);
+	deadline = s_fence->deadline;
+	spin_unlock_irqrestore(&s_fence->lock, flags);
+
+	dma_fence_set_deadline(fence, deadline);
+}
+
 struct drm_sched_job *drm_sched_entity_pop_job(struct drm_sched_entity *entity)
 {
 	struct drm_sched_job *sched_job;
@@ -461,6 +483,8 @@ struct drm_sched_job *drm_sched_entity_pop_job(struct drm_sched_entity *entity)
 			drm_sched_job_dependency(sched_job, entity))) {
 		trace_drm_sched_job_wait_dep(sched_job, entity->dependency);
 
+		drm_sched_job_pass_deadline(sched_job, entity->dependency);
+
 		if (drm_sched_entity_add_dependency_cb(entity))
 			return NULL;
 	}
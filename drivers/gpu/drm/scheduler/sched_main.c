@@ -76,6 +76,18 @@ int drm_sched_policy = DRM_SCHED_POLICY_FIFO;
 MODULE_PARM_DESC(sched_policy, "Specify the scheduling policy for entities on a run-queue, " __stringify(DRM_SCHED_POLICY_RR) " = Round Robin, " __stringify(DRM_SCHED_POLICY_FIFO) " = FIFO (default).");
 module_param_named(sched_policy, drm_sched_policy, int, 0444);
 
+static unsigned int drm_sched_deadline_ms;
+
+/**
+ * DOC: sched_deadline_ms (uint)
+ * When non-zero, entities on a run queue are picked earliest deadline first
+ * instead of by sched_policy.  A job's deadline is the earliest one set on
+ * its finished fence, or this many milliseconds after it was pushed if
+ * nobody set one.
+ */
+MODULE_PARM_DESC(sched_deadline_ms, "Pick entities earliest deadline first, with this implicit deadline for jobs without one (0 = disabled, default)");
+module_param_named(sched_deadline_ms, drm_sched_deadline_ms, uint, 0644);
+
 static __always_inline bool drm_sched_entity_compare_before(struct rb_node *a,
 							    const struct rb_node *b)
 {
@@ -256,6 +268,67 @@ drm_sched_rq_select_entity_fifo(struct drm_sched_rq *rq)
 	return rb ? rb_entry(rb, struct drm_sched_entity, rb_tree_node) : NULL;
 }
 
+static ktime_t drm_sched_job_deadline(struct drm_sched_job *job,
+				      unsigned int implicit_ms)
+{
+	struct drm_sched_fence *s_fence = job->s_fence;
+	ktime_t deadline = ktime_add_ms(job->submit_ts, implicit_ms);
+	unsigned long flags;
+
+	spin_lock_irqsave(&s_fence->lock, flags);
+	if (test_bit(DRM_SCHED_FENCE_FLAG_HAS_DEADLINE_BIT,
+		     &s_fence->finished.flags) &&
+	    ktime_before(s_fence->deadline, deadline))
+		deadline = s_fence->deadline;
+	spin_unlock_irqrestore(&s_fence->lock, flags);
+
+	return deadline;
+}
+
+/**
+ * drm_sched_rq_select_entity_edf - Select the entity with the earliest deadline
+ *
+ * @rq: scheduler run queue to check.
+ * @implicit_ms: deadline of jobs nobody set one on, relative to their push
+ *
+ * Deadlines can be set at any time while a job waits, so rather than keeping
+ * the entities sorted this looks at the job at the head of each of them.
+ * Returns NULL if no entity is ready.
+ */
+static struct drm_sched_entity *
+drm_sched_rq_select_entity_edf(struct drm_sched_rq *rq, unsigned int implicit_ms)
+{
+	struct drm_sched_entity *entity, *best = NULL;
+	ktime_t best_deadline = 0;
+
+	spin_lock(&rq->lock);
+	list_for_each_entry(entity, &rq->entities, list) {
+		struct drm_sched_job *job;
+		ktime_t deadline;
+
+		if (!drm_sched_entity_is_ready(entity))
+			continue;
+
+		job = to_drm_sched_job(spsc_queue_peek(&entity->job_queue));
+		if (!job)
+			continue;
+
+		deadline = drm_sched_job_deadline(job, implicit_ms);
+		if (!best || ktime_before(deadline, best_deadline)) {
+			best = entity;
+			best_deadline = deadline;
+		}
+	}
+
+	if (best) {
+		rq->current_entity = best;
+		reinit_completion(&best->entity_idle);
+	}
+	spin_unlock(&rq->lock);
+
+	return best;
+}
+
 /**
  * drm_sched_job_done - complete a job
  * @s_job: pointer to the job which is done
@@ -272,6 +345,16 @@ static void drm_sched_job_done(struct drm_sched_job *s_job, int result)
 
 	trace_drm_sched_process_job(s_fence);
 
+	if (trace_drm_sched_job_deadline_miss_enabled() &&
+	    test_bit(DRM_SCHED_FENCE_FLAG_HAS_DEADLINE_BIT,
+		     &s_fence->finished.flags)) {
+		ktime_t now = ktime_get();
+
+		if (ktime_after(now, s_fence->deadline))
+			trace_drm_sched_job_deadline_miss(s_fence,
+				ktime_to_ns(ktime_sub(now, s_fence->deadline)));
+	}
+
 	dma_fence_get(&s_fence->finished);
 	drm_sched_fence_finished(s_fence, result);
 	dma_fence_put(&s_fence->finished);
@@ -881,6 +964,7 @@ void drm_sched_wakeup_if_can_queue(struct drm_gpu_scheduler *sched)
 static struct drm_sched_entity *
 drm_sched_select_entity(struct drm_gpu_scheduler *sched)
 {
+	unsigned int deadline_ms = READ_ONCE(drm_sched_deadline_ms);
 	struct drm_sched_entity *entity;
 	int i;
 
@@ -889,9 +973,13 @@ drm_sched_select_entity(struct drm_gpu_scheduler *sched)
 
 	/* Kernel run queue has higher priority than normal run queue*/
 	for (i = DRM_SCHED_PRIORITY_COUNT - 1; i >= DRM_SCHED_PRIORITY_MIN; i--) {
-		entity = drm_sched_policy == DRM_SCHED_POLICY_FIFO ?
-			drm_sched_rq_select_entity_fifo(&sched->sched_rq[i]) :
-			drm_sched_rq_select_entity_rr(&sched->sched_rq[i]);
+		if (deadline_ms)
+			entity = drm_sched_rq_select_entity_edf(&sched->sched_rq[i],
+								deadline_ms);
+		else if (drm_sched_policy == DRM_SCHED_POLICY_FIFO)
+			entity = drm_sched_rq_select_entity_fifo(&sched->sched_rq[i]);
+		else
+			entity = drm_sched_rq_select_entity_rr(&sched->sched_rq[i]);
 		if (entity)
 			break;
 	}
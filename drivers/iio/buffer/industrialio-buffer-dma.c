@@ -12,8 +12,10 @@
 #include <linux/mutex.h>
 #include <linux/sched.h>
 #include <linux/poll.h>
+#include <linux/iio/iio.h>
 #include <linux/iio/buffer_impl.h>
 #include <linux/iio/buffer-dma.h>
+#include <linux/dma-buf.h>
 #include <linux/dma-mapping.h>
 #include <linux/sizes.h>
 
@@ -88,6 +90,13 @@
  * has special requirements that are not handled by the generic functions. If a
  * driver chooses to overload a callback it has to ensure that the generic
  * callback is called from within the custom callback.
+ *
+ * Instead of reading the samples through fileio, the application can also have
+ * blocks allocated for it and exported as DMABUFs. It then maps them and passes
+ * them back and forth through the enqueue and dequeue callbacks, so the samples
+ * are never copied. The fileio blocks are freed as long as there are any such
+ * blocks, and a DMABUF block is freed only once the application has closed all
+ * its references to it.
  */
 
 static void iio_buffer_block_release(struct kref *kref)
@@ -182,6 +191,7 @@ static struct iio_dma_buffer_block *iio_dma_buffer_alloc_block(
 	block->state = IIO_BLOCK_STATE_DEQUEUED;
 	block->queue = queue;
 	INIT_LIST_HEAD(&block->head);
+	INIT_LIST_HEAD(&block->dmabuf_entry);
 	kref_init(&block->kref);
 
 	iio_buffer_get(&queue->buffer);
@@ -296,6 +306,10 @@ int iio_dma_buffer_request_update(struct iio_buffer *buffer)
 
 	mutex_lock(&queue->lock);
 
+	/* The application brings its own blocks */
+	if (!list_empty(&queue->dmabufs))
+		goto out_unlock;
+
 	/* Allocations are page aligned */
 	if (PAGE_ALIGN(queue->fileio.block_size) == PAGE_ALIGN(size))
 		try_reuse = true;
@@ -490,6 +504,11 @@ int iio_dma_buffer_read(struct iio_buffer *buffer, size_t n,
 
 	mutex_lock(&queue->lock);
 
+	if (!list_empty(&queue->dmabufs)) {
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+
 	if (!queue->fileio.active_block) {
 		block = iio_dma_buffer_dequeue(queue);
 		if (block == NULL) {
@@ -561,6 +580,301 @@ size_t iio_dma_buffer_data_available(struct iio_buffer *buf)
 }
 EXPORT_SYMBOL_GPL(iio_dma_buffer_data_available);
 
+static void iio_dma_buffer_fileio_free(struct iio_dma_buffer_queue *queue)
+{
+	unsigned int i;
+
+	spin_lock_irq(&queue->list_lock);
+	for (i = 0; i < ARRAY_SIZE(queue->fileio.blocks); i++) {
+		if (!queue->fileio.blocks[i])
+			continue;
+		queue->fileio.blocks[i]->state = IIO_BLOCK_STATE_DEAD;
+	}
+	INIT_LIST_HEAD(&queue->outgoing);
+	spin_unlock_irq(&queue->list_lock);
+
+	INIT_LIST_HEAD(&queue->incoming);
+
+	for (i = 0; i < ARRAY_SIZE(queue->fileio.blocks); i++) {
+		if (!queue->fileio.blocks[i])
+			continue;
+		iio_buffer_block_put(queue->fileio.blocks[i]);
+		queue->fileio.blocks[i] = NULL;
+	}
+	queue->fileio.active_block = NULL;
+}
+
+static struct sg_table *iio_dma_buffer_dmabuf_map(
+	struct dma_buf_attachment *attach, enum dma_data_direction dir)
+{
+	struct iio_dma_buffer_block *block = attach->dmabuf->priv;
+	struct sg_table *sgt;
+	int ret;
+
+	sgt = kzalloc(sizeof(*sgt), GFP_KERNEL);
+	if (!sgt)
+		return ERR_PTR(-ENOMEM);
+
+	ret = dma_get_sgtable(block->queue->dev, sgt, block->vaddr,
+		block->phys_addr, PAGE_ALIGN(block->size));
+	if (ret)
+		goto err_free_sgt;
+
+	ret = dma_map_sgtable(attach->dev, sgt, dir, 0);
+	if (ret)
+		goto err_free_table;
+
+	return sgt;
+
+err_free_table:
+	sg_free_table(sgt);
+err_free_sgt:
+	kfree(sgt);
+	return ERR_PTR(ret);
+}
+
+static void iio_dma_buffer_dmabuf_unmap(struct dma_buf_attachment *attach,
+	struct sg_table *sgt, enum dma_data_direction dir)
+{
+	dma_unmap_sgtable(attach->dev, sgt, dir, 0);
+	sg_free_table(sgt);
+	kfree(sgt);
+}
+
+static int iio_dma_buffer_dmabuf_mmap(struct dma_buf *dmabuf,
+	struct vm_area_struct *vma)
+{
+	struct iio_dma_buffer_block *block = dmabuf->priv;
+
+	return dma_mmap_coherent(block->queue->dev, vma, block->vaddr,
+		block->phys_addr, PAGE_ALIGN(block->size));
+}
+
+static int iio_dma_buffer_dmabuf_vmap(struct dma_buf *dmabuf,
+	struct iosys_map *map)
+{
+	struct iio_dma_buffer_block *block = dmabuf->priv;
+
+	iosys_map_set_vaddr(map, block->vaddr);
+
+	return 0;
+}
+
+static void iio_dma_buffer_dmabuf_release(struct dma_buf *dmabuf)
+{
+	struct iio_dma_buffer_block *block = dmabuf->priv;
+	struct iio_dma_buffer_queue *queue = block->queue;
+
+	mutex_lock(&queue->lock);
+	list_del_init(&block->dmabuf_entry);
+
+	/*
+	 * Blocks on the incoming or outgoing queue are taken off it, one that
+	 * is still being processed is freed once the DMA controller is done
+	 * with it.
+	 */
+	spin_lock_irq(&queue->list_lock);
+	if (block->state == IIO_BLOCK_STATE_QUEUED ||
+	    block->state == IIO_BLOCK_STATE_DONE)
+		list_del(&block->head);
+	block->state = IIO_BLOCK_STATE_DEAD;
+	spin_unlock_irq(&queue->list_lock);
+	mutex_unlock(&queue->lock);
+
+	iio_buffer_block_put(block);
+}
+
+static const struct dma_buf_ops iio_dma_buffer_dmabuf_ops = {
+	.map_dma_buf = iio_dma_buffer_dmabuf_map,
+	.unmap_dma_buf = iio_dma_buffer_dmabuf_unmap,
+	.mmap = iio_dma_buffer_dmabuf_mmap,
+	.vmap = iio_dma_buffer_dmabuf_vmap,
+	.release = iio_dma_buffer_dmabuf_release,
+};
+
+/**
+ * iio_dma_buffer_alloc_dmabuf() - DMA buffer alloc_dmabuf callback
+ * @buffer: Buffer to allocate the block for
+ * @size: Size of the block in bytes
+ *
+ * Should be used as the alloc_dmabuf callback for iio_buffer_access_ops
+ * struct for DMA buffers. Allocates a block and exports it as a DMABUF, which
+ * can be mapped by the application. The fileio blocks are freed when the first
+ * one is allocated, so the buffer must be disabled.
+ *
+ * Return: a file descriptor of the DMABUF, or a negative error code.
+ */
+int iio_dma_buffer_alloc_dmabuf(struct iio_buffer *buffer, size_t size)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
+	struct iio_dma_buffer_block *block;
+	struct dma_buf *dmabuf;
+	int ret;
+
+	mutex_lock(&queue->lock);
+
+	if (!queue->ops) {
+		ret = -ENODEV;
+		goto out_unlock;
+	}
+
+	if (queue->active) {
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+
+	block = iio_dma_buffer_alloc_block(queue, size);
+	if (!block) {
+		ret = -ENOMEM;
+		goto out_unlock;
+	}
+
+	exp_info.ops = &iio_dma_buffer_dmabuf_ops;
+	exp_info.size = PAGE_ALIGN(size);
+	exp_info.flags = O_RDWR;
+	exp_info.priv = block;
+
+	dmabuf = dma_buf_export(&exp_info);
+	if (IS_ERR(dmabuf)) {
+		ret = PTR_ERR(dmabuf);
+		block->state = IIO_BLOCK_STATE_DEAD;
+		iio_buffer_block_put(block);
+		goto out_unlock;
+	}
+
+	if (list_empty(&queue->dmabufs))
+		iio_dma_buffer_fileio_free(queue);
+	list_add_tail(&block->dmabuf_entry, &queue->dmabufs);
+
+	mutex_unlock(&queue->lock);
+
+	/* Releasing the DMABUF takes the lock, so this is done without it */
+	ret = dma_buf_fd(dmabuf, O_CLOEXEC);
+	if (ret < 0)
+		dma_buf_put(dmabuf);
+
+	return ret;
+
+out_unlock:
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_alloc_dmabuf);
+
+/**
+ * iio_dma_buffer_enqueue_dmabuf() - DMA buffer enqueue_dmabuf callback
+ * @buffer: Buffer to enqueue the DMABUF to
+ * @iio_dmabuf: Descriptor of the DMABUF
+ *
+ * Should be used as the enqueue_dmabuf callback for iio_buffer_access_ops
+ * struct for DMA buffers. The DMABUF must have been allocated from @buffer and
+ * must not be queued already.
+ */
+int iio_dma_buffer_enqueue_dmabuf(struct iio_buffer *buffer,
+	const struct iio_dmabuf *iio_dmabuf)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block *block;
+	struct dma_buf *dmabuf;
+	int ret = 0;
+
+	dmabuf = dma_buf_get(iio_dmabuf->fd);
+	if (IS_ERR(dmabuf))
+		return PTR_ERR(dmabuf);
+
+	block = dmabuf->priv;
+	if (dmabuf->ops != &iio_dma_buffer_dmabuf_ops || block->queue != queue) {
+		ret = -EINVAL;
+		goto out_dmabuf_put;
+	}
+
+	mutex_lock(&queue->lock);
+	if (!queue->ops) {
+		ret = -ENODEV;
+	} else if (block->state != IIO_BLOCK_STATE_DEQUEUED) {
+		ret = -EBUSY;
+	} else {
+		block->fd = iio_dmabuf->fd;
+		block->bytes_used = 0;
+		iio_dma_buffer_enqueue(queue, block);
+	}
+	mutex_unlock(&queue->lock);
+
+out_dmabuf_put:
+	dma_buf_put(dmabuf);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_enqueue_dmabuf);
+
+static bool iio_dma_buffer_dmabuf_ready(struct iio_dma_buffer_queue *queue)
+{
+	bool ready;
+
+	spin_lock_irq(&queue->list_lock);
+	ready = !list_empty(&queue->outgoing) || !queue->ops;
+	spin_unlock_irq(&queue->list_lock);
+
+	return ready;
+}
+
+/**
+ * iio_dma_buffer_dequeue_dmabuf() - DMA buffer dequeue_dmabuf callback
+ * @buffer: Buffer to dequeue the DMABUF from
+ * @iio_dmabuf: Filled with the descriptor of the DMABUF
+ * @nonblock: Return -EAGAIN instead of waiting if no DMABUF is done
+ *
+ * Should be used as the dequeue_dmabuf callback for iio_buffer_access_ops
+ * struct for DMA buffers. Dequeues the oldest filled DMABUF, the file
+ * descriptor reported for it is the one it was enqueued with.
+ */
+int iio_dma_buffer_dequeue_dmabuf(struct iio_buffer *buffer,
+	struct iio_dmabuf *iio_dmabuf, bool nonblock)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block *block;
+	int ret;
+
+	for (;;) {
+		mutex_lock(&queue->lock);
+		if (!queue->ops) {
+			ret = -ENODEV;
+			goto out_unlock;
+		}
+
+		if (list_empty(&queue->dmabufs)) {
+			ret = -EINVAL;
+			goto out_unlock;
+		}
+
+		/* Under the lock so the DMABUF can't be released meanwhile */
+		block = iio_dma_buffer_dequeue(queue);
+		if (block)
+			break;
+		mutex_unlock(&queue->lock);
+
+		if (nonblock)
+			return -EAGAIN;
+
+		ret = wait_event_interruptible(queue->buffer.pollq,
+			iio_dma_buffer_dmabuf_ready(queue));
+		if (ret)
+			return ret;
+	}
+
+	iio_dmabuf->fd = block->fd;
+	iio_dmabuf->bytes_used = block->bytes_used;
+	ret = 0;
+
+out_unlock:
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_dequeue_dmabuf);
+
 /**
  * iio_dma_buffer_set_bytes_per_datum() - DMA buffer set_bytes_per_datum callback
  * @buffer: Buffer to set the bytes-per-datum for
@@ -618,6 +932,7 @@ int iio_dma_buffer_init(struct iio_dma_buffer_queue *queue,
 
 	INIT_LIST_HEAD(&queue->incoming);
 	INIT_LIST_HEAD(&queue->outgoing);
+	INIT_LIST_HEAD(&queue->dmabufs);
 
 	mutex_init(&queue->lock);
 	spin_lock_init(&queue->list_lock);
@@ -635,31 +950,27 @@ EXPORT_SYMBOL_GPL(iio_dma_buffer_init);
  */
 void iio_dma_buffer_exit(struct iio_dma_buffer_queue *queue)
 {
-	unsigned int i;
+	struct iio_dma_buffer_block *block, *_block;
 
 	mutex_lock(&queue->lock);
 
+	/*
+	 * Blocks exported as DMABUF stay around until the application closes
+	 * them, but are never queued again.
+	 */
 	spin_lock_irq(&queue->list_lock);
-	for (i = 0; i < ARRAY_SIZE(queue->fileio.blocks); i++) {
-		if (!queue->fileio.blocks[i])
-			continue;
-		queue->fileio.blocks[i]->state = IIO_BLOCK_STATE_DEAD;
+	list_for_each_entry_safe(block, _block, &queue->dmabufs, dmabuf_entry) {
+		block->state = IIO_BLOCK_STATE_DEAD;
+		list_del_init(&block->dmabuf_entry);
 	}
-	INIT_LIST_HEAD(&queue->outgoing);
 	spin_unlock_irq(&queue->list_lock);
 
-	INIT_LIST_HEAD(&queue->incoming);
-
-	for (i = 0; i < ARRAY_SIZE(queue->fileio.blocks); i++) {
-		if (!queue->fileio.blocks[i])
-			continue;
-		iio_buffer_block_put(queue->fileio.blocks[i]);
-		queue->fileio.blocks[i] = NULL;
-	}
-	queue->fileio.active_block = NULL;
+	iio_dma_buffer_fileio_free(queue);
 	queue->ops = NULL;
 
 	mutex_unlock(&queue->lock);
+
+	wake_up_interruptible_poll(&queue->buffer.pollq, EPOLLIN | EPOLLRDNORM);
 }
 EXPORT_SYMBOL_GPL(iio_dma_buffer_exit);
 
@@ -677,6 +988,173 @@ void iio_dma_buffer_release(struct iio_dma_buffer_queue *queue)
 }
 EXPORT_SYMBOL_GPL(iio_dma_buffer_release);
 
+/*
+ * Software filled DMA buffer, for triggered buffer drivers that want to hand
+ * blocks of samples, or DMABUFs, to the application without DMA of their own.
+ * Each scan pushed to the buffer is appended to the oldest submitted block and
+ * the readers are only woken up once a block is full.
+ */
+struct iio_dma_buffer_sw {
+	struct iio_dma_buffer_queue queue;
+	struct list_head active;
+};
+
+static struct iio_dma_buffer_sw *iio_buffer_to_sw(struct iio_buffer *buffer)
+{
+	return container_of(buffer, struct iio_dma_buffer_sw, queue.buffer);
+}
+
+static int iio_dma_buffer_sw_submit(struct iio_dma_buffer_queue *queue,
+	struct iio_dma_buffer_block *block)
+{
+	struct iio_dma_buffer_sw *sw = iio_buffer_to_sw(&queue->buffer);
+
+	block->bytes_used = 0;
+
+	/* Can't hold a single scan, hand it back empty */
+	if (block->size < queue->buffer.bytes_per_datum) {
+		iio_dma_buffer_block_done(block);
+		return 0;
+	}
+
+	spin_lock_irq(&queue->list_lock);
+	list_add_tail(&block->head, &sw->active);
+	spin_unlock_irq(&queue->list_lock);
+
+	return 0;
+}
+
+static void iio_dma_buffer_sw_abort(struct iio_dma_buffer_queue *queue)
+{
+	struct iio_dma_buffer_sw *sw = iio_buffer_to_sw(&queue->buffer);
+	struct iio_dma_buffer_block *block;
+
+	/* The partially filled block is handed back with what it holds */
+	spin_lock_irq(&queue->list_lock);
+	block = list_first_entry_or_null(&sw->active,
+		struct iio_dma_buffer_block, head);
+	if (block && block->bytes_used)
+		list_del(&block->head);
+	else
+		block = NULL;
+	spin_unlock_irq(&queue->list_lock);
+
+	if (block)
+		iio_dma_buffer_block_done(block);
+
+	iio_dma_buffer_block_list_abort(queue, &sw->active);
+}
+
+static int iio_dma_buffer_sw_store_to(struct iio_buffer *buffer,
+	const void *data)
+{
+	struct iio_dma_buffer_sw *sw = iio_buffer_to_sw(buffer);
+	struct iio_dma_buffer_queue *queue = &sw->queue;
+	size_t n = buffer->bytes_per_datum;
+	struct iio_dma_buffer_block *block;
+	unsigned long flags;
+	bool full;
+
+	spin_lock_irqsave(&queue->list_lock, flags);
+	block = list_first_entry_or_null(&sw->active,
+		struct iio_dma_buffer_block, head);
+	if (!block) {
+		spin_unlock_irqrestore(&queue->list_lock, flags);
+		return -EBUSY;
+	}
+
+	memcpy(block->vaddr + block->bytes_used, data, n);
+	block->bytes_used += n;
+
+	full = block->bytes_used + n > block->size;
+	if (full)
+		list_del(&block->head);
+	spin_unlock_irqrestore(&queue->list_lock, flags);
+
+	if (full)
+		iio_dma_buffer_block_done(block);
+
+	return 0;
+}
+
+static void iio_dma_buffer_sw_release(struct iio_buffer *buffer)
+{
+	struct iio_dma_buffer_sw *sw = iio_buffer_to_sw(buffer);
+
+	iio_dma_buffer_release(&sw->queue);
+	kfree(sw);
+}
+
+static const struct iio_buffer_access_funcs iio_dma_buffer_sw_access = {
+	.store_to = iio_dma_buffer_sw_store_to,
+	.read = iio_dma_buffer_read,
+	.set_bytes_per_datum = iio_dma_buffer_set_bytes_per_datum,
+	.set_length = iio_dma_buffer_set_length,
+	.request_update = iio_dma_buffer_request_update,
+	.enable = iio_dma_buffer_enable,
+	.disable = iio_dma_buffer_disable,
+	.data_available = iio_dma_buffer_data_available,
+	.release = iio_dma_buffer_sw_release,
+	.alloc_dmabuf = iio_dma_buffer_alloc_dmabuf,
+	.enqueue_dmabuf = iio_dma_buffer_enqueue_dmabuf,
+	.dequeue_dmabuf = iio_dma_buffer_dequeue_dmabuf,
+
+	.modes = INDIO_BUFFER_SOFTWARE | INDIO_BUFFER_TRIGGERED,
+	.flags = INDIO_BUFFER_FLAG_BLOCK_WAKEUP,
+};
+
+static const struct iio_dma_buffer_ops iio_dma_buffer_sw_ops = {
+	.submit = iio_dma_buffer_sw_submit,
+	.abort = iio_dma_buffer_sw_abort,
+};
+
+static void iio_dma_buffer_sw_free(void *buffer)
+{
+	struct iio_dma_buffer_sw *sw = iio_buffer_to_sw(buffer);
+
+	iio_dma_buffer_exit(&sw->queue);
+	iio_buffer_put(buffer);
+}
+
+/**
+ * devm_iio_dma_buffer_sw_setup() - Setup a software filled DMA buffer
+ * @dev: Parent device for the buffer
+ * @indio_dev: IIO device to which to attach this buffer
+ * @dma_dev: Device the blocks are allocated for, typically the controller of
+ *   the bus the IIO device is on
+ *
+ * Attaches a DMA buffer to @indio_dev that is filled with the scans pushed by
+ * the pollfunc of a triggered buffer, in addition to the buffer created by
+ * devm_iio_triggered_buffer_setup(), which must be called first. Userspace
+ * gets it with IIO_BUFFER_GET_FD_IOCTL and can either read it or exchange its
+ * blocks as DMABUFs.
+ *
+ * Return: 0 on success, a negative error code otherwise.
+ */
+int devm_iio_dma_buffer_sw_setup(struct device *dev, struct iio_dev *indio_dev,
+	struct device *dma_dev)
+{
+	struct iio_dma_buffer_sw *sw;
+	int ret;
+
+	sw = kzalloc(sizeof(*sw), GFP_KERNEL);
+	if (!sw)
+		return -ENOMEM;
+
+	INIT_LIST_HEAD(&sw->active);
+	iio_dma_buffer_init(&sw->queue, dma_dev, &iio_dma_buffer_sw_ops);
+	sw->queue.buffer.access = &iio_dma_buffer_sw_access;
+
+	ret = devm_add_action_or_reset(dev, iio_dma_buffer_sw_free,
+				       &sw->queue.buffer);
+	if (ret)
+		return ret;
+
+	return iio_device_attach_buffer(indio_dev, &sw->queue.buffer);
+}
+EXPORT_SYMBOL_GPL(devm_iio_dma_buffer_sw_setup);
+
 MODULE_AUTHOR("Lars-Peter Clausen <lars@metafoo.de>");
 MODULE_DESCRIPTION("DMA buffer for the IIO framework");
 MODULE_LICENSE("GPL v2");
+MODULE_IMPORT_NS(DMA_BUF);
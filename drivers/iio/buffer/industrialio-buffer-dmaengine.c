@@ -119,6 +119,9 @@ static const struct iio_buffer_access_funcs iio_dmaengine_buffer_ops = {
 	.disable = iio_dma_buffer_disable,
 	.data_available = iio_dma_buffer_data_available,
 	.release = iio_dmaengine_buffer_release,
+	.alloc_dmabuf = iio_dma_buffer_alloc_dmabuf,
+	.enqueue_dmabuf = iio_dma_buffer_enqueue_dmabuf,
+	.dequeue_dmabuf = iio_dma_buffer_dequeue_dmabuf,
 
 	.modes = INDIO_BUFFER_HARDWARE,
 	.flags = INDIO_BUFFER_FLAG_FIXED_WATERMARK,
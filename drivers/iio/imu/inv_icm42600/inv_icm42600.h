@@ -330,14 +330,27 @@ struct inv_icm42600_state {
 #define INV_ICM42670_REG_FIFO_CONFIG2			0x0029
 #define INV_ICM42670_FIFO_CONFIG2_COUNT_1		0x0001
 
+/* FIFO watermark is 12 bits (FIFO_CONFIG2 and FIFO_CONFIG3) in little-endian */
+#define INV_ICM42670_REG_FIFO_CONFIG3			0x002A
+#define INV_ICM42670_FIFO_WATERMARK_VAL(_wm)		\
+		cpu_to_le16((_wm) & GENMASK(11, 0))
+
+/* MREG1 registers, written through BLK_SEL_W, MADDR_W and M_W */
+#define INV_ICM42670_TMST_CONFIG1			0x0000
+#define INV_ICM42670_TMST_CONFIG1_TMST_RES_16US		BIT(3)
+#define INV_ICM42670_TMST_CONFIG1_TMST_DELTA_EN		BIT(2)
+#define INV_ICM42670_TMST_CONFIG1_TMST_EN		BIT(0)
+
 #define INV_ICM42670_FIFO_CONFIG5			0x0001
 #define INV_ICM42670_FIFO_CONFIG5_ACCEL_EN		BIT(0)
 #define INV_ICM42670_FIFO_CONFIG5_GYRO_EN		BIT(1)
 #define INV_ICM42670_FIFO_CONFIG5_RESUME_PARTIAL_RD	BIT(4)
 #define INV_ICM42670_FIFO_CONFIG5_WM_GT_TH		BIT(5)
 
+#define INV_ICM42670_REG_BLK_SEL_W			0x0079
 #define INV_ICM42670_MADDR_W				0x007A
 #define INV_ICM42670_M_W				0x007B
+#define INV_ICM42670_MREG_WRITE_TIME_US			10
 
 /* FIFO watermark is 16 bits (2 registers wide) in little-endian */
 #define INV_ICM42600_REG_FIFO_WATERMARK			0x0060
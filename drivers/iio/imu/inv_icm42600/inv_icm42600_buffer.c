@@ -9,6 +9,8 @@
 #include <linux/pm_runtime.h>
 #include <linux/regmap.h>
 #include <linux/delay.h>
+#include <linux/math64.h>
+#include <asm/unaligned.h>
 
 #include <linux/iio/buffer.h>
 #include <linux/iio/common/inv_sensors_timestamp.h>
@@ -41,6 +43,11 @@ struct inv_icm42600_fifo_2sensors_packet {
 } __packed;
 #define INV_ICM42600_FIFO_2SENSORS_PACKET_SIZE		16
 
+/* nominal ns per chip us, in 16.16 fixed point */
+#define INV_ICM42600_TSYNC_MULT		(NSEC_PER_USEC << 16)
+/* chip clock deviation from its nominal rate accepted, in per mille */
+#define INV_ICM42600_TSYNC_DRIFT	20
+
 ssize_t inv_icm42600_fifo_decode_packet(const void *packet, const void **accel,
 					const void **gyro, const int8_t **temp,
 					const void **timestamp, unsigned int *odr)
@@ -272,6 +279,216 @@ int inv_icm42600_buffer_update_watermark(struct inv_icm42600_state *st)
 	return 0;
 }
 
+/* Registers of MREG1 are written indirectly, through the bank 0 window */
+static int inv_icm42670_write_mreg1(struct inv_icm42600_state *st,
+				    unsigned int reg, unsigned int val)
+{
+	int ret;
+
+	ret = regmap_write(st->map, INV_ICM42670_REG_BLK_SEL_W, 0);
+	if (ret)
+		return ret;
+
+	ret = regmap_write(st->map, INV_ICM42670_MADDR_W, reg);
+	if (ret)
+		return ret;
+
+	ret = regmap_write(st->map, INV_ICM42670_M_W, val);
+	if (ret)
+		return ret;
+
+	usleep_range(INV_ICM42670_MREG_WRITE_TIME_US,
+		     2 * INV_ICM42670_MREG_WRITE_TIME_US);
+
+	return 0;
+}
+
+/*
+ * Batching: the FIFO streams and is read in a single burst on watermark
+ * interrupts, the watermark being the number of samples of the maximum
+ * latency set by userspace.
+ */
+static int inv_icm42600_buffer_batch_on(struct inv_icm42600_state *st)
+{
+	size_t packet_size = inv_icm42600_get_packet_size(st->fifo.en);
+	uint32_t period_us = st->fifo.period / NSEC_PER_USEC;
+	unsigned int val, wm;
+	__le16 raw_wm;
+	int ret;
+
+	wm = clamp_t(unsigned int, st->fifo.max_latency_us / period_us, 1,
+		     INV_ICM42600_FIFO_WATERMARK_MAX / packet_size);
+
+	val = INV_ICM42670_FIFO_CONFIG5_WM_GT_TH;
+	if (st->fifo.en & INV_ICM42600_SENSOR_GYRO)
+		val |= INV_ICM42670_FIFO_CONFIG5_GYRO_EN;
+	if (st->fifo.en & INV_ICM42600_SENSOR_ACCEL)
+		val |= INV_ICM42670_FIFO_CONFIG5_ACCEL_EN;
+	ret = inv_icm42670_write_mreg1(st, INV_ICM42670_FIFO_CONFIG5, val);
+	if (ret)
+		return ret;
+
+	/* absolute FIFO timestamps with 1us resolution */
+	ret = inv_icm42670_write_mreg1(st, INV_ICM42670_TMST_CONFIG1,
+				       INV_ICM42670_TMST_CONFIG1_TMST_EN);
+	if (ret)
+		return ret;
+
+	/* watermark is in bytes, the FIFO count being set in bytes */
+	raw_wm = INV_ICM42670_FIFO_WATERMARK_VAL(wm * packet_size);
+	memcpy(st->buffer, &raw_wm, sizeof(raw_wm));
+	ret = regmap_bulk_write(st->map, INV_ICM42670_REG_FIFO_CONFIG2,
+				st->buffer, sizeof(raw_wm));
+	if (ret)
+		return ret;
+
+	ret = regmap_write(st->map, INV_ICM42670_REG_FIFO_CONFIG1,
+			   INV_ICM42670_FIFO_CONFIG1_STREAM);
+	if (ret)
+		return ret;
+
+	ret = regmap_write(st->map, INV_ICM42670_REG_SIGNAL_PATH_RESET,
+			   INV_ICM42670_SIGNAL_PATH_RESET_FIFO_FLUSH);
+	if (ret)
+		return ret;
+
+	ret = regmap_update_bits(st->map, INV_ICM42670_REG_INT_SOURCE0,
+				 INV_ICM42600_INT_SOURCE0_UI_DRDY_INT1_EN |
+				 INV_ICM42600_INT_SOURCE0_FIFO_THS_INT1_EN,
+				 INV_ICM42600_INT_SOURCE0_FIFO_THS_INT1_EN);
+	if (ret)
+		return ret;
+
+	/* the interrupt handler waits for st->lock, held by the caller */
+	st->fifo.batch_wm = wm;
+	st->fifo.tsync.valid = false;
+	st->fifo.batching = true;
+
+	return 0;
+}
+
+static uint32_t inv_icm42600_tsync_delta(uint16_t raw, uint16_t prev,
+					 uint32_t period_us)
+{
+	uint32_t delta = (uint16_t)(raw - prev);
+
+	/* the 16 bits counter wraps every 65.5ms, maybe several times */
+	while (delta + 32768 < period_us)
+		delta += 65536;
+
+	return delta;
+}
+
+static int64_t inv_icm42600_tsync_scale(int64_t chip, uint32_t mult)
+{
+	if (chip < 0)
+		return -(int64_t)mul_u64_u32_shr(-chip, mult, 16);
+
+	return mul_u64_u32_shr(chip, mult, 16);
+}
+
+/*
+ * Compute the system timestamps of the samples in the FIFO data buffer from
+ * their FIFO timestamps. Samples are spaced by the chip time between them,
+ * scaled by the measured rate of the chip clock, and the sample that raised
+ * the interrupt is slewed towards the interrupt timestamp: the interrupt
+ * latency jitter is filtered out while the timestamps keep following the
+ * system clock. Single sensor packets have no timestamp and are spaced by
+ * the FIFO period.
+ */
+static void inv_icm42600_buffer_tsync(struct inv_icm42600_state *st,
+				      int64_t ts, unsigned int anchor)
+{
+	struct inv_icm42600_tsync *tsync = &st->fifo.tsync;
+	uint32_t period_us = st->fifo.period / NSEC_PER_USEC;
+	const void *accel, *gyro, *timestamp;
+	const int8_t *temp;
+	unsigned int odr, no;
+	uint64_t chip = tsync->chip;
+	uint16_t raw = tsync->raw;
+	bool prev = tsync->valid;
+	uint64_t anchor_chip;
+	int64_t base, err, last;
+	ssize_t i, size;
+
+	/* unwrapped chip time of every sample */
+	for (i = 0, no = 0; i < st->fifo.count && no < ARRAY_SIZE(st->fifo.ts);
+	     i += size, ++no) {
+		size = inv_icm42600_fifo_decode_packet(&st->fifo.data[i],
+				&accel, &gyro, &temp, &timestamp, &odr);
+		if (size <= 0)
+			break;
+		if (timestamp) {
+			/* FIFO data follows sensor data endianness */
+			uint16_t val = get_unaligned_le16(timestamp);
+
+			if (prev)
+				chip += inv_icm42600_tsync_delta(val, raw,
+								 period_us);
+			raw = val;
+		} else if (prev) {
+			chip += period_us;
+			raw += period_us;
+		}
+		prev = true;
+		st->fifo.ts[no] = chip;
+	}
+	tsync->nb = no;
+	if (no == 0)
+		return;
+
+	/* sample that raised the watermark interrupt, the last one if flushed */
+	if (anchor == 0 || anchor > no)
+		anchor = no;
+	anchor_chip = st->fifo.ts[anchor - 1];
+
+	if (tsync->valid) {
+		uint64_t dchip = anchor_chip - tsync->anchor_chip;
+		int64_t dts = ts - tsync->anchor_ts;
+		int64_t mult;
+
+		/* track the chip clock rate, ignoring anything off its spec */
+		if (dchip && dts > 0) {
+			mult = div64_u64((uint64_t)dts << 16, dchip);
+			if (abs(mult - INV_ICM42600_TSYNC_MULT) <=
+			    INV_ICM42600_TSYNC_MULT / 1000 * INV_ICM42600_TSYNC_DRIFT)
+				tsync->mult += (mult - (int64_t)tsync->mult) / 8;
+		}
+
+		base = tsync->ts + inv_icm42600_tsync_scale(anchor_chip -
+						tsync->chip, tsync->mult);
+		err = ts - base;
+		/* resync on large errors, like after samples got lost */
+		if (abs(err) > max_t(int64_t, 2 * st->fifo.period, NSEC_PER_MSEC))
+			base = ts;
+		else
+			base += err / 8;
+		last = tsync->ts;
+	} else {
+		tsync->mult = INV_ICM42600_TSYNC_MULT;
+		base = ts;
+		last = S64_MIN;
+	}
+
+	for (no = 0; no < tsync->nb; ++no) {
+		int64_t t = base + inv_icm42600_tsync_scale(st->fifo.ts[no] -
+						(int64_t)anchor_chip, tsync->mult);
+
+		/* never go back in time, even when resyncing */
+		if (t <= last)
+			t = last + 1;
+		st->fifo.ts[no] = t;
+		last = t;
+	}
+
+	tsync->raw = raw;
+	tsync->chip = chip;
+	tsync->ts = last;
+	tsync->anchor_chip = anchor_chip;
+	tsync->anchor_ts = ts;
+	tsync->valid = true;
+}
+
 static int inv_icm42600_buffer_preenable(struct iio_dev *indio_dev)
 {
 	struct inv_icm42600_state *st = iio_device_get_drvdata(indio_dev);
@@ -304,6 +521,13 @@ static int inv_icm42600_buffer_postenable(struct iio_dev *indio_dev)
 		goto out_on;
 	}
 
+	if (st->fifo.max_latency_us) {
+		ret = inv_icm42600_buffer_batch_on(st);
+		if (ret)
+			goto out_unlock;
+		goto out_on;
+	}
+
 	/* set DATA_RDY interrupt */
 	ret = regmap_update_bits(st->map, INV_ICM42670_REG_INT_SOURCE0,
 				 INV_ICM42600_INT_SOURCE0_UI_DRDY_INT1_EN,
@@ -338,12 +562,21 @@ static int inv_icm42600_buffer_predisable(struct iio_dev *indio_dev)
 		goto out_off;
 	}
 
-	/* disable DATA_RDY interrupt */
+	/* disable DATA_RDY and FIFO watermark interrupts */
 	ret = regmap_update_bits(st->map, INV_ICM42670_REG_INT_SOURCE0,
-				 INV_ICM42600_INT_SOURCE0_UI_DRDY_INT1_EN, 0);
+				 INV_ICM42600_INT_SOURCE0_UI_DRDY_INT1_EN |
+				 INV_ICM42600_INT_SOURCE0_FIFO_THS_INT1_EN, 0);
 	if (ret)
 		goto out_unlock;
 
+	if (st->fifo.batching) {
+		st->fifo.batching = false;
+		ret = regmap_write(st->map, INV_ICM42670_REG_FIFO_CONFIG1,
+				   INV_ICM42670_FIFO_CONFIG1_BYPASS);
+		if (ret)
+			goto out_unlock;
+	}
+
 out_off:
 	/* decrease data streaming on counter */
 	st->fifo.on--;
@@ -436,7 +669,7 @@ int inv_icm42600_buffer_fifo_read(struct inv_icm42600_state *st,
 				  unsigned int max)
 {
 	size_t max_count;
-	__be16 *raw_fifo_count;
+	__le16 *raw_fifo_count;
 	ssize_t i, size;
 	const void *accel, *gyro, *timestamp;
 	const int8_t *temp;
@@ -455,20 +688,23 @@ int inv_icm42600_buffer_fifo_read(struct inv_icm42600_state *st,
 	else
 		max_count = max * inv_icm42600_get_packet_size(st->fifo.en);
 
-	/* read FIFO count value */
-	raw_fifo_count = (__be16 *)st->buffer;
+	/* read FIFO count value, set to little-endian by buffer init */
+	raw_fifo_count = (__le16 *)st->buffer;
 	ret = regmap_bulk_read(st->map, INV_ICM42670_REG_FIFO_COUNT,
 			       raw_fifo_count, sizeof(*raw_fifo_count));
 	if (ret)
 		return ret;
-	st->fifo.count = be16_to_cpup(raw_fifo_count);
+	st->fifo.count = le16_to_cpup(raw_fifo_count);
 
 	/* check and clamp FIFO count value */
 	if (st->fifo.count == 0)
 		return 0;
 	if (st->fifo.count > max_count)
 		st->fifo.count = max_count;
-	/* read all FIFO data in internal buffer */
+	/*
+	 * read all FIFO data in internal buffer, as a single transfer large
+	 * enough for the bus controller to use DMA
+	 */
 	ret = regmap_noinc_read(st->map, INV_ICM42670_REG_FIFO_DATA,
 				st->fifo.data, st->fifo.count);
 	if (ret)
@@ -499,8 +735,14 @@ int inv_icm42600_buffer_fifo_parse(struct inv_icm42600_state *st)
 		return 0;
 	/* Handle unified IMU device */
 	ts = iio_priv(st->indio_dev);
-	inv_sensors_timestamp_interrupt(ts, st->fifo.period, st->fifo.nb.total,
-					st->fifo.nb.total, st->timestamp.accel);
+	if (st->fifo.batching)
+		inv_icm42600_buffer_tsync(st, st->timestamp.accel,
+					  st->fifo.batch_wm);
+	else
+		inv_sensors_timestamp_interrupt(ts, st->fifo.period,
+						st->fifo.nb.total,
+						st->fifo.nb.total,
+						st->timestamp.accel);
 	ret = inv_icm42600_imu_parse_fifo(st->indio_dev);
 	if (ret) {
 		return ret;
@@ -527,9 +769,12 @@ int inv_icm42600_buffer_hwfifo_flush(struct inv_icm42600_state *st,
 		return 0;
 	/* Handle unified IMU device */
 	ts = iio_priv(st->indio_dev);
-	inv_sensors_timestamp_interrupt(ts, st->fifo.period,
-					st->fifo.nb.total, st->fifo.nb.total,
-					imu_ts);
+	if (st->fifo.batching)
+		inv_icm42600_buffer_tsync(st, imu_ts, 0);
+	else
+		inv_sensors_timestamp_interrupt(ts, st->fifo.period,
+						st->fifo.nb.total,
+						st->fifo.nb.total, imu_ts);
 	ret = inv_icm42600_imu_parse_fifo(st->indio_dev);
 	if (ret) {
 		return ret;
@@ -537,6 +782,36 @@ int inv_icm42600_buffer_hwfifo_flush(struct inv_icm42600_state *st,
 	return 0;
 }
 
+/**
+ * inv_icm42600_buffer_batch_irq - read the FIFO on a watermark interrupt
+ * @st:	driver internal state
+ *
+ * Returns 0 on success, a negative error code otherwise.
+ */
+int inv_icm42600_buffer_batch_irq(struct inv_icm42600_state *st)
+{
+	struct device *dev = regmap_get_device(st->map);
+	unsigned int status;
+	int ret;
+
+	ret = regmap_read(st->map, INV_ICM42670_REG_INT_STATUS, &status);
+	if (ret)
+		return ret;
+
+	if (status & INV_ICM42600_INT_STATUS_FIFO_FULL)
+		dev_warn_ratelimited(dev, "FIFO full, samples lost\n");
+
+	if (!(status & (INV_ICM42600_INT_STATUS_FIFO_THS |
+			INV_ICM42600_INT_STATUS_FIFO_FULL)))
+		return 0;
+
+	ret = inv_icm42600_buffer_fifo_read(st, 0);
+	if (ret)
+		return ret;
+
+	return inv_icm42600_buffer_fifo_parse(st);
+}
+
 int inv_icm42600_buffer_init(struct inv_icm42600_state *st)
 {
 	unsigned int val;
@@ -15,6 +15,32 @@ struct inv_icm42600_state;
 #define INV_ICM42600_SENSOR_ACCEL	BIT(1)
 #define INV_ICM42600_SENSOR_TEMP	BIT(2)
 
+#define INV_ICM42600_FIFO_DATA_SIZE	2080
+/* smallest FIFO packet is 8 bytes */
+#define INV_ICM42600_FIFO_PACKETS_MAX	(INV_ICM42600_FIFO_DATA_SIZE / 8)
+
+/**
+ * struct inv_icm42600_tsync - FIFO timestamps alignment to the system clock
+ * @valid:	the fields below describe the last sample of a previous batch.
+ * @raw:	FIFO timestamp of the last sample, in chip us.
+ * @chip:	unwrapped chip time of the last sample, in chip us.
+ * @ts:		system timestamp given to the last sample, in ns.
+ * @anchor_chip: chip time of the sample that raised the last interrupt.
+ * @anchor_ts:	system timestamp of the last interrupt, in ns.
+ * @mult:	ns per chip us in 16.16 fixed point, tracks the chip clock drift.
+ * @nb:		number of samples with a timestamp in the FIFO timestamps buffer.
+ */
+struct inv_icm42600_tsync {
+	bool valid;
+	uint16_t raw;
+	uint64_t chip;
+	int64_t ts;
+	uint64_t anchor_chip;
+	int64_t anchor_ts;
+	uint32_t mult;
+	unsigned int nb;
+};
+
 /**
  * struct inv_icm42600_fifo - FIFO state variables
  * @on:		reference counter for FIFO on.
@@ -23,6 +49,12 @@ struct inv_icm42600_state;
  * @watermark:	watermark configuration values for accel and gyro.
  * @count:	number of bytes in the FIFO data buffer.
  * @nb:		gyro, accel and total samples in the FIFO data buffer.
+ * @max_latency_us: maximum latency of batched samples, 0 for a data ready
+ *		interrupt per sample.
+ * @batching:	FIFO is streaming and read on watermark interrupts.
+ * @batch_wm:	number of samples of the watermark interrupt when batching.
+ * @tsync:	FIFO timestamps alignment state.
+ * @ts:		system timestamps of the samples in the FIFO data buffer.
  * @data:	FIFO data buffer aligned for DMA (2kB + 32 bytes of read cache).
  */
 struct inv_icm42600_fifo {
@@ -39,7 +71,12 @@ struct inv_icm42600_fifo {
 		size_t accel;
 		size_t total;
 	} nb;
-	uint8_t data[2080] __aligned(IIO_DMA_MINALIGN);
+	unsigned int max_latency_us;
+	bool batching;
+	unsigned int batch_wm;
+	struct inv_icm42600_tsync tsync;
+	int64_t ts[INV_ICM42600_FIFO_PACKETS_MAX];
+	uint8_t data[INV_ICM42600_FIFO_DATA_SIZE] __aligned(IIO_DMA_MINALIGN);
 };
 
 /* FIFO data packet */
@@ -95,4 +132,6 @@ int inv_icm42600_buffer_fifo_parse(struct inv_icm42600_state *st);
 int inv_icm42600_buffer_hwfifo_flush(struct inv_icm42600_state *st,
 				     unsigned int count);
 
+int inv_icm42600_buffer_batch_irq(struct inv_icm42600_state *st);
+
 #endif
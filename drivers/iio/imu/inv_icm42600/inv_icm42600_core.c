@@ -452,6 +452,14 @@ static irqreturn_t inv_icm42600_irq_handler(int irq, void *_data)
 
 	mutex_lock(&st->lock);
 
+	/* FIFO watermark interrupt when batching */
+	if (st->fifo.batching) {
+		ret = inv_icm42600_buffer_batch_irq(st);
+		if (ret)
+			dev_err(dev, "FIFO read error %d\n", ret);
+		goto out_unlock;
+	}
+
 	ret = regmap_read(st->map, INV_ICM42670_REG_INT_STATUS_DRDY, &status);
 	if (ret)
 		goto out_unlock;
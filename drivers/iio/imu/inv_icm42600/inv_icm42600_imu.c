@@ -15,6 +15,7 @@
 #include <linux/iio/common/inv_sensors_timestamp.h>
 #include <linux/iio/iio.h>
 #include <linux/iio/kfifo_buf.h>
+#include <linux/iio/sysfs.h>
 
 #include "inv_icm42600.h"
 #include "inv_icm42600_temp.h"
@@ -535,6 +536,61 @@ static int inv_icm42600_imu_hwfifo_flush(struct iio_dev *indio_dev,
 	return ret;
 }
 
+static ssize_t inv_icm42600_imu_max_latency_show(struct device *dev,
+						 struct device_attribute *attr,
+						 char *buf)
+{
+	struct iio_dev *indio_dev = dev_to_iio_dev(dev);
+	struct inv_icm42600_state *st = iio_device_get_drvdata(indio_dev);
+	unsigned int val;
+
+	mutex_lock(&st->lock);
+	val = st->fifo.max_latency_us;
+	mutex_unlock(&st->lock);
+
+	return sysfs_emit(buf, "%u\n", val);
+}
+
+/*
+ * Maximum latency of the samples in us: when not 0, samples are batched in
+ * the FIFO and read on watermark interrupts instead of one by one on data
+ * ready interrupts. Taken into account when the buffer is enabled.
+ */
+static ssize_t inv_icm42600_imu_max_latency_store(struct device *dev,
+						  struct device_attribute *attr,
+						  const char *buf, size_t len)
+{
+	struct iio_dev *indio_dev = dev_to_iio_dev(dev);
+	struct inv_icm42600_state *st = iio_device_get_drvdata(indio_dev);
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &val);
+	if (ret)
+		return ret;
+
+	ret = iio_device_claim_direct_mode(indio_dev);
+	if (ret)
+		return ret;
+
+	mutex_lock(&st->lock);
+	st->fifo.max_latency_us = val;
+	mutex_unlock(&st->lock);
+
+	iio_device_release_direct_mode(indio_dev);
+
+	return len;
+}
+
+static IIO_DEVICE_ATTR(hwfifo_max_latency_us, 0644,
+		       inv_icm42600_imu_max_latency_show,
+		       inv_icm42600_imu_max_latency_store, 0);
+
+static const struct iio_dev_attr *inv_icm42600_imu_buffer_attrs[] = {
+	&iio_dev_attr_hwfifo_max_latency_us,
+	NULL,
+};
+
 static const struct iio_info inv_icm42600_imu_info = {
 	.read_raw = inv_icm42600_imu_read_raw,
 	.read_avail = inv_icm42600_imu_read_avail,
@@ -582,8 +638,9 @@ struct iio_dev *inv_icm42600_imu_init(struct inv_icm42600_state *st)
 	indio_dev->available_scan_masks = inv_icm42600_imu_scan_masks;
 	indio_dev->setup_ops = &inv_icm42600_buffer_ops;
 
-	ret = devm_iio_kfifo_buffer_setup(dev, indio_dev,
-					  &inv_icm42600_buffer_ops);
+	ret = devm_iio_kfifo_buffer_setup_ext(dev, indio_dev,
+					      &inv_icm42600_buffer_ops,
+					      inv_icm42600_imu_buffer_attrs);
 	if (ret)
 		return ERR_PTR(ret);
 
@@ -636,7 +693,10 @@ int inv_icm42600_imu_parse_fifo(struct iio_dev *indio_dev)
 		
 		/* convert 8 bits FIFO temperature in high resolution format */
 		buffer.temp = temp ? (*temp * 64) : 0;
-		ts_val = inv_sensors_timestamp_pop(ts);
+		if (st->fifo.batching && no < st->fifo.tsync.nb)
+			ts_val = st->fifo.ts[no];
+		else
+			ts_val = inv_sensors_timestamp_pop(ts);
 		iio_push_to_buffers_with_timestamp(indio_dev, &buffer, ts_val);
 	}
 
@@ -1518,11 +1518,94 @@ static int iio_buffer_chrdev_release(struct inode *inode, struct file *filep)
 	return 0;
 }
 
+static int iio_buffer_alloc_dmabuf(struct iio_buffer *buffer,
+				   struct iio_dmabuf_alloc_req __user *user_req)
+{
+	struct iio_dmabuf_alloc_req req;
+
+	if (!buffer->access->alloc_dmabuf)
+		return -ENOTTY;
+
+	if (copy_from_user(&req, user_req, sizeof(req)))
+		return -EFAULT;
+
+	if (req.resv || !req.size || req.size > SIZE_MAX)
+		return -EINVAL;
+
+	return buffer->access->alloc_dmabuf(buffer, req.size);
+}
+
+static int iio_buffer_enqueue_dmabuf(struct iio_buffer *buffer,
+				     struct iio_dmabuf __user *user_req)
+{
+	struct iio_dmabuf req;
+
+	if (!buffer->access->enqueue_dmabuf)
+		return -ENOTTY;
+
+	if (copy_from_user(&req, user_req, sizeof(req)))
+		return -EFAULT;
+
+	if (req.flags || req.bytes_used)
+		return -EINVAL;
+
+	return buffer->access->enqueue_dmabuf(buffer, &req);
+}
+
+static int iio_buffer_dequeue_dmabuf(struct iio_buffer *buffer,
+				     struct iio_dmabuf __user *user_req,
+				     bool nonblock)
+{
+	struct iio_dmabuf req = { };
+	int ret;
+
+	if (!buffer->access->dequeue_dmabuf)
+		return -ENOTTY;
+
+	ret = buffer->access->dequeue_dmabuf(buffer, &req, nonblock);
+	if (ret)
+		return ret;
+
+	/*
+	 * The DMABUF stays dequeued if this fails, userspace can still
+	 * enqueue it again as it knows its file descriptor.
+	 */
+	if (copy_to_user(user_req, &req, sizeof(req)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static long iio_buffer_chrdev_ioctl(struct file *filp, unsigned int cmd,
+				    unsigned long arg)
+{
+	struct iio_dev_buffer_pair *ib = filp->private_data;
+	struct iio_buffer *buffer = ib->buffer;
+	void __user *_arg = (void __user *)arg;
+
+	if (!ib->indio_dev->info)
+		return -ENODEV;
+
+	switch (cmd) {
+	case IIO_BUFFER_DMABUF_ALLOC_IOCTL:
+		return iio_buffer_alloc_dmabuf(buffer, _arg);
+	case IIO_BUFFER_DMABUF_ENQUEUE_IOCTL:
+		return iio_buffer_enqueue_dmabuf(buffer, _arg);
+	case IIO_BUFFER_DMABUF_DEQUEUE_IOCTL:
+		return iio_buffer_dequeue_dmabuf(buffer, _arg,
+						 filp->f_flags & O_NONBLOCK);
+	default:
+		return -ENOTTY;
+	}
+}
+
 static const struct file_operations iio_buffer_chrdev_fileops = {
 	.owner = THIS_MODULE,
 	.llseek = noop_llseek,
 	.read = iio_buffer_read,
 	.write = iio_buffer_write,
+	.unlocked_ioctl = iio_buffer_chrdev_ioctl,
+	.compat_ioctl = compat_ptr_ioctl,
 	.poll = iio_buffer_poll,
 	.release = iio_buffer_chrdev_release,
 };
@@ -1849,6 +1932,9 @@ static int iio_push_to_buffer(struct iio_buffer *buffer, const void *data)
 	if (ret)
 		return ret;
 
+	if (buffer->access->flags & INDIO_BUFFER_FLAG_BLOCK_WAKEUP)
+		return 0;
+
 	/*
 	 * We can't just test for watermark to decide if we wake the poll queue
 	 * because read may request less samples than the watermark.
@@ -7,6 +7,7 @@
 #include <linux/dev_printk.h>
 #include <linux/adreno-smmu-priv.h>
 #include <linux/delay.h>
+#include <linux/module.h>
 #include <linux/of_device.h>
 #include <linux/of_platform.h>
 #include <linux/firmware/qcom/qcom_scm.h>
@@ -555,6 +556,37 @@ static const struct of_device_id qcom_smmu_client_of_match[] __maybe_unused = {
 	{ }
 };
 
+/*
+ * Streaming multimedia masters unmap thousands of pages per second, and
+ * waiting for a TLB sync on every one of those unmaps dominates the cost.
+ * Optionally hand them DMA domains with a flush queue so that invalidation
+ * is batched, at the price of the usual non-strict window where a stale
+ * IOTLB entry may still reach a freed buffer.
+ */
+static bool qcom_smmu_client_fq;
+module_param_named(qcom_client_fq, qcom_smmu_client_fq, bool, 0444);
+MODULE_PARM_DESC(qcom_client_fq,
+	"Use lazy IOTLB invalidation for the video and camera DMA domains");
+
+static const struct of_device_id qcom_smmu_fq_client_of_match[] __maybe_unused = {
+	{ .compatible = "qcom,msm8916-camss" },
+	{ .compatible = "qcom,msm8916-venus" },
+	{ .compatible = "qcom,msm8996-camss" },
+	{ .compatible = "qcom,msm8996-venus" },
+	{ .compatible = "qcom,sc7180-venus" },
+	{ .compatible = "qcom,sc7280-camss" },
+	{ .compatible = "qcom,sc7280-venus" },
+	{ .compatible = "qcom,sc8280xp-camss" },
+	{ .compatible = "qcom,sdm660-camss" },
+	{ .compatible = "qcom,sdm660-venus" },
+	{ .compatible = "qcom,sdm845-camss" },
+	{ .compatible = "qcom,sdm845-venus" },
+	{ .compatible = "qcom,sdm845-venus-v2" },
+	{ .compatible = "qcom,sm8250-camss" },
+	{ .compatible = "qcom,sm8250-venus" },
+	{ }
+};
+
 static int qcom_smmu_init_context(struct arm_smmu_domain *smmu_domain,
 		struct io_pgtable_cfg *pgtbl_cfg, struct device *dev)
 {
@@ -690,7 +722,14 @@ static int qcom_smmu_def_domain_type(struct device *dev)
 	const struct of_device_id *match =
 		of_match_device(qcom_smmu_client_of_match, dev);
 
-	return match ? IOMMU_DOMAIN_IDENTITY : 0;
+	if (match)
+		return IOMMU_DOMAIN_IDENTITY;
+
+	if (qcom_smmu_client_fq &&
+	    of_match_device(qcom_smmu_fq_client_of_match, dev))
+		return IOMMU_DOMAIN_DMA_FQ;
+
+	return 0;
 }
 
 static int qcom_smmu500_reset(struct arm_smmu_device *smmu)
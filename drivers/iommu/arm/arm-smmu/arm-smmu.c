@@ -20,6 +20,7 @@
 #include <linux/acpi.h>
 #include <linux/acpi_iort.h>
 #include <linux/bitfield.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/dma-mapping.h>
 #include <linux/err.h>
@@ -33,6 +34,7 @@
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
 #include <linux/ratelimit.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 
 #include <linux/fsl/mc.h>
@@ -232,6 +234,8 @@ static void arm_smmu_tlb_sync_context(struct arm_smmu_domain *smmu_domain)
 	__arm_smmu_tlb_sync(smmu, ARM_SMMU_CB(smmu, smmu_domain->cfg.cbndx),
 			    ARM_SMMU_CB_TLBSYNC, ARM_SMMU_CB_TLBSTATUS);
 	spin_unlock_irqrestore(&smmu_domain->cb_lock, flags);
+
+	atomic_long_inc(&smmu->cbs[smmu_domain->cfg.cbndx].tlb_syncs);
 }
 
 static void arm_smmu_tlb_inv_context_s1(void *cookie)
@@ -459,6 +463,9 @@ static void arm_smmu_init_context_bank(struct arm_smmu_domain *smmu_domain,
 	bool stage1 = cfg->cbar != CBAR_TYPE_S2_TRANS;
 
 	cb->cfg = cfg;
+	atomic_long_set(&cb->tlb_syncs, 0);
+	atomic_long_set(&cb->tlb_flush_all, 0);
+	atomic_long_set(&cb->unmaps_deferred, 0);
 
 	/* TCR */
 	if (stage1) {
@@ -1211,6 +1218,10 @@ static size_t arm_smmu_unmap_pages(struct iommu_domain *domain, unsigned long io
 	ret = ops->unmap_pages(ops, iova, pgsize, pgcount, iotlb_gather);
 	arm_smmu_rpm_put(smmu);
 
+	/* Invalidation is left to the flush queue, saving a TLB sync */
+	if (iommu_iotlb_gather_queued(iotlb_gather))
+		atomic_long_inc(&smmu->cbs[to_smmu_domain(domain)->cfg.cbndx].unmaps_deferred);
+
 	return ret;
 }
 
@@ -1223,6 +1234,8 @@ static void arm_smmu_flush_iotlb_all(struct iommu_domain *domain)
 		arm_smmu_rpm_get(smmu);
 		smmu_domain->flush_ops->tlb_flush_all(smmu_domain);
 		arm_smmu_rpm_put(smmu);
+
+		atomic_long_inc(&smmu->cbs[smmu_domain->cfg.cbndx].tlb_flush_all);
 	}
 }
 
@@ -2050,6 +2063,47 @@ static void arm_smmu_rmr_install_bypass_smr(struct arm_smmu_device *smmu)
 	iort_put_rmr_sids(dev_fwnode(smmu->dev), &rmr_list);
 }
 
+#ifdef CONFIG_IOMMU_DEBUGFS
+static struct dentry *arm_smmu_debugfs;
+static DEFINE_MUTEX(arm_smmu_debugfs_lock);
+
+static int arm_smmu_tlb_stats_show(struct seq_file *s, void *data)
+{
+	struct arm_smmu_device *smmu = dev_get_drvdata(s->private);
+	int i;
+
+	seq_puts(s, "cb       syncs   flush_all  unmaps_deferred\n");
+	for (i = 0; i < smmu->num_context_banks; i++) {
+		struct arm_smmu_cb *cb = &smmu->cbs[i];
+
+		if (!READ_ONCE(cb->cfg))
+			continue;
+
+		seq_printf(s, "%-4d %10ld %10ld %16ld\n", i,
+			   atomic_long_read(&cb->tlb_syncs),
+			   atomic_long_read(&cb->tlb_flush_all),
+			   atomic_long_read(&cb->unmaps_deferred));
+	}
+
+	return 0;
+}
+
+static void arm_smmu_debugfs_init(struct arm_smmu_device *smmu)
+{
+	mutex_lock(&arm_smmu_debugfs_lock);
+	if (!arm_smmu_debugfs)
+		arm_smmu_debugfs = debugfs_create_dir("arm-smmu",
+						      iommu_debugfs_dir);
+	mutex_unlock(&arm_smmu_debugfs_lock);
+
+	smmu->debugfs = debugfs_create_dir(dev_name(smmu->dev), arm_smmu_debugfs);
+	debugfs_create_devm_seqfile(smmu->dev, "tlb_stats", smmu->debugfs,
+				    arm_smmu_tlb_stats_show);
+}
+#else
+static inline void arm_smmu_debugfs_init(struct arm_smmu_device *smmu) {}
+#endif
+
 static int arm_smmu_device_probe(struct platform_device *pdev)
 {
 	struct resource *res;
@@ -2179,6 +2233,8 @@ static int arm_smmu_device_probe(struct platform_device *pdev)
 	arm_smmu_device_reset(smmu);
 	arm_smmu_test_smr_masks(smmu);
 
+	arm_smmu_debugfs_init(smmu);
+
 	/*
 	 * We want to avoid touching dev->power.lock in fastpaths unless
 	 * it's really going to do something useful - pm_runtime_enabled()
@@ -2219,6 +2275,7 @@ static void arm_smmu_device_remove(struct platform_device *pdev)
 
 	iommu_device_unregister(&smmu->iommu);
 	iommu_device_sysfs_remove(&smmu->iommu);
+	debugfs_remove_recursive(smmu->debugfs);
 
 	arm_smmu_device_shutdown(pdev);
 }
@@ -328,6 +328,8 @@ struct arm_smmu_device {
 
 	spinlock_t			global_sync_lock;
 
+	struct dentry			*debugfs;
+
 	/* IOMMU core code handle */
 	struct iommu_device		iommu;
 };
@@ -357,6 +359,11 @@ struct arm_smmu_cb {
 	u32				tcr[2];
 	u32				mair[2];
 	struct arm_smmu_cfg		*cfg;
+
+	/* TLB maintenance statistics, reset when the bank is assigned */
+	atomic_long_t			tlb_syncs;
+	atomic_long_t			tlb_flush_all;
+	atomic_long_t			unmaps_deferred;
 };
 
 enum arm_smmu_domain_stage {
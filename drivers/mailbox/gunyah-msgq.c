@@ -8,20 +8,34 @@
 #include <linux/interrupt.h>
 #include <linux/gunyah.h>
 #include <linux/printk.h>
+#include <linux/sched.h>
 #include <linux/init.h>
 #include <linux/slab.h>
 #include <linux/wait.h>
 
 #define mbox_chan_to_msgq(chan) (container_of(chan->mbox, struct gh_msgq, mbox))
 
+/* Messages delivered to the client before giving other threads a chance to run */
+#define GH_MSGQ_RX_BUDGET	16
+
 static irqreturn_t gh_msgq_rx_irq_handler(int irq, void *data)
 {
 	struct gh_msgq *msgq = data;
 	struct gh_msgq_rx_data rx_data;
 	enum gh_error gh_error;
+	unsigned int budget = GH_MSGQ_RX_BUDGET;
 	bool ready = true;
 
+	/*
+	 * The whole burst is drained in one run of the IRQ thread rather than
+	 * taking an interrupt per message, but a long one shouldn't hog the CPU.
+	 */
 	while (ready) {
+		if (!budget--) {
+			cond_resched();
+			budget = GH_MSGQ_RX_BUDGET;
+		}
+
 		gh_error = gh_hypercall_msgq_recv(msgq->rx_ghrsc->capid,
 				&rx_data.data, sizeof(rx_data.data),
 				&rx_data.length, &ready);
@@ -37,12 +51,83 @@ static irqreturn_t gh_msgq_rx_irq_handler(int irq, void *data)
 	return IRQ_HANDLED;
 }
 
+/*
+ * Sends msgq->tx_next and the rest of its burst for as long as the message
+ * queue has space. *done is set once the whole burst is sent and the queue can
+ * accept another message, or the burst failed and msgq->last_ret says why.
+ * Otherwise the tx IRQ picks up where this left off.
+ *
+ * Returns -EAGAIN if the queue was full before anything could be sent.
+ */
+static int gh_msgq_send_burst(struct gh_msgq *msgq, bool *done)
+	__must_hold(&msgq->tx_lock)
+{
+	struct gh_msgq_tx_data *msgq_data;
+	enum gh_error gh_error;
+	bool ready, sent = false;
+	u64 tx_flags;
+
+	*done = false;
+
+	while ((msgq_data = msgq->tx_next)) {
+		tx_flags = 0;
+		if (msgq_data->push)
+			tx_flags |= GH_HYPERCALL_MSGQ_TX_FLAGS_PUSH;
+
+		gh_error = gh_hypercall_msgq_send(msgq->tx_ghrsc->capid, msgq_data->length,
+						  msgq_data->data, tx_flags, &ready);
+
+		/**
+		 * unlikely because Linux tracks state of msgq and should not try to
+		 * send message when msgq is full.
+		 */
+		if (unlikely(gh_error == GH_ERROR_MSGQUEUE_FULL))
+			return sent ? 0 : -EAGAIN;
+
+		/**
+		 * Propagate all other errors to client. If we return error to mailbox
+		 * framework, then no other messages can be sent and nobody will know
+		 * to retry this message.
+		 */
+		msgq->last_ret = gh_error_remap(gh_error);
+		if (gh_error != GH_ERROR_OK) {
+			dev_err(msgq->mbox.dev, "Failed to send data: %d (%d)\n", gh_error,
+				msgq->last_ret);
+			msgq->tx_next = NULL;
+			*done = true;
+			return 0;
+		}
+
+		sent = true;
+		msgq->tx_next = msgq_data->next;
+
+		/**
+		 * This message was successfully sent, but message queue isn't ready to
+		 * accept more messages because it's now full. Mailbox framework
+		 * requires that we only report that message was transmitted when
+		 * we're ready to transmit another message. We'll get that in the form
+		 * of tx IRQ once the other side starts to drain the msgq.
+		 */
+		if (!ready)
+			return 0;
+	}
+
+	*done = true;
+	return 0;
+}
+
 /* Fired when message queue transitions from "full" to "space available" to send messages */
 static irqreturn_t gh_msgq_tx_irq_handler(int irq, void *data)
 {
 	struct gh_msgq *msgq = data;
+	bool done;
+
+	spin_lock(&msgq->tx_lock);
+	gh_msgq_send_burst(msgq, &done);
+	spin_unlock(&msgq->tx_lock);
 
-	mbox_chan_txdone(gh_msgq_chan(msgq), 0);
+	if (done)
+		mbox_chan_txdone(gh_msgq_chan(msgq), msgq->last_ret);
 
 	return IRQ_HANDLED;
 }
@@ -58,47 +143,22 @@ static void gh_msgq_txdone_tasklet(struct tasklet_struct *tasklet)
 static int gh_msgq_send_data(struct mbox_chan *chan, void *data)
 {
 	struct gh_msgq *msgq = mbox_chan_to_msgq(chan);
-	struct gh_msgq_tx_data *msgq_data = data;
-	u64 tx_flags = 0;
-	enum gh_error gh_error;
-	bool ready;
+	unsigned long flags;
+	bool done;
+	int ret;
 
 	if (!msgq->tx_ghrsc)
 		return -EOPNOTSUPP;
 
-	if (msgq_data->push)
-		tx_flags |= GH_HYPERCALL_MSGQ_TX_FLAGS_PUSH;
-
-	gh_error = gh_hypercall_msgq_send(msgq->tx_ghrsc->capid, msgq_data->length, msgq_data->data,
-						tx_flags, &ready);
-
-	/**
-	 * unlikely because Linux tracks state of msgq and should not try to
-	 * send message when msgq is full.
-	 */
-	if (unlikely(gh_error == GH_ERROR_MSGQUEUE_FULL))
-		return -EAGAIN;
-
-	/**
-	 * Propagate all other errors to client. If we return error to mailbox
-	 * framework, then no other messages can be sent and nobody will know
-	 * to retry this message.
-	 */
-	msgq->last_ret = gh_error_remap(gh_error);
+	spin_lock_irqsave(&msgq->tx_lock, flags);
+	msgq->tx_next = data;
+	ret = gh_msgq_send_burst(msgq, &done);
+	if (ret)
+		msgq->tx_next = NULL;
+	spin_unlock_irqrestore(&msgq->tx_lock, flags);
 
-	/**
-	 * This message was successfully sent, but message queue isn't ready to
-	 * accept more messages because it's now full. Mailbox framework
-	 * requires that we only report that message was transmitted when
-	 * we're ready to transmit another message. We'll get that in the form
-	 * of tx IRQ once the other side starts to drain the msgq.
-	 */
-	if (gh_error == GH_ERROR_OK) {
-		if (!ready)
-			return 0;
-	} else {
-		dev_err(msgq->mbox.dev, "Failed to send data: %d (%d)\n", gh_error, msgq->last_ret);
-	}
+	if (ret || !done)
+		return ret;
 
 	/**
 	 * We can send more messages. Mailbox framework requires that tx done
@@ -125,7 +185,8 @@ static struct mbox_chan_ops gh_msgq_ops = {
  *
  * At least one of tx_ghrsc and rx_ghrsc must be not NULL. Most message queue use cases come with
  * a pair of message queues to facilitate bidirectional communication. When tx_ghrsc is set,
- * the client can send messages with mbox_send_message(gh_msgq_chan(msgq), msg). When rx_ghrsc
+ * the client can send messages with mbox_send_message(gh_msgq_chan(msgq), msg), where msg may
+ * chain further messages to be sent as one burst through gh_msgq_tx_data.next. When rx_ghrsc
  * is set, the mbox_client must register an .rx_callback() and the message queue driver will
  * deliver all available messages upon receiving the RX ready interrupt. The messages should be
  * consumed or copied by the client right away as the gh_msgq_rx_data will be replaced/destroyed
@@ -160,6 +221,7 @@ int gh_msgq_init(struct device *parent, struct gh_msgq *msgq, struct mbox_client
 
 	if (tx_ghrsc) {
 		msgq->tx_ghrsc = tx_ghrsc;
+		spin_lock_init(&msgq->tx_lock);
 
 		ret = request_irq(msgq->tx_ghrsc->irq, gh_msgq_tx_irq_handler, 0, "gh_msgq_tx",
 				msgq);
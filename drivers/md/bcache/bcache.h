@@ -361,6 +361,14 @@ struct cached_dev {
 	struct list_head	io_lru;
 	spinlock_t		io_lock;
 
+	/*
+	 * Bucket sized regions of the backing device read recently, for
+	 * read_admit_on_reuse.  Entries are region + 1, 0 if unused.
+	 */
+#define RECENT_MISS_BITS	10
+#define RECENT_MISS		(1 << RECENT_MISS_BITS)
+	uint64_t		recent_miss[RECENT_MISS];
+
 	struct cache_accounting	accounting;
 
 	/* The rest of this all shows up in sysfs */
@@ -369,6 +377,7 @@ struct cached_dev {
 	unsigned int		io_disable:1;
 	unsigned int		verify:1;
 	unsigned int		bypass_torture_test:1;
+	unsigned int		read_admit_on_reuse:1;
 
 	unsigned int		partial_stripes_expensive:1;
 	unsigned int		writeback_metadata:1;
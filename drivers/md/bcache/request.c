@@ -360,6 +360,25 @@ static struct hlist_head *iohash(struct cached_dev *dc, uint64_t k)
 	return &dc->io_hash[hash_64(k, RECENT_IO_BITS)];
 }
 
+/*
+ * Returns true if the bucket sized region @bio starts in was read before,
+ * within roughly the last RECENT_MISS regions read, and remembers it
+ * otherwise.  Races between readers only cost a lost or an early admission.
+ */
+static bool read_region_reused(struct cached_dev *dc, struct bio *bio)
+{
+	struct cache_set *c = dc->disk.c;
+	uint64_t region = div_u64(bio->bi_iter.bi_sector,
+				  c->cache->sb.bucket_size) + 1;
+	uint64_t *slot = &dc->recent_miss[hash_64(region, RECENT_MISS_BITS)];
+
+	if (READ_ONCE(*slot) == region)
+		return true;
+
+	WRITE_ONCE(*slot, region);
+	return false;
+}
+
 static bool check_should_bypass(struct cached_dev *dc, struct bio *bio)
 {
 	struct cache_set *c = dc->disk.c;
@@ -400,6 +419,16 @@ static bool check_should_bypass(struct cached_dev *dc, struct bio *bio)
 		goto skip;
 	}
 
+	/*
+	 * Data read only once, e.g. while a large file is streamed in for the
+	 * first time, would just push out data that is read again and again.
+	 * Only admit reads of regions read before, metadata always.
+	 */
+	if (dc->read_admit_on_reuse && !op_is_write(bio_op(bio)) &&
+	    !(bio->bi_opf & (REQ_META|REQ_PRIO)) &&
+	    !read_region_reused(dc, bio))
+		goto skip;
+
 	if (bypass_torture_test(dc)) {
 		if (get_random_u32_below(4) == 3)
 			goto skip;
@@ -111,6 +111,7 @@ rw_attribute(sequential_cutoff);
 rw_attribute(data_csum);
 rw_attribute(cache_mode);
 rw_attribute(readahead_cache_policy);
+rw_attribute(read_admit_on_reuse);
 rw_attribute(stop_when_cache_set_failed);
 rw_attribute(writeback_metadata);
 rw_attribute(writeback_running);
@@ -196,6 +197,7 @@ SHOW(__bch_cached_dev)
 	sysfs_printf(data_csum,		"%i", dc->disk.data_csum);
 	var_printf(verify,		"%i");
 	var_printf(bypass_torture_test,	"%i");
+	var_printf(read_admit_on_reuse,	"%i");
 	var_printf(writeback_metadata,	"%i");
 	var_printf(writeback_running,	"%i");
 	var_printf(writeback_consider_fragment,	"%i");
@@ -307,6 +309,7 @@ STORE(__cached_dev)
 	sysfs_strtoul(data_csum,	dc->disk.data_csum);
 	d_strtoul(verify);
 	sysfs_strtoul_bool(bypass_torture_test, dc->bypass_torture_test);
+	sysfs_strtoul_bool(read_admit_on_reuse, dc->read_admit_on_reuse);
 	sysfs_strtoul_bool(writeback_metadata, dc->writeback_metadata);
 	sysfs_strtoul_bool(writeback_running, dc->writeback_running);
 	sysfs_strtoul_bool(writeback_consider_fragment, dc->writeback_consider_fragment);
@@ -531,6 +534,7 @@ static struct attribute *bch_cached_dev_attrs[] = {
 	&sysfs_stripe_size,
 	&sysfs_partial_stripes_expensive,
 	&sysfs_sequential_cutoff,
+	&sysfs_read_admit_on_reuse,
 	&sysfs_clear_stats,
 	&sysfs_running,
 	&sysfs_state,
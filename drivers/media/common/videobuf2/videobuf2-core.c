@@ -34,6 +34,10 @@
 static int debug;
 module_param(debug, int, 0644);
 
+static unsigned int dmabuf_cache = VB2_DMABUF_CACHE_SIZE;
+module_param(dmabuf_cache, uint, 0644);
+MODULE_PARM_DESC(dmabuf_cache, "Number of unused dmabuf attachments each queue keeps mapped");
+
 #define dprintk(q, level, fmt, arg...)					\
 	do {								\
 		if (debug >= level)					\
@@ -304,6 +308,135 @@ static void __vb2_plane_dmabuf_put(struct vb2_buffer *vb, struct vb2_plane *p)
 	p->dbuf_mapped = 0;
 }
 
+/*
+ * Userspace is free to queue any dmabuf with any buffer index, and e.g.
+ * GStreamer does not keep the two in step. A buffer queued with a dmabuf
+ * other than the one it had before would have to detach the old one and
+ * attach and map the new one, even though that is usually still attached
+ * to another buffer or was detached from one a few frames ago. Instead the
+ * dmabufs a buffer drops are parked in a small per-queue cache, still
+ * mapped, and handed to the next buffer queued with them.
+ */
+
+#ifdef CONFIG_VIDEO_ADV_DEBUG
+/* To the balance checks, a parked attachment is detached from its buffer */
+static void vb2_dmabuf_cache_account(struct vb2_buffer *vb, int sign)
+{
+	vb->cnt_mem_attach_dmabuf += sign > 0;
+	vb->cnt_mem_map_dmabuf += sign > 0;
+	vb->cnt_mem_unmap_dmabuf += sign < 0;
+	vb->cnt_mem_detach_dmabuf += sign < 0;
+}
+#else
+static inline void vb2_dmabuf_cache_account(struct vb2_buffer *vb, int sign)
+{
+}
+#endif
+
+static void vb2_dmabuf_cache_drop(struct vb2_queue *q,
+				  struct vb2_dmabuf_cache_entry *e)
+{
+	q->mem_ops->unmap_dmabuf(e->mem_priv);
+	q->mem_ops->detach_dmabuf(e->mem_priv);
+	dma_buf_put(e->dbuf);
+	memset(e, 0, sizeof(*e));
+}
+
+/*
+ * vb2_dmabuf_cache_flush() - drop all parked dmabufs, done before the
+ * buffers they were last attached through are freed
+ */
+static void vb2_dmabuf_cache_flush(struct vb2_queue *q)
+{
+	unsigned int i;
+
+	for (i = 0; i < VB2_DMABUF_CACHE_SIZE; i++)
+		if (q->dmabuf_cache[i].dbuf)
+			vb2_dmabuf_cache_drop(q, &q->dmabuf_cache[i]);
+}
+
+/*
+ * vb2_dmabuf_cache_park() - park the dmabuf of a plane instead of releasing
+ * it, evicting the oldest entry other than one of @next, which the plane is
+ * about to take, if the cache is full
+ */
+static bool vb2_dmabuf_cache_park(struct vb2_buffer *vb, unsigned int plane,
+				  struct dma_buf *next)
+{
+	struct vb2_queue *q = vb->vb2_queue;
+	struct vb2_plane *p = &vb->planes[plane];
+	struct vb2_dmabuf_cache_entry *e = NULL;
+	unsigned int i, size = min_t(unsigned int, READ_ONCE(dmabuf_cache),
+				     VB2_DMABUF_CACHE_SIZE);
+
+	if (!size || !q->mem_ops->move_dmabuf || !p->mem_priv ||
+	    !p->dbuf_mapped)
+		return false;
+
+	for (i = 0; i < size; i++) {
+		if (!q->dmabuf_cache[i].dbuf) {
+			e = &q->dmabuf_cache[i];
+			break;
+		}
+		if (q->dmabuf_cache[i].dbuf != next &&
+		    (!e || q->dmabuf_cache[i].stamp < e->stamp))
+			e = &q->dmabuf_cache[i];
+	}
+	if (!e)
+		return false;
+	if (e->dbuf)
+		vb2_dmabuf_cache_drop(q, e);
+
+	e->dbuf = p->dbuf;
+	e->mem_priv = p->mem_priv;
+	e->dev = q->alloc_devs[plane] ? : q->dev;
+	e->length = p->length;
+	e->stamp = ++q->dmabuf_stamp;
+	vb2_dmabuf_cache_account(vb, -1);
+
+	p->mem_priv = NULL;
+	p->dbuf = NULL;
+	p->dbuf_mapped = 0;
+
+	return true;
+}
+
+/*
+ * vb2_dmabuf_cache_take() - move a parked attachment of @dbuf to a plane,
+ * consuming the caller's reference to @dbuf
+ */
+static bool vb2_dmabuf_cache_take(struct vb2_buffer *vb, unsigned int plane,
+				  struct dma_buf *dbuf, unsigned int length)
+{
+	struct vb2_queue *q = vb->vb2_queue;
+	struct device *dev = q->alloc_devs[plane] ? : q->dev;
+	struct vb2_plane *p = &vb->planes[plane];
+	struct vb2_dmabuf_cache_entry *e;
+	unsigned int i;
+
+	for (i = 0; i < VB2_DMABUF_CACHE_SIZE; i++) {
+		e = &q->dmabuf_cache[i];
+		if (e->dbuf == dbuf && e->dev == dev && e->length == length)
+			break;
+	}
+	if (i == VB2_DMABUF_CACHE_SIZE)
+		return false;
+
+	dprintk(q, 3, "reusing cached dmabuf for plane %d\n", plane);
+
+	q->mem_ops->move_dmabuf(e->mem_priv, vb);
+	vb2_dmabuf_cache_account(vb, 1);
+	p->dbuf = e->dbuf;
+	p->mem_priv = e->mem_priv;
+	p->dbuf_mapped = 1;
+	memset(e, 0, sizeof(*e));
+
+	/* The cache already held a reference */
+	dma_buf_put(dbuf);
+
+	return true;
+}
+
 /*
  * __vb2_buf_dmabuf_put() - release memory associated with
  * a DMABUF shared buffer
@@ -508,6 +641,9 @@ static void __vb2_queue_free(struct vb2_queue *q, unsigned int buffers)
 
 	lockdep_assert_held(&q->mmap_lock);
 
+	/* Parked dmabufs may have been attached through any of the buffers */
+	vb2_dmabuf_cache_flush(q);
+
 	/* Call driver-provided cleanup function for each buffer, if provided */
 	for (buffer = q->num_buffers - buffers; buffer < q->num_buffers;
 	     ++buffer) {
@@ -1295,12 +1431,17 @@ static int __prepare_dmabuf(struct vb2_buffer *vb)
 		}
 
 		/* Release previously acquired memory if present */
-		__vb2_plane_dmabuf_put(vb, &vb->planes[plane]);
+		if (!vb2_dmabuf_cache_park(vb, plane, dbuf))
+			__vb2_plane_dmabuf_put(vb, &vb->planes[plane]);
 		vb->planes[plane].bytesused = 0;
 		vb->planes[plane].length = 0;
 		vb->planes[plane].m.fd = 0;
 		vb->planes[plane].data_offset = 0;
 
+		if (vb2_dmabuf_cache_take(vb, plane, dbuf,
+					  planes[plane].length))
+			continue;
+
 		/* Acquire each plane's memory */
 		mem_priv = call_ptr_memop(attach_dmabuf,
 					  vb,
@@ -601,6 +601,13 @@ static void vb2_dma_sg_unmap_dmabuf(void *mem_priv)
 	buf->dma_sgt = NULL;
 }
 
+static void vb2_dma_sg_move_dmabuf(void *mem_priv, struct vb2_buffer *vb)
+{
+	struct vb2_dma_sg_buf *buf = mem_priv;
+
+	buf->vb = vb;
+}
+
 static void vb2_dma_sg_detach_dmabuf(void *mem_priv)
 {
 	struct vb2_dma_sg_buf *buf = mem_priv;
@@ -667,6 +674,7 @@ const struct vb2_mem_ops vb2_dma_sg_memops = {
 	.get_dmabuf	= vb2_dma_sg_get_dmabuf,
 	.map_dmabuf	= vb2_dma_sg_map_dmabuf,
 	.unmap_dmabuf	= vb2_dma_sg_unmap_dmabuf,
+	.move_dmabuf	= vb2_dma_sg_move_dmabuf,
 	.attach_dmabuf	= vb2_dma_sg_attach_dmabuf,
 	.detach_dmabuf	= vb2_dma_sg_detach_dmabuf,
 	.cookie		= vb2_dma_sg_cookie,
@@ -0,0 +1,57 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM camss
+
+#if !defined(_TRACE_CAMSS_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_CAMSS_H
+#include <linux/dma-buf.h>
+#include <linux/tracepoint.h>
+#include <media/videobuf2-v4l2.h>
+
+/*
+ * A buffer filled by the VFE. Only buffers imported from a DMA-buf carry its
+ * identity, it is 0 for MMAP buffers.
+ */
+TRACE_EVENT(camss_vfe_buf_done,
+
+	TP_PROTO(const char *video, struct vb2_v4l2_buffer *vbuf),
+
+	TP_ARGS(video, vbuf),
+
+	TP_STRUCT__entry(
+		__string(video, video)
+		__field(u32, index)
+		__field(u32, sequence)
+		__field(u64, timestamp)
+		__field(u64, dmabuf)
+	),
+
+	TP_fast_assign(
+		__assign_str(video, video);
+		__entry->index = vbuf->vb2_buf.index;
+		__entry->sequence = vbuf->sequence;
+		__entry->timestamp = vbuf->vb2_buf.timestamp;
+		__entry->dmabuf = vbuf->vb2_buf.memory == VB2_MEMORY_DMABUF ?
+			dma_buf_trace_id(vbuf->vb2_buf.planes[0].dbuf) : 0;
+	),
+
+	TP_printk("video: %s index: %u sequence: %u timestamp: %llu dmabuf: %llu",
+		  __get_str(video), __entry->index, __entry->sequence,
+		  __entry->timestamp, __entry->dmabuf
+	)
+);
+
+#endif /* _TRACE_CAMSS_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH ../../drivers/media/platform/qcom/camss
+
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE camss-trace
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
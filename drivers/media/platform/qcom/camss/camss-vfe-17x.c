@@ -372,7 +372,7 @@ static irqreturn_t vfe_isr(int irq, void *dev)
 			vfe->isr_ops.reg_update(vfe, i);
 
 	for (i = VFE_LINE_RDI0; i < vfe->res->line_num; i++)
-		if (status0 & STATUS_1_RDI_SOF(i))
+		if (status1 & STATUS_1_RDI_SOF(i))
 			vfe->isr_ops.sof(vfe, i);
 
 	for (i = 0; i < MSM_VFE_COMPOSITE_IRQ_NUM; i++)
@@ -447,6 +447,7 @@ static int vfe_enable_output(struct vfe_line *line)
 	unsigned long flags;
 	unsigned int frame_skip = 0;
 	unsigned int i;
+	u32 kick;
 
 	sensor = camss_find_sensor(&line->subdev.entity);
 	if (sensor) {
@@ -480,17 +481,20 @@ static int vfe_enable_output(struct vfe_line *line)
 	vfe_wm_start(vfe, output->wm_idx[0], line);
 
 	for (i = 0; i < 2; i++) {
-		output->buf[i] = vfe_buf_get_pending(output);
+		output->buf[i] = vfe_buf_get_next(output);
 		if (!output->buf[i])
 			break;
 		output->gen2.active_num++;
 		vfe_wm_update(vfe, output->wm_idx[0], output->buf[i]->addr[0], line);
 	}
 
-	ops->reg_update(vfe, line->id);
+	if (vfe_sync_arm(line, &kick))
+		ops->reg_update(vfe, line->id);
 
 	spin_unlock_irqrestore(&vfe->output_lock, flags);
 
+	vfe_sync_kick(line, kick);
+
 	return 0;
 }
 
@@ -514,6 +518,10 @@ static int vfe_enable(struct vfe_line *line)
 
 	mutex_unlock(&vfe->stream_lock);
 
+	ret = vfe_scratch_alloc(line);
+	if (ret < 0)
+		goto error_get_output;
+
 	ret = vfe_get_output(line);
 	if (ret < 0)
 		goto error_get_output;
@@ -530,6 +538,8 @@ static int vfe_enable(struct vfe_line *line)
 	vfe_put_output(line);
 
 error_get_output:
+	vfe_scratch_free(line);
+
 	mutex_lock(&vfe->stream_lock);
 
 	vfe->stream_count--;
@@ -546,7 +556,8 @@ static int vfe_enable(struct vfe_line *line)
  */
 static void vfe_isr_sof(struct vfe_device *vfe, enum vfe_line_id line_id)
 {
-	/* nop */
+	vfe_sync_sof(&vfe->line[line_id], ktime_get_ns());
+	vfe_progress_sof(&vfe->line[line_id]);
 }
 
 /*
@@ -602,15 +613,28 @@ static void vfe_isr_wm_done(struct vfe_device *vfe, u8 wm)
 		goto out_unlock;
 	}
 
-	ready_buf->vb.vb2_buf.timestamp = ts;
-	ready_buf->vb.sequence = output->sequence++;
+	vfe_progress_done(line, ts);
+
+	if (vfe_buf_is_scratch(output, ready_buf)) {
+		/* Userspace was late: count the frame, there is no buffer to return */
+		output->sequence++;
+		output->late++;
+	} else if (output->sync && output->sof_ts) {
+		/* Stamp with the start of frame, so that members line up */
+		ready_buf->vb.vb2_buf.timestamp = output->sof_ts;
+		ready_buf->vb.sequence = output->group_seq;
+		output->sequence++;
+	} else {
+		ready_buf->vb.vb2_buf.timestamp = ts;
+		ready_buf->vb.sequence = output->sequence++;
+	}
 
 	index = 0;
 	output->buf[0] = output->buf[1];
 	if (output->buf[0])
 		index = 1;
 
-	output->buf[index] = vfe_buf_get_pending(output);
+	output->buf[index] = vfe_buf_get_next(output);
 
 	if (output->buf[index])
 		vfe_wm_update(vfe, output->wm_idx[0], output->buf[index]->addr[0], line);
@@ -619,7 +643,8 @@ static void vfe_isr_wm_done(struct vfe_device *vfe, u8 wm)
 
 	spin_unlock_irqrestore(&vfe->output_lock, flags);
 
-	vb2_buffer_done(&ready_buf->vb.vb2_buf, VB2_BUF_STATE_DONE);
+	if (!vfe_buf_is_scratch(output, ready_buf))
+		msm_video_buffer_done(&line->video_out, ready_buf);
 
 	return;
 
@@ -310,7 +310,7 @@ static int vfe_enable_output(struct vfe_line *line)
 	vfe_wm_start(vfe, output->wm_idx[0], line);
 
 	for (i = 0; i < 2; i++) {
-		output->buf[i] = vfe_buf_get_pending(output);
+		output->buf[i] = vfe_buf_get_next(output);
 		if (!output->buf[i])
 			break;
 		output->gen2.active_num++;
@@ -346,6 +346,10 @@ static int vfe_enable(struct vfe_line *line)
 
 	mutex_unlock(&vfe->stream_lock);
 
+	ret = vfe_scratch_alloc(line);
+	if (ret < 0)
+		goto error_get_output;
+
 	ret = vfe_get_output(line);
 	if (ret < 0)
 		goto error_get_output;
@@ -362,6 +366,8 @@ static int vfe_enable(struct vfe_line *line)
 	vfe_put_output(line);
 
 error_get_output:
+	vfe_scratch_free(line);
+
 	mutex_lock(&vfe->stream_lock);
 
 	vfe->stream_count--;
@@ -424,15 +430,21 @@ static void vfe_isr_wm_done(struct vfe_device *vfe, u8 wm)
 		goto out_unlock;
 	}
 
-	ready_buf->vb.vb2_buf.timestamp = ts;
-	ready_buf->vb.sequence = output->sequence++;
+	if (vfe_buf_is_scratch(output, ready_buf)) {
+		/* Userspace was late: count the frame, there is no buffer to return */
+		output->sequence++;
+		output->late++;
+	} else {
+		ready_buf->vb.vb2_buf.timestamp = ts;
+		ready_buf->vb.sequence = output->sequence++;
+	}
 
 	index = 0;
 	output->buf[0] = output->buf[1];
 	if (output->buf[0])
 		index = 1;
 
-	output->buf[index] = vfe_buf_get_pending(output);
+	output->buf[index] = vfe_buf_get_next(output);
 
 	if (output->buf[index])
 		vfe_wm_update(vfe, output->wm_idx[0], output->buf[index]->addr[0], line);
@@ -441,7 +453,8 @@ static void vfe_isr_wm_done(struct vfe_device *vfe, u8 wm)
 
 	spin_unlock_irqrestore(&vfe->output_lock, flags);
 
-	vb2_buffer_done(&ready_buf->vb.vb2_buf, VB2_BUF_STATE_DONE);
+	if (!vfe_buf_is_scratch(output, ready_buf))
+		msm_video_buffer_done(&line->video_out, ready_buf);
 
 	return;
 
@@ -609,6 +609,7 @@ static void vfe_isr_wm_done(struct vfe_device *vfe, u8 wm)
 {
 	struct camss_buffer *ready_buf;
 	struct vfe_output *output;
+	struct vfe_line *line;
 	dma_addr_t *new_addr;
 	unsigned long flags;
 	u32 active_index;
@@ -624,7 +625,8 @@ static void vfe_isr_wm_done(struct vfe_device *vfe, u8 wm)
 				    "Received wm done for unmapped index\n");
 		goto out_unlock;
 	}
-	output = &vfe->line[vfe->wm_output_map[wm]].output;
+	line = &vfe->line[vfe->wm_output_map[wm]];
+	output = &line->output;
 
 	if (output->gen1.active_buf == active_index && 0) {
 		dev_err_ratelimited(vfe->camss->dev,
@@ -667,7 +669,7 @@ static void vfe_isr_wm_done(struct vfe_device *vfe, u8 wm)
 	if (output->state == VFE_OUTPUT_STOPPING)
 		output->last_buffer = ready_buf;
 	else
-		vb2_buffer_done(&ready_buf->vb.vb2_buf, VB2_BUF_STATE_DONE);
+		msm_video_buffer_done(&line->video_out, ready_buf);
 
 	return;
 
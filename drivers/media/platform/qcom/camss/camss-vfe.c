@@ -9,6 +9,7 @@
  */
 #include <linux/clk.h>
 #include <linux/completion.h>
+#include <linux/dma-mapping.h>
 #include <linux/interrupt.h>
 #include <linux/iommu.h>
 #include <linux/mutex.h>
@@ -459,6 +460,24 @@ int vfe_reserve_wm(struct vfe_device *vfe, enum vfe_line_id line_id)
 	return ret;
 }
 
+static bool vfe_scratch;
+module_param(vfe_scratch, bool, 0644);
+MODULE_PARM_DESC(vfe_scratch,
+		 "Keep write masters busy with a scratch buffer when userspace is late requeueing");
+
+static unsigned int sync_lines;
+module_param(sync_lines, uint, 0644);
+MODULE_PARM_DESC(sync_lines,
+		 "Mask of VFE lines, bit (vfe * 4 + line), to start and sequence together");
+
+static unsigned int progress_lines;
+module_param(progress_lines, uint, 0644);
+MODULE_PARM_DESC(progress_lines,
+		 "Report capture progress to userspace every this many lines (0 = off)");
+
+/* How far apart the first frames of a sync group may start */
+#define VFE_SYNC_WINDOW_NS	(4 * NSEC_PER_MSEC)
+
 int vfe_release_wm(struct vfe_device *vfe, u8 wm)
 {
 	if (wm >= ARRAY_SIZE(vfe->wm_output_map))
@@ -483,6 +502,74 @@ struct camss_buffer *vfe_buf_get_pending(struct vfe_output *output)
 	return buffer;
 }
 
+struct camss_buffer *vfe_buf_get_next(struct vfe_output *output)
+{
+	struct camss_buffer *buffer = vfe_buf_get_pending(output);
+
+	if (!buffer && output->scratch_cookie)
+		buffer = &output->scratch;
+
+	return buffer;
+}
+
+/*
+ * vfe_scratch_alloc - Allocate the scratch buffer of a VFE output
+ * @line: VFE line
+ *
+ * With the scratch buffer the hardware always has two addresses programmed,
+ * and a frame arriving while userspace has no buffer queued is captured into
+ * it and counted as late, instead of stalling the write master.  The contents
+ * are never looked at, so a single buffer serves both ping-pong slots.
+ *
+ * Return 0 on success or a negative error code otherwise
+ */
+int vfe_scratch_alloc(struct vfe_line *line)
+{
+	struct vfe_device *vfe = to_vfe(line);
+	struct vfe_output *output = &line->output;
+	struct v4l2_pix_format_mplane *pix = &line->video_out.active_fmt.fmt.pix_mp;
+	dma_addr_t addr;
+
+	output->late = 0;
+
+	if (!READ_ONCE(vfe_scratch))
+		return 0;
+
+	output->scratch_size = PAGE_ALIGN(pix->plane_fmt[0].sizeimage);
+	output->scratch_cookie = dma_alloc_attrs(vfe->camss->dev,
+						 output->scratch_size, &addr,
+						 GFP_KERNEL,
+						 DMA_ATTR_NO_KERNEL_MAPPING);
+	if (!output->scratch_cookie)
+		return -ENOMEM;
+
+	output->scratch.addr[0] = addr;
+
+	return 0;
+}
+
+/*
+ * vfe_scratch_free - Free the scratch buffer of a stopped VFE output
+ * @line: VFE line
+ */
+void vfe_scratch_free(struct vfe_line *line)
+{
+	struct vfe_device *vfe = to_vfe(line);
+	struct vfe_output *output = &line->output;
+
+	if (output->late)
+		dev_dbg(vfe->camss->dev, "VFE%u line %u: %u late frames\n",
+			vfe->id, line->id, output->late);
+
+	if (!output->scratch_cookie)
+		return;
+
+	dma_free_attrs(vfe->camss->dev, output->scratch_size,
+		       output->scratch_cookie, output->scratch.addr[0],
+		       DMA_ATTR_NO_KERNEL_MAPPING);
+	output->scratch_cookie = NULL;
+}
+
 void vfe_buf_add_pending(struct vfe_output *output,
 			 struct camss_buffer *buffer)
 {
@@ -541,6 +628,234 @@ static int vfe_disable_output(struct vfe_line *line)
 	return vfe_reset(vfe);
 }
 
+static u32 vfe_sync_bit(struct vfe_line *line)
+{
+	unsigned int n = to_vfe(line)->id * VFE_LINE_NUM_MAX + line->id;
+
+	return n < 32 ? BIT(n) : 0;
+}
+
+/*
+ * vfe_sync_arm - Prepare to start a VFE line, which may be in a sync group
+ * @line: VFE line, with its output lock held
+ * @kick: Returns the other lines to start with vfe_sync_kick()
+ *
+ * The lines of a sync group only start capturing once all of them are
+ * streaming, so that the first reg update, which starts a line, is issued to
+ * them all at once.  A line which is not in a group, or joins a group which is
+ * already running, starts right away.
+ *
+ * Return true if the caller should issue the reg update for @line itself
+ */
+bool vfe_sync_arm(struct vfe_line *line, u32 *kick)
+{
+	struct vfe_sync_group *group = &to_vfe(line)->camss->sync;
+	struct vfe_output *output = &line->output;
+	u32 bit = vfe_sync_bit(line);
+	bool start = true;
+
+	*kick = 0;
+	output->sof_ts = 0;
+	output->frame_ns = 0;
+	output->readout_ns = 0;
+	output->sync = bit & READ_ONCE(sync_lines);
+	if (!output->sync)
+		return true;
+
+	spin_lock(&group->lock);
+
+	if (!group->armed && !group->running) {
+		group->mask = READ_ONCE(sync_lines);
+		group->sof_ts = 0;
+	}
+
+	if (group->running) {
+		group->running |= bit;
+	} else if (((group->armed | bit) & group->mask) == group->mask) {
+		*kick = group->armed;
+		group->running = group->armed | bit;
+		group->armed = 0;
+	} else {
+		group->armed |= bit;
+		start = false;
+	}
+
+	spin_unlock(&group->lock);
+
+	return start;
+}
+
+/*
+ * vfe_sync_kick - Start the lines of a sync group waiting for the last one
+ * @line: The last VFE line of the group, with its output lock released
+ * @kick: Lines returned by vfe_sync_arm()
+ */
+void vfe_sync_kick(struct vfe_line *line, u32 kick)
+{
+	struct camss *camss = to_vfe(line)->camss;
+	unsigned long mask = kick;
+	unsigned long flags;
+	unsigned int n;
+
+	for_each_set_bit(n, &mask, 32) {
+		struct vfe_device *vfe = &camss->vfe[n / VFE_LINE_NUM_MAX];
+		enum vfe_line_id id = n % VFE_LINE_NUM_MAX;
+
+		spin_lock_irqsave(&vfe->output_lock, flags);
+		if (vfe->line[id].output.state == VFE_OUTPUT_ON)
+			vfe->res->hw_ops->reg_update(vfe, id);
+		spin_unlock_irqrestore(&vfe->output_lock, flags);
+	}
+}
+
+static void vfe_sync_disarm(struct vfe_line *line)
+{
+	struct vfe_sync_group *group = &to_vfe(line)->camss->sync;
+	struct vfe_output *output = &line->output;
+	u32 bit = vfe_sync_bit(line);
+	unsigned long flags;
+
+	if (!output->sync)
+		return;
+
+	spin_lock_irqsave(&group->lock, flags);
+	group->armed &= ~bit;
+	group->running &= ~bit;
+	spin_unlock_irqrestore(&group->lock, flags);
+
+	output->sync = false;
+}
+
+/*
+ * vfe_sync_sof - Latch the start of frame time of a VFE line
+ * @line: VFE line
+ * @ts: Start of frame time, in the CLOCK_MONOTONIC domain shared by all lines
+ *
+ * For a line in a sync group, a start of frame within half a frame of that of
+ * another member belongs to the same group frame, and gets its number.
+ */
+void vfe_sync_sof(struct vfe_line *line, u64 ts)
+{
+	struct vfe_sync_group *group = &to_vfe(line)->camss->sync;
+	struct vfe_output *output = &line->output;
+	u64 window;
+
+	if (output->sof_ts)
+		output->frame_ns = ts - output->sof_ts;
+	output->sof_ts = ts;
+
+	if (!output->sync)
+		return;
+
+	window = output->frame_ns ? output->frame_ns / 2 : VFE_SYNC_WINDOW_NS;
+
+	spin_lock(&group->lock);
+	if (!group->sof_ts) {
+		group->sequence = 0;
+		group->sof_ts = ts;
+	} else if (abs_diff(ts, group->sof_ts) > window) {
+		group->sequence++;
+		group->sof_ts = ts;
+	}
+	output->group_seq = group->sequence;
+	spin_unlock(&group->lock);
+}
+
+/*
+ * The write master has no interrupt for a line count, so progress is derived
+ * from the time the previous frame took from start of frame to write master
+ * done, which covers the whole readout.  A sixteenth of that is added as a
+ * margin for jitter, so that the lines reported are in memory.
+ */
+static ktime_t vfe_progress_time(struct vfe_output *output, u32 lines, u32 height)
+{
+	u64 ns = div_u64(output->readout_ns * lines, height);
+
+	return ns_to_ktime(output->sof_ts + ns + output->readout_ns / 16);
+}
+
+static enum hrtimer_restart vfe_progress_timer(struct hrtimer *timer)
+{
+	struct vfe_output *output = container_of(timer, struct vfe_output,
+						 progress_timer);
+	struct vfe_line *line = container_of(output, struct vfe_line, output);
+	struct vfe_device *vfe = to_vfe(line);
+	u32 height = line->video_out.active_fmt.fmt.pix_mp.height;
+	enum hrtimer_restart restart = HRTIMER_NORESTART;
+	u32 step = READ_ONCE(progress_lines);
+	unsigned long flags;
+
+	spin_lock_irqsave(&vfe->output_lock, flags);
+
+	if (!output->progress_buf)
+		goto out_unlock;
+
+	msm_video_frame_progress(&line->video_out, output->progress_buf,
+				 output->sync ? output->group_seq : output->sequence,
+				 output->progress_lines);
+
+	output->progress_lines += step;
+	if (step && output->progress_lines < height) {
+		hrtimer_set_expires(timer, vfe_progress_time(output,
+							     output->progress_lines,
+							     height));
+		restart = HRTIMER_RESTART;
+	} else {
+		output->progress_buf = NULL;
+	}
+
+out_unlock:
+	spin_unlock_irqrestore(&vfe->output_lock, flags);
+
+	return restart;
+}
+
+/*
+ * vfe_progress_sof - Start reporting the progress of a frame
+ * @line: VFE line, after vfe_sync_sof() latched the start of frame
+ */
+void vfe_progress_sof(struct vfe_line *line)
+{
+	struct vfe_device *vfe = to_vfe(line);
+	struct vfe_output *output = &line->output;
+	u32 height = line->video_out.active_fmt.fmt.pix_mp.height;
+	u32 step = READ_ONCE(progress_lines);
+	struct camss_buffer *buf;
+	unsigned long flags;
+
+	if (!step || step >= height)
+		return;
+
+	spin_lock_irqsave(&vfe->output_lock, flags);
+
+	buf = output->buf[0];
+	if (output->readout_ns && buf && !vfe_buf_is_scratch(output, buf)) {
+		output->progress_buf = buf;
+		output->progress_lines = step;
+		hrtimer_start(&output->progress_timer,
+			      vfe_progress_time(output, step, height),
+			      HRTIMER_MODE_ABS);
+	}
+
+	spin_unlock_irqrestore(&vfe->output_lock, flags);
+}
+
+/*
+ * vfe_progress_done - Stop reporting the progress of the finished frame
+ * @line: VFE line, with its output lock held
+ * @ts: Time of the write master done interrupt
+ */
+void vfe_progress_done(struct vfe_line *line, u64 ts)
+{
+	struct vfe_output *output = &line->output;
+
+	if (output->sof_ts && ts > output->sof_ts)
+		output->readout_ns = ts - output->sof_ts;
+
+	output->progress_buf = NULL;
+	hrtimer_try_to_cancel(&output->progress_timer);
+}
+
 /*
  * vfe_disable - Disable streaming on VFE line
  * @line: VFE line
@@ -557,6 +872,9 @@ int vfe_disable(struct vfe_line *line)
 		goto error;
 
 	vfe_put_output(line);
+	hrtimer_cancel(&line->output.progress_timer);
+	vfe_scratch_free(line);
+	vfe_sync_disarm(line);
 
 	mutex_lock(&vfe->stream_lock);
 
@@ -890,10 +1208,10 @@ int vfe_flush_buffers(struct camss_video *vid,
 
 	vfe_buf_flush_pending(output, state);
 
-	if (output->buf[0])
+	if (output->buf[0] && !vfe_buf_is_scratch(output, output->buf[0]))
 		vb2_buffer_done(&output->buf[0]->vb.vb2_buf, state);
 
-	if (output->buf[1])
+	if (output->buf[1] && !vfe_buf_is_scratch(output, output->buf[1]))
 		vb2_buffer_done(&output->buf[1]->vb.vb2_buf, state);
 
 	if (output->last_buffer) {
@@ -1609,6 +1927,9 @@ int msm_vfe_subdev_init(struct camss *camss, struct vfe_device *vfe,
 		l->id = i;
 		init_completion(&l->output.sof);
 		init_completion(&l->output.reg_update);
+		hrtimer_init(&l->output.progress_timer, CLOCK_MONOTONIC,
+			     HRTIMER_MODE_ABS);
+		l->output.progress_timer.function = vfe_progress_timer;
 
 		if (i == VFE_LINE_PIX) {
 			l->nformats = res->vfe.formats_pix->nformats;
@@ -11,6 +11,7 @@
 #define QC_MSM_CAMSS_VFE_H
 
 #include <linux/clk.h>
+#include <linux/hrtimer.h>
 #include <linux/spinlock_types.h>
 #include <media/media-entity.h>
 #include <media/v4l2-device.h>
@@ -64,6 +65,27 @@ struct vfe_output {
 	struct camss_buffer *last_buffer;
 	struct list_head pending_bufs;
 
+	/*
+	 * Frames are written here when no buffer was queued in time. It stands
+	 * in for a real buffer in buf[], but is never returned to vb2.
+	 */
+	struct camss_buffer scratch;
+	void *scratch_cookie;
+	size_t scratch_size;
+	unsigned int late;
+
+	/* Start of frame tracking, for sync groups */
+	bool sync;
+	u64 sof_ts;
+	u64 frame_ns;
+	u32 group_seq;
+
+	/* Partial frame progress reporting */
+	struct hrtimer progress_timer;
+	struct camss_buffer *progress_buf;
+	u64 readout_ns;
+	u32 progress_lines;
+
 	unsigned int drop_update_idx;
 
 	union {
@@ -83,6 +105,26 @@ struct vfe_output {
 	struct completion reg_update;
 };
 
+/*
+ * struct vfe_sync_group - VFE lines started and sequenced together
+ * @lock: Protects the fields below
+ * @mask: Member lines, latched from the sync_lines parameter
+ * @armed: Members waiting for the rest of the group to be started
+ * @running: Members capturing
+ * @sof_ts: Start of frame time of the current group frame
+ * @sequence: Number of the current group frame
+ *
+ * Lines are identified by bit (vfe id * VFE_LINE_NUM_MAX + line id).
+ */
+struct vfe_sync_group {
+	spinlock_t lock;
+	u32 mask;
+	u32 armed;
+	u32 running;
+	u64 sof_ts;
+	u32 sequence;
+};
+
 struct vfe_line {
 	enum vfe_line_id id;
 	struct v4l2_subdev subdev;
@@ -184,6 +226,31 @@ void vfe_buf_add_pending(struct vfe_output *output, struct camss_buffer *buffer)
 
 struct camss_buffer *vfe_buf_get_pending(struct vfe_output *output);
 
+/*
+ * vfe_buf_get_next - Get the next buffer for the hardware to fill
+ * @output: VFE output
+ *
+ * Returns the first pending buffer, or the scratch buffer if there is none
+ * and one was allocated, or NULL.
+ */
+struct camss_buffer *vfe_buf_get_next(struct vfe_output *output);
+
+static inline bool vfe_buf_is_scratch(struct vfe_output *output,
+				      struct camss_buffer *buf)
+{
+	return buf == &output->scratch;
+}
+
+int vfe_scratch_alloc(struct vfe_line *line);
+void vfe_scratch_free(struct vfe_line *line);
+
+bool vfe_sync_arm(struct vfe_line *line, u32 *kick);
+void vfe_sync_kick(struct vfe_line *line, u32 kick);
+void vfe_sync_sof(struct vfe_line *line, u64 ts);
+
+void vfe_progress_sof(struct vfe_line *line);
+void vfe_progress_done(struct vfe_line *line, u64 ts);
+
 int vfe_flush_buffers(struct camss_video *vid, enum vb2_buffer_state state);
 
 /*
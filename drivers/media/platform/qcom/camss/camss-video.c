@@ -11,19 +11,29 @@
 #include <media/media-entity.h>
 #include <media/v4l2-dev.h>
 #include <media/v4l2-device.h>
+#include <media/v4l2-event.h>
 #include <media/v4l2-ioctl.h>
 #include <media/v4l2-mc.h>
 #include <media/videobuf2-dma-sg.h>
+#include <uapi/linux/qcom-camss.h>
 
 #include "camss-video.h"
 #include "camss.h"
 
+#define CREATE_TRACE_POINTS
+#include "camss-trace.h"
+
 #define CAMSS_FRAME_MIN_WIDTH		1
 #define CAMSS_FRAME_MAX_WIDTH		8191
 #define CAMSS_FRAME_MIN_HEIGHT		1
 #define CAMSS_FRAME_MAX_HEIGHT_RDI	8191
 #define CAMSS_FRAME_MAX_HEIGHT_PIX	4096
 
+static unsigned int frame_batch = 1;
+module_param(frame_batch, uint, 0644);
+MODULE_PARM_DESC(frame_batch,
+		 "Number of captured frames to hand to userspace at once (1 = no batching)");
+
 /* -----------------------------------------------------------------------------
  * Helper functions
  */
@@ -203,6 +213,93 @@ static void video_buf_queue(struct vb2_buffer *vb)
 	video->ops->queue_buffer(video, buffer);
 }
 
+static void video_complete_batch(struct list_head *done)
+{
+	struct camss_buffer *buf, *tmp;
+
+	list_for_each_entry_safe(buf, tmp, done, queue) {
+		list_del(&buf->queue);
+		vb2_buffer_done(&buf->vb.vb2_buf, VB2_BUF_STATE_DONE);
+	}
+}
+
+/*
+ * msm_video_buffer_done - Return a filled buffer to userspace
+ * @video: Video device the buffer was captured for
+ * @buf: The buffer, with its timestamp and sequence already set
+ *
+ * With frame batching enabled the buffer is held until video->batch_size
+ * buffers have been filled, and these are then all completed in one go, so
+ * that a waiting process is only woken up once for the whole bundle.
+ *
+ * May be called from interrupt context.
+ */
+void msm_video_buffer_done(struct camss_video *video, struct camss_buffer *buf)
+{
+	unsigned long flags;
+	LIST_HEAD(done);
+
+	trace_camss_vfe_buf_done(video->vdev.name, &buf->vb);
+
+	if (video->batch_size <= 1) {
+		vb2_buffer_done(&buf->vb.vb2_buf, VB2_BUF_STATE_DONE);
+		return;
+	}
+
+	spin_lock_irqsave(&video->batch_lock, flags);
+	list_add_tail(&buf->queue, &video->batch);
+	if (++video->batch_count >= video->batch_size) {
+		list_splice_init(&video->batch, &done);
+		video->batch_count = 0;
+	}
+	spin_unlock_irqrestore(&video->batch_lock, flags);
+
+	video_complete_batch(&done);
+}
+
+/*
+ * video_flush_batch - Complete the buffers of a partially filled bundle
+ * @video: Video device
+ */
+static void video_flush_batch(struct camss_video *video)
+{
+	unsigned long flags;
+	LIST_HEAD(done);
+
+	spin_lock_irqsave(&video->batch_lock, flags);
+	list_splice_init(&video->batch, &done);
+	video->batch_count = 0;
+	spin_unlock_irqrestore(&video->batch_lock, flags);
+
+	video_complete_batch(&done);
+}
+
+/*
+ * msm_video_frame_progress - Tell userspace how much of a frame was written
+ * @video: Video device the buffer is being captured for
+ * @buf: The buffer being written
+ * @sequence: Sequence number the buffer will be completed with
+ * @lines: Lines written so far
+ *
+ * May be called from interrupt context.
+ */
+void msm_video_frame_progress(struct camss_video *video, struct camss_buffer *buf,
+			      u32 sequence, u32 lines)
+{
+	struct camss_event_frame_progress *progress;
+	struct v4l2_event event = {
+		.type = V4L2_EVENT_CAMSS_FRAME_PROGRESS,
+	};
+
+	progress = (struct camss_event_frame_progress *)event.u.data;
+	progress->index = buf->vb.vb2_buf.index;
+	progress->sequence = sequence;
+	progress->lines = lines;
+	progress->height = video->active_fmt.fmt.pix_mp.height;
+
+	v4l2_event_queue(&video->vdev, &event);
+}
+
 static int video_check_format(struct camss_video *video)
 {
 	struct v4l2_pix_format_mplane *pix = &video->active_fmt.fmt.pix_mp;
@@ -244,6 +341,13 @@ static int video_start_streaming(struct vb2_queue *q, unsigned int count)
 	if (ret < 0)
 		goto error;
 
+	/*
+	 * Never hold back more than half of the buffers, so that the hardware
+	 * can keep filling the rest while a bundle is being collected.
+	 */
+	video->batch_size = clamp(READ_ONCE(frame_batch), 1U,
+				  max(q->num_buffers / 2, 1U));
+
 	entity = &vdev->entity;
 	while (1) {
 		pad = &entity->pads[0];
@@ -305,6 +409,9 @@ static void video_stop_streaming(struct vb2_queue *q)
 
 	video_device_pipeline_stop(vdev);
 
+	/* The hardware is stopped, so hand out what was captured so far */
+	video_flush_batch(video);
+
 	video->ops->flush_buffers(video, VB2_BUF_STATE_ERROR);
 }
 
@@ -556,6 +663,17 @@ static int video_s_input(struct file *file, void *fh, unsigned int input)
 	return input == 0 ? 0 : -EINVAL;
 }
 
+static int video_subscribe_event(struct v4l2_fh *fh,
+				 const struct v4l2_event_subscription *sub)
+{
+	switch (sub->type) {
+	case V4L2_EVENT_CAMSS_FRAME_PROGRESS:
+		return v4l2_event_subscribe(fh, sub, 4, NULL);
+	default:
+		return -EINVAL;
+	}
+}
+
 static const struct v4l2_ioctl_ops msm_vid_ioctl_ops = {
 	.vidioc_querycap		= video_querycap,
 	.vidioc_enum_fmt_vid_cap	= video_enum_fmt,
@@ -575,6 +693,8 @@ static const struct v4l2_ioctl_ops msm_vid_ioctl_ops = {
 	.vidioc_enum_input		= video_enum_input,
 	.vidioc_g_input			= video_g_input,
 	.vidioc_s_input			= video_s_input,
+	.vidioc_subscribe_event		= video_subscribe_event,
+	.vidioc_unsubscribe_event	= v4l2_event_unsubscribe,
 };
 
 /* -----------------------------------------------------------------------------
@@ -713,6 +833,9 @@ int msm_video_register(struct camss_video *video, struct v4l2_device *v4l2_dev,
 	vdev = &video->vdev;
 
 	mutex_init(&video->q_lock);
+	spin_lock_init(&video->batch_lock);
+	INIT_LIST_HEAD(&video->batch);
+	video->batch_size = 1;
 
 	q = &video->vb2_q;
 	q->drv_priv = video;
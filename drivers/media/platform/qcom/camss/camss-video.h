@@ -11,6 +11,7 @@
 #define QC_MSM_CAMSS_VIDEO_H
 
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
 #include <linux/videodev2.h>
 #include <media/media-entity.h>
 #include <media/v4l2-dev.h>
@@ -48,8 +49,18 @@ struct camss_video {
 	unsigned int line_based;
 	const struct camss_format_info *formats;
 	unsigned int nformats;
+
+	/* Completed buffers held back until a bundle of batch_size is full */
+	spinlock_t batch_lock;
+	struct list_head batch;
+	unsigned int batch_count;
+	unsigned int batch_size;
 };
 
+void msm_video_buffer_done(struct camss_video *video, struct camss_buffer *buf);
+void msm_video_frame_progress(struct camss_video *video, struct camss_buffer *buf,
+			      u32 sequence, u32 lines);
+
 int msm_video_register(struct camss_video *video, struct v4l2_device *v4l2_dev,
 		       const char *name);
 
@@ -2594,6 +2594,7 @@ static int camss_probe(struct platform_device *pdev)
 	camss->res = of_device_get_match_data(dev);
 
 	atomic_set(&camss->ref_count, 0);
+	spin_lock_init(&camss->sync.lock);
 	camss->dev = dev;
 	platform_set_drvdata(pdev, camss);
 
@@ -111,6 +111,7 @@ struct camss {
 	struct csid_device *csid;
 	struct ispif_device *ispif;
 	struct vfe_device *vfe;
+	struct vfe_sync_group sync;
 	atomic_t ref_count;
 	int genpd_num;
 	struct device *genpd;
@@ -23,6 +23,7 @@
 
 #include "core.h"
 #include "firmware.h"
+#include "helpers.h"
 #include "pm_helpers.h"
 #include "hfi_venus_io.h"
 
@@ -345,6 +346,7 @@ static int venus_probe(struct platform_device *pdev)
 		goto err_core_put;
 
 	venus_assign_register_offsets(core);
+	venus_helper_intbuf_pool_init(core);
 
 	ret = v4l2_device_register(dev, &core->v4l2_dev);
 	if (ret)
@@ -411,6 +413,7 @@ static int venus_probe(struct platform_device *pdev)
 	hfi_destroy(core);
 err_core_deinit:
 	hfi_core_deinit(core, false);
+	venus_helper_intbuf_pool_destroy(core);
 err_core_put:
 	if (core->pm_ops->core_put)
 		core->pm_ops->core_put(core);
@@ -444,6 +447,7 @@ static void venus_remove(struct platform_device *pdev)
 	v4l2_device_unregister(&core->v4l2_dev);
 
 	hfi_destroy(core);
+	venus_helper_intbuf_pool_destroy(core);
 
 	mutex_destroy(&core->pm_lock);
 	mutex_destroy(&core->lock);
@@ -9,6 +9,7 @@
 
 #include <linux/bitops.h>
 #include <linux/list.h>
+#include <linux/shrinker.h>
 #include <media/videobuf2-v4l2.h>
 #include <media/v4l2-ctrls.h>
 #include <media/v4l2-device.h>
@@ -116,6 +117,22 @@ struct venus_format {
 	u32 flags;
 };
 
+/**
+ * struct venus_intbuf_pool - internal buffers kept for reuse by sessions
+ * @lock:	protects @bufs and @size
+ * @bufs:	free buffers, most recently released first
+ * @size:	total size of @bufs in bytes
+ * @shrinker:	gives the pool back under memory pressure
+ * @registered:	@shrinker has been registered
+ */
+struct venus_intbuf_pool {
+	struct mutex lock;
+	struct list_head bufs;
+	size_t size;
+	struct shrinker shrinker;
+	bool registered;
+};
+
 /**
  * struct venus_core - holds core parameters valid for all instances
  *
@@ -170,6 +187,7 @@ struct venus_format {
  * @core1_usage_count: usage counter for core1
  * @root:	debugfs root directory
  * @venus_ver:	the venus firmware version
+ * @intbuf_pool: internal buffers released by sessions, for reuse
  */
 struct venus_core {
 	void __iomem *base;
@@ -233,6 +251,7 @@ struct venus_core {
 		u32 minor;
 		u32 rev;
 	} venus_ver;
+	struct venus_intbuf_pool intbuf_pool;
 };
 
 struct vdec_controls {
@@ -242,6 +261,8 @@ struct vdec_controls {
 	u32 display_delay;
 	u32 display_delay_enable;
 	u64 conceal_color;
+	u32 low_latency;
+	struct v4l2_ctrl *latency;
 };
 
 struct venc_controls {
@@ -317,6 +338,8 @@ struct venc_controls {
 	struct v4l2_ctrl_hdr10_mastering_display mastering;
 };
 
+struct venus_qp_map;
+
 struct venus_buffer {
 	struct vb2_v4l2_buffer vb;
 	struct list_head list;
@@ -325,14 +348,34 @@ struct venus_buffer {
 	struct list_head reg_list;
 	u32 flags;
 	struct list_head ref_list;
+	struct venus_qp_map *qp_map;
 };
 
+/* Room for the extradata records of one encoder input buffer */
+#define VENUS_EXTRADATA_SLOT	128
+
+/**
+ * struct clock_data - clock vote of an instance
+ * @core_id:		hardware core(s) the instance runs on
+ * @freq:		last clock rate computed for the instance
+ * @vpp_freq:		cycles per macroblock of the pixel processor
+ * @vsp_freq:		cycles per macroblock of the stream processor
+ * @low_power_freq:	cycles per macroblock in low-power mode
+ * @window_start:	start of the frame rate measurement window, in ns
+ * @window_frames:	frames queued since @window_start
+ * @last_frame_ns:	time the last frame was queued
+ * @measured_fps:	frame rate measured over the recent windows, 0 if none
+ */
 struct clock_data {
 	u32 core_id;
 	unsigned long freq;
 	unsigned long vpp_freq;
 	unsigned long vsp_freq;
 	unsigned long low_power_freq;
+	u64 window_start;
+	u32 window_frames;
+	u64 last_frame_ns;
+	u32 measured_fps;
 };
 
 #define to_venus_buffer(ptr)	container_of(ptr, struct venus_buffer, vb)
@@ -360,12 +403,14 @@ struct venus_ts_metadata {
 	bool used;
 	u64 ts_ns;
 	u64 ts_us;
+	u64 queued_ns;
 	u32 flags;
 	struct v4l2_timecode tc;
 };
 
 enum venus_inst_modes {
 	VENUS_LOW_POWER = BIT(0),
+	VENUS_LOW_LATENCY = BIT(1),
 };
 
 /**
@@ -438,6 +483,10 @@ enum venus_inst_modes {
  * @drain_active:	Drain sequence is in progress
  * @flags:	bitmask flags describing current instance mode
  * @dpb_ids:	DPB buffer ID's
+ * @qp_map:	encoder QP map applied to input buffers queued from now on
+ * @extradata:	extradata records of the encoder input buffers, one
+ *		VENUS_EXTRADATA_SLOT per buffer index
+ * @extradata_da: device address of @extradata
  */
 struct venus_inst {
 	struct list_head list;
@@ -509,6 +558,9 @@ struct venus_inst {
 	bool drain_active;
 	enum venus_inst_modes flags;
 	struct ida dpb_ids;
+	struct venus_qp_map *qp_map;
+	void *extradata;
+	dma_addr_t extradata_da;
 };
 
 #define IS_V1(core)	((core)->res->hfi_version == HFI_VERSION_1XX)
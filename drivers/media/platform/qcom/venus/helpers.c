@@ -3,9 +3,13 @@
  * Copyright (c) 2012-2016, The Linux Foundation. All rights reserved.
  * Copyright (C) 2017 Linaro Ltd.
  */
+#include <linux/dma-buf.h>
 #include <linux/idr.h>
 #include <linux/list.h>
+#include <linux/module.h>
 #include <linux/mutex.h>
+#include <linux/shrinker.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/kernel.h>
 #include <media/videobuf2-dma-contig.h>
@@ -38,6 +42,153 @@ struct intbuf {
 	u32 dpb_out_tag;
 };
 
+static unsigned int intbuf_pool_kb = 32 * 1024;
+module_param(intbuf_pool_kb, uint, 0644);
+MODULE_PARM_DESC(intbuf_pool_kb, "Memory kept for reuse as internal buffers of later sessions, in KiB");
+
+#define INTBUF_ATTRS	(DMA_ATTR_WRITE_COMBINE | DMA_ATTR_NO_KERNEL_MAPPING)
+
+/*
+ * Internal and DPB buffers are only ever accessed by the firmware, so
+ * instead of freeing them when a session ends they are kept in a pool on
+ * the core, and handed to the next session asking for a buffer of the same
+ * type and size.  This saves short sessions the allocation and IOMMU map of
+ * every buffer at start.  The pool is capped at intbuf_pool_kb, and memory
+ * pressure empties it, oldest buffers first.
+ */
+static struct intbuf *intbuf_get(struct venus_inst *inst, u32 type, size_t size)
+{
+	struct venus_intbuf_pool *pool = &inst->core->intbuf_pool;
+	struct device *dev = inst->core->dev;
+	struct intbuf *buf;
+
+	mutex_lock(&pool->lock);
+	list_for_each_entry(buf, &pool->bufs, list) {
+		if (buf->type == type && buf->size == size) {
+			list_del_init(&buf->list);
+			pool->size -= buf->size;
+			mutex_unlock(&pool->lock);
+			buf->owned_by = DRIVER;
+			buf->dpb_out_tag = 0;
+			return buf;
+		}
+	}
+	mutex_unlock(&pool->lock);
+
+	buf = kzalloc(sizeof(*buf), GFP_KERNEL);
+	if (!buf)
+		return NULL;
+
+	buf->type = type;
+	buf->size = size;
+	buf->attrs = INTBUF_ATTRS;
+	buf->va = dma_alloc_attrs(dev, buf->size, &buf->da, GFP_KERNEL,
+				  buf->attrs);
+	if (!buf->va) {
+		kfree(buf);
+		return NULL;
+	}
+
+	INIT_LIST_HEAD(&buf->list);
+
+	return buf;
+}
+
+static void intbuf_release(struct device *dev, struct intbuf *buf)
+{
+	dma_free_attrs(dev, buf->size, buf->va, buf->da, buf->attrs);
+	kfree(buf);
+}
+
+static void intbuf_put(struct venus_inst *inst, struct intbuf *buf)
+{
+	struct venus_intbuf_pool *pool = &inst->core->intbuf_pool;
+	size_t max = (size_t)READ_ONCE(intbuf_pool_kb) * SZ_1K;
+
+	mutex_lock(&pool->lock);
+	if (pool->size + buf->size <= max) {
+		list_add(&buf->list, &pool->bufs);
+		pool->size += buf->size;
+		buf = NULL;
+	}
+	mutex_unlock(&pool->lock);
+
+	if (buf)
+		intbuf_release(inst->core->dev, buf);
+}
+
+static unsigned long intbuf_pool_count(struct shrinker *shrinker,
+				       struct shrink_control *sc)
+{
+	struct venus_intbuf_pool *pool =
+		container_of(shrinker, struct venus_intbuf_pool, shrinker);
+
+	return READ_ONCE(pool->size) >> PAGE_SHIFT ?: SHRINK_EMPTY;
+}
+
+static unsigned long intbuf_pool_scan(struct shrinker *shrinker,
+				      struct shrink_control *sc)
+{
+	struct venus_intbuf_pool *pool =
+		container_of(shrinker, struct venus_intbuf_pool, shrinker);
+	struct venus_core *core =
+		container_of(pool, struct venus_core, intbuf_pool);
+	unsigned long freed = 0;
+	struct intbuf *buf, *n;
+	LIST_HEAD(victims);
+
+	if (!mutex_trylock(&pool->lock))
+		return SHRINK_STOP;
+
+	list_for_each_entry_safe_reverse(buf, n, &pool->bufs, list) {
+		if (freed >= sc->nr_to_scan)
+			break;
+
+		list_move(&buf->list, &victims);
+		pool->size -= buf->size;
+		freed += buf->size >> PAGE_SHIFT;
+	}
+	mutex_unlock(&pool->lock);
+
+	list_for_each_entry_safe(buf, n, &victims, list)
+		intbuf_release(core->dev, buf);
+
+	return freed;
+}
+
+void venus_helper_intbuf_pool_init(struct venus_core *core)
+{
+	struct venus_intbuf_pool *pool = &core->intbuf_pool;
+
+	mutex_init(&pool->lock);
+	INIT_LIST_HEAD(&pool->bufs);
+
+	pool->shrinker.count_objects = intbuf_pool_count;
+	pool->shrinker.scan_objects = intbuf_pool_scan;
+	pool->shrinker.seeks = DEFAULT_SEEKS;
+	if (register_shrinker(&pool->shrinker, "venus-intbuf-%s",
+			      dev_name(core->dev)))
+		dev_warn(core->dev, "cannot register the buffer pool shrinker\n");
+	else
+		pool->registered = true;
+}
+
+void venus_helper_intbuf_pool_destroy(struct venus_core *core)
+{
+	struct venus_intbuf_pool *pool = &core->intbuf_pool;
+	struct intbuf *buf, *n;
+
+	if (pool->registered)
+		unregister_shrinker(&pool->shrinker);
+
+	list_for_each_entry_safe(buf, n, &pool->bufs, list)
+		intbuf_release(core->dev, buf);
+	INIT_LIST_HEAD(&pool->bufs);
+	pool->size = 0;
+
+	mutex_destroy(&pool->lock);
+}
+
 bool venus_helper_check_codec(struct venus_inst *inst, u32 v4l2_pixfmt)
 {
 	struct venus_core *core = inst->core;
@@ -95,9 +246,7 @@ static void free_dpb_buf(struct venus_inst *inst, struct intbuf *buf)
 	ida_free(&inst->dpb_ids, buf->dpb_out_tag);
 
 	list_del_init(&buf->list);
-	dma_free_attrs(inst->core->dev, buf->size, buf->va, buf->da,
-		       buf->attrs);
-	kfree(buf);
+	intbuf_put(inst, buf);
 }
 
 int venus_helper_queue_dpb_bufs(struct venus_inst *inst)
@@ -162,7 +311,6 @@ EXPORT_SYMBOL_GPL(venus_helper_free_dpb_bufs);
 int venus_helper_alloc_dpb_bufs(struct venus_inst *inst)
 {
 	struct venus_core *core = inst->core;
-	struct device *dev = core->dev;
 	enum hfi_version ver = core->res->hfi_version;
 	struct hfi_buffer_requirements bufreq;
 	u32 buftype = inst->dpb_buftype;
@@ -192,26 +340,15 @@ int venus_helper_alloc_dpb_bufs(struct venus_inst *inst)
 	count = hfi_bufreq_get_count_min(&bufreq, ver);
 
 	for (i = 0; i < count; i++) {
-		buf = kzalloc(sizeof(*buf), GFP_KERNEL);
+		buf = intbuf_get(inst, buftype, dpb_size);
 		if (!buf) {
 			ret = -ENOMEM;
 			goto fail;
 		}
 
-		buf->type = buftype;
-		buf->size = dpb_size;
-		buf->attrs = DMA_ATTR_WRITE_COMBINE |
-			     DMA_ATTR_NO_KERNEL_MAPPING;
-		buf->va = dma_alloc_attrs(dev, buf->size, &buf->da, GFP_KERNEL,
-					  buf->attrs);
-		if (!buf->va) {
-			ret = -ENOMEM;
-			goto fail;
-		}
-		buf->owned_by = DRIVER;
-
 		id = ida_alloc_min(&inst->dpb_ids, VB2_MAX_FRAME, GFP_KERNEL);
 		if (id < 0) {
+			intbuf_put(inst, buf);
 			ret = id;
 			goto fail;
 		}
@@ -224,7 +361,6 @@ int venus_helper_alloc_dpb_bufs(struct venus_inst *inst)
 	return 0;
 
 fail:
-	kfree(buf);
 	venus_helper_free_dpb_bufs(inst);
 	return ret;
 }
@@ -248,22 +384,9 @@ static int intbufs_set_buffer(struct venus_inst *inst, u32 type)
 		return 0;
 
 	for (i = 0; i < bufreq.count_actual; i++) {
-		buf = kzalloc(sizeof(*buf), GFP_KERNEL);
-		if (!buf) {
-			ret = -ENOMEM;
-			goto fail;
-		}
-
-		buf->type = bufreq.type;
-		buf->size = bufreq.size;
-		buf->attrs = DMA_ATTR_WRITE_COMBINE |
-			     DMA_ATTR_NO_KERNEL_MAPPING;
-		buf->va = dma_alloc_attrs(dev, buf->size, &buf->da, GFP_KERNEL,
-					  buf->attrs);
-		if (!buf->va) {
-			ret = -ENOMEM;
-			goto fail;
-		}
+		buf = intbuf_get(inst, bufreq.type, bufreq.size);
+		if (!buf)
+			return -ENOMEM;
 
 		memset(&bd, 0, sizeof(bd));
 		bd.buffer_size = buf->size;
@@ -274,19 +397,14 @@ static int intbufs_set_buffer(struct venus_inst *inst, u32 type)
 		ret = hfi_session_set_buffers(inst, &bd);
 		if (ret) {
 			dev_err(dev, "set session buffers failed\n");
-			goto dma_free;
+			intbuf_put(inst, buf);
+			return ret;
 		}
 
 		list_add_tail(&buf->list, &inst->internalbufs);
 	}
 
 	return 0;
-
-dma_free:
-	dma_free_attrs(dev, buf->size, buf->va, buf->da, buf->attrs);
-fail:
-	kfree(buf);
-	return ret;
 }
 
 static int intbufs_unset_buffers(struct venus_inst *inst)
@@ -305,9 +423,7 @@ static int intbufs_unset_buffers(struct venus_inst *inst)
 		ret = hfi_session_unset_buffers(inst, &bd);
 
 		list_del_init(&buf->list);
-		dma_free_attrs(inst->core->dev, buf->size, buf->va, buf->da,
-			       buf->attrs);
-		kfree(buf);
+		intbuf_put(inst, buf);
 	}
 
 	return ret;
@@ -395,11 +511,8 @@ int venus_helper_intbufs_realloc(struct venus_inst *inst)
 
 		ret = hfi_session_unset_buffers(inst, &bd);
 
-		dma_free_attrs(inst->core->dev, buf->size, buf->va, buf->da,
-			       buf->attrs);
-
 		list_del_init(&buf->list);
-		kfree(buf);
+		intbuf_put(inst, buf);
 	}
 
 	ret = intbufs_set_buffer(inst, HFI_BUFFER_INTERNAL_SCRATCH(ver));
@@ -471,10 +584,16 @@ put_ts_metadata(struct venus_inst *inst, struct vb2_v4l2_buffer *vbuf)
 	inst->tss[slot].tc = vbuf->timecode;
 	inst->tss[slot].ts_us = ts_us;
 	inst->tss[slot].ts_ns = vb->timestamp;
+	inst->tss[slot].queued_ns = ktime_get_ns();
 }
 
-void venus_helper_get_ts_metadata(struct venus_inst *inst, u64 timestamp_us,
-				  struct vb2_v4l2_buffer *vbuf)
+/*
+ * Restores the flags, timecode and timestamp the bitstream buffer with
+ * @timestamp_us was queued with.  Returns the time it was handed to the
+ * firmware, or 0 if no such buffer is pending.
+ */
+u64 venus_helper_get_ts_metadata(struct venus_inst *inst, u64 timestamp_us,
+				 struct vb2_v4l2_buffer *vbuf)
 {
 	struct vb2_buffer *vb = &vbuf->vb2_buf;
 	unsigned int i;
@@ -490,51 +609,269 @@ void venus_helper_get_ts_metadata(struct venus_inst *inst, u64 timestamp_us,
 		vbuf->flags |= inst->tss[i].flags;
 		vbuf->timecode = inst->tss[i].tc;
 		vb->timestamp = inst->tss[i].ts_ns;
-		break;
+		return inst->tss[i].queued_ns;
 	}
+
+	return 0;
 }
 EXPORT_SYMBOL_GPL(venus_helper_get_ts_metadata);
 
-static int
-session_process_buf(struct venus_inst *inst, struct vb2_v4l2_buffer *vbuf)
+/**
+ * struct venus_qp_map - dma-buf holding an encoder QP delta map
+ * @ref:	held by the instance while it is current, and by every input
+ *		buffer it was queued with
+ * @dmabuf:	the dma-buf
+ * @attach:	attachment of @dmabuf to the core
+ * @sgt:	mapping of @attach
+ * @da:		device address of the map
+ * @size:	size of the map, one byte per macroblock
+ *
+ * The firmware reads the map straight from @da, it is never copied.
+ */
+struct venus_qp_map {
+	struct kref ref;
+	struct dma_buf *dmabuf;
+	struct dma_buf_attachment *attach;
+	struct sg_table *sgt;
+	dma_addr_t da;
+	size_t size;
+};
+
+struct venus_qp_map *venus_helper_qp_map_get(struct venus_inst *inst, int fd)
+{
+	struct device *dev = inst->core->dev;
+	struct venus_qp_map *map;
+	int ret;
+
+	map = kzalloc(sizeof(*map), GFP_KERNEL);
+	if (!map)
+		return ERR_PTR(-ENOMEM);
+
+	kref_init(&map->ref);
+
+	map->dmabuf = dma_buf_get(fd);
+	if (IS_ERR(map->dmabuf)) {
+		ret = PTR_ERR(map->dmabuf);
+		goto err_free;
+	}
+
+	map->attach = dma_buf_attach(map->dmabuf, dev);
+	if (IS_ERR(map->attach)) {
+		ret = PTR_ERR(map->attach);
+		goto err_put;
+	}
+
+	map->sgt = dma_buf_map_attachment_unlocked(map->attach, DMA_TO_DEVICE);
+	if (IS_ERR(map->sgt)) {
+		ret = PTR_ERR(map->sgt);
+		goto err_detach;
+	}
+
+	/* The firmware takes a single device address for the whole map */
+	if (map->sgt->nents != 1) {
+		ret = -EINVAL;
+		goto err_unmap;
+	}
+
+	map->da = sg_dma_address(map->sgt->sgl);
+	map->size = sg_dma_len(map->sgt->sgl);
+
+	return map;
+
+err_unmap:
+	dma_buf_unmap_attachment_unlocked(map->attach, map->sgt, DMA_TO_DEVICE);
+err_detach:
+	dma_buf_detach(map->dmabuf, map->attach);
+err_put:
+	dma_buf_put(map->dmabuf);
+err_free:
+	kfree(map);
+	return ERR_PTR(ret);
+}
+EXPORT_SYMBOL_GPL(venus_helper_qp_map_get);
+
+static void qp_map_release(struct kref *ref)
+{
+	struct venus_qp_map *map = container_of(ref, struct venus_qp_map, ref);
+
+	dma_buf_unmap_attachment_unlocked(map->attach, map->sgt, DMA_TO_DEVICE);
+	dma_buf_detach(map->dmabuf, map->attach);
+	dma_buf_put(map->dmabuf);
+	kfree(map);
+}
+
+void venus_helper_qp_map_put(struct venus_qp_map *map)
+{
+	if (map)
+		kref_put(&map->ref, qp_map_release);
+}
+EXPORT_SYMBOL_GPL(venus_helper_qp_map_put);
+
+/*
+ * Attaches the current QP map of the instance to an encoder input buffer
+ * being queued, in place of the one it was last queued with.
+ */
+void venus_helper_qp_map_latch(struct venus_inst *inst,
+			       struct vb2_v4l2_buffer *vbuf)
+{
+	struct venus_buffer *buf = to_venus_buffer(vbuf);
+	struct venus_qp_map *map = inst->qp_map;
+
+	venus_helper_qp_map_put(buf->qp_map);
+	buf->qp_map = NULL;
+
+	if (!map)
+		return;
+
+	/* Pick up what the CPU wrote since the map was last used */
+	dma_sync_sgtable_for_device(inst->core->dev, map->sgt, DMA_TO_DEVICE);
+
+	kref_get(&map->ref);
+	buf->qp_map = map;
+}
+EXPORT_SYMBOL_GPL(venus_helper_qp_map_latch);
+
+static void
+session_fill_qp_map(struct venus_inst *inst, struct venus_buffer *buf,
+		    struct hfi_frame_data *fdata)
+{
+	unsigned int offset = buf->vb.vb2_buf.index * VENUS_EXTRADATA_SLOT;
+	const size_t hdr_size = offsetof(struct hfi_extradata_header, data);
+	struct venus_qp_map *map = buf->qp_map;
+	struct hfi_extradata_header *hdr;
+	struct hfi_extradata_roi_qp *roi;
+	u32 mbs;
+
+	if (!map || !inst->extradata)
+		return;
+
+	mbs = DIV_ROUND_UP(inst->width, 16) * DIV_ROUND_UP(inst->height, 16);
+	if (map->size < mbs) {
+		dev_dbg(inst->core->dev, VDBGL "QP map too small: %zu < %u\n",
+			map->size, mbs);
+		return;
+	}
+
+	hdr = inst->extradata + offset;
+	hdr->size = ALIGN(hdr_size + sizeof(*roi), 4);
+	hdr->version = 1;
+	hdr->port_index = 0;
+	hdr->type = HFI_EXTRADATA_ROI_QP;
+	hdr->data_size = sizeof(*roi);
+
+	roi = (struct hfi_extradata_roi_qp *)hdr->data;
+	roi->upper_qp_offset = 0;
+	roi->lower_qp_offset = 0;
+	roi->roi_info = 1;
+	roi->mbi_info_size = mbs;
+	roi->mbi_info_addr = map->da;
+
+	hdr = (void *)hdr + hdr->size;
+	hdr->size = hdr_size;
+	hdr->version = 1;
+	hdr->port_index = 0;
+	hdr->type = HFI_EXTRADATA_NONE;
+	hdr->data_size = 0;
+
+	fdata->extradata_addr = inst->extradata_da + offset;
+	fdata->extradata_size = VENUS_EXTRADATA_SLOT;
+	fdata->flags |= HFI_BUFFERFLAG_EXTRADATA;
+}
+
+static void
+session_fill_fdata(struct venus_inst *inst, struct vb2_v4l2_buffer *vbuf,
+		   struct hfi_frame_data *fdata)
 {
 	struct venus_buffer *buf = to_venus_buffer(vbuf);
 	struct vb2_buffer *vb = &vbuf->vb2_buf;
 	unsigned int type = vb->type;
-	struct hfi_frame_data fdata;
 
-	memset(&fdata, 0, sizeof(fdata));
-	fdata.alloc_len = buf->size;
-	fdata.device_addr = buf->dma_addr;
-	fdata.timestamp = vb->timestamp;
-	do_div(fdata.timestamp, NSEC_PER_USEC);
-	fdata.flags = 0;
-	fdata.clnt_data = vbuf->vb2_buf.index;
+	memset(fdata, 0, sizeof(*fdata));
+	fdata->alloc_len = buf->size;
+	fdata->device_addr = buf->dma_addr;
+	fdata->timestamp = vb->timestamp;
+	do_div(fdata->timestamp, NSEC_PER_USEC);
+	fdata->flags = 0;
+	fdata->clnt_data = vbuf->vb2_buf.index;
 
 	if (type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE) {
-		fdata.buffer_type = HFI_BUFFER_INPUT;
-		fdata.filled_len = vb2_get_plane_payload(vb, 0);
-		fdata.offset = vb->planes[0].data_offset;
+		fdata->buffer_type = HFI_BUFFER_INPUT;
+		fdata->filled_len = vb2_get_plane_payload(vb, 0);
+		fdata->offset = vb->planes[0].data_offset;
 
-		if (vbuf->flags & V4L2_BUF_FLAG_LAST || !fdata.filled_len)
-			fdata.flags |= HFI_BUFFERFLAG_EOS;
+		if (vbuf->flags & V4L2_BUF_FLAG_LAST || !fdata->filled_len)
+			fdata->flags |= HFI_BUFFERFLAG_EOS;
 
 		if (inst->session_type == VIDC_SESSION_TYPE_DEC)
 			put_ts_metadata(inst, vbuf);
+		else
+			session_fill_qp_map(inst, buf, fdata);
 
+		venus_pm_account_frame(inst);
 		venus_pm_load_scale(inst);
 	} else if (type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
 		if (inst->session_type == VIDC_SESSION_TYPE_ENC)
-			fdata.buffer_type = HFI_BUFFER_OUTPUT;
+			fdata->buffer_type = HFI_BUFFER_OUTPUT;
 		else
-			fdata.buffer_type = inst->opb_buftype;
-		fdata.filled_len = 0;
-		fdata.offset = 0;
+			fdata->buffer_type = inst->opb_buftype;
+		fdata->filled_len = 0;
+		fdata->offset = 0;
 	}
+}
+
+static int
+session_process_buf(struct venus_inst *inst, struct vb2_v4l2_buffer *vbuf)
+{
+	struct hfi_frame_data fdata;
+
+	session_fill_fdata(inst, vbuf, &fdata);
 
 	return hfi_session_process_buf(inst, &fdata);
 }
 
+/*
+ * Buffers collected to be handed to the firmware together, so that it is
+ * only woken up once for all of them.
+ */
+struct session_buf_batch {
+	struct hfi_frame_data fdata[HFI_BUF_BATCH_MAX];
+	struct vb2_v4l2_buffer *vbuf[HFI_BUF_BATCH_MAX];
+	unsigned int count;
+};
+
+static int session_batch_flush(struct venus_inst *inst,
+			       struct session_buf_batch *batch)
+{
+	unsigned int i;
+	int ret;
+
+	if (!batch->count)
+		return 0;
+
+	ret = hfi_session_process_bufs(inst, batch->fdata, batch->count);
+
+	/* Whatever didn't make it into the queue goes back with an error */
+	for (i = max(ret, 0); i < batch->count; i++)
+		return_buf_error(inst, batch->vbuf[i]);
+
+	batch->count = 0;
+
+	return ret < 0 ? ret : 0;
+}
+
+static int session_batch_add(struct venus_inst *inst,
+			     struct session_buf_batch *batch,
+			     struct vb2_v4l2_buffer *vbuf)
+{
+	session_fill_fdata(inst, vbuf, &batch->fdata[batch->count]);
+	batch->vbuf[batch->count++] = vbuf;
+
+	if (batch->count < HFI_BUF_BATCH_MAX)
+		return 0;
+
+	return session_batch_flush(inst, batch);
+}
+
 static bool is_dynamic_bufmode(struct venus_inst *inst)
 {
 	struct venus_core *core = inst->core;
@@ -1159,7 +1496,8 @@ static u32 venus_helper_get_work_mode(struct venus_inst *inst)
 		num_mbs = (ALIGN(inst->height, 16) * ALIGN(inst->width, 16)) / 256;
 		if (inst->hfi_codec == HFI_VIDEO_CODEC_MPEG2 ||
 		    inst->pic_struct != HFI_INTERLACE_FRAME_PROGRESSIVE ||
-		    num_mbs <= NUM_MBS_720P)
+		    num_mbs <= NUM_MBS_720P ||
+		    inst->flags & VENUS_LOW_LATENCY)
 			mode = VIDC_WORK_MODE_1;
 	} else {
 		num_mbs = (ALIGN(inst->out_height, 16) * ALIGN(inst->out_width, 16)) / 256;
@@ -1601,36 +1939,34 @@ EXPORT_SYMBOL_GPL(venus_helper_vb2_queue_error);
 int venus_helper_process_initial_cap_bufs(struct venus_inst *inst)
 {
 	struct v4l2_m2m_ctx *m2m_ctx = inst->m2m_ctx;
+	struct session_buf_batch batch = {};
 	struct v4l2_m2m_buffer *buf, *n;
 	int ret;
 
 	v4l2_m2m_for_each_dst_buf_safe(m2m_ctx, buf, n) {
-		ret = session_process_buf(inst, &buf->vb);
-		if (ret) {
-			return_buf_error(inst, &buf->vb);
+		ret = session_batch_add(inst, &batch, &buf->vb);
+		if (ret)
 			return ret;
-		}
 	}
 
-	return 0;
+	return session_batch_flush(inst, &batch);
 }
 EXPORT_SYMBOL_GPL(venus_helper_process_initial_cap_bufs);
 
 int venus_helper_process_initial_out_bufs(struct venus_inst *inst)
 {
 	struct v4l2_m2m_ctx *m2m_ctx = inst->m2m_ctx;
+	struct session_buf_batch batch = {};
 	struct v4l2_m2m_buffer *buf, *n;
 	int ret;
 
 	v4l2_m2m_for_each_src_buf_safe(m2m_ctx, buf, n) {
-		ret = session_process_buf(inst, &buf->vb);
-		if (ret) {
-			return_buf_error(inst, &buf->vb);
+		ret = session_batch_add(inst, &batch, &buf->vb);
+		if (ret)
 			return ret;
-		}
 	}
 
-	return 0;
+	return session_batch_flush(inst, &batch);
 }
 EXPORT_SYMBOL_GPL(venus_helper_process_initial_out_bufs);
 
@@ -1672,22 +2008,18 @@ void venus_helper_m2m_device_run(void *priv)
 {
 	struct venus_inst *inst = priv;
 	struct v4l2_m2m_ctx *m2m_ctx = inst->m2m_ctx;
+	struct session_buf_batch batch = {};
 	struct v4l2_m2m_buffer *buf, *n;
-	int ret;
 
 	mutex_lock(&inst->lock);
 
-	v4l2_m2m_for_each_dst_buf_safe(m2m_ctx, buf, n) {
-		ret = session_process_buf(inst, &buf->vb);
-		if (ret)
-			return_buf_error(inst, &buf->vb);
-	}
+	v4l2_m2m_for_each_dst_buf_safe(m2m_ctx, buf, n)
+		session_batch_add(inst, &batch, &buf->vb);
 
-	v4l2_m2m_for_each_src_buf_safe(m2m_ctx, buf, n) {
-		ret = session_process_buf(inst, &buf->vb);
-		if (ret)
-			return_buf_error(inst, &buf->vb);
-	}
+	v4l2_m2m_for_each_src_buf_safe(m2m_ctx, buf, n)
+		session_batch_add(inst, &batch, &buf->vb);
+
+	session_batch_flush(inst, &batch);
 
 	mutex_unlock(&inst->lock);
 }
@@ -58,6 +58,12 @@ int venus_helper_get_out_fmts(struct venus_inst *inst, u32 fmt, u32 *out_fmt,
 bool venus_helper_check_format(struct venus_inst *inst, u32 v4l2_pixfmt);
 int venus_helper_alloc_dpb_bufs(struct venus_inst *inst);
 int venus_helper_free_dpb_bufs(struct venus_inst *inst);
+void venus_helper_intbuf_pool_init(struct venus_core *core);
+void venus_helper_intbuf_pool_destroy(struct venus_core *core);
+struct venus_qp_map *venus_helper_qp_map_get(struct venus_inst *inst, int fd);
+void venus_helper_qp_map_put(struct venus_qp_map *map);
+void venus_helper_qp_map_latch(struct venus_inst *inst,
+			       struct vb2_v4l2_buffer *vbuf);
 int venus_helper_intbufs_alloc(struct venus_inst *inst);
 int venus_helper_intbufs_free(struct venus_inst *inst);
 int venus_helper_intbufs_realloc(struct venus_inst *inst);
@@ -65,8 +71,8 @@ int venus_helper_queue_dpb_bufs(struct venus_inst *inst);
 int venus_helper_unregister_bufs(struct venus_inst *inst);
 int venus_helper_process_initial_cap_bufs(struct venus_inst *inst);
 int venus_helper_process_initial_out_bufs(struct venus_inst *inst);
-void venus_helper_get_ts_metadata(struct venus_inst *inst, u64 timestamp_us,
-				  struct vb2_v4l2_buffer *vbuf);
+u64 venus_helper_get_ts_metadata(struct venus_inst *inst, u64 timestamp_us,
+				 struct vb2_v4l2_buffer *vbuf);
 int venus_helper_get_profile_level(struct venus_inst *inst, u32 *profile, u32 *level);
 int venus_helper_set_profile_level(struct venus_inst *inst, u32 profile, u32 level);
 int venus_helper_set_stride(struct venus_inst *inst, unsigned int aligned_width,
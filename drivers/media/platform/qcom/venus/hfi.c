@@ -553,6 +553,38 @@ int hfi_session_process_buf(struct venus_inst *inst, struct hfi_frame_data *fd)
 }
 EXPORT_SYMBOL_GPL(hfi_session_process_buf);
 
+/*
+ * hfi_session_process_bufs - Hand several buffers to the firmware at once
+ *
+ * Returns the number of buffers queued, counting from the first one, or a
+ * negative error code if not even the first one could be.
+ */
+int hfi_session_process_bufs(struct venus_inst *inst, struct hfi_frame_data *fds,
+			     unsigned int count)
+{
+	const struct hfi_ops *ops = inst->core->ops;
+	unsigned int i;
+	int ret;
+
+	if (test_bit(0, &inst->core->sys_error))
+		return -EIO;
+
+	if (!count || count > HFI_BUF_BATCH_MAX)
+		return -EINVAL;
+
+	if (ops->session_process_bufs)
+		return ops->session_process_bufs(inst, fds, count);
+
+	for (i = 0; i < count; i++) {
+		ret = hfi_session_process_buf(inst, &fds[i]);
+		if (ret)
+			return i ? i : ret;
+	}
+
+	return count;
+}
+EXPORT_SYMBOL_GPL(hfi_session_process_bufs);
+
 irqreturn_t hfi_isr_thread(int irq, void *dev_id)
 {
 	struct venus_core *core = dev_id;
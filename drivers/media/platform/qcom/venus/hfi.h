@@ -43,6 +43,9 @@ struct hfi_frame_data {
 	u32 extradata_size;
 };
 
+/* Most buffers hfi_session_process_bufs() takes at once */
+#define HFI_BUF_BATCH_MAX	8
+
 union hfi_get_property {
 	struct hfi_profile_level profile_level;
 	struct hfi_buffer_requirements bufreq[HFI_BUFFER_TYPE_MAX];
@@ -121,6 +124,9 @@ struct hfi_ops {
 	int (*session_continue)(struct venus_inst *inst);
 	int (*session_etb)(struct venus_inst *inst, struct hfi_frame_data *fd);
 	int (*session_ftb)(struct venus_inst *inst, struct hfi_frame_data *fd);
+	int (*session_process_bufs)(struct venus_inst *inst,
+				    struct hfi_frame_data *fds,
+				    unsigned int count);
 	int (*session_set_buffers)(struct venus_inst *inst,
 				   struct hfi_buffer_desc *bd);
 	int (*session_unset_buffers)(struct venus_inst *inst,
@@ -172,6 +178,8 @@ int hfi_session_get_property(struct venus_inst *inst, u32 ptype,
 			     union hfi_get_property *hprop);
 int hfi_session_set_property(struct venus_inst *inst, u32 ptype, void *pdata);
 int hfi_session_process_buf(struct venus_inst *inst, struct hfi_frame_data *f);
+int hfi_session_process_bufs(struct venus_inst *inst, struct hfi_frame_data *fds,
+			     unsigned int count);
 irqreturn_t hfi_isr_thread(int irq, void *dev_id);
 irqreturn_t hfi_isr(int irq, void *dev);
 
@@ -458,6 +458,14 @@ static int pkt_session_set_property_1x(struct hfi_session_set_property_pkt *pkt,
 		pkt->shdr.hdr.size += sizeof(u32) * 2;
 		break;
 	}
+	case HFI_PROPERTY_PARAM_INDEX_EXTRADATA: {
+		struct hfi_index_extradata_config *in = pdata, *ext = prop_data;
+
+		ext->enable = in->enable;
+		ext->index_extra_data_id = in->index_extra_data_id;
+		pkt->shdr.hdr.size += sizeof(u32) + sizeof(*ext);
+		break;
+	}
 	case HFI_PROPERTY_PARAM_BUFFER_COUNT_ACTUAL: {
 		struct hfi_buffer_count_actual *in = pdata, *count = prop_data;
 
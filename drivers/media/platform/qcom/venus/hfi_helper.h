@@ -105,6 +105,7 @@
 #define HFI_EXTRADATA_STREAM_USERDATA			0x0000000e
 #define HFI_EXTRADATA_FRAME_QP				0x0000000f
 #define HFI_EXTRADATA_FRAME_BITS_INFO			0x00000010
+#define HFI_EXTRADATA_ROI_QP				0x00000013
 #define HFI_EXTRADATA_MULTISLICE_INFO			0x7f100000
 #define HFI_EXTRADATA_NUM_CONCEALED_MB			0x7f100001
 #define HFI_EXTRADATA_INDEX				0x7f100002
@@ -524,6 +525,7 @@
 #define HFI_PROPERTY_PARAM_VENC_VPX_ERROR_RESILIENCE_MODE	0x2005029
 #define HFI_PROPERTY_PARAM_VENC_HIER_B_MAX_NUM_ENH_LAYER	0x200502c
 #define HFI_PROPERTY_PARAM_VENC_HIER_P_HYBRID_MODE		0x200502f
+#define HFI_PROPERTY_PARAM_VENC_ROI_QP_EXTRADATA		0x200502b
 #define HFI_PROPERTY_PARAM_VENC_HDR10_PQ_SEI			0x2005036
 
 /*
@@ -1144,6 +1146,15 @@ struct hfi_extradata_header {
 	u8 data[1];
 };
 
+/* Per-macroblock QP deltas, one s8 each, at device address mbi_info_addr */
+struct hfi_extradata_roi_qp {
+	u32 upper_qp_offset;
+	u32 lower_qp_offset;
+	u32 roi_info;
+	u32 mbi_info_size;
+	u32 mbi_info_addr;
+};
+
 struct hfi_batch_info {
 	u32 input_batch_count;
 	u32 output_batch_count;
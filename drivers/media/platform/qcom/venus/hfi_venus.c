@@ -378,13 +378,12 @@ static void venus_soft_int(struct venus_hfi_device *hdev)
 	writel(clear_bit, cpu_ic_base + CPU_IC_SOFTINT);
 }
 
-static int venus_iface_cmdq_write_nolock(struct venus_hfi_device *hdev,
-					 void *pkt, bool sync)
+static int venus_iface_cmdq_enqueue_nolock(struct venus_hfi_device *hdev,
+					   void *pkt, bool sync, u32 *rx_req)
 {
 	struct device *dev = hdev->core->dev;
 	struct hfi_pkt_hdr *cmd_packet;
 	struct iface_queue *queue;
-	u32 rx_req;
 	int ret;
 
 	if (!venus_is_valid_state(hdev))
@@ -395,7 +394,7 @@ static int venus_iface_cmdq_write_nolock(struct venus_hfi_device *hdev,
 
 	queue = &hdev->queues[IFACEQ_CMD_IDX];
 
-	ret = venus_write_queue(hdev, queue, pkt, &rx_req);
+	ret = venus_write_queue(hdev, queue, pkt, rx_req);
 	if (ret) {
 		dev_err(dev, "write to iface cmd queue failed (%d)\n", ret);
 		return ret;
@@ -412,6 +411,19 @@ static int venus_iface_cmdq_write_nolock(struct venus_hfi_device *hdev,
 		wmb();
 	}
 
+	return 0;
+}
+
+static int venus_iface_cmdq_write_nolock(struct venus_hfi_device *hdev,
+					 void *pkt, bool sync)
+{
+	u32 rx_req;
+	int ret;
+
+	ret = venus_iface_cmdq_enqueue_nolock(hdev, pkt, sync, &rx_req);
+	if (ret)
+		return ret;
+
 	if (rx_req)
 		venus_soft_int(hdev);
 
@@ -429,6 +441,36 @@ static int venus_iface_cmdq_write(struct venus_hfi_device *hdev, void *pkt, bool
 	return ret;
 }
 
+/*
+ * Write several asynchronous commands under one lock, and raise at most one
+ * interrupt once they are all in the queue.  Returns the number of packets
+ * written, which is short only if the queue filled up, or a negative error
+ * code if not even the first one fit.
+ */
+static int venus_iface_cmdq_write_batch(struct venus_hfi_device *hdev,
+					void **pkts, unsigned int count)
+{
+	u32 rx_req, doorbell = 0;
+	unsigned int i;
+	int ret = 0;
+
+	mutex_lock(&hdev->lock);
+
+	for (i = 0; i < count; i++) {
+		ret = venus_iface_cmdq_enqueue_nolock(hdev, pkts[i], false, &rx_req);
+		if (ret)
+			break;
+		doorbell |= rx_req;
+	}
+
+	if (doorbell)
+		venus_soft_int(hdev);
+
+	mutex_unlock(&hdev->lock);
+
+	return i ? i : ret;
+}
+
 static int venus_hfi_core_set_resource(struct venus_core *core, u32 id,
 				       u32 size, u32 addr, void *cookie)
 {
@@ -1321,6 +1363,48 @@ static int venus_session_ftb(struct venus_inst *inst,
 	return venus_iface_cmdq_write(hdev, &pkt, false);
 }
 
+union venus_buf_pkt {
+	struct hfi_session_empty_buffer_compressed_pkt etb_dec;
+	struct hfi_session_empty_buffer_uncompressed_plane0_pkt etb_enc;
+	struct hfi_session_fill_buffer_pkt ftb;
+};
+
+static int venus_session_process_bufs(struct venus_inst *inst,
+				      struct hfi_frame_data *fds,
+				      unsigned int count)
+{
+	struct venus_hfi_device *hdev = to_hfi_priv(inst->core);
+	union venus_buf_pkt pkts[HFI_BUF_BATCH_MAX];
+	void *ptrs[HFI_BUF_BATCH_MAX];
+	unsigned int i;
+	int ret = 0;
+
+	for (i = 0; i < count; i++) {
+		struct hfi_frame_data *fd = &fds[i];
+
+		if (fd->buffer_type == HFI_BUFFER_INPUT &&
+		    inst->session_type == VIDC_SESSION_TYPE_DEC)
+			ret = pkt_session_etb_decoder(&pkts[i].etb_dec, inst, fd);
+		else if (fd->buffer_type == HFI_BUFFER_INPUT &&
+			 inst->session_type == VIDC_SESSION_TYPE_ENC)
+			ret = pkt_session_etb_encoder(&pkts[i].etb_enc, inst, fd);
+		else if (fd->buffer_type == HFI_BUFFER_OUTPUT ||
+			 fd->buffer_type == HFI_BUFFER_OUTPUT2)
+			ret = pkt_session_ftb(&pkts[i].ftb, inst, fd);
+		else
+			ret = -EINVAL;
+		if (ret)
+			break;
+
+		ptrs[i] = &pkts[i];
+	}
+
+	if (!i)
+		return ret;
+
+	return venus_iface_cmdq_write_batch(hdev, ptrs, i);
+}
+
 static int venus_session_set_buffers(struct venus_inst *inst,
 				     struct hfi_buffer_desc *bd)
 {
@@ -1651,6 +1735,7 @@ static const struct hfi_ops venus_hfi_ops = {
 	.session_continue		= venus_session_continue,
 	.session_etb			= venus_session_etb,
 	.session_ftb			= venus_session_ftb,
+	.session_process_bufs		= venus_session_process_bufs,
 	.session_set_buffers		= venus_session_set_buffers,
 	.session_unset_buffers		= venus_session_unset_buffers,
 	.session_load_res		= venus_session_load_res,
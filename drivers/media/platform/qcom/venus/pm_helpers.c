@@ -146,6 +146,75 @@ static void vcodec_clks_disable(struct venus_core *core, struct clk **clks)
 		clk_disable_unprepare(clks[i]);
 }
 
+/*
+ * Sessions vote for the frame rate they actually run at rather than the one
+ * they declared.  It is measured over windows of LOAD_WINDOW_NS, and goes up
+ * as soon as a quarter of a window shows a higher rate, but only comes down
+ * halfway towards a lower one per full window.  A session which hasn't queued
+ * a frame for LOAD_IDLE_NS doesn't vote at all.
+ */
+#define LOAD_WINDOW_NS		(250 * NSEC_PER_MSEC)
+#define LOAD_IDLE_NS		(4 * LOAD_WINDOW_NS)
+/* Headroom on top of the measured rate, in eighths */
+#define LOAD_HEADROOM		1
+
+void venus_pm_account_frame(struct venus_inst *inst)
+{
+	struct clock_data *clk = &inst->clk_data;
+	u64 now = ktime_get_ns();
+	u64 elapsed;
+	u32 fps;
+
+	if (!clk->window_start || now - clk->last_frame_ns > LOAD_IDLE_NS) {
+		clk->window_start = now;
+		clk->window_frames = 0;
+		WRITE_ONCE(clk->last_frame_ns, now);
+		return;
+	}
+
+	WRITE_ONCE(clk->last_frame_ns, now);
+	clk->window_frames++;
+
+	elapsed = now - clk->window_start;
+	if (elapsed < LOAD_WINDOW_NS / 4)
+		return;
+
+	fps = DIV_ROUND_UP_ULL((u64)clk->window_frames * NSEC_PER_SEC, elapsed);
+	if (fps > clk->measured_fps)
+		WRITE_ONCE(clk->measured_fps, fps);
+
+	if (elapsed < LOAD_WINDOW_NS)
+		return;
+
+	if (fps < clk->measured_fps)
+		WRITE_ONCE(clk->measured_fps, (clk->measured_fps + fps + 1) / 2);
+
+	clk->window_start = now;
+	clk->window_frames = 0;
+}
+
+static bool inst_idle(struct venus_inst *inst)
+{
+	const struct clock_data *clk = &inst->clk_data;
+
+	return READ_ONCE(clk->measured_fps) &&
+	       ktime_get_ns() - READ_ONCE(clk->last_frame_ns) > LOAD_IDLE_NS;
+}
+
+static u32 inst_fps(struct venus_inst *inst)
+{
+	u32 fps = READ_ONCE(inst->clk_data.measured_fps);
+
+	/* Until a rate has been measured, trust the declared one */
+	if (!fps)
+		return inst->fps;
+
+	if (inst_idle(inst))
+		return 0;
+
+	return fps + DIV_ROUND_UP(fps * LOAD_HEADROOM, 8);
+}
+
 static u32 load_per_instance(struct venus_inst *inst)
 {
 	u32 mbs;
@@ -155,7 +224,7 @@ static u32 load_per_instance(struct venus_inst *inst)
 
 	mbs = (ALIGN(inst->width, 16) / 16) * (ALIGN(inst->height, 16) / 16);
 
-	return mbs * inst->fps;
+	return mbs * inst_fps(inst);
 }
 
 static u32 load_per_type(struct venus_core *core, u32 session_type)
@@ -240,6 +309,20 @@ static int load_scale_bw(struct venus_core *core)
 	return icc_set_bw(core->video_path, total_avg, total_peak);
 }
 
+static bool low_latency_running(struct venus_core *core)
+{
+	struct venus_inst *inst;
+
+	lockdep_assert_held(&core->lock);
+
+	list_for_each_entry(inst, &core->instances, list) {
+		if (inst->state == INST_START && inst->flags & VENUS_LOW_LATENCY)
+			return true;
+	}
+
+	return false;
+}
+
 static int load_scale_v1(struct venus_inst *inst)
 {
 	struct venus_core *core = inst->core;
@@ -259,6 +342,9 @@ static int load_scale_v1(struct venus_inst *inst)
 		dev_warn(dev, "HW is overloaded, needed: %d max: %d\n",
 			 mbs_per_sec, core->res->max_load);
 
+	if (low_latency_running(core))
+		goto set_freq;
+
 	if (!mbs_per_sec && num_rows > 1) {
 		freq = table[num_rows - 1].freq;
 		goto set_freq;
@@ -1076,7 +1162,7 @@ static unsigned long calculate_inst_freq(struct venus_inst *inst,
 					 unsigned long filled_len)
 {
 	unsigned long vpp_freq_per_mb = 0, vpp_freq = 0, vsp_freq = 0;
-	u32 fps = (u32)inst->fps;
+	u32 fps = inst_fps(inst);
 	u32 mbs_per_sec;
 
 	mbs_per_sec = load_per_instance(inst);
@@ -1084,6 +1170,10 @@ static unsigned long calculate_inst_freq(struct venus_inst *inst,
 	if (inst->state != INST_START)
 		return 0;
 
+	/* Low-latency sessions keep the core at its highest rate */
+	if (inst->flags & VENUS_LOW_LATENCY)
+		return inst->core->res->freq_tbl[0].freq;
+
 	if (inst->session_type == VIDC_SESSION_TYPE_ENC) {
 		vpp_freq_per_mb = inst->flags & VENUS_LOW_POWER ?
 			inst->clk_data.low_power_freq :
@@ -1128,6 +1218,10 @@ static int load_scale_v4(struct venus_inst *inst)
 
 	mutex_lock(&core->lock);
 	list_for_each_entry(inst, &core->instances, list) {
+		/* The vote of an idle session is stale, drop it */
+		if (inst_idle(inst))
+			inst->clk_data.freq = 0;
+
 		if (inst->clk_data.core_id == VIDC_CORE_ID_1) {
 			freq_core1 += inst->clk_data.freq;
 		} else if (inst->clk_data.core_id == VIDC_CORE_ID_2) {
@@ -28,6 +28,7 @@ struct venus_pm_ops {
 };
 
 const struct venus_pm_ops *venus_pm_get(enum hfi_version version);
+void venus_pm_account_frame(struct venus_inst *inst);
 
 static inline int venus_pm_load_scale(struct venus_inst *inst)
 {
@@ -694,7 +694,8 @@ static int vdec_set_properties(struct venus_inst *inst)
 			return ret;
 	}
 
-	if (ctr->display_delay_enable && ctr->display_delay == 0) {
+	if (ctr->low_latency ||
+	    (ctr->display_delay_enable && ctr->display_delay == 0)) {
 		ptype = HFI_PROPERTY_PARAM_VDEC_OUTPUT_ORDER;
 		decode_order = HFI_OUTPUT_ORDER_DECODE;
 		ret = hfi_session_set_property(inst, ptype, &decode_order);
@@ -702,6 +703,13 @@ static int vdec_set_properties(struct venus_inst *inst)
 			return ret;
 	}
 
+	if (ctr->low_latency) {
+		ptype = HFI_PROPERTY_CONFIG_REALTIME;
+		ret = hfi_session_set_property(inst, ptype, &en);
+		if (ret)
+			return ret;
+	}
+
 	/* Enabling sufficient sequence change support for VP9 */
 	if (is_fw_rev_or_newer(inst->core, 5, 4, 51)) {
 		ptype = HFI_PROPERTY_PARAM_VDEC_ENABLE_SUFFICIENT_SEQCHANGE_EVENT;
@@ -1397,10 +1405,12 @@ static void vdec_buf_done(struct venus_inst *inst, unsigned int buf_type,
 			  u32 tag, u32 bytesused, u32 data_offset, u32 flags,
 			  u32 hfi_flags, u64 timestamp_us)
 {
+	struct vdec_controls *ctr = &inst->controls.dec;
 	enum vb2_buffer_state state = VB2_BUF_STATE_DONE;
 	struct vb2_v4l2_buffer *vbuf;
 	struct vb2_buffer *vb;
 	unsigned int type;
+	u64 queued_ns;
 
 	vdec_pm_touch(inst);
 
@@ -1442,7 +1452,12 @@ static void vdec_buf_done(struct venus_inst *inst, unsigned int buf_type,
 		vbuf->sequence = inst->sequence_out++;
 	}
 
-	venus_helper_get_ts_metadata(inst, timestamp_us, vbuf);
+	queued_ns = venus_helper_get_ts_metadata(inst, timestamp_us, vbuf);
+
+	if (type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE && ctr->low_latency &&
+	    queued_ns)
+		v4l2_ctrl_s_ctrl(ctr->latency,
+				 div_u64(ktime_get_ns() - queued_ns, NSEC_PER_USEC));
 
 	if (hfi_flags & HFI_BUFFERFLAG_READONLY)
 		venus_helper_acquire_buf_ref(vbuf);
@@ -5,6 +5,7 @@
  */
 #include <linux/types.h>
 #include <media/v4l2-ctrls.h>
+#include <uapi/linux/qcom-venus.h>
 
 #include "core.h"
 #include "helpers.h"
@@ -39,6 +40,13 @@ static int vdec_op_s_ctrl(struct v4l2_ctrl *ctrl)
 	case V4L2_CID_MPEG_VIDEO_DEC_CONCEAL_COLOR:
 		ctr->conceal_color = *ctrl->p_new.p_s64;
 		break;
+	case V4L2_CID_MPEG_VENUS_DEC_LOW_LATENCY:
+		ctr->low_latency = ctrl->val;
+		inst->flags = ctrl->val ? inst->flags | VENUS_LOW_LATENCY :
+			inst->flags & ~VENUS_LOW_LATENCY;
+		break;
+	case V4L2_CID_MPEG_VENUS_DEC_LATENCY:
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -93,12 +101,31 @@ static const struct v4l2_ctrl_ops vdec_ctrl_ops = {
 	.g_volatile_ctrl = vdec_op_g_volatile_ctrl,
 };
 
+static const struct v4l2_ctrl_config vdec_low_latency_ctrl = {
+	.ops = &vdec_ctrl_ops,
+	.id = V4L2_CID_MPEG_VENUS_DEC_LOW_LATENCY,
+	.name = "Low Latency Decoding",
+	.type = V4L2_CTRL_TYPE_BOOLEAN,
+	.max = 1,
+	.step = 1,
+};
+
+static const struct v4l2_ctrl_config vdec_latency_ctrl = {
+	.ops = &vdec_ctrl_ops,
+	.id = V4L2_CID_MPEG_VENUS_DEC_LATENCY,
+	.name = "Decode Latency (us)",
+	.type = V4L2_CTRL_TYPE_INTEGER,
+	.flags = V4L2_CTRL_FLAG_READ_ONLY,
+	.max = S32_MAX,
+	.step = 1,
+};
+
 int vdec_ctrl_init(struct venus_inst *inst)
 {
 	struct v4l2_ctrl *ctrl;
 	int ret;
 
-	ret = v4l2_ctrl_handler_init(&inst->ctrl_handler, 12);
+	ret = v4l2_ctrl_handler_init(&inst->ctrl_handler, 14);
 	if (ret)
 		return ret;
 
@@ -179,6 +206,11 @@ int vdec_ctrl_init(struct venus_inst *inst)
 			  V4L2_CID_MPEG_VIDEO_DEC_CONCEAL_COLOR, 0,
 			  0xffffffffffffLL, 1, 0x8000800010LL);
 
+	v4l2_ctrl_new_custom(&inst->ctrl_handler, &vdec_low_latency_ctrl, NULL);
+
+	inst->controls.dec.latency =
+		v4l2_ctrl_new_custom(&inst->ctrl_handler, &vdec_latency_ctrl, NULL);
+
 	ret = inst->ctrl_handler.error;
 	if (ret) {
 		v4l2_ctrl_handler_free(&inst->ctrl_handler);
@@ -997,6 +997,18 @@ static int venc_set_properties(struct venus_inst *inst)
 			return ret;
 	}
 
+	if (inst->qp_map) {
+		struct hfi_index_extradata_config extradata = {
+			.enable = 1,
+			.index_extra_data_id = HFI_PROPERTY_PARAM_VENC_ROI_QP_EXTRADATA,
+		};
+
+		ptype = HFI_PROPERTY_PARAM_INDEX_EXTRADATA;
+		ret = hfi_session_set_property(inst, ptype, &extradata);
+		if (ret)
+			return ret;
+	}
+
 	return 0;
 }
 
@@ -1186,6 +1198,8 @@ static void venc_buf_cleanup(struct vb2_buffer *vb)
 	if (vb->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE)
 		if (!list_empty(&inst->registeredbufs))
 			list_del_init(&buf->reg_list);
+	venus_helper_qp_map_put(buf->qp_map);
+	buf->qp_map = NULL;
 	mutex_unlock(&inst->lock);
 
 	inst->buf_count--;
@@ -1308,6 +1322,9 @@ static void venc_vb2_buf_queue(struct vb2_buffer *vb)
 		return;
 	}
 
+	if (vb->type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE)
+		venus_helper_qp_map_latch(inst, vbuf);
+
 	venus_helper_vb2_buf_queue(vb);
 	mutex_unlock(&inst->lock);
 }
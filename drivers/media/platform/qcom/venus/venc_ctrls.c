@@ -3,8 +3,10 @@
  * Copyright (c) 2012-2016, The Linux Foundation. All rights reserved.
  * Copyright (C) 2017 Linaro Ltd.
  */
+#include <linux/dma-mapping.h>
 #include <linux/types.h>
 #include <media/v4l2-ctrls.h>
+#include <uapi/linux/qcom-venus.h>
 
 #include "core.h"
 #include "venc.h"
@@ -67,6 +69,35 @@ static int venc_calc_bpframes(u32 gop_size, u32 conseq_b, u32 *bf, u32 *pf)
 	return 0;
 }
 
+static int venc_set_qp_map(struct venus_inst *inst, int fd)
+{
+	struct device *dev = inst->core->dev;
+	struct venus_qp_map *map = NULL, *old;
+
+	if (fd >= 0) {
+		if (!inst->extradata) {
+			inst->extradata =
+				dma_alloc_coherent(dev, VENUS_EXTRADATA_SLOT * VIDEO_MAX_FRAME,
+						   &inst->extradata_da, GFP_KERNEL);
+			if (!inst->extradata)
+				return -ENOMEM;
+		}
+
+		map = venus_helper_qp_map_get(inst, fd);
+		if (IS_ERR(map))
+			return PTR_ERR(map);
+	}
+
+	mutex_lock(&inst->lock);
+	old = inst->qp_map;
+	inst->qp_map = map;
+	mutex_unlock(&inst->lock);
+
+	venus_helper_qp_map_put(old);
+
+	return 0;
+}
+
 static int venc_op_s_ctrl(struct v4l2_ctrl *ctrl)
 {
 	struct venus_inst *inst = ctrl_to_inst(ctrl);
@@ -340,6 +371,8 @@ static int venc_op_s_ctrl(struct v4l2_ctrl *ctrl)
 
 		ctr->h264_8x8_transform = ctrl->val;
 		break;
+	case V4L2_CID_MPEG_VENUS_ENC_QP_MAP:
+		return venc_set_qp_map(inst, ctrl->val);
 	default:
 		return -EINVAL;
 	}
@@ -372,6 +405,18 @@ static const struct v4l2_ctrl_ops venc_ctrl_ops = {
 	.g_volatile_ctrl = venc_op_g_volatile_ctrl,
 };
 
+static const struct v4l2_ctrl_config venc_qp_map_ctrl = {
+	.ops = &venc_ctrl_ops,
+	.id = V4L2_CID_MPEG_VENUS_ENC_QP_MAP,
+	.name = "QP Map Buffer",
+	.type = V4L2_CTRL_TYPE_INTEGER,
+	.min = -1,
+	.max = INT_MAX,
+	.step = 1,
+	.def = -1,
+	.flags = V4L2_CTRL_FLAG_EXECUTE_ON_WRITE,
+};
+
 int venc_ctrl_init(struct venus_inst *inst)
 {
 	int ret;
@@ -381,7 +426,7 @@ int venc_ctrl_init(struct venus_inst *inst)
 	};
 	struct v4l2_ctrl_hdr10_cll_info p_hdr10_cll = { 1000, 400 };
 
-	ret = v4l2_ctrl_handler_init(&inst->ctrl_handler, 59);
+	ret = v4l2_ctrl_handler_init(&inst->ctrl_handler, 60);
 	if (ret)
 		return ret;
 
@@ -622,6 +667,8 @@ int venc_ctrl_init(struct venus_inst *inst)
 			  V4L2_CID_MPEG_VIDEO_INTRA_REFRESH_PERIOD, 0,
 			  ((4096 * 2304) >> 8), 1, 0);
 
+	v4l2_ctrl_new_custom(&inst->ctrl_handler, &venc_qp_map_ctrl, NULL);
+
 	ret = inst->ctrl_handler.error;
 	if (ret)
 		goto err;
@@ -639,4 +686,13 @@ int venc_ctrl_init(struct venus_inst *inst)
 void venc_ctrl_deinit(struct venus_inst *inst)
 {
 	v4l2_ctrl_handler_free(&inst->ctrl_handler);
+
+	venus_helper_qp_map_put(inst->qp_map);
+	inst->qp_map = NULL;
+
+	if (inst->extradata)
+		dma_free_coherent(inst->core->dev,
+				  VENUS_EXTRADATA_SLOT * VIDEO_MAX_FRAME,
+				  inst->extradata, inst->extradata_da);
+	inst->extradata = NULL;
 }
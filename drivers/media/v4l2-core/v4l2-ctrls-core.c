@@ -1676,6 +1676,10 @@ int handler_new_ref(struct v4l2_ctrl_handler *hdl,
 	if (ctrl_ref)
 		*ctrl_ref = NULL;
 
+	/* Recycled request objects would not know about the new control */
+	if (hdl->req_pool)
+		v4l2_ctrl_request_pool_flush(hdl);
+
 	/*
 	 * Automatically add the control class if it is not yet present and
 	 * the new control is not a compound control.
@@ -84,6 +84,7 @@ int try_set_ext_ctrls_common(struct v4l2_fh *fh,
 /* v4l2-ctrls-request.c */
 void v4l2_ctrl_handler_init_request(struct v4l2_ctrl_handler *hdl);
 void v4l2_ctrl_handler_free_request(struct v4l2_ctrl_handler *hdl);
+void v4l2_ctrl_request_pool_flush(struct v4l2_ctrl_handler *hdl);
 int v4l2_g_ext_ctrls_request(struct v4l2_ctrl_handler *hdl, struct video_device *vdev,
 			     struct media_device *mdev, struct v4l2_ext_controls *cs);
 int try_set_ext_ctrls_request(struct v4l2_fh *fh,
@@ -15,12 +15,90 @@
 
 #include "v4l2-ctrls-priv.h"
 
+/*
+ * The copies of a main handler which hold the control values of requests
+ * can be kept in a pool when their request lets go of them, rather than
+ * being freed, and handed to the next request. They still have all the
+ * control refs and value storage of the main handler, so reusing one only
+ * takes clearing the refs.
+ *
+ * The pool is refcounted, by the main handler and by every request handler
+ * which may return to it, so it is safe to release request objects after
+ * the main handler is gone. Pooled handlers are linked through their
+ * requests_queued list, which is unused while they are not bound.
+ */
+struct v4l2_ctrl_request_pool {
+	struct kref ref;
+	struct mutex lock;
+	struct list_head free;
+	unsigned int nr_free;
+	unsigned int max;
+	unsigned int gen;
+	bool dead;
+};
+
+/* A copy of a main handler in a request */
+struct v4l2_ctrl_request_hdl {
+	struct v4l2_ctrl_handler hdl;
+	struct v4l2_ctrl_request_pool *pool;
+	unsigned int gen;
+};
+
+static const struct media_request_object_ops req_ops;
+
+static inline struct v4l2_ctrl_request_hdl *
+to_request_hdl(struct v4l2_ctrl_handler *hdl)
+{
+	return container_of(hdl, struct v4l2_ctrl_request_hdl, hdl);
+}
+
+static void v4l2_ctrl_request_pool_release(struct kref *ref)
+{
+	struct v4l2_ctrl_request_pool *pool =
+		container_of(ref, struct v4l2_ctrl_request_pool, ref);
+
+	mutex_destroy(&pool->lock);
+	kfree(pool);
+}
+
+static void v4l2_ctrl_request_hdl_free(struct v4l2_ctrl_handler *hdl)
+{
+	v4l2_ctrl_handler_free(hdl);
+	kfree(to_request_hdl(hdl));
+}
+
+/* Free the pooled handlers, the ones in use are freed when released */
+static void v4l2_ctrl_request_pool_drain(struct v4l2_ctrl_request_pool *pool,
+					 bool dead)
+{
+	struct v4l2_ctrl_handler *hdl, *next;
+	LIST_HEAD(free);
+
+	mutex_lock(&pool->lock);
+	list_splice_init(&pool->free, &free);
+	pool->nr_free = 0;
+	pool->gen++;
+	pool->dead |= dead;
+	mutex_unlock(&pool->lock);
+
+	list_for_each_entry_safe(hdl, next, &free, requests_queued) {
+		list_del_init(&hdl->requests_queued);
+		v4l2_ctrl_request_hdl_free(hdl);
+	}
+}
+
+void v4l2_ctrl_request_pool_flush(struct v4l2_ctrl_handler *hdl)
+{
+	v4l2_ctrl_request_pool_drain(hdl->req_pool, false);
+}
+
 /* Initialize the request-related fields in a control handler */
 void v4l2_ctrl_handler_init_request(struct v4l2_ctrl_handler *hdl)
 {
 	INIT_LIST_HEAD(&hdl->requests);
 	INIT_LIST_HEAD(&hdl->requests_queued);
 	hdl->request_is_queued = false;
+	hdl->req_pool = NULL;
 	media_request_object_init(&hdl->req_obj);
 }
 
@@ -28,15 +106,15 @@ void v4l2_ctrl_handler_init_request(struct v4l2_ctrl_handler *hdl)
 void v4l2_ctrl_handler_free_request(struct v4l2_ctrl_handler *hdl)
 {
 	struct v4l2_ctrl_handler *req, *next_req;
+	struct v4l2_ctrl_request_pool *pool = hdl->req_pool;
 
 	/*
-	 * Do nothing if this isn't the main handler or the main
-	 * handler is not used in any request.
+	 * Do nothing if this isn't the main handler.
 	 *
 	 * The main handler can be identified by having a NULL ops pointer in
 	 * the request object.
 	 */
-	if (hdl->req_obj.ops || list_empty(&hdl->requests))
+	if (hdl->req_obj.ops)
 		return;
 
 	/*
@@ -48,6 +126,12 @@ void v4l2_ctrl_handler_free_request(struct v4l2_ctrl_handler *hdl)
 		media_request_object_unbind(&req->req_obj);
 		media_request_object_put(&req->req_obj);
 	}
+
+	if (pool) {
+		hdl->req_pool = NULL;
+		v4l2_ctrl_request_pool_drain(pool, true);
+		kref_put(&pool->ref, v4l2_ctrl_request_pool_release);
+	}
 }
 
 static int v4l2_ctrl_request_clone(struct v4l2_ctrl_handler *hdl,
@@ -107,13 +191,47 @@ static void v4l2_ctrl_request_unbind(struct media_request_object *obj)
 	mutex_unlock(main_hdl->lock);
 }
 
+/* Put a request handler back in its pool, if there's room */
+static bool v4l2_ctrl_request_recycle(struct v4l2_ctrl_handler *hdl)
+{
+	struct v4l2_ctrl_request_hdl *req_hdl = to_request_hdl(hdl);
+	struct v4l2_ctrl_request_pool *pool = req_hdl->pool;
+	struct v4l2_ctrl_ref *ref;
+	bool recycled = false;
+
+	if (hdl->error)
+		return false;
+
+	list_for_each_entry(ref, &hdl->ctrl_refs, node) {
+		ref->req_done = false;
+		ref->p_req_valid = false;
+		ref->p_req_array_enomem = false;
+	}
+	hdl->request_is_queued = false;
+
+	mutex_lock(&pool->lock);
+	if (!pool->dead && req_hdl->gen == pool->gen &&
+	    pool->nr_free < pool->max) {
+		list_add(&hdl->requests_queued, &pool->free);
+		pool->nr_free++;
+		recycled = true;
+	}
+	mutex_unlock(&pool->lock);
+
+	return recycled;
+}
+
 static void v4l2_ctrl_request_release(struct media_request_object *obj)
 {
 	struct v4l2_ctrl_handler *hdl =
 		container_of(obj, struct v4l2_ctrl_handler, req_obj);
+	struct v4l2_ctrl_request_pool *pool = to_request_hdl(hdl)->pool;
 
-	v4l2_ctrl_handler_free(hdl);
-	kfree(hdl);
+	if (!pool || !v4l2_ctrl_request_recycle(hdl))
+		v4l2_ctrl_request_hdl_free(hdl);
+
+	if (pool)
+		kref_put(&pool->ref, v4l2_ctrl_request_pool_release);
 }
 
 static const struct media_request_object_ops req_ops = {
@@ -153,27 +271,138 @@ static int v4l2_ctrl_request_bind(struct media_request *req,
 {
 	int ret;
 
-	ret = v4l2_ctrl_request_clone(hdl, from);
-
+	ret = media_request_object_bind(req, &req_ops,
+					from, false, &hdl->req_obj);
 	if (!ret) {
-		ret = media_request_object_bind(req, &req_ops,
-						from, false, &hdl->req_obj);
-		if (!ret) {
-			mutex_lock(from->lock);
-			list_add_tail(&hdl->requests, &from->requests);
-			mutex_unlock(from->lock);
-		}
+		mutex_lock(from->lock);
+		list_add_tail(&hdl->requests, &from->requests);
+		mutex_unlock(from->lock);
 	}
 	return ret;
 }
 
+/* Allocate a copy of @main_hdl, without binding it to a request */
+static struct v4l2_ctrl_handler *
+v4l2_ctrl_request_hdl_alloc(struct v4l2_ctrl_handler *main_hdl)
+{
+	struct v4l2_ctrl_request_hdl *req_hdl;
+	struct v4l2_ctrl_handler *hdl;
+	int ret;
+
+	req_hdl = kzalloc(sizeof(*req_hdl), GFP_KERNEL);
+	if (!req_hdl)
+		return ERR_PTR(-ENOMEM);
+
+	hdl = &req_hdl->hdl;
+	ret = v4l2_ctrl_handler_init(hdl, (main_hdl->nr_of_buckets - 1) * 8);
+	if (!ret)
+		ret = v4l2_ctrl_request_clone(hdl, main_hdl);
+	if (ret) {
+		v4l2_ctrl_request_hdl_free(hdl);
+		return ERR_PTR(ret);
+	}
+
+	return hdl;
+}
+
+/*
+ * Get a copy of @main_hdl bound to @req, from the pool of the main handler
+ * if it has one with a handler to spare.
+ */
+static struct v4l2_ctrl_handler *
+v4l2_ctrl_request_hdl_new(struct media_request *req,
+			  struct v4l2_ctrl_handler *main_hdl)
+{
+	struct v4l2_ctrl_request_pool *pool = main_hdl->req_pool;
+	struct v4l2_ctrl_handler *hdl = NULL;
+	unsigned int gen = 0;
+	int ret;
+
+	if (pool) {
+		mutex_lock(&pool->lock);
+		hdl = list_first_entry_or_null(&pool->free,
+					       struct v4l2_ctrl_handler,
+					       requests_queued);
+		if (hdl) {
+			list_del_init(&hdl->requests_queued);
+			pool->nr_free--;
+		}
+		gen = pool->gen;
+		kref_get(&pool->ref);
+		mutex_unlock(&pool->lock);
+	}
+
+	if (hdl) {
+		media_request_object_init(&hdl->req_obj);
+	} else {
+		hdl = v4l2_ctrl_request_hdl_alloc(main_hdl);
+		if (IS_ERR(hdl)) {
+			if (pool)
+				kref_put(&pool->ref, v4l2_ctrl_request_pool_release);
+			return hdl;
+		}
+	}
+
+	to_request_hdl(hdl)->pool = pool;
+	to_request_hdl(hdl)->gen = gen;
+
+	ret = v4l2_ctrl_request_bind(req, hdl, main_hdl);
+	if (ret) {
+		to_request_hdl(hdl)->pool = NULL;
+		v4l2_ctrl_request_hdl_free(hdl);
+		if (pool)
+			kref_put(&pool->ref, v4l2_ctrl_request_pool_release);
+		return ERR_PTR(ret);
+	}
+
+	return hdl;
+}
+
+int v4l2_ctrl_request_pool_init(struct v4l2_ctrl_handler *hdl,
+				unsigned int slots)
+{
+	struct v4l2_ctrl_request_pool *pool;
+	struct v4l2_ctrl_handler *req_hdl;
+	unsigned int i;
+
+	if (WARN_ON(hdl->req_obj.ops || hdl->req_pool))
+		return -EINVAL;
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return -ENOMEM;
+
+	kref_init(&pool->ref);
+	mutex_init(&pool->lock);
+	INIT_LIST_HEAD(&pool->free);
+	pool->max = slots;
+
+	for (i = 0; i < slots; i++) {
+		req_hdl = v4l2_ctrl_request_hdl_alloc(hdl);
+		if (IS_ERR(req_hdl)) {
+			v4l2_ctrl_request_pool_drain(pool, true);
+			kref_put(&pool->ref, v4l2_ctrl_request_pool_release);
+			return PTR_ERR(req_hdl);
+		}
+
+		/* Not a main handler, even before it is first bound */
+		req_hdl->req_obj.ops = &req_ops;
+		list_add(&req_hdl->requests_queued, &pool->free);
+		pool->nr_free++;
+	}
+
+	hdl->req_pool = pool;
+
+	return 0;
+}
+EXPORT_SYMBOL(v4l2_ctrl_request_pool_init);
+
 static struct media_request_object *
 v4l2_ctrls_find_req_obj(struct v4l2_ctrl_handler *hdl,
 			struct media_request *req, bool set)
 {
 	struct media_request_object *obj;
 	struct v4l2_ctrl_handler *new_hdl;
-	int ret;
 
 	if (IS_ERR(req))
 		return ERR_CAST(req);
@@ -198,20 +427,11 @@ v4l2_ctrls_find_req_obj(struct v4l2_ctrl_handler *hdl,
 	if (!set)
 		return ERR_PTR(-ENOMEM);
 
-	new_hdl = kzalloc(sizeof(*new_hdl), GFP_KERNEL);
-	if (!new_hdl)
-		return ERR_PTR(-ENOMEM);
+	new_hdl = v4l2_ctrl_request_hdl_new(req, hdl);
+	if (IS_ERR(new_hdl))
+		return ERR_CAST(new_hdl);
 
 	obj = &new_hdl->req_obj;
-	ret = v4l2_ctrl_handler_init(new_hdl, (hdl->nr_of_buckets - 1) * 8);
-	if (!ret)
-		ret = v4l2_ctrl_request_bind(req, new_hdl, hdl);
-	if (ret) {
-		v4l2_ctrl_handler_free(new_hdl);
-		kfree(new_hdl);
-		return ERR_PTR(ret);
-	}
-
 	media_request_object_get(obj);
 	return obj;
 }
@@ -338,21 +558,11 @@ void v4l2_ctrl_request_complete(struct media_request *req,
 	 */
 	obj = media_request_object_find(req, &req_ops, main_hdl);
 	if (!obj) {
-		int ret;
-
 		/* Create a new request so the driver can return controls */
-		hdl = kzalloc(sizeof(*hdl), GFP_KERNEL);
-		if (!hdl)
+		hdl = v4l2_ctrl_request_hdl_new(req, main_hdl);
+		if (IS_ERR(hdl))
 			return;
 
-		ret = v4l2_ctrl_handler_init(hdl, (main_hdl->nr_of_buckets - 1) * 8);
-		if (!ret)
-			ret = v4l2_ctrl_request_bind(req, hdl, main_hdl);
-		if (ret) {
-			v4l2_ctrl_handler_free(hdl);
-			kfree(hdl);
-			return;
-		}
 		hdl->request_is_queued = true;
 		obj = media_request_object_find(req, &req_ops, main_hdl);
 	}
@@ -368,6 +368,20 @@ static long v4l2_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	return ret;
 }
 
+static int v4l2_uring_cmd(struct io_uring_cmd *ioucmd,
+			  unsigned int issue_flags)
+{
+	struct file *filp = ioucmd->file;
+	struct video_device *vdev = video_devdata(filp);
+
+	if (!vdev->fops->unlocked_ioctl)
+		return -ENOTTY;
+	if (!video_is_registered(vdev))
+		return -ENODEV;
+
+	return video_uring_cmd(filp, ioucmd, issue_flags);
+}
+
 #ifdef CONFIG_MMU
 #define v4l2_get_unmapped_area NULL
 #else
@@ -481,6 +495,7 @@ static const struct file_operations v4l2_fops = {
 #ifdef CONFIG_COMPAT
 	.compat_ioctl = v4l2_compat_ioctl32,
 #endif
+	.uring_cmd = v4l2_uring_cmd,
 	.release = v4l2_release,
 	.poll = v4l2_poll,
 	.llseek = no_llseek,
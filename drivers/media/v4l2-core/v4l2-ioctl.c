@@ -9,6 +9,7 @@
  */
 
 #include <linux/compat.h>
+#include <linux/io_uring.h>
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/slab.h>
@@ -3443,3 +3444,33 @@ long video_ioctl2(struct file *file,
 	return video_usercopy(file, cmd, arg, __video_do_ioctl);
 }
 EXPORT_SYMBOL(video_ioctl2);
+
+int video_uring_cmd(struct file *file, struct io_uring_cmd *ioucmd,
+		    unsigned int issue_flags)
+{
+	struct video_device *vdev = video_devdata(file);
+	const u64 *cmd = io_uring_sqe_cmd(ioucmd->sqe);
+	void __user *arg = u64_to_user_ptr(READ_ONCE(*cmd));
+
+	/*
+	 * Only the buffer queue ioctls, so that a ring can keep a pipeline
+	 * going without a syscall per frame.  The ioctls of compat users
+	 * encode a different size and are refused here.
+	 */
+	switch (ioucmd->cmd_op) {
+	case VIDIOC_QBUF:
+	case VIDIOC_DQBUF:
+		break;
+	default:
+		return -ENOTTY;
+	}
+
+	/* a blocking DQBUF is issued again from io-wq, where it may sleep */
+	if (ioucmd->cmd_op == VIDIOC_DQBUF &&
+	    (issue_flags & IO_URING_F_NONBLOCK) &&
+	    !(file->f_flags & O_NONBLOCK))
+		return -EAGAIN;
+
+	return vdev->fops->unlocked_ioctl(file, ioucmd->cmd_op,
+					  (unsigned long)arg);
+}
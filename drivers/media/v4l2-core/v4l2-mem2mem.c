@@ -84,7 +84,11 @@ static const char * const m2m_entity_name[] = {
  *			v4l2_m2m_unregister_media_controller().
  * @intf_devnode:	&struct media_intf devnode pointer with the interface
  *			with controls the M2M device.
- * @curr_ctx:		currently running instance
+ * @curr_ctx:		currently running instance, when not batching
+ * @max_batch:		maximum number of instances run at once, 0 unless
+ *			set with v4l2_m2m_set_max_batch()
+ * @num_running:	number of instances in the running batch
+ * @batch_done:		wait queue signalled when a batch has finished
  * @job_queue:		instances queued to run
  * @job_spinlock:	protects job_queue
  * @job_work:		worker to run queued jobs.
@@ -93,6 +97,9 @@ static const char * const m2m_entity_name[] = {
  */
 struct v4l2_m2m_dev {
 	struct v4l2_m2m_ctx	*curr_ctx;
+	unsigned int		max_batch;
+	unsigned int		num_running;
+	wait_queue_head_t	batch_done;
 #ifdef CONFIG_MEDIA_CONTROLLER
 	struct media_entity	*source;
 	struct media_pad	source_pad;
@@ -284,6 +291,62 @@ static void v4l2_m2m_try_run(struct v4l2_m2m_dev *m2m_dev)
 	m2m_dev->m2m_ops->device_run(m2m_dev->curr_ctx->priv);
 }
 
+/**
+ * v4l2_m2m_try_run_batch() - run as many queued jobs as possible at once
+ * @m2m_dev: per-device context
+ *
+ * Batching counterpart of v4l2_m2m_try_run(): takes up to max_batch
+ * instances from the head of the waiting jobs list, one job each, and hands
+ * them to .device_run_batch together. An instance is only queued again
+ * when its job has finished, at the tail, so every instance with work gets
+ * a slot in turn, however many buffers the others have ready.
+ */
+static void v4l2_m2m_try_run_batch(struct v4l2_m2m_dev *m2m_dev)
+{
+	void *priv[V4L2_M2M_MAX_BATCH];
+	struct v4l2_m2m_ctx *m2m_ctx;
+	unsigned int num = 0;
+	unsigned long flags;
+
+	spin_lock_irqsave(&m2m_dev->job_spinlock, flags);
+	if (m2m_dev->num_running) {
+		spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
+		dprintk("Another batch is running, won't run now\n");
+		return;
+	}
+
+	if (m2m_dev->job_queue_flags & QUEUE_PAUSED) {
+		spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
+		dprintk("Running new jobs is paused\n");
+		return;
+	}
+
+	list_for_each_entry(m2m_ctx, &m2m_dev->job_queue, queue) {
+		m2m_ctx->job_flags |= TRANS_RUNNING;
+		priv[num++] = m2m_ctx->priv;
+		if (num == m2m_dev->max_batch)
+			break;
+	}
+	m2m_dev->num_running = num;
+	spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
+
+	if (!num) {
+		dprintk("No job pending\n");
+		return;
+	}
+
+	dprintk("Running batch of %u jobs\n", num);
+	m2m_dev->m2m_ops->device_run_batch(priv, num);
+}
+
+static void v4l2_m2m_run(struct v4l2_m2m_dev *m2m_dev)
+{
+	if (m2m_dev->max_batch)
+		v4l2_m2m_try_run_batch(m2m_dev);
+	else
+		v4l2_m2m_try_run(m2m_dev);
+}
+
 /*
  * __v4l2_m2m_try_queue() - queue a job
  * @m2m_dev: m2m device
@@ -388,7 +451,7 @@ void v4l2_m2m_try_schedule(struct v4l2_m2m_ctx *m2m_ctx)
 	struct v4l2_m2m_dev *m2m_dev = m2m_ctx->m2m_dev;
 
 	__v4l2_m2m_try_queue(m2m_dev, m2m_ctx);
-	v4l2_m2m_try_run(m2m_dev);
+	v4l2_m2m_run(m2m_dev);
 }
 EXPORT_SYMBOL_GPL(v4l2_m2m_try_schedule);
 
@@ -401,7 +464,7 @@ static void v4l2_m2m_device_run_work(struct work_struct *work)
 	struct v4l2_m2m_dev *m2m_dev =
 		container_of(work, struct v4l2_m2m_dev, job_work);
 
-	v4l2_m2m_try_run(m2m_dev);
+	v4l2_m2m_run(m2m_dev);
 }
 
 /**
@@ -462,6 +525,16 @@ static void v4l2_m2m_schedule_next_job(struct v4l2_m2m_dev *m2m_dev,
 	schedule_work(&m2m_dev->job_work);
 }
 
+/*
+ * Drop a finished job from the running batch, waking up v4l2_m2m_suspend()
+ * once all are done. Assumes job_spinlock is held.
+ */
+static void v4l2_m2m_batch_job_done(struct v4l2_m2m_dev *m2m_dev)
+{
+	if (!WARN_ON(!m2m_dev->num_running) && !--m2m_dev->num_running)
+		wake_up(&m2m_dev->batch_done);
+}
+
 /*
  * Assumes job_spinlock is held, called from v4l2_m2m_job_finish() or
  * v4l2_m2m_buf_done_and_job_finish().
@@ -469,6 +542,19 @@ static void v4l2_m2m_schedule_next_job(struct v4l2_m2m_dev *m2m_dev,
 static bool _v4l2_m2m_job_finish(struct v4l2_m2m_dev *m2m_dev,
 				 struct v4l2_m2m_ctx *m2m_ctx)
 {
+	if (m2m_dev->max_batch) {
+		if (!(m2m_ctx->job_flags & TRANS_RUNNING)) {
+			dprintk("Called by an instance not currently running\n");
+			return false;
+		}
+
+		list_del(&m2m_ctx->queue);
+		m2m_ctx->job_flags &= ~(TRANS_QUEUED | TRANS_RUNNING);
+		wake_up(&m2m_ctx->finished);
+		v4l2_m2m_batch_job_done(m2m_dev);
+		return true;
+	}
+
 	if (!m2m_dev->curr_ctx || m2m_dev->curr_ctx != m2m_ctx) {
 		dprintk("Called by an instance not currently running\n");
 		return false;
@@ -554,6 +640,8 @@ void v4l2_m2m_suspend(struct v4l2_m2m_dev *m2m_dev)
 	if (curr_ctx)
 		wait_event(curr_ctx->finished,
 			   !(curr_ctx->job_flags & TRANS_RUNNING));
+	else if (m2m_dev->max_batch)
+		wait_event(m2m_dev->batch_done, !READ_ONCE(m2m_dev->num_running));
 }
 EXPORT_SYMBOL(v4l2_m2m_suspend);
 
@@ -565,7 +653,7 @@ void v4l2_m2m_resume(struct v4l2_m2m_dev *m2m_dev)
 	m2m_dev->job_queue_flags &= ~QUEUE_PAUSED;
 	spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
 
-	v4l2_m2m_try_run(m2m_dev);
+	v4l2_m2m_run(m2m_dev);
 }
 EXPORT_SYMBOL(v4l2_m2m_resume);
 
@@ -887,6 +975,10 @@ int v4l2_m2m_streamoff(struct file *file, struct v4l2_m2m_ctx *m2m_ctx,
 	/* We should not be scheduled anymore, since we're dropping a queue. */
 	if (m2m_ctx->job_flags & TRANS_QUEUED)
 		list_del(&m2m_ctx->queue);
+	if (m2m_dev->max_batch && (m2m_ctx->job_flags & TRANS_RUNNING)) {
+		v4l2_m2m_batch_job_done(m2m_dev);
+		wake_up(&m2m_ctx->finished);
+	}
 	m2m_ctx->job_flags = 0;
 
 	spin_lock_irqsave(&q_ctx->rdy_spinlock, flags);
@@ -1195,7 +1287,8 @@ struct v4l2_m2m_dev *v4l2_m2m_init(const struct v4l2_m2m_ops *m2m_ops)
 {
 	struct v4l2_m2m_dev *m2m_dev;
 
-	if (!m2m_ops || WARN_ON(!m2m_ops->device_run))
+	if (!m2m_ops ||
+	    WARN_ON(!m2m_ops->device_run && !m2m_ops->device_run_batch))
 		return ERR_PTR(-EINVAL);
 
 	m2m_dev = kzalloc(sizeof *m2m_dev, GFP_KERNEL);
@@ -1204,14 +1297,30 @@ struct v4l2_m2m_dev *v4l2_m2m_init(const struct v4l2_m2m_ops *m2m_ops)
 
 	m2m_dev->curr_ctx = NULL;
 	m2m_dev->m2m_ops = m2m_ops;
+	if (!m2m_ops->device_run)
+		m2m_dev->max_batch = 1;
 	INIT_LIST_HEAD(&m2m_dev->job_queue);
 	spin_lock_init(&m2m_dev->job_spinlock);
+	init_waitqueue_head(&m2m_dev->batch_done);
 	INIT_WORK(&m2m_dev->job_work, v4l2_m2m_device_run_work);
 
 	return m2m_dev;
 }
 EXPORT_SYMBOL_GPL(v4l2_m2m_init);
 
+int v4l2_m2m_set_max_batch(struct v4l2_m2m_dev *m2m_dev,
+			   unsigned int max_batch)
+{
+	if (WARN_ON(!m2m_dev->m2m_ops->device_run_batch) ||
+	    !max_batch || max_batch > V4L2_M2M_MAX_BATCH)
+		return -EINVAL;
+
+	m2m_dev->max_batch = max_batch;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(v4l2_m2m_set_max_batch);
+
 void v4l2_m2m_release(struct v4l2_m2m_dev *m2m_dev)
 {
 	kfree(m2m_dev);
@@ -3,12 +3,18 @@
 // Copyright (c) 2018, Linaro Limited
 
 #include <linux/completion.h>
+#include <linux/debugfs.h>
 #include <linux/device.h>
 #include <linux/dma-buf.h>
+#include <linux/dma-fence.h>
 #include <linux/dma-mapping.h>
 #include <linux/dma-resv.h>
+#include <linux/eventfd.h>
+#include <linux/file.h>
+#include <linux/hash.h>
 #include <linux/idr.h>
 #include <linux/list.h>
+#include <linux/mm.h>
 #include <linux/miscdevice.h>
 #include <linux/module.h>
 #include <linux/of_address.h>
@@ -16,16 +22,29 @@
 #include <linux/platform_device.h>
 #include <linux/sort.h>
 #include <linux/of_platform.h>
+#include <linux/rbtree.h>
+#include <linux/rcupdate.h>
 #include <linux/rpmsg.h>
 #include <linux/scatterlist.h>
 #include <linux/slab.h>
+#include <linux/smp.h>
+#include <linux/seq_file.h>
+#include <linux/sync_file.h>
+#include <linux/workqueue.h>
+#include <linux/xarray.h>
 #include <linux/delay.h>
 #include <linux/firmware/qcom/qcom_scm.h>
 #include <uapi/misc/fastrpc.h>
 #include <linux/of_reserved_mem.h>
 #include <linux/soc/qcom/pdr.h>
 
+#define CREATE_TRACE_POINTS
+#include "trace-fastrpc.h"
+
 #define FASTRPC_IOCTL_INVOKEV2		_IOWR('R', 14, struct fastrpc_invoke_v2)
+#define FASTRPC_IOCTL_INVOKE_BATCH	_IOWR('R', 15, struct fastrpc_invoke_batch)
+#define FASTRPC_IOCTL_INVOKE_ASYNC	_IOWR('R', 16, struct fastrpc_invoke_async)
+#define FASTRPC_IOCTL_ASYNC_RESPONSE	_IOWR('R', 17, struct fastrpc_async_response)
 
 #define ADSP_DOMAIN_ID (0)
 #define MDSP_DOMAIN_ID (1)
@@ -41,6 +60,11 @@
 #define FASTRPC_MAX_CRCLIST	64
 #define FASTRPC_PHYS(p)	((p) & 0xffffffff)
 #define FASTRPC_CTX_MAX (256)
+#define FASTRPC_MAX_BATCH	(64)
+#define FASTRPC_ARG_BUF_SIZE	(4 * PAGE_SIZE)
+#define FASTRPC_ARG_BUF_COUNT	(8)
+/* Pinned user buffers kept mapped per session for reuse */
+#define FASTRPC_PIN_CACHE_SIZE	(8)
 #define FASTRPC_INIT_HANDLE	1
 #define FASTRPC_DSP_UTILITIES_HANDLE	2
 #define FASTRPC_MAX_STATIC_HANDLE (20)
@@ -135,6 +159,59 @@
 #define FASTRPC_POLL_RESPONSE (0xdecaf)
 /* timeout in us for polling until memory barrier */
 #define FASTRPC_POLL_TIME_MEM_UPDATE (500)
+/* Handles per process whose response latency is tracked for adaptive poll */
+#define FASTRPC_LAT_SLOTS_BITS	(4)
+#define FASTRPC_LAT_SLOTS	(1 << FASTRPC_LAT_SLOTS_BITS)
+/* Window over which the adaptive poll CPU budget is accounted */
+#define FASTRPC_POLL_WINDOW_NS	(100 * NSEC_PER_MSEC)
+
+/* Latency histogram buckets, bucket i counting [2^i, 2^(i+1)) us */
+#define FASTRPC_HIST_BUCKETS	(20)
+/* Remote handles per process that get a latency histogram */
+#define FASTRPC_HIST_MAX_HANDLES	(64)
+/* DMA-bufs of a call reported by the invoke tracepoints */
+#define FASTRPC_TRACE_MAX_DMABUFS	(16)
+
+enum fastrpc_hist_phase {
+	/* kernel-side argument marshalling and unmarshalling */
+	HIST_MARSHAL,
+	/* glink send to response from the DSP */
+	HIST_DSP,
+	/* response from the DSP to the caller running again */
+	HIST_WAKEUP,
+	HIST_PHASE_MAX,
+};
+
+static const char * const hist_phase_names[HIST_PHASE_MAX] = {
+	"marshal", "dsp", "wakeup",
+};
+
+static struct dentry *fastrpc_debugfs_root;
+
+static bool steer_replies;
+module_param(steer_replies, bool, 0644);
+MODULE_PARM_DESC(steer_replies,
+		 "Complete synchronous calls on the CPU that sent them");
+
+static unsigned int zero_copy_threshold;
+module_param(zero_copy_threshold, uint, 0644);
+MODULE_PARM_DESC(zero_copy_threshold,
+		 "Size from which plain user buffers are pinned and mapped instead of copied, 0 to always copy");
+
+static bool adaptive_poll;
+module_param(adaptive_poll, bool, 0644);
+MODULE_PARM_DESC(adaptive_poll,
+		 "Poll for responses of calls that are expected to complete quickly");
+
+static unsigned int adaptive_poll_max_us = 100;
+module_param(adaptive_poll_max_us, uint, 0644);
+MODULE_PARM_DESC(adaptive_poll_max_us,
+		 "Longest typical latency, in us, of a call that is polled for");
+
+static unsigned int adaptive_poll_budget = 25;
+module_param(adaptive_poll_budget, uint, 0644);
+MODULE_PARM_DESC(adaptive_poll_budget,
+		 "Share of CPU time, in percent, a process may spend polling");
 
 /* Response types supported for RPC calls */
 enum fastrpc_response_flags {
@@ -156,6 +233,41 @@ struct fastrpc_invoke_v2 {
 	__u32 reserved[18];
 };
 
+/* Keep running the remaining entries of a batch after one of them fails */
+#define FASTRPC_BATCH_CONTINUE_ON_ERROR	(1 << 0)
+#define FASTRPC_BATCH_FLAGS_MASK	(FASTRPC_BATCH_CONTINUE_ON_ERROR)
+
+struct fastrpc_invoke_batch {
+	__u64 invokes;		/* array of struct fastrpc_invoke_v2 */
+	__u64 status;		/* [out] array of __s32, one per entry */
+	__u32 count;		/* number of entries, at most FASTRPC_MAX_BATCH */
+	__u32 flags;		/* FASTRPC_BATCH_* flags */
+	__u32 reserved[4];
+};
+
+/* Return a sync_file fd that signals when the async invocation completes */
+#define FASTRPC_ASYNC_FENCE		(1 << 0)
+#define FASTRPC_ASYNC_FLAGS_MASK	(FASTRPC_ASYNC_FENCE)
+
+struct fastrpc_invoke_async {
+	__u64 invoke;		/* pointer to struct fastrpc_invoke_v2 */
+	__s32 eventfd;		/* eventfd signalled on completion, or -1 */
+	__s32 fence_fd;		/* [out] sync_file fd, with FASTRPC_ASYNC_FENCE */
+	__u32 flags;		/* FASTRPC_ASYNC_* flags */
+	__u32 reserved;
+	__u64 jobid;		/* [out] token for FASTRPC_IOCTL_ASYNC_RESPONSE */
+};
+
+/* Fail with -EAGAIN instead of waiting for the job to complete */
+#define FASTRPC_ASYNC_NONBLOCK		(1 << 0)
+
+struct fastrpc_async_response {
+	__u64 jobid;		/* job to collect, or 0 for any completed job */
+	__s32 result;		/* [out] return value of the invocation */
+	__u32 flags;		/* FASTRPC_ASYNC_NONBLOCK */
+	__u32 reserved[4];
+};
+
 struct fastrpc_phy_page {
 	u64 addr;		/* physical address */
 	u64 size;		/* size of contiguous region */
@@ -262,8 +374,22 @@ struct fastrpc_dma_buf_attachment {
 	struct list_head node;
 };
 
+/* User pages of a plain buffer argument, pinned and mapped on the session */
+struct fastrpc_pin {
+	struct list_head node;
+	struct mm_struct *mm;
+	u64 uaddr;
+	unsigned int npages;
+	struct page **pages;
+	struct sg_table sgt;
+	u64 iova;
+};
+
 struct fastrpc_map {
 	struct list_head node;
+	/* indexed by (fd, va) and, once mapped on the DSP, by raddr */
+	struct rb_node fd_node;
+	struct rb_node raddr_node;
 	struct fastrpc_user *fl;
 	int fd;
 	struct dma_buf *buf;
@@ -288,6 +414,15 @@ struct fastrpc_perf {
 	u64 putargs;
 	u64 invargs;
 	u64 invoke;
+	u64 argbuf_inuse;
+	u64 argbuf_fallback;
+};
+
+/* A producer fence the deferred send of an async invocation waits for */
+struct fastrpc_fence_dep {
+	struct dma_fence_cb cb;
+	struct dma_fence *fence;
+	struct fastrpc_invoke_ctx *ctx;
 };
 
 struct fastrpc_invoke_ctx {
@@ -304,6 +439,33 @@ struct fastrpc_invoke_ctx {
 	u64 msg_sz;
 	/* Threads poll for specified timeout and fall back to glink wait */
 	u64 poll_timeout;
+	/* time spent polling for the response */
+	u64 poll_ns;
+	/* CPU the call was sent from, where replies are steered to */
+	int cpu;
+	int rsp_retval;
+	call_single_data_t csd;
+	/* the response callback looks contexts up under RCU */
+	struct rcu_head rcu;
+	/* latency accounting */
+	u64 marshal_ns;
+	u64 sent_ns;
+	u64 rsp_ns;
+	/* async invocation state, owned by the submitter until collected */
+	bool is_async;
+	bool async_claimed;
+	u64 jobid;
+	struct mm_struct *mm;
+	struct eventfd_ctx *evfd;
+	struct dma_fence *fence;
+	/* send of an async invocation deferred until @deps signal */
+	u32 handle;
+	bool send_deferred;
+	int send_err;
+	struct fastrpc_fence_dep *deps;
+	int ndeps;
+	atomic_t deps_pending;
+	struct work_struct send_work;
 	/* work done status flag */
 	bool is_work_done;
 	/* response flags from remote processor */
@@ -315,7 +477,11 @@ struct fastrpc_invoke_ctx {
 	struct fastrpc_user *fl;
 	union fastrpc_remote_arg *rpra;
 	struct fastrpc_map **maps;
+	/* pinned plain buffers, allocated when the first one is pinned */
+	struct fastrpc_pin **pins;
 	struct fastrpc_buf *buf;
+	/* @buf belongs to the per-user argument buffer pool */
+	bool buf_pooled;
 	struct fastrpc_invoke_args *args;
 	struct fastrpc_buf_overlap *olaps;
 	struct fastrpc_channel_ctx *cctx;
@@ -371,11 +537,31 @@ struct fastrpc_device {
 	bool secure;
 };
 
+struct fastrpc_handle_lat {
+	u32 handle;
+	/* moving average of the response latency */
+	u64 avg_ns;
+};
+
+struct fastrpc_handle_hist {
+	u32 handle;
+	u64 count;
+	u32 buckets[HIST_PHASE_MAX][FASTRPC_HIST_BUCKETS];
+};
+
 struct fastrpc_user {
 	struct list_head user;
 	struct list_head maps;
 	struct list_head pending;
 	struct list_head mmaps;
+	/* maps indexed for lookup, protected by @lock */
+	struct rb_root maps_by_fd;
+	struct rb_root maps_by_raddr;
+	/* idle pre-allocated argument buffers */
+	struct list_head arg_bufs;
+	/* idle pinned buffers, most recently used first */
+	struct list_head pins;
+	int nr_pins;
 
 	struct fastrpc_channel_ctx *cctx;
 	struct fastrpc_session_ctx *sctx;
@@ -386,6 +572,21 @@ struct fastrpc_user {
 	bool is_secure_dev;
 	bool is_unsigned_pd;
 	char *servloc_name;
+	/* argument buffers allocated and handed out to contexts */
+	int arg_bufs_count;
+	int arg_bufs_inuse;
+	/* adaptive poll state, protected by @lock */
+	struct fastrpc_handle_lat lat[FASTRPC_LAT_SLOTS];
+	u64 poll_window_start;
+	u64 poll_spent_ns;
+	/* async invocations, jobid and claims protected by @lock */
+	wait_queue_head_t async_wq;
+	u64 async_seq;
+	spinlock_t fence_lock;
+	/* per remote handle latency histograms, counts protected by @lock */
+	struct xarray hists;
+	atomic_t nr_hists;
+	struct dentry *debugfs;
 	/* Lock for lists */
 	spinlock_t lock;
 	/* lock for allocations */
@@ -402,7 +603,9 @@ enum fastrpc_perfkeys {
 	PERF_PUTARGS = 6,
 	PERF_INVARGS = 7,
 	PERF_INVOKE = 8,
-	PERF_KEY_MAX = 9,
+	PERF_ARGBUF_INUSE = 9,
+	PERF_ARGBUF_FALLBACK = 10,
+	PERF_KEY_MAX = 11,
 };
 
 #define PERF_END ((void)0)
@@ -480,6 +683,10 @@ static void fastrpc_free_map(struct kref *ref)
 	if (map->fl) {
 		spin_lock(&map->fl->lock);
 		list_del(&map->node);
+		if (!RB_EMPTY_NODE(&map->fd_node))
+			rb_erase(&map->fd_node, &map->fl->maps_by_fd);
+		if (!RB_EMPTY_NODE(&map->raddr_node))
+			rb_erase(&map->raddr_node, &map->fl->maps_by_raddr);
 		spin_unlock(&map->fl->lock);
 		map->fl = NULL;
 	}
@@ -502,17 +709,96 @@ static int fastrpc_map_get(struct fastrpc_map *map)
 }
 
 
+static bool fastrpc_map_fd_less(struct rb_node *a, const struct rb_node *b)
+{
+	struct fastrpc_map *ma = rb_entry(a, struct fastrpc_map, fd_node);
+	const struct fastrpc_map *mb = rb_entry(b, struct fastrpc_map, fd_node);
+
+	if (ma->fd != mb->fd)
+		return ma->fd < mb->fd;
+	return (u64)ma->va < (u64)mb->va;
+}
+
+static bool fastrpc_map_raddr_less(struct rb_node *a, const struct rb_node *b)
+{
+	return rb_entry(a, struct fastrpc_map, raddr_node)->raddr <
+	       rb_entry(b, struct fastrpc_map, raddr_node)->raddr;
+}
+
+static int fastrpc_map_raddr_cmp(const void *key, const struct rb_node *node)
+{
+	u64 raddr = *(const u64 *)key;
+	u64 cur = rb_entry(node, struct fastrpc_map, raddr_node)->raddr;
+
+	if (raddr == cur)
+		return 0;
+	return raddr < cur ? -1 : 1;
+}
+
+/* Record the DSP address of @map; the caller must not hold fl->lock */
+static void fastrpc_map_set_raddr(struct fastrpc_user *fl,
+				  struct fastrpc_map *map, u64 raddr)
+{
+	spin_lock(&fl->lock);
+	if (!RB_EMPTY_NODE(&map->raddr_node)) {
+		rb_erase(&map->raddr_node, &fl->maps_by_raddr);
+		RB_CLEAR_NODE(&map->raddr_node);
+	}
+	map->raddr = raddr;
+	if (raddr)
+		rb_add(&map->raddr_node, &fl->maps_by_raddr,
+		       fastrpc_map_raddr_less);
+	spin_unlock(&fl->lock);
+}
+
+/* Find a map with DSP address @raddr and, unless @fd is negative, fd @fd */
+static struct fastrpc_map *fastrpc_map_find_raddr(struct fastrpc_user *fl,
+						  int fd, u64 raddr)
+{
+	struct fastrpc_map *map;
+	struct rb_node *node;
+
+	lockdep_assert_held(&fl->lock);
+
+	node = rb_find_first(&raddr, &fl->maps_by_raddr, fastrpc_map_raddr_cmp);
+	for (; node; node = rb_next(node)) {
+		map = rb_entry(node, struct fastrpc_map, raddr_node);
+		if (map->raddr != raddr)
+			break;
+		if (fd < 0 || map->fd == fd)
+			return map;
+	}
+
+	return NULL;
+}
+
 static int fastrpc_map_lookup(struct fastrpc_user *fl, int fd,
 			u64 va, u64 len, struct fastrpc_map **ppmap, bool take_ref)
 {
 	struct fastrpc_session_ctx *sess = fl->sctx;
-	struct fastrpc_map *map = NULL;
+	struct fastrpc_map *map = NULL, *floor = NULL;
+	struct rb_node *node;
 	int ret = -ENOENT;
 
 	spin_lock(&fl->lock);
-	list_for_each_entry(map, &fl->maps, node) {
-		if (map->fd != fd || va < (u64)map->va ||
-				va + len > (u64)map->va + map->size)
+	/* find the map with the highest va not above @va for this fd */
+	node = fl->maps_by_fd.rb_node;
+	while (node) {
+		map = rb_entry(node, struct fastrpc_map, fd_node);
+		if (map->fd < fd || (map->fd == fd && (u64)map->va <= va)) {
+			floor = map;
+			node = node->rb_right;
+		} else {
+			node = node->rb_left;
+		}
+	}
+
+	/* maps of one fd may overlap, so walk down to lower addresses */
+	for (node = floor ? &floor->fd_node : NULL; node; node = rb_prev(node)) {
+		map = rb_entry(node, struct fastrpc_map, fd_node);
+		if (map->fd != fd)
+			break;
+		if (va + len > (u64)map->va + map->size)
 			continue;
 
 		if (take_ref) {
@@ -615,6 +901,204 @@ static int fastrpc_remote_heap_alloc(struct fastrpc_user *fl, struct device *dev
 	return  __fastrpc_buf_alloc(fl, rdev, size, obuf);
 }
 
+/*
+ * Every user keeps up to FASTRPC_ARG_BUF_COUNT argument buffers of
+ * FASTRPC_ARG_BUF_SIZE bytes that stay allocated and mapped on the session
+ * device for the lifetime of the file, so that an invocation with small
+ * inline arguments needs no allocation or mapping. Buffers are created on
+ * demand and returned to the pool when their context is freed. Payloads
+ * that do not fit, or that find every buffer in use, fall back to a buffer
+ * of their own.
+ */
+static int fastrpc_arg_buf_get(struct fastrpc_invoke_ctx *ctx, u64 size)
+{
+	struct fastrpc_user *fl = ctx->fl;
+	struct fastrpc_buf *buf = NULL;
+	bool grow = false;
+	u64 *counter;
+	int inuse = 0;
+	int err;
+
+	if (size <= FASTRPC_ARG_BUF_SIZE) {
+		spin_lock(&fl->lock);
+		buf = list_first_entry_or_null(&fl->arg_bufs, struct fastrpc_buf, node);
+		if (buf) {
+			list_del_init(&buf->node);
+			fl->arg_bufs_inuse++;
+		} else if (fl->arg_bufs_count < FASTRPC_ARG_BUF_COUNT) {
+			/* reserve the slot, the buffer is allocated below */
+			fl->arg_bufs_count++;
+			fl->arg_bufs_inuse++;
+			grow = true;
+		}
+		inuse = fl->arg_bufs_inuse;
+		spin_unlock(&fl->lock);
+	}
+
+	if (grow) {
+		err = fastrpc_buf_alloc(fl, fl->sctx->dev, FASTRPC_ARG_BUF_SIZE, &buf);
+		if (err) {
+			spin_lock(&fl->lock);
+			fl->arg_bufs_count--;
+			fl->arg_bufs_inuse--;
+			spin_unlock(&fl->lock);
+			buf = NULL;
+		}
+	}
+
+	if (buf) {
+		ctx->buf = buf;
+		ctx->buf_pooled = true;
+		counter = GET_COUNTER((u64 *)ctx->perf, PERF_ARGBUF_INUSE);
+		if (counter)
+			*counter = inuse;
+		return 0;
+	}
+
+	counter = GET_COUNTER((u64 *)ctx->perf, PERF_ARGBUF_FALLBACK);
+	if (counter)
+		(*counter)++;
+
+	return fastrpc_buf_alloc(fl, fl->sctx->dev, size, &ctx->buf);
+}
+
+static void fastrpc_arg_buf_put(struct fastrpc_invoke_ctx *ctx)
+{
+	struct fastrpc_user *fl = ctx->fl;
+
+	if (!ctx->buf_pooled) {
+		fastrpc_buf_free(ctx->buf);
+		return;
+	}
+
+	spin_lock(&fl->lock);
+	list_add(&ctx->buf->node, &fl->arg_bufs);
+	fl->arg_bufs_inuse--;
+	spin_unlock(&fl->lock);
+}
+
+static void fastrpc_pin_free(struct fastrpc_user *fl, struct fastrpc_pin *pin)
+{
+	mutex_lock(&fl->sctx->map_mutex);
+	if (fl->sctx->dev)
+		dma_unmap_sgtable(fl->sctx->dev, &pin->sgt, DMA_BIDIRECTIONAL, 0);
+	mutex_unlock(&fl->sctx->map_mutex);
+	sg_free_table(&pin->sgt);
+	unpin_user_pages(pin->pages, pin->npages);
+	kvfree(pin->pages);
+	kfree(pin);
+}
+
+/* Return @pin to the session cache, evicting the least recently used one */
+static void fastrpc_pin_put(struct fastrpc_user *fl, struct fastrpc_pin *pin)
+{
+	struct fastrpc_pin *evict = NULL;
+
+	spin_lock(&fl->lock);
+	list_add(&pin->node, &fl->pins);
+	if (++fl->nr_pins > FASTRPC_PIN_CACHE_SIZE) {
+		evict = list_last_entry(&fl->pins, struct fastrpc_pin, node);
+		list_del(&evict->node);
+		fl->nr_pins--;
+	}
+	spin_unlock(&fl->lock);
+
+	if (evict)
+		fastrpc_pin_free(fl, evict);
+}
+
+/*
+ * Pin the user pages behind [@ptr, @ptr + @len) and map them as one range
+ * on the session device. A cached mapping is reused only if the range is
+ * still backed by the very same pages, which the fresh pin tells us, so
+ * that memory remapped by userspace is never exposed to the DSP.
+ */
+static struct fastrpc_pin *fastrpc_pin_get(struct fastrpc_user *fl, u64 ptr, u64 len)
+{
+	struct device *dev = fl->sctx->dev;
+	u64 uaddr = ptr & PAGE_MASK;
+	unsigned int npages = (PAGE_ALIGN(ptr + len) - uaddr) >> PAGE_SHIFT;
+	struct fastrpc_pin *pin, *iter;
+	struct page **pages;
+	int pinned, err;
+
+	pages = kvmalloc_array(npages, sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		return NULL;
+
+	pinned = pin_user_pages_fast(uaddr, npages, FOLL_WRITE | FOLL_LONGTERM, pages);
+	if (pinned != npages) {
+		if (pinned > 0)
+			unpin_user_pages(pages, pinned);
+		kvfree(pages);
+		return NULL;
+	}
+
+	pin = NULL;
+	spin_lock(&fl->lock);
+	list_for_each_entry(iter, &fl->pins, node) {
+		if (iter->mm == current->mm && iter->uaddr == uaddr &&
+		    iter->npages == npages &&
+		    !memcmp(iter->pages, pages, npages * sizeof(*pages))) {
+			list_del(&iter->node);
+			fl->nr_pins--;
+			pin = iter;
+			break;
+		}
+	}
+	spin_unlock(&fl->lock);
+
+	if (pin) {
+		unpin_user_pages(pages, npages);
+		kvfree(pages);
+		mutex_lock(&fl->sctx->map_mutex);
+		if (fl->sctx->dev)
+			dma_sync_sgtable_for_device(dev, &pin->sgt, DMA_BIDIRECTIONAL);
+		mutex_unlock(&fl->sctx->map_mutex);
+		return pin;
+	}
+
+	pin = kzalloc(sizeof(*pin), GFP_KERNEL);
+	if (!pin)
+		goto err_unpin;
+
+	pin->mm = current->mm;
+	pin->uaddr = uaddr;
+	pin->npages = npages;
+	pin->pages = pages;
+	err = sg_alloc_table_from_pages(&pin->sgt, pages, npages, 0,
+					(u64)npages << PAGE_SHIFT, GFP_KERNEL);
+	if (err)
+		goto err_free;
+
+	mutex_lock(&fl->sctx->map_mutex);
+	err = fl->sctx->dev ? dma_map_sgtable(dev, &pin->sgt, DMA_BIDIRECTIONAL, 0) : -ENODEV;
+	mutex_unlock(&fl->sctx->map_mutex);
+	if (err)
+		goto err_table;
+
+	/* the DSP takes a single range per argument */
+	if (pin->sgt.nents != 1) {
+		fastrpc_pin_free(fl, pin);
+		return NULL;
+	}
+
+	pin->iova = sg_dma_address(pin->sgt.sgl);
+	if (fl->sctx->sid)
+		pin->iova += ((u64)fl->sctx->sid << 32);
+
+	return pin;
+
+err_table:
+	sg_free_table(&pin->sgt);
+err_free:
+	kfree(pin);
+err_unpin:
+	unpin_user_pages(pages, npages);
+	kvfree(pages);
+	return NULL;
+}
+
 static void fastrpc_channel_ctx_free(struct kref *ref)
 {
 	struct fastrpc_channel_ctx *cctx;
@@ -650,8 +1134,32 @@ static void fastrpc_context_free(struct kref *ref)
 	for (i = 0; i < ctx->nbufs; i++)
 		fastrpc_map_put(ctx->maps[i]);
 
+	if (ctx->pins) {
+		for (i = 0; i < ctx->nbufs; i++) {
+			if (ctx->pins[i])
+				fastrpc_pin_put(ctx->fl, ctx->pins[i]);
+		}
+		kfree(ctx->pins);
+	}
+
 	if (ctx->buf)
-		fastrpc_buf_free(ctx->buf);
+		fastrpc_arg_buf_put(ctx);
+
+	if (ctx->fence) {
+		if (!dma_fence_is_signaled(ctx->fence)) {
+			dma_fence_set_error(ctx->fence, -ECANCELED);
+			dma_fence_signal(ctx->fence);
+		}
+		dma_fence_put(ctx->fence);
+	}
+	if (ctx->evfd)
+		eventfd_ctx_put(ctx->evfd);
+	for (i = 0; i < ctx->ndeps; i++)
+		dma_fence_put(ctx->deps[i].fence);
+	kfree(ctx->deps);
+	/* async submitters hand their copy of the arguments to the context */
+	if (ctx->is_async)
+		kfree(ctx->args);
 
 	spin_lock_irqsave(&cctx->lock, flags);
 	idr_remove(&cctx->ctx_idr, ctx->ctxid >> 16);
@@ -660,7 +1168,7 @@ static void fastrpc_context_free(struct kref *ref)
 	kfree(ctx->perf);
 	kfree(ctx->maps);
 	kfree(ctx->olaps);
-	kfree(ctx);
+	kfree_rcu(ctx, rcu);
 
 	fastrpc_channel_ctx_put(cctx);
 }
@@ -670,6 +1178,40 @@ static void fastrpc_context_put(struct fastrpc_invoke_ctx *ctx)
 	kref_put(&ctx->refcount, fastrpc_context_free);
 }
 
+/*
+ * Report completion of @ctx with @retval. The waiter may free @ctx as soon
+ * as ctx->work is completed, so nothing in @ctx is touched after that.
+ */
+static void fastrpc_context_complete(struct fastrpc_invoke_ctx *ctx, int retval)
+{
+	struct fastrpc_user *fl = ctx->fl;
+	bool is_async = ctx->is_async;
+
+	ctx->retval = retval;
+	ctx->rsp_ns = ktime_get_ns();
+	if (is_async) {
+		if (ctx->fence) {
+			if (retval)
+				dma_fence_set_error(ctx->fence, -EIO);
+			dma_fence_signal(ctx->fence);
+		}
+		if (ctx->evfd)
+			eventfd_signal(ctx->evfd, 1);
+	}
+	ctx->is_work_done = true;
+	complete(&ctx->work);
+
+	if (is_async)
+		wake_up(&fl->async_wq);
+}
+
+static void fastrpc_steered_complete(void *info)
+{
+	struct fastrpc_invoke_ctx *ctx = info;
+
+	fastrpc_context_complete(ctx, ctx->rsp_retval);
+}
+
 #define CMP(aa, bb) ((aa) == (bb) ? 0 : (aa) < (bb) ? -1 : 1)
 static int olaps_cmp(const void *a, const void *b)
 {
@@ -778,6 +1320,7 @@ static struct fastrpc_invoke_ctx *fastrpc_context_alloc(
 	ctx->rsp_flags = NORMAL_RESPONSE;
 	ctx->is_work_done = false;
 	init_completion(&ctx->work);
+	INIT_CSD(&ctx->csd, fastrpc_steered_complete, ctx);
 
 	spin_lock(&user->lock);
 	list_add_tail(&ctx->node, &user->pending);
@@ -931,6 +1474,8 @@ static int fastrpc_map_create(struct fastrpc_user *fl, int fd,
 		return -ENOMEM;
 
 	INIT_LIST_HEAD(&map->node);
+	RB_CLEAR_NODE(&map->fd_node);
+	RB_CLEAR_NODE(&map->raddr_node);
 	kref_init(&map->refcount);
 
 	map->fl = fl;
@@ -1005,6 +1550,7 @@ static int fastrpc_map_create(struct fastrpc_user *fl, int fd,
 	}
 	spin_lock(&fl->lock);
 	list_add_tail(&map->node, &fl->maps);
+	rb_add(&map->fd_node, &fl->maps_by_fd, fastrpc_map_fd_less);
 	spin_unlock(&fl->lock);
 	*ppmap = map;
 
@@ -1070,6 +1616,9 @@ static u64 fastrpc_get_payload_size(struct fastrpc_invoke_ctx *ctx, int metalen)
 	for (oix = 0; oix < ctx->nbufs; oix++) {
 		int i = ctx->olaps[oix].raix;
 
+		if (ctx->pins && ctx->pins[i])
+			continue;
+
 		if (ctx->args[i].fd == 0 || ctx->args[i].fd == -1) {
 
 			if (ctx->olaps[oix].offset == 0)
@@ -1118,6 +1667,42 @@ static struct fastrpc_phy_page *fastrpc_phy_page_start(struct fastrpc_invoke_buf
 	return (struct fastrpc_phy_page *)(&buf[len]);
 }
 
+/*
+ * Pin plain user buffers of at least zero_copy_threshold bytes instead of
+ * copying them into the payload. Buffers overlapping another argument share
+ * payload space with it and keep being copied, as does anything that cannot
+ * be pinned or mapped as a single range.
+ */
+static void fastrpc_pin_args(struct fastrpc_invoke_ctx *ctx, u32 kernel)
+{
+	unsigned int threshold = READ_ONCE(zero_copy_threshold);
+	struct fastrpc_buf_overlap *olap;
+	int oix, i;
+
+	if (kernel || !threshold)
+		return;
+
+	for (oix = 0; oix < ctx->nbufs; oix++) {
+		olap = &ctx->olaps[oix];
+		i = olap->raix;
+
+		if ((ctx->args[i].fd != 0 && ctx->args[i].fd != -1) ||
+		    ctx->args[i].length < threshold)
+			continue;
+		if (olap->offset || olap->mstart != olap->start ||
+		    (oix + 1 < ctx->nbufs && ctx->olaps[oix + 1].start < olap->end))
+			continue;
+
+		if (!ctx->pins) {
+			ctx->pins = kcalloc(ctx->nbufs, sizeof(*ctx->pins), GFP_KERNEL);
+			if (!ctx->pins)
+				return;
+		}
+		ctx->pins[i] = fastrpc_pin_get(ctx->fl, ctx->args[i].ptr,
+					       ctx->args[i].length);
+	}
+}
+
 static int fastrpc_get_args(u32 kernel, struct fastrpc_invoke_ctx *ctx)
 {
 	struct device *dev = ctx->fl->sctx->dev;
@@ -1132,6 +1717,10 @@ static int fastrpc_get_args(u32 kernel, struct fastrpc_invoke_ctx *ctx)
 
 	inbufs = REMOTE_SCALARS_INBUFS(ctx->sc);
 	metalen = fastrpc_get_meta_size(ctx);
+
+	PERF(ctx->perf_kernel, GET_COUNTER((u64 *)ctx->perf, PERF_MAP),
+	fastrpc_pin_args(ctx, kernel);
+	PERF_END);
 	pkt_size = fastrpc_get_payload_size(ctx, metalen);
 
 	PERF(ctx->perf_kernel, GET_COUNTER((u64 *)ctx->perf, PERF_MAP),
@@ -1142,7 +1731,7 @@ static int fastrpc_get_args(u32 kernel, struct fastrpc_invoke_ctx *ctx)
 
 	ctx->msg_sz = pkt_size;
 
-	err = fastrpc_buf_alloc(ctx->fl, dev, pkt_size, &ctx->buf);
+	err = fastrpc_arg_buf_get(ctx, pkt_size);
 	if (err)
 		return err;
 
@@ -1187,6 +1776,10 @@ static int fastrpc_get_args(u32 kernel, struct fastrpc_invoke_ctx *ctx)
 				  PAGE_SHIFT;
 			pages[i].size = (pg_end - pg_start + 1) * PAGE_SIZE;
 			PERF_END);
+		} else if (ctx->pins && ctx->pins[i]) {
+			rpra[i].buf.pv = (u64) ctx->args[i].ptr;
+			pages[i].addr = ctx->pins[i]->iova;
+			pages[i].size = (u64)ctx->pins[i]->npages << PAGE_SHIFT;
 		} else {
 			PERF(ctx->perf_kernel, GET_COUNTER((u64 *)ctx->perf, PERF_COPY),
 			if (ctx->olaps[oix].offset == 0) {
@@ -1213,7 +1806,7 @@ static int fastrpc_get_args(u32 kernel, struct fastrpc_invoke_ctx *ctx)
 			PERF_END);
 		}
 
-		if (i < inbufs && !ctx->maps[i]) {
+		if (i < inbufs && !ctx->maps[i] && !(ctx->pins && ctx->pins[i])) {
 			void *dst = (void *)(uintptr_t)rpra[i].buf.pv;
 			void *src = (void *)(uintptr_t)ctx->args[i].ptr;
 
@@ -1273,7 +1866,14 @@ static int fastrpc_put_args(struct fastrpc_invoke_ctx *ctx,
 	perf_dsp_list = (u64 *)(poll + 1);
 
 	for (i = inbufs; i < ctx->nbufs; ++i) {
-		if (!ctx->maps[i]) {
+		if (ctx->pins && ctx->pins[i]) {
+			/* the DSP wrote straight into the user pages */
+			mutex_lock(&fl->sctx->map_mutex);
+			if (fl->sctx->dev)
+				dma_sync_sgtable_for_cpu(fl->sctx->dev, &ctx->pins[i]->sgt,
+							 DMA_BIDIRECTIONAL);
+			mutex_unlock(&fl->sctx->map_mutex);
+		} else if (!ctx->maps[i]) {
 			void *src = (void *)(uintptr_t)rpra[i].buf.pv;
 			void *dst = (void *)(uintptr_t)ctx->args[i].ptr;
 			u64 len = rpra[i].buf.len;
@@ -1322,7 +1922,7 @@ static int fastrpc_invoke_send(struct fastrpc_session_ctx *sctx,
 
 	cctx = fl->cctx;
 	msg->pid = fl->client_id;
-	msg->tid = current->pid;
+	msg->tid = ctx->pid;
 
 	if (kernel)
 		msg->pid = 0;
@@ -1336,6 +1936,8 @@ static int fastrpc_invoke_send(struct fastrpc_session_ctx *sctx,
 	if (cctx->rpdev == NULL)
 		return -EPIPE;
 
+	ctx->sent_ns = ktime_get_ns();
+	ctx->cpu = raw_smp_processor_id();
 	ret = rpmsg_send(cctx->rpdev->ept, (void *)msg, sizeof(*msg));
 
 	return ret;
@@ -1418,10 +2020,16 @@ static int poll_for_remote_response(struct fastrpc_invoke_ctx *ctx, u64 timeout)
 	for (i = 0, j = 0; i < timeout; i++, j++) {
 		if (*poll == FASTRPC_POLL_RESPONSE) {
 			err = 0;
+			ctx->rsp_ns = ktime_get_ns();
 			ctx->is_work_done = true;
 			ctx->retval = 0;
 			break;
 		}
+		/* the response came through glink instead */
+		if (READ_ONCE(ctx->is_work_done)) {
+			err = 0;
+			break;
+		}
 		if (j == FASTRPC_POLL_TIME_MEM_UPDATE) {
 			/* make sure that all poll memory writes by DSP are seen by CPU */
 			dma_rmb();
@@ -1444,36 +2052,372 @@ static inline int fastrpc_wait_for_response(struct fastrpc_invoke_ctx *ctx,
 		err = wait_for_completion_interruptible(&ctx->work);
 	}
 
-	return err;
+	return err;
+}
+
+static int fastrpc_wait_for_completion(struct fastrpc_invoke_ctx *ctx,
+										u32 kernel)
+{
+	int err;
+
+	do {
+		switch (ctx->rsp_flags) {
+		case NORMAL_RESPONSE:
+			err = fastrpc_wait_for_response(ctx, kernel);
+			if (err || ctx->is_work_done)
+				return err;
+			break;
+		case POLL_MODE: {
+			u64 start = ktime_get_ns();
+
+			err = poll_for_remote_response(ctx, ctx->poll_timeout);
+			ctx->poll_ns += ktime_get_ns() - start;
+			/* If polling timed out, move to normal response mode */
+			if (err)
+				ctx->rsp_flags = NORMAL_RESPONSE;
+			break;
+		}
+		default:
+			err = -EBADR;
+			dev_dbg(ctx->fl->sctx->dev,
+				"unsupported response type:0x%x\n", ctx->rsp_flags);
+			break;
+		}
+	} while (!ctx->is_work_done);
+
+	return err;
+}
+
+/*
+ * Buffers the DSP reads must not be written by anyone else while the call
+ * runs, and buffers it writes must not be accessed at all: inputs wait for
+ * the writers of the buffer, outputs and handles for all of its users.
+ */
+static enum dma_resv_usage fastrpc_arg_wait_usage(struct fastrpc_invoke_ctx *ctx, int i)
+{
+	return i < REMOTE_SCALARS_INBUFS(ctx->sc) ? DMA_RESV_USAGE_WRITE :
+						    DMA_RESV_USAGE_READ;
+}
+
+/* Wait for the implicit fences of every dma-buf passed to @ctx */
+static int fastrpc_wait_arg_fences(struct fastrpc_invoke_ctx *ctx)
+{
+	long ret;
+	int i;
+
+	for (i = 0; i < ctx->nscalars; i++) {
+		if (!ctx->maps[i] || !ctx->maps[i]->buf)
+			continue;
+
+		ret = dma_resv_wait_timeout(ctx->maps[i]->buf->resv,
+					    fastrpc_arg_wait_usage(ctx, i), true,
+					    MAX_SCHEDULE_TIMEOUT);
+		/* nothing was sent yet, so there is no call to restart */
+		if (ret < 0)
+			return ret == -ERESTARTSYS ? -EINTR : ret;
+	}
+
+	return 0;
+}
+
+/*
+ * Publish the completion fence of an async invocation on its dma-bufs, so
+ * that later users of a buffer implicitly wait for the DSP: as a reader of
+ * the input buffers and as the writer of everything else.
+ */
+static int fastrpc_attach_arg_fences(struct fastrpc_invoke_ctx *ctx)
+{
+	struct dma_resv *resv;
+	int i, err = 0;
+
+	for (i = 0; i < ctx->nscalars && !err; i++) {
+		if (!ctx->maps[i] || !ctx->maps[i]->buf)
+			continue;
+
+		resv = ctx->maps[i]->buf->resv;
+		dma_resv_lock(resv, NULL);
+		err = dma_resv_reserve_fences(resv, 1);
+		if (!err)
+			dma_resv_add_fence(resv, ctx->fence,
+					   i < REMOTE_SCALARS_INBUFS(ctx->sc) ?
+					   DMA_RESV_USAGE_READ : DMA_RESV_USAGE_WRITE);
+		dma_resv_unlock(resv);
+	}
+
+	return err;
+}
+
+/* Collect the unsignalled implicit fences of the dma-buf arguments */
+static int fastrpc_get_arg_deps(struct fastrpc_invoke_ctx *ctx)
+{
+	struct dma_fence *fence;
+	int i, err;
+
+	for (i = 0; i < ctx->nscalars; i++) {
+		if (!ctx->maps[i] || !ctx->maps[i]->buf)
+			continue;
+
+		err = dma_resv_get_singleton(ctx->maps[i]->buf->resv,
+					     fastrpc_arg_wait_usage(ctx, i), &fence);
+		if (err)
+			return err;
+		if (!fence)
+			continue;
+
+		if (!ctx->deps) {
+			ctx->deps = kcalloc(ctx->nscalars, sizeof(*ctx->deps),
+					    GFP_KERNEL);
+			if (!ctx->deps) {
+				dma_fence_put(fence);
+				return -ENOMEM;
+			}
+		}
+		ctx->deps[ctx->ndeps].fence = fence;
+		ctx->deps[ctx->ndeps].ctx = ctx;
+		ctx->ndeps++;
+	}
+
+	return 0;
+}
+
+static void fastrpc_deferred_send(struct work_struct *work)
+{
+	struct fastrpc_invoke_ctx *ctx = container_of(work, struct fastrpc_invoke_ctx,
+						      send_work);
+	int i, err = 0;
+
+	/* a failed producer fails the job rather than feeding it bad data */
+	for (i = 0; i < ctx->ndeps && !err; i++)
+		err = ctx->deps[i].fence->error;
+
+	if (!err)
+		err = fastrpc_invoke_send(ctx->fl->sctx, ctx, false, ctx->handle);
+	if (err) {
+		ctx->send_err = err;
+		fastrpc_context_complete(ctx, err);
+	}
+
+	/* drop the reference taken when the send was deferred */
+	fastrpc_context_put(ctx);
+}
+
+static void fastrpc_dep_signaled(struct dma_fence *fence, struct dma_fence_cb *cb)
+{
+	struct fastrpc_fence_dep *dep = container_of(cb, struct fastrpc_fence_dep, cb);
+
+	if (atomic_dec_and_test(&dep->ctx->deps_pending))
+		queue_work(system_highpri_wq, &dep->ctx->send_work);
+}
+
+/*
+ * Send @ctx once all of its dependencies have signalled, from a worker if
+ * any of them is still pending. Returns 1 when the send was deferred.
+ */
+static int fastrpc_send_when_ready(struct fastrpc_invoke_ctx *ctx)
+{
+	int i;
+
+	if (!ctx->ndeps)
+		return fastrpc_invoke_send(ctx->fl->sctx, ctx, false, ctx->handle);
+
+	INIT_WORK(&ctx->send_work, fastrpc_deferred_send);
+	/* bias the count so that the worker cannot run before all are added */
+	atomic_set(&ctx->deps_pending, ctx->ndeps + 1);
+	kref_get(&ctx->refcount);
+	ctx->send_deferred = true;
+
+	for (i = 0; i < ctx->ndeps; i++) {
+		if (dma_fence_add_callback(ctx->deps[i].fence, &ctx->deps[i].cb,
+					   fastrpc_dep_signaled))
+			atomic_dec(&ctx->deps_pending);
+	}
+
+	if (!atomic_dec_and_test(&ctx->deps_pending))
+		return 1;
+
+	/* everything signalled while the callbacks were being added */
+	ctx->send_deferred = false;
+	fastrpc_context_put(ctx);
+	for (i = 0; i < ctx->ndeps; i++) {
+		if (ctx->deps[i].fence->error)
+			return ctx->deps[i].fence->error;
+	}
+
+	return fastrpc_invoke_send(ctx->fl->sctx, ctx, false, ctx->handle);
+}
+
+/* Stop a deferred send of @ctx from happening, on release of its file */
+static void fastrpc_cancel_deferred_send(struct fastrpc_invoke_ctx *ctx)
+{
+	bool last = false;
+	int i;
+
+	if (!ctx->send_deferred)
+		return;
+
+	for (i = 0; i < ctx->ndeps; i++) {
+		if (dma_fence_remove_callback(ctx->deps[i].fence, &ctx->deps[i].cb))
+			last |= atomic_dec_and_test(&ctx->deps_pending);
+	}
+
+	/* either no callback queued the worker, or it is cancelled here */
+	if (last || cancel_work_sync(&ctx->send_work))
+		fastrpc_context_put(ctx);
+}
+
+/*
+ * Report the start or the end of a call and the DMA-bufs mapped for its
+ * arguments, so that a trace can follow a buffer through the DSP.
+ */
+static void fastrpc_trace_invoke(struct fastrpc_invoke_ctx *ctx, u32 handle,
+				 bool end)
+{
+	struct fastrpc_user *fl = ctx->fl;
+	u64 dmabufs[FASTRPC_TRACE_MAX_DMABUFS];
+	unsigned int n = 0;
+	int i;
+
+	if (!(end ? trace_fastrpc_invoke_end_enabled() :
+		    trace_fastrpc_invoke_start_enabled()))
+		return;
+
+	for (i = 0; i < ctx->nscalars && n < ARRAY_SIZE(dmabufs); i++) {
+		if (ctx->maps[i] && ctx->maps[i]->buf)
+			dmabufs[n++] = dma_buf_trace_id(ctx->maps[i]->buf);
+	}
+
+	if (end)
+		trace_fastrpc_invoke_end(fl->cctx->domain_id, fl->client_id,
+					 handle, ctx->sc, ctx->ctxid,
+					 ctx->retval, dmabufs, n);
+	else
+		trace_fastrpc_invoke_start(fl->cctx->domain_id, fl->client_id,
+					   handle, ctx->sc, ctx->ctxid, 0,
+					   dmabufs, n);
+}
+
+static unsigned int fastrpc_hist_bucket(u64 ns)
+{
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+
+	return us ? min_t(unsigned int, ilog2(us), FASTRPC_HIST_BUCKETS - 1) : 0;
+}
+
+/*
+ * Account a completed call of @handle to the histograms of @fl and report
+ * it through the fastrpc_invoke_latency tracepoint. Histograms are created
+ * on first use, up to FASTRPC_HIST_MAX_HANDLES per process.
+ */
+static void fastrpc_record_latency(struct fastrpc_invoke_ctx *ctx, u32 handle,
+				   u64 done_ns)
+{
+	struct fastrpc_user *fl = ctx->fl;
+	struct fastrpc_handle_hist *hist, *old;
+	u64 ns[HIST_PHASE_MAX];
+	int i;
+
+	ns[HIST_MARSHAL] = ctx->marshal_ns;
+	ns[HIST_DSP] = ctx->rsp_ns > ctx->sent_ns ? ctx->rsp_ns - ctx->sent_ns : 0;
+	ns[HIST_WAKEUP] = done_ns > ctx->rsp_ns ? done_ns - ctx->rsp_ns : 0;
+
+	trace_fastrpc_invoke_latency(fl->cctx->domain_id, fl->client_id, handle,
+				     ctx->sc, ns[HIST_MARSHAL], ns[HIST_DSP],
+				     ns[HIST_WAKEUP]);
+
+	hist = xa_load(&fl->hists, handle);
+	if (!hist) {
+		if (atomic_read(&fl->nr_hists) >= FASTRPC_HIST_MAX_HANDLES)
+			return;
+
+		hist = kzalloc(sizeof(*hist), GFP_KERNEL);
+		if (!hist)
+			return;
+		hist->handle = handle;
+
+		old = xa_cmpxchg(&fl->hists, handle, NULL, hist, GFP_KERNEL);
+		if (old) {
+			kfree(hist);
+			if (xa_is_err(old))
+				return;
+			hist = old;
+		} else {
+			atomic_inc(&fl->nr_hists);
+		}
+	}
+
+	spin_lock(&fl->lock);
+	hist->count++;
+	for (i = 0; i < HIST_PHASE_MAX; i++)
+		hist->buckets[i][fastrpc_hist_bucket(ns[i])]++;
+	spin_unlock(&fl->lock);
+}
+
+static int fastrpc_hist_show(struct seq_file *s, void *unused)
+{
+	struct fastrpc_user *fl = s->private;
+	struct fastrpc_handle_hist *hist;
+	unsigned long index;
+	int i, j;
+
+	seq_printf(s, "# bucket i counts calls taking [2^i, 2^(i+1)) us, the last one everything above\n");
+	xa_for_each(&fl->hists, index, hist) {
+		seq_printf(s, "handle: 0x%x calls: %llu\n", hist->handle, hist->count);
+		for (i = 0; i < HIST_PHASE_MAX; i++) {
+			seq_printf(s, "  %-8s", hist_phase_names[i]);
+			for (j = 0; j < FASTRPC_HIST_BUCKETS; j++)
+				seq_printf(s, " %u", hist->buckets[i][j]);
+			seq_putc(s, '\n');
+		}
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(fastrpc_hist);
+
+/*
+ * Adaptive poll: when the caller did not ask for a poll timeout, poll for
+ * the response of calls whose average latency on this process is short, and
+ * sleep on everything else. Polling is bounded to twice the average, and a
+ * process stops polling once it has spent adaptive_poll_budget percent of
+ * the current window spinning.
+ */
+static u64 fastrpc_adaptive_poll_timeout(struct fastrpc_user *fl, u32 handle)
+{
+	struct fastrpc_handle_lat *lat = &fl->lat[hash_32(handle, FASTRPC_LAT_SLOTS_BITS)];
+	u64 now = ktime_get_ns(), timeout = 0, avg_us;
+
+	spin_lock(&fl->lock);
+	if (now - fl->poll_window_start > FASTRPC_POLL_WINDOW_NS) {
+		fl->poll_window_start = now;
+		fl->poll_spent_ns = 0;
+	}
+
+	if (lat->handle == handle && lat->avg_ns &&
+	    fl->poll_spent_ns * 100 < FASTRPC_POLL_WINDOW_NS * adaptive_poll_budget) {
+		avg_us = div_u64(lat->avg_ns, NSEC_PER_USEC);
+		if (avg_us <= adaptive_poll_max_us)
+			timeout = clamp_t(u64, 2 * avg_us, 1, adaptive_poll_max_us);
+	}
+	spin_unlock(&fl->lock);
+
+	return timeout;
 }
 
-static int fastrpc_wait_for_completion(struct fastrpc_invoke_ctx *ctx,
-										u32 kernel)
+static void fastrpc_adaptive_poll_update(struct fastrpc_user *fl, u32 handle,
+					 u64 latency_ns, u64 poll_ns)
 {
-	int err;
-
-	do {
-		switch (ctx->rsp_flags) {
-		case NORMAL_RESPONSE:
-			err = fastrpc_wait_for_response(ctx, kernel);
-			if (err || ctx->is_work_done)
-				return err;
-			break;
-		case POLL_MODE:
-			err = poll_for_remote_response(ctx, ctx->poll_timeout);
-			/* If polling timed out, move to normal response mode */
-			if (err)
-				ctx->rsp_flags = NORMAL_RESPONSE;
-			break;
-		default:
-			err = -EBADR;
-			dev_dbg(ctx->fl->sctx->dev,
-				"unsupported response type:0x%x\n", ctx->rsp_flags);
-			break;
-		}
-	} while (!ctx->is_work_done);
+	struct fastrpc_handle_lat *lat = &fl->lat[hash_32(handle, FASTRPC_LAT_SLOTS_BITS)];
 
-	return err;
+	spin_lock(&fl->lock);
+	fl->poll_spent_ns += poll_ns;
+	if (lat->handle != handle || !lat->avg_ns) {
+		lat->handle = handle;
+		lat->avg_ns = latency_ns;
+	} else {
+		/* weight new samples by 1/8 */
+		lat->avg_ns = lat->avg_ns - (lat->avg_ns >> 3) + (latency_ns >> 3);
+	}
+	spin_unlock(&fl->lock);
 }
 
 static int fastrpc_internal_invoke(struct fastrpc_user *fl,
@@ -1484,6 +2428,8 @@ static int fastrpc_internal_invoke(struct fastrpc_user *fl,
 	u32 handle, sc;
 	int err = 0, perferr = 0;
 	struct timespec64 invoket = {0};
+	bool adaptive = false;
+	u64 start;
 
 	if (inv2->perf_kernel)
 		ktime_get_boottime_ts64(&invoket);
@@ -1517,12 +2463,20 @@ static int fastrpc_internal_invoke(struct fastrpc_user *fl,
 			goto bail;
 	}
 
+	start = ktime_get_ns();
 	PERF(ctx->perf_kernel, GET_COUNTER((u64 *)ctx->perf, PERF_GETARGS),
 	err = fastrpc_get_args(kernel, ctx);
 	PERF_END);
+	ctx->marshal_ns = ktime_get_ns() - start;
 	if (err)
 		goto bail;
 
+	err = fastrpc_wait_arg_fences(ctx);
+	if (err)
+		goto bail;
+
+	fastrpc_trace_invoke(ctx, handle, false);
+
 	/* make sure that all CPU memory writes are seen by DSP */
 	dma_wmb();
 	PERF(ctx->perf_kernel, GET_COUNTER((u64 *)ctx->perf, PERF_LINK),
@@ -1532,15 +2486,26 @@ static int fastrpc_internal_invoke(struct fastrpc_user *fl,
 	if (err)
 		goto bail;
 
-	if (ctx->poll_timeout != 0 && handle > FASTRPC_MAX_STATIC_HANDLE &&
+	if (handle > FASTRPC_MAX_STATIC_HANDLE &&
 		fl->cctx->domain_id == CDSP_DOMAIN_ID &&
-		fl->pd == USER_PD)
-		ctx->rsp_flags = POLL_MODE;
+		fl->pd == USER_PD) {
+		if (!ctx->poll_timeout && READ_ONCE(adaptive_poll)) {
+			adaptive = true;
+			ctx->poll_timeout = fastrpc_adaptive_poll_timeout(fl, handle);
+		}
+		if (ctx->poll_timeout != 0)
+			ctx->rsp_flags = POLL_MODE;
+	}
 
 	err = fastrpc_wait_for_completion(ctx, kernel);
 	if (err)
 		goto bail;
 
+	start = ktime_get_ns();
+	if (adaptive && ctx->is_work_done)
+		fastrpc_adaptive_poll_update(fl, handle, start - ctx->sent_ns,
+					     ctx->poll_ns);
+
 	if (!ctx->is_work_done) {
 		err = -ETIMEDOUT;
 		dev_dbg(fl->sctx->dev, "Invalid workdone state for handle 0x%x, sc 0x%x\n",
@@ -1554,9 +2519,13 @@ static int fastrpc_internal_invoke(struct fastrpc_user *fl,
 	/* populate all the output buffers with results */
 	err = fastrpc_put_args(ctx, kernel);
 	PERF_END);
+	ctx->marshal_ns += ktime_get_ns() - start;
 	if (err)
 		goto bail;
 
+	fastrpc_trace_invoke(ctx, handle, true);
+	fastrpc_record_latency(ctx, handle, start);
+
 	/* Check the response from remote dsp */
 	err = ctx->retval;
 	if (err)
@@ -1980,9 +2949,12 @@ static int fastrpc_device_release(struct inode *inode, struct file *file)
 	struct fastrpc_channel_ctx *cctx = fl->cctx;
 	struct fastrpc_invoke_ctx *ctx, *n;
 	struct fastrpc_map *map, *m;
+	struct fastrpc_handle_hist *hist;
 	struct fastrpc_buf *buf, *b;
-	unsigned long flags;
+	struct fastrpc_pin *pin, *p;
+	unsigned long flags, index;
 
+	debugfs_remove(fl->debugfs);
 	fastrpc_release_current_dsp_process(fl);
 
 	spin_lock_irqsave(&cctx->lock, flags);
@@ -1993,6 +2965,7 @@ static int fastrpc_device_release(struct inode *inode, struct file *file)
 		fastrpc_buf_free(fl->init_mem);
 
 	list_for_each_entry_safe(ctx, n, &fl->pending, node) {
+		fastrpc_cancel_deferred_send(ctx);
 		list_del(&ctx->node);
 		fastrpc_context_put(ctx);
 	}
@@ -2005,9 +2978,22 @@ static int fastrpc_device_release(struct inode *inode, struct file *file)
 		fastrpc_buf_free(buf);
 	}
 
+	list_for_each_entry_safe(buf, b, &fl->arg_bufs, node) {
+		list_del(&buf->node);
+		fastrpc_buf_free(buf);
+	}
+
+	list_for_each_entry_safe(pin, p, &fl->pins, node) {
+		list_del(&pin->node);
+		fastrpc_pin_free(fl, pin);
+	}
+
 	fastrpc_session_free(cctx, fl->sctx);
 	fastrpc_channel_ctx_put(cctx);
 
+	xa_for_each(&fl->hists, index, hist)
+		kfree(hist);
+	xa_destroy(&fl->hists);
 	mutex_destroy(&fl->mutex);
 	kfree(fl);
 	file->private_data = NULL;
@@ -2021,6 +3007,7 @@ static int fastrpc_device_open(struct inode *inode, struct file *filp)
 	struct fastrpc_device *fdevice;
 	struct fastrpc_user *fl = NULL;
 	unsigned long flags;
+	char name[32];
 
 	fdevice = miscdev_to_fdevice(filp->private_data);
 	cctx = fdevice->cctx;
@@ -2040,8 +3027,15 @@ static int fastrpc_device_open(struct inode *inode, struct file *filp)
 	mutex_init(&fl->mutex);
 	INIT_LIST_HEAD(&fl->pending);
 	INIT_LIST_HEAD(&fl->maps);
+	fl->maps_by_fd = RB_ROOT;
+	fl->maps_by_raddr = RB_ROOT;
 	INIT_LIST_HEAD(&fl->mmaps);
+	INIT_LIST_HEAD(&fl->arg_bufs);
+	INIT_LIST_HEAD(&fl->pins);
 	INIT_LIST_HEAD(&fl->user);
+	init_waitqueue_head(&fl->async_wq);
+	spin_lock_init(&fl->fence_lock);
+	xa_init(&fl->hists);
 	fl->cctx = cctx;
 	fl->is_secure_dev = fdevice->secure;
 
@@ -2058,6 +3052,11 @@ static int fastrpc_device_open(struct inode *inode, struct file *filp)
 	list_add_tail(&fl->user, &cctx->users);
 	spin_unlock_irqrestore(&cctx->lock, flags);
 
+	snprintf(name, sizeof(name), "%s-%d-%d", domains[cctx->domain_id],
+		 current->tgid, fl->client_id);
+	fl->debugfs = debugfs_create_file(name, 0400, fastrpc_debugfs_root, fl,
+					  &fastrpc_hist_fops);
+
 	return 0;
 }
 
@@ -2191,6 +3190,358 @@ static int fastrpc_invokev2(struct fastrpc_user *fl, char __user *argp)
 	return err;
 }
 
+/*
+ * Run an array of invocations on the session back to back for a single
+ * syscall. Entries are issued in order, each with its own context, so the
+ * crc/perf_kernel/perf_dsp pointers of every entry are honoured exactly as
+ * for FASTRPC_IOCTL_INVOKEV2. The result of each entry is written to the
+ * status array; entries that were not run are reported as -ECANCELED.
+ * A batch that is interrupted by a signal returns -EINTR rather than being
+ * restarted, since restarting would issue the completed entries again.
+ */
+static int fastrpc_invoke_batch(struct fastrpc_user *fl, char __user *argp)
+{
+	struct fastrpc_invoke_batch batch;
+	struct fastrpc_invoke_v2 *invs;
+	s32 *status;
+	u32 i;
+	int err = 0, ret;
+
+	if (copy_from_user(&batch, argp, sizeof(batch)))
+		return -EFAULT;
+
+	if (!batch.count || batch.count > FASTRPC_MAX_BATCH ||
+	    batch.flags & ~FASTRPC_BATCH_FLAGS_MASK ||
+	    memchr_inv(batch.reserved, 0, sizeof(batch.reserved)))
+		return -EINVAL;
+
+	invs = memdup_user((void __user *)(uintptr_t)batch.invokes,
+			   batch.count * sizeof(*invs));
+	if (IS_ERR(invs))
+		return PTR_ERR(invs);
+
+	status = kcalloc(batch.count, sizeof(*status), GFP_KERNEL);
+	if (!status) {
+		err = -ENOMEM;
+		goto free_invs;
+	}
+
+	for (i = 0; i < batch.count; i++)
+		status[i] = -ECANCELED;
+
+	for (i = 0; i < batch.count; i++) {
+		ret = fastrpc_copy_args(&invs[i].inv);
+		if (!ret) {
+			ret = fastrpc_internal_invoke(fl, false, &invs[i]);
+			kfree((void *)(uintptr_t)invs[i].inv.args);
+		}
+
+		if (ret == -ERESTARTSYS)
+			ret = -EINTR;
+		status[i] = ret;
+
+		if (ret && !err)
+			err = ret;
+		if (ret == -EINTR || ret == -ETIMEDOUT ||
+		    (ret && !(batch.flags & FASTRPC_BATCH_CONTINUE_ON_ERROR)))
+			break;
+	}
+
+	if (copy_to_user((void __user *)(uintptr_t)batch.status, status,
+			 batch.count * sizeof(*status)))
+		err = -EFAULT;
+
+	kfree(status);
+free_invs:
+	kfree(invs);
+
+	return err;
+}
+
+static const char *fastrpc_fence_get_driver_name(struct dma_fence *fence)
+{
+	return "fastrpc";
+}
+
+static const char *fastrpc_fence_get_timeline_name(struct dma_fence *fence)
+{
+	return "fastrpc-async";
+}
+
+static const struct dma_fence_ops fastrpc_fence_ops = {
+	.get_driver_name = fastrpc_fence_get_driver_name,
+	.get_timeline_name = fastrpc_fence_get_timeline_name,
+};
+
+/*
+ * Submit an invocation without waiting for it. The arguments are marshalled
+ * and the message is sent as for a synchronous call; completion is reported
+ * through the optional eventfd and sync_file, and the results are copied out
+ * by FASTRPC_IOCTL_ASYNC_RESPONSE, which must be issued from the submitting
+ * process since output buffers live in its address space.
+ */
+static int fastrpc_invoke_async(struct fastrpc_user *fl, char __user *argp)
+{
+	struct fastrpc_invoke_async req;
+	struct fastrpc_invoke_v2 inv2;
+	struct fastrpc_invoke_ctx *ctx;
+	struct eventfd_ctx *evfd = NULL;
+	struct sync_file *sync_file = NULL;
+	int fence_fd = -1;
+	u32 handle;
+	u64 start;
+	int err;
+
+	if (copy_from_user(&req, argp, sizeof(req)))
+		return -EFAULT;
+
+	if (req.flags & ~FASTRPC_ASYNC_FLAGS_MASK || req.reserved)
+		return -EINVAL;
+
+	if (copy_from_user(&inv2, (void __user *)(uintptr_t)req.invoke, sizeof(inv2)))
+		return -EFAULT;
+
+	if (!fl->sctx)
+		return -EINVAL;
+
+	if (!fl->cctx->rpdev)
+		return -EPIPE;
+
+	handle = inv2.inv.handle;
+	if (handle == FASTRPC_INIT_HANDLE) {
+		dev_warn_ratelimited(fl->sctx->dev, "user app trying to send a kernel RPC message (%d)\n",  handle);
+		return -EPERM;
+	}
+
+	if (req.eventfd >= 0) {
+		evfd = eventfd_ctx_fdget(req.eventfd);
+		if (IS_ERR(evfd))
+			return PTR_ERR(evfd);
+	}
+
+	err = fastrpc_copy_args(&inv2.inv);
+	if (err)
+		goto err_args;
+
+	/* async completions are always delivered through glink */
+	inv2.poll_timeout = 0;
+	ctx = fastrpc_context_alloc(fl, false, inv2.inv.sc, &inv2);
+	if (IS_ERR(ctx)) {
+		err = PTR_ERR(ctx);
+		kfree((void *)(uintptr_t)inv2.inv.args);
+		goto err_args;
+	}
+
+	ctx->is_async = true;
+	ctx->args = (struct fastrpc_invoke_args *)(uintptr_t)inv2.inv.args;
+	ctx->mm = current->mm;
+	ctx->evfd = evfd;
+	evfd = NULL;
+
+	ctx->handle = handle;
+
+	spin_lock(&fl->lock);
+	ctx->jobid = ++fl->async_seq;
+	spin_unlock(&fl->lock);
+
+	/*
+	 * The fence also guards the argument dma-bufs. Jobs complete out of
+	 * order, so each fence gets a context of its own: dma_resv would let
+	 * a later fence of a shared context replace an unsignalled one.
+	 */
+	ctx->fence = kzalloc(sizeof(*ctx->fence), GFP_KERNEL);
+	if (!ctx->fence) {
+		err = -ENOMEM;
+		goto bail;
+	}
+	dma_fence_init(ctx->fence, &fastrpc_fence_ops, &fl->fence_lock,
+		       dma_fence_context_alloc(1), 1);
+
+	if (req.flags & FASTRPC_ASYNC_FENCE) {
+		sync_file = sync_file_create(ctx->fence);
+		if (!sync_file) {
+			err = -ENOMEM;
+			goto bail;
+		}
+
+		fence_fd = get_unused_fd_flags(O_CLOEXEC);
+		if (fence_fd < 0) {
+			err = fence_fd;
+			goto bail;
+		}
+	}
+
+	if (fl->servloc_name) {
+		err = fastrpc_check_pd_status(fl,
+			AUDIO_PDR_SERVICE_LOCATION_CLIENT_NAME);
+		err |= fastrpc_check_pd_status(fl,
+			SENSORS_PDR_ADSP_SERVICE_LOCATION_CLIENT_NAME);
+		err |= fastrpc_check_pd_status(fl,
+			SENSORS_PDR_SLPI_SERVICE_LOCATION_CLIENT_NAME);
+		if (err)
+			goto bail;
+	}
+
+	start = ktime_get_ns();
+	PERF(ctx->perf_kernel, GET_COUNTER((u64 *)ctx->perf, PERF_GETARGS),
+	err = fastrpc_get_args(false, ctx);
+	PERF_END);
+	ctx->marshal_ns = ktime_get_ns() - start;
+	if (err)
+		goto bail;
+
+	/* dependencies first, or the job would wait for its own fence */
+	err = fastrpc_get_arg_deps(ctx);
+	if (!err)
+		err = fastrpc_attach_arg_fences(ctx);
+	if (err)
+		goto bail;
+
+	/* make sure that all CPU memory writes are seen by DSP */
+	dma_wmb();
+	PERF(ctx->perf_kernel, GET_COUNTER((u64 *)ctx->perf, PERF_LINK),
+	err = fastrpc_send_when_ready(ctx);
+	PERF_END);
+	if (err < 0)
+		goto bail;
+
+	/*
+	 * The job is in flight from here on; if userspace cannot be told
+	 * about it, it is still collected when the file is released.
+	 */
+	req.jobid = ctx->jobid;
+	req.fence_fd = fence_fd;
+	if (copy_to_user(argp, &req, sizeof(req))) {
+		if (sync_file) {
+			put_unused_fd(fence_fd);
+			fput(sync_file->file);
+		}
+		return -EFAULT;
+	}
+
+	if (sync_file)
+		fd_install(fence_fd, sync_file->file);
+
+	return 0;
+
+bail:
+	if (fence_fd >= 0)
+		put_unused_fd(fence_fd);
+	if (sync_file)
+		fput(sync_file->file);
+	spin_lock(&fl->lock);
+	list_del(&ctx->node);
+	spin_unlock(&fl->lock);
+	fastrpc_context_put(ctx);
+
+	return err;
+
+err_args:
+	if (evfd)
+		eventfd_ctx_put(evfd);
+
+	return err;
+}
+
+/*
+ * Claim an async job of the current process: job @jobid, or any completed
+ * job when @jobid is 0. Returns NULL when the job exists but is not done
+ * yet, or ERR_PTR(-ENOENT) when there is nothing to wait for.
+ */
+static struct fastrpc_invoke_ctx *fastrpc_async_claim(struct fastrpc_user *fl,
+						      u64 jobid)
+{
+	struct fastrpc_invoke_ctx *ctx, *found = ERR_PTR(-ENOENT);
+
+	spin_lock(&fl->lock);
+	list_for_each_entry(ctx, &fl->pending, node) {
+		if (!ctx->is_async || ctx->async_claimed || ctx->mm != current->mm)
+			continue;
+		if (jobid && ctx->jobid != jobid)
+			continue;
+
+		if (!completion_done(&ctx->work)) {
+			found = NULL;
+			if (jobid)
+				break;
+			continue;
+		}
+
+		ctx->async_claimed = true;
+		found = ctx;
+		break;
+	}
+	spin_unlock(&fl->lock);
+
+	return found;
+}
+
+static int fastrpc_async_response(struct fastrpc_user *fl, char __user *argp)
+{
+	struct fastrpc_async_response rsp;
+	struct fastrpc_invoke_ctx *ctx;
+	int err, perferr;
+	u64 start;
+
+	if (copy_from_user(&rsp, argp, sizeof(rsp)))
+		return -EFAULT;
+
+	if (rsp.flags & ~FASTRPC_ASYNC_NONBLOCK ||
+	    memchr_inv(rsp.reserved, 0, sizeof(rsp.reserved)))
+		return -EINVAL;
+
+	if (rsp.flags & FASTRPC_ASYNC_NONBLOCK) {
+		ctx = fastrpc_async_claim(fl, rsp.jobid);
+		if (!ctx)
+			return -EAGAIN;
+	} else {
+		err = wait_event_interruptible(fl->async_wq,
+				(ctx = fastrpc_async_claim(fl, rsp.jobid)) != NULL);
+		if (err)
+			return err;
+	}
+	if (IS_ERR(ctx))
+		return PTR_ERR(ctx);
+
+	/* make sure that all memory writes by DSP are seen by CPU */
+	dma_rmb();
+	if (ctx->send_err) {
+		/* the DSP never saw the job, so there is nothing to copy out */
+		err = ctx->send_err;
+	} else {
+		start = ktime_get_ns();
+		PERF(ctx->perf_kernel, GET_COUNTER((u64 *)ctx->perf, PERF_PUTARGS),
+		err = fastrpc_put_args(ctx, false);
+		PERF_END);
+		ctx->marshal_ns += ktime_get_ns() - start;
+		if (!err) {
+			fastrpc_record_latency(ctx, ctx->handle, start);
+			err = ctx->retval;
+		}
+	}
+
+	if (ctx->perf_kernel && ctx->perf) {
+		perferr = copy_to_user((void __user *)ctx->perf_kernel,
+				ctx->perf, FASTRPC_KERNEL_PERF_LIST * sizeof(u64));
+		if (perferr)
+			dev_info(fl->sctx->dev,
+				"Warning: failed to copy perf data %d\n", perferr);
+	}
+
+	rsp.jobid = ctx->jobid;
+	rsp.result = err;
+
+	spin_lock(&fl->lock);
+	list_del(&ctx->node);
+	spin_unlock(&fl->lock);
+	fastrpc_context_put(ctx);
+
+	if (copy_to_user(argp, &rsp, sizeof(rsp)))
+		return -EFAULT;
+
+	return 0;
+}
+
 static int fastrpc_get_info_from_dsp(struct fastrpc_user *fl, uint32_t *dsp_attr_buf,
 				     uint32_t dsp_attr_buf_len)
 {
@@ -2356,7 +3707,7 @@ static int fastrpc_req_munmap(struct fastrpc_user *fl, char __user *argp)
 	struct fastrpc_buf *buf = NULL, *iter, *b;
 	struct fastrpc_req_munmap req;
 	struct fastrpc_munmap_req_msg req_msg;
-	struct fastrpc_map *map = NULL, *iterm, *m;
+	struct fastrpc_map *map = NULL;
 	struct device *dev = fl->sctx->dev;
 	struct fastrpc_invoke_args args[1] = { [0] = { 0 } };
 	struct fastrpc_invoke_v2 ioctl = {0};
@@ -2392,12 +3743,7 @@ static int fastrpc_req_munmap(struct fastrpc_user *fl, char __user *argp)
 		return err;
 	}
 	spin_lock(&fl->lock);
-	list_for_each_entry_safe(iterm, m, &fl->maps, node) {
-		if (iterm->raddr == req.vaddrout) {
-			map = iterm;
-			break;
-		}
-	}
+	map = fastrpc_map_find_raddr(fl, -1, req.vaddrout);
 	spin_unlock(&fl->lock);
 	if (!map) {
 		dev_err(dev, "map not in list\n");
@@ -2555,7 +3901,7 @@ static int fastrpc_req_mmap(struct fastrpc_user *fl, char __user *argp)
 		}
 
 		/* update the buffer to be able to deallocate the memory on the DSP */
-		map->raddr = (uintptr_t) rsp_msg.vaddr;
+		fastrpc_map_set_raddr(fl, map, (uintptr_t) rsp_msg.vaddr);
 
 		/* let the client know the address to use */
 		req.vaddrout = rsp_msg.vaddr;
@@ -2585,19 +3931,13 @@ static int fastrpc_req_mem_unmap_impl(struct fastrpc_user *fl, struct fastrpc_me
 {
 	struct fastrpc_invoke_args args[1] = { [0] = { 0 } };
 	struct fastrpc_invoke_v2 ioctl = {0};
-	struct fastrpc_map *map = NULL, *iter, *m;
+	struct fastrpc_map *map = NULL;
 	struct fastrpc_mem_unmap_req_msg req_msg = { 0 };
 	int err = 0;
 	struct device *dev = fl->sctx->dev;
 
 	spin_lock(&fl->lock);
-	list_for_each_entry_safe(iter, m, &fl->maps, node) {
-		if ((req->fd < 0 || iter->fd == req->fd) && (iter->raddr == req->vaddr)) {
-			map = iter;
-			break;
-		}
-	}
-
+	map = fastrpc_map_find_raddr(fl, req->fd, req->vaddr);
 	spin_unlock(&fl->lock);
 
 	if (!map) {
@@ -2695,7 +4035,7 @@ static int fastrpc_req_mem_map(struct fastrpc_user *fl, char __user *argp)
 	}
 
 	/* update the buffer to be able to deallocate the memory on the DSP */
-	map->raddr = rsp_msg.vaddr;
+	fastrpc_map_set_raddr(fl, map, rsp_msg.vaddr);
 
 	/* let the client know the address to use */
 	req.vaddrout = rsp_msg.vaddr;
@@ -2731,6 +4071,15 @@ static long fastrpc_device_ioctl(struct file *file, unsigned int cmd,
 	case FASTRPC_IOCTL_INVOKEV2:
 		err = fastrpc_invokev2(fl, argp);
 		break;
+	case FASTRPC_IOCTL_INVOKE_BATCH:
+		err = fastrpc_invoke_batch(fl, argp);
+		break;
+	case FASTRPC_IOCTL_INVOKE_ASYNC:
+		err = fastrpc_invoke_async(fl, argp);
+		break;
+	case FASTRPC_IOCTL_ASYNC_RESPONSE:
+		err = fastrpc_async_response(fl, argp);
+		break;
 	case FASTRPC_IOCTL_INIT_ATTACH:
 		err = fastrpc_init_attach(fl, ROOT_PD);
 		break;
@@ -2775,11 +4124,8 @@ static void fastrpc_notify_users(struct fastrpc_user *user)
 	struct fastrpc_invoke_ctx *ctx;
 
 	spin_lock(&user->lock);
-	list_for_each_entry(ctx, &user->pending, node) {
-		ctx->retval = -EPIPE;
-		ctx->is_work_done = true;
-		complete(&ctx->work);
-	}
+	list_for_each_entry(ctx, &user->pending, node)
+		fastrpc_context_complete(ctx, -EPIPE);
 	spin_unlock(&user->lock);
 }
 
@@ -3157,13 +4503,33 @@ static void fastrpc_rpmsg_remove(struct rpmsg_device *rpdev)
 	fastrpc_channel_ctx_put(cctx);
 }
 
+/*
+ * Complete a synchronous call on the CPU it was sent from, where its
+ * caller most likely sleeps, instead of on the CPU that took the glink
+ * interrupt. The waiter cannot free the context before it is completed,
+ * so it stays valid until the IPI has run. Returns false if the caller
+ * has to complete the context itself.
+ */
+static bool fastrpc_steer_reply(struct fastrpc_invoke_ctx *ctx, int retval)
+{
+	int cpu = READ_ONCE(ctx->cpu);
+
+	if (!READ_ONCE(steer_replies) || ctx->is_async ||
+	    cpu == raw_smp_processor_id() || !cpu_online(cpu))
+		return false;
+
+	ctx->rsp_retval = retval;
+
+	/* a duplicate reply still in flight is completed in place */
+	return !smp_call_function_single_async(cpu, &ctx->csd);
+}
+
 static int fastrpc_rpmsg_callback(struct rpmsg_device *rpdev, void *data,
 				  int len, void *priv, u32 addr)
 {
 	struct fastrpc_channel_ctx *cctx = dev_get_drvdata(&rpdev->dev);
 	struct fastrpc_invoke_rsp *rsp = data;
 	struct fastrpc_invoke_ctx *ctx;
-	unsigned long flags;
 	unsigned long ctxid;
 
 	if (len < sizeof(*rsp))
@@ -3171,18 +4537,22 @@ static int fastrpc_rpmsg_callback(struct rpmsg_device *rpdev, void *data,
 
 	ctxid = ((rsp->ctx & FASTRPC_CTXID_MASK) >> 16);
 
-	spin_lock_irqsave(&cctx->lock, flags);
+	/*
+	 * Contexts are freed after an RCU grace period, so the lookup needs
+	 * no lock and concurrent replies for different users do not contend
+	 * on the channel lock.
+	 */
+	rcu_read_lock();
 	ctx = idr_find(&cctx->ctx_idr, ctxid);
-	spin_unlock_irqrestore(&cctx->lock, flags);
-
 	if (!ctx) {
+		rcu_read_unlock();
 		dev_dbg(&rpdev->dev, "No context ID matches response\n");
 		return 0;
 	}
 
-	ctx->retval = rsp->retval;
-	ctx->is_work_done = true;
-	complete(&ctx->work);
+	if (!fastrpc_steer_reply(ctx, rsp->retval))
+		fastrpc_context_complete(ctx, rsp->retval);
+	rcu_read_unlock();
 
 	return 0;
 }
@@ -3207,9 +4577,12 @@ static int fastrpc_init(void)
 {
 	int ret;
 
+	fastrpc_debugfs_root = debugfs_create_dir("fastrpc", NULL);
+
 	ret = platform_driver_register(&fastrpc_cb_driver);
 	if (ret < 0) {
 		pr_err("fastrpc: failed to register cb driver\n");
+		debugfs_remove_recursive(fastrpc_debugfs_root);
 		return ret;
 	}
 
@@ -3217,6 +4590,7 @@ static int fastrpc_init(void)
 	if (ret < 0) {
 		pr_err("fastrpc: failed to register rpmsg driver\n");
 		platform_driver_unregister(&fastrpc_cb_driver);
+		debugfs_remove_recursive(fastrpc_debugfs_root);
 		return ret;
 	}
 
@@ -3228,6 +4602,7 @@ static void fastrpc_exit(void)
 {
 	platform_driver_unregister(&fastrpc_cb_driver);
 	unregister_rpmsg_driver(&fastrpc_driver);
+	debugfs_remove_recursive(fastrpc_debugfs_root);
 }
 module_exit(fastrpc_exit);
 
@@ -0,0 +1,110 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM fastrpc
+
+#if !defined(_TRACE_FASTRPC_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_FASTRPC_H
+#include <linux/types.h>
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(fastrpc_invoke_latency,
+
+	TP_PROTO(int domain, int client_id, u32 handle, u32 sc,
+		 u64 marshal_ns, u64 dsp_ns, u64 wakeup_ns),
+
+	TP_ARGS(domain, client_id, handle, sc, marshal_ns, dsp_ns, wakeup_ns),
+
+	TP_STRUCT__entry(
+		__field(int, domain)
+		__field(int, client_id)
+		__field(u32, handle)
+		__field(u32, sc)
+		__field(u64, marshal_ns)
+		__field(u64, dsp_ns)
+		__field(u64, wakeup_ns)
+	),
+
+	TP_fast_assign(
+		__entry->domain = domain;
+		__entry->client_id = client_id;
+		__entry->handle = handle;
+		__entry->sc = sc;
+		__entry->marshal_ns = marshal_ns;
+		__entry->dsp_ns = dsp_ns;
+		__entry->wakeup_ns = wakeup_ns;
+	),
+
+	TP_printk("domain: %d client: 0x%x handle: 0x%x sc: 0x%x marshal: %llu dsp: %llu wakeup: %llu",
+		  __entry->domain, __entry->client_id, __entry->handle,
+		  __entry->sc, __entry->marshal_ns, __entry->dsp_ns,
+		  __entry->wakeup_ns
+	)
+);
+
+/*
+ * Start and end of a remote call, with the identities of the DMA-bufs
+ * passed to it. The two events of a call share its ctxid.
+ */
+DECLARE_EVENT_CLASS(fastrpc_invoke,
+
+	TP_PROTO(int domain, int client_id, u32 handle, u32 sc, u64 ctxid,
+		 int retval, const u64 *dmabufs, unsigned int ndmabufs),
+
+	TP_ARGS(domain, client_id, handle, sc, ctxid, retval, dmabufs, ndmabufs),
+
+	TP_STRUCT__entry(
+		__field(int, domain)
+		__field(int, client_id)
+		__field(u32, handle)
+		__field(u32, sc)
+		__field(u64, ctxid)
+		__field(int, retval)
+		__dynamic_array(u64, dmabufs, ndmabufs)
+	),
+
+	TP_fast_assign(
+		__entry->domain = domain;
+		__entry->client_id = client_id;
+		__entry->handle = handle;
+		__entry->sc = sc;
+		__entry->ctxid = ctxid;
+		__entry->retval = retval;
+		memcpy(__get_dynamic_array(dmabufs), dmabufs,
+		       ndmabufs * sizeof(*dmabufs));
+	),
+
+	TP_printk("domain: %d client: 0x%x handle: 0x%x sc: 0x%x ctxid: 0x%llx retval: %d dmabufs: %s",
+		  __entry->domain, __entry->client_id, __entry->handle,
+		  __entry->sc, __entry->ctxid, __entry->retval,
+		  __print_array(__get_dynamic_array(dmabufs),
+				__get_dynamic_array_len(dmabufs) / sizeof(u64),
+				sizeof(u64))
+	)
+);
+
+DEFINE_EVENT(fastrpc_invoke, fastrpc_invoke_start,
+	TP_PROTO(int domain, int client_id, u32 handle, u32 sc, u64 ctxid,
+		 int retval, const u64 *dmabufs, unsigned int ndmabufs),
+	TP_ARGS(domain, client_id, handle, sc, ctxid, retval, dmabufs, ndmabufs)
+);
+
+DEFINE_EVENT(fastrpc_invoke, fastrpc_invoke_end,
+	TP_PROTO(int domain, int client_id, u32 handle, u32 sc, u64 ctxid,
+		 int retval, const u64 *dmabufs, unsigned int ndmabufs),
+	TP_ARGS(domain, client_id, handle, sc, ctxid, retval, dmabufs, ndmabufs)
+);
+
+#endif /* _TRACE_FASTRPC_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH ../../drivers/misc
+
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE trace-fastrpc
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
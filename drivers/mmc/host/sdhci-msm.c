@@ -26,6 +26,7 @@
 #include "sdhci-cqhci.h"
 #include "sdhci-pltfm.h"
 #include "cqhci.h"
+#include "mmc_hsq.h"
 
 #define CORE_MCI_VERSION		0x50
 #define CORE_VERSION_MAJOR_SHIFT	28
@@ -293,6 +294,7 @@ struct sdhci_msm_host {
 	u32 dll_config;
 	u32 ddr_config;
 	bool vqmmc_enabled;
+	bool use_hsq;
 	u32 gpio_bt_reg_on;
 	struct regulator *vdda;
 };
@@ -2127,6 +2129,76 @@ static int sdhci_msm_cqe_add_host(struct sdhci_host *host,
 	return ret;
 }
 
+static int sdhci_msm_request_atomic(struct mmc_host *mmc,
+				    struct mmc_request *mrq)
+{
+	return sdhci_request_atomic(mmc, mrq);
+}
+
+static void sdhci_msm_request_done(struct sdhci_host *host,
+				   struct mmc_request *mrq)
+{
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_msm_host *msm_host = sdhci_pltfm_priv(pltfm_host);
+
+	/* Validate if the request was from software queue firstly. */
+	if (msm_host->use_hsq && mmc_hsq_finalize_request(host->mmc, mrq))
+		return;
+
+	mmc_request_done(host->mmc, mrq);
+}
+
+/*
+ * Hosts without CQE, i.e. the SD card and SDIO slots, queue requests in
+ * software instead, so the block layer can prepare and DMA map the next
+ * request while the current one is still on the bus.  The next request is
+ * issued straight from the completion of the previous one.
+ */
+static int sdhci_msm_hsq_add_host(struct sdhci_host *host,
+				  struct platform_device *pdev)
+{
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_msm_host *msm_host = sdhci_pltfm_priv(pltfm_host);
+	struct mmc_hsq *hsq;
+	int ret;
+
+	/*
+	 * Requests are issued from the completion path. Card detection may
+	 * sleep on a removable slot, so complete from the workqueue there.
+	 */
+	if (!mmc_card_is_removable(host->mmc))
+		host->mmc_host_ops.request_atomic = sdhci_msm_request_atomic;
+	else
+		host->always_defer_done = true;
+
+	ret = sdhci_setup_host(host);
+	if (ret)
+		return ret;
+
+	hsq = devm_kzalloc(&pdev->dev, sizeof(*hsq), GFP_KERNEL);
+	if (!hsq) {
+		ret = -ENOMEM;
+		goto cleanup;
+	}
+
+	ret = mmc_hsq_init(hsq, host->mmc);
+	if (ret)
+		goto cleanup;
+
+	msm_host->use_hsq = true;
+
+	ret = __sdhci_add_host(host);
+	if (ret)
+		goto cleanup;
+
+	return 0;
+
+cleanup:
+	msm_host->use_hsq = false;
+	sdhci_cleanup_host(host);
+	return ret;
+}
+
 /*
  * Platform specific register write functions. This is so that, if any
  * register write needs to be followed up by platform specific actions,
@@ -2395,6 +2467,7 @@ static const struct sdhci_ops sdhci_msm_ops = {
 	.dump_vendor_regs = sdhci_msm_dump_vendor_regs,
 	.set_power = sdhci_set_power_noreg,
 	.set_timeout = sdhci_msm_set_timeout,
+	.request_done = sdhci_msm_request_done,
 };
 
 static const struct sdhci_pltfm_data sdhci_msm_pdata = {
@@ -2754,7 +2827,7 @@ static int sdhci_msm_probe(struct platform_device *pdev)
 	if (of_property_read_bool(node, "supports-cqe"))
 		ret = sdhci_msm_cqe_add_host(host, pdev);
 	else
-		ret = sdhci_add_host(host);
+		ret = sdhci_msm_hsq_add_host(host, pdev);
 	if (ret)
 		goto pm_runtime_disable;
 
@@ -2806,6 +2879,9 @@ static __maybe_unused int sdhci_msm_runtime_suspend(struct device *dev)
 	struct sdhci_msm_host *msm_host = sdhci_pltfm_priv(pltfm_host);
 	unsigned long flags;
 
+	if (msm_host->use_hsq && host->mmc->hsq_enabled)
+		mmc_hsq_suspend(host->mmc);
+
 	spin_lock_irqsave(&host->lock, flags);
 	host->runtime_suspended = true;
 	spin_unlock_irqrestore(&host->lock, flags);
@@ -2850,6 +2926,10 @@ static __maybe_unused int sdhci_msm_runtime_resume(struct device *dev)
 	host->runtime_suspended = false;
 	spin_unlock_irqrestore(&host->lock, flags);
 
+	/* The core enables the queue itself once a card is initialized */
+	if (msm_host->use_hsq && host->mmc->hsq_enabled)
+		mmc_hsq_resume(host->mmc);
+
 	return ret;
 }
 
@@ -66,6 +66,8 @@ struct stmmac_q_tx_stats {
 	u64_stats_t tx_set_ic_bit;
 	u64_stats_t tx_tso_frames;
 	u64_stats_t tx_tso_nfrags;
+	u64_stats_t tx_tbs_n;
+	u64_stats_t tx_tbs_late;
 };
 
 struct stmmac_napi_tx_stats {
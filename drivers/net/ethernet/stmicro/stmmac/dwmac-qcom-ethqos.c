@@ -883,6 +883,8 @@ static int qcom_ethqos_probe(struct platform_device *pdev)
 		plat_dat->flags |= STMMAC_FLAG_HAS_INTEGRATED_PCS;
 	if (data->dma_addr_width)
 		plat_dat->host_dma_width = data->dma_addr_width;
+	/* Keep NAPI out of the softirq of whichever CPU takes the interrupt */
+	plat_dat->flags |= STMMAC_FLAG_NAPI_THREADED;
 
 	if (ethqos->serdes_phy) {
 		plat_dat->serdes_powerup = qcom_ethqos_serdes_powerup;
@@ -301,6 +301,9 @@ enum power_event {
 #define GMAC_HI_REG_AE			BIT(31)
 
 /* L3/L4 Filters regs */
+#define GMAC_L3L4_DMCHEN0		BIT(28)
+#define GMAC_L3L4_DMCHN0		GENMASK(27, 24)
+#define GMAC_L3L4_DMCHN0_SHIFT		24
 #define GMAC_L4DPIM0			BIT(21)
 #define GMAC_L4DPM0			BIT(20)
 #define GMAC_L4SPIM0			BIT(19)
@@ -339,6 +342,7 @@ enum power_event {
 #define MTL_RXQ_DMA_MAP1		0x00000c34 /* queue 4 to 7 */
 #define MTL_RXQ_DMA_QXMDMACH_MASK(x)	(0xf << 8 * (x))
 #define MTL_RXQ_DMA_QXMDMACH(chan, q)	((chan) << (8 * (q)))
+#define MTL_RXQ_DMA_QXDDMACH(q)		BIT(8 * (q) + 4)
 
 #define MTL_CHAN_BASE_ADDR		0x00000d00
 #define MTL_CHAN_BASE_OFFSET		0x40
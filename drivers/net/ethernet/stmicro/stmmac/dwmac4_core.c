@@ -1145,10 +1145,14 @@ static int dwmac4_config_l4_filter(struct mac_device_info *hw, u32 filter_no,
 
 	writel(value, ioaddr + GMAC_L3L4_CTRL(filter_no));
 
+	/* Source and destination port may both be matched */
+	value = readl(ioaddr + GMAC_L4_ADDR(filter_no));
 	if (sa) {
-		value = match & GMAC_L4SP0;
+		value &= ~GMAC_L4SP0;
+		value |= match & GMAC_L4SP0;
 	} else {
-		value = (match << GMAC_L4DP0_SHIFT) & GMAC_L4DP0;
+		value &= ~GMAC_L4DP0;
+		value |= (match << GMAC_L4DP0_SHIFT) & GMAC_L4DP0;
 	}
 
 	writel(value, ioaddr + GMAC_L4_ADDR(filter_no));
@@ -1159,6 +1163,47 @@ static int dwmac4_config_l4_filter(struct mac_device_info *hw, u32 filter_no,
 	return 0;
 }
 
+static int dwmac5_config_l3l4_dma_chan(struct mac_device_info *hw,
+				       u32 filter_no, bool en, u32 chan)
+{
+	void __iomem *ioaddr = hw->pcsr;
+	u32 value;
+
+	value = readl(ioaddr + GMAC_L3L4_CTRL(filter_no));
+	value &= ~(GMAC_L3L4_DMCHEN0 | GMAC_L3L4_DMCHN0);
+	if (en)
+		value |= GMAC_L3L4_DMCHEN0 |
+			 ((chan << GMAC_L3L4_DMCHN0_SHIFT) & GMAC_L3L4_DMCHN0);
+	writel(value, ioaddr + GMAC_L3L4_CTRL(filter_no));
+
+	if (!en)
+		return 0;
+
+	/* Queue 0 receives all traffic not routed elsewhere, let it follow
+	 * the DMA channel picked by the filters. Other packets keep going
+	 * to the channel of the DA filter, which is channel 0 as well.
+	 */
+	value = readl(ioaddr + MTL_RXQ_DMA_MAP0);
+	value |= MTL_RXQ_DMA_QXDDMACH(0);
+	writel(value, ioaddr + MTL_RXQ_DMA_MAP0);
+
+	return 0;
+}
+
+static void dwmac4_enable_l3l4_filter(struct mac_device_info *hw, bool en)
+{
+	void __iomem *ioaddr = hw->pcsr;
+	u32 value;
+
+	/* Packets matching no L3/L4 filter are dropped while this is set */
+	value = readl(ioaddr + GMAC_PACKET_FILTER);
+	if (en)
+		value |= GMAC_PACKET_FILTER_IPFE;
+	else
+		value &= ~GMAC_PACKET_FILTER_IPFE;
+	writel(value, ioaddr + GMAC_PACKET_FILTER);
+}
+
 const struct stmmac_ops dwmac4_ops = {
 	.core_init = dwmac4_core_init,
 	.phylink_get_caps = dwmac4_phylink_get_caps,
@@ -1197,6 +1242,7 @@ const struct stmmac_ops dwmac4_ops = {
 	.set_arp_offload = dwmac4_set_arp_offload,
 	.config_l3_filter = dwmac4_config_l3_filter,
 	.config_l4_filter = dwmac4_config_l4_filter,
+	.enable_l3l4_filter = dwmac4_enable_l3l4_filter,
 	.add_hw_vlan_rx_fltr = dwmac4_add_hw_vlan_rx_fltr,
 	.del_hw_vlan_rx_fltr = dwmac4_del_hw_vlan_rx_fltr,
 	.restore_hw_vlan_rx_fltr = dwmac4_restore_hw_vlan_rx_fltr,
@@ -1241,6 +1287,7 @@ const struct stmmac_ops dwmac410_ops = {
 	.set_arp_offload = dwmac4_set_arp_offload,
 	.config_l3_filter = dwmac4_config_l3_filter,
 	.config_l4_filter = dwmac4_config_l4_filter,
+	.enable_l3l4_filter = dwmac4_enable_l3l4_filter,
 	.est_configure = dwmac5_est_configure,
 	.est_irq_status = dwmac5_est_irq_status,
 	.fpe_configure = dwmac5_fpe_configure,
@@ -1294,6 +1341,8 @@ const struct stmmac_ops dwmac510_ops = {
 	.set_arp_offload = dwmac4_set_arp_offload,
 	.config_l3_filter = dwmac4_config_l3_filter,
 	.config_l4_filter = dwmac4_config_l4_filter,
+	.config_l3l4_dma_chan = dwmac5_config_l3l4_dma_chan,
+	.enable_l3l4_filter = dwmac4_enable_l3l4_filter,
 	.est_configure = dwmac5_est_configure,
 	.est_irq_status = dwmac5_est_irq_status,
 	.fpe_configure = dwmac5_fpe_configure,
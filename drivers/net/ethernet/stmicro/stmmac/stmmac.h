@@ -12,6 +12,7 @@
 #define STMMAC_RESOURCE_NAME   "stmmaceth"
 
 #include <linux/clk.h>
+#include <linux/dim.h>
 #include <linux/hrtimer.h>
 #include <linux/if_vlan.h>
 #include <linux/stmmac.h>
@@ -92,6 +93,7 @@ struct stmmac_rx_buffer {
 	};
 	struct page *sec_page;
 	dma_addr_t sec_addr;
+	__u32 sec_page_offset;
 };
 
 struct stmmac_xdp_buff {
@@ -107,6 +109,8 @@ struct stmmac_rx_queue {
 	struct xdp_rxq_info xdp_rxq;
 	struct xsk_buff_pool *xsk_pool;
 	struct page_pool *page_pool;
+	/* Size of the page fragments RX buffers use, 0 for whole pages */
+	unsigned int frag_size;
 	struct stmmac_rx_buffer *buf_pool;
 	struct stmmac_priv *priv_data;
 	struct dma_extended_desc *dma_erx;
@@ -120,6 +124,9 @@ struct stmmac_rx_queue {
 	unsigned int state_saved;
 	struct {
 		struct sk_buff *skb;
+		/* AF_XDP zero-copy frame and its last buffer */
+		struct xdp_buff *xdp;
+		struct xdp_buff *xdp_tail;
 		unsigned int len;
 		unsigned int error;
 	} state;
@@ -132,6 +139,10 @@ struct stmmac_channel {
 	struct stmmac_priv *priv_data;
 	spinlock_t lock;
 	u32 index;
+	struct dim rx_dim;
+	struct dim tx_dim;
+	u16 rx_dim_events;
+	u16 tx_dim_events;
 };
 
 struct stmmac_tc_entry {
@@ -179,6 +190,9 @@ struct stmmac_flow_entry {
 	int in_use;
 	int idx;
 	int is_l4;
+	/* Set up through ethtool ntuple rather than tc flower */
+	bool is_ntuple;
+	struct ethtool_rx_flow_spec fs;
 };
 
 /* Rx Frame Steering */
@@ -220,12 +234,25 @@ struct stmmac_priv {
 	bool tso;
 	int sph;
 	int sph_cap;
+	/* Header split turned off through ethtool */
+	bool sph_disabled;
 	u32 sarc_type;
 
 	unsigned int rx_copybreak;
 	u32 rx_riwt[MTL_MAX_TX_QUEUES];
 	int hwts_rx_en;
 
+	/* Coalescing set through ethtool, the upper bounds for DIM */
+	u32 tx_coal_frames_set[MTL_MAX_TX_QUEUES];
+	u32 tx_coal_timer_set[MTL_MAX_TX_QUEUES];
+	u32 rx_coal_frames_set[MTL_MAX_TX_QUEUES];
+	u32 rx_riwt_set[MTL_MAX_TX_QUEUES];
+	bool rx_dim_enabled;
+	bool tx_dim_enabled;
+
+	/* NAPI threads run as SCHED_FIFO */
+	bool napi_rt;
+
 	void __iomem *ioaddr;
 	struct net_device *dev;
 	struct device *device;
@@ -349,6 +376,8 @@ int stmmac_mdio_register(struct net_device *ndev);
 int stmmac_mdio_reset(struct mii_bus *mii);
 int stmmac_xpcs_setup(struct mii_bus *mii);
 void stmmac_set_ethtool_ops(struct net_device *netdev);
+void stmmac_restore_rx_flows(struct stmmac_priv *priv);
+void stmmac_del_rx_flows(struct stmmac_priv *priv);
 
 int stmmac_init_tstamp_counter(struct stmmac_priv *priv, u32 systime_flags);
 void stmmac_ptp_register(struct stmmac_priv *priv);
@@ -364,9 +393,13 @@ int stmmac_dvr_probe(struct device *device,
 void stmmac_disable_eee_mode(struct stmmac_priv *priv);
 bool stmmac_eee_init(struct stmmac_priv *priv);
 int stmmac_reinit_queues(struct net_device *dev, u32 rx_cnt, u32 tx_cnt);
+int stmmac_set_napi_threaded(struct stmmac_priv *priv, bool threaded);
+void stmmac_napi_threads_config(struct stmmac_priv *priv);
 int stmmac_reinit_ringparam(struct net_device *dev, u32 rx_size, u32 tx_size);
 int stmmac_bus_clks_config(struct stmmac_priv *priv, bool enabled);
 void stmmac_fpe_handshake(struct stmmac_priv *priv, bool enable);
+u32 stmmac_usec2riwt(u32 usec, struct stmmac_priv *priv);
+void stmmac_dim_restore(struct stmmac_priv *priv);
 
 static inline bool stmmac_xdp_is_enabled(struct stmmac_priv *priv)
 {
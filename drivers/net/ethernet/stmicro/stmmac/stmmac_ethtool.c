@@ -15,6 +15,7 @@
 #include <linux/phylink.h>
 #include <linux/net_tstamp.h>
 #include <asm/io.h>
+#include <net/page_pool/helpers.h>
 
 #include "stmmac.h"
 #include "dwmac_dma.h"
@@ -181,6 +182,14 @@ static const char stmmac_qstats_string[][ETH_GSTRING_LEN] = {
 };
 #define STMMAC_QSTATS ARRAY_SIZE(stmmac_qstats_string)
 
+static const char stmmac_priv_flags_strings[][ETH_GSTRING_LEN] = {
+#define STMMAC_PRIV_FLAG_NAPI_THREADED	BIT(0)
+	"napi-threaded",
+#define STMMAC_PRIV_FLAG_NAPI_RT	BIT(1)
+	"napi-rt",
+};
+#define STMMAC_PRIV_FLAGS_LEN ARRAY_SIZE(stmmac_priv_flags_strings)
+
 /* HW MAC Management counters (if supported) */
 #define STMMAC_MMC_STAT(m)	\
 	{ #m, sizeof_field(struct stmmac_counters, m),	\
@@ -278,6 +287,8 @@ static const struct stmmac_stats stmmac_mmc[] = {
 static const char stmmac_qstats_tx_string[][ETH_GSTRING_LEN] = {
 	"tx_pkt_n",
 	"tx_irq_n",
+	"tx_tbs_n",
+	"tx_tbs_late",
 #define STMMAC_TXQ_STATS ARRAY_SIZE(stmmac_qstats_tx_string)
 };
 
@@ -486,6 +497,11 @@ static void stmmac_get_ringparam(struct net_device *netdev,
 	ring->tx_max_pending = DMA_MAX_TX_SIZE;
 	ring->rx_pending = priv->dma_conf.dma_rx_size;
 	ring->tx_pending = priv->dma_conf.dma_tx_size;
+
+	if (priv->sph_cap)
+		kernel_ring->tcp_data_split = priv->sph ?
+					      ETHTOOL_TCP_DATA_SPLIT_ENABLED :
+					      ETHTOOL_TCP_DATA_SPLIT_DISABLED;
 }
 
 static int stmmac_set_ringparam(struct net_device *netdev,
@@ -493,6 +509,9 @@ static int stmmac_set_ringparam(struct net_device *netdev,
 				struct kernel_ethtool_ringparam *kernel_ring,
 				struct netlink_ext_ack *extack)
 {
+	struct stmmac_priv *priv = netdev_priv(netdev);
+	bool sph_disabled = priv->sph_disabled;
+
 	if (ring->rx_mini_pending || ring->rx_jumbo_pending ||
 	    ring->rx_pending < DMA_MIN_RX_SIZE ||
 	    ring->rx_pending > DMA_MAX_RX_SIZE ||
@@ -502,6 +521,31 @@ static int stmmac_set_ringparam(struct net_device *netdev,
 	    !is_power_of_2(ring->tx_pending))
 		return -EINVAL;
 
+	/* Split headers land in the RX buffer, payloads in a page of their own */
+	switch (kernel_ring->tcp_data_split) {
+	case ETHTOOL_TCP_DATA_SPLIT_ENABLED:
+		if (!priv->sph_cap) {
+			NL_SET_ERR_MSG_MOD(extack, "header split not supported");
+			return -EOPNOTSUPP;
+		}
+		if (stmmac_xdp_is_enabled(priv)) {
+			NL_SET_ERR_MSG_MOD(extack,
+					   "header split can't be used with XDP");
+			return -EBUSY;
+		}
+		sph_disabled = false;
+		break;
+	case ETHTOOL_TCP_DATA_SPLIT_DISABLED:
+		sph_disabled = true;
+		break;
+	default:
+		break;
+	}
+
+	priv->sph_disabled = sph_disabled;
+	priv->sph = priv->sph_cap && !sph_disabled &&
+		    !stmmac_xdp_is_enabled(priv);
+
 	return stmmac_reinit_ringparam(netdev, ring->rx_pending,
 				       ring->tx_pending);
 }
@@ -590,15 +634,23 @@ static void stmmac_get_per_qstats(struct stmmac_priv *priv, u64 *data)
 
 	for (q = 0; q < tx_cnt; q++) {
 		struct stmmac_txq_stats *txq_stats = &priv->xstats.txq_stats[q];
-		u64 pkt_n;
+		u64 pkt_n, tbs_n, tbs_late;
 
 		do {
 			start = u64_stats_fetch_begin(&txq_stats->napi_syncp);
 			pkt_n = u64_stats_read(&txq_stats->napi.tx_pkt_n);
 		} while (u64_stats_fetch_retry(&txq_stats->napi_syncp, start));
 
+		do {
+			start = u64_stats_fetch_begin(&txq_stats->q_syncp);
+			tbs_n = u64_stats_read(&txq_stats->q.tx_tbs_n);
+			tbs_late = u64_stats_read(&txq_stats->q.tx_tbs_late);
+		} while (u64_stats_fetch_retry(&txq_stats->q_syncp, start));
+
 		*data++ = pkt_n;
 		*data++ = stmmac_get_tx_normal_irq_n(priv, q);
+		*data++ = tbs_n;
+		*data++ = tbs_late;
 	}
 
 	for (q = 0; q < rx_cnt; q++) {
@@ -615,6 +667,25 @@ static void stmmac_get_per_qstats(struct stmmac_priv *priv, u64 *data)
 	}
 }
 
+/* Recycling stats of the RX page pools of all queues together */
+static void stmmac_get_page_pool_stats(struct stmmac_priv *priv, u64 *data)
+{
+#ifdef CONFIG_PAGE_POOL_STATS
+	u32 rx_queues_count = priv->plat->rx_queues_to_use;
+	struct page_pool_stats stats = {};
+	u32 queue;
+
+	for (queue = 0; queue < rx_queues_count; queue++) {
+		struct stmmac_rx_queue *rx_q = &priv->dma_conf.rx_queue[queue];
+
+		if (rx_q->page_pool)
+			page_pool_get_stats(rx_q->page_pool, &stats);
+	}
+
+	page_pool_ethtool_stats_get(data, &stats);
+#endif
+}
+
 static void stmmac_get_ethtool_stats(struct net_device *dev,
 				 struct ethtool_stats *dummy, u64 *data)
 {
@@ -719,6 +790,10 @@ static void stmmac_get_ethtool_stats(struct net_device *dev,
 	data[j++] = napi_poll;
 
 	stmmac_get_per_qstats(priv, &data[j]);
+	j += STMMAC_TXQ_STATS * tx_queues_count +
+	     STMMAC_RXQ_STATS * rx_queues_count;
+
+	stmmac_get_page_pool_stats(priv, &data[j]);
 }
 
 static int stmmac_get_sset_count(struct net_device *netdev, int sset)
@@ -732,7 +807,8 @@ static int stmmac_get_sset_count(struct net_device *netdev, int sset)
 	case ETH_SS_STATS:
 		len = STMMAC_STATS_LEN + STMMAC_QSTATS +
 		      STMMAC_TXQ_STATS * tx_cnt +
-		      STMMAC_RXQ_STATS * rx_cnt;
+		      STMMAC_RXQ_STATS * rx_cnt +
+		      page_pool_ethtool_stats_get_count();
 
 		if (priv->dma_cap.rmon)
 			len += STMMAC_MMC_STATS_LEN;
@@ -750,12 +826,14 @@ static int stmmac_get_sset_count(struct net_device *netdev, int sset)
 		return len;
 	case ETH_SS_TEST:
 		return stmmac_selftest_get_count(priv);
+	case ETH_SS_PRIV_FLAGS:
+		return STMMAC_PRIV_FLAGS_LEN;
 	default:
 		return -EOPNOTSUPP;
 	}
 }
 
-static void stmmac_get_qstats_string(struct stmmac_priv *priv, u8 *data)
+static u8 *stmmac_get_qstats_string(struct stmmac_priv *priv, u8 *data)
 {
 	u32 tx_cnt = priv->plat->tx_queues_to_use;
 	u32 rx_cnt = priv->plat->rx_queues_to_use;
@@ -775,6 +853,8 @@ static void stmmac_get_qstats_string(struct stmmac_priv *priv, u8 *data)
 			data += ETH_GSTRING_LEN;
 		}
 	}
+
+	return data;
 }
 
 static void stmmac_get_strings(struct net_device *dev, u32 stringset, u8 *data)
@@ -810,17 +890,50 @@ static void stmmac_get_strings(struct net_device *dev, u32 stringset, u8 *data)
 			memcpy(p, stmmac_qstats_string[i], ETH_GSTRING_LEN);
 			p += ETH_GSTRING_LEN;
 		}
-		stmmac_get_qstats_string(priv, p);
+		p = stmmac_get_qstats_string(priv, p);
+		page_pool_ethtool_stats_get_strings(p);
 		break;
 	case ETH_SS_TEST:
 		stmmac_selftest_get_strings(priv, p);
 		break;
+	case ETH_SS_PRIV_FLAGS:
+		memcpy(p, stmmac_priv_flags_strings,
+		       sizeof(stmmac_priv_flags_strings));
+		break;
 	default:
 		WARN_ON(1);
 		break;
 	}
 }
 
+static u32 stmmac_get_priv_flags(struct net_device *dev)
+{
+	struct stmmac_priv *priv = netdev_priv(dev);
+	u32 flags = 0;
+
+	if (dev->threaded)
+		flags |= STMMAC_PRIV_FLAG_NAPI_THREADED;
+	if (priv->napi_rt)
+		flags |= STMMAC_PRIV_FLAG_NAPI_RT;
+
+	return flags;
+}
+
+static int stmmac_set_priv_flags(struct net_device *dev, u32 flags)
+{
+	bool threaded = !!(flags & STMMAC_PRIV_FLAG_NAPI_THREADED);
+	struct stmmac_priv *priv = netdev_priv(dev);
+
+	priv->napi_rt = !!(flags & STMMAC_PRIV_FLAG_NAPI_RT);
+
+	if (threaded != dev->threaded)
+		return stmmac_set_napi_threaded(priv, threaded);
+
+	stmmac_napi_threads_config(priv);
+
+	return 0;
+}
+
 /* Currently only support WOL through Magic packet. */
 static void stmmac_get_wol(struct net_device *dev, struct ethtool_wolinfo *wol)
 {
@@ -931,7 +1044,7 @@ static int stmmac_ethtool_op_set_eee(struct net_device *dev,
 	return 0;
 }
 
-static u32 stmmac_usec2riwt(u32 usec, struct stmmac_priv *priv)
+u32 stmmac_usec2riwt(u32 usec, struct stmmac_priv *priv)
 {
 	unsigned long clk = clk_get_rate(priv->plat->stmmac_clk);
 
@@ -976,22 +1089,25 @@ static int __stmmac_get_coalesce(struct net_device *dev,
 		return -EINVAL;
 
 	if (queue < tx_cnt) {
-		ec->tx_coalesce_usecs = priv->tx_coal_timer[queue];
-		ec->tx_max_coalesced_frames = priv->tx_coal_frames[queue];
+		ec->tx_coalesce_usecs = priv->tx_coal_timer_set[queue];
+		ec->tx_max_coalesced_frames = priv->tx_coal_frames_set[queue];
 	} else {
 		ec->tx_coalesce_usecs = 0;
 		ec->tx_max_coalesced_frames = 0;
 	}
 
 	if (priv->use_riwt && queue < rx_cnt) {
-		ec->rx_max_coalesced_frames = priv->rx_coal_frames[queue];
-		ec->rx_coalesce_usecs = stmmac_riwt2usec(priv->rx_riwt[queue],
-							 priv);
+		ec->rx_max_coalesced_frames = priv->rx_coal_frames_set[queue];
+		ec->rx_coalesce_usecs =
+			stmmac_riwt2usec(priv->rx_riwt_set[queue], priv);
 	} else {
 		ec->rx_max_coalesced_frames = 0;
 		ec->rx_coalesce_usecs = 0;
 	}
 
+	ec->use_adaptive_rx_coalesce = priv->rx_dim_enabled;
+	ec->use_adaptive_tx_coalesce = priv->tx_dim_enabled;
+
 	return 0;
 }
 
@@ -1029,6 +1145,10 @@ static int __stmmac_set_coalesce(struct net_device *dev,
 	else if (queue >= max_cnt)
 		return -EINVAL;
 
+	/* The RX watchdog is what DIM moderates on the RX side */
+	if (ec->use_adaptive_rx_coalesce && !priv->use_riwt)
+		return -EOPNOTSUPP;
+
 	if (priv->use_riwt && (ec->rx_coalesce_usecs > 0)) {
 		rx_riwt = stmmac_usec2riwt(ec->rx_coalesce_usecs, priv);
 
@@ -1039,17 +1159,13 @@ static int __stmmac_set_coalesce(struct net_device *dev,
 			int i;
 
 			for (i = 0; i < rx_cnt; i++) {
-				priv->rx_riwt[i] = rx_riwt;
-				stmmac_rx_watchdog(priv, priv->ioaddr,
-						   rx_riwt, i);
-				priv->rx_coal_frames[i] =
+				priv->rx_riwt_set[i] = rx_riwt;
+				priv->rx_coal_frames_set[i] =
 					ec->rx_max_coalesced_frames;
 			}
 		} else if (queue < rx_cnt) {
-			priv->rx_riwt[queue] = rx_riwt;
-			stmmac_rx_watchdog(priv, priv->ioaddr,
-					   rx_riwt, queue);
-			priv->rx_coal_frames[queue] =
+			priv->rx_riwt_set[queue] = rx_riwt;
+			priv->rx_coal_frames_set[queue] =
 				ec->rx_max_coalesced_frames;
 		}
 	}
@@ -1066,18 +1182,24 @@ static int __stmmac_set_coalesce(struct net_device *dev,
 		int i;
 
 		for (i = 0; i < tx_cnt; i++) {
-			priv->tx_coal_frames[i] =
+			priv->tx_coal_frames_set[i] =
 				ec->tx_max_coalesced_frames;
-			priv->tx_coal_timer[i] =
+			priv->tx_coal_timer_set[i] =
 				ec->tx_coalesce_usecs;
 		}
 	} else if (queue < tx_cnt) {
-		priv->tx_coal_frames[queue] =
+		priv->tx_coal_frames_set[queue] =
 			ec->tx_max_coalesced_frames;
-		priv->tx_coal_timer[queue] =
+		priv->tx_coal_timer_set[queue] =
 			ec->tx_coalesce_usecs;
 	}
 
+	priv->rx_dim_enabled = ec->use_adaptive_rx_coalesce;
+	priv->tx_dim_enabled = ec->use_adaptive_tx_coalesce;
+
+	/* Start over from the new bounds, DIM moves down from there */
+	stmmac_dim_restore(priv);
+
 	return 0;
 }
 
@@ -1095,6 +1217,262 @@ static int stmmac_set_per_queue_coalesce(struct net_device *dev, u32 queue,
 	return __stmmac_set_coalesce(dev, ec, queue);
 }
 
+static void stmmac_clear_rx_flow(struct stmmac_priv *priv,
+				 struct stmmac_flow_entry *entry)
+{
+	/* Clears the L4 and DMA channel settings of the filter too */
+	stmmac_config_l3_filter(priv, priv->hw, entry->idx, false, false,
+				false, false, 0);
+
+	entry->in_use = false;
+	entry->is_ntuple = false;
+	entry->is_l4 = false;
+	entry->action = 0;
+}
+
+/* The MAC drops what matches no L3/L4 filter while the filters are enabled.
+ * That is what tc flower rules and ntuple drop rules, which are inverse
+ * filters, rely on. Steering rules only pick the DMA channel of the packets
+ * they match, which the filters do whether enabled or not.
+ */
+static void stmmac_update_l3l4_filter(struct stmmac_priv *priv)
+{
+	bool en = false;
+	int i;
+
+	for (i = 0; i < priv->flow_entries_max; i++) {
+		struct stmmac_flow_entry *entry = &priv->flow_entries[i];
+
+		if (!entry->in_use)
+			continue;
+		if (!entry->is_ntuple || (entry->action & STMMAC_FLOW_ACTION_DROP))
+			en = true;
+	}
+
+	stmmac_enable_l3l4_filter(priv, priv->hw, en);
+}
+
+static int stmmac_program_rx_flow(struct stmmac_priv *priv,
+				  struct stmmac_flow_entry *entry,
+				  struct ethtool_rx_flow_spec *fs)
+{
+	struct ethtool_tcpip4_spec *key = &fs->h_u.tcp_ip4_spec;
+	struct ethtool_tcpip4_spec *mask = &fs->m_u.tcp_ip4_spec;
+	bool drop = fs->ring_cookie == RX_CLS_FLOW_DISC;
+	bool is_udp = fs->flow_type == UDP_V4_FLOW;
+	int ret = 0;
+
+	if (mask->ip4src)
+		ret = stmmac_config_l3_filter(priv, priv->hw, entry->idx, true,
+					      false, true, drop,
+					      ntohl(key->ip4src));
+	if (!ret && mask->ip4dst)
+		ret = stmmac_config_l3_filter(priv, priv->hw, entry->idx, true,
+					      false, false, drop,
+					      ntohl(key->ip4dst));
+	if (!ret && mask->psrc)
+		ret = stmmac_config_l4_filter(priv, priv->hw, entry->idx, true,
+					      is_udp, true, drop,
+					      ntohs(key->psrc));
+	if (!ret && mask->pdst)
+		ret = stmmac_config_l4_filter(priv, priv->hw, entry->idx, true,
+					      is_udp, false, drop,
+					      ntohs(key->pdst));
+	if (!ret && !drop)
+		ret = stmmac_config_l3l4_dma_chan(priv, priv->hw, entry->idx,
+						  true,
+						  ethtool_get_flow_spec_ring(fs->ring_cookie));
+	if (ret) {
+		stmmac_clear_rx_flow(priv, entry);
+		return ret;
+	}
+
+	entry->in_use = true;
+	entry->is_ntuple = true;
+	entry->is_l4 = mask->psrc || mask->pdst;
+	entry->action = drop ? STMMAC_FLOW_ACTION_DROP : 0;
+	entry->fs = *fs;
+
+	return 0;
+}
+
+static int stmmac_add_rx_flow(struct stmmac_priv *priv,
+			      struct ethtool_rx_flow_spec *fs)
+{
+	struct ethtool_tcpip4_spec *mask = &fs->m_u.tcp_ip4_spec;
+	struct stmmac_flow_entry *entry;
+	int nkeys, ret;
+
+	if (!(priv->dev->features & NETIF_F_NTUPLE))
+		return -EOPNOTSUPP;
+
+	if (fs->location >= priv->flow_entries_max)
+		return -EINVAL;
+
+	entry = &priv->flow_entries[fs->location];
+	if (entry->in_use && !entry->is_ntuple)
+		return -EBUSY;
+
+	/* The IPv4 address fields of the user flow are where they are in the
+	 * TCP and UDP ones, and there is no L4 match for it below.
+	 */
+	switch (fs->flow_type) {
+	case TCP_V4_FLOW:
+	case UDP_V4_FLOW:
+		/* The protocol is only matched along with a port */
+		if (!mask->psrc && !mask->pdst)
+			return -EOPNOTSUPP;
+		break;
+	case IPV4_USER_FLOW:
+		if (fs->m_u.usr_ip4_spec.l4_4_bytes ||
+		    fs->m_u.usr_ip4_spec.proto)
+			return -EOPNOTSUPP;
+		break;
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	/* Only whole fields can be matched */
+	if (mask->tos ||
+	    (mask->ip4src && mask->ip4src != htonl(~0)) ||
+	    (mask->ip4dst && mask->ip4dst != htonl(~0)) ||
+	    (mask->psrc && mask->psrc != htons(~0)) ||
+	    (mask->pdst && mask->pdst != htons(~0)))
+		return -EOPNOTSUPP;
+
+	nkeys = !!mask->ip4src + !!mask->ip4dst + !!mask->psrc + !!mask->pdst;
+	if (!nkeys)
+		return -EINVAL;
+
+	if (fs->ring_cookie == RX_CLS_FLOW_DISC) {
+		/* An inverse filter matches when any of its fields differs,
+		 * so only drop rules on a single field are what they say.
+		 */
+		if (nkeys > 1)
+			return -EOPNOTSUPP;
+	} else if (ethtool_get_flow_spec_ring_vf(fs->ring_cookie) ||
+		   ethtool_get_flow_spec_ring(fs->ring_cookie) >=
+		   priv->plat->rx_queues_to_use) {
+		return -EINVAL;
+	}
+
+	if (entry->in_use)
+		stmmac_clear_rx_flow(priv, entry);
+
+	ret = stmmac_program_rx_flow(priv, entry, fs);
+	stmmac_update_l3l4_filter(priv);
+
+	return ret;
+}
+
+static int stmmac_del_rx_flow(struct stmmac_priv *priv, u32 location)
+{
+	struct stmmac_flow_entry *entry;
+
+	if (location >= priv->flow_entries_max)
+		return -EINVAL;
+
+	entry = &priv->flow_entries[location];
+	if (!entry->in_use || !entry->is_ntuple)
+		return -ENOENT;
+
+	stmmac_clear_rx_flow(priv, entry);
+	stmmac_update_l3l4_filter(priv);
+
+	return 0;
+}
+
+void stmmac_del_rx_flows(struct stmmac_priv *priv)
+{
+	int i;
+
+	for (i = 0; i < priv->flow_entries_max; i++) {
+		struct stmmac_flow_entry *entry = &priv->flow_entries[i];
+
+		if (entry->in_use && entry->is_ntuple)
+			stmmac_clear_rx_flow(priv, entry);
+	}
+
+	stmmac_update_l3l4_filter(priv);
+}
+
+/* Reprogram the ntuple rules after the MAC has been reset */
+void stmmac_restore_rx_flows(struct stmmac_priv *priv)
+{
+	bool restored = false;
+	int i;
+
+	for (i = 0; i < priv->flow_entries_max; i++) {
+		struct stmmac_flow_entry *entry = &priv->flow_entries[i];
+		struct ethtool_rx_flow_spec *fs = &entry->fs;
+
+		if (!entry->in_use || !entry->is_ntuple)
+			continue;
+
+		if (fs->ring_cookie != RX_CLS_FLOW_DISC &&
+		    ethtool_get_flow_spec_ring(fs->ring_cookie) >=
+		    priv->plat->rx_queues_to_use) {
+			netdev_warn(priv->dev,
+				    "Dropping ntuple rule %u, its RX queue is gone\n",
+				    fs->location);
+			stmmac_clear_rx_flow(priv, entry);
+			continue;
+		}
+
+		if (stmmac_program_rx_flow(priv, entry, fs))
+			netdev_warn(priv->dev,
+				    "Failed to restore ntuple rule %u\n",
+				    fs->location);
+		restored = true;
+	}
+
+	if (restored)
+		stmmac_update_l3l4_filter(priv);
+}
+
+static int stmmac_get_rx_flow(struct stmmac_priv *priv,
+			      struct ethtool_rxnfc *rxnfc)
+{
+	struct stmmac_flow_entry *entry;
+
+	if (rxnfc->fs.location >= priv->flow_entries_max)
+		return -EINVAL;
+
+	entry = &priv->flow_entries[rxnfc->fs.location];
+	if (!entry->in_use || !entry->is_ntuple)
+		return -ENOENT;
+
+	rxnfc->fs = entry->fs;
+
+	return 0;
+}
+
+static int stmmac_get_rx_flows(struct stmmac_priv *priv,
+			       struct ethtool_rxnfc *rxnfc, u32 *rule_locs)
+{
+	unsigned int cnt = 0;
+	int i;
+
+	for (i = 0; i < priv->flow_entries_max; i++) {
+		struct stmmac_flow_entry *entry = &priv->flow_entries[i];
+
+		if (!entry->in_use || !entry->is_ntuple)
+			continue;
+
+		if (rule_locs) {
+			if (cnt == rxnfc->rule_cnt)
+				return -EMSGSIZE;
+			rule_locs[cnt] = i;
+		}
+		cnt++;
+	}
+
+	rxnfc->data = priv->flow_entries_max;
+	rxnfc->rule_cnt = cnt;
+
+	return 0;
+}
+
 static int stmmac_get_rxnfc(struct net_device *dev,
 			    struct ethtool_rxnfc *rxnfc, u32 *rule_locs)
 {
@@ -1104,6 +1482,12 @@ static int stmmac_get_rxnfc(struct net_device *dev,
 	case ETHTOOL_GRXRINGS:
 		rxnfc->data = priv->plat->rx_queues_to_use;
 		break;
+	case ETHTOOL_GRXCLSRLCNT:
+		return stmmac_get_rx_flows(priv, rxnfc, NULL);
+	case ETHTOOL_GRXCLSRULE:
+		return stmmac_get_rx_flow(priv, rxnfc);
+	case ETHTOOL_GRXCLSRLALL:
+		return stmmac_get_rx_flows(priv, rxnfc, rule_locs);
 	default:
 		return -EOPNOTSUPP;
 	}
@@ -1111,6 +1495,20 @@ static int stmmac_get_rxnfc(struct net_device *dev,
 	return 0;
 }
 
+static int stmmac_set_rxnfc(struct net_device *dev, struct ethtool_rxnfc *rxnfc)
+{
+	struct stmmac_priv *priv = netdev_priv(dev);
+
+	switch (rxnfc->cmd) {
+	case ETHTOOL_SRXCLSRLINS:
+		return stmmac_add_rx_flow(priv, &rxnfc->fs);
+	case ETHTOOL_SRXCLSRLDEL:
+		return stmmac_del_rx_flow(priv, rxnfc->fs.location);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
 static u32 stmmac_get_rxfh_key_size(struct net_device *dev)
 {
 	struct stmmac_priv *priv = netdev_priv(dev);
@@ -1263,7 +1661,9 @@ static int stmmac_set_tunable(struct net_device *dev,
 
 static const struct ethtool_ops stmmac_ethtool_ops = {
 	.supported_coalesce_params = ETHTOOL_COALESCE_USECS |
-				     ETHTOOL_COALESCE_MAX_FRAMES,
+				     ETHTOOL_COALESCE_MAX_FRAMES |
+				     ETHTOOL_COALESCE_USE_ADAPTIVE,
+	.supported_ring_params = ETHTOOL_RING_USE_TCP_DATA_SPLIT,
 	.begin = stmmac_check_if_running,
 	.get_drvinfo = stmmac_ethtool_getdrvinfo,
 	.get_msglevel = stmmac_ethtool_getmsglevel,
@@ -1279,12 +1679,15 @@ static const struct ethtool_ops stmmac_ethtool_ops = {
 	.self_test = stmmac_selftest_run,
 	.get_ethtool_stats = stmmac_get_ethtool_stats,
 	.get_strings = stmmac_get_strings,
+	.get_priv_flags = stmmac_get_priv_flags,
+	.set_priv_flags = stmmac_set_priv_flags,
 	.get_wol = stmmac_get_wol,
 	.set_wol = stmmac_set_wol,
 	.get_eee = stmmac_ethtool_op_get_eee,
 	.set_eee = stmmac_ethtool_op_set_eee,
 	.get_sset_count	= stmmac_get_sset_count,
 	.get_rxnfc = stmmac_get_rxnfc,
+	.set_rxnfc = stmmac_set_rxnfc,
 	.get_rxfh_key_size = stmmac_get_rxfh_key_size,
 	.get_rxfh_indir_size = stmmac_get_rxfh_indir_size,
 	.get_rxfh = stmmac_get_rxfh,
@@ -30,6 +30,7 @@
 #include <linux/slab.h>
 #include <linux/pm_runtime.h>
 #include <linux/prefetch.h>
+#include <linux/sched.h>
 #include <linux/pinctrl/consumer.h>
 #ifdef CONFIG_DEBUG_FS
 #include <linux/debugfs.h>
@@ -42,6 +43,7 @@
 #include <net/page_pool/helpers.h>
 #include <net/pkt_cls.h>
 #include <net/xdp_sock_drv.h>
+#include <uapi/linux/sched/types.h>
 #include "stmmac_ptp.h"
 #include "stmmac.h"
 #include "stmmac_xdp.h"
@@ -216,10 +218,14 @@ static void __stmmac_disable_all_queues(struct stmmac_priv *priv)
 			continue;
 		}
 
-		if (queue < rx_queues_cnt)
+		if (queue < rx_queues_cnt) {
 			napi_disable(&ch->rx_napi);
-		if (queue < tx_queues_cnt)
+			cancel_work_sync(&ch->rx_dim.work);
+		}
+		if (queue < tx_queues_cnt) {
 			napi_disable(&ch->tx_napi);
+			cancel_work_sync(&ch->tx_dim.work);
+		}
 	}
 }
 
@@ -1315,6 +1321,26 @@ static void stmmac_display_rings(struct stmmac_priv *priv,
 	stmmac_display_tx_rings(priv, dma_conf);
 }
 
+/**
+ * stmmac_xsk_rx_buf_size - RX DMA buffer size of an AF_XDP zero-copy queue
+ * @priv: driver private structure
+ * @pool: XSK buffer pool of the queue
+ * Description: frames spanning several XSK buffers keep their list of
+ * fragments at the end of the first one, so when the MTU does not fit in a
+ * single buffer that space must be left out of reach of the DMA.
+ */
+static u32 stmmac_xsk_rx_buf_size(struct stmmac_priv *priv,
+				  struct xsk_buff_pool *pool)
+{
+	u32 size = xsk_pool_get_rx_frame_size(pool);
+
+	if (priv->dev->mtu + ETH_HLEN + VLAN_HLEN * 2 + ETH_FCS_LEN > size)
+		size = ALIGN_DOWN(size - SKB_DATA_ALIGN(sizeof(struct skb_shared_info)),
+				  16);
+
+	return size;
+}
+
 static int stmmac_set_bfsize(int mtu, int bufsize)
 {
 	int ret = bufsize;
@@ -1416,6 +1442,25 @@ static void stmmac_clear_descriptors(struct stmmac_priv *priv,
 		stmmac_clear_tx_descriptors(priv, dma_conf, queue);
 }
 
+/**
+ * stmmac_rx_page_alloc - allocate the memory of an RX buffer
+ * @rx_q: RX queue
+ * @offset: returns the offset of the buffer in the page
+ * @gfp: allocation flags
+ * Description: RX buffers are whole pages, or fragments of one when the
+ * queue fits several buffers in a page.
+ */
+static struct page *stmmac_rx_page_alloc(struct stmmac_rx_queue *rx_q,
+					 unsigned int *offset, gfp_t gfp)
+{
+	if (rx_q->frag_size)
+		return page_pool_alloc_frag(rx_q->page_pool, offset,
+					    rx_q->frag_size, gfp);
+
+	*offset = 0;
+	return page_pool_alloc_pages(rx_q->page_pool, gfp);
+}
+
 /**
  * stmmac_init_rx_buffers - init the RX descriptor buffer.
  * @priv: driver private structure
@@ -1440,18 +1485,20 @@ static int stmmac_init_rx_buffers(struct stmmac_priv *priv,
 		gfp |= GFP_DMA32;
 
 	if (!buf->page) {
-		buf->page = page_pool_alloc_pages(rx_q->page_pool, gfp);
+		buf->page = stmmac_rx_page_alloc(rx_q, &buf->page_offset, gfp);
 		if (!buf->page)
 			return -ENOMEM;
-		buf->page_offset = stmmac_rx_offset(priv);
+		buf->page_offset += stmmac_rx_offset(priv);
 	}
 
 	if (priv->sph && !buf->sec_page) {
-		buf->sec_page = page_pool_alloc_pages(rx_q->page_pool, gfp);
+		buf->sec_page = stmmac_rx_page_alloc(rx_q, &buf->sec_page_offset,
+						     gfp);
 		if (!buf->sec_page)
 			return -ENOMEM;
 
-		buf->sec_addr = page_pool_get_dma_addr(buf->sec_page);
+		buf->sec_addr = page_pool_get_dma_addr(buf->sec_page) +
+				buf->sec_page_offset;
 		stmmac_set_desc_sec_addr(priv, p, buf->sec_addr, true);
 	} else {
 		buf->sec_page = NULL;
@@ -1601,6 +1648,14 @@ static void dma_free_rx_xskbufs(struct stmmac_priv *priv,
 		xsk_buff_free(buf->xdp);
 		buf->xdp = NULL;
 	}
+
+	/* A frame still being received holds its buffers off the ring */
+	if (rx_q->state.xdp) {
+		xsk_buff_free(rx_q->state.xdp);
+		rx_q->state.xdp = NULL;
+		rx_q->state.xdp_tail = NULL;
+		rx_q->state_saved = false;
+	}
 }
 
 static int stmmac_alloc_rx_buffers_zc(struct stmmac_priv *priv,
@@ -2028,6 +2083,22 @@ static int __alloc_dma_rx_desc_resources(struct stmmac_priv *priv,
 	pp_params.offset = stmmac_rx_offset(priv);
 	pp_params.max_len = STMMAC_MAX_RX_BUF_SIZE(num_pages);
 
+	/* Share pages between RX buffers when several fit in one, unless
+	 * XDP is in use, which expects a page per frame. Neither the header
+	 * nor the payload buffer of split header needs more than one buffer
+	 * size. Fragments are cache line aligned so that the CPU and device
+	 * never share a line of two buffers. The pool then syncs whole pages
+	 * for the device, as it only does so once all fragments are back.
+	 */
+	rx_q->frag_size = ALIGN(dma_conf->dma_buf_sz, dma_get_cache_alignment());
+	if (!xdp_prog && num_pages == 1 && 2 * rx_q->frag_size <= PAGE_SIZE) {
+		pp_params.flags |= PP_FLAG_PAGE_FRAG;
+		pp_params.offset = 0;
+		pp_params.max_len = PAGE_SIZE;
+	} else {
+		rx_q->frag_size = 0;
+	}
+
 	rx_q->page_pool = page_pool_create(&pp_params);
 	if (IS_ERR(rx_q->page_pool)) {
 		ret = PTR_ERR(rx_q->page_pool);
@@ -2397,7 +2468,7 @@ static void stmmac_dma_operation_mode(struct stmmac_priv *priv)
 				rxfifosz, qmode);
 
 		if (rx_q->xsk_pool) {
-			buf_size = xsk_pool_get_rx_frame_size(rx_q->xsk_pool);
+			buf_size = stmmac_xsk_rx_buf_size(priv, rx_q->xsk_pool);
 			stmmac_set_dma_bfsize(priv, priv->ioaddr,
 					      buf_size,
 					      chan);
@@ -2422,32 +2493,38 @@ static bool stmmac_xdp_xmit_zc(struct stmmac_priv *priv, u32 queue, u32 budget)
 	struct stmmac_tx_queue *tx_q = &priv->dma_conf.tx_queue[queue];
 	struct stmmac_txq_stats *txq_stats = &priv->xstats.txq_stats[queue];
 	struct xsk_buff_pool *pool = tx_q->xsk_pool;
+	struct xdp_desc *descs = pool->tx_descs;
 	unsigned int entry = tx_q->cur_tx;
-	struct dma_desc *tx_desc = NULL;
-	struct xdp_desc xdp_desc;
-	bool work_done = true;
+	unsigned int first_entry = entry;
+	struct dma_desc *first = NULL;
+	unsigned int pkt_len = 0;
 	u32 tx_set_ic_bit = 0;
+	u32 avail, nb_descs, i;
 
 	/* Avoids TX time-out as we are sharing with slow path */
 	txq_trans_cond_update(nq);
 
-	budget = min(budget, stmmac_tx_avail(priv, queue));
+	/* We are sharing with slow path and stop XSK TX desc submission when
+	 * available TX ring is less than threshold.
+	 */
+	avail = stmmac_tx_avail(priv, queue);
+	if (unlikely(avail < STMMAC_TX_XSK_AVAIL) ||
+	    !netif_carrier_ok(priv->dev))
+		return false;
 
-	while (budget-- > 0) {
-		dma_addr_t dma_addr;
-		bool set_ic;
+	budget = min(budget, avail - STMMAC_TX_XSK_AVAIL + 1);
 
-		/* We are sharing with slow path and stop XSK TX desc submission when
-		 * available TX ring is less than threshold.
-		 */
-		if (unlikely(stmmac_tx_avail(priv, queue) < STMMAC_TX_XSK_AVAIL) ||
-		    !netif_carrier_ok(priv->dev)) {
-			work_done = false;
-			break;
-		}
+	/* Only whole packets are handed out, so the OWN bit of the first
+	 * descriptor of a multi-buffer packet can be set once the rest of
+	 * it is ready, as for the slow path.
+	 */
+	nb_descs = xsk_tx_peek_release_desc_batch(pool, budget);
 
-		if (!xsk_tx_peek_desc(pool, &xdp_desc))
-			break;
+	for (i = 0; i < nb_descs; i++) {
+		struct xdp_desc *xdp_desc = &descs[i];
+		struct dma_desc *tx_desc;
+		dma_addr_t dma_addr;
+		bool set_ic, ls;
 
 		if (likely(priv->extend_desc))
 			tx_desc = (struct dma_desc *)(tx_q->dma_etx + entry);
@@ -2456,8 +2533,10 @@ static bool stmmac_xdp_xmit_zc(struct stmmac_priv *priv, u32 queue, u32 budget)
 		else
 			tx_desc = tx_q->dma_tx + entry;
 
-		dma_addr = xsk_buff_raw_get_dma(pool, xdp_desc.addr);
-		xsk_buff_raw_dma_sync_for_device(pool, dma_addr, xdp_desc.len);
+		ls = !(xdp_desc->options & XDP_PKT_CONTD) || i == nb_descs - 1;
+
+		dma_addr = xsk_buff_raw_get_dma(pool, xdp_desc->addr);
+		xsk_buff_raw_dma_sync_for_device(pool, dma_addr, xdp_desc->len);
 
 		tx_q->tx_skbuff_dma[entry].buf_type = STMMAC_TXBUF_T_XSK_TX;
 
@@ -2469,32 +2548,52 @@ static bool stmmac_xdp_xmit_zc(struct stmmac_priv *priv, u32 queue, u32 budget)
 		tx_q->xdpf[entry] = NULL;
 
 		tx_q->tx_skbuff_dma[entry].map_as_page = false;
-		tx_q->tx_skbuff_dma[entry].len = xdp_desc.len;
-		tx_q->tx_skbuff_dma[entry].last_segment = true;
+		tx_q->tx_skbuff_dma[entry].len = xdp_desc->len;
+		tx_q->tx_skbuff_dma[entry].last_segment = ls;
 		tx_q->tx_skbuff_dma[entry].is_jumbo = false;
 
 		stmmac_set_desc_addr(priv, tx_desc, dma_addr);
 
-		tx_q->tx_count_frames++;
+		if (!first) {
+			first = tx_desc;
+			first_entry = entry;
+		}
+		pkt_len += xdp_desc->len;
 
-		if (!priv->tx_coal_frames[queue])
-			set_ic = false;
-		else if (tx_q->tx_count_frames % priv->tx_coal_frames[queue] == 0)
-			set_ic = true;
-		else
-			set_ic = false;
+		if (ls) {
+			tx_q->tx_count_frames++;
 
-		if (set_ic) {
-			tx_q->tx_count_frames = 0;
-			stmmac_set_tx_ic(priv, tx_desc);
-			tx_set_ic_bit++;
+			if (!priv->tx_coal_frames[queue])
+				set_ic = false;
+			else if (tx_q->tx_count_frames % priv->tx_coal_frames[queue] == 0)
+				set_ic = true;
+			else
+				set_ic = false;
+
+			if (set_ic) {
+				tx_q->tx_count_frames = 0;
+				stmmac_set_tx_ic(priv, tx_desc);
+				tx_set_ic_bit++;
+			}
 		}
 
-		stmmac_prepare_tx_desc(priv, tx_desc, 1, xdp_desc.len,
-				       true, priv->mode, true, true,
-				       xdp_desc.len);
+		if (tx_desc != first)
+			stmmac_prepare_tx_desc(priv, tx_desc, 0, xdp_desc->len,
+					       true, priv->mode, true, ls,
+					       xdp_desc->len);
 
-		stmmac_enable_dma_transmission(priv, priv->ioaddr);
+		if (ls) {
+			/* Prepare the first descriptor setting the OWN bit too */
+			stmmac_prepare_tx_desc(priv, first, 1,
+					       tx_q->tx_skbuff_dma[first_entry].len,
+					       true, priv->mode, true,
+					       first == tx_desc, pkt_len);
+
+			stmmac_enable_dma_transmission(priv, priv->ioaddr);
+
+			first = NULL;
+			pkt_len = 0;
+		}
 
 		tx_q->cur_tx = STMMAC_GET_ENTRY(tx_q->cur_tx, priv->dma_conf.dma_tx_size);
 		entry = tx_q->cur_tx;
@@ -2503,17 +2602,13 @@ static bool stmmac_xdp_xmit_zc(struct stmmac_priv *priv, u32 queue, u32 budget)
 	u64_stats_add(&txq_stats->napi.tx_set_ic_bit, tx_set_ic_bit);
 	u64_stats_update_end(&txq_stats->napi_syncp);
 
-	if (tx_desc) {
+	if (nb_descs)
 		stmmac_flush_tx_descriptors(priv, queue);
-		xsk_tx_release(pool);
-	}
 
-	/* Return true if all of the 3 conditions are met
-	 *  a) TX Budget is still available
-	 *  b) work_done = true when XSK TX desc peek is empty (no more
-	 *     pending XSK TX for transmission)
+	/* Return true if the budget was not used up, meaning there is no
+	 * more pending XSK TX for transmission.
 	 */
-	return !!budget && work_done;
+	return nb_descs < budget;
 }
 
 static void stmmac_bump_dma_threshold(struct stmmac_priv *priv, u32 chan)
@@ -2545,11 +2640,16 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 	unsigned int bytes_compl = 0, pkts_compl = 0;
 	unsigned int entry, xmits = 0, count = 0;
 	u32 tx_packets = 0, tx_errors = 0;
+	struct xdp_frame_bulk bq;
 
 	__netif_tx_lock_bh(netdev_get_tx_queue(priv->dev, queue));
 
 	tx_q->xsk_frames_done = 0;
 
+	/* Frames sent through ndo_xdp_xmit are returned in bulk */
+	xdp_frame_bulk_init(&bq);
+	rcu_read_lock();
+
 	entry = tx_q->dirty_tx;
 
 	/* Try to clean all TX complete frame in 1 shot */
@@ -2634,7 +2734,7 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 
 		if (xdpf &&
 		    tx_q->tx_skbuff_dma[entry].buf_type == STMMAC_TXBUF_T_XDP_NDO) {
-			xdp_return_frame(xdpf);
+			xdp_return_frame_bulk(xdpf, &bq);
 			tx_q->xdpf[entry] = NULL;
 		}
 
@@ -2645,7 +2745,12 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 			if (likely(skb)) {
 				pkts_compl++;
 				bytes_compl += skb->len;
-				dev_consume_skb_any(skb);
+				/* Recycled through the per-CPU NAPI skb cache
+				 * and freed in bulk. Zerocopy completions of a
+				 * socket come in order, so they coalesce into
+				 * a single notification range.
+				 */
+				napi_consume_skb(skb, budget);
 				tx_q->tx_skbuff[entry] = NULL;
 			}
 		}
@@ -2656,6 +2761,9 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 	}
 	tx_q->dirty_tx = entry;
 
+	xdp_flush_frame_bulk(&bq);
+	rcu_read_unlock();
+
 	netdev_tx_completed_queue(netdev_get_tx_queue(priv->dev, queue),
 				  pkts_compl, bytes_compl);
 
@@ -3042,6 +3150,8 @@ static void stmmac_init_coalesce(struct stmmac_priv *priv)
 	for (chan = 0; chan < tx_channel_count; chan++) {
 		struct stmmac_tx_queue *tx_q = &priv->dma_conf.tx_queue[chan];
 
+		priv->tx_coal_frames_set[chan] = STMMAC_TX_FRAMES;
+		priv->tx_coal_timer_set[chan] = STMMAC_COAL_TX_TIMER;
 		priv->tx_coal_frames[chan] = STMMAC_TX_FRAMES;
 		priv->tx_coal_timer[chan] = STMMAC_COAL_TX_TIMER;
 
@@ -3049,8 +3159,137 @@ static void stmmac_init_coalesce(struct stmmac_priv *priv)
 		tx_q->txtimer.function = stmmac_tx_timer;
 	}
 
-	for (chan = 0; chan < rx_channel_count; chan++)
+	for (chan = 0; chan < rx_channel_count; chan++) {
+		priv->rx_coal_frames_set[chan] = STMMAC_RX_FRAMES;
 		priv->rx_coal_frames[chan] = STMMAC_RX_FRAMES;
+	}
+}
+
+/**
+ * stmmac_dim_restore - reset coalescing to the values set through ethtool
+ * @priv: driver private structure
+ * Description: the values in use are only different from those while DIM
+ * runs, which starts from the ethtool values again after this.
+ */
+void stmmac_dim_restore(struct stmmac_priv *priv)
+{
+	u32 tx_channel_count = priv->plat->tx_queues_to_use;
+	u32 rx_channel_count = priv->plat->rx_queues_to_use;
+	u32 chan;
+
+	for (chan = 0; chan < tx_channel_count; chan++) {
+		WRITE_ONCE(priv->tx_coal_frames[chan],
+			   priv->tx_coal_frames_set[chan]);
+		WRITE_ONCE(priv->tx_coal_timer[chan],
+			   priv->tx_coal_timer_set[chan]);
+	}
+
+	for (chan = 0; chan < rx_channel_count; chan++) {
+		WRITE_ONCE(priv->rx_coal_frames[chan],
+			   priv->rx_coal_frames_set[chan]);
+
+		if (priv->use_riwt && priv->rx_riwt_set[chan]) {
+			priv->rx_riwt[chan] = priv->rx_riwt_set[chan];
+			stmmac_rx_watchdog(priv, priv->ioaddr,
+					   priv->rx_riwt[chan], chan);
+		}
+	}
+}
+
+/*
+ * DIM picks a moderation profile per queue from the packet rate seen by
+ * NAPI. The profile is applied to the RX watchdog and the TX coalescing,
+ * but never above the values set through ethtool, so DIM only ever trades
+ * interrupts for latency within what the user allowed.
+ */
+static void stmmac_rx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct stmmac_channel *ch =
+		container_of(dim, struct stmmac_channel, rx_dim);
+	struct stmmac_priv *priv = ch->priv_data;
+	struct dim_cq_moder moder;
+	u32 chan = ch->index;
+	u32 riwt, max_riwt;
+
+	moder = net_dim_get_rx_moderation(dim->mode, dim->profile_ix);
+
+	max_riwt = max_t(u32, priv->rx_riwt_set[chan], MIN_DMA_RIWT);
+	riwt = clamp_t(u32, stmmac_usec2riwt(moder.usec, priv),
+		       MIN_DMA_RIWT, max_riwt);
+	if (riwt != priv->rx_riwt[chan]) {
+		priv->rx_riwt[chan] = riwt;
+		stmmac_rx_watchdog(priv, priv->ioaddr, riwt, chan);
+	}
+
+	if (priv->rx_coal_frames_set[chan])
+		WRITE_ONCE(priv->rx_coal_frames[chan],
+			   clamp_t(u32, moder.pkts, 1,
+				   priv->rx_coal_frames_set[chan]));
+
+	dim->state = DIM_START_MEASURE;
+}
+
+static void stmmac_tx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct stmmac_channel *ch =
+		container_of(dim, struct stmmac_channel, tx_dim);
+	struct stmmac_priv *priv = ch->priv_data;
+	struct dim_cq_moder moder;
+	u32 chan = ch->index;
+
+	moder = net_dim_get_tx_moderation(dim->mode, dim->profile_ix);
+
+	if (priv->tx_coal_timer_set[chan])
+		WRITE_ONCE(priv->tx_coal_timer[chan],
+			   clamp_t(u32, moder.usec, 1,
+				   priv->tx_coal_timer_set[chan]));
+	if (priv->tx_coal_frames_set[chan])
+		WRITE_ONCE(priv->tx_coal_frames[chan],
+			   clamp_t(u32, moder.pkts, 1,
+				   priv->tx_coal_frames_set[chan]));
+
+	dim->state = DIM_START_MEASURE;
+}
+
+static void stmmac_rx_dim_update(struct stmmac_priv *priv,
+				 struct stmmac_channel *ch)
+{
+	struct stmmac_rxq_stats *rxq_stats = &priv->xstats.rxq_stats[ch->index];
+	struct dim_sample sample = {};
+
+	if (!priv->rx_dim_enabled || !priv->use_riwt)
+		return;
+
+	/* Only updated from this NAPI context, no need for the syncp */
+	dim_update_sample(++ch->rx_dim_events,
+			  u64_stats_read(&rxq_stats->napi.rx_packets),
+			  u64_stats_read(&rxq_stats->napi.rx_bytes),
+			  &sample);
+	net_dim(&ch->rx_dim, sample);
+}
+
+static void stmmac_tx_dim_update(struct stmmac_priv *priv,
+				 struct stmmac_channel *ch)
+{
+	struct stmmac_txq_stats *txq_stats = &priv->xstats.txq_stats[ch->index];
+	struct dim_sample sample = {};
+	unsigned int start;
+	u64 bytes;
+
+	if (!priv->tx_dim_enabled)
+		return;
+
+	do {
+		start = u64_stats_fetch_begin(&txq_stats->q_syncp);
+		bytes = u64_stats_read(&txq_stats->q.tx_bytes);
+	} while (u64_stats_fetch_retry(&txq_stats->q_syncp, start));
+
+	dim_update_sample(++ch->tx_dim_events,
+			  u64_stats_read(&txq_stats->napi.tx_packets), bytes,
+			  &sample);
+	net_dim(&ch->tx_dim, sample);
 }
 
 static void stmmac_set_rings_length(struct stmmac_priv *priv)
@@ -3385,9 +3624,10 @@ static int stmmac_hw_setup(struct net_device *dev, bool ptp_register)
 		u32 queue;
 
 		for (queue = 0; queue < rx_cnt; queue++) {
-			if (!priv->rx_riwt[queue])
-				priv->rx_riwt[queue] = DEF_DMA_RIWT;
+			if (!priv->rx_riwt_set[queue])
+				priv->rx_riwt_set[queue] = DEF_DMA_RIWT;
 
+			priv->rx_riwt[queue] = priv->rx_riwt_set[queue];
 			stmmac_rx_watchdog(priv, priv->ioaddr,
 					   priv->rx_riwt[queue], queue);
 		}
@@ -3430,6 +3670,8 @@ static int stmmac_hw_setup(struct net_device *dev, bool ptp_register)
 		stmmac_enable_tbs(priv, priv->ioaddr, enable, chan);
 	}
 
+	stmmac_restore_rx_flows(priv);
+
 	/* Configure real RX and TX queues */
 	netif_set_real_num_rx_queues(dev, priv->plat->rx_queues_to_use);
 	netif_set_real_num_tx_queues(dev, priv->plat->tx_queues_to_use);
@@ -4094,7 +4336,8 @@ static void stmmac_tso_allocator(struct stmmac_priv *priv, dma_addr_t des,
 	}
 }
 
-static void stmmac_flush_tx_descriptors(struct stmmac_priv *priv, int queue)
+static void __stmmac_flush_tx_descriptors(struct stmmac_priv *priv, int queue,
+					  unsigned int entry)
 {
 	struct stmmac_tx_queue *tx_q = &priv->dma_conf.tx_queue[queue];
 	int desc_size;
@@ -4112,10 +4355,27 @@ static void stmmac_flush_tx_descriptors(struct stmmac_priv *priv, int queue)
 	 */
 	wmb();
 
-	tx_q->tx_tail_addr = tx_q->dma_tx_phy + (tx_q->cur_tx * desc_size);
+	tx_q->tx_tail_addr = tx_q->dma_tx_phy + (entry * desc_size);
 	stmmac_set_tx_tail_ptr(priv, priv->ioaddr, tx_q->tx_tail_addr, queue);
 }
 
+static void stmmac_flush_tx_descriptors(struct stmmac_priv *priv, int queue)
+{
+	__stmmac_flush_tx_descriptors(priv, queue,
+				      priv->dma_conf.tx_queue[queue].cur_tx);
+}
+
+/* The doorbell of frames queued with xmit_more may still be pending when a
+ * later frame of the burst fails, hand them to the DMA before giving up.
+ */
+static void stmmac_tx_flush_pending(struct stmmac_priv *priv, int queue,
+				    unsigned int first_tx)
+{
+	stmmac_enable_dma_transmission(priv, priv->ioaddr);
+	__stmmac_flush_tx_descriptors(priv, queue, first_tx);
+	stmmac_tx_timer_arm(priv, queue);
+}
+
 /**
  *  stmmac_tso_xmit - Tx entry point of the driver for oversized frames (TSO)
  *  @skb : the socket buffer
@@ -4183,6 +4443,7 @@ static netdev_tx_t stmmac_tso_xmit(struct sk_buff *skb, struct net_device *dev)
 				   "%s: Tx Ring full when queue awake\n",
 				   __func__);
 		}
+		stmmac_tx_flush_pending(priv, queue, first_tx);
 		return NETDEV_TX_BUSY;
 	}
 
@@ -4365,10 +4626,12 @@ static netdev_tx_t stmmac_tso_xmit(struct sk_buff *skb, struct net_device *dev)
 		print_pkt(skb->data, skb_headlen(skb));
 	}
 
-	netdev_tx_sent_queue(netdev_get_tx_queue(dev, queue), skb->len);
-
-	stmmac_flush_tx_descriptors(priv, queue);
-	stmmac_tx_timer_arm(priv, queue);
+	/* Leave the doorbell to the last frame of a burst */
+	if (__netdev_tx_sent_queue(netdev_get_tx_queue(dev, queue), skb->len,
+				   netdev_xmit_more())) {
+		stmmac_flush_tx_descriptors(priv, queue);
+		stmmac_tx_timer_arm(priv, queue);
+	}
 
 	return NETDEV_TX_OK;
 
@@ -4376,6 +4639,7 @@ static netdev_tx_t stmmac_tso_xmit(struct sk_buff *skb, struct net_device *dev)
 	dev_err(priv->device, "Tx dma map failed\n");
 	dev_kfree_skb(skb);
 	priv->xstats.tx_dropped++;
+	stmmac_tx_flush_pending(priv, queue, first_tx);
 	return NETDEV_TX_OK;
 }
 
@@ -4409,6 +4673,33 @@ static bool stmmac_has_ip_ethertype(struct sk_buff *skb)
  *  It programs the chain or the ring and supports oversized frames
  *  and SG feature.
  */
+/**
+ * stmmac_tx_tbs_account - account a frame with a launch time
+ * @priv: driver private structure
+ * @txq_stats: statistics of the TX queue the frame is queued on
+ * @launch: launch time of the frame, in the time base of the PTP clock
+ * Description: the MAC sends frames whose launch time has passed right
+ * away, so they miss their slot in the schedule. Counting them tells a
+ * scheduler running late apart from jitter on the link.
+ */
+static void stmmac_tx_tbs_account(struct stmmac_priv *priv,
+				  struct stmmac_txq_stats *txq_stats,
+				  ktime_t launch)
+{
+	unsigned long flags;
+	u64 now = 0;
+
+	read_lock_irqsave(&priv->ptp_lock, flags);
+	stmmac_get_systime(priv, priv->ptpaddr, &now);
+	read_unlock_irqrestore(&priv->ptp_lock, flags);
+
+	u64_stats_update_begin(&txq_stats->q_syncp);
+	u64_stats_inc(&txq_stats->q.tx_tbs_n);
+	if (ktime_to_ns(launch) <= now)
+		u64_stats_inc(&txq_stats->q.tx_tbs_late);
+	u64_stats_update_end(&txq_stats->q_syncp);
+}
+
 static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 {
 	unsigned int first_entry, tx_packets, enh_desc;
@@ -4450,6 +4741,7 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 				   "%s: Tx Ring full when queue awake\n",
 				   __func__);
 		}
+		stmmac_tx_flush_pending(priv, queue, first_tx);
 		return NETDEV_TX_BUSY;
 	}
 
@@ -4643,16 +4935,19 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 
 		tbs_desc = &tx_q->dma_entx[first_entry];
 		stmmac_set_desc_tbs(priv, tbs_desc, ts.tv_sec, ts.tv_nsec);
+		stmmac_tx_tbs_account(priv, txq_stats, skb->tstamp);
 	}
 
 	stmmac_set_tx_owner(priv, first);
 
-	netdev_tx_sent_queue(netdev_get_tx_queue(dev, queue), skb->len);
-
-	stmmac_enable_dma_transmission(priv, priv->ioaddr);
+	/* Leave the doorbell to the last frame of a burst */
+	if (__netdev_tx_sent_queue(netdev_get_tx_queue(dev, queue), skb->len,
+				   netdev_xmit_more())) {
+		stmmac_enable_dma_transmission(priv, priv->ioaddr);
 
-	stmmac_flush_tx_descriptors(priv, queue);
-	stmmac_tx_timer_arm(priv, queue);
+		stmmac_flush_tx_descriptors(priv, queue);
+		stmmac_tx_timer_arm(priv, queue);
+	}
 
 	return NETDEV_TX_OK;
 
@@ -4660,6 +4955,7 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 	netdev_err(priv->dev, "Tx DMA map failed\n");
 	dev_kfree_skb(skb);
 	priv->xstats.tx_dropped++;
+	stmmac_tx_flush_pending(priv, queue, first_tx);
 	return NETDEV_TX_OK;
 }
 
@@ -4709,17 +5005,22 @@ static inline void stmmac_rx_refill(struct stmmac_priv *priv, u32 queue)
 			p = rx_q->dma_rx + entry;
 
 		if (!buf->page) {
-			buf->page = page_pool_alloc_pages(rx_q->page_pool, gfp);
+			buf->page = stmmac_rx_page_alloc(rx_q, &buf->page_offset,
+							 gfp);
 			if (!buf->page)
 				break;
+			buf->page_offset += stmmac_rx_offset(priv);
 		}
 
 		if (priv->sph && !buf->sec_page) {
-			buf->sec_page = page_pool_alloc_pages(rx_q->page_pool, gfp);
+			buf->sec_page = stmmac_rx_page_alloc(rx_q,
+							     &buf->sec_page_offset,
+							     gfp);
 			if (!buf->sec_page)
 				break;
 
-			buf->sec_addr = page_pool_get_dma_addr(buf->sec_page);
+			buf->sec_addr = page_pool_get_dma_addr(buf->sec_page) +
+					buf->sec_page_offset;
 		}
 
 		buf->addr = page_pool_get_dma_addr(buf->page) + buf->page_offset;
@@ -4893,12 +5194,19 @@ static int stmmac_xdp_get_tx_queue(struct stmmac_priv *priv,
 static int stmmac_xdp_xmit_back(struct stmmac_priv *priv,
 				struct xdp_buff *xdp)
 {
-	struct xdp_frame *xdpf = xdp_convert_buff_to_frame(xdp);
 	int cpu = smp_processor_id();
+	struct xdp_frame *xdpf;
 	struct netdev_queue *nq;
 	int queue;
 	int res;
 
+	/* Only AF_XDP zero-copy frames span several buffers, and those can't
+	 * be converted to a frame whole.
+	 */
+	if (unlikely(xdp_buff_has_frags(xdp)))
+		return STMMAC_XDP_CONSUMED;
+
+	xdpf = xdp_convert_buff_to_frame(xdp);
 	if (unlikely(!xdpf))
 		return STMMAC_XDP_CONSUMED;
 
@@ -4990,10 +5298,14 @@ static struct sk_buff *stmmac_construct_skb_zc(struct stmmac_channel *ch,
 {
 	unsigned int metasize = xdp->data - xdp->data_meta;
 	unsigned int datasize = xdp->data_end - xdp->data;
+	struct skb_shared_info *sinfo;
+	struct xdp_buff *frag;
 	struct sk_buff *skb;
+	int i;
 
 	skb = __napi_alloc_skb(&ch->rxtx_napi,
-			       xdp->data_end - xdp->data_hard_start,
+			       xdp->data - xdp->data_hard_start +
+			       xdp_get_buff_len(xdp),
 			       GFP_ATOMIC | __GFP_NOWARN);
 	if (unlikely(!skb))
 		return NULL;
@@ -5003,6 +5315,22 @@ static struct sk_buff *stmmac_construct_skb_zc(struct stmmac_channel *ch,
 	if (metasize)
 		skb_metadata_set(skb, metasize);
 
+	if (likely(!xdp_buff_has_frags(xdp)))
+		return skb;
+
+	/* The rest of a multi-buffer frame is copied in as well, the XSK
+	 * buffers of the fragments go back to the pool as they are done.
+	 */
+	sinfo = xdp_get_shared_info_from_buff(xdp);
+	for (i = 0; i < sinfo->nr_frags; i++) {
+		frag = xsk_buff_get_frag(xdp);
+		if (!frag)
+			break;
+
+		skb_put_data(skb, frag->data, skb_frag_size(&sinfo->frags[i]));
+		xsk_buff_free(frag);
+	}
+
 	return skb;
 }
 
@@ -5012,7 +5340,7 @@ static void stmmac_dispatch_skb_zc(struct stmmac_priv *priv, u32 queue,
 {
 	struct stmmac_rxq_stats *rxq_stats = &priv->xstats.rxq_stats[queue];
 	struct stmmac_channel *ch = &priv->channel[queue];
-	unsigned int len = xdp->data_end - xdp->data;
+	unsigned int len = xdp_get_buff_len(xdp);
 	enum pkt_hash_types hash_type;
 	int coe = priv->hw->rx_csum;
 	struct sk_buff *skb;
@@ -5113,12 +5441,69 @@ static struct stmmac_xdp_buff *xsk_buff_to_stmmac_ctx(struct xdp_buff *xdp)
 	return (struct stmmac_xdp_buff *)xdp;
 }
 
+static unsigned int stmmac_rx_buf_len_zc(struct stmmac_priv *priv,
+					 struct stmmac_rx_queue *rx_q,
+					 struct dma_desc *p,
+					 int status, unsigned int len)
+{
+	unsigned int size = stmmac_xsk_rx_buf_size(priv, rx_q->xsk_pool);
+	unsigned int plen;
+
+	/* Not last descriptor, the buffer is full */
+	if (status & rx_not_ls)
+		return size;
+
+	/* Last descriptor, holds what the earlier ones did not */
+	plen = stmmac_get_rx_frame_len(priv, p, priv->hw->rx_csum);
+
+	return min(size, plen - min(plen, len));
+}
+
+static int stmmac_xsk_add_frag(struct xdp_buff *first, struct xdp_buff *xdp,
+			       unsigned int size)
+{
+	struct skb_shared_info *sinfo = xdp_get_shared_info_from_buff(first);
+
+	if (!xdp_buff_has_frags(first)) {
+		sinfo->nr_frags = 0;
+		sinfo->xdp_frags_size = 0;
+		xdp_buff_set_frags_flag(first);
+	}
+
+	if (unlikely(sinfo->nr_frags == MAX_SKB_FRAGS))
+		return -ENOMEM;
+
+	__skb_fill_page_desc_noacc(sinfo, sinfo->nr_frags++,
+				   virt_to_page(xdp->data_hard_start),
+				   xdp->data - xdp->data_hard_start, size);
+	sinfo->xdp_frags_size += size;
+	xsk_buff_add_frag(xdp);
+
+	return 0;
+}
+
+/* The FCS may start in the buffer before the last one of a frame */
+static void stmmac_xsk_trim_tail(struct xdp_buff *first, struct xdp_buff *tail,
+				 unsigned int trim)
+{
+	struct skb_shared_info *sinfo;
+
+	tail->data_end -= trim;
+	if (!xdp_buff_has_frags(first))
+		return;
+
+	sinfo = xdp_get_shared_info_from_buff(first);
+	skb_frag_size_sub(&sinfo->frags[sinfo->nr_frags - 1], trim);
+	sinfo->xdp_frags_size -= trim;
+}
+
 static int stmmac_rx_zc(struct stmmac_priv *priv, int limit, u32 queue)
 {
 	struct stmmac_rxq_stats *rxq_stats = &priv->xstats.rxq_stats[queue];
 	struct stmmac_rx_queue *rx_q = &priv->dma_conf.rx_queue[queue];
 	unsigned int count = 0, error = 0, len = 0;
 	int dirty = stmmac_rx_dirty(priv, queue);
+	struct xdp_buff *first = NULL, *tail = NULL;
 	unsigned int next_entry = rx_q->cur_rx;
 	u32 rx_errors = 0, rx_dropped = 0;
 	unsigned int desc_size;
@@ -5151,10 +5536,14 @@ static int stmmac_rx_zc(struct stmmac_priv *priv, int limit, u32 queue)
 		int res;
 
 		if (!count && rx_q->state_saved) {
+			first = rx_q->state.xdp;
+			tail = rx_q->state.xdp_tail;
 			error = rx_q->state.error;
 			len = rx_q->state.len;
 		} else {
 			rx_q->state_saved = false;
+			first = NULL;
+			tail = NULL;
 			error = 0;
 			len = 0;
 		}
@@ -5212,34 +5601,34 @@ static int stmmac_rx_zc(struct stmmac_priv *priv, int limit, u32 queue)
 				rx_errors++;
 		}
 
+		if (unlikely(error && first)) {
+			xsk_buff_free(first);
+			first = NULL;
+			tail = NULL;
+		}
+
 		if (unlikely(error && (status & rx_not_ls)))
 			goto read_again;
 		if (unlikely(error)) {
+			error = 0;
 			count++;
 			continue;
 		}
 
-		/* XSK pool expects RX frame 1:1 mapped to XSK buffer */
-		if (likely(status & rx_not_ls)) {
-			xsk_buff_free(buf->xdp);
-			buf->xdp = NULL;
-			dirty++;
-			count++;
-			goto read_again;
-		}
-
-		ctx = xsk_buff_to_stmmac_ctx(buf->xdp);
-		ctx->priv = priv;
-		ctx->desc = p;
-		ctx->ndesc = np;
-
 		/* XDP ZC Frame only support primary buffers for now */
-		buf1_len = stmmac_rx_buf1_len(priv, p, status, len);
+		buf1_len = stmmac_rx_buf_len_zc(priv, rx_q, p, status, len);
 		len += buf1_len;
 
 		/* ACS is disabled; strip manually. */
 		if (likely(!(status & rx_not_ls))) {
-			buf1_len -= ETH_FCS_LEN;
+			if (unlikely(buf1_len < ETH_FCS_LEN)) {
+				if (first)
+					stmmac_xsk_trim_tail(first, tail,
+							     ETH_FCS_LEN - buf1_len);
+				buf1_len = 0;
+			} else {
+				buf1_len -= ETH_FCS_LEN;
+			}
 			len -= ETH_FCS_LEN;
 		}
 
@@ -5247,16 +5636,54 @@ static int stmmac_rx_zc(struct stmmac_priv *priv, int limit, u32 queue)
 		buf->xdp->data_end = buf->xdp->data + buf1_len;
 		xsk_buff_dma_sync_for_cpu(buf->xdp, rx_q->xsk_pool);
 
+		/* Frames spanning several descriptors are chained as fragments
+		 * of the XSK buffer of the first one.
+		 */
+		if (!first) {
+			first = buf->xdp;
+			tail = first;
+		} else if (!buf1_len) {
+			xsk_buff_free(buf->xdp);
+		} else if (stmmac_xsk_add_frag(first, buf->xdp, buf1_len)) {
+			xsk_buff_free(buf->xdp);
+			xsk_buff_free(first);
+			first = NULL;
+			tail = NULL;
+			error = 1;
+			rx_dropped++;
+		} else {
+			tail = buf->xdp;
+		}
+
+		buf->xdp = NULL;
+		dirty++;
+
+		if (unlikely(error && (status & rx_not_ls)))
+			goto read_again;
+		if (unlikely(error)) {
+			error = 0;
+			count++;
+			continue;
+		}
+
+		if (status & rx_not_ls)
+			goto read_again;
+
+		ctx = xsk_buff_to_stmmac_ctx(first);
+		ctx->priv = priv;
+		ctx->desc = p;
+		ctx->ndesc = np;
+
 		prog = READ_ONCE(priv->xdp_prog);
-		res = __stmmac_xdp_run_prog(priv, prog, buf->xdp);
+		res = __stmmac_xdp_run_prog(priv, prog, first);
 
 		switch (res) {
 		case STMMAC_XDP_PASS:
-			stmmac_dispatch_skb_zc(priv, queue, p, np, buf->xdp);
-			xsk_buff_free(buf->xdp);
+			stmmac_dispatch_skb_zc(priv, queue, p, np, first);
+			xsk_buff_free(first);
 			break;
 		case STMMAC_XDP_CONSUMED:
-			xsk_buff_free(buf->xdp);
+			xsk_buff_free(first);
 			rx_dropped++;
 			break;
 		case STMMAC_XDP_TX:
@@ -5265,12 +5692,15 @@ static int stmmac_rx_zc(struct stmmac_priv *priv, int limit, u32 queue)
 			break;
 		}
 
-		buf->xdp = NULL;
-		dirty++;
+		first = NULL;
+		tail = NULL;
 		count++;
 	}
 
-	if (status & rx_not_ls) {
+	/* Keep what was received of a frame the DMA is still writing */
+	rx_q->state.xdp = first;
+	rx_q->state.xdp_tail = tail;
+	if (first || error) {
 		rx_q->state_saved = true;
 		rx_q->state.error = error;
 		rx_q->state.len = len;
@@ -5322,7 +5752,8 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 	int buf_sz;
 
 	dma_dir = page_pool_get_dma_dir(rx_q->page_pool);
-	buf_sz = DIV_ROUND_UP(priv->dma_conf.dma_buf_sz, PAGE_SIZE) * PAGE_SIZE;
+	buf_sz = rx_q->frag_size ? :
+		 DIV_ROUND_UP(priv->dma_conf.dma_buf_sz, PAGE_SIZE) * PAGE_SIZE;
 	limit = min(priv->dma_conf.dma_rx_size - 1, (unsigned int)limit);
 
 	if (netif_msg_rx_status(priv)) {
@@ -5413,7 +5844,8 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 
 		prefetch(page_address(buf->page) + buf->page_offset);
 		if (buf->sec_page)
-			prefetch(page_address(buf->sec_page));
+			prefetch(page_address(buf->sec_page) +
+				 buf->sec_page_offset);
 
 		buf1_len = stmmac_rx_buf1_len(priv, p, status, len);
 		len += buf1_len;
@@ -5522,8 +5954,8 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 			dma_sync_single_for_cpu(priv->device, buf->sec_addr,
 						buf2_len, dma_dir);
 			skb_add_rx_frag(skb, skb_shinfo(skb)->nr_frags,
-					buf->sec_page, 0, buf2_len,
-					priv->dma_conf.dma_buf_sz);
+					buf->sec_page, buf->sec_page_offset,
+					buf2_len, priv->dma_conf.dma_buf_sz);
 
 			/* Data payload appended into SKB */
 			skb_mark_for_recycle(skb);
@@ -5600,6 +6032,8 @@ static int stmmac_napi_poll_rx(struct napi_struct *napi, int budget)
 	if (work_done < budget && napi_complete_done(napi, work_done)) {
 		unsigned long flags;
 
+		stmmac_rx_dim_update(priv, ch);
+
 		spin_lock_irqsave(&ch->lock, flags);
 		stmmac_enable_dma_irq(priv, priv->ioaddr, chan, 1, 0);
 		spin_unlock_irqrestore(&ch->lock, flags);
@@ -5628,6 +6062,8 @@ static int stmmac_napi_poll_tx(struct napi_struct *napi, int budget)
 	if (work_done < budget && napi_complete_done(napi, work_done)) {
 		unsigned long flags;
 
+		stmmac_tx_dim_update(priv, ch);
+
 		spin_lock_irqsave(&ch->lock, flags);
 		stmmac_enable_dma_irq(priv, priv->ioaddr, chan, 0, 1);
 		spin_unlock_irqrestore(&ch->lock, flags);
@@ -5740,7 +6176,8 @@ static int stmmac_change_mtu(struct net_device *dev, int new_mtu)
 
 	txfifosz /= priv->plat->tx_queues_to_use;
 
-	if (stmmac_xdp_is_enabled(priv) && new_mtu > ETH_DATA_LEN) {
+	if (stmmac_xdp_is_enabled(priv) && new_mtu > ETH_DATA_LEN &&
+	    !priv->xdp_prog->aux->xdp_has_frags) {
 		netdev_dbg(priv->dev, "Jumbo frames not supported for XDP\n");
 		return -EINVAL;
 	}
@@ -5827,6 +6264,9 @@ static int stmmac_set_features(struct net_device *netdev,
 	 */
 	stmmac_rx_ipc(priv, priv->hw);
 
+	if (!(features & NETIF_F_NTUPLE) && (netdev->features & NETIF_F_NTUPLE))
+		stmmac_del_rx_flows(priv);
+
 	if (priv->sph_cap) {
 		bool sph_en = (priv->hw->rx_csum > 0) && priv->sph;
 		u32 chan;
@@ -6694,7 +7134,7 @@ void stmmac_enable_rx_queue(struct stmmac_priv *priv, u32 queue)
 			       rx_q->rx_tail_addr, rx_q->queue_index);
 
 	if (rx_q->xsk_pool && rx_q->buf_alloc_num) {
-		buf_size = xsk_pool_get_rx_frame_size(rx_q->xsk_pool);
+		buf_size = stmmac_xsk_rx_buf_size(priv, rx_q->xsk_pool);
 		stmmac_set_dma_bfsize(priv, priv->ioaddr,
 				      buf_size,
 				      rx_q->queue_index);
@@ -6849,7 +7289,7 @@ int stmmac_xdp_open(struct net_device *dev)
 				       rx_q->rx_tail_addr, chan);
 
 		if (rx_q->xsk_pool && rx_q->buf_alloc_num) {
-			buf_size = xsk_pool_get_rx_frame_size(rx_q->xsk_pool);
+			buf_size = stmmac_xsk_rx_buf_size(priv, rx_q->xsk_pool);
 			stmmac_set_dma_bfsize(priv, priv->ioaddr,
 					      buf_size,
 					      rx_q->queue_index);
@@ -7151,6 +7591,99 @@ static int stmmac_hw_init(struct stmmac_priv *priv)
 	return 0;
 }
 
+static void stmmac_napi_thread_config(struct stmmac_priv *priv,
+				      struct napi_struct *napi,
+				      bool use_cpu, u32 cpu)
+{
+	struct sched_attr attr = {
+		.size = sizeof(attr),
+		.sched_policy = SCHED_NORMAL,
+	};
+	int ret;
+
+	if (!napi->thread)
+		return;
+
+	if (use_cpu) {
+		if (cpu < nr_cpu_ids && cpu_possible(cpu))
+			set_cpus_allowed_ptr(napi->thread, cpumask_of(cpu));
+		else
+			netdev_warn(priv->dev, "Invalid NAPI CPU %u\n", cpu);
+	}
+
+	if (priv->napi_rt) {
+		attr.sched_policy = SCHED_FIFO;
+		attr.sched_priority = priv->plat->napi_rt_prio ?: MAX_RT_PRIO / 2;
+	}
+
+	ret = sched_setattr_nocheck(napi->thread, &attr);
+	if (ret)
+		netdev_warn(priv->dev, "Failed to set NAPI thread policy (%d)\n",
+			    ret);
+}
+
+/**
+ * stmmac_napi_threads_config - set up the NAPI threads
+ * @priv: driver private structure
+ * Description: binds the NAPI thread of each queue to the CPU the platform
+ * gave for it, and makes it SCHED_FIFO or SCHED_OTHER depending on
+ * priv->napi_rt. Channels serving both directions through rxtx_napi use the
+ * CPU of their RX queue. Nothing is done for NAPI contexts without a thread,
+ * so this is a no-op unless threaded mode is on.
+ */
+void stmmac_napi_threads_config(struct stmmac_priv *priv)
+{
+	u32 rx_cnt = priv->plat->rx_queues_to_use;
+	u32 tx_cnt = priv->plat->tx_queues_to_use;
+	u32 queue, maxq;
+
+	maxq = max(rx_cnt, tx_cnt);
+
+	for (queue = 0; queue < maxq; queue++) {
+		struct stmmac_rxq_cfg *rxq = &priv->plat->rx_queues_cfg[queue];
+		struct stmmac_txq_cfg *txq = &priv->plat->tx_queues_cfg[queue];
+		struct stmmac_channel *ch = &priv->channel[queue];
+
+		if (queue < rx_cnt) {
+			stmmac_napi_thread_config(priv, &ch->rx_napi,
+						  rxq->use_napi_cpu,
+						  rxq->napi_cpu);
+		}
+		if (queue < tx_cnt) {
+			stmmac_napi_thread_config(priv, &ch->tx_napi,
+						  txq->use_napi_cpu,
+						  txq->napi_cpu);
+		}
+		if (queue < rx_cnt && queue < tx_cnt) {
+			stmmac_napi_thread_config(priv, &ch->rxtx_napi,
+						  rxq->use_napi_cpu,
+						  rxq->napi_cpu);
+		}
+	}
+}
+
+/**
+ * stmmac_set_napi_threaded - switch NAPI between softirq and threads
+ * @priv: driver private structure
+ * @threaded: run NAPI in kernel threads
+ * Description: the threads are created the first time threaded mode is
+ * turned on and kept, along with their affinity and policy, when it is
+ * turned off again.
+ */
+int stmmac_set_napi_threaded(struct stmmac_priv *priv, bool threaded)
+{
+	int ret;
+
+	ret = dev_set_threaded(priv->dev, threaded);
+	if (ret)
+		return ret;
+
+	if (threaded)
+		stmmac_napi_threads_config(priv);
+
+	return 0;
+}
+
 static void stmmac_napi_add(struct net_device *dev)
 {
 	struct stmmac_priv *priv = netdev_priv(dev);
@@ -7165,6 +7698,11 @@ static void stmmac_napi_add(struct net_device *dev)
 		ch->index = queue;
 		spin_lock_init(&ch->lock);
 
+		INIT_WORK(&ch->rx_dim.work, stmmac_rx_dim_work);
+		ch->rx_dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+		INIT_WORK(&ch->tx_dim.work, stmmac_tx_dim_work);
+		ch->tx_dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+
 		if (queue < priv->plat->rx_queues_to_use) {
 			netif_napi_add(dev, &ch->rx_napi, stmmac_napi_poll_rx);
 		}
@@ -7178,6 +7716,9 @@ static void stmmac_napi_add(struct net_device *dev)
 				       stmmac_napi_poll_rxtx);
 		}
 	}
+
+	/* New NAPI contexts get new threads in threaded mode */
+	stmmac_napi_threads_config(priv);
 }
 
 static void stmmac_napi_del(struct net_device *dev)
@@ -7477,13 +8018,18 @@ int stmmac_dvr_probe(struct device *device,
 	ndev->hw_features = NETIF_F_SG | NETIF_F_IP_CSUM | NETIF_F_IPV6_CSUM |
 			    NETIF_F_RXCSUM;
 	ndev->xdp_features = NETDEV_XDP_ACT_BASIC | NETDEV_XDP_ACT_REDIRECT |
-			     NETDEV_XDP_ACT_XSK_ZEROCOPY;
+			     NETDEV_XDP_ACT_XSK_ZEROCOPY | NETDEV_XDP_ACT_RX_SG;
+	ndev->xdp_zc_max_segs = MAX_SKB_FRAGS;
 
 	ret = stmmac_tc_init(priv, priv);
 	if (!ret) {
 		ndev->hw_features |= NETIF_F_HW_TC;
 	}
 
+	/* ntuple rules steer flows to RX queues with the L3/L4 filters */
+	if (priv->flow_entries && priv->hw->mac->config_l3l4_dma_chan)
+		ndev->hw_features |= NETIF_F_NTUPLE;
+
 	if ((priv->plat->flags & STMMAC_FLAG_TSO_EN) && (priv->dma_cap.tsoen)) {
 		ndev->hw_features |= NETIF_F_TSO | NETIF_F_TSO6;
 		if (priv->plat->has_gmac4)
@@ -7647,6 +8193,14 @@ int stmmac_dvr_probe(struct device *device,
 		goto error_netdev_register;
 	}
 
+	/* The NAPI threads are named after the interface, so they can only be
+	 * created once it is registered.
+	 */
+	priv->napi_rt = !!priv->plat->napi_rt_prio;
+	if ((priv->plat->flags & STMMAC_FLAG_NAPI_THREADED) &&
+	    stmmac_set_napi_threaded(priv, true))
+		netdev_warn(ndev, "Failed to enable threaded NAPI\n");
+
 #ifdef CONFIG_DEBUG_FS
 	stmmac_init_fs(ndev);
 #endif
@@ -16,6 +16,7 @@
 #include <linux/of.h>
 #include <linux/of_net.h>
 #include <linux/of_mdio.h>
+#include <linux/sched/prio.h>
 
 #include "stmmac.h"
 #include "stmmac_platform.h"
@@ -198,6 +199,10 @@ static int stmmac_mtl_setup(struct platform_device *pdev,
 			plat->rx_queues_cfg[queue].use_prio = true;
 		}
 
+		if (!of_property_read_u32(q_node, "snps,napi-cpu",
+					  &plat->rx_queues_cfg[queue].napi_cpu))
+			plat->rx_queues_cfg[queue].use_napi_cpu = true;
+
 		/* RX queue specific packet type routing */
 		if (of_property_read_bool(q_node, "snps,route-avcp"))
 			plat->rx_queues_cfg[queue].pkt_route = PACKET_AVCPQ;
@@ -279,6 +284,10 @@ static int stmmac_mtl_setup(struct platform_device *pdev,
 		plat->tx_queues_cfg[queue].coe_unsupported =
 			of_property_read_bool(q_node, "snps,coe-unsupported");
 
+		if (!of_property_read_u32(q_node, "snps,napi-cpu",
+					  &plat->tx_queues_cfg[queue].napi_cpu))
+			plat->tx_queues_cfg[queue].use_napi_cpu = true;
+
 		queue++;
 	}
 	if (queue != plat->tx_queues_to_use) {
@@ -487,6 +496,16 @@ stmmac_probe_config_dt(struct platform_device *pdev, u8 *mac)
 	if (of_property_read_bool(np, "snps,en-tx-lpi-clockgating"))
 		plat->flags |= STMMAC_FLAG_EN_TX_LPI_CLOCKGATING;
 
+	/* Run NAPI in kernel threads, optionally real-time ones, rather than
+	 * in softirq context on whichever CPU took the channel interrupt.
+	 */
+	if (of_property_read_bool(np, "snps,napi-threaded"))
+		plat->flags |= STMMAC_FLAG_NAPI_THREADED;
+	if (!of_property_read_u32(np, "snps,napi-rt-priority",
+				  &plat->napi_rt_prio))
+		plat->napi_rt_prio = min_t(u32, plat->napi_rt_prio,
+					   MAX_RT_PRIO - 1);
+
 	/* Set the maxmtu to a default of JUMBO_LEN in case the
 	 * parameter is not present in the device tree.
 	 */
@@ -1101,6 +1101,10 @@ static int tc_setup_etf(struct stmmac_priv *priv,
 		return -EINVAL;
 	if (!(priv->dma_conf.tx_queue[qopt->queue].tbs & STMMAC_TBS_AVAIL))
 		return -EINVAL;
+	/* Launch times are compared against the PTP system time */
+	if (qopt->enable && !priv->dma_cap.time_stamp &&
+	    !priv->dma_cap.atime_stamp)
+		return -EOPNOTSUPP;
 
 	if (qopt->enable)
 		priv->dma_conf.tx_queue[qopt->queue].tbs |= STMMAC_TBS_EN;
@@ -19,8 +19,8 @@ static int stmmac_xdp_enable_pool(struct stmmac_priv *priv,
 		return -EINVAL;
 
 	frame_size = xsk_pool_get_rx_frame_size(pool);
-	/* XDP ZC does not span multiple frame, make sure XSK pool buffer
-	 * size can at least store Q-in-Q frame.
+	/* Only jumbo frames span several XSK buffers, make sure XSK pool
+	 * buffer size can at least store Q-in-Q frame.
 	 */
 	if (frame_size < ETH_FRAME_LEN + VLAN_HLEN * 2)
 		return -EOPNOTSUPP;
@@ -109,9 +109,9 @@ int stmmac_xdp_set_prog(struct stmmac_priv *priv, struct bpf_prog *prog,
 
 	if_running = netif_running(dev);
 
-	if (prog && dev->mtu > ETH_DATA_LEN) {
-		/* For now, the driver doesn't support XDP functionality with
-		 * jumbo frames so we return error.
+	if (prog && dev->mtu > ETH_DATA_LEN && !prog->aux->xdp_has_frags) {
+		/* Jumbo frames may span several buffers on AF_XDP zero-copy
+		 * queues, which only programs handling fragments cope with.
 		 */
 		NL_SET_ERR_MSG_MOD(extack, "Jumbo frames not supported");
 		return -EOPNOTSUPP;
@@ -129,7 +129,8 @@ int stmmac_xdp_set_prog(struct stmmac_priv *priv, struct bpf_prog *prog,
 		bpf_prog_put(old_prog);
 
 	/* Disable RX SPH for XDP operation */
-	priv->sph = priv->sph_cap && !stmmac_xdp_is_enabled(priv);
+	priv->sph = priv->sph_cap && !priv->sph_disabled &&
+		    !stmmac_xdp_is_enabled(priv);
 
 	if (if_running && need_update)
 		stmmac_xdp_open(dev);
@@ -382,6 +382,7 @@ static void mhi_net_rx_refill_work(struct work_struct *work)
 	struct mhi_mbim_context *mbim = container_of(work, struct mhi_mbim_context,
 						     rx_refill.work);
 	struct mhi_device *mdev = mbim->mdev;
+	int queued = 0;
 	int err;
 
 	while (!mhi_queue_is_full(mdev, DMA_FROM_DEVICE)) {
@@ -391,11 +392,12 @@ static void mhi_net_rx_refill_work(struct work_struct *work)
 			break;
 
 		err = mhi_queue_skb(mdev, DMA_FROM_DEVICE, skb,
-				    mbim->mru, MHI_EOT);
+				    mbim->mru, MHI_EOT | MHI_DEFER_DB);
 		if (unlikely(err)) {
 			kfree_skb(skb);
 			break;
 		}
+		queued++;
 
 		/* Do not hog the CPU if rx buffers are consumed faster than
 		 * queued (unlikely).
@@ -403,6 +405,10 @@ static void mhi_net_rx_refill_work(struct work_struct *work)
 		cond_resched();
 	}
 
+	/* Let the device know about all the new buffers at once */
+	if (queued)
+		mhi_queue_flush(mdev, DMA_FROM_DEVICE);
+
 	/* If we're still starved of rx buffers, reschedule later */
 	if (mhi_get_free_desc_count(mdev, DMA_FROM_DEVICE) == mbim->rx_queue_sz)
 		schedule_delayed_work(&mbim->rx_refill, HZ / 2);
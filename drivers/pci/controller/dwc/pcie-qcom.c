@@ -8,6 +8,7 @@
  * Author: Stanimir Varbanov <svarbanov@mm-sol.com>
  */
 
+#include <linux/bitfield.h>
 #include <linux/clk.h>
 #include <linux/crc8.h>
 #include <linux/debugfs.h>
@@ -30,6 +31,7 @@
 #include <linux/reset.h>
 #include <linux/slab.h>
 #include <linux/types.h>
+#include <linux/workqueue.h>
 #include <soc/qcom/cmd-db.h>
 #include <linux/notifier.h>
 
@@ -86,6 +88,15 @@
 #define L23_CLK_RMV_DIS				BIT(2)
 #define L1_CLK_RMV_DIS				BIT(1)
 
+/* L1 PM Substates Control 2 register fields */
+#define L1SS_CTL2_T_PWR_ON_SCALE		GENMASK(1, 0)
+#define L1SS_CTL2_T_PWR_ON_VALUE		GENMASK(7, 3)
+
+/* Dynamic L1ss policy */
+#define L1SS_POLL_MS				100
+#define L1SS_BUSY_THRESHOLD			100 /* L1 entries per poll */
+#define L1SS_IDLE_POLLS				10
+
 /* PARF_PM_CTRL register fields */
 #define REQ_NOT_ENTR_L1				BIT(5) /* "Prevent L0->L1" */
 
@@ -254,6 +265,20 @@ struct qcom_pcie {
 	struct dentry *debugfs;
 	bool suspended;
 	bool soc_is_rpmh;
+
+	/* Dynamic L1ss policy, see qcom_pcie_l1ss_work() */
+	struct delayed_work l1ss_work;
+	bool l1ss_dynamic;
+	bool l1ss_off;
+	u32 l1ss_busy_threshold;
+	unsigned int l1ss_idle_polls;
+	u32 l1ss_last_l1;
+	u32 l1ss_last_l12;
+	u64 l1ss_on_ms;
+	u64 l1ss_off_ms;
+	u64 l1ss_l12_entries;
+	u32 l1ss_switches;
+	u32 l1ss_ltr_blocked;
 };
 
 #define to_qcom_pcie(x)		dev_get_drvdata((x)->dev)
@@ -1468,6 +1493,146 @@ static int qcom_pcie_link_transition_count(struct seq_file *s, void *data)
 	return 0;
 }
 
+/* Returns the device at the other end of the root port's link, with a ref */
+static struct pci_dev *qcom_pcie_l1ss_link_dev(struct qcom_pcie *pcie)
+{
+	struct pci_bus *bus = pcie->pci->pp.bridge->bus;
+	struct pci_dev *root, *pdev = NULL;
+
+	root = pci_get_slot(bus, PCI_DEVFN(0, 0));
+	if (!root)
+		return NULL;
+
+	if (root->subordinate)
+		pdev = pci_get_slot(root->subordinate, PCI_DEVFN(0, 0));
+	pci_dev_put(root);
+
+	return pdev;
+}
+
+/*
+ * Whether the latency the device says it tolerates, through LTR, is less than
+ * it takes to power the link back on from L1.2.
+ */
+static bool qcom_pcie_l1ss_ltr_blocks(struct pci_dev *pdev)
+{
+	static const u32 scale_us[] = { 2, 10, 100 };
+	u32 ctl2, scale, t_pwr_on_ns;
+	u64 ltr_ns;
+	int ltr;
+	u16 lat;
+
+	ltr = pci_find_ext_capability(pdev, PCI_EXT_CAP_ID_LTR);
+	if (!ltr || !pdev->l1ss)
+		return false;
+
+	pci_read_config_word(pdev, ltr + PCI_LTR_MAX_SNOOP_LAT, &lat);
+	pci_read_config_dword(pdev, pdev->l1ss + PCI_L1SS_CTL2, &ctl2);
+
+	scale = FIELD_GET(L1SS_CTL2_T_PWR_ON_SCALE, ctl2);
+	if (scale >= ARRAY_SIZE(scale_us))
+		return false;
+
+	t_pwr_on_ns = FIELD_GET(L1SS_CTL2_T_PWR_ON_VALUE, ctl2) *
+		      scale_us[scale] * NSEC_PER_USEC;
+	ltr_ns = (u64)(lat & PCI_LTR_VALUE_MASK) <<
+		 (5 * ((lat & PCI_LTR_SCALE_MASK) >> PCI_LTR_SCALE_SHIFT));
+
+	return lat && ltr_ns < t_pwr_on_ns;
+}
+
+/*
+ * Exiting L1.2 takes long enough to show up in the tail latency of bursty
+ * I/O, keeping the link out of it costs power while idle.  Sample how often
+ * the link enters L1 and keep the L1 substates off while that is high, or
+ * while the device's LTR doesn't tolerate the L1.2 exit latency, and turn
+ * them back on once the link has been quiet for a while.
+ */
+static void qcom_pcie_l1ss_work(struct work_struct *work)
+{
+	struct qcom_pcie *pcie = container_of(work, struct qcom_pcie,
+					      l1ss_work.work);
+	int l1ss = PCIE_LINK_STATE_L1_1 | PCIE_LINK_STATE_L1_2 |
+		   PCIE_LINK_STATE_L1_1_PCIPM | PCIE_LINK_STATE_L1_2_PCIPM;
+	int base = PCIE_LINK_STATE_L0S | PCIE_LINK_STATE_L1 |
+		   PCIE_LINK_STATE_CLKPM;
+	struct pci_dev *pdev;
+	u32 l1, l12, l1_delta;
+	bool off, ltr_blocked;
+
+	if (pcie->suspended || !dw_pcie_link_up(pcie->pci))
+		goto out;
+
+	pdev = qcom_pcie_l1ss_link_dev(pcie);
+	if (!pdev)
+		goto out;
+
+	l1 = readl_relaxed(pcie->mhi + PARF_DEBUG_CNT_PM_LINKST_IN_L1);
+	l12 = readl_relaxed(pcie->mhi + PARF_DEBUG_CNT_AUX_CLK_IN_L1SUB_L2);
+	l1_delta = l1 - pcie->l1ss_last_l1;
+	pcie->l1ss_l12_entries += l12 - pcie->l1ss_last_l12;
+	pcie->l1ss_last_l1 = l1;
+	pcie->l1ss_last_l12 = l12;
+
+	if (pcie->l1ss_off)
+		pcie->l1ss_off_ms += L1SS_POLL_MS;
+	else
+		pcie->l1ss_on_ms += L1SS_POLL_MS;
+
+	ltr_blocked = qcom_pcie_l1ss_ltr_blocks(pdev);
+	if (ltr_blocked || l1_delta > pcie->l1ss_busy_threshold) {
+		pcie->l1ss_idle_polls = 0;
+		off = true;
+	} else if (++pcie->l1ss_idle_polls >= L1SS_IDLE_POLLS) {
+		off = false;
+	} else {
+		off = pcie->l1ss_off;
+	}
+
+	if (off != pcie->l1ss_off &&
+	    !pci_enable_link_state(pdev, off ? base : base | l1ss)) {
+		pcie->l1ss_off = off;
+		pcie->l1ss_switches++;
+		if (off && ltr_blocked)
+			pcie->l1ss_ltr_blocked++;
+	}
+
+	pci_dev_put(pdev);
+out:
+	queue_delayed_work(system_freezable_wq, &pcie->l1ss_work,
+			   msecs_to_jiffies(L1SS_POLL_MS));
+}
+
+static int qcom_pcie_l1ss_stats(struct seq_file *s, void *data)
+{
+	struct qcom_pcie *pcie = (struct qcom_pcie *)dev_get_drvdata(s->private);
+
+	seq_printf(s, "L1ss: %s\n", pcie->l1ss_off ? "off" : "on");
+	seq_printf(s, "time with L1ss on: %llu ms\n", pcie->l1ss_on_ms);
+	seq_printf(s, "time with L1ss off: %llu ms\n", pcie->l1ss_off_ms);
+	seq_printf(s, "L1.2 entries: %llu\n", pcie->l1ss_l12_entries);
+	seq_printf(s, "switches: %u\n", pcie->l1ss_switches);
+	seq_printf(s, "turned off for LTR: %u\n", pcie->l1ss_ltr_blocked);
+
+	return 0;
+}
+
+static void qcom_pcie_l1ss_init(struct qcom_pcie *pcie)
+{
+	struct device *dev = pcie->pci->dev;
+
+	if (!of_property_read_bool(dev->of_node, "qcom,dynamic-l1ss"))
+		return;
+
+	pcie->l1ss_dynamic = true;
+	pcie->l1ss_busy_threshold = L1SS_BUSY_THRESHOLD;
+	pcie->l1ss_last_l1 = readl_relaxed(pcie->mhi + PARF_DEBUG_CNT_PM_LINKST_IN_L1);
+	pcie->l1ss_last_l12 = readl_relaxed(pcie->mhi + PARF_DEBUG_CNT_AUX_CLK_IN_L1SUB_L2);
+	INIT_DELAYED_WORK(&pcie->l1ss_work, qcom_pcie_l1ss_work);
+	queue_delayed_work(system_freezable_wq, &pcie->l1ss_work,
+			   msecs_to_jiffies(L1SS_POLL_MS));
+}
+
 static void qcom_pcie_init_debugfs(struct qcom_pcie *pcie)
 {
 	struct dw_pcie *pci = pcie->pci;
@@ -1481,6 +1646,13 @@ static void qcom_pcie_init_debugfs(struct qcom_pcie *pcie)
 	pcie->debugfs = debugfs_create_dir(name, NULL);
 	debugfs_create_devm_seqfile(dev, "link_transition_count", pcie->debugfs,
 				    qcom_pcie_link_transition_count);
+
+	if (pcie->l1ss_dynamic) {
+		debugfs_create_devm_seqfile(dev, "l1ss_policy", pcie->debugfs,
+					    qcom_pcie_l1ss_stats);
+		debugfs_create_u32("l1ss_busy_threshold", 0644, pcie->debugfs,
+				   &pcie->l1ss_busy_threshold);
+	}
 }
 
 static int qcom_pcie_probe(struct platform_device *pdev)
@@ -1581,8 +1753,10 @@ static int qcom_pcie_probe(struct platform_device *pdev)
 
 	qcom_pcie_icc_update(pcie);
 
-	if (pcie->mhi)
+	if (pcie->mhi) {
+		qcom_pcie_l1ss_init(pcie);
 		qcom_pcie_init_debugfs(pcie);
+	}
 
 	return 0;
 
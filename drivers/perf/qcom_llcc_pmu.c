@@ -0,0 +1,635 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Qualcomm LLCC performance monitor
+ *
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * The LLCC perfmon has 16 counters, each counting one event of one port of
+ * the cache: the tag pipeline (TRP) sees the hits and misses of the slices
+ * and the back end (BEAC) the read and write beats to DDR, which makes it
+ * the DDR bandwidth of all the clients going through the LLCC. Events of
+ * the front end and tag pipeline can be filtered by slice (SCID), that is
+ * by client.
+ *
+ * Counters are programmed through the broadcast region and read from each
+ * bank, they clear on dump, so a dump gives the deltas of all the counters
+ * since the previous one. A timer dumps them often enough for the 32 bits
+ * deltas to never wrap.
+ */
+
+#include <linux/bitfield.h>
+#include <linux/cpuhotplug.h>
+#include <linux/hrtimer.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/perf_event.h>
+#include <linux/platform_device.h>
+#include <linux/regmap.h>
+#include <linux/soc/qcom/llcc-qcom.h>
+
+#define LLCC_PMU_NUM_COUNTERS		16
+
+/* perfmon registers, for LLCC v2 (sc7280/qcs6490) */
+#define LLCC_PERFMON_MODE		0x3100c
+#define LLCC_PERFMON_MONITOR_EN		BIT(15)
+#define LLCC_PERFMON_MODE_MANUAL	0
+#define LLCC_PERFMON_DUMP		0x31010
+#define LLCC_PERFMON_MONITOR_DUMP	BIT(0)
+#define LLCC_PERFMON_COUNTER_CFG(n)	(0x31020 + 4 * (n))
+#define LLCC_PERFMON_CLEAR_ON_ENABLE	BIT(31)
+#define LLCC_PERFMON_CLEAR_ON_DUMP	BIT(30)
+#define LLCC_PERFMON_COUNT_CLOCK	BIT(24)
+#define LLCC_PERFMON_EVENT_SEL		GENMASK(20, 16)
+#define LLCC_PERFMON_PORT_SEL		GENMASK(3, 0)
+#define LLCC_PERFMON_COUNTER_VAL(n)	(0x31060 + 4 * (n))
+
+/* per port event selection and filters */
+#define LLCC_PROF_EVENT_SEL		GENMASK(5, 0)
+#define LLCC_PROF_FILTER_EN		BIT(16)
+#define LLCC_PROF_FILTER_SCID_MATCH	GENMASK(4, 0)
+#define LLCC_PROF_FILTER_SCID_MASK	GENMASK(20, 16)
+
+enum llcc_pmu_port {
+	LLCC_PORT_FEAC,
+	LLCC_PORT_FERC,
+	LLCC_PORT_FEWC,
+	LLCC_PORT_BEAC,
+	LLCC_PORT_BERC,
+	LLCC_PORT_TRP,
+	LLCC_PORT_DRP,
+	LLCC_PORT_PMGR,
+	LLCC_PORT_MAX,
+};
+
+/**
+ * struct llcc_pmu_port_regs - registers of a port
+ * @event_cfg: event selection of the first counter, 4 bytes apart
+ * @filter_cfg: SCID filter, 0 if the port has none
+ */
+struct llcc_pmu_port_regs {
+	u32 event_cfg;
+	u32 filter_cfg;
+};
+
+static const struct llcc_pmu_port_regs llcc_pmu_ports[LLCC_PORT_MAX] = {
+	[LLCC_PORT_FEAC] = { .event_cfg = 0x41060, .filter_cfg = 0x41000 },
+	[LLCC_PORT_FERC] = { .event_cfg = 0x42010 },
+	[LLCC_PORT_FEWC] = { .event_cfg = 0x43010 },
+	[LLCC_PORT_BEAC] = { .event_cfg = 0x49040 },
+	[LLCC_PORT_BERC] = { .event_cfg = 0x4b010 },
+	[LLCC_PORT_TRP] = { .event_cfg = 0x24060, .filter_cfg = 0x24000 },
+	[LLCC_PORT_DRP] = { .event_cfg = 0x44010 },
+	[LLCC_PORT_PMGR] = { .event_cfg = 0x3f000 },
+};
+
+/* config:0-5 event, config:8-11 port, config:24 clock, config1:0-4 scid */
+#define LLCC_PMU_EVENT			GENMASK_ULL(5, 0)
+#define LLCC_PMU_PORT			GENMASK_ULL(11, 8)
+#define LLCC_PMU_CLOCK			BIT_ULL(24)
+#define LLCC_PMU_FILTER_EN		BIT_ULL(31)
+#define LLCC_PMU_SCID			GENMASK_ULL(4, 0)
+
+/* 32 bits deltas of beats of 32 bytes at ~50GB/s wrap after ~2.7s */
+#define LLCC_PMU_POLL_NS		(1 * NSEC_PER_SEC)
+
+/**
+ * struct llcc_pmu - LLCC perfmon
+ * @pmu: perf PMU
+ * @llcc: data of the LLCC device
+ * @events: events of the counters
+ * @counts: counts of the counters since they were started
+ * @used: counters in use
+ * @port_scid: SCID filtered on each port, -1 if not filtered
+ * @port_users: number of filtered events of each port
+ * @lock: protects the counters, the timer and the perf callbacks race
+ * @timer: dumps the counters before they can wrap
+ * @cpu: CPU the events are counted on
+ * @node: CPU hotplug instance
+ * @identifier: SoC of the perfmon, for the perf events of the SoC
+ */
+struct llcc_pmu {
+	struct pmu pmu;
+	struct llcc_drv_data *llcc;
+	struct perf_event *events[LLCC_PMU_NUM_COUNTERS];
+	u64 counts[LLCC_PMU_NUM_COUNTERS];
+	DECLARE_BITMAP(used, LLCC_PMU_NUM_COUNTERS);
+	int port_scid[LLCC_PORT_MAX];
+	unsigned int port_users[LLCC_PORT_MAX];
+	raw_spinlock_t lock;
+	struct hrtimer timer;
+	int cpu;
+	struct hlist_node node;
+	const char *identifier;
+};
+
+#define to_llcc_pmu(p)	container_of(p, struct llcc_pmu, pmu)
+
+static enum cpuhp_state llcc_pmu_cpuhp_state;
+
+/* Add the deltas since the last dump to all the counters in use */
+static void llcc_pmu_dump(struct llcc_pmu *pmu)
+{
+	struct llcc_drv_data *llcc = pmu->llcc;
+	unsigned int bank, val;
+	int n;
+
+	lockdep_assert_held(&pmu->lock);
+
+	if (bitmap_empty(pmu->used, LLCC_PMU_NUM_COUNTERS))
+		return;
+
+	regmap_write(llcc->bcast_regmap, LLCC_PERFMON_DUMP,
+		     LLCC_PERFMON_MONITOR_DUMP);
+
+	for_each_set_bit(n, pmu->used, LLCC_PMU_NUM_COUNTERS) {
+		for (bank = 0; bank < llcc->num_banks; bank++) {
+			if (!regmap_read(llcc->regmaps[bank],
+					 LLCC_PERFMON_COUNTER_VAL(n), &val))
+				pmu->counts[n] += val;
+		}
+	}
+}
+
+static void llcc_pmu_event_update(struct perf_event *event)
+{
+	struct llcc_pmu *pmu = to_llcc_pmu(event->pmu);
+	struct hw_perf_event *hwc = &event->hw;
+	u64 prev, now;
+
+	now = pmu->counts[hwc->idx];
+	prev = local64_xchg(&hwc->prev_count, now);
+	local64_add(now - prev, &event->count);
+}
+
+static enum hrtimer_restart llcc_pmu_poll(struct hrtimer *timer)
+{
+	struct llcc_pmu *pmu = container_of(timer, struct llcc_pmu, timer);
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&pmu->lock, flags);
+	llcc_pmu_dump(pmu);
+	raw_spin_unlock_irqrestore(&pmu->lock, flags);
+
+	hrtimer_forward_now(timer, ns_to_ktime(LLCC_PMU_POLL_NS));
+	return HRTIMER_RESTART;
+}
+
+static bool llcc_pmu_port_valid(struct perf_event *event)
+{
+	u64 config = event->attr.config;
+	unsigned int port = FIELD_GET(LLCC_PMU_PORT, config);
+
+	if (config & LLCC_PMU_CLOCK)
+		return true;
+
+	if (port >= LLCC_PORT_MAX)
+		return false;
+
+	/* filtering is only possible on the ports with a filter */
+	return !(config & LLCC_PMU_FILTER_EN) ||
+	       llcc_pmu_ports[port].filter_cfg;
+}
+
+static int llcc_pmu_event_init(struct perf_event *event)
+{
+	struct llcc_pmu *pmu = to_llcc_pmu(event->pmu);
+	struct perf_event *sibling;
+	unsigned int counters = 1;
+
+	if (event->attr.type != event->pmu->type)
+		return -ENOENT;
+
+	/* uncore counters can't be attributed to a task */
+	if (is_sampling_event(event) || event->attach_state & PERF_ATTACH_TASK)
+		return -EINVAL;
+
+	if (event->cpu < 0)
+		return -EINVAL;
+
+	if (!llcc_pmu_port_valid(event))
+		return -EINVAL;
+
+	if (event->group_leader != event) {
+		if (event->group_leader->pmu != event->pmu &&
+		    !is_software_event(event->group_leader))
+			return -EINVAL;
+		counters++;
+	}
+
+	for_each_sibling_event(sibling, event->group_leader) {
+		if (sibling == event)
+			continue;
+		if (sibling->pmu != event->pmu && !is_software_event(sibling))
+			return -EINVAL;
+		counters++;
+	}
+
+	if (counters > LLCC_PMU_NUM_COUNTERS)
+		return -EINVAL;
+
+	event->cpu = pmu->cpu;
+	event->hw.idx = -1;
+
+	return 0;
+}
+
+static void llcc_pmu_counter_enable(struct llcc_pmu *pmu, int idx,
+				    u64 config, u64 config1)
+{
+	struct regmap *map = pmu->llcc->bcast_regmap;
+	unsigned int port = FIELD_GET(LLCC_PMU_PORT, config);
+	unsigned int cfg, ev;
+
+	cfg = LLCC_PERFMON_CLEAR_ON_ENABLE | LLCC_PERFMON_CLEAR_ON_DUMP;
+	if (config & LLCC_PMU_CLOCK) {
+		cfg |= LLCC_PERFMON_COUNT_CLOCK;
+	} else {
+		ev = FIELD_PREP(LLCC_PROF_EVENT_SEL,
+				FIELD_GET(LLCC_PMU_EVENT, config));
+		if (config & LLCC_PMU_FILTER_EN)
+			ev |= LLCC_PROF_FILTER_EN;
+		regmap_write(map, llcc_pmu_ports[port].event_cfg + 4 * idx, ev);
+
+		cfg |= FIELD_PREP(LLCC_PERFMON_EVENT_SEL, idx) |
+		       FIELD_PREP(LLCC_PERFMON_PORT_SEL, port);
+	}
+	regmap_write(map, LLCC_PERFMON_COUNTER_CFG(idx), cfg);
+}
+
+static void llcc_pmu_counter_disable(struct llcc_pmu *pmu, int idx)
+{
+	regmap_write(pmu->llcc->bcast_regmap, LLCC_PERFMON_COUNTER_CFG(idx), 0);
+}
+
+/* Ports have a single filter that the events of the port must agree on */
+static int llcc_pmu_filter_get(struct llcc_pmu *pmu, u64 config, u64 config1)
+{
+	unsigned int port = FIELD_GET(LLCC_PMU_PORT, config);
+	int scid = FIELD_GET(LLCC_PMU_SCID, config1);
+	unsigned int val;
+
+	if ((config & LLCC_PMU_CLOCK) || !(config & LLCC_PMU_FILTER_EN))
+		return 0;
+
+	if (pmu->port_users[port] && pmu->port_scid[port] != scid)
+		return -EAGAIN;
+
+	if (!pmu->port_users[port]++) {
+		pmu->port_scid[port] = scid;
+		val = FIELD_PREP(LLCC_PROF_FILTER_SCID_MATCH, scid) |
+		      FIELD_PREP(LLCC_PROF_FILTER_SCID_MASK,
+				 FIELD_MAX(LLCC_PROF_FILTER_SCID_MASK));
+		regmap_write(pmu->llcc->bcast_regmap,
+			     llcc_pmu_ports[port].filter_cfg, val);
+	}
+
+	return 0;
+}
+
+static void llcc_pmu_filter_put(struct llcc_pmu *pmu, u64 config)
+{
+	unsigned int port = FIELD_GET(LLCC_PMU_PORT, config);
+
+	if ((config & LLCC_PMU_CLOCK) || !(config & LLCC_PMU_FILTER_EN))
+		return;
+
+	if (!--pmu->port_users[port])
+		pmu->port_scid[port] = -1;
+}
+
+static void llcc_pmu_event_start(struct perf_event *event, int flags)
+{
+	struct llcc_pmu *pmu = to_llcc_pmu(event->pmu);
+	struct hw_perf_event *hwc = &event->hw;
+	unsigned long irqflags;
+
+	raw_spin_lock_irqsave(&pmu->lock, irqflags);
+	llcc_pmu_dump(pmu);
+	pmu->counts[hwc->idx] = 0;
+	local64_set(&hwc->prev_count, 0);
+	llcc_pmu_counter_enable(pmu, hwc->idx, event->attr.config,
+				event->attr.config1);
+	raw_spin_unlock_irqrestore(&pmu->lock, irqflags);
+
+	hwc->state = 0;
+}
+
+static void llcc_pmu_event_stop(struct perf_event *event, int flags)
+{
+	struct llcc_pmu *pmu = to_llcc_pmu(event->pmu);
+	struct hw_perf_event *hwc = &event->hw;
+	unsigned long irqflags;
+
+	if (hwc->state & PERF_HES_STOPPED)
+		return;
+
+	raw_spin_lock_irqsave(&pmu->lock, irqflags);
+	llcc_pmu_dump(pmu);
+	llcc_pmu_event_update(event);
+	llcc_pmu_counter_disable(pmu, hwc->idx);
+	raw_spin_unlock_irqrestore(&pmu->lock, irqflags);
+
+	hwc->state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
+}
+
+static int llcc_pmu_event_add(struct perf_event *event, int flags)
+{
+	struct llcc_pmu *pmu = to_llcc_pmu(event->pmu);
+	struct hw_perf_event *hwc = &event->hw;
+	unsigned long irqflags;
+	int idx, ret;
+
+	raw_spin_lock_irqsave(&pmu->lock, irqflags);
+	idx = find_first_zero_bit(pmu->used, LLCC_PMU_NUM_COUNTERS);
+	if (idx == LLCC_PMU_NUM_COUNTERS) {
+		ret = -EAGAIN;
+		goto out_unlock;
+	}
+
+	ret = llcc_pmu_filter_get(pmu, event->attr.config, event->attr.config1);
+	if (ret)
+		goto out_unlock;
+
+	if (bitmap_empty(pmu->used, LLCC_PMU_NUM_COUNTERS))
+		hrtimer_start(&pmu->timer, ns_to_ktime(LLCC_PMU_POLL_NS),
+			      HRTIMER_MODE_REL_PINNED);
+	set_bit(idx, pmu->used);
+	pmu->events[idx] = event;
+	hwc->idx = idx;
+out_unlock:
+	raw_spin_unlock_irqrestore(&pmu->lock, irqflags);
+	if (ret)
+		return ret;
+
+	hwc->state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+	if (flags & PERF_EF_START)
+		llcc_pmu_event_start(event, PERF_EF_RELOAD);
+
+	perf_event_update_userpage(event);
+
+	return 0;
+}
+
+static void llcc_pmu_event_del(struct perf_event *event, int flags)
+{
+	struct llcc_pmu *pmu = to_llcc_pmu(event->pmu);
+	struct hw_perf_event *hwc = &event->hw;
+	unsigned long irqflags;
+	bool idle;
+
+	llcc_pmu_event_stop(event, PERF_EF_UPDATE);
+
+	raw_spin_lock_irqsave(&pmu->lock, irqflags);
+	llcc_pmu_filter_put(pmu, event->attr.config);
+	pmu->events[hwc->idx] = NULL;
+	clear_bit(hwc->idx, pmu->used);
+	idle = bitmap_empty(pmu->used, LLCC_PMU_NUM_COUNTERS);
+	raw_spin_unlock_irqrestore(&pmu->lock, irqflags);
+
+	/* the timer takes the lock, cancel it without */
+	if (idle)
+		hrtimer_cancel(&pmu->timer);
+
+	hwc->idx = -1;
+	perf_event_update_userpage(event);
+}
+
+static void llcc_pmu_event_read(struct perf_event *event)
+{
+	struct llcc_pmu *pmu = to_llcc_pmu(event->pmu);
+	unsigned long irqflags;
+
+	raw_spin_lock_irqsave(&pmu->lock, irqflags);
+	llcc_pmu_dump(pmu);
+	llcc_pmu_event_update(event);
+	raw_spin_unlock_irqrestore(&pmu->lock, irqflags);
+}
+
+static void llcc_pmu_enable(struct pmu *p)
+{
+	struct llcc_pmu *pmu = to_llcc_pmu(p);
+
+	regmap_write(pmu->llcc->bcast_regmap, LLCC_PERFMON_MODE,
+		     LLCC_PERFMON_MONITOR_EN | LLCC_PERFMON_MODE_MANUAL);
+}
+
+static void llcc_pmu_disable(struct pmu *p)
+{
+	struct llcc_pmu *pmu = to_llcc_pmu(p);
+	unsigned long irqflags;
+
+	/* collect what was counted before the counters stop */
+	raw_spin_lock_irqsave(&pmu->lock, irqflags);
+	llcc_pmu_dump(pmu);
+	raw_spin_unlock_irqrestore(&pmu->lock, irqflags);
+
+	regmap_write(pmu->llcc->bcast_regmap, LLCC_PERFMON_MODE, 0);
+}
+
+static ssize_t cpumask_show(struct device *dev, struct device_attribute *attr,
+			    char *buf)
+{
+	struct llcc_pmu *pmu = to_llcc_pmu(dev_get_drvdata(dev));
+
+	return cpumap_print_to_pagebuf(true, buf, cpumask_of(pmu->cpu));
+}
+static DEVICE_ATTR_RO(cpumask);
+
+static ssize_t identifier_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct llcc_pmu *pmu = to_llcc_pmu(dev_get_drvdata(dev));
+
+	return sysfs_emit(buf, "%s\n", pmu->identifier);
+}
+static DEVICE_ATTR_RO(identifier);
+
+static struct attribute *llcc_pmu_attrs[] = {
+	&dev_attr_cpumask.attr,
+	&dev_attr_identifier.attr,
+	NULL,
+};
+
+static const struct attribute_group llcc_pmu_attr_group = {
+	.attrs = llcc_pmu_attrs,
+};
+
+PMU_FORMAT_ATTR(event, "config:0-5");
+PMU_FORMAT_ATTR(port, "config:8-11");
+PMU_FORMAT_ATTR(clock, "config:24");
+PMU_FORMAT_ATTR(filter_en, "config:31");
+PMU_FORMAT_ATTR(scid, "config1:0-4");
+
+static struct attribute *llcc_pmu_format_attrs[] = {
+	&format_attr_event.attr,
+	&format_attr_port.attr,
+	&format_attr_clock.attr,
+	&format_attr_filter_en.attr,
+	&format_attr_scid.attr,
+	NULL,
+};
+
+static const struct attribute_group llcc_pmu_format_group = {
+	.name = "format",
+	.attrs = llcc_pmu_format_attrs,
+};
+
+#define LLCC_PMU_EVENT_ATTR(_name, _str)				\
+	(&((struct perf_pmu_events_attr[]) {				\
+		{ .attr = __ATTR(_name, 0444, perf_event_sysfs_show, NULL), \
+		  .event_str = _str, }					\
+	})[0].attr.attr)
+
+static struct attribute *llcc_pmu_event_attrs[] = {
+	LLCC_PMU_EVENT_ATTR(cycles, "clock=1"),
+	LLCC_PMU_EVENT_ATTR(trp_read_hit, "port=0x5,event=0x00"),
+	LLCC_PMU_EVENT_ATTR(trp_read_miss, "port=0x5,event=0x01"),
+	LLCC_PMU_EVENT_ATTR(trp_write_hit, "port=0x5,event=0x02"),
+	LLCC_PMU_EVENT_ATTR(trp_write_miss, "port=0x5,event=0x03"),
+	LLCC_PMU_EVENT_ATTR(feac_read, "port=0x0,event=0x00"),
+	LLCC_PMU_EVENT_ATTR(feac_write, "port=0x0,event=0x01"),
+	LLCC_PMU_EVENT_ATTR(beac_read_beat, "port=0x3,event=0x00"),
+	LLCC_PMU_EVENT_ATTR(beac_write_beat, "port=0x3,event=0x01"),
+	NULL,
+};
+
+static const struct attribute_group llcc_pmu_events_group = {
+	.name = "events",
+	.attrs = llcc_pmu_event_attrs,
+};
+
+static const struct attribute_group *llcc_pmu_attr_groups[] = {
+	&llcc_pmu_attr_group,
+	&llcc_pmu_format_group,
+	&llcc_pmu_events_group,
+	NULL,
+};
+
+static int llcc_pmu_offline_cpu(unsigned int cpu, struct hlist_node *node)
+{
+	struct llcc_pmu *pmu = hlist_entry_safe(node, struct llcc_pmu, node);
+	unsigned int target;
+
+	if (cpu != pmu->cpu)
+		return 0;
+
+	target = cpumask_any_but(cpu_online_mask, cpu);
+	if (target >= nr_cpu_ids)
+		return 0;
+
+	perf_pmu_migrate_context(&pmu->pmu, cpu, target);
+	pmu->cpu = target;
+
+	return 0;
+}
+
+static int llcc_pmu_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct llcc_pmu *pmu;
+	int port, ret;
+
+	pmu = devm_kzalloc(dev, sizeof(*pmu), GFP_KERNEL);
+	if (!pmu)
+		return -ENOMEM;
+
+	/* the perfmon is a child of the LLCC, using its register regions */
+	pmu->llcc = dev_get_drvdata(dev->parent);
+	if (IS_ERR_OR_NULL(pmu->llcc) || !pmu->llcc->bcast_regmap)
+		return -EPROBE_DEFER;
+
+	pmu->identifier = of_device_get_match_data(dev) ? : "llcc";
+	for (port = 0; port < LLCC_PORT_MAX; port++)
+		pmu->port_scid[port] = -1;
+	raw_spin_lock_init(&pmu->lock);
+	hrtimer_init(&pmu->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	pmu->timer.function = llcc_pmu_poll;
+	pmu->cpu = raw_smp_processor_id();
+
+	pmu->pmu = (struct pmu) {
+		.module		= THIS_MODULE,
+		.task_ctx_nr	= perf_invalid_context,
+		.pmu_enable	= llcc_pmu_enable,
+		.pmu_disable	= llcc_pmu_disable,
+		.event_init	= llcc_pmu_event_init,
+		.add		= llcc_pmu_event_add,
+		.del		= llcc_pmu_event_del,
+		.start		= llcc_pmu_event_start,
+		.stop		= llcc_pmu_event_stop,
+		.read		= llcc_pmu_event_read,
+		.attr_groups	= llcc_pmu_attr_groups,
+		.capabilities	= PERF_PMU_CAP_NO_EXCLUDE,
+	};
+
+	ret = cpuhp_state_add_instance_nocalls(llcc_pmu_cpuhp_state,
+					       &pmu->node);
+	if (ret)
+		return ret;
+
+	ret = perf_pmu_register(&pmu->pmu, "qcom_llcc", -1);
+	if (ret) {
+		cpuhp_state_remove_instance_nocalls(llcc_pmu_cpuhp_state,
+						    &pmu->node);
+		return ret;
+	}
+
+	platform_set_drvdata(pdev, pmu);
+
+	return 0;
+}
+
+static int llcc_pmu_remove(struct platform_device *pdev)
+{
+	struct llcc_pmu *pmu = platform_get_drvdata(pdev);
+
+	perf_pmu_unregister(&pmu->pmu);
+	cpuhp_state_remove_instance_nocalls(llcc_pmu_cpuhp_state, &pmu->node);
+
+	return 0;
+}
+
+static const struct of_device_id llcc_pmu_of_match[] = {
+	{ .compatible = "qcom,sc7280-llcc-perfmon", .data = "sc7280" },
+	{ .compatible = "qcom,llcc-perfmon" },
+	{ }
+};
+MODULE_DEVICE_TABLE(of, llcc_pmu_of_match);
+
+static struct platform_driver llcc_pmu_driver = {
+	.driver = {
+		.name = "qcom-llcc-pmu",
+		.of_match_table = llcc_pmu_of_match,
+		.suppress_bind_attrs = true,
+	},
+	.probe = llcc_pmu_probe,
+	.remove = llcc_pmu_remove,
+};
+
+static int __init llcc_pmu_init(void)
+{
+	int ret;
+
+	ret = cpuhp_setup_state_multi(CPUHP_AP_ONLINE_DYN,
+				      "perf/qcom/llcc:online", NULL,
+				      llcc_pmu_offline_cpu);
+	if (ret < 0)
+		return ret;
+	llcc_pmu_cpuhp_state = ret;
+
+	ret = platform_driver_register(&llcc_pmu_driver);
+	if (ret)
+		cpuhp_remove_multi_state(llcc_pmu_cpuhp_state);
+
+	return ret;
+}
+module_init(llcc_pmu_init);
+
+static void __exit llcc_pmu_exit(void)
+{
+	platform_driver_unregister(&llcc_pmu_driver);
+	cpuhp_remove_multi_state(llcc_pmu_cpuhp_state);
+}
+module_exit(llcc_pmu_exit);
+
+MODULE_DESCRIPTION("Qualcomm LLCC performance monitor driver");
+MODULE_LICENSE("GPL");
@@ -166,6 +166,10 @@ static int rpmh_regulator_send_request(struct rpmh_vreg *vreg,
 {
 	int ret;
 
+	/* Sent, and waited for, by the commit of the caller's transaction */
+	if (rpmh_txn_queue(vreg->dev, RPMH_ACTIVE_ONLY_STATE, cmd, 1))
+		return 0;
+
 	if (wait_for_ack || vreg->always_wait_for_ack)
 		ret = rpmh_write(vreg->dev, RPMH_ACTIVE_ONLY_STATE, cmd, 1);
 	else
@@ -84,6 +84,8 @@ struct qcom_adsp {
 
 	const struct firmware *firmware;
 	const struct firmware *dtb_firmware;
+	struct completion dtb_firmware_ready;
+	bool dtb_firmware_pending;
 
 	struct completion start_done;
 	struct completion stop_done;
@@ -210,6 +212,47 @@ static int adsp_unprepare(struct rproc *rproc)
 	return 0;
 }
 
+static void adsp_dtb_firmware_callback(const struct firmware *fw, void *context)
+{
+	struct qcom_adsp *adsp = context;
+
+	adsp->dtb_firmware = fw;
+	complete_all(&adsp->dtb_firmware_ready);
+}
+
+/*
+ * The dtb image is requested from probe, in parallel with the request of the
+ * main image done by the remoteproc core on auto boot, and kept around so that
+ * subsequent boots and recoveries don't have to fetch it again.
+ */
+static void adsp_dtb_firmware_prefetch(struct qcom_adsp *adsp)
+{
+	int ret;
+
+	init_completion(&adsp->dtb_firmware_ready);
+	ret = request_firmware_nowait(THIS_MODULE, FW_ACTION_UEVENT,
+				      adsp->dtb_firmware_name, adsp->dev,
+				      GFP_KERNEL, adsp, adsp_dtb_firmware_callback);
+	if (!ret)
+		adsp->dtb_firmware_pending = true;
+}
+
+static void adsp_dtb_firmware_wait(struct qcom_adsp *adsp)
+{
+	if (!adsp->dtb_firmware_pending)
+		return;
+
+	wait_for_completion(&adsp->dtb_firmware_ready);
+	adsp->dtb_firmware_pending = false;
+}
+
+static void adsp_dtb_firmware_release(struct qcom_adsp *adsp)
+{
+	adsp_dtb_firmware_wait(adsp);
+	release_firmware(adsp->dtb_firmware);
+	adsp->dtb_firmware = NULL;
+}
+
 static int adsp_load(struct rproc *rproc, const struct firmware *fw)
 {
 	struct qcom_adsp *adsp = rproc->priv;
@@ -219,11 +262,15 @@ static int adsp_load(struct rproc *rproc, const struct firmware *fw)
 	adsp->firmware = fw;
 
 	if (adsp->dtb_pas_id) {
-		ret = request_firmware(&adsp->dtb_firmware, adsp->dtb_firmware_name, adsp->dev);
-		if (ret) {
-			dev_err(adsp->dev, "request_firmware failed for %s: %d\n",
-				adsp->dtb_firmware_name, ret);
-			return ret;
+		adsp_dtb_firmware_wait(adsp);
+		if (!adsp->dtb_firmware) {
+			ret = request_firmware(&adsp->dtb_firmware,
+					       adsp->dtb_firmware_name, adsp->dev);
+			if (ret) {
+				dev_err(adsp->dev, "request_firmware failed for %s: %d\n",
+					adsp->dtb_firmware_name, ret);
+				return ret;
+			}
 		}
 
 		ret = qcom_mdt_pas_init(adsp->dev, adsp->dtb_firmware, adsp->dtb_firmware_name,
@@ -246,7 +293,7 @@ static int adsp_load(struct rproc *rproc, const struct firmware *fw)
 	qcom_scm_pas_metadata_release(&adsp->dtb_pas_metadata);
 
 release_dtb_firmware:
-	release_firmware(adsp->dtb_firmware);
+	adsp_dtb_firmware_release(adsp);
 
 	return ret;
 }
@@ -774,12 +821,18 @@ static int adsp_probe(struct platform_device *pdev)
 	}
 
 	qcom_add_ssr_subdev(rproc, &adsp->ssr_subdev, desc->ssr_name);
+
+	if (adsp->dtb_pas_id && rproc->auto_boot)
+		adsp_dtb_firmware_prefetch(adsp);
+
 	ret = rproc_add(rproc);
 	if (ret)
-		goto detach_proxy_pds;
+		goto release_dtb_firmware;
 
 	return 0;
 
+release_dtb_firmware:
+	adsp_dtb_firmware_release(adsp);
 detach_proxy_pds:
 	adsp_pds_detach(adsp, adsp->proxy_pds, adsp->proxy_pd_count);
 free_rproc:
@@ -794,6 +847,7 @@ static void adsp_remove(struct platform_device *pdev)
 	struct qcom_adsp *adsp = platform_get_drvdata(pdev);
 
 	rproc_del(adsp->rproc);
+	adsp_dtb_firmware_release(adsp);
 
 	qcom_q6v5_deinit(&adsp->q6v5);
 	adsp_unassign_memory_region(adsp);
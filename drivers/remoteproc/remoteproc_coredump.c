@@ -10,6 +10,7 @@
 #include <linux/device.h>
 #include <linux/kernel.h>
 #include <linux/remoteproc.h>
+#include <linux/vmalloc.h>
 #include "remoteproc_internal.h"
 #include "remoteproc_elf_helpers.h"
 
@@ -131,6 +132,34 @@ static void rproc_coredump_free(void *data)
 	complete(&dump_state->dump_done);
 }
 
+/*
+ * Allocate the dump buffer, with room for a copy of the segments unless they
+ * are to be read inline.  In auto mode the copy is only made if the memory is
+ * readily available, as recovery is stalled while device memory is read
+ * inline, and @dump_conf is updated to the mechanism to be used.
+ */
+static void *rproc_coredump_alloc(enum rproc_dump_mechanism *dump_conf,
+				  size_t header_sz, size_t segments_sz)
+{
+	void *data;
+
+	if (*dump_conf == RPROC_COREDUMP_AUTO) {
+		data = __vmalloc(header_sz + segments_sz,
+				 GFP_KERNEL | __GFP_NORETRY | __GFP_NOWARN);
+		if (data) {
+			*dump_conf = RPROC_COREDUMP_ENABLED;
+			return data;
+		}
+
+		*dump_conf = RPROC_COREDUMP_INLINE;
+	}
+
+	if (*dump_conf == RPROC_COREDUMP_ENABLED)
+		header_sz += segments_sz;
+
+	return vmalloc(header_sz);
+}
+
 static void *rproc_coredump_find_segment(loff_t user_offset,
 					 struct list_head *segments,
 					 size_t *data_left)
@@ -230,7 +259,8 @@ static ssize_t rproc_coredump_read(char *buffer, loff_t offset, size_t count,
  * from device memory to userspace or copy segments from device memory to
  * a separate buffer, which can then be read by userspace.
  * The first approach avoids using extra vmalloc memory. But it will stall
- * recovery flow until dump is read by userspace.
+ * recovery flow until dump is read by userspace. The auto configuration
+ * only takes the first one if the buffer can't be allocated easily.
  */
 void rproc_coredump(struct rproc *rproc)
 {
@@ -238,6 +268,7 @@ void rproc_coredump(struct rproc *rproc)
 	void *phdr;
 	void *ehdr;
 	size_t data_size;
+	size_t segments_size = 0;
 	size_t offset;
 	void *data;
 	u8 class = rproc->elf_class;
@@ -257,21 +288,22 @@ void rproc_coredump(struct rproc *rproc)
 	data_size = elf_size_of_hdr(class);
 	list_for_each_entry(segment, &rproc->dump_segments, node) {
 		/*
-		 * For default configuration buffer includes headers & segments.
-		 * For inline dump buffer just includes headers as segments are
-		 * directly read from device memory.
+		 * The segments are only added to the buffer if they are copied,
+		 * for inline dumps they are read directly from device memory.
 		 */
 		data_size += elf_size_of_phdr(class);
-		if (dump_conf == RPROC_COREDUMP_ENABLED)
-			data_size += segment->size;
+		segments_size += segment->size;
 
 		phnum++;
 	}
 
-	data = vmalloc(data_size);
+	data = rproc_coredump_alloc(&dump_conf, data_size, segments_size);
 	if (!data)
 		return;
 
+	if (dump_conf == RPROC_COREDUMP_ENABLED)
+		data_size += segments_size;
+
 	ehdr = data;
 
 	memset(ehdr, 0, elf_size_of_hdr(class));
@@ -340,7 +372,8 @@ EXPORT_SYMBOL_GPL(rproc_coredump);
  * from device memory to userspace or copy segments from device memory to
  * a separate buffer, which can then be read by userspace.
  * The first approach avoids using extra vmalloc memory. But it will stall
- * recovery flow until dump is read by userspace.
+ * recovery flow until dump is read by userspace. The auto configuration
+ * only takes the first one if the buffer can't be allocated easily.
  */
 void rproc_coredump_using_sections(struct rproc *rproc)
 {
@@ -348,6 +381,7 @@ void rproc_coredump_using_sections(struct rproc *rproc)
 	void *shdr;
 	void *ehdr;
 	size_t data_size;
+	size_t segments_size = 0;
 	size_t strtbl_size = 0;
 	size_t strtbl_index = 1;
 	size_t offset;
@@ -355,7 +389,7 @@ void rproc_coredump_using_sections(struct rproc *rproc)
 	u8 class = rproc->elf_class;
 	int shnum;
 	struct rproc_coredump_state dump_state;
-	unsigned int dump_conf = rproc->dump_conf;
+	enum rproc_dump_mechanism dump_conf = rproc->dump_conf;
 	char *str_tbl = "STR_TBL";
 
 	if (list_empty(&rproc->dump_segments) ||
@@ -381,17 +415,19 @@ void rproc_coredump_using_sections(struct rproc *rproc)
 	list_for_each_entry(segment, &rproc->dump_segments, node) {
 		data_size += elf_size_of_shdr(class);
 		strtbl_size += strlen(segment->priv) + 1;
-		if (dump_conf == RPROC_COREDUMP_ENABLED)
-			data_size += segment->size;
+		segments_size += segment->size;
 		shnum++;
 	}
 
 	data_size += strtbl_size;
 
-	data = vmalloc(data_size);
+	data = rproc_coredump_alloc(&dump_conf, data_size, segments_size);
 	if (!data)
 		return;
 
+	if (dump_conf == RPROC_COREDUMP_ENABLED)
+		data_size += segments_size;
+
 	ehdr = data;
 	memset(ehdr, 0, elf_size_of_hdr(class));
 	/* e_ident field is common for both elf32 and elf64 */
@@ -36,6 +36,7 @@ static const char * const rproc_coredump_str[] = {
 	[RPROC_COREDUMP_DISABLED]	= "disabled",
 	[RPROC_COREDUMP_ENABLED]	= "enabled",
 	[RPROC_COREDUMP_INLINE]		= "inline",
+	[RPROC_COREDUMP_AUTO]		= "auto",
 };
 
 /* Expose the current coredump configuration via debugfs */
@@ -67,6 +68,10 @@ static ssize_t rproc_coredump_read(struct file *filp, char __user *userbuf,
  * inline:	The coredump will not be copied to a separate buffer and the
  *		recovery process will have to wait until data is read by
  *		userspace. But this avoid usage of extra memory.
+ *
+ * auto:	The coredump will be copied to a separate buffer if that memory
+ *		can be allocated without reclaim having to work hard for it,
+ *		and read inline otherwise.
  */
 static ssize_t rproc_coredump_write(struct file *filp,
 				    const char __user *user_buf, size_t count,
@@ -99,6 +104,8 @@ static ssize_t rproc_coredump_write(struct file *filp,
 		rproc->dump_conf = RPROC_COREDUMP_ENABLED;
 	} else if (!strncmp(buf, "inline", count)) {
 		rproc->dump_conf = RPROC_COREDUMP_INLINE;
+	} else if (!strncmp(buf, "auto", count)) {
+		rproc->dump_conf = RPROC_COREDUMP_AUTO;
 	} else {
 		dev_err(&rproc->dev, "Invalid coredump configuration\n");
 		err = -EINVAL;
@@ -4,10 +4,12 @@
  * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
  */
 
+#include <linux/hrtimer.h>
 #include <linux/idr.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/list.h>
+#include <linux/log2.h>
 #include <linux/mfd/syscon.h>
 #include <linux/module.h>
 #include <linux/of.h>
@@ -15,6 +17,7 @@
 #include <linux/platform_device.h>
 #include <linux/regmap.h>
 #include <linux/rpmsg.h>
+#include <linux/sched/clock.h>
 #include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/wait.h>
@@ -97,6 +100,9 @@ struct glink_core_rx_intent {
  * @tx_avail_notify: Waitqueue for pending tx tasks
  * @sent_read_notify: flag to check cmd sent or not
  * @abort_tx:	flag indicating that all tx attempts should fail
+ * @kick_timer: sends the doorbell for coalesced tx, see __qcom_glink_tx()
+ * @rx_busy_poll_us: time to poll the rx fifo for more data once it ran
+ *		empty, 0 to return right away
  */
 struct qcom_glink {
 	struct device *dev;
@@ -122,6 +128,9 @@ struct qcom_glink {
 	bool sent_read_notify;
 
 	bool abort_tx;
+
+	struct hrtimer kick_timer;
+	u32 rx_busy_poll_us;
 };
 
 enum {
@@ -155,6 +164,9 @@ enum {
  * @intent_req_result: Result of intent request
  * @intent_received: flag indicating that an intent has been received
  * @intent_req_wq: wait queue for intent_req signalling
+ * @pooled_intents: number of requested intents kept for reuse
+ * @tx_coalesce_us: max time the doorbell for data sent on the channel may be
+ *		delayed, to ring it once for several messages
  */
 struct glink_channel {
 	struct rpmsg_endpoint ept;
@@ -187,6 +199,9 @@ struct glink_channel {
 	int intent_req_result;
 	bool intent_received;
 	wait_queue_head_t intent_req_wq;
+
+	unsigned int pooled_intents;
+	u32 tx_coalesce_us;
 };
 
 #define to_glink_channel(_ept) container_of(_ept, struct glink_channel, ept)
@@ -366,9 +381,29 @@ static void qcom_glink_send_read_notify(struct qcom_glink *glink)
 	qcom_glink_tx_kick(glink);
 }
 
-static int qcom_glink_tx(struct qcom_glink *glink,
-			 const void *hdr, size_t hlen,
-			 const void *data, size_t dlen, bool wait)
+static enum hrtimer_restart qcom_glink_kick_timer(struct hrtimer *timer)
+{
+	struct qcom_glink *glink = container_of(timer, struct qcom_glink,
+						kick_timer);
+	unsigned long flags;
+
+	spin_lock_irqsave(&glink->tx_lock, flags);
+	qcom_glink_tx_kick(glink);
+	spin_unlock_irqrestore(&glink->tx_lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * With a @coalesce_us the doorbell is held back for up to that long, unless
+ * the tx fifo is more than half full, so that one interrupt of the remote
+ * covers a burst of messages.  Any doorbell rung in the meantime covers the
+ * delayed one as well.
+ */
+static int __qcom_glink_tx(struct qcom_glink *glink,
+			   const void *hdr, size_t hlen,
+			   const void *data, size_t dlen, bool wait,
+			   u32 coalesce_us)
 {
 	unsigned int tlen = hlen + dlen;
 	unsigned long flags;
@@ -414,7 +449,15 @@ static int qcom_glink_tx(struct qcom_glink *glink,
 	}
 
 	qcom_glink_tx_write(glink, hdr, hlen, data, dlen);
-	qcom_glink_tx_kick(glink);
+	if (coalesce_us &&
+	    qcom_glink_tx_avail(glink) > glink->tx_pipe->length / 2) {
+		if (!hrtimer_active(&glink->kick_timer))
+			hrtimer_start(&glink->kick_timer,
+				      us_to_ktime(coalesce_us),
+				      HRTIMER_MODE_REL_SOFT);
+	} else {
+		qcom_glink_tx_kick(glink);
+	}
 
 out:
 	spin_unlock_irqrestore(&glink->tx_lock, flags);
@@ -422,6 +465,13 @@ static int qcom_glink_tx(struct qcom_glink *glink,
 	return ret;
 }
 
+static int qcom_glink_tx(struct qcom_glink *glink,
+			 const void *hdr, size_t hlen,
+			 const void *data, size_t dlen, bool wait)
+{
+	return __qcom_glink_tx(glink, hdr, hlen, data, dlen, wait, 0);
+}
+
 static int qcom_glink_send_version(struct qcom_glink *glink)
 {
 	struct glink_msg msg;
@@ -868,12 +918,22 @@ static void qcom_glink_handle_rx_done(struct qcom_glink *glink,
  * The function searches for the local channel to which the request for
  * rx_intent has arrived and allocates and notifies the remote back
  */
+/*
+ * Intents requested by the remote are kept for reuse, in power of two size
+ * classes, up to GLINK_INTENT_POOL_MAX of them per channel.  The rx_done of
+ * such an intent then hands it straight back to the remote, which saves the
+ * request/advertise round trip on the next message of a busy channel.
+ */
+#define GLINK_INTENT_POOL_MAX		16
+#define GLINK_INTENT_POOL_MIN_SIZE	SZ_1K
+#define GLINK_INTENT_POOL_MAX_SIZE	SZ_64K
+
 static void qcom_glink_handle_intent_req(struct qcom_glink *glink,
 					 u32 cid, size_t size)
 {
 	struct glink_core_rx_intent *intent;
 	struct glink_channel *channel;
-	unsigned long flags;
+	bool reuse;
 
 	channel = qcom_glink_channel_ref_get(glink, true, cid);
 
@@ -886,9 +946,20 @@ static void qcom_glink_handle_intent_req(struct qcom_glink *glink,
 		return;
 	}
 
-	intent = qcom_glink_alloc_intent(glink, channel, size, false);
-	if (intent)
+	/* only called from qcom_glink_work(), so pooled_intents needs no lock */
+	reuse = (glink->features & GLINK_FEATURE_INTENT_REUSE) &&
+		channel->pooled_intents < GLINK_INTENT_POOL_MAX &&
+		size <= GLINK_INTENT_POOL_MAX_SIZE;
+	if (reuse)
+		size = roundup_pow_of_two(max_t(size_t, size,
+						GLINK_INTENT_POOL_MIN_SIZE));
+
+	intent = qcom_glink_alloc_intent(glink, channel, size, reuse);
+	if (intent) {
+		if (reuse)
+			channel->pooled_intents++;
 		qcom_glink_advertise_intent(glink, channel, intent);
+	}
 
 	qcom_glink_send_intent_req_ack(glink, channel, !!intent);
 	qcom_glink_channel_ref_put(channel);
@@ -936,6 +1007,7 @@ static int qcom_glink_rx_data(struct qcom_glink *glink, size_t avail)
 	unsigned int left_size;
 	unsigned int rcid;
 	unsigned int liid;
+	const void *data = NULL;
 	int ret = 0;
 	unsigned long flags;
 
@@ -1017,8 +1089,20 @@ static int qcom_glink_rx_data(struct qcom_glink *glink, size_t avail)
 		goto advance_rx;
 	}
 
-	qcom_glink_rx_peek(glink, intent->data + intent->offset,
-			   sizeof(hdr), chunk_size);
+	/*
+	 * An unfragmented message that doesn't wrap around the end of the fifo
+	 * is handed to the endpoint where it is, as the fifo isn't advanced
+	 * before the callback returns.
+	 */
+	if (!left_size && !intent->offset && glink->rx_pipe->peek_linear)
+		data = glink->rx_pipe->peek_linear(glink->rx_pipe, sizeof(hdr),
+						   chunk_size);
+
+	if (!data) {
+		qcom_glink_rx_peek(glink, intent->data + intent->offset,
+				   sizeof(hdr), chunk_size);
+		data = intent->data;
+	}
 	intent->offset += chunk_size;
 
 	/* Handle message when no fragments remain to be received */
@@ -1026,7 +1110,7 @@ static int qcom_glink_rx_data(struct qcom_glink *glink, size_t avail)
 		spin_lock(&channel->recv_lock);
 		if (channel->ept.cb) {
 			channel->ept.cb(channel->ept.rpdev,
-					intent->data,
+					(void *)data,
 					intent->offset,
 					channel->ept.priv,
 					RPMSG_ADDR_ANY);
@@ -1201,6 +1285,28 @@ static void qcom_glink_handle_signals(struct qcom_glink *glink,
 	qcom_glink_channel_ref_put(channel);
 }
 
+/*
+ * Spin on the rx fifo for up to rx_busy_poll_us, counted from when it first
+ * ran empty, so that a message arriving shortly after is handled without
+ * another interrupt.
+ */
+static bool qcom_glink_rx_busy_poll(struct qcom_glink *glink, u64 *end)
+{
+	if (!glink->rx_busy_poll_us)
+		return false;
+
+	if (!*end)
+		*end = local_clock() + glink->rx_busy_poll_us * NSEC_PER_USEC;
+
+	while (local_clock() < *end) {
+		if (qcom_glink_rx_avail(glink) >= sizeof(struct glink_msg))
+			return true;
+		cpu_relax();
+	}
+
+	return false;
+}
+
 void qcom_glink_native_rx(struct qcom_glink *glink)
 {
 	struct glink_msg msg;
@@ -1208,6 +1314,7 @@ void qcom_glink_native_rx(struct qcom_glink *glink)
 	unsigned int param2;
 	unsigned int avail;
 	unsigned int cmd;
+	u64 poll_end = 0;
 	int ret = 0;
 
 	/* To wakeup any blocking writers */
@@ -1215,8 +1322,11 @@ void qcom_glink_native_rx(struct qcom_glink *glink)
 
 	for (;;) {
 		avail = qcom_glink_rx_avail(glink);
-		if (avail < sizeof(msg))
-			break;
+		if (avail < sizeof(msg)) {
+			if (!qcom_glink_rx_busy_poll(glink, &poll_end))
+				break;
+			avail = qcom_glink_rx_avail(glink);
+		}
 
 		qcom_glink_rx_peek(glink, &msg, 0, sizeof(msg));
 
@@ -1404,6 +1514,8 @@ static int qcom_glink_announce_create(struct rpmsg_device *rpdev)
 	if (glink->intentless || !completion_done(&channel->open_ack))
 		return 0;
 
+	of_property_read_u32(np, "qcom,tx-coalesce-us", &channel->tx_coalesce_us);
+
 	prop = of_find_property(np, "qcom,intents", NULL);
 	if (prop) {
 		val = prop->value;
@@ -1553,7 +1665,8 @@ static int __qcom_glink_send(struct glink_channel *channel,
 						len - offset - chunk_size,
 						offset > 0);
 
-		ret = qcom_glink_tx(glink, &req, sizeof(req), data + offset, chunk_size, wait);
+		ret = __qcom_glink_tx(glink, &req, sizeof(req), data + offset,
+				      chunk_size, wait, channel->tx_coalesce_us);
 		if (ret) {
 			/* Mark intent available if we failed */
 			if (intent)
@@ -1942,6 +2055,10 @@ struct qcom_glink *qcom_glink_native_probe(struct device *dev,
 	INIT_LIST_HEAD(&glink->rx_queue);
 	INIT_WORK(&glink->rx_work, qcom_glink_work);
 	init_waitqueue_head(&glink->tx_avail_notify);
+	hrtimer_init(&glink->kick_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_SOFT);
+	glink->kick_timer.function = qcom_glink_kick_timer;
+	of_property_read_u32(dev->of_node, "qcom,rx-busy-poll-us",
+			     &glink->rx_busy_poll_us);
 
 	spin_lock_init(&glink->idr_lock);
 	idr_init(&glink->lcids);
@@ -1990,6 +2107,7 @@ void qcom_glink_native_remove(struct qcom_glink *glink)
 	glink->abort_tx = true;
 	wake_up_all(&glink->tx_avail_notify);
 	spin_unlock_irqrestore(&glink->tx_lock, flags);
+	hrtimer_cancel(&glink->kick_timer);
 
 	/* Abort any senders waiting for intent requests */
 	spin_lock_irqsave(&glink->idr_lock, flags);
@@ -19,6 +19,9 @@ struct qcom_glink_pipe {
 
 	void (*peek)(struct qcom_glink_pipe *glink_pipe, void *data,
 		     unsigned int offset, size_t count);
+	/* optional, NULL if the range wraps around the end of the fifo */
+	const void *(*peek_linear)(struct qcom_glink_pipe *glink_pipe,
+				   unsigned int offset, size_t count);
 	void (*advance)(struct qcom_glink_pipe *glink_pipe, size_t count);
 
 	void (*write)(struct qcom_glink_pipe *glink_pipe,
@@ -120,6 +120,27 @@ static void glink_smem_rx_peek(struct qcom_glink_pipe *np,
 		memcpy_fromio(data + len, pipe->fifo, (count - len));
 }
 
+static const void *glink_smem_rx_peek_linear(struct qcom_glink_pipe *np,
+					     unsigned int offset, size_t count)
+{
+	struct glink_smem_pipe *pipe = to_smem_pipe(np);
+	u32 tail;
+
+	tail = le32_to_cpu(*pipe->tail);
+
+	if (WARN_ON_ONCE(tail > pipe->native.length))
+		return NULL;
+
+	tail += offset;
+	if (tail >= pipe->native.length)
+		tail -= pipe->native.length;
+
+	if (count > pipe->native.length - tail)
+		return NULL;
+
+	return pipe->fifo + tail;
+}
+
 static void glink_smem_rx_advance(struct qcom_glink_pipe *np,
 				  size_t count)
 {
@@ -341,6 +362,7 @@ struct qcom_glink_smem *qcom_glink_smem_register(struct device *parent,
 	rx_pipe->smem = smem;
 	rx_pipe->native.avail = glink_smem_rx_avail;
 	rx_pipe->native.peek = glink_smem_rx_peek;
+	rx_pipe->native.peek_linear = glink_smem_rx_peek_linear;
 	rx_pipe->native.advance = glink_smem_rx_advance;
 
 	tx_pipe->smem = smem;
@@ -18,19 +18,28 @@
 #include <linux/fs.h>
 #include <linux/idr.h>
 #include <linux/kernel.h>
+#include <linux/log2.h>
 #include <linux/module.h>
 #include <linux/poll.h>
 #include <linux/rpmsg.h>
+#include <linux/sizes.h>
 #include <linux/skbuff.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
+#include <linux/vmalloc.h>
 #include <uapi/linux/rpmsg.h>
+#include <uapi/linux/rpmsg-batch.h>
 
 #include "rpmsg_char.h"
 #include "rpmsg_internal.h"
 
 #define RPMSG_DEV_MAX	(MINORMASK + 1)
 
+/* Largest batch of messages handled by a single ioctl */
+#define RPMSG_MMSG_MAX		1024
+/* Largest receive ring */
+#define RPMSG_RING_MAX_SIZE	SZ_16M
+
 static dev_t rpmsg_major;
 
 static DEFINE_IDA(rpmsg_ept_ida);
@@ -54,6 +63,10 @@ static DEFINE_IDA(rpmsg_minor_ida);
  *              on device open to prevent endpoint address update.
  * remote_flow_restricted: to indicate if the remote has requested for flow to be limited
  * remote_flow_updated: to indicate if the flow control has been requested
+ * @ring:	receive ring shared with userspace, header page then data, if set up
+ * @ring_size:	size of the data area of @ring
+ * @ring_head:	kernel copy of the producer offset of @ring
+ * @ring_dropped: kernel copy of the count of messages dropped by @ring
  */
 struct rpmsg_eptdev {
 	struct device dev;
@@ -72,6 +85,11 @@ struct rpmsg_eptdev {
 
 	bool remote_flow_restricted;
 	bool remote_flow_updated;
+
+	void *ring;
+	u32 ring_size;
+	u32 ring_head;
+	u32 ring_dropped;
 };
 
 int rpmsg_chrdev_eptdev_destroy(struct device *dev, void *data)
@@ -98,12 +116,69 @@ int rpmsg_chrdev_eptdev_destroy(struct device *dev, void *data)
 }
 EXPORT_SYMBOL(rpmsg_chrdev_eptdev_destroy);
 
+static bool rpmsg_ring_empty(struct rpmsg_eptdev *eptdev)
+{
+	struct rpmsg_ring_hdr *hdr = eptdev->ring;
+
+	return eptdev->ring_head == READ_ONCE(hdr->tail);
+}
+
+/*
+ * Write a message to the receive ring, or drop it if the ring is full.
+ * The tail is under control of userspace, a bogus one only makes the ring
+ * look full. Caller must hold queue_lock.
+ */
+static void rpmsg_ring_put(struct rpmsg_eptdev *eptdev, void *buf, int len)
+{
+	struct rpmsg_ring_hdr *hdr = eptdev->ring;
+	char *data = eptdev->ring + PAGE_SIZE;
+	u32 size = eptdev->ring_size;
+	u32 head = eptdev->ring_head;
+	u32 used = head - smp_load_acquire(&hdr->tail);
+	u32 off = head & (size - 1);
+	u32 rec = sizeof(struct rpmsg_ring_rec) + ALIGN(len, 8);
+	u32 pad = size - off < rec ? size - off : 0;
+	struct rpmsg_ring_rec *r;
+
+	if (used > size || rec + pad > size - used) {
+		WRITE_ONCE(hdr->dropped, ++eptdev->ring_dropped);
+		return;
+	}
+
+	/* records don't wrap, skip the end of the data area instead */
+	if (pad) {
+		r = (struct rpmsg_ring_rec *)(data + off);
+		r->len = pad - sizeof(*r);
+		r->flags = RPMSG_RING_REC_PAD;
+		head += pad;
+		off = 0;
+	}
+
+	r = (struct rpmsg_ring_rec *)(data + off);
+	r->len = len;
+	r->flags = 0;
+	memcpy(r + 1, buf, len);
+
+	eptdev->ring_head = head + rec;
+	smp_store_release(&hdr->head, eptdev->ring_head);
+}
+
 static int rpmsg_ept_cb(struct rpmsg_device *rpdev, void *buf, int len,
 			void *priv, u32 addr)
 {
 	struct rpmsg_eptdev *eptdev = priv;
 	struct sk_buff *skb;
 
+	spin_lock(&eptdev->queue_lock);
+	if (eptdev->ring) {
+		rpmsg_ring_put(eptdev, buf, len);
+		spin_unlock(&eptdev->queue_lock);
+
+		wake_up_interruptible(&eptdev->readq);
+		return 0;
+	}
+	spin_unlock(&eptdev->queue_lock);
+
 	skb = alloc_skb(len, GFP_ATOMIC);
 	if (!skb)
 		return -ENOMEM;
@@ -180,6 +255,8 @@ static int rpmsg_eptdev_release(struct inode *inode, struct file *filp)
 {
 	struct rpmsg_eptdev *eptdev = cdev_to_eptdev(inode->i_cdev);
 	struct device *dev = &eptdev->dev;
+	unsigned long flags;
+	void *ring;
 
 	/* Close the endpoint, if it's not already destroyed by the parent */
 	mutex_lock(&eptdev->ept_lock);
@@ -194,6 +271,12 @@ static int rpmsg_eptdev_release(struct inode *inode, struct file *filp)
 	/* Discard all SKBs */
 	skb_queue_purge(&eptdev->queue);
 
+	spin_lock_irqsave(&eptdev->queue_lock, flags);
+	ring = eptdev->ring;
+	eptdev->ring = NULL;
+	spin_unlock_irqrestore(&eptdev->queue_lock, flags);
+	vfree(ring);
+
 	put_device(dev);
 
 	return 0;
@@ -303,6 +386,9 @@ static __poll_t rpmsg_eptdev_poll(struct file *filp, poll_table *wait)
 	if (!skb_queue_empty(&eptdev->queue))
 		mask |= EPOLLIN | EPOLLRDNORM;
 
+	if (READ_ONCE(eptdev->ring) && !rpmsg_ring_empty(eptdev))
+		mask |= EPOLLIN | EPOLLRDNORM;
+
 	if (eptdev->remote_flow_updated)
 		mask |= EPOLLPRI;
 
@@ -313,6 +399,205 @@ static __poll_t rpmsg_eptdev_poll(struct file *filp, poll_table *wait)
 	return mask;
 }
 
+/*
+ * Receive up to mmsg.count messages, waiting only for the first one.
+ * Like read(), a message that can't be copied to userspace is lost.
+ */
+static long rpmsg_eptdev_recv_mmsg(struct file *filp,
+				   struct rpmsg_mmsg __user *argp)
+{
+	struct rpmsg_eptdev *eptdev = filp->private_data;
+	struct rpmsg_msg __user *umsgs;
+	struct rpmsg_mmsg mmsg;
+	struct rpmsg_msg msg;
+	unsigned long flags;
+	struct sk_buff *skb;
+	unsigned int i;
+	int ret = 0;
+
+	if (copy_from_user(&mmsg, argp, sizeof(mmsg)))
+		return -EFAULT;
+
+	if (mmsg.flags & ~RPMSG_MMSG_DONTWAIT)
+		return -EINVAL;
+
+	if (!eptdev->ept)
+		return -EPIPE;
+
+	if (skb_queue_empty(&eptdev->queue)) {
+		if ((filp->f_flags & O_NONBLOCK) ||
+		    (mmsg.flags & RPMSG_MMSG_DONTWAIT))
+			return -EAGAIN;
+
+		if (wait_event_interruptible(eptdev->readq,
+					     !skb_queue_empty(&eptdev->queue) ||
+					     !eptdev->ept))
+			return -ERESTARTSYS;
+
+		if (!eptdev->ept)
+			return -EPIPE;
+	}
+
+	umsgs = u64_to_user_ptr(mmsg.msgs);
+	mmsg.count = min_t(u32, mmsg.count, RPMSG_MMSG_MAX);
+	for (i = 0; i < mmsg.count; i++) {
+		if (copy_from_user(&msg, &umsgs[i], sizeof(msg))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		spin_lock_irqsave(&eptdev->queue_lock, flags);
+		skb = skb_dequeue(&eptdev->queue);
+		spin_unlock_irqrestore(&eptdev->queue_lock, flags);
+		if (!skb)
+			break;
+
+		msg.flags = skb->len > msg.len ? RPMSG_MSG_TRUNC : 0;
+		msg.len = min_t(u32, msg.len, skb->len);
+		if (copy_to_user(u64_to_user_ptr(msg.buf), skb->data, msg.len) ||
+		    copy_to_user(&umsgs[i], &msg, sizeof(msg)))
+			ret = -EFAULT;
+
+		kfree_skb(skb);
+		if (ret)
+			break;
+	}
+
+	return i ? i : ret;
+}
+
+/*
+ * Send mmsg.count messages, through a single bounce buffer sized for the
+ * largest of them. Stops at the first one that can't be sent.
+ */
+static long rpmsg_eptdev_send_mmsg(struct file *filp,
+				   struct rpmsg_mmsg __user *argp)
+{
+	struct rpmsg_eptdev *eptdev = filp->private_data;
+	bool nonblock = filp->f_flags & O_NONBLOCK;
+	struct rpmsg_msg __user *umsgs;
+	struct rpmsg_mmsg mmsg;
+	struct rpmsg_msg msg;
+	size_t kbuf_len = 0;
+	void *kbuf = NULL;
+	unsigned int i = 0;
+	int ret = 0;
+
+	if (copy_from_user(&mmsg, argp, sizeof(mmsg)))
+		return -EFAULT;
+
+	if (mmsg.flags & ~RPMSG_MMSG_DONTWAIT)
+		return -EINVAL;
+	if (mmsg.flags & RPMSG_MMSG_DONTWAIT)
+		nonblock = true;
+
+	if (mutex_lock_interruptible(&eptdev->ept_lock))
+		return -ERESTARTSYS;
+
+	if (!eptdev->ept) {
+		ret = -EPIPE;
+		goto unlock_eptdev;
+	}
+
+	umsgs = u64_to_user_ptr(mmsg.msgs);
+	mmsg.count = min_t(u32, mmsg.count, RPMSG_MMSG_MAX);
+	for (i = 0; i < mmsg.count; i++) {
+		if (copy_from_user(&msg, &umsgs[i], sizeof(msg))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		if (msg.flags) {
+			ret = -EINVAL;
+			break;
+		}
+
+		if (msg.len > kbuf_len) {
+			kfree(kbuf);
+			kbuf_len = 0;
+			kbuf = kmalloc(msg.len, GFP_KERNEL);
+			if (!kbuf) {
+				ret = -ENOMEM;
+				break;
+			}
+			kbuf_len = msg.len;
+		}
+
+		if (copy_from_user(kbuf, u64_to_user_ptr(msg.buf), msg.len)) {
+			ret = -EFAULT;
+			break;
+		}
+
+		if (nonblock) {
+			ret = rpmsg_trysendto(eptdev->ept, kbuf, msg.len,
+					      eptdev->chinfo.dst);
+			if (ret == -ENOMEM)
+				ret = -EAGAIN;
+		} else {
+			ret = rpmsg_sendto(eptdev->ept, kbuf, msg.len,
+					   eptdev->chinfo.dst);
+		}
+		if (ret)
+			break;
+	}
+
+unlock_eptdev:
+	mutex_unlock(&eptdev->ept_lock);
+	kfree(kbuf);
+
+	return i ? i : ret;
+}
+
+static long rpmsg_eptdev_setup_ring(struct rpmsg_eptdev *eptdev,
+				    struct rpmsg_ring_setup __user *argp)
+{
+	struct rpmsg_ring_setup setup;
+	struct rpmsg_ring_hdr *hdr;
+	unsigned long flags;
+	void *ring;
+
+	if (copy_from_user(&setup, argp, sizeof(setup)))
+		return -EFAULT;
+
+	if (setup.flags || setup.size < PAGE_SIZE ||
+	    setup.size > RPMSG_RING_MAX_SIZE || !is_power_of_2(setup.size))
+		return -EINVAL;
+
+	ring = vmalloc_user(PAGE_SIZE + setup.size);
+	if (!ring)
+		return -ENOMEM;
+
+	hdr = ring;
+	hdr->size = setup.size;
+	hdr->data_offset = PAGE_SIZE;
+
+	spin_lock_irqsave(&eptdev->queue_lock, flags);
+	if (eptdev->ring) {
+		spin_unlock_irqrestore(&eptdev->queue_lock, flags);
+		vfree(ring);
+		return -EBUSY;
+	}
+	eptdev->ring_size = setup.size;
+	eptdev->ring_head = 0;
+	eptdev->ring_dropped = 0;
+	WRITE_ONCE(eptdev->ring, ring);
+	spin_unlock_irqrestore(&eptdev->queue_lock, flags);
+
+	return 0;
+}
+
+static int rpmsg_eptdev_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct rpmsg_eptdev *eptdev = filp->private_data;
+	void *ring = READ_ONCE(eptdev->ring);
+
+	/* the ring is only freed on release, after all mappings are gone */
+	if (!ring || vma->vm_pgoff)
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, ring, 0);
+}
+
 static long rpmsg_eptdev_ioctl(struct file *fp, unsigned int cmd,
 			       unsigned long arg)
 {
@@ -342,6 +627,15 @@ static long rpmsg_eptdev_ioctl(struct file *fp, unsigned int cmd,
 		}
 		ret = rpmsg_chrdev_eptdev_destroy(&eptdev->dev, NULL);
 		break;
+	case RPMSG_RECV_MMSG_IOCTL:
+		ret = rpmsg_eptdev_recv_mmsg(fp, (void __user *)arg);
+		break;
+	case RPMSG_SEND_MMSG_IOCTL:
+		ret = rpmsg_eptdev_send_mmsg(fp, (void __user *)arg);
+		break;
+	case RPMSG_SETUP_RING_IOCTL:
+		ret = rpmsg_eptdev_setup_ring(eptdev, (void __user *)arg);
+		break;
 	default:
 		ret = -EINVAL;
 	}
@@ -356,6 +650,7 @@ static const struct file_operations rpmsg_eptdev_fops = {
 	.read_iter = rpmsg_eptdev_read_iter,
 	.write_iter = rpmsg_eptdev_write_iter,
 	.poll = rpmsg_eptdev_poll,
+	.mmap = rpmsg_eptdev_mmap,
 	.unlocked_ioctl = rpmsg_eptdev_ioctl,
 	.compat_ioctl = compat_ptr_ioctl,
 };
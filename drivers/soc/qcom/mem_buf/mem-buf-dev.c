@@ -5,6 +5,7 @@
  */
 
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
@@ -17,21 +18,105 @@
 #include "mem-buf-dev.h"
 #include "mem-buf-ids.h"
 
+#define CREATE_TRACE_POINTS
+#include "trace-mem-buf.h"
+EXPORT_TRACEPOINT_SYMBOL(send_alloc_req);
+EXPORT_TRACEPOINT_SYMBOL(receive_alloc_req);
+EXPORT_TRACEPOINT_SYMBOL(send_relinquish_msg);
+EXPORT_TRACEPOINT_SYMBOL(receive_relinquish_msg);
+EXPORT_TRACEPOINT_SYMBOL(send_alloc_resp_msg);
+EXPORT_TRACEPOINT_SYMBOL(receive_alloc_resp_msg);
+EXPORT_TRACEPOINT_SYMBOL(mem_buf_alloc_info);
+EXPORT_TRACEPOINT_SYMBOL(send_relinquish_resp_msg);
+EXPORT_TRACEPOINT_SYMBOL(receive_relinquish_resp_msg);
+
+/*
+ * Maximum number of sg entries handed to a single hyp_assign_table() call.
+ * Larger tables are assigned in batches, which bounds the size of the
+ * descriptors built for each call and lets the CPU be rescheduled between
+ * them.
+ */
+#define MEM_BUF_ASSIGN_BATCH	512
+/* Largest entry built by merging contiguous ones */
+#define MEM_BUF_MAX_SEG_LEN	(UINT_MAX & PAGE_MASK)
+
 struct device *mem_buf_dev;
 EXPORT_SYMBOL_GPL(mem_buf_dev);
 
 unsigned char mem_buf_capability;
 EXPORT_SYMBOL_GPL(mem_buf_capability);
 
-int mem_buf_hyp_assign_table(struct sg_table *sgt, u32 *src_vmid, int source_nelems,
-			     int *dest_vmids, int *dest_perms, int dest_nelems)
+static bool mem_buf_sg_contiguous(struct scatterlist *sg, phys_addr_t end,
+				  unsigned int len)
+{
+	return sg_phys(sg) == end && sg->length <= MEM_BUF_MAX_SEG_LEN - len;
+}
+
+/*
+ * Returns a copy of @sgt in which physically contiguous entries are merged,
+ * or NULL if there is nothing to merge or no memory for the copy, @sgt then
+ * being used as is. Buffers built out of small chunks are often largely
+ * contiguous, and every entry costs the hypervisor time.
+ */
+static struct sg_table *mem_buf_coalesce_sgt(struct sg_table *sgt)
+{
+	struct scatterlist *sg, *new_sg = NULL;
+	struct sg_table *new_sgt;
+	unsigned int nents = 0, len = 0;
+	phys_addr_t end = 0;
+	int i, ret;
+
+	for_each_sgtable_sg(sgt, sg, i) {
+		if (!nents || !mem_buf_sg_contiguous(sg, end, len)) {
+			nents++;
+			len = 0;
+		}
+		len += sg->length;
+		end = sg_phys(sg) + sg->length;
+	}
+
+	if (nents == sgt->orig_nents)
+		return NULL;
+
+	new_sgt = kzalloc(sizeof(*new_sgt), GFP_KERNEL);
+	if (!new_sgt)
+		return NULL;
+
+	ret = sg_alloc_table(new_sgt, nents, GFP_KERNEL);
+	if (ret) {
+		kfree(new_sgt);
+		return NULL;
+	}
+
+	for_each_sgtable_sg(sgt, sg, i) {
+		if (new_sg && mem_buf_sg_contiguous(sg, end, new_sg->length)) {
+			new_sg->length += sg->length;
+		} else {
+			new_sg = new_sg ? sg_next(new_sg) : new_sgt->sgl;
+			sg_set_page(new_sg, sg_page(sg), sg->length, sg->offset);
+		}
+		end = sg_phys(sg) + sg->length;
+	}
+
+	return new_sgt;
+}
+
+static void mem_buf_free_sgt(struct sg_table *sgt)
+{
+	if (!sgt)
+		return;
+
+	sg_free_table(sgt);
+	kfree(sgt);
+}
+
+static int __mem_buf_hyp_assign_table(struct sg_table *sgt, u32 *src_vmid,
+				      int source_nelems, int *dest_vmids,
+				      int *dest_perms, int dest_nelems)
 {
 	char *verb;
 	int ret;
 
-	if (!mem_buf_vm_uses_hyp_assign())
-		return 0;
-
 	verb = *src_vmid == current_vmid ? "Assign" : "Unassign";
 
 	pr_debug("%s memory to target VMIDs\n", verb);
@@ -44,20 +129,93 @@ int mem_buf_hyp_assign_table(struct sg_table *sgt, u32 *src_vmid, int source_nel
 	return ret;
 }
 
+/*
+ * Assigns @sgt in batches of MEM_BUF_ASSIGN_BATCH entries. If a batch fails
+ * after others succeeded, memory assigned away from this VM is given back.
+ * Returns -EADDRNOTAVAIL if that isn't possible, the memory then being in
+ * an unknown state.
+ */
+int mem_buf_hyp_assign_table(struct sg_table *sgt, u32 *src_vmid, int source_nelems,
+			     int *dest_vmids, int *dest_perms, int dest_nelems)
+{
+	int src_perms[] = {PERM_READ | PERM_WRITE | PERM_EXEC};
+	struct scatterlist *sg = sgt->sgl;
+	unsigned int done = 0, n, i;
+	struct sg_table batch;
+	int ret, ret2;
+
+	if (!mem_buf_vm_uses_hyp_assign())
+		return 0;
+
+	if (sgt->orig_nents <= MEM_BUF_ASSIGN_BATCH)
+		return __mem_buf_hyp_assign_table(sgt, src_vmid, source_nelems,
+						  dest_vmids, dest_perms,
+						  dest_nelems);
+
+	while (done < sgt->orig_nents) {
+		n = min_t(unsigned int, sgt->orig_nents - done,
+			  MEM_BUF_ASSIGN_BATCH);
+		batch.sgl = sg;
+		batch.nents = batch.orig_nents = n;
+
+		ret = __mem_buf_hyp_assign_table(&batch, src_vmid, source_nelems,
+						 dest_vmids, dest_perms,
+						 dest_nelems);
+		if (ret)
+			goto undo;
+
+		for (i = 0; i < n; i++)
+			sg = sg_next(sg);
+		done += n;
+		cond_resched();
+	}
+
+	return 0;
+
+undo:
+	if (!done)
+		return ret;
+
+	if (source_nelems != 1 || *src_vmid != current_vmid)
+		return -EADDRNOTAVAIL;
+
+	batch.sgl = sgt->sgl;
+	batch.nents = batch.orig_nents = done;
+	ret2 = mem_buf_hyp_assign_table(&batch, (u32 *)dest_vmids, dest_nelems,
+					(int *)src_vmid, src_perms,
+					ARRAY_SIZE(src_perms));
+	if (ret2 < 0) {
+		pr_err("hyp_assign failed while recovering from another error: %d\n",
+		       ret2);
+		return -EADDRNOTAVAIL;
+	}
+
+	return ret;
+}
+
 int mem_buf_assign_mem(u32 op, struct sg_table *sgt,
 		       struct mem_buf_lend_kernel_arg *arg)
 {
 	int src_vmid[] = {current_vmid};
 	int src_perms[] = {PERM_READ | PERM_WRITE | PERM_EXEC};
+	struct sg_table *coalesced;
+	unsigned int nents;
+	u64 start;
 	int ret, ret2;
 
 	if (!sgt || !arg->nr_acl_entries || !arg->vmids || !arg->perms)
 		return -EINVAL;
 
+	start = ktime_get_ns();
+	nents = sgt->orig_nents;
+	coalesced = mem_buf_coalesce_sgt(sgt);
+	if (coalesced)
+		sgt = coalesced;
+
 	ret = mem_buf_hyp_assign_table(sgt, src_vmid, ARRAY_SIZE(src_vmid), arg->vmids, arg->perms,
 					arg->nr_acl_entries);
 	if (ret)
-		return ret;
+		goto out;
 
 	ret = mem_buf_assign_mem_gunyah(op, sgt, arg);
 	if (ret) {
@@ -66,10 +224,14 @@ int mem_buf_assign_mem(u32 op, struct sg_table *sgt,
 		if (ret2 < 0) {
 			pr_err("hyp_assign failed while recovering from another error: %d\n",
 			       ret2);
-			return -EADDRNOTAVAIL;
+			ret = -EADDRNOTAVAIL;
 		}
 	}
 
+out:
+	trace_mem_buf_assign_mem(nents, sgt->orig_nents,
+				 ktime_get_ns() - start, ret);
+	mem_buf_free_sgt(coalesced);
 	return ret;
 }
 EXPORT_SYMBOL_GPL(mem_buf_assign_mem);
@@ -80,19 +242,31 @@ int mem_buf_unassign_mem(struct sg_table *sgt, int *src_vmids,
 {
 	int dst_vmid[] = {current_vmid};
 	int dst_perm[] = {PERM_READ | PERM_WRITE | PERM_EXEC};
+	struct sg_table *coalesced;
+	unsigned int nents;
+	u64 start;
 	int ret;
 
 	if (!sgt || !src_vmids || !nr_acl_entries)
 		return -EINVAL;
 
+	start = ktime_get_ns();
 	if (memparcel_hdl != MEM_BUF_MEMPARCEL_INVALID) {
 		ret = mem_buf_unassign_mem_gunyah(memparcel_hdl);
 		if (ret)
 			return ret;
 	}
 
+	nents = sgt->orig_nents;
+	coalesced = mem_buf_coalesce_sgt(sgt);
+	if (coalesced)
+		sgt = coalesced;
+
 	ret = mem_buf_hyp_assign_table(sgt, src_vmids, nr_acl_entries,
 			       dst_vmid, dst_perm, ARRAY_SIZE(dst_vmid));
+	trace_mem_buf_unassign_mem(nents, sgt->orig_nents,
+				   ktime_get_ns() - start, ret);
+	mem_buf_free_sgt(coalesced);
 	return ret;
 }
 EXPORT_SYMBOL_GPL(mem_buf_unassign_mem);
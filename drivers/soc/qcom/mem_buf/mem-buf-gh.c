@@ -14,6 +14,7 @@
 #include <linux/dma-map-ops.h>
 #include <linux/memremap.h>
 #include <linux/cma.h>
+#include <linux/xarray.h>
 
 #include "../../../../drivers/dma-buf/heaps/qcom_sg_ops.h"
 #include "mem-buf-gh.h"
@@ -25,17 +26,20 @@
 #define MEM_BUF_TIMEOUT_MS 3500
 #define to_rmt_msg(_work) container_of(_work, struct mem_buf_rmt_msg, work)
 
-/* Maintains a list of memory buffers requested from other VMs */
-static DEFINE_MUTEX(mem_buf_list_lock);
-static LIST_HEAD(mem_buf_list);
+/* The number of memory buffers requested from other VMs that are in use */
+static atomic_t mem_buf_nr_membufs = ATOMIC_INIT(0);
 
 /* Data structures for tracking message queue usage. */
 static struct workqueue_struct *mem_buf_wq;
 static void *mem_buf_msgq_hdl;
 
-/* Maintains a list of memory buffers lent out to other VMs */
-static DEFINE_MUTEX(mem_buf_xfer_mem_list_lock);
-static LIST_HEAD(mem_buf_xfer_mem_list);
+/*
+ * Memory buffers lent out to other VMs, indexed by obj_id. An obj_id is
+ * reserved for as long as its mem_buf_xfer_mem exists, but the entry only
+ * points to it while the memory is lent and can be relinquished.
+ */
+static DEFINE_XARRAY_ALLOC(mem_buf_xfer_mems);
+static u32 mem_buf_next_obj_id;
 
 /**
  * struct mem_buf_rmt_msg: Represents a message sent from a remote VM
@@ -62,8 +66,7 @@ struct mem_buf_rmt_msg {
  * @hdl: The memparcel handle associated with the memory
  * @trans_type: The type of memory transfer associated with the memory (donation,
  * share, lend).
- * @entry: List entry for maintaining a list of memory buffers that are lent
- * out.
+ * @entry: List entry for the reservoir of memory lent ahead of time.
  * @nr_acl_entries: The number of VMIDs and permissions associated with the
  * memory
  * @dst_vmids: The VMIDs that have access to the memory
@@ -104,8 +107,6 @@ struct mem_buf_xfer_mem {
  * @dst_data: Memory type specific data used by the native VM when adding the
  * memory to the system.
  * @filp: Pointer to the file structure for the membuf
- * @entry: List head for maintaing a list of memory buffers that have been
- * provided by remote VMs.
  * @obj_id: Uniquely identifies this object.
  */
 struct mem_buf_desc {
@@ -119,11 +120,20 @@ struct mem_buf_desc {
 	enum mem_buf_mem_type dst_mem_type;
 	void *dst_data;
 	struct file *filp;
-	struct list_head entry;
 	u32 obj_id;
 };
-static DEFINE_IDR(mem_buf_obj_idr);
-static DEFINE_MUTEX(mem_buf_idr_mutex);
+
+/**
+ * struct mem_buf_batch_desc - The consumer side state of a batch allocation.
+ * @nr_entries: The number of buffers that were requested.
+ * @membufs: The buffers that were requested, in request order.
+ * @rets: The outcome of each allocation as reported by the remote VM.
+ */
+struct mem_buf_batch_desc {
+	unsigned int nr_entries;
+	struct mem_buf_desc **membufs;
+	int *rets;
+};
 
 struct mem_buf_xfer_dmaheap_mem {
 	char name[MEM_BUF_MAX_DMAHEAP_NAME_LEN];
@@ -145,24 +155,41 @@ struct mem_buf_dmabuf_obj {
 
 static int mem_buf_alloc_obj_id(void)
 {
+	u32 obj_id;
 	int ret;
 
-	mutex_lock(&mem_buf_idr_mutex);
-	ret = idr_alloc_cyclic(&mem_buf_obj_idr, NULL, 0, INT_MAX, GFP_KERNEL);
-	mutex_unlock(&mem_buf_idr_mutex);
+	/* A NULL entry only reserves the obj_id until the memory is lent */
+	ret = xa_alloc_cyclic(&mem_buf_xfer_mems, &obj_id, NULL, xa_limit_31b,
+			      &mem_buf_next_obj_id, GFP_KERNEL);
 	if (ret < 0) {
 		pr_err("%s: failed to allocate obj id rc: %d\n",
 		       __func__, ret);
 		return ret;
 	}
-	return ret;
+	return obj_id;
 }
 
 static void mem_buf_destroy_obj_id(u32 obj_id)
 {
-	mutex_lock(&mem_buf_idr_mutex);
-	idr_remove(&mem_buf_obj_idr, obj_id);
-	mutex_unlock(&mem_buf_idr_mutex);
+	xa_erase(&mem_buf_xfer_mems, obj_id);
+}
+
+/*
+ * Takes lent memory out of the lookup, so that only one of a relinquish and a
+ * failed allocation response can clean it up. The obj_id stays reserved until
+ * the memory is freed.
+ */
+static struct mem_buf_xfer_mem *mem_buf_xfer_mem_unpublish(u32 obj_id)
+{
+	struct mem_buf_xfer_mem *xfer_mem;
+
+	xa_lock(&mem_buf_xfer_mems);
+	xfer_mem = xa_load(&mem_buf_xfer_mems, obj_id);
+	if (xfer_mem)
+		__xa_store(&mem_buf_xfer_mems, obj_id, NULL, 0);
+	xa_unlock(&mem_buf_xfer_mems);
+
+	return xfer_mem;
 }
 
 /* Functions invoked when treating allocation requests from other VMs. */
@@ -456,25 +483,22 @@ static void mem_buf_free_xfer_mem_type_data(enum mem_buf_mem_type type,
 }
 
 static
-struct mem_buf_xfer_mem *mem_buf_prep_xfer_mem(void *req_msg)
+struct mem_buf_xfer_mem *mem_buf_prep_xfer_mem(u64 size, enum mem_buf_mem_type mem_type,
+					       struct gh_acl_desc *acl_desc,
+					       void *arb_payload)
 {
 	int ret;
 	struct mem_buf_xfer_mem *xfer_mem;
 	u32 nr_acl_entries;
-	void *arb_payload;
-	enum mem_buf_mem_type mem_type;
 	void *mem_type_data;
 
-	nr_acl_entries = get_alloc_req_nr_acl_entries(req_msg);
+	nr_acl_entries = acl_desc->n_acl_entries;
 	if (nr_acl_entries != 1)
 		return ERR_PTR(-EINVAL);
 
-	arb_payload = get_alloc_req_arb_payload(req_msg);
-	if (!arb_payload)
+	if (mem_type == MEM_BUF_DMAHEAP_MEM_TYPE && !arb_payload)
 		return ERR_PTR(-EINVAL);
 
-	mem_type = get_alloc_req_src_mem_type(req_msg);
-
 	xfer_mem = kzalloc(sizeof(*xfer_mem), GFP_KERNEL);
 	if (!xfer_mem)
 		return ERR_PTR(-ENOMEM);
@@ -486,10 +510,10 @@ struct mem_buf_xfer_mem *mem_buf_prep_xfer_mem(void *req_msg)
 	}
 	xfer_mem->obj_id = ret;
 
-	xfer_mem->size = get_alloc_req_size(req_msg);
+	xfer_mem->size = size;
 	xfer_mem->mem_type = mem_type;
 	xfer_mem->nr_acl_entries = nr_acl_entries;
-	ret = mem_buf_gh_acl_desc_to_vmid_perm_list(get_alloc_req_gh_acl_desc(req_msg),
+	ret = mem_buf_gh_acl_desc_to_vmid_perm_list(acl_desc,
 						    &xfer_mem->dst_vmids,
 						    &xfer_mem->dst_perms);
 	if (ret) {
@@ -559,14 +583,17 @@ static int mem_buf_get_mem_xfer_type_gh(struct gh_acl_desc *acl_desc, int owner_
 	return GH_RM_TRANS_TYPE_LEND;
 }
 
-static struct mem_buf_xfer_mem *mem_buf_process_alloc_req(void *req)
+static struct mem_buf_xfer_mem *mem_buf_lend_xfer_mem(u64 size,
+						       enum mem_buf_mem_type mem_type,
+						       u32 xfer_type,
+						       struct gh_acl_desc *acl_desc,
+						       void *arb_payload)
 {
 	int ret;
-	u32 xfer_type;
 	struct mem_buf_xfer_mem *xfer_mem;
 	struct mem_buf_lend_kernel_arg arg = {0};
 
-	xfer_mem = mem_buf_prep_xfer_mem(req);
+	xfer_mem = mem_buf_prep_xfer_mem(size, mem_type, acl_desc, arb_payload);
 	if (IS_ERR(xfer_mem))
 		return xfer_mem;
 
@@ -575,8 +602,6 @@ static struct mem_buf_xfer_mem *mem_buf_process_alloc_req(void *req)
 		goto err_rmt_alloc;
 
 	if (!xfer_mem->secure_alloc) {
-		xfer_type = get_alloc_req_xfer_type(req);
-
 		arg.nr_acl_entries = xfer_mem->nr_acl_entries;
 		arg.vmids = xfer_mem->dst_vmids;
 		arg.perms = xfer_mem->dst_perms;
@@ -588,10 +613,6 @@ static struct mem_buf_xfer_mem *mem_buf_process_alloc_req(void *req)
 		xfer_mem->trans_type = xfer_type;
 	}
 
-	mutex_lock(&mem_buf_xfer_mem_list_lock);
-	list_add(&xfer_mem->entry, &mem_buf_xfer_mem_list);
-	mutex_unlock(&mem_buf_xfer_mem_list_lock);
-
 	return xfer_mem;
 
 err_assign_mem:
@@ -643,6 +664,203 @@ static void mem_buf_cleanup_alloc_req(struct mem_buf_xfer_mem *xfer_mem,
 	mem_buf_free_xfer_mem(xfer_mem);
 }
 
+/*
+ * Reservoir of buddy memory lent to one VM ahead of time. Allocation requests
+ * from that VM for buddy memory of the reservoir size are served from it
+ * without allocating or assigning anything, and the reservoir is refilled
+ * from mem_buf_wq afterwards. It is disabled unless reservoir_vmid,
+ * reservoir_size and reservoir_depth are all set; changes take effect on the
+ * next allocation request.
+ */
+static int reservoir_vmid = -1;
+module_param(reservoir_vmid, int, 0644);
+MODULE_PARM_DESC(reservoir_vmid, "VMID to lend reservoir memory to ahead of time, -1 to disable");
+
+static int reservoir_perms = PERM_READ | PERM_WRITE;
+module_param(reservoir_perms, int, 0644);
+MODULE_PARM_DESC(reservoir_perms, "Permissions of reservoir_vmid on reservoir memory");
+
+static unsigned long reservoir_size;
+module_param(reservoir_size, ulong, 0644);
+MODULE_PARM_DESC(reservoir_size, "Size in bytes of each reservoir buffer");
+
+static unsigned int reservoir_depth;
+module_param(reservoir_depth, uint, 0644);
+MODULE_PARM_DESC(reservoir_depth, "Number of reservoir buffers to keep lent");
+
+static DEFINE_SPINLOCK(mem_buf_reservoir_lock);
+static LIST_HEAD(mem_buf_reservoir);
+static unsigned int mem_buf_reservoir_count;
+static bool mem_buf_reservoir_active;
+
+static bool mem_buf_reservoir_match(struct mem_buf_xfer_mem *xfer_mem, size_t size,
+				    int vmid, int perms)
+{
+	return xfer_mem->size == size && xfer_mem->dst_vmids[0] == vmid &&
+	       xfer_mem->dst_perms[0] == perms;
+}
+
+static void mem_buf_reservoir_refill_work(struct work_struct *work)
+{
+	int vmid = READ_ONCE(reservoir_vmid);
+	int perms = READ_ONCE(reservoir_perms);
+	size_t size = PAGE_ALIGN(READ_ONCE(reservoir_size));
+	unsigned int depth = READ_ONCE(reservoir_depth);
+	struct mem_buf_xfer_mem *xfer_mem, *tmp;
+	struct gh_acl_desc *acl_desc;
+	LIST_HEAD(stale);
+	bool active;
+
+	if (vmid < 0 || !size)
+		depth = 0;
+
+	/* Hand back buffers the current configuration no longer asks for */
+	spin_lock(&mem_buf_reservoir_lock);
+	list_for_each_entry_safe(xfer_mem, tmp, &mem_buf_reservoir, entry) {
+		if (mem_buf_reservoir_count > depth ||
+		    !mem_buf_reservoir_match(xfer_mem, size, vmid, perms)) {
+			list_move(&xfer_mem->entry, &stale);
+			mem_buf_reservoir_count--;
+		}
+	}
+	spin_unlock(&mem_buf_reservoir_lock);
+
+	list_for_each_entry_safe(xfer_mem, tmp, &stale, entry) {
+		list_del_init(&xfer_mem->entry);
+		mem_buf_cleanup_alloc_req(xfer_mem, xfer_mem->hdl);
+	}
+
+	if (!depth)
+		return;
+
+	acl_desc = mem_buf_vmid_perm_list_to_gh_acl(&vmid, &perms, 1);
+	if (IS_ERR(acl_desc))
+		return;
+
+	for (;;) {
+		spin_lock(&mem_buf_reservoir_lock);
+		active = mem_buf_reservoir_active && mem_buf_reservoir_count < depth;
+		spin_unlock(&mem_buf_reservoir_lock);
+		if (!active)
+			break;
+
+		xfer_mem = mem_buf_lend_xfer_mem(size, MEM_BUF_BUDDY_MEM_TYPE,
+						 GH_RM_TRANS_TYPE_LEND, acl_desc, NULL);
+		if (IS_ERR(xfer_mem)) {
+			pr_err_ratelimited("%s: failed to refill reservoir rc: %ld\n",
+					   __func__, PTR_ERR(xfer_mem));
+			break;
+		}
+
+		spin_lock(&mem_buf_reservoir_lock);
+		active = mem_buf_reservoir_active;
+		if (active) {
+			list_add_tail(&xfer_mem->entry, &mem_buf_reservoir);
+			mem_buf_reservoir_count++;
+		}
+		spin_unlock(&mem_buf_reservoir_lock);
+		if (!active) {
+			mem_buf_cleanup_alloc_req(xfer_mem, xfer_mem->hdl);
+			break;
+		}
+	}
+
+	kfree(acl_desc);
+}
+
+static DECLARE_WORK(mem_buf_reservoir_work, mem_buf_reservoir_refill_work);
+
+static struct mem_buf_xfer_mem *mem_buf_reservoir_take(u64 size,
+						       enum mem_buf_mem_type mem_type,
+						       u32 xfer_type,
+						       struct gh_acl_desc *acl_desc)
+{
+	struct mem_buf_xfer_mem *iter, *xfer_mem = NULL;
+	bool refill;
+
+	spin_lock(&mem_buf_reservoir_lock);
+	if (mem_type == MEM_BUF_BUDDY_MEM_TYPE && xfer_type == GH_RM_TRANS_TYPE_LEND &&
+	    acl_desc->n_acl_entries == 1) {
+		list_for_each_entry(iter, &mem_buf_reservoir, entry) {
+			if (mem_buf_reservoir_match(iter, PAGE_ALIGN(size),
+						    acl_desc->acl_entries[0].vmid,
+						    acl_desc->acl_entries[0].perms)) {
+				xfer_mem = iter;
+				list_del_init(&xfer_mem->entry);
+				mem_buf_reservoir_count--;
+				break;
+			}
+		}
+	}
+	refill = mem_buf_reservoir_active &&
+		 (mem_buf_reservoir_count || READ_ONCE(reservoir_depth));
+	spin_unlock(&mem_buf_reservoir_lock);
+
+	if (refill)
+		queue_work(mem_buf_wq, &mem_buf_reservoir_work);
+
+	return xfer_mem;
+}
+
+static void mem_buf_reservoir_start(void)
+{
+	spin_lock(&mem_buf_reservoir_lock);
+	mem_buf_reservoir_active = true;
+	spin_unlock(&mem_buf_reservoir_lock);
+	queue_work(mem_buf_wq, &mem_buf_reservoir_work);
+}
+
+static void mem_buf_reservoir_stop(void)
+{
+	struct mem_buf_xfer_mem *xfer_mem, *tmp;
+	LIST_HEAD(entries);
+
+	spin_lock(&mem_buf_reservoir_lock);
+	mem_buf_reservoir_active = false;
+	spin_unlock(&mem_buf_reservoir_lock);
+	cancel_work_sync(&mem_buf_reservoir_work);
+
+	spin_lock(&mem_buf_reservoir_lock);
+	list_splice_init(&mem_buf_reservoir, &entries);
+	mem_buf_reservoir_count = 0;
+	spin_unlock(&mem_buf_reservoir_lock);
+
+	list_for_each_entry_safe(xfer_mem, tmp, &entries, entry) {
+		list_del_init(&xfer_mem->entry);
+		mem_buf_cleanup_alloc_req(xfer_mem, xfer_mem->hdl);
+	}
+}
+
+static struct mem_buf_xfer_mem *__mem_buf_process_alloc_req(u64 size,
+							     enum mem_buf_mem_type mem_type,
+							     u32 xfer_type,
+							     struct gh_acl_desc *acl_desc,
+							     void *arb_payload)
+{
+	struct mem_buf_xfer_mem *xfer_mem;
+
+	xfer_mem = mem_buf_reservoir_take(size, mem_type, xfer_type, acl_desc);
+	if (!xfer_mem)
+		xfer_mem = mem_buf_lend_xfer_mem(size, mem_type, xfer_type,
+						 acl_desc, arb_payload);
+	if (IS_ERR(xfer_mem))
+		return xfer_mem;
+
+	/* The obj_id is already reserved, so this does not allocate */
+	xa_store(&mem_buf_xfer_mems, xfer_mem->obj_id, xfer_mem, GFP_KERNEL);
+
+	return xfer_mem;
+}
+
+static struct mem_buf_xfer_mem *mem_buf_process_alloc_req(void *req)
+{
+	return __mem_buf_process_alloc_req(get_alloc_req_size(req),
+					   get_alloc_req_src_mem_type(req),
+					   get_alloc_req_xfer_type(req),
+					   get_alloc_req_gh_acl_desc(req),
+					   get_alloc_req_arb_payload(req));
+}
+
 static void mem_buf_alloc_req_work(struct work_struct *work)
 {
 	struct mem_buf_rmt_msg *rmt_msg = to_rmt_msg(work);
@@ -689,32 +907,87 @@ static void mem_buf_alloc_req_work(struct work_struct *work)
 	return;
 
 out_err:
-	if (xfer_mem) {
-		mutex_lock(&mem_buf_xfer_mem_list_lock);
-		list_del(&xfer_mem->entry);
-		mutex_unlock(&mem_buf_xfer_mem_list_lock);
+	if (xfer_mem && mem_buf_xfer_mem_unpublish(obj_id))
 		mem_buf_cleanup_alloc_req(xfer_mem, xfer_mem->hdl);
+}
+
+/*
+ * Every entry of a batch is allocated and lent independently, and the outcome
+ * of each is reported in one response, so that the requesting VM can keep the
+ * buffers that were lent and relinquish them one by one later on.
+ */
+static void mem_buf_alloc_batch_req_work(struct work_struct *work)
+{
+	struct mem_buf_rmt_msg *rmt_msg = to_rmt_msg(work);
+	struct mem_buf_alloc_batch_req *req_msg = rmt_msg->msg;
+	struct mem_buf_alloc_batch_resp_entry entries[MEM_BUF_MAX_BATCH_ENTRIES] = {};
+	struct mem_buf_xfer_mem *xfer_mems[MEM_BUF_MAX_BATCH_ENTRIES] = {};
+	struct mem_buf_xfer_mem *xfer_mem;
+	void *resp_msg;
+	unsigned int i;
+	int ret;
+
+	if (rmt_msg->msg_size < sizeof(*req_msg) || !req_msg->nr_entries ||
+	    req_msg->nr_entries > MEM_BUF_MAX_BATCH_ENTRIES) {
+		pr_err("%s: malformed batch allocation request\n", __func__);
+		goto out_free_msg;
+	}
+
+	trace_receive_alloc_batch_req(req_msg);
+	for (i = 0; i < req_msg->nr_entries; i++) {
+		xfer_mem = __mem_buf_process_alloc_req(req_msg->sizes[i],
+						       req_msg->src_mem_type,
+						       req_msg->trans_type,
+						       &req_msg->acl_desc,
+						       get_alloc_batch_req_arb_payload(req_msg));
+		if (IS_ERR(xfer_mem)) {
+			entries[i].ret = PTR_ERR(xfer_mem);
+			pr_err("%s: failed to process rmt memory alloc request %u: %d\n",
+			       __func__, i, entries[i].ret);
+			continue;
+		}
+
+		xfer_mems[i] = xfer_mem;
+		entries[i].hdl = xfer_mem->hdl;
+		entries[i].obj_id = xfer_mem->obj_id;
 	}
+
+	resp_msg = mem_buf_construct_alloc_batch_resp(req_msg, entries);
+	if (IS_ERR(resp_msg))
+		goto out_err;
+
+	trace_send_alloc_batch_resp_msg(resp_msg);
+	ret = mem_buf_msgq_send(mem_buf_msgq_hdl, resp_msg);
+	kfree(resp_msg);
+	if (ret < 0) {
+		pr_err("%s: failed to send batch allocation response rc: %d\n",
+		       __func__, ret);
+		goto out_err;
+	}
+	pr_debug("%s: Batch allocation response sent\n", __func__);
+	goto out_free_msg;
+
+out_err:
+	for (i = 0; i < req_msg->nr_entries; i++) {
+		xfer_mem = xfer_mems[i];
+		if (xfer_mem && mem_buf_xfer_mem_unpublish(entries[i].obj_id))
+			mem_buf_cleanup_alloc_req(xfer_mem, xfer_mem->hdl);
+	}
+out_free_msg:
+	kfree(rmt_msg->msg);
+	kfree(rmt_msg);
 }
 
 static void mem_buf_relinquish_work(struct work_struct *work)
 {
-	struct mem_buf_xfer_mem *xfer_mem_iter, *tmp, *xfer_mem = NULL;
+	struct mem_buf_xfer_mem *xfer_mem;
 	struct mem_buf_rmt_msg *rmt_msg = to_rmt_msg(work);
 	struct mem_buf_alloc_relinquish *relinquish_msg = rmt_msg->msg;
 	u32 obj_id = get_relinquish_req_obj_id(relinquish_msg);
 	void *resp_msg;
 
 	trace_receive_relinquish_msg(relinquish_msg);
-	mutex_lock(&mem_buf_xfer_mem_list_lock);
-	list_for_each_entry_safe(xfer_mem_iter, tmp, &mem_buf_xfer_mem_list,
-				 entry)
-		if (xfer_mem_iter->obj_id == obj_id) {
-			xfer_mem = xfer_mem_iter;
-			list_del(&xfer_mem->entry);
-			break;
-		}
-	mutex_unlock(&mem_buf_xfer_mem_list_lock);
+	xfer_mem = mem_buf_xfer_mem_unpublish(obj_id);
 
 	if (xfer_mem)
 		mem_buf_cleanup_alloc_req(xfer_mem, relinquish_msg->hdl);
@@ -803,6 +1076,30 @@ static void mem_buf_relinquish_hdlr(void *hdlr_data, void *_buf, size_t size)
 	queue_work(mem_buf_wq, &rmt_msg->work);
 }
 
+static void mem_buf_alloc_batch_req_hdlr(void *hdlr_data, void *_buf, size_t size)
+{
+	struct mem_buf_rmt_msg *rmt_msg;
+	void *buf;
+
+	if (!(mem_buf_capability & MEM_BUF_CAP_SUPPLIER))
+		return;
+
+	rmt_msg = kmalloc(sizeof(*rmt_msg), GFP_KERNEL);
+	if (!rmt_msg)
+		return;
+
+	buf = kmemdup(_buf, size, GFP_KERNEL);
+	if (!buf) {
+		kfree(rmt_msg);
+		return;
+	}
+
+	rmt_msg->msg = buf;
+	rmt_msg->msg_size = size;
+	INIT_WORK(&rmt_msg->work, mem_buf_alloc_batch_req_work);
+	queue_work(mem_buf_wq, &rmt_msg->work);
+}
+
 static int mem_buf_request_mem(struct mem_buf_desc *membuf)
 {
 	struct mem_buf_txn *txn;
@@ -841,6 +1138,39 @@ static int mem_buf_request_mem(struct mem_buf_desc *membuf)
 	return ret;
 }
 
+static int mem_buf_request_mem_batch(struct mem_buf_batch_desc *batch, const size_t *sizes)
+{
+	struct mem_buf_desc *membuf = batch->membufs[0];
+	struct mem_buf_txn *txn;
+	void *alloc_req_msg;
+	int ret;
+
+	txn = mem_buf_init_txn(mem_buf_msgq_hdl, batch);
+	if (IS_ERR(txn))
+		return PTR_ERR(txn);
+
+	alloc_req_msg = mem_buf_construct_alloc_batch_req(txn, batch->nr_entries, sizes,
+							  membuf->acl_desc,
+							  membuf->src_mem_type,
+							  membuf->src_data,
+							  membuf->trans_type);
+	if (IS_ERR(alloc_req_msg)) {
+		ret = PTR_ERR(alloc_req_msg);
+		goto out;
+	}
+
+	ret = mem_buf_msgq_send(mem_buf_msgq_hdl, alloc_req_msg);
+	kfree(alloc_req_msg);
+	if (ret < 0)
+		goto out;
+
+	ret = mem_buf_txn_wait(mem_buf_msgq_hdl, txn);
+
+out:
+	mem_buf_destroy_txn(mem_buf_msgq_hdl, txn);
+	return ret;
+}
+
 static void __mem_buf_relinquish_mem(u32 obj_id, u32 memparcel_hdl)
 {
 	void *relinquish_msg, *txn;
@@ -918,11 +1248,87 @@ static void mem_buf_relinquish_mem(struct mem_buf_desc *membuf)
 	kfree(sgt);
 }
 
+/**
+ * struct mem_buf_relinquish_hdl_work: A deferred relinquish of a memparcel
+ * @obj_id: Unique identifier for the memory object associated with @hdl
+ * @hdl: The memparcel handle to relinquish
+ * @work: work structure for running the relinquish on mem_buf_wq
+ */
+struct mem_buf_relinquish_hdl_work {
+	u32 obj_id;
+	gh_memparcel_handle_t hdl;
+	struct work_struct work;
+};
+
+static void mem_buf_relinquish_hdl_work_fn(struct work_struct *work)
+{
+	struct mem_buf_relinquish_hdl_work *rel_work =
+		container_of(work, struct mem_buf_relinquish_hdl_work, work);
+
+	__mem_buf_relinquish_mem(rel_work->obj_id, rel_work->hdl);
+	kfree(rel_work);
+}
+
+/*
+ * Invoked by the message queue receiver thread with the transaction lock held,
+ * so the relinquish transaction, which needs both, is handed to mem_buf_wq.
+ */
 static void mem_buf_relinquish_memparcel_hdl(void *hdlr_data, u32 obj_id, gh_memparcel_handle_t hdl)
 {
-	__mem_buf_relinquish_mem(obj_id, hdl);
+	struct mem_buf_relinquish_hdl_work *rel_work;
+
+	rel_work = kmalloc(sizeof(*rel_work), GFP_KERNEL);
+	if (!rel_work) {
+		pr_err("%s: unable to relinquish memparcel 0x%x\n", __func__, hdl);
+		return;
+	}
+
+	rel_work->obj_id = obj_id;
+	rel_work->hdl = hdl;
+	INIT_WORK(&rel_work->work, mem_buf_relinquish_hdl_work_fn);
+	queue_work(mem_buf_wq, &rel_work->work);
+}
+
+static int mem_buf_alloc_batch_resp_hdlr(void *hdlr_data, void *msg_buf, size_t size,
+					 void *out_buf)
+{
+	struct mem_buf_alloc_batch_resp *alloc_resp = msg_buf;
+	struct mem_buf_batch_desc *batch = out_buf;
+	unsigned int i;
+	int ret = 0;
+
+	if (!(mem_buf_capability & MEM_BUF_CAP_CONSUMER))
+		return -EPERM;
+
+	if (alloc_resp->nr_entries != batch->nr_entries) {
+		pr_err("%s: response has %u entries, expected %u\n", __func__,
+		       alloc_resp->nr_entries, batch->nr_entries);
+		for (i = 0; i < alloc_resp->nr_entries; i++)
+			if (!alloc_resp->entries[i].ret)
+				mem_buf_relinquish_memparcel_hdl(hdlr_data,
+								 alloc_resp->entries[i].obj_id,
+								 alloc_resp->entries[i].hdl);
+		return -EPROTO;
+	}
+
+	for (i = 0; i < alloc_resp->nr_entries; i++) {
+		batch->rets[i] = alloc_resp->entries[i].ret;
+		if (batch->rets[i] < 0) {
+			pr_err("%s remote allocation %u failed rc: %d\n", __func__, i,
+			       batch->rets[i]);
+			if (!ret)
+				ret = batch->rets[i];
+			continue;
+		}
+
+		batch->membufs[i]->memparcel_hdl = alloc_resp->entries[i].hdl;
+		batch->membufs[i]->obj_id = alloc_resp->entries[i].obj_id;
+	}
+
+	return ret;
 }
 
+
 static void *mem_buf_retrieve_dmaheap_mem_type_data_user(
 				struct mem_buf_dmaheap_data __user *udata)
 {
@@ -1004,15 +1410,12 @@ static bool is_valid_ioctl_mem_type(enum mem_buf_mem_type mem_type)
 	return (mem_type == MEM_BUF_DMAHEAP_MEM_TYPE);
 }
 
-void *mem_buf_alloc(struct mem_buf_allocation_data *alloc_data)
+static struct mem_buf_desc *mem_buf_desc_create(struct mem_buf_allocation_data *alloc_data)
 {
 	int ret;
 	struct mem_buf_desc *membuf;
 	int perms = PERM_READ | PERM_WRITE | PERM_EXEC;
 
-	if (!(mem_buf_capability & MEM_BUF_CAP_CONSUMER))
-		return ERR_PTR(-EOPNOTSUPP);
-
 	if (!alloc_data || !alloc_data->size || alloc_data->nr_acl_entries != 1 ||
 	    !alloc_data->vmids || !alloc_data->perms ||
 	    !is_valid_mem_type(alloc_data->src_mem_type) ||
@@ -1023,7 +1426,6 @@ void *mem_buf_alloc(struct mem_buf_allocation_data *alloc_data)
 	if (!membuf)
 		return ERR_PTR(-ENOMEM);
 
-	pr_debug("%s: mem buf alloc begin\n", __func__);
 	membuf->size = alloc_data->size;
 
 	/* Create copies of data structures from alloc_data as they may be on-stack */
@@ -1065,6 +1467,42 @@ void *mem_buf_alloc(struct mem_buf_allocation_data *alloc_data)
 
 	trace_mem_buf_alloc_info(membuf->size, membuf->src_mem_type,
 				 membuf->dst_mem_type, membuf->acl_desc);
+	return membuf;
+
+err_alloc_dst_data:
+	mem_buf_free_mem_type_data(membuf->src_mem_type, membuf->src_data);
+err_alloc_src_data:
+	if (membuf->sgl_desc)
+		kvfree(membuf->sgl_desc);
+err_alloc_sgl_desc:
+	kfree(membuf->acl_desc);
+err_alloc_acl_list:
+	kfree(membuf);
+	return ERR_PTR(ret);
+}
+
+static void mem_buf_desc_destroy(struct mem_buf_desc *membuf)
+{
+	kvfree(membuf->sgl_desc);
+	mem_buf_free_mem_type_data(membuf->dst_mem_type, membuf->dst_data);
+	mem_buf_free_mem_type_data(membuf->src_mem_type, membuf->src_data);
+	kfree(membuf->acl_desc);
+	kfree(membuf);
+}
+
+void *mem_buf_alloc(struct mem_buf_allocation_data *alloc_data)
+{
+	int ret;
+	struct mem_buf_desc *membuf;
+
+	if (!(mem_buf_capability & MEM_BUF_CAP_CONSUMER))
+		return ERR_PTR(-EOPNOTSUPP);
+
+	pr_debug("%s: mem buf alloc begin\n", __func__);
+	membuf = mem_buf_desc_create(alloc_data);
+	if (IS_ERR(membuf))
+		return membuf;
+
 	ret = mem_buf_request_mem(membuf);
 	if (ret)
 		goto err_mem_req;
@@ -1074,9 +1512,7 @@ void *mem_buf_alloc(struct mem_buf_allocation_data *alloc_data)
 	if (ret)
 		goto err_map_mem_s2;
 
-	mutex_lock(&mem_buf_list_lock);
-	list_add_tail(&membuf->entry, &mem_buf_list);
-	mutex_unlock(&mem_buf_list_lock);
+	atomic_inc(&mem_buf_nr_membufs);
 
 	pr_debug("%s: mem buf alloc success\n", __func__);
 	return membuf;
@@ -1084,33 +1520,115 @@ void *mem_buf_alloc(struct mem_buf_allocation_data *alloc_data)
 err_map_mem_s2:
 	mem_buf_relinquish_mem(membuf);
 err_mem_req:
-	mem_buf_free_mem_type_data(membuf->dst_mem_type, membuf->dst_data);
-err_alloc_dst_data:
-	mem_buf_free_mem_type_data(membuf->src_mem_type, membuf->src_data);
-err_alloc_src_data:
-	if (membuf->sgl_desc)
-		kvfree(membuf->sgl_desc);
-err_alloc_sgl_desc:
-	kfree(membuf->acl_desc);
-err_alloc_acl_list:
-	kfree(membuf);
+	mem_buf_desc_destroy(membuf);
 	return ERR_PTR(ret);
 }
 
+/**
+ * mem_buf_alloc_batch() - Request several buffers from a remote VM at once
+ * @alloc_data: Describes every buffer in the batch. @alloc_data->size and
+ * @alloc_data->sgl_desc are ignored.
+ * @sizes: The size of each buffer.
+ * @nr_entries: The number of buffers, at most MEM_BUF_MAX_BATCH_ENTRIES.
+ * @membufs: Filled with one membuf per entry of @sizes on success. Each one is
+ * released independently with mem_buf_free().
+ *
+ * All of the buffers are requested with a single message queue transaction,
+ * instead of one per buffer as with mem_buf_alloc(). The request succeeds only
+ * if every buffer could be allocated, lent and mapped.
+ *
+ * Return: 0 on success, or a negative error code.
+ */
+int mem_buf_alloc_batch(struct mem_buf_allocation_data *alloc_data,
+			const size_t *sizes, unsigned int nr_entries, void **membufs)
+{
+	struct mem_buf_allocation_data entry_data;
+	struct mem_buf_batch_desc batch;
+	struct mem_buf_desc **descs;
+	unsigned int i, j;
+	int *rets;
+	int ret;
+
+	if (!(mem_buf_capability & MEM_BUF_CAP_CONSUMER))
+		return -EOPNOTSUPP;
+
+	if (!alloc_data || !sizes || !membufs || !nr_entries ||
+	    nr_entries > MEM_BUF_MAX_BATCH_ENTRIES)
+		return -EINVAL;
+
+	descs = kcalloc(nr_entries, sizeof(*descs), GFP_KERNEL);
+	rets = kcalloc(nr_entries, sizeof(*rets), GFP_KERNEL);
+	if (!descs || !rets) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	entry_data = *alloc_data;
+	entry_data.sgl_desc = NULL;
+	for (i = 0; i < nr_entries; i++) {
+		entry_data.size = sizes[i];
+		descs[i] = mem_buf_desc_create(&entry_data);
+		if (IS_ERR(descs[i])) {
+			ret = PTR_ERR(descs[i]);
+			descs[i] = NULL;
+			goto err_destroy_descs;
+		}
+		rets[i] = -ETIMEDOUT;
+	}
+
+	batch.nr_entries = nr_entries;
+	batch.membufs = descs;
+	batch.rets = rets;
+	ret = mem_buf_request_mem_batch(&batch, sizes);
+	if (ret) {
+		/* Hand back the buffers that the remote VM did lend */
+		for (i = 0; i < nr_entries; i++)
+			if (!rets[i])
+				__mem_buf_relinquish_mem(descs[i]->obj_id,
+							 descs[i]->memparcel_hdl);
+		goto err_destroy_descs;
+	}
+
+	for (i = 0; i < nr_entries; i++) {
+		ret = mem_buf_map_mem_s2(descs[i]->trans_type, &descs[i]->memparcel_hdl,
+					 descs[i]->acl_desc, &descs[i]->sgl_desc, VMID_HLOS);
+		if (ret)
+			goto err_map_mem_s2;
+	}
+
+	for (i = 0; i < nr_entries; i++)
+		membufs[i] = descs[i];
+	atomic_add(nr_entries, &mem_buf_nr_membufs);
+
+	ret = 0;
+	goto out_free;
+
+err_map_mem_s2:
+	for (j = 0; j < nr_entries; j++) {
+		if (j <= i)
+			mem_buf_relinquish_mem(descs[j]);
+		else
+			__mem_buf_relinquish_mem(descs[j]->obj_id,
+						 descs[j]->memparcel_hdl);
+	}
+	i = nr_entries;
+err_destroy_descs:
+	while (i--)
+		mem_buf_desc_destroy(descs[i]);
+out_free:
+	kfree(rets);
+	kfree(descs);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(mem_buf_alloc_batch);
+
 void mem_buf_free(void *__membuf)
 {
 	struct mem_buf_desc *membuf = __membuf;
 
-	mutex_lock(&mem_buf_list_lock);
-	list_del(&membuf->entry);
-	mutex_unlock(&mem_buf_list_lock);
-
+	atomic_dec(&mem_buf_nr_membufs);
 	mem_buf_relinquish_mem(membuf);
-	kvfree(membuf->sgl_desc);
-	mem_buf_free_mem_type_data(membuf->dst_mem_type, membuf->dst_data);
-	mem_buf_free_mem_type_data(membuf->src_mem_type, membuf->src_data);
-	kfree(membuf->acl_desc);
-	kfree(membuf);
+	mem_buf_desc_destroy(membuf);
 }
 EXPORT_SYMBOL_GPL(mem_buf_free);
 
@@ -1196,6 +1714,7 @@ struct dma_buf *mem_buf_retrieve(struct mem_buf_retrieve_kernel_arg *arg)
 	kfree(sgt);
 
 	INIT_LIST_HEAD(&buffer->attachments);
+	INIT_LIST_HEAD(&buffer->map_cache);
 	mutex_init(&buffer->lock);
 	buffer->heap = NULL;
 	buffer->len = mem_buf_get_sgl_buf_size(sgl_desc);
@@ -1383,6 +1902,8 @@ static const struct mem_buf_msgq_ops msgq_ops = {
 	.alloc_req_hdlr = mem_buf_alloc_req_hdlr,
 	.alloc_resp_hdlr = mem_buf_alloc_resp_hdlr,
 	.relinquish_hdlr = mem_buf_relinquish_hdlr,
+	.alloc_batch_req_hdlr = mem_buf_alloc_batch_req_hdlr,
+	.alloc_batch_resp_hdlr = mem_buf_alloc_batch_resp_hdlr,
 	.relinquish_memparcel_hdl = mem_buf_relinquish_memparcel_hdl,
 };
 
@@ -1410,6 +1931,9 @@ int mem_buf_msgq_alloc(struct device *dev)
 		goto err_msgq_register;
 	}
 
+	if (mem_buf_capability & MEM_BUF_CAP_SUPPLIER)
+		mem_buf_reservoir_start();
+
 	return 0;
 
 err_msgq_register:
@@ -1423,17 +1947,15 @@ void mem_buf_msgq_free(struct device *dev)
 	if (!(mem_buf_capability & MEM_BUF_CAP_DUAL))
 		return;
 
-	mutex_lock(&mem_buf_list_lock);
-	if (!list_empty(&mem_buf_list))
+	mem_buf_reservoir_stop();
+
+	if (atomic_read(&mem_buf_nr_membufs))
 		dev_err(mem_buf_dev,
 			"Removing mem-buf driver while there are membufs\n");
-	mutex_unlock(&mem_buf_list_lock);
 
-	mutex_lock(&mem_buf_xfer_mem_list_lock);
-	if (!list_empty(&mem_buf_xfer_mem_list))
+	if (!xa_empty(&mem_buf_xfer_mems))
 		dev_err(mem_buf_dev,
 			"Removing mem-buf driver while memory is still lent\n");
-	mutex_unlock(&mem_buf_xfer_mem_list_lock);
 	mem_buf_msgq_unregister(mem_buf_msgq_hdl);
 	mem_buf_msgq_hdl = NULL;
 	destroy_workqueue(mem_buf_wq);
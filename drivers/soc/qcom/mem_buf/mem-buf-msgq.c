@@ -210,6 +210,101 @@ void *mem_buf_construct_relinquish_resp(void *_msg)
 }
 EXPORT_SYMBOL_GPL(mem_buf_construct_relinquish_resp);
 
+/*
+ * mem_buf_construct_alloc_batch_req: Constructs a batch allocation request message.
+ * @mem_buf_txn: A valid transaction structure allocated by a call to mem_buf_init_txn().
+ * @nr_entries: The number of allocations to be requested, at most MEM_BUF_MAX_BATCH_ENTRIES.
+ * @sizes: The size of each allocation to be requested.
+ * @acl_desc: A GH ACL descriptor that describes who will have access to each allocation and
+ *            with what permissions.
+ * @src_mem_type: The type of memory that will be used to satisfy the allocations.
+ * @src_data: A pointer to auxiliary data required to satisfy the allocations.
+ * @trans_type: One of GH_RM_TRANS_TYPE_DONATE/LEND/SHARE
+ */
+void *mem_buf_construct_alloc_batch_req(void *mem_buf_txn, unsigned int nr_entries,
+					const size_t *sizes, struct gh_acl_desc *acl_desc,
+					enum mem_buf_mem_type src_mem_type, void *src_data,
+					u32 trans_type)
+{
+	size_t tot_size, alloc_req_size, acl_desc_size;
+	void *req_buf, *arb_payload;
+	unsigned int nr_acl_entries = acl_desc->n_acl_entries;
+	struct mem_buf_alloc_batch_req *req;
+	struct mem_buf_txn *txn = mem_buf_txn;
+	unsigned int i;
+
+	BUILD_BUG_ON(offsetof(struct mem_buf_alloc_batch_req, acl_desc.acl_entries[1]) +
+		     MEM_BUF_MAX_DMAHEAP_NAME_LEN > GH_MSGQ_MAX_MSG_SIZE_BYTES);
+
+	if (!nr_entries || nr_entries > MEM_BUF_MAX_BATCH_ENTRIES)
+		return ERR_PTR(-EINVAL);
+
+	for (i = 0; i < nr_entries; i++)
+		if (!sizes[i] || sizes[i] > U32_MAX)
+			return ERR_PTR(-EINVAL);
+
+	alloc_req_size = offsetof(struct mem_buf_alloc_batch_req,
+				  acl_desc.acl_entries[nr_acl_entries]);
+	tot_size = alloc_req_size +
+		   mem_buf_get_mem_type_alloc_req_size(src_mem_type);
+
+	req_buf = kzalloc(tot_size, GFP_KERNEL);
+	if (!req_buf)
+		return ERR_PTR(-ENOMEM);
+
+	req = req_buf;
+	req->hdr.txn_id = txn->txn_id;
+	req->hdr.msg_type = MEM_BUF_ALLOC_BATCH_REQ;
+	req->hdr.msg_size = tot_size;
+	req->nr_entries = nr_entries;
+	req->src_mem_type = src_mem_type;
+	req->trans_type = trans_type;
+	for (i = 0; i < nr_entries; i++)
+		req->sizes[i] = sizes[i];
+	acl_desc_size = offsetof(struct gh_acl_desc,
+				 acl_entries[nr_acl_entries]);
+	memcpy(&req->acl_desc, acl_desc, acl_desc_size);
+
+	arb_payload = req_buf + alloc_req_size;
+	mem_buf_populate_alloc_req_arb_payload(arb_payload, src_data,
+					       src_mem_type);
+
+	trace_send_alloc_batch_req(req);
+	return req_buf;
+}
+EXPORT_SYMBOL_GPL(mem_buf_construct_alloc_batch_req);
+
+/*
+ * mem_buf_construct_alloc_batch_resp: Construct a response message to a batch allocation request.
+ * @req_msg: The batch request message that is being replied to.
+ * @entries: The outcome of each allocation, one per entry in the request, in request order.
+ */
+void *mem_buf_construct_alloc_batch_resp(void *req_msg,
+					 const struct mem_buf_alloc_batch_resp_entry *entries)
+{
+	struct mem_buf_alloc_batch_req *req = req_msg;
+	struct mem_buf_alloc_batch_resp *resp_msg;
+	size_t tot_size;
+
+	BUILD_BUG_ON(struct_size(resp_msg, entries, MEM_BUF_MAX_BATCH_ENTRIES) >
+		     GH_MSGQ_MAX_MSG_SIZE_BYTES);
+
+	tot_size = struct_size(resp_msg, entries, req->nr_entries);
+	resp_msg = kzalloc(tot_size, GFP_KERNEL);
+	if (!resp_msg)
+		return ERR_PTR(-ENOMEM);
+
+	resp_msg->hdr.txn_id = req->hdr.txn_id;
+	resp_msg->hdr.msg_type = MEM_BUF_ALLOC_BATCH_RESP;
+	resp_msg->hdr.msg_size = tot_size;
+	resp_msg->nr_entries = req->nr_entries;
+	memcpy(resp_msg->entries, entries,
+	       req->nr_entries * sizeof(*entries));
+
+	return resp_msg;
+}
+EXPORT_SYMBOL_GPL(mem_buf_construct_alloc_batch_resp);
+
 int mem_buf_retrieve_txn_id(void *mem_buf_txn)
 {
 	struct mem_buf_txn *txn = mem_buf_txn;
@@ -364,6 +459,42 @@ static void mem_buf_process_alloc_resp(struct mem_buf_msgq_desc *desc, void *buf
 	mutex_unlock(&desc->idr_mutex);
 }
 
+static void mem_buf_process_alloc_batch_resp(struct mem_buf_msgq_desc *desc, void *buf,
+					     size_t size)
+{
+	struct mem_buf_alloc_batch_resp *resp = buf;
+	struct mem_buf_txn *txn;
+	unsigned int noreclaim_flag;
+	unsigned int i;
+
+	if (size < sizeof(*resp) || resp->nr_entries > MEM_BUF_MAX_BATCH_ENTRIES ||
+	    size != struct_size(resp, entries, resp->nr_entries)) {
+		pr_err("%s response received is not of correct size\n",
+		       __func__);
+		return;
+	}
+	trace_receive_alloc_batch_resp_msg(resp);
+
+	mutex_lock(&desc->idr_mutex);
+	noreclaim_flag = memalloc_noreclaim_save();
+	txn = idr_find(&desc->txn_idr, resp->hdr.txn_id);
+	if (!txn || !desc->msgq_ops->alloc_batch_resp_hdlr) {
+		pr_err("%s no txn associated with id: %d\n", __func__, resp->hdr.txn_id);
+		/* Hand back every allocation that succeeded, as for a single response */
+		for (i = 0; i < resp->nr_entries; i++)
+			if (!resp->entries[i].ret)
+				desc->msgq_ops->relinquish_memparcel_hdl(desc->hdlr_data,
+									 resp->entries[i].obj_id,
+									 resp->entries[i].hdl);
+	} else {
+		txn->txn_ret = desc->msgq_ops->alloc_batch_resp_hdlr(desc->hdlr_data, buf, size,
+								     txn->resp_buf);
+		complete(&txn->txn_done);
+	}
+	memalloc_noreclaim_restore(noreclaim_flag);
+	mutex_unlock(&desc->idr_mutex);
+}
+
 static void mem_buf_process_relinquish_resp(struct mem_buf_msgq_desc *desc,
 					    void *buf, size_t size)
 {
@@ -411,6 +542,13 @@ static void mem_buf_process_msg(struct mem_buf_msgq_desc *desc, void *buf, size_
 	case MEM_BUF_ALLOC_RELINQUISH_RESP:
 		mem_buf_process_relinquish_resp(desc, buf, size);
 		break;
+	case MEM_BUF_ALLOC_BATCH_REQ:
+		if (desc->msgq_ops->alloc_batch_req_hdlr)
+			desc->msgq_ops->alloc_batch_req_hdlr(desc->hdlr_data, buf, size);
+		break;
+	case MEM_BUF_ALLOC_BATCH_RESP:
+		mem_buf_process_alloc_batch_resp(desc, buf, size);
+		break;
 	default:
 		pr_err("%s: received message of unknown type: %d\n", __func__,
 		       hdr->msg_type);
@@ -20,15 +20,29 @@
  * @MEM_BUF_ALLOC_RELINQUISH: The message is a notification from another VM
  * that the receiving VM can reclaim the memory.
  * @MEM_BUF_ALLOC_RELINQUISH_RESP: Indicates completion of MEM_BUF_ALLOC_RELINQUISH.
+ * @MEM_BUF_ALLOC_BATCH_REQ: The message is a request from another VM to the
+ * receiving VM to allocate several buffers that share the same ACL, memory type
+ * and transfer type.
+ * @MEM_BUF_ALLOC_BATCH_RESP: The message is a response from a remote VM to a
+ * batch allocation request issued by the receiving VM.
  */
 enum mem_buf_msg_type {
 	MEM_BUF_ALLOC_REQ,
 	MEM_BUF_ALLOC_RESP,
 	MEM_BUF_ALLOC_RELINQUISH,
 	MEM_BUF_ALLOC_RELINQUISH_RESP,
+	MEM_BUF_ALLOC_BATCH_REQ,
+	MEM_BUF_ALLOC_BATCH_RESP,
 	MEM_BUF_ALLOC_REQ_MAX,
 };
 
+/*
+ * The largest number of buffers that can be requested with a single
+ * MEM_BUF_ALLOC_BATCH_REQ. Both the request, with a DMAHEAP name appended, and
+ * the response must fit in one message queue message.
+ */
+#define MEM_BUF_MAX_BATCH_ENTRIES 16
+
 /**
  * struct mem_buf_msg_hdr: The header for all membuf messages
  * @txn_id: The transaction ID for the message. This field is only meaningful
@@ -98,6 +112,55 @@ struct mem_buf_alloc_relinquish {
 	u32 obj_id;
 } __packed;
 
+/**
+ * struct mem_buf_alloc_batch_req: The message format for a request to allocate
+ * several buffers from another VM.
+ * @hdr: Message header
+ * @nr_entries: The number of valid entries in @sizes.
+ * @src_mem_type: The type of memory that the remote VM should allocate.
+ * @trans_type: One of GH_RM_TRANS_TYPE_DONATE/SHARE/LEND
+ * @sizes: The size of each memory allocation to be performed on the remote VM.
+ * @acl_desc: A GH ACL descriptor that applies to every buffer in the batch.
+ *
+ * As with struct mem_buf_alloc_req, memory type specific data follows the ACL
+ * entries.
+ */
+struct mem_buf_alloc_batch_req {
+	struct mem_buf_msg_hdr hdr;
+	u32 nr_entries;
+	u32 src_mem_type;
+	u32 trans_type;
+	u32 sizes[MEM_BUF_MAX_BATCH_ENTRIES];
+	struct gh_acl_desc acl_desc;
+} __packed;
+
+/**
+ * struct mem_buf_alloc_batch_resp_entry: The outcome of one allocation in a
+ * batch.
+ * @ret: Return code from remote VM for this allocation
+ * @hdl: The memparcel handle associated with the memory. Only meaningful if
+ * @ret is 0.
+ * @obj_id: Unique identifier for the memory object associated with handle.
+ */
+struct mem_buf_alloc_batch_resp_entry {
+	s32 ret;
+	u32 hdl;
+	u32 obj_id;
+} __packed;
+
+/**
+ * struct mem_buf_alloc_batch_resp: The message format for a batch allocation
+ * request response.
+ * @hdr: Message header
+ * @nr_entries: The number of entries in @entries, which matches the request.
+ * @entries: One entry per requested allocation, in request order.
+ */
+struct mem_buf_alloc_batch_resp {
+	struct mem_buf_msg_hdr hdr;
+	u32 nr_entries;
+	struct mem_buf_alloc_batch_resp_entry entries[];
+} __packed;
+
 /*
  * mem_buf_msgq_ops: A set of ops that are invoked when a message of particular
  * types are received by a mem-buf message queue.
@@ -108,6 +171,10 @@ struct mem_buf_alloc_relinquish {
  * @alloc_req_hdlr: The handler for messages of type MEM_BUF_ALLOC_REQ.
  * @alloc_resp_hdlr: The handler for messages of type MEM_BUF_ALLOC_RESP.
  * @relinquish_hdlr: The handler for messages of type MEM_BUF_ALLOC_RELINQUISH.
+ * @alloc_batch_req_hdlr: Optional. The handler for messages of type
+ *                        MEM_BUF_ALLOC_BATCH_REQ.
+ * @alloc_batch_resp_hdlr: Optional. The handler for messages of type
+ *                         MEM_BUF_ALLOC_BATCH_RESP.
  * @relinquish_memparcel_hdl: Callback for relinquishing a memparcel. This is typically used in
  *                            case an allocation request times out, and the response arrives late.
  *                            In this case, the transaction will have been aborted, but the memory
@@ -117,6 +184,8 @@ struct mem_buf_msgq_ops {
 	void (*alloc_req_hdlr)(void *hdlr_data, void *msg, size_t size);
 	int (*alloc_resp_hdlr)(void *hdlr_data, void *msg, size_t size, void *resp_buf);
 	void (*relinquish_hdlr)(void *hdlr_data, void *msg, size_t size);
+	void (*alloc_batch_req_hdlr)(void *hdlr_data, void *msg, size_t size);
+	int (*alloc_batch_resp_hdlr)(void *hdlr_data, void *msg, size_t size, void *resp_buf);
 	void (*relinquish_memparcel_hdl)(void *hdlr_data, u32 obj_id,
 					 gh_memparcel_handle_t memparcel_hdl);
 };
@@ -192,6 +261,22 @@ static inline u32 get_relinquish_req_obj_id(struct mem_buf_alloc_relinquish *rel
 	return relinquish_msg->obj_id;
 }
 
+static inline void *get_alloc_batch_req_arb_payload(struct mem_buf_alloc_batch_req *req)
+{
+	void *buf = req;
+	size_t nr_acl_entries;
+	size_t payload_offset;
+
+	nr_acl_entries = req->acl_desc.n_acl_entries;
+	if (nr_acl_entries != 1)
+		return NULL;
+
+	payload_offset = offsetof(struct mem_buf_alloc_batch_req,
+				  acl_desc.acl_entries[nr_acl_entries]);
+
+	return buf + payload_offset;
+}
+
 #if IS_ENABLED(CONFIG_QCOM_MEM_BUF_MSGQ)
 void *mem_buf_msgq_register(const char *msgq_name, struct mem_buf_msgq_hdlr_info *info);
 void mem_buf_msgq_unregister(void *mem_buf_msgq_hdl);
@@ -214,6 +299,12 @@ void *mem_buf_construct_alloc_resp(void *req_msg, s32 alloc_ret,
 void *mem_buf_construct_relinquish_msg(void *mem_buf_txn, u32 obj_id,
 				       gh_memparcel_handle_t memparcel_hdl);
 void *mem_buf_construct_relinquish_resp(void *_msg);
+void *mem_buf_construct_alloc_batch_req(void *mem_buf_txn, unsigned int nr_entries,
+					const size_t *sizes, struct gh_acl_desc *acl_desc,
+					enum mem_buf_mem_type src_mem_type, void *src_data,
+					u32 trans_type);
+void *mem_buf_construct_alloc_batch_resp(void *req_msg,
+					 const struct mem_buf_alloc_batch_resp_entry *entries);
 #else
 static inline void *mem_buf_msgq_register(const char *msgq_name,
 					  struct mem_buf_msgq_hdlr_info *info)
@@ -275,5 +366,21 @@ static inline int mem_buf_retrieve_txn_id(void *mem_buf_txn)
 {
 	return -ENODEV;
 }
+
+static inline void *mem_buf_construct_alloc_batch_req(void *mem_buf_txn,
+						      unsigned int nr_entries,
+						      const size_t *sizes,
+						      struct gh_acl_desc *acl_desc,
+						      enum mem_buf_mem_type src_mem_type,
+						      void *src_data, u32 trans_type)
+{
+	return ERR_PTR(-ENODEV);
+}
+
+static inline void *mem_buf_construct_alloc_batch_resp(void *req_msg,
+				const struct mem_buf_alloc_batch_resp_entry *entries)
+{
+	return ERR_PTR(-ENODEV);
+}
 #endif
 #endif
@@ -7,10 +7,12 @@
 #define pr_fmt(fmt) "mem_buf_vmperm: " fmt
 
 #include <linux/highmem.h>
+#include <linux/ktime.h>
 #include <linux/mem-buf-exporter.h>
 #include "mem-buf-dev.h"
 #include "mem-buf-gh.h"
 #include "mem-buf-ids.h"
+#include "trace-mem-buf.h"
 
 struct mem_buf_vmperm {
 	u32 flags;
@@ -189,7 +191,7 @@ static int __mem_buf_vmperm_reclaim(struct mem_buf_vmperm *vmperm,
 				   vmperm->memparcel_hdl);
 	if (ret) {
 		pr_err_ratelimited("Reclaim failed\n");
-		if (leak_memory_on_reclaim_fail)
+		if (leak_memory_on_reclaim_fail || ret == -EADDRNOTAVAIL)
 			mem_buf_vmperm_set_err(vmperm);
 		return ret;
 	}
@@ -257,6 +259,19 @@ struct mem_buf_vmperm *to_mem_buf_vmperm(struct dma_buf *dmabuf)
 }
 EXPORT_SYMBOL_GPL(to_mem_buf_vmperm);
 
+/*
+ * Must be called without vmperm->lock held, as exporters take their own
+ * buffer lock before pinning.
+ */
+static void mem_buf_dma_buf_invalidate(struct dma_buf *dmabuf)
+{
+	struct mem_buf_dma_buf_ops *ops;
+
+	ops = container_of(dmabuf->ops, struct mem_buf_dma_buf_ops, dma_ops);
+	if (ops->invalidate)
+		ops->invalidate(dmabuf);
+}
+
 int mem_buf_dma_buf_set_destructor(struct dma_buf *buf,
 				   mem_buf_dma_buf_destructor dtor,
 				   void *dtor_data)
@@ -442,6 +457,7 @@ static int mem_buf_lend_internal(struct dma_buf *dmabuf,
 {
 	struct mem_buf_vmperm *vmperm;
 	struct sg_table *sgt;
+	u64 start, cmo_ns;
 	int ret;
 
 	if (!arg->nr_acl_entries || !arg->vmids || !arg->perms)
@@ -464,6 +480,8 @@ static int mem_buf_lend_internal(struct dma_buf *dmabuf,
 	if (ret)
 		return ret;
 
+	mem_buf_dma_buf_invalidate(dmabuf);
+
 	mutex_lock(&vmperm->lock);
 	if (vmperm->flags & MEM_BUF_WRAPPER_FLAG_ERR) {
 		pr_err_ratelimited("dma-buf is not in a usable state!\n");
@@ -499,8 +517,10 @@ static int mem_buf_lend_internal(struct dma_buf *dmabuf,
 	 * whether they require cache maintenance prior to caling this function
 	 * for backwards compatibility with ion we will always do CMO.
 	 */
+	start = ktime_get_ns();
 	dma_map_sgtable(mem_buf_dev, vmperm->sgt, DMA_TO_DEVICE, 0);
 	dma_unmap_sgtable(mem_buf_dev, vmperm->sgt, DMA_TO_DEVICE, 0);
+	cmo_ns = ktime_get_ns() - start;
 
 	ret = mem_buf_vmperm_resize(vmperm, arg->nr_acl_entries);
 	if (ret)
@@ -519,11 +539,15 @@ static int mem_buf_lend_internal(struct dma_buf *dmabuf,
 	vmperm->memparcel_hdl = arg->memparcel_hdl;
 
 	mutex_unlock(&vmperm->lock);
+	trace_mem_buf_lend(op, dmabuf->size, arg->nr_acl_entries, cmo_ns,
+			   ktime_get_ns() - start, 0);
 	return 0;
 
 err_assign:
 err_resize:
 	mutex_unlock(&vmperm->lock);
+	trace_mem_buf_lend(op, dmabuf->size, arg->nr_acl_entries, cmo_ns,
+			   ktime_get_ns() - start, ret);
 	return ret;
 }
 
@@ -603,6 +627,8 @@ int mem_buf_reclaim(struct dma_buf *dmabuf)
 		return -EINVAL;
 	}
 
+	mem_buf_dma_buf_invalidate(dmabuf);
+
 	mutex_lock(&vmperm->lock);
 	if (vmperm->flags & MEM_BUF_WRAPPER_FLAG_STATIC_VM) {
 		pr_err_ratelimited("dma-buf is staticvm type!\n");
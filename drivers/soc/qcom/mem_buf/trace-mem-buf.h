@@ -57,6 +57,10 @@ static char __maybe_unused *msg_type_to_str(enum mem_buf_msg_type type)
 		return "MEM_BUF_ALLOC_RELINQUISH";
 	else if (type == MEM_BUF_ALLOC_RELINQUISH_RESP)
 		return "MEM_BUF_ALLOC_RELINQUISH_RESP";
+	else if (type == MEM_BUF_ALLOC_BATCH_REQ)
+		return "MEM_BUF_ALLOC_BATCH_REQ";
+	else if (type == MEM_BUF_ALLOC_BATCH_RESP)
+		return "MEM_BUF_ALLOC_BATCH_RESP";
 
 	return NULL;
 }
@@ -225,6 +229,93 @@ DEFINE_EVENT(alloc_resp_class, receive_alloc_resp_msg,
 	TP_ARGS(resp)
 );
 
+DECLARE_EVENT_CLASS(alloc_batch_req_msg_class,
+
+	TP_PROTO(struct mem_buf_alloc_batch_req *req),
+
+	TP_ARGS(req),
+
+	TP_STRUCT__entry(
+		__field(u32, txn_id)
+		__string(msg_type, msg_type_to_str(req->hdr.msg_type))
+		__field(u32, nr_entries)
+		__dynamic_array(u32, sizes, req->nr_entries)
+	),
+
+	TP_fast_assign(
+		__entry->txn_id = req->hdr.txn_id;
+		__assign_str(msg_type, msg_type_to_str(req->hdr.msg_type));
+		__entry->nr_entries = req->nr_entries;
+		memcpy(__get_dynamic_array(sizes), req->sizes,
+		       req->nr_entries * sizeof(u32));
+	),
+
+	TP_printk("txn_id: %d msg_type: %s nr_entries: %u alloc_sz: %s",
+		  __entry->txn_id, __get_str(msg_type), __entry->nr_entries,
+		  __print_array(__get_dynamic_array(sizes),
+				__entry->nr_entries, sizeof(u32))
+	)
+);
+
+DEFINE_EVENT(alloc_batch_req_msg_class, send_alloc_batch_req,
+
+	TP_PROTO(struct mem_buf_alloc_batch_req *req),
+
+	TP_ARGS(req)
+);
+
+DEFINE_EVENT(alloc_batch_req_msg_class, receive_alloc_batch_req,
+
+	TP_PROTO(struct mem_buf_alloc_batch_req *req),
+
+	TP_ARGS(req)
+);
+
+DECLARE_EVENT_CLASS(alloc_batch_resp_class,
+
+	TP_PROTO(struct mem_buf_alloc_batch_resp *resp),
+
+	TP_ARGS(resp),
+
+	TP_STRUCT__entry(
+		__field(u32, txn_id)
+		__string(msg_type, msg_type_to_str(resp->hdr.msg_type))
+		__field(u32, nr_entries)
+		__field(u32, nr_failed)
+	),
+
+	TP_fast_assign(
+		unsigned int i;
+
+		__entry->txn_id = resp->hdr.txn_id;
+		__assign_str(msg_type, msg_type_to_str(resp->hdr.msg_type));
+		__entry->nr_entries = resp->nr_entries;
+		__entry->nr_failed = 0;
+		for (i = 0; i < resp->nr_entries; i++)
+			if (resp->entries[i].ret)
+				__entry->nr_failed++;
+	),
+
+	TP_printk("txn_id: %d msg_type: %s nr_entries: %u nr_failed: %u",
+		  __entry->txn_id, __get_str(msg_type), __entry->nr_entries,
+		  __entry->nr_failed
+	)
+);
+
+DEFINE_EVENT(alloc_batch_resp_class, send_alloc_batch_resp_msg,
+
+	TP_PROTO(struct mem_buf_alloc_batch_resp *resp),
+
+	TP_ARGS(resp)
+);
+
+DEFINE_EVENT(alloc_batch_resp_class, receive_alloc_batch_resp_msg,
+
+	TP_PROTO(struct mem_buf_alloc_batch_resp *resp),
+
+	TP_ARGS(resp)
+);
+
 DECLARE_EVENT_CLASS(relinquish_resp_class,
 
 	TP_PROTO(struct mem_buf_alloc_relinquish *resp),
@@ -324,6 +415,81 @@ TRACE_EVENT(map_mem_s2,
 	)
 );
 
+DECLARE_EVENT_CLASS(mem_buf_assign_class,
+
+	TP_PROTO(unsigned int nents, unsigned int assign_nents, u64 time_ns,
+		 int ret),
+
+	TP_ARGS(nents, assign_nents, time_ns, ret),
+
+	TP_STRUCT__entry(
+		__field(unsigned int, nents)
+		__field(unsigned int, assign_nents)
+		__field(u64, time_ns)
+		__field(int, ret)
+	),
+
+	TP_fast_assign(
+		__entry->nents = nents;
+		__entry->assign_nents = assign_nents;
+		__entry->time_ns = time_ns;
+		__entry->ret = ret;
+	),
+
+	TP_printk("SGL entries: %u assigned as: %u time: %llu ns ret: %d",
+		  __entry->nents, __entry->assign_nents, __entry->time_ns,
+		  __entry->ret
+	)
+);
+
+DEFINE_EVENT(mem_buf_assign_class, mem_buf_assign_mem,
+
+	TP_PROTO(unsigned int nents, unsigned int assign_nents, u64 time_ns,
+		 int ret),
+
+	TP_ARGS(nents, assign_nents, time_ns, ret)
+);
+
+DEFINE_EVENT(mem_buf_assign_class, mem_buf_unassign_mem,
+
+	TP_PROTO(unsigned int nents, unsigned int assign_nents, u64 time_ns,
+		 int ret),
+
+	TP_ARGS(nents, assign_nents, time_ns, ret)
+);
+
+TRACE_EVENT(mem_buf_lend,
+
+	TP_PROTO(u32 op, size_t size, unsigned int nr_acl_entries,
+		 u64 cmo_ns, u64 time_ns, int ret),
+
+	TP_ARGS(op, size, nr_acl_entries, cmo_ns, time_ns, ret),
+
+	TP_STRUCT__entry(
+		__field(u32, op)
+		__field(size_t, size)
+		__field(unsigned int, nr_acl_entries)
+		__field(u64, cmo_ns)
+		__field(u64, time_ns)
+		__field(int, ret)
+	),
+
+	TP_fast_assign(
+		__entry->op = op;
+		__entry->size = size;
+		__entry->nr_acl_entries = nr_acl_entries;
+		__entry->cmo_ns = cmo_ns;
+		__entry->time_ns = time_ns;
+		__entry->ret = ret;
+	),
+
+	TP_printk("%s size: 0x%zx ACL entries: %u cache maintenance: %llu ns total: %llu ns ret: %d",
+		  __entry->op == GH_RM_TRANS_TYPE_SHARE ? "share" : "lend",
+		  __entry->size, __entry->nr_acl_entries, __entry->cmo_ns,
+		  __entry->time_ns, __entry->ret
+	)
+);
+
 #endif /* _TRACE_MEM_BUF_H */
 
 #undef TRACE_INCLUDE_PATH
@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Transactions grouping the active-only votes of several RPMh clients
+ * (clocks, regulators, interconnects) into a single rpmh_write_batch().
+ */
+
+#include <linux/device.h>
+#include <linux/export.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+
+#include <soc/qcom/rpmh.h>
+
+#define RPMH_TXN_MAX_CMDS	(4 * MAX_RPMH_PAYLOAD)
+
+/**
+ * struct rpmh_txn: the open RPMh transaction
+ *
+ * @owner:    task that opened the transaction, NULL if there is none.
+ * @depth:    number of rpmh_txn_begin() not yet committed by @owner.
+ * @dev:      device of the first queued command, all others must be on
+ *            the same RSC.
+ * @cmds:     the queued commands, at most one per resource address.
+ * @num_cmds: number of commands in @cmds.
+ */
+struct rpmh_txn {
+	struct task_struct *owner;
+	unsigned int depth;
+	const struct device *dev;
+	struct tcs_cmd cmds[RPMH_TXN_MAX_CMDS];
+	u32 num_cmds;
+};
+
+static DEFINE_MUTEX(rpmh_txn_lock);
+static struct rpmh_txn rpmh_txn;
+
+/**
+ * rpmh_txn_begin: Open a transaction for the active votes of this task
+ *
+ * Until the matching rpmh_txn_commit(), active-only votes that RPMh clients
+ * of this task send through rpmh_txn_queue() are held back and then sent
+ * together. Transactions may nest, only the outermost commit sends the
+ * votes. Only one task can have a transaction open at a time, others wait.
+ */
+void rpmh_txn_begin(void)
+{
+	if (rpmh_txn.owner == current) {
+		rpmh_txn.depth++;
+		return;
+	}
+
+	mutex_lock(&rpmh_txn_lock);
+	rpmh_txn.depth = 1;
+	rpmh_txn.dev = NULL;
+	rpmh_txn.num_cmds = 0;
+	WRITE_ONCE(rpmh_txn.owner, current);
+}
+EXPORT_SYMBOL_GPL(rpmh_txn_begin);
+
+static struct tcs_cmd *rpmh_txn_find(u32 addr)
+{
+	u32 i;
+
+	for (i = 0; i < rpmh_txn.num_cmds; i++)
+		if (rpmh_txn.cmds[i].addr == addr)
+			return &rpmh_txn.cmds[i];
+
+	return NULL;
+}
+
+/**
+ * rpmh_txn_queue: Add votes to the transaction of the current task
+ *
+ * @dev: The RPMh client device
+ * @state: Active/sleep set
+ * @cmd: The payload data
+ * @n: The number of elements in @cmd
+ *
+ * Return: true if the votes were queued and will be sent by
+ * rpmh_txn_commit(), false if the caller has to send them itself because
+ * there is no open transaction, they are not active-only votes, @dev is on
+ * another RSC or the transaction is full.
+ */
+bool rpmh_txn_queue(const struct device *dev, enum rpmh_state state,
+		    const struct tcs_cmd *cmd, u32 n)
+{
+	struct tcs_cmd *tc;
+	u32 i, new = 0;
+
+	if (READ_ONCE(rpmh_txn.owner) != current ||
+	    state != RPMH_ACTIVE_ONLY_STATE)
+		return false;
+
+	if (rpmh_txn.dev && rpmh_txn.dev->parent != dev->parent)
+		return false;
+
+	for (i = 0; i < n; i++)
+		if (!rpmh_txn_find(cmd[i].addr))
+			new++;
+	if (rpmh_txn.num_cmds + new > RPMH_TXN_MAX_CMDS)
+		return false;
+
+	/* Only the last vote for a resource matters */
+	for (i = 0; i < n; i++) {
+		tc = rpmh_txn_find(cmd[i].addr);
+		if (!tc) {
+			tc = &rpmh_txn.cmds[rpmh_txn.num_cmds++];
+			tc->addr = cmd[i].addr;
+			tc->wait = 0;
+		}
+		tc->data = cmd[i].data;
+		tc->wait |= cmd[i].wait;
+	}
+
+	if (!rpmh_txn.dev)
+		rpmh_txn.dev = dev;
+
+	return true;
+}
+EXPORT_SYMBOL_GPL(rpmh_txn_queue);
+
+/**
+ * rpmh_txn_commit: Send the votes of the transaction of the current task
+ *
+ * Sends the queued votes with rpmh_write_batch() and waits for them to
+ * complete, when called for the outermost rpmh_txn_begin().
+ *
+ * Return: 0 on success, errno of rpmh_write_batch() otherwise, in which
+ * case the votes queued in the transaction have not all been applied.
+ */
+int rpmh_txn_commit(void)
+{
+	u32 n[RPMH_TXN_MAX_CMDS / MAX_RPMH_PAYLOAD + 1] = { 0 };
+	u32 left, i = 0;
+	int ret = 0;
+
+	if (WARN_ON(rpmh_txn.owner != current))
+		return -EINVAL;
+
+	if (--rpmh_txn.depth)
+		return 0;
+
+	for (left = rpmh_txn.num_cmds; left; left -= n[i++])
+		n[i] = min_t(u32, left, MAX_RPMH_PAYLOAD);
+
+	if (rpmh_txn.num_cmds)
+		ret = rpmh_write_batch(rpmh_txn.dev, RPMH_ACTIVE_ONLY_STATE,
+				       rpmh_txn.cmds, n);
+
+	WRITE_ONCE(rpmh_txn.owner, NULL);
+	mutex_unlock(&rpmh_txn_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(rpmh_txn_commit);
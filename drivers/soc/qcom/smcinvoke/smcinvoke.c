@@ -28,6 +28,10 @@
 #include <linux/ratelimit.h>
 #include <linux/qtee_shmbridge.h>
 #include <linux/kthread.h>
+#include <linux/log2.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
 
 #include "smci_internal.h"
 
@@ -169,12 +173,28 @@
 
 #define FILE_IS_REMOTE_OBJ(f) ((f)->f_op && (f)->f_op == &g_smcinvoke_fops)
 
+/*
+ * g_smcinvoke_lock protects the callback servers, their transaction tables
+ * and pending cbobjs. g_mem_obj_lock protects g_mem_objs and the ids and
+ * refcounts of memory objects, so that invokes passing dma-bufs do not
+ * serialize behind callback processing of unrelated clients. When both are
+ * needed, g_smcinvoke_lock is taken first.
+ */
 static DEFINE_MUTEX(g_smcinvoke_lock);
+static DEFINE_MUTEX(g_mem_obj_lock);
 #define NO_LOCK 0
 #define TAKE_LOCK 1
 #define MUTEX_LOCK(x) { if (x) mutex_lock(&g_smcinvoke_lock); }
 #define MUTEX_UNLOCK(x) { if (x) mutex_unlock(&g_smcinvoke_lock); }
 
+/*
+ * Message buffers sub-allocated from the default bridge are cached in
+ * power-of-two classes of PAGE_SIZE up to PAGE_SIZE << (SHM_POOL_CLASSES - 1),
+ * SHM_POOL_DEPTH deep each, so that back to back invokes reuse them.
+ */
+#define SHM_POOL_CLASSES        5
+#define SHM_POOL_DEPTH          8
+
 #define POST_KT_SLEEP           0
 #define POST_KT_WAKEUP          1
 #define MAX_CHAR_NAME           50
@@ -303,6 +323,7 @@ struct smcinvoke_cb_txn {
 	size_t cb_req_bytes;
 	struct file **filp_to_release;
 	struct hlist_node hash;
+	struct list_head list;
 	struct kref ref_cnt;
 };
 
@@ -314,7 +335,8 @@ struct smcinvoke_server_info {
 	wait_queue_head_t req_wait_q;
 	wait_queue_head_t rsp_wait_q;
 	size_t cb_buf_size;
-	DECLARE_HASHTABLE(reqs_table, 4);
+	/* placed requests in arrival order, handed out one per accept thread */
+	struct list_head reqs_list;
 	DECLARE_HASHTABLE(responses_table, 4);
 	struct hlist_node hash;
 	struct list_head pending_cbobjs;
@@ -375,6 +397,7 @@ struct smcinvoke_shmbridge_deregister_pending_list {
 struct smcinvoke_object_release_pending_list {
 	struct list_head list;
 	struct object_release data;
+	ktime_t queued;
 };
 
 struct smcinvoke_worker_thread {
@@ -464,6 +487,169 @@ static inline void release_filp(struct file **filp_to_release, size_t arr_len)
 	}
 }
 
+static struct {
+	struct mutex lock;
+	struct qtee_shm shm[SHM_POOL_CLASSES][SHM_POOL_DEPTH];
+	unsigned int count[SHM_POOL_CLASSES];
+} g_shm_pool = {
+	.lock = __MUTEX_INITIALIZER(g_shm_pool.lock),
+};
+
+static int shm_pool_class(size_t size)
+{
+	unsigned int order = order_base_2(DIV_ROUND_UP(size, PAGE_SIZE));
+
+	return order < SHM_POOL_CLASSES ? order : -1;
+}
+
+/*
+ * Returns a zeroed message buffer of at least @size bytes, taken from the
+ * pool when one of the right class is available.
+ */
+static int smcinvoke_alloc_shm(size_t size, struct qtee_shm *shm)
+{
+	int class = shm_pool_class(size);
+
+	if (class < 0)
+		return qtee_shmbridge_allocate_shm(size, shm);
+
+	mutex_lock(&g_shm_pool.lock);
+	if (g_shm_pool.count[class]) {
+		*shm = g_shm_pool.shm[class][--g_shm_pool.count[class]];
+		mutex_unlock(&g_shm_pool.lock);
+		memset(shm->vaddr, 0, shm->size);
+		return 0;
+	}
+	mutex_unlock(&g_shm_pool.lock);
+
+	/* Allocate the whole class so the buffer can serve any size in it */
+	return qtee_shmbridge_allocate_shm(PAGE_SIZE << class, shm);
+}
+
+static void smcinvoke_free_shm(struct qtee_shm *shm)
+{
+	int class;
+
+	if (!shm->vaddr)
+		return;
+
+	class = shm_pool_class(shm->size);
+	if (class >= 0 && shm->size == PAGE_SIZE << class) {
+		mutex_lock(&g_shm_pool.lock);
+		if (g_shm_pool.count[class] < SHM_POOL_DEPTH) {
+			g_shm_pool.shm[class][g_shm_pool.count[class]++] = *shm;
+			mutex_unlock(&g_shm_pool.lock);
+			memset(shm, 0, sizeof(*shm));
+			return;
+		}
+		mutex_unlock(&g_shm_pool.lock);
+	}
+
+	qtee_shmbridge_free_shm(shm);
+}
+
+static void smcinvoke_drain_shm_pool(void)
+{
+	int class;
+
+	mutex_lock(&g_shm_pool.lock);
+	for (class = 0; class < SHM_POOL_CLASSES; class++) {
+		while (g_shm_pool.count[class])
+			qtee_shmbridge_free_shm(
+				&g_shm_pool.shm[class][--g_shm_pool.count[class]]);
+	}
+	mutex_unlock(&g_shm_pool.lock);
+}
+
+/*
+ * Latency histograms, one per stage, in log2 microsecond buckets. Bucket
+ * i counts samples in [2^i, 2^(i+1)) us and the last one everything above.
+ */
+#define SMCI_LAT_BUCKETS	22
+
+enum smcinvoke_lat_stage {
+	SMCI_LAT_INVOKE_ROOT,		/* INVOKE_REQ on the root object */
+	SMCI_LAT_INVOKE_OBJ,		/* INVOKE_REQ on other TZ objects */
+	SMCI_LAT_INVOKE_KERNEL,		/* invokes from kernel clients */
+	SMCI_LAT_MARSHAL_IN,
+	SMCI_LAT_SMC,			/* each SMC, secure world time */
+	SMCI_LAT_MARSHAL_OUT,
+	SMCI_LAT_CB_KERNEL,		/* callbacks served by the kernel */
+	SMCI_LAT_CB_MEM,		/* memory object releases */
+	SMCI_LAT_CB_USER,		/* round trips to userspace servers */
+	SMCI_LAT_RELEASE,		/* object release SMCs */
+	SMCI_LAT_RELEASE_BACKLOG,	/* time queued for the object kthread */
+	SMCI_LAT_MAX
+};
+
+static const char * const smcinvoke_lat_names[SMCI_LAT_MAX] = {
+	[SMCI_LAT_INVOKE_ROOT]		= "invoke_root",
+	[SMCI_LAT_INVOKE_OBJ]		= "invoke_obj",
+	[SMCI_LAT_INVOKE_KERNEL]	= "invoke_kernel",
+	[SMCI_LAT_MARSHAL_IN]		= "marshal_in",
+	[SMCI_LAT_SMC]			= "smc",
+	[SMCI_LAT_MARSHAL_OUT]		= "marshal_out",
+	[SMCI_LAT_CB_KERNEL]		= "cb_kernel",
+	[SMCI_LAT_CB_MEM]		= "cb_mem",
+	[SMCI_LAT_CB_USER]		= "cb_user",
+	[SMCI_LAT_RELEASE]		= "release",
+	[SMCI_LAT_RELEASE_BACKLOG]	= "release_backlog",
+};
+
+static struct {
+	spinlock_t lock;
+	u64 count[SMCI_LAT_MAX];
+	u64 sum_ns[SMCI_LAT_MAX];
+	u64 max_ns[SMCI_LAT_MAX];
+	u32 buckets[SMCI_LAT_MAX][SMCI_LAT_BUCKETS];
+	unsigned int backlog;
+	unsigned int max_backlog;
+} g_lat = {
+	.lock = __SPIN_LOCK_UNLOCKED(g_lat.lock),
+};
+
+static struct dentry *smcinvoke_debugfs_root;
+
+static void smcinvoke_record_latency(enum smcinvoke_lat_stage stage, ktime_t start)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+	unsigned int bucket = us ? min_t(unsigned int, ilog2(us), SMCI_LAT_BUCKETS - 1) : 0;
+
+	trace_smcinvoke_latency(smcinvoke_lat_names[stage], ns);
+
+	spin_lock(&g_lat.lock);
+	g_lat.count[stage]++;
+	g_lat.sum_ns[stage] += ns;
+	g_lat.max_ns[stage] = max(g_lat.max_ns[stage], ns);
+	g_lat.buckets[stage][bucket]++;
+	spin_unlock(&g_lat.lock);
+}
+
+static int smcinvoke_latency_show(struct seq_file *s, void *unused)
+{
+	int i, j;
+
+	seq_puts(s, "# bucket i counts samples taking [2^i, 2^(i+1)) us, the last one everything above\n");
+	spin_lock(&g_lat.lock);
+	seq_printf(s, "release backlog: %u max: %u\n", g_lat.backlog,
+			g_lat.max_backlog);
+	for (i = 0; i < SMCI_LAT_MAX; i++) {
+		seq_printf(s, "%-16s count: %llu avg_us: %llu max_us: %llu\n ",
+				smcinvoke_lat_names[i], g_lat.count[i],
+				g_lat.count[i] ?
+				div64_u64(g_lat.sum_ns[i], g_lat.count[i] * NSEC_PER_USEC) : 0,
+				div_u64(g_lat.max_ns[i], NSEC_PER_USEC));
+		for (j = 0; j < SMCI_LAT_BUCKETS; j++)
+			seq_printf(s, " %u", g_lat.buckets[i][j]);
+		seq_putc(s, '\n');
+	}
+	spin_unlock(&g_lat.lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(smcinvoke_latency);
+
 static struct smcinvoke_mem_obj *find_mem_obj_locked(uint16_t mem_obj_id,
 							bool is_mem_rgn_obj)
 {
@@ -558,6 +744,7 @@ static int smcinvoke_release_tz_object(struct qtee_shm *in_shm, struct qtee_shm
 	uint8_t *out_buf = NULL;
 	struct smcinvoke_msg_hdr hdr = {0};
 	struct smcinvoke_cmd_req req = {0};
+	ktime_t start = ktime_get();
 
 	in_buf = in_shm->vaddr;
 	out_buf = out_shm->vaddr;
@@ -571,6 +758,7 @@ static int smcinvoke_release_tz_object(struct qtee_shm *in_shm, struct qtee_shm
 			SMCINVOKE_TZ_MIN_BUF_SIZE, &req, NULL,
 			&release_handles, context_type, in_shm, out_shm, false);
 	process_piggyback_data(out_buf, SMCINVOKE_TZ_MIN_BUF_SIZE);
+	smcinvoke_record_latency(SMCI_LAT_RELEASE, start);
 	if (ret) {
 		pr_err_ratelimited("Failed to release object(0x%x), ret:%d\n",
 				hdr.tzhandle, ret);
@@ -583,21 +771,27 @@ static int smcinvoke_release_tz_object(struct qtee_shm *in_shm, struct qtee_shm
 }
 
 
+/*
+ * Releases are taken off the pending list in batches, so that a process
+ * exiting with many objects costs one list splice and one pair of message
+ * buffers rather than a lock round trip per handle.
+ */
 static int smcinvoke_object_post_process(void)
 {
-	struct smcinvoke_object_release_pending_list *entry = NULL;
-	struct list_head *pos;
+	struct smcinvoke_object_release_pending_list *entry = NULL, *tmp;
+	LIST_HEAD(batch);
+	unsigned int count, failed;
 	int ret = 0;
 	struct qtee_shm in_shm = {0}, out_shm = {0};
 
-	ret = qtee_shmbridge_allocate_shm(SMCINVOKE_TZ_MIN_BUF_SIZE, &in_shm);
+	ret = smcinvoke_alloc_shm(SMCINVOKE_TZ_MIN_BUF_SIZE, &in_shm);
 	if (ret) {
 		ret = -ENOMEM;
 		pr_err("shmbridge alloc failed for in msg in object release\n");
 		goto out;
 	}
 
-	ret = qtee_shmbridge_allocate_shm(SMCINVOKE_TZ_MIN_BUF_SIZE, &out_shm);
+	ret = smcinvoke_alloc_shm(SMCINVOKE_TZ_MIN_BUF_SIZE, &out_shm);
 	if (ret) {
 		ret = -ENOMEM;
 		pr_err("shmbridge alloc failed for out msg in object release\n");
@@ -606,30 +800,34 @@ static int smcinvoke_object_post_process(void)
 
 	do {
 		mutex_lock(&object_postprocess_lock);
-		if (list_empty(&g_object_postprocess)) {
-			mutex_unlock(&object_postprocess_lock);
-			break;
-		}
-		pos = g_object_postprocess.next;
-		entry = list_entry(pos, struct smcinvoke_object_release_pending_list, list);
-
-		list_del(pos);
+		list_splice_init(&g_object_postprocess, &batch);
 		mutex_unlock(&object_postprocess_lock);
+		if (list_empty(&batch))
+			break;
 
-		if (entry) {
+		count = 0;
+		failed = 0;
+		list_for_each_entry_safe(entry, tmp, &batch, list) {
+			smcinvoke_record_latency(SMCI_LAT_RELEASE_BACKLOG, entry->queued);
+			spin_lock(&g_lat.lock);
+			g_lat.backlog--;
+			spin_unlock(&g_lat.lock);
 			do {
 				ret = smcinvoke_release_tz_object(&in_shm, &out_shm,
 						entry->data.tzhandle,  entry->data.context_type);
 			} while (-EBUSY == ret);
-		} else {
-			pr_err("entry is NULL, pos:%#llx\n", (uint64_t)pos);
+			if (ret)
+				failed++;
+			count++;
+			list_del(&entry->list);
+			kfree_sensitive(entry);
 		}
-		kfree_sensitive(entry);
+		trace_smcinvoke_object_release_batch(count, failed);
 	} while (1);
 
 out:
-	qtee_shmbridge_free_shm(&in_shm);
-	qtee_shmbridge_free_shm(&out_shm);
+	smcinvoke_free_shm(&in_shm);
+	smcinvoke_free_shm(&out_shm);
 
 	return ret;
 }
@@ -685,6 +883,30 @@ static void __wakeup_postprocess_kthread(struct smcinvoke_worker_thread *smcinvo
 }
 
 
+static void queue_object_release(uint32_t tzhandle, uint32_t context_type)
+{
+	struct smcinvoke_object_release_pending_list *entry = NULL;
+
+	entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry) {
+		pr_err("Unable to queue release of handle:%u\n", tzhandle);
+		return;
+	}
+
+	entry->data.tzhandle = tzhandle;
+	entry->data.context_type = context_type;
+	entry->queued = ktime_get();
+	mutex_lock(&object_postprocess_lock);
+	list_add_tail(&entry->list, &g_object_postprocess);
+	mutex_unlock(&object_postprocess_lock);
+
+	spin_lock(&g_lat.lock);
+	g_lat.max_backlog = max(g_lat.max_backlog, ++g_lat.backlog);
+	spin_unlock(&g_lat.lock);
+	pr_debug("Object release list: added a handle:%u\n", tzhandle);
+	__wakeup_postprocess_kthread(&smcinvoke[OBJECT_WORKER_THREAD]);
+}
+
 static int smcinvoke_postprocess_kthread_func(void *data)
 {
 	struct smcinvoke_worker_thread *smcinvoke_wrk_trd = data;
@@ -701,6 +923,12 @@ static int smcinvoke_postprocess_kthread_func(void *data)
 			kthread_should_stop() ||
 			(atomic_read(&smcinvoke_wrk_trd->postprocess_kthread_state)
 			== POST_KT_WAKEUP));
+		/*
+		 * Go back to sleep state before draining, so that work queued
+		 * while this pass runs wakes the thread for another one.
+		 */
+		atomic_set(&smcinvoke_wrk_trd->postprocess_kthread_state,
+			POST_KT_SLEEP);
 		switch (smcinvoke_wrk_trd->type) {
 		case SHMB_WORKER_THREAD:
 			pr_debug("kthread to %s postprocess is called %d\n",
@@ -733,9 +961,6 @@ static int smcinvoke_postprocess_kthread_func(void *data)
 		 */
 		if (smcinvoke_wrk_trd->type == ADCI_WORKER_THREAD)
 			break;
-
-		atomic_set(&smcinvoke_wrk_trd->postprocess_kthread_state,
-			POST_KT_SLEEP);
 	}
 	pr_warn("kthread(worker_thread) processed, worker_thread type is %d\n",
 			smcinvoke_wrk_trd->type);
@@ -832,7 +1057,7 @@ static inline void free_mem_obj_locked(struct smcinvoke_mem_obj *mem_obj)
 	kfree(mem_obj->server);
 	kfree(mem_obj);
 	mem_obj = NULL;
-	mutex_unlock(&g_smcinvoke_lock);
+	mutex_unlock(&g_mem_obj_lock);
 
 	if (shmbridge_handle)
 		ret = qtee_shmbridge_deregister(shmbridge_handle);
@@ -859,7 +1084,7 @@ static inline void free_mem_obj_locked(struct smcinvoke_mem_obj *mem_obj)
 		dma_buf_put(dmabuf_to_free);
 	}
 
-	mutex_lock(&g_smcinvoke_lock);
+	mutex_lock(&g_mem_obj_lock);
 }
 
 static void del_mem_regn_obj_locked(struct kref *kref)
@@ -996,10 +1221,22 @@ static int put_pending_cbobj_locked(uint16_t srvr_id, int16_t obj_id)
 	return ret;
 }
 
+static int release_mem_obj(int32_t tzhandle)
+{
+	int ret;
+
+	mutex_lock(&g_mem_obj_lock);
+	ret = release_mem_obj_locked(tzhandle);
+	mutex_unlock(&g_mem_obj_lock);
+
+	return ret;
+}
+
+/* Caller holds g_smcinvoke_lock; memory objects take g_mem_obj_lock here */
 static int release_tzhandle_locked(int32_t tzhandle)
 {
 	if (TZHANDLE_IS_MEM_OBJ(tzhandle))
-		return release_mem_obj_locked(tzhandle);
+		return release_mem_obj(tzhandle);
 	else if (TZHANDLE_IS_CB_OBJ(tzhandle))
 		return put_pending_cbobj_locked(TZHANDLE_GET_SERVER(tzhandle),
 				TZHANDLE_GET_OBJID(tzhandle));
@@ -1010,10 +1247,16 @@ static void release_tzhandles(const int32_t *tzhandles, size_t len)
 {
 	size_t i;
 
-	mutex_lock(&g_smcinvoke_lock);
-	for (i = 0; i < len; i++)
-		release_tzhandle_locked(tzhandles[i]);
-	mutex_unlock(&g_smcinvoke_lock);
+	for (i = 0; i < len; i++) {
+		if (TZHANDLE_IS_MEM_OBJ(tzhandles[i])) {
+			release_mem_obj(tzhandles[i]);
+		} else if (TZHANDLE_IS_CB_OBJ(tzhandles[i])) {
+			mutex_lock(&g_smcinvoke_lock);
+			put_pending_cbobj_locked(TZHANDLE_GET_SERVER(tzhandles[i]),
+					TZHANDLE_GET_OBJID(tzhandles[i]));
+			mutex_unlock(&g_smcinvoke_lock);
+		}
+	}
 }
 
 static void delete_cb_txn_locked(struct kref *kref)
@@ -1026,6 +1269,7 @@ static void delete_cb_txn_locked(struct kref *kref)
 
 	kfree(cb_txn->cb_req);
 	hash_del(&cb_txn->hash);
+	list_del(&cb_txn->list);
 	kfree(cb_txn);
 }
 
@@ -1033,20 +1277,17 @@ static struct smcinvoke_cb_txn *find_cbtxn_locked(
 		struct smcinvoke_server_info *server,
 		uint32_t txn_id, int32_t state)
 {
-	int i = 0;
 	struct smcinvoke_cb_txn *cb_txn = NULL;
 
-	/*
-	 * Since HASH_BITS() does not work on pointers, we can't select hash
-	 * table using state and loop over it.
-	 */
 	if (state == SMCINVOKE_REQ_PLACED) {
-		/* pick up 1st req */
-		hash_for_each(server->reqs_table, i, cb_txn, hash) {
+		/* pick up the oldest req */
+		cb_txn = list_first_entry_or_null(&server->reqs_list,
+				struct smcinvoke_cb_txn, list);
+		if (cb_txn) {
 			kref_get(&cb_txn->ref_cnt);
-			hash_del(&cb_txn->hash);
-			return cb_txn;
+			list_del_init(&cb_txn->list);
 		}
+		return cb_txn;
 	} else if (state == SMCINVOKE_REQ_PROCESSING) {
 		hash_for_each_possible(
 				server->responses_table, cb_txn, hash, txn_id) {
@@ -1239,7 +1480,7 @@ static int32_t smcinvoke_map_mem_region_locked(struct smcinvoke_mem_obj *mem_obj
 		 * case of shmbridge creation.
 		 */
 		kref_get(&mem_obj->mem_map_obj_ref_cnt);
-		mutex_unlock(&g_smcinvoke_lock);
+		mutex_unlock(&g_mem_obj_lock);
 
 		ret = smcinvoke_create_bridge(mem_obj);
 
@@ -1248,7 +1489,7 @@ static int32_t smcinvoke_map_mem_region_locked(struct smcinvoke_mem_obj *mem_obj
 		 * have to check again if the memobj is still valid or not
 		 * after decreasing the reference.
 		 */
-		mutex_lock(&g_smcinvoke_lock);
+		mutex_lock(&g_mem_obj_lock);
 		kref_put(&mem_obj->mem_map_obj_ref_cnt, del_mem_map_obj_locked);
 
 		if (ret) {
@@ -1291,13 +1532,13 @@ static int create_mem_obj(struct dma_buf *dma_buf, int32_t *tzhandle,
 	}
 	kref_init(&t_mem_obj->mem_regn_ref_cnt);
 	t_mem_obj->dma_buf = dma_buf;
-	mutex_lock(&g_smcinvoke_lock);
+	mutex_lock(&g_mem_obj_lock);
 	t_mem_obj->mem_region_id = next_mem_region_obj_id_locked();
 	server_i->server_id = server_id;
 	t_mem_obj->server = server_i;
 	t_mem_obj->mem_obj_user_fd = user_handle;
 	list_add_tail(&t_mem_obj->list, &g_mem_objs);
-	mutex_unlock(&g_smcinvoke_lock);
+	mutex_unlock(&g_mem_obj_lock);
 	*mem_obj = t_mem_obj;
 	*tzhandle = TZHANDLE_MAKE_LOCAL(MEM_RGN_SRVR_ID,
 			t_mem_obj->mem_region_id);
@@ -1342,7 +1583,7 @@ static int get_tzhandle_from_uhandle(int32_t uhandle, int32_t server_fd,
 			server_id = get_server_id(server_fd);
 			ret = create_mem_obj(dma_buf, tzhandle, &mem_obj, server_id, uhandle);
 			if (!ret && mem_obj_async_support && l_pending_mem_obj) {
-				mutex_lock(&g_smcinvoke_lock);
+				mutex_lock(&g_mem_obj_lock);
 				/* Map the newly created memory object and add it
 				 * to l_pending_mem_obj list.
 				 * Before returning to TZ, add the mapping data
@@ -1355,7 +1596,7 @@ static int get_tzhandle_from_uhandle(int32_t uhandle, int32_t server_fd,
 				else
 					pr_err("Failed to map memory region\n");
 
-				mutex_unlock(&g_smcinvoke_lock);
+				mutex_unlock(&g_mem_obj_lock);
 			}
 
 		} else if (is_remote_obj(UHANDLE_GET_FD(uhandle),
@@ -1431,7 +1672,7 @@ static int get_uhandle_from_tzhandle(int32_t tzhandle, int32_t srvr_id,
 	} else if (TZHANDLE_IS_MEM_RGN_OBJ(tzhandle)) {
 		struct smcinvoke_mem_obj *mem_obj = NULL;
 
-		MUTEX_LOCK(lock)
+		mutex_lock(&g_mem_obj_lock);
 		mem_obj = find_mem_obj_locked(TZHANDLE_GET_OBJID(tzhandle),
 				SMCINVOKE_MEM_RGN_OBJ);
 
@@ -1445,7 +1686,7 @@ static int get_uhandle_from_tzhandle(int32_t tzhandle, int32_t srvr_id,
 			ret = 0;
 		}
 exit_lock:
-		MUTEX_UNLOCK(lock)
+		mutex_unlock(&g_mem_obj_lock);
 	} else if (TZHANDLE_IS_REMOTE(tzhandle)) {
 		/* if execution comes here => tzhandle is an unsigned int */
 		ret = get_fd_for_obj(context_type,
@@ -1466,7 +1707,7 @@ static int32_t smcinvoke_release_mem_obj_locked(void *buf, size_t buf_len)
 
 	trace_release_mem_obj_locked(msg->hdr.tzhandle, buf_len);
 
-	return release_tzhandle_locked(msg->hdr.tzhandle);
+	return release_mem_obj_locked(msg->hdr.tzhandle);
 }
 
 static int32_t smcinvoke_process_map_mem_region_req(void *buf, size_t buf_len)
@@ -1490,11 +1731,11 @@ static int32_t smcinvoke_process_map_mem_region_req(void *buf, size_t buf_len)
 	ob = buf + msg->args[0].b.offset;
 	oo = &msg->args[2].handle;
 
-	mutex_lock(&g_smcinvoke_lock);
+	mutex_lock(&g_mem_obj_lock);
 	mem_obj = find_mem_obj_locked(TZHANDLE_GET_OBJID(msg->args[1].handle),
 			SMCINVOKE_MEM_RGN_OBJ);
 	if (!mem_obj) {
-		mutex_unlock(&g_smcinvoke_lock);
+		mutex_unlock(&g_mem_obj_lock);
 		pr_err("Memory object not found\n");
 		return OBJECT_ERROR_BADOBJ;
 	}
@@ -1511,7 +1752,7 @@ static int32_t smcinvoke_process_map_mem_region_req(void *buf, size_t buf_len)
 		*oo = TZHANDLE_MAKE_LOCAL(MEM_MAP_SRVR_ID, mem_obj->mem_map_obj_id);
 	}
 
-	mutex_unlock(&g_smcinvoke_lock);
+	mutex_unlock(&g_mem_obj_lock);
 
 	return ret;
 }
@@ -1567,11 +1808,11 @@ static void process_mem_obj(void *buf, size_t buf_len)
 {
 	struct smcinvoke_tzcb_req *cb_req = buf;
 
-	mutex_lock(&g_smcinvoke_lock);
+	mutex_lock(&g_mem_obj_lock);
 	cb_req->result = (cb_req->hdr.op == OBJECT_OP_RELEASE) ?
 			smcinvoke_release_mem_obj_locked(buf, buf_len) :
 			OBJECT_ERROR_INVALID;
-	mutex_unlock(&g_smcinvoke_lock);
+	mutex_unlock(&g_mem_obj_lock);
 }
 
 static int invoke_cmd_handler(int cmd, phys_addr_t in_paddr, size_t in_buf_len,
@@ -1581,6 +1822,7 @@ static int invoke_cmd_handler(int cmd, phys_addr_t in_paddr, size_t in_buf_len,
 		struct qtee_shm *out_shm)
 {
 	int ret = 0;
+	ktime_t start = ktime_get();
 
 	switch (cmd) {
 	case SMCINVOKE_INVOKE_CMD_LEGACY:
@@ -1613,6 +1855,7 @@ static int invoke_cmd_handler(int cmd, phys_addr_t in_paddr, size_t in_buf_len,
 		break;
 	}
 
+	smcinvoke_record_latency(SMCI_LAT_SMC, start);
 	trace_invoke_cmd_handler(cmd, *response_type, *result, ret);
 	return ret;
 }
@@ -1631,6 +1874,7 @@ static void process_tzcb_req(void *buf, size_t buf_len, struct file **arr_filp)
 	struct smcinvoke_server_info *srvr_info = NULL;
 	struct smcinvoke_mem_obj *mem_obj = NULL;
 	uint16_t server_id = 0;
+	ktime_t start = ktime_get();
 
 	if (buf_len < sizeof(struct smcinvoke_tzcb_req)) {
 		pr_err("smaller buffer length : %zu\n", buf_len);
@@ -1641,14 +1885,18 @@ static void process_tzcb_req(void *buf, size_t buf_len, struct file **arr_filp)
 
 	/* check whether it is to be served by kernel or userspace */
 	if (TZHANDLE_IS_KERNEL_OBJ(cb_req->hdr.tzhandle)) {
-		return process_kernel_obj(buf, buf_len);
+		process_kernel_obj(buf, buf_len);
+		smcinvoke_record_latency(SMCI_LAT_CB_KERNEL, start);
+		return;
 	} else if (TZHANDLE_IS_MEM_MAP_OBJ(cb_req->hdr.tzhandle)) {
 		/*
 		 * MEM_MAP memory object is created and owned by kernel,
 		 * hence its processing(handling deletion) is done in
 		 * kernel context.
 		 */
-		return process_mem_obj(buf, buf_len);
+		process_mem_obj(buf, buf_len);
+		smcinvoke_record_latency(SMCI_LAT_CB_MEM, start);
+		return;
 	} else if (TZHANDLE_IS_MEM_RGN_OBJ(cb_req->hdr.tzhandle)) {
 		/*
 		 * MEM_RGN memory objects are created and owned by userspace,
@@ -1695,20 +1943,24 @@ static void process_tzcb_req(void *buf, size_t buf_len, struct file **arr_filp)
 	cb_txn->cb_req = cb_req;
 	cb_txn->cb_req_bytes = buf_len;
 	cb_txn->filp_to_release = arr_filp;
+	INIT_LIST_HEAD(&cb_txn->list);
 	kref_init(&cb_txn->ref_cnt);
 
 	mutex_lock(&g_smcinvoke_lock);
 	++cb_reqs_inflight;
 
 	if (TZHANDLE_IS_MEM_RGN_OBJ(cb_req->hdr.tzhandle)) {
+		mutex_lock(&g_mem_obj_lock);
 		mem_obj = find_mem_obj_locked(TZHANDLE_GET_OBJID(cb_req->hdr.tzhandle),
 				SMCINVOKE_MEM_RGN_OBJ);
 		if (!mem_obj) {
+			mutex_unlock(&g_mem_obj_lock);
 			pr_err("mem obj with tzhandle : %d not found\n", cb_req->hdr.tzhandle);
 			mutex_unlock(&g_smcinvoke_lock);
 			goto out;
 		}
 		server_id = mem_obj->server->server_id;
+		mutex_unlock(&g_mem_obj_lock);
 	} else
 		server_id = TZHANDLE_GET_SERVER(cb_req->hdr.tzhandle);
 
@@ -1726,7 +1978,7 @@ static void process_tzcb_req(void *buf, size_t buf_len, struct file **arr_filp)
 	}
 
 	cb_txn->txn_id = ++srvr_info->txn_id;
-	hash_add(srvr_info->reqs_table, &cb_txn->hash, cb_txn->txn_id);
+	list_add_tail(&cb_txn->list, &srvr_info->reqs_list);
 	mutex_unlock(&g_smcinvoke_lock);
 
 	trace_process_tzcb_req_wait(cb_req->hdr.tzhandle, cbobj_retries, cb_txn->txn_id,
@@ -1736,7 +1988,8 @@ static void process_tzcb_req(void *buf, size_t buf_len, struct file **arr_filp)
 	 * we need not worry that server_info will be deleted because as long
 	 * as this CBObj is served by this server, srvr_info will be valid.
 	 */
-	wake_up_interruptible_all(&srvr_info->req_wait_q);
+	/* accept threads wait exclusively, so this hands the req to one of them */
+	wake_up_interruptible(&srvr_info->req_wait_q);
 	/* timeout before 1s otherwise tzbusy would come */
 	timeout_jiff = msecs_to_jiffies(100);
 
@@ -1791,6 +2044,7 @@ static void process_tzcb_req(void *buf, size_t buf_len, struct file **arr_filp)
 	 */
 	mutex_lock(&g_smcinvoke_lock);
 	hash_del(&cb_txn->hash);
+	list_del_init(&cb_txn->list);
 	if (ret == 0) {
 		pr_err("CBObj timed out! No more retries\n");
 		cb_req->result = Object_ERROR_TIMEOUT;
@@ -1823,6 +2077,7 @@ static void process_tzcb_req(void *buf, size_t buf_len, struct file **arr_filp)
 	if (srvr_info)
 		kref_put(&srvr_info->ref_cnt, destroy_cb_server);
 	mutex_unlock(&g_smcinvoke_lock);
+	smcinvoke_record_latency(SMCI_LAT_CB_USER, start);
 }
 
 static int marshal_out_invoke_req(const uint8_t *buf, uint32_t buf_size,
@@ -1836,6 +2091,7 @@ static int marshal_out_invoke_req(const uint8_t *buf, uint32_t buf_size,
 	size_t offset = sizeof(struct smcinvoke_msg_hdr) +
 			OBJECT_COUNTS_TOTAL(req->counts) *
 			sizeof(union smcinvoke_tz_args);
+	ktime_t start = ktime_get();
 
 	if (offset > buf_size)
 		goto out;
@@ -1897,6 +2153,7 @@ static int marshal_out_invoke_req(const uint8_t *buf, uint32_t buf_size,
 	}
 	ret = 0;
 out:
+	smcinvoke_record_latency(SMCI_LAT_MARSHAL_OUT, start);
 	return ret;
 }
 
@@ -2378,11 +2635,11 @@ static int marshal_out_tzcb_req(const struct smcinvoke_accept *user_req,
 				break;
 			}
 
-			mutex_lock(&g_smcinvoke_lock);
+			mutex_lock(&g_mem_obj_lock);
 			add_mem_obj_info_to_async_side_channel_locked(async_buf_begin,
 						async_buf_size, &l_mem_objs_pending_async);
 			delete_pending_async_list_locked(&l_mem_objs_pending_async);
-			mutex_unlock(&g_smcinvoke_lock);
+			mutex_unlock(&g_mem_obj_lock);
 		}
 	} while (0);
 
@@ -2588,7 +2845,7 @@ static long process_server_req(struct file *filp, unsigned int cmd,
 	init_waitqueue_head(&server_info->req_wait_q);
 	init_waitqueue_head(&server_info->rsp_wait_q);
 	server_info->cb_buf_size = server_req.cb_buf_size;
-	hash_init(server_info->reqs_table);
+	INIT_LIST_HEAD(&server_info->reqs_list);
 	hash_init(server_info->responses_table);
 	INIT_LIST_HEAD(&server_info->pending_cbobjs);
 	server_info->is_server_suspended = 0;
@@ -2599,7 +2856,7 @@ static long process_server_req(struct file *filp, unsigned int cmd,
 	hash_add(g_cb_servers, &server_info->hash,
 			server_info->server_id);
 	if (g_max_cb_buf_size < server_req.cb_buf_size)
-		g_max_cb_buf_size = server_req.cb_buf_size;
+		WRITE_ONCE(g_max_cb_buf_size, server_req.cb_buf_size);
 
 	mutex_unlock(&g_smcinvoke_lock);
 	ret = get_fd_for_obj(SMCINVOKE_OBJ_TYPE_SERVER,
@@ -2709,8 +2966,8 @@ static long process_accept_req(struct file *filp, unsigned int cmd,
 	 * callback req to process.
 	 */
 	do {
-		ret = wait_event_interruptible(server_info->req_wait_q,
-				!hash_empty(server_info->reqs_table));
+		ret = wait_event_interruptible_exclusive(server_info->req_wait_q,
+				!list_empty(&server_info->reqs_list));
 		if (ret) {
 			trace_process_accept_req_ret(current->pid, current->tgid, ret);
 			/*
@@ -2813,6 +3070,7 @@ static long process_invoke_req(struct file *filp, unsigned int cmd,
 	int32_t tzhandles_to_release[OBJECT_COUNTS_MAX_OO] = {0};
 	bool tz_acked = false;
 	uint32_t context_type = tzobj->context_type;
+	ktime_t start = ktime_get(), marshal_start;
 
 	if (context_type == SMCINVOKE_OBJ_TYPE_TZ_OBJ &&
 			_IOC_SIZE(cmd) != sizeof(req)) {
@@ -2871,7 +3129,7 @@ static long process_invoke_req(struct file *filp, unsigned int cmd,
 	}
 
 	inmsg_size = compute_in_msg_size(&req, args_buf);
-	ret = qtee_shmbridge_allocate_shm(inmsg_size, &in_shm);
+	ret = smcinvoke_alloc_shm(inmsg_size, &in_shm);
 	if (ret) {
 		ret = -ENOMEM;
 		pr_err("shmbridge alloc failed for in msg in invoke req\n");
@@ -2879,10 +3137,8 @@ static long process_invoke_req(struct file *filp, unsigned int cmd,
 	}
 	in_msg = in_shm.vaddr;
 
-	mutex_lock(&g_smcinvoke_lock);
-	outmsg_size = PAGE_ALIGN(g_max_cb_buf_size);
-	mutex_unlock(&g_smcinvoke_lock);
-	ret = qtee_shmbridge_allocate_shm(outmsg_size, &out_shm);
+	outmsg_size = PAGE_ALIGN(READ_ONCE(g_max_cb_buf_size));
+	ret = smcinvoke_alloc_shm(outmsg_size, &out_shm);
 	if (ret) {
 		ret = -ENOMEM;
 		pr_err("shmbridge alloc failed for out msg in invoke req\n");
@@ -2892,21 +3148,23 @@ static long process_invoke_req(struct file *filp, unsigned int cmd,
 
 	trace_process_invoke_req_tzhandle(tzobj->tzhandle, req.op, req.counts);
 
+	marshal_start = ktime_get();
 	ret = marshal_in_invoke_req(&req, args_buf, tzobj->tzhandle, in_msg,
 			inmsg_size, filp_to_release, tzhandles_to_release,
 			context_type, &l_mem_objs_pending_async);
+	smcinvoke_record_latency(SMCI_LAT_MARSHAL_IN, marshal_start);
 	if (ret) {
 		pr_err("failed to marshal in invoke req, ret :%d\n", ret);
 		goto out;
 	}
 
 	if (mem_obj_async_support) {
-		mutex_lock(&g_smcinvoke_lock);
+		mutex_lock(&g_mem_obj_lock);
 		add_mem_obj_info_to_async_side_channel_locked(
 				out_msg,
 				outmsg_size,
 				&l_mem_objs_pending_async);
-		mutex_unlock(&g_smcinvoke_lock);
+		mutex_unlock(&g_mem_obj_lock);
 	}
 
 	ret = prepare_send_scm_msg(in_msg, in_shm.paddr, inmsg_size,
@@ -2959,15 +3217,24 @@ static long process_invoke_req(struct file *filp, unsigned int cmd,
 			req.op, req.counts);
 
 	release_filp(filp_to_release, OBJECT_COUNTS_MAX_OO);
-	if (ret) {
+	mutex_lock(&g_mem_obj_lock);
+	if (ret)
 		release_map_obj_pending_async_list_locked(&l_mem_objs_pending_async);
-		release_tzhandles(tzhandles_to_release, OBJECT_COUNTS_MAX_OO);
-	}
 	delete_pending_async_list_locked(&l_mem_objs_pending_async);
-	qtee_shmbridge_free_shm(&in_shm);
-	qtee_shmbridge_free_shm(&out_shm);
+	mutex_unlock(&g_mem_obj_lock);
+	if (ret)
+		release_tzhandles(tzhandles_to_release, OBJECT_COUNTS_MAX_OO);
+	smcinvoke_free_shm(&in_shm);
+	smcinvoke_free_shm(&out_shm);
 	kfree(args_buf);
 
+	if (context_type == SMCINVOKE_OBJ_TYPE_TZ_OBJ_FOR_KERNEL)
+		smcinvoke_record_latency(SMCI_LAT_INVOKE_KERNEL, start);
+	else if (tzobj->tzhandle == SMCINVOKE_TZ_ROOT_OBJ)
+		smcinvoke_record_latency(SMCI_LAT_INVOKE_ROOT, start);
+	else
+		smcinvoke_record_latency(SMCI_LAT_INVOKE_OBJ, start);
+
 	if (ret)
 		pr_err("invoke thread returning with ret = %d\n", ret);
 
@@ -3085,7 +3352,6 @@ int smcinvoke_release_filp(struct file *filp)
 	int ret = 0;
 	struct smcinvoke_file_data *file_data = filp->private_data;
 	uint32_t tzhandle = 0;
-	struct smcinvoke_object_release_pending_list *entry = NULL;
 	struct qtee_shm in_shm = {0}, out_shm = {0};
 
 	trace_smcinvoke_release_filp(current->files, filp,
@@ -3104,13 +3370,23 @@ int smcinvoke_release_filp(struct file *filp)
 		goto out;
 	}
 
-	ret = qtee_shmbridge_allocate_shm(SMCINVOKE_TZ_MIN_BUF_SIZE, &in_shm);
+	/*
+	 * An exiting process closes all of its objects at once; leave the
+	 * SMCs to the object kthread instead of stalling the exit on one
+	 * round trip per handle.
+	 */
+	if (current->flags & PF_EXITING) {
+		queue_object_release(tzhandle, file_data->context_type);
+		goto out;
+	}
+
+	ret = smcinvoke_alloc_shm(SMCINVOKE_TZ_MIN_BUF_SIZE, &in_shm);
 	if (ret) {
 		pr_err("shmbridge alloc failed for in msg in object release with ret %d\n", ret);
 		goto out;
 	}
 
-	ret = qtee_shmbridge_allocate_shm(SMCINVOKE_TZ_MIN_BUF_SIZE, &out_shm);
+	ret = smcinvoke_alloc_shm(SMCINVOKE_TZ_MIN_BUF_SIZE, &out_shm);
 	if (ret) {
 		pr_err("shmbridge alloc failed for out msg in object release with ret:%d\n", ret);
 		goto out;
@@ -3121,24 +3397,13 @@ int smcinvoke_release_filp(struct file *filp)
 
 	if (-EBUSY == ret) {
 		pr_debug("failed to release handle in sync adding to list\n");
-		entry = kzalloc(sizeof(*entry), GFP_KERNEL);
-		if (!entry) {
-			ret = -ENOMEM;
-			goto out;
-		}
+		queue_object_release(tzhandle, file_data->context_type);
 		ret = 0;
-		entry->data.tzhandle = tzhandle;
-		entry->data.context_type = file_data->context_type;
-		mutex_lock(&object_postprocess_lock);
-		list_add_tail(&entry->list, &g_object_postprocess);
-		mutex_unlock(&object_postprocess_lock);
-		pr_debug("Object release list: added a handle:%u\n", tzhandle);
-		__wakeup_postprocess_kthread(&smcinvoke[OBJECT_WORKER_THREAD]);
 	}
 
 out:
-	qtee_shmbridge_free_shm(&in_shm);
-	qtee_shmbridge_free_shm(&out_shm);
+	smcinvoke_free_shm(&in_shm);
+	smcinvoke_free_shm(&out_shm);
 	kfree(filp->private_data);
 	filp->private_data = NULL;
 
@@ -3237,6 +3502,10 @@ static int smcinvoke_probe(struct platform_device *pdev)
 	}
 	smcinvoke_pdev = pdev;
 
+	smcinvoke_debugfs_root = debugfs_create_dir(SMCINVOKE_DEV, NULL);
+	debugfs_create_file("latency", 0400, smcinvoke_debugfs_root, NULL,
+			&smcinvoke_latency_fops);
+
 	__wakeup_postprocess_kthread(&smcinvoke[ADCI_WORKER_THREAD]);
 	return 0;
 
@@ -3255,7 +3524,9 @@ static int smcinvoke_remove(struct platform_device *pdev)
 {
 	int count = 1;
 
+	debugfs_remove_recursive(smcinvoke_debugfs_root);
 	smcinvoke_destroy_kthreads();
+	smcinvoke_drain_shm_pool();
 	cdev_del(&smcinvoke_cdev);
 	device_destroy(driver_class, smcinvoke_device_no);
 	class_destroy(driver_class);
@@ -444,6 +444,38 @@ TRACE_EVENT(smcinvoke_release_filp,
 			__entry->context_type)
 );
 
+TRACE_EVENT(smcinvoke_latency,
+	TP_PROTO(const char *stage, u64 ns),
+	TP_ARGS(stage, ns),
+	TP_STRUCT__entry(
+		__string(stage,		stage)
+		__field(u64,		ns)
+	),
+	TP_fast_assign(
+		__assign_str(stage, stage);
+		__entry->ns		= ns;
+	),
+	TP_printk("stage=%s ns=%llu",
+			__get_str(stage),
+			__entry->ns)
+);
+
+TRACE_EVENT(smcinvoke_object_release_batch,
+	TP_PROTO(unsigned int count, unsigned int failed),
+	TP_ARGS(count, failed),
+	TP_STRUCT__entry(
+		__field(unsigned int,	count)
+		__field(unsigned int,	failed)
+	),
+	TP_fast_assign(
+		__entry->count		= count;
+		__entry->failed		= failed;
+	),
+	TP_printk("count=%u failed=%u",
+			__entry->count,
+			__entry->failed)
+);
+
 TRACE_EVENT(smcinvoke_release_from_kernel_client,
 	TP_PROTO(struct files_struct *files, struct file *filp, int f_count),
 	TP_ARGS(files, filp, f_count),
@@ -93,6 +93,60 @@ void spi_trace_log(struct device *dev, const char *fmt, ...)
 	va_end(args);
 }
 
+/*
+ * Upper bound of transfers queued at once, each takes up to three TREs of
+ * the 64 in a GPI channel ring.
+ */
+#define GSI_CHAIN_MAX_XFERS	16
+
+/**
+ * struct spi_geni_gsi_xfer - what the GPI descriptors of a transfer encode
+ * @tx_buf: TX buffer of the transfer
+ * @rx_buf: RX buffer of the transfer
+ * @len: length of the transfer
+ * @speed_hz: clock rate of the transfer
+ * @bits_per_word: word size of the transfer
+ * @cs_change: cs_change of the transfer
+ * @tx_dma: DMA address of the TX buffer
+ * @rx_dma: DMA address of the RX buffer
+ * @tx: reusable TX descriptor, NULL until built
+ * @rx: reusable RX descriptor, NULL until built or without RX
+ */
+struct spi_geni_gsi_xfer {
+	const void *tx_buf;
+	void *rx_buf;
+	unsigned int len;
+	u32 speed_hz;
+	u8 bits_per_word;
+	bool cs_change;
+	dma_addr_t tx_dma;
+	dma_addr_t rx_dma;
+	struct dma_async_tx_descriptor *tx;
+	struct dma_async_tx_descriptor *rx;
+};
+
+/**
+ * struct spi_geni_gsi_prep - a message replayed from prepared GPI descriptors
+ * @msg: the last message sent in GPI mode, NULL if it can't be prepared
+ * @spi: device of @msg
+ * @mode: mode of @spi when @msg was sent
+ * @num_xfers: number of transfers in @xfer
+ * @built: the descriptors of @xfer are built
+ * @xfer: the transfers of @msg
+ * @pending: DMA channels yet to complete the message
+ * @status: error of the replay, if any
+ */
+struct spi_geni_gsi_prep {
+	struct spi_message *msg;
+	struct spi_device *spi;
+	u32 mode;
+	unsigned int num_xfers;
+	bool built;
+	struct spi_geni_gsi_xfer xfer[GSI_CHAIN_MAX_XFERS];
+	atomic_t pending;
+	int status;
+};
+
 struct spi_geni_master {
 	struct geni_se se;
 	struct device *dev;
@@ -119,6 +173,7 @@ struct spi_geni_master {
 	struct dma_chan *tx;
 	struct dma_chan *rx;
 	int cur_xfer_mode;
+	struct spi_geni_gsi_prep gsi_prep;
 };
 
 static void spi_slv_setup(struct spi_geni_master *mas)
@@ -476,15 +531,42 @@ spi_gsi_callback_result(void *cb, const struct dmaengine_result *result)
 	spi_finalize_current_transfer(spi);
 }
 
-static int setup_gsi_xfer(struct spi_transfer *xfer, struct spi_geni_master *mas,
-			  struct spi_device *spi_slv, struct spi_controller *spi)
+/* The last descriptor of each channel of a prepared message calls this */
+static void
+spi_gsi_prep_callback_result(void *cb, const struct dmaengine_result *result)
+{
+	struct spi_controller *spi = cb;
+	struct spi_geni_master *mas = spi_controller_get_devdata(spi);
+	struct spi_geni_gsi_prep *prep = &mas->gsi_prep;
+
+	if (result->result != DMA_TRANS_NOERROR || result->residue) {
+		dev_err(&spi->dev, "DMA txn failed: %d, pending: %d\n",
+			result->result, result->residue);
+		WRITE_ONCE(prep->status, -EIO);
+	}
+
+	if (atomic_dec_and_test(&prep->pending))
+		spi_finalize_current_transfer(spi);
+}
+
+/*
+ * Build the GPI descriptors of @xfer.  Reusable descriptors read the TX data
+ * from memory when they run, rather than copying it in the TRE once.
+ */
+static int prep_gsi_xfer(struct spi_transfer *xfer, struct spi_geni_master *mas,
+			 struct spi_device *spi_slv, struct spi_controller *spi,
+			 bool reuse, struct dma_async_tx_descriptor **tx_descp,
+			 struct dma_async_tx_descriptor **rx_descp)
 {
 	unsigned long flags = DMA_PREP_INTERRUPT | DMA_CTRL_ACK;
 	struct dma_slave_config config = {};
 	struct gpi_spi_config peripheral = {};
-	struct dma_async_tx_descriptor *tx_desc, *rx_desc;
+	struct dma_async_tx_descriptor *tx_desc, *rx_desc = NULL;
 	int ret;
 
+	if (reuse)
+		flags |= DMA_CTRL_REUSE;
+
 	config.peripheral_config = &peripheral;
 	config.peripheral_size = sizeof(peripheral);
 	peripheral.set_config = true;
@@ -502,12 +584,12 @@ static int setup_gsi_xfer(struct spi_transfer *xfer, struct spi_geni_master *mas
 	 */
 	if (xfer->tx_buf && xfer->rx_buf) {
 		peripheral.cmd = SPI_DUPLEX;
-		if (xfer->len <= QCOM_GPI_IMMEDIATE_DMA_LEN)
+		if (xfer->len <= QCOM_GPI_IMMEDIATE_DMA_LEN && !reuse)
 			peripheral.flags |= QCOM_GPI_IMMEDIATE_DMA;
 	} else if (xfer->tx_buf) {
 		peripheral.cmd = SPI_TX;
 		peripheral.rx_len = 0;
-		if (xfer->len <= QCOM_GPI_IMMEDIATE_DMA_LEN)
+		if (xfer->len <= QCOM_GPI_IMMEDIATE_DMA_LEN && !reuse)
 			peripheral.flags |= QCOM_GPI_IMMEDIATE_DMA;
 	} else if (xfer->rx_buf) {
 		peripheral.cmd = SPI_RX;
@@ -547,6 +629,8 @@ static int setup_gsi_xfer(struct spi_transfer *xfer, struct spi_geni_master *mas
 			dev_err(mas->dev, "Err setting up rx desc\n");
 			return -EIO;
 		}
+		if (reuse)
+			dmaengine_desc_set_reuse(rx_desc);
 	}
 
 	/*
@@ -558,23 +642,67 @@ static int setup_gsi_xfer(struct spi_transfer *xfer, struct spi_geni_master *mas
 					  DMA_MEM_TO_DEV, flags);
 	if (!tx_desc) {
 		dev_err(mas->dev, "Err setting up tx desc\n");
+		if (rx_desc && reuse)
+			dmaengine_desc_free(rx_desc);
 		return -EIO;
 	}
 
-	tx_desc->callback_result = spi_gsi_callback_result;
-	tx_desc->callback_param = spi;
+	if (reuse)
+		dmaengine_desc_set_reuse(tx_desc);
+
+	*tx_descp = tx_desc;
+	*rx_descp = rx_desc;
+	return 0;
+}
+
+/*
+ * Only a transfer with @notify set completes the current transfer, so
+ * several transfers can be queued back to back and waited for at once.
+ */
+static int setup_gsi_xfer(struct spi_transfer *xfer, struct spi_geni_master *mas,
+			  struct spi_device *spi_slv, struct spi_controller *spi,
+			  bool notify)
+{
+	struct dma_async_tx_descriptor *tx_desc, *rx_desc;
+	int ret;
+
+	ret = prep_gsi_xfer(xfer, mas, spi_slv, spi, false, &tx_desc, &rx_desc);
+	if (ret)
+		return ret;
+
+	if (notify) {
+		tx_desc->callback_result = spi_gsi_callback_result;
+		tx_desc->callback_param = spi;
+	}
 
-	if (peripheral.cmd & SPI_RX)
+	if (rx_desc)
 		dmaengine_submit(rx_desc);
 	dmaengine_submit(tx_desc);
 
-	if (peripheral.cmd & SPI_RX)
+	if (rx_desc)
 		dma_async_issue_pending(mas->rx);
 
 	dma_async_issue_pending(mas->tx);
 	return 1;
 }
 
+/* Free the prepared descriptors, which must not be in flight */
+static void spi_geni_gsi_prep_release(struct spi_geni_master *mas)
+{
+	struct spi_geni_gsi_prep *prep = &mas->gsi_prep;
+	unsigned int i;
+
+	for (i = 0; prep->built && i < prep->num_xfers; i++) {
+		dmaengine_desc_free(prep->xfer[i].tx);
+		if (prep->xfer[i].rx)
+			dmaengine_desc_free(prep->xfer[i].rx);
+		prep->xfer[i].tx = NULL;
+		prep->xfer[i].rx = NULL;
+	}
+	prep->built = false;
+	prep->msg = NULL;
+}
+
 static u32 get_xfer_len_in_words(struct spi_transfer *xfer,
 				struct spi_geni_master *mas)
 {
@@ -666,6 +794,8 @@ static int spi_geni_grab_gpi_chan(struct spi_geni_master *mas)
 
 static void spi_geni_release_dma_chan(struct spi_geni_master *mas)
 {
+	spi_geni_gsi_prep_release(mas);
+
 	if (mas->rx) {
 		dma_release_channel(mas->rx);
 		mas->rx = NULL;
@@ -969,7 +1099,274 @@ static int spi_geni_transfer_one(struct spi_controller *spi,
 			ret = 1;
 		return ret;
 	}
-	return setup_gsi_xfer(xfer, mas, slv, spi);
+	return setup_gsi_xfer(xfer, mas, slv, spi, true);
+}
+
+static unsigned int spi_geni_gsi_timeout_ms(struct spi_transfer *xfer,
+					    unsigned int len)
+{
+	u64 ms;
+
+	/* twice the time on the wire, plus some slack, as the SPI core does */
+	ms = 8ULL * MSEC_PER_SEC * len;
+	do_div(ms, max(xfer->speed_hz, 1U));
+	ms += ms + 200;
+
+	return min_t(u64, ms, UINT_MAX);
+}
+
+static dma_addr_t spi_geni_sg_dma(struct sg_table *sgt)
+{
+	return sgt->nents ? sg_dma_address(sgt->sgl) : 0;
+}
+
+/*
+ * Remember @msg, if it may be replayed from prepared descriptors when it is
+ * sent again unchanged.
+ */
+static void spi_geni_gsi_prep_record(struct spi_geni_master *mas,
+				     struct spi_message *msg)
+{
+	struct spi_geni_gsi_prep *prep = &mas->gsi_prep;
+	struct spi_geni_gsi_xfer *px;
+	struct spi_transfer *xfer;
+	unsigned int n = 0;
+
+	spi_geni_gsi_prep_release(mas);
+
+	list_for_each_entry(xfer, &msg->transfers, transfer_list) {
+		if (!xfer->len || xfer->delay.value ||
+		    n == GSI_CHAIN_MAX_XFERS ||
+		    xfer->tx_sg.nents > 1 || xfer->rx_sg.nents > 1)
+			return;
+
+		px = &prep->xfer[n++];
+		px->tx_buf = xfer->tx_buf;
+		px->rx_buf = xfer->rx_buf;
+		px->len = xfer->len;
+		px->speed_hz = xfer->speed_hz;
+		px->bits_per_word = xfer->bits_per_word;
+		px->cs_change = xfer->cs_change;
+		px->tx_dma = spi_geni_sg_dma(&xfer->tx_sg);
+		px->rx_dma = spi_geni_sg_dma(&xfer->rx_sg);
+	}
+
+	prep->num_xfers = n;
+	prep->spi = msg->spi;
+	prep->mode = msg->spi->mode;
+	prep->msg = msg;
+}
+
+/* Is @msg the recorded message, with the same buffers and settings? */
+static bool spi_geni_gsi_prep_match(struct spi_geni_master *mas,
+				    struct spi_message *msg)
+{
+	struct spi_geni_gsi_prep *prep = &mas->gsi_prep;
+	struct spi_geni_gsi_xfer *px;
+	struct spi_transfer *xfer;
+	unsigned int n = 0;
+
+	if (!prep->msg || prep->msg != msg || prep->spi != msg->spi ||
+	    prep->mode != msg->spi->mode)
+		return false;
+
+	list_for_each_entry(xfer, &msg->transfers, transfer_list) {
+		if (n == prep->num_xfers)
+			return false;
+
+		px = &prep->xfer[n++];
+		if (px->tx_buf != xfer->tx_buf || px->rx_buf != xfer->rx_buf ||
+		    px->len != xfer->len || px->speed_hz != xfer->speed_hz ||
+		    px->bits_per_word != xfer->bits_per_word ||
+		    px->cs_change != xfer->cs_change || xfer->delay.value ||
+		    px->tx_dma != spi_geni_sg_dma(&xfer->tx_sg) ||
+		    px->rx_dma != spi_geni_sg_dma(&xfer->rx_sg))
+			return false;
+	}
+
+	return n == prep->num_xfers;
+}
+
+/* Build reusable descriptors for the recorded message @msg, once */
+static int spi_geni_gsi_prep_build(struct spi_controller *spi,
+				   struct spi_message *msg)
+{
+	struct spi_geni_master *mas = spi_controller_get_devdata(spi);
+	struct spi_geni_gsi_prep *prep = &mas->gsi_prep;
+	struct spi_geni_gsi_xfer *px;
+	struct spi_transfer *xfer;
+	unsigned int n = 0;
+	int ret;
+
+	if (prep->built)
+		return 0;
+
+	list_for_each_entry(xfer, &msg->transfers, transfer_list) {
+		px = &prep->xfer[n];
+		ret = prep_gsi_xfer(xfer, mas, msg->spi, spi, true,
+				    &px->tx, &px->rx);
+		if (ret) {
+			prep->num_xfers = n;
+			prep->built = true;
+			spi_geni_gsi_prep_release(mas);
+			return ret;
+		}
+		n++;
+	}
+	prep->built = true;
+
+	px = &prep->xfer[n - 1];
+	px->tx->callback_result = spi_gsi_prep_callback_result;
+	px->tx->callback_param = spi;
+
+	while (n--) {
+		px = &prep->xfer[n];
+		if (px->rx) {
+			px->rx->callback_result = spi_gsi_prep_callback_result;
+			px->rx->callback_param = spi;
+			break;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Send the prepared message again: all its TREs are copied to the rings and
+ * each channel is started with a single doorbell, nothing is computed again
+ * and the caller is woken once.
+ */
+static int spi_geni_gsi_prep_replay(struct spi_controller *spi,
+				    struct spi_message *msg)
+{
+	struct spi_geni_master *mas = spi_controller_get_devdata(spi);
+	struct spi_geni_gsi_prep *prep = &mas->gsi_prep;
+	struct spi_transfer *last;
+	unsigned int i, len = 0;
+	bool rx = false;
+
+	if (spi_geni_is_abort_still_pending(mas))
+		return -EBUSY;
+
+	for (i = 0; i < prep->num_xfers; i++) {
+		rx |= !!prep->xfer[i].rx;
+		len += prep->xfer[i].len;
+	}
+
+	prep->status = 0;
+	atomic_set(&prep->pending, rx ? 2 : 1);
+	reinit_completion(&spi->xfer_completion);
+
+	for (i = 0; i < prep->num_xfers; i++) {
+		if (prep->xfer[i].rx)
+			dmaengine_submit(prep->xfer[i].rx);
+		dmaengine_submit(prep->xfer[i].tx);
+	}
+
+	if (rx)
+		dma_async_issue_pending(mas->rx);
+	dma_async_issue_pending(mas->tx);
+
+	last = list_last_entry(&msg->transfers, struct spi_transfer,
+			       transfer_list);
+	if (!wait_for_completion_timeout(&spi->xfer_completion,
+			msecs_to_jiffies(spi_geni_gsi_timeout_ms(last, len)))) {
+		dev_err(mas->dev, "GPI prepared message timed out\n");
+		return -ETIMEDOUT;
+	}
+	if (READ_ONCE(prep->status))
+		return prep->status;
+
+	msg->actual_length += len;
+	return 0;
+}
+
+/*
+ * In GPI mode the transfers of a message are queued on the DMA channels back
+ * to back, and only the last transfer of a batch signals completion.  A
+ * message of many short transfers, like the RX FIFO reads and tail pointer
+ * increments of a CAN controller, then costs the caller one wakeup rather
+ * than one per transfer.  A transfer with a delay ends its batch, so the
+ * delay is still honoured.
+ *
+ * A message sent again unchanged, as drivers polling a sensor at a high
+ * rate do with the same message and buffers, is replayed from descriptors
+ * built when it was sent the second time in a row.
+ */
+static int spi_geni_gsi_transfer_one_message(struct spi_controller *spi,
+					     struct spi_message *msg)
+{
+	struct spi_geni_master *mas = spi_controller_get_devdata(spi);
+	struct spi_transfer *xfer, *last = NULL;
+	unsigned int n = 0, len = 0;
+	unsigned long time_left;
+	int ret = 0;
+
+	msg->status = 0;
+
+	if (spi_geni_gsi_prep_match(mas, msg) &&
+	    !spi_geni_gsi_prep_build(spi, msg)) {
+		ret = spi_geni_gsi_prep_replay(spi, msg);
+		goto out;
+	}
+	spi_geni_gsi_prep_record(mas, msg);
+
+	list_for_each_entry(xfer, &msg->transfers, transfer_list)
+		if (xfer->len)
+			last = xfer;
+
+	reinit_completion(&spi->xfer_completion);
+
+	list_for_each_entry(xfer, &msg->transfers, transfer_list) {
+		bool notify;
+
+		if (spi_geni_is_abort_still_pending(mas)) {
+			ret = -EBUSY;
+			break;
+		}
+
+		if (!xfer->len)
+			continue;
+
+		notify = xfer == last || xfer->delay.value ||
+			 ++n == GSI_CHAIN_MAX_XFERS;
+		ret = setup_gsi_xfer(xfer, mas, msg->spi, spi, notify);
+		if (ret < 0)
+			break;
+		ret = 0;
+		len += xfer->len;
+
+		if (!notify)
+			continue;
+
+		time_left = wait_for_completion_timeout(&spi->xfer_completion,
+				msecs_to_jiffies(spi_geni_gsi_timeout_ms(xfer, len)));
+		if (!time_left) {
+			dev_err(mas->dev, "GPI transfer chain timed out\n");
+			ret = -ETIMEDOUT;
+			break;
+		}
+		if (msg->status) {
+			ret = msg->status;
+			break;
+		}
+
+		msg->actual_length += len;
+		n = len = 0;
+		reinit_completion(&spi->xfer_completion);
+		spi_transfer_delay_exec(xfer);
+	}
+
+out:
+	if (ret) {
+		spi_geni_handle_err(spi, msg);
+		spi_geni_gsi_prep_release(mas);
+	}
+
+	msg->status = ret;
+	spi_finalize_current_message(spi);
+
+	return ret;
 }
 
 static irqreturn_t geni_spi_isr(int irq, void *data)
@@ -1178,8 +1575,10 @@ static int spi_geni_probe(struct platform_device *pdev)
 	/*
 	 * TX is required per GSI spec, see setup_gsi_xfer().
 	 */
-	if (mas->cur_xfer_mode == GENI_GPI_DMA)
+	if (mas->cur_xfer_mode == GENI_GPI_DMA) {
 		spi->flags = SPI_CONTROLLER_MUST_TX;
+		spi->transfer_one_message = spi_geni_gsi_transfer_one_message;
+	}
 
 	ret = request_irq(mas->irq, geni_spi_isr, 0, dev_name(dev), spi);
 	if (ret)
@@ -0,0 +1,237 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * predictive.c - A step wise thermal governor acting on predicted temperature
+ *
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Throttles like step_wise, one cooling state at a time, but compares the
+ * trip points against the temperature the zone is expected to reach
+ * horizon_ms from now, extrapolated from the rate of change of its recent
+ * samples.  Mitigation thus starts gently while the zone is still heating
+ * up towards a trip, instead of hard once it has overshot it.
+ *
+ * The rate of change is only known for zones that are polled, zones that
+ * are only updated by trip interrupts behave like with step_wise.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/minmax.h>
+#include <linux/module.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/thermal.h>
+
+#include "thermal_core.h"
+
+/* updates closer together than this are the same update for other trips */
+#define PREDICTIVE_MIN_SAMPLE_MS	10
+
+static unsigned int horizon_ms = 1000;
+module_param(horizon_ms, uint, 0644);
+MODULE_PARM_DESC(horizon_ms, "How far ahead to predict the temperature");
+
+/**
+ * struct predictive_data - per thermal zone state of the governor
+ * @temp: temperature of the last sample
+ * @time: time of the last sample, 0 before the first one
+ * @slope: smoothed rate of change of the temperature in mC/s
+ * @predicted: temperature predicted at the last sample
+ * @throttles: number of times a cooling state was raised
+ * @early_throttles: number of those while the zone was below the trip
+ * @releases: number of times a cooling state was lowered
+ * @debugfs: debugfs file of the zone
+ */
+struct predictive_data {
+	int temp;
+	ktime_t time;
+	int slope;
+	int predicted;
+	u64 throttles;
+	u64 early_throttles;
+	u64 releases;
+	struct dentry *debugfs;
+};
+
+static struct dentry *predictive_debugfs;
+
+static void predictive_sample(struct thermal_zone_device *tz,
+			      struct predictive_data *pd)
+{
+	ktime_t now = ktime_get();
+	s64 dt = ktime_ms_delta(now, pd->time);
+	int slope;
+
+	if (pd->time && dt < PREDICTIVE_MIN_SAMPLE_MS)
+		return;
+
+	if (pd->time) {
+		slope = div_s64((s64)(tz->temperature - pd->temp) * MSEC_PER_SEC,
+				dt);
+		/* smooth out the quantization of the sensor readings */
+		pd->slope = (3 * pd->slope + slope) / 4;
+	}
+	pd->temp = tz->temperature;
+	pd->time = now;
+
+	pd->predicted = tz->temperature;
+	if (pd->slope > 0)
+		pd->predicted += (int)div_s64((s64)pd->slope * horizon_ms,
+					      MSEC_PER_SEC);
+}
+
+static unsigned long get_target_state(struct thermal_instance *instance,
+				      int slope, bool throttle)
+{
+	struct thermal_cooling_device *cdev = instance->cdev;
+	unsigned long cur_state;
+	unsigned long next_target;
+
+	cdev->ops->get_cur_state(cdev, &cur_state);
+	next_target = instance->target;
+
+	if (!instance->initialized) {
+		if (throttle)
+			return clamp(cur_state + 1, instance->lower,
+				     instance->upper);
+		return THERMAL_NO_TARGET;
+	}
+
+	if (throttle) {
+		if (slope > 0)
+			next_target = clamp(cur_state + 1, instance->lower,
+					    instance->upper);
+	} else if (slope <= 0) {
+		if (cur_state <= instance->lower)
+			next_target = THERMAL_NO_TARGET;
+		else
+			next_target = clamp(cur_state - 1, instance->lower,
+					    instance->upper);
+	}
+
+	return next_target;
+}
+
+static void predictive_trip_update(struct thermal_zone_device *tz,
+				   struct predictive_data *pd, int trip_id)
+{
+	const struct thermal_trip *trip = &tz->trips[trip_id];
+	struct thermal_instance *instance;
+	unsigned long old_target;
+	bool throttle;
+
+	throttle = tz->temperature >= trip->temperature ||
+		   pd->predicted >= trip->temperature;
+
+	list_for_each_entry(instance, &tz->thermal_instances, tz_node) {
+		if (instance->trip != trip)
+			continue;
+
+		old_target = instance->target;
+		instance->target = get_target_state(instance, pd->slope,
+						    throttle);
+		if (instance->initialized && old_target == instance->target)
+			continue;
+
+		if (instance->target != THERMAL_NO_TARGET &&
+		    (old_target == THERMAL_NO_TARGET ||
+		     instance->target > old_target)) {
+			pd->throttles++;
+			if (tz->temperature < trip->temperature)
+				pd->early_throttles++;
+		} else if (old_target != THERMAL_NO_TARGET) {
+			pd->releases++;
+		}
+
+		if (trip->type == THERMAL_TRIP_PASSIVE) {
+			if (old_target == THERMAL_NO_TARGET &&
+			    instance->target != THERMAL_NO_TARGET)
+				tz->passive++;
+			else if (old_target != THERMAL_NO_TARGET &&
+				 instance->target == THERMAL_NO_TARGET)
+				tz->passive--;
+		}
+
+		instance->initialized = true;
+		mutex_lock(&instance->cdev->lock);
+		instance->cdev->updated = false; /* cdev needs update */
+		mutex_unlock(&instance->cdev->lock);
+	}
+}
+
+/**
+ * predictive_throttle - throttles devices associated with the given zone
+ * @tz: thermal_zone_device
+ * @trip: trip point index
+ *
+ * Raises the cooling state of the devices of @trip by one step as long as
+ * the zone is heating up and its temperature, or the one predicted for
+ * horizon_ms from now, is at or above the trip, and lowers it one step at a
+ * time once both are below it and the zone is no longer heating up.
+ */
+static int predictive_throttle(struct thermal_zone_device *tz, int trip)
+{
+	struct predictive_data *pd = tz->governor_data;
+	struct thermal_instance *instance;
+
+	lockdep_assert_held(&tz->lock);
+
+	predictive_sample(tz, pd);
+	predictive_trip_update(tz, pd, trip);
+
+	list_for_each_entry(instance, &tz->thermal_instances, tz_node)
+		thermal_cdev_update(instance->cdev);
+
+	return 0;
+}
+
+static int predictive_stats_show(struct seq_file *s, void *unused)
+{
+	struct predictive_data *pd = s->private;
+
+	seq_printf(s, "slope_mC_per_s: %d\n", READ_ONCE(pd->slope));
+	seq_printf(s, "predicted_mC: %d\n", READ_ONCE(pd->predicted));
+	seq_printf(s, "throttles: %llu\n", READ_ONCE(pd->throttles));
+	seq_printf(s, "early_throttles: %llu\n", READ_ONCE(pd->early_throttles));
+	seq_printf(s, "releases: %llu\n", READ_ONCE(pd->releases));
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(predictive_stats);
+
+static int predictive_bind(struct thermal_zone_device *tz)
+{
+	struct predictive_data *pd;
+
+	pd = kzalloc(sizeof(*pd), GFP_KERNEL);
+	if (!pd)
+		return -ENOMEM;
+
+	/* thermal_governor_lock serializes binding */
+	if (!predictive_debugfs)
+		predictive_debugfs = debugfs_create_dir("thermal_predictive",
+							NULL);
+	pd->debugfs = debugfs_create_file(dev_name(&tz->device), 0444,
+					  predictive_debugfs, pd,
+					  &predictive_stats_fops);
+
+	tz->governor_data = pd;
+	return 0;
+}
+
+static void predictive_unbind(struct thermal_zone_device *tz)
+{
+	struct predictive_data *pd = tz->governor_data;
+
+	debugfs_remove(pd->debugfs);
+	kfree(pd);
+	tz->governor_data = NULL;
+}
+
+static struct thermal_governor thermal_gov_predictive = {
+	.name		= "predictive",
+	.bind_to_tz	= predictive_bind,
+	.unbind_from_tz	= predictive_unbind,
+	.throttle	= predictive_throttle,
+};
+THERMAL_GOVERNOR_DECLARE(thermal_gov_predictive);
@@ -10,6 +10,7 @@
 #include <linux/io.h>
 #include <linux/iopoll.h>
 #include <linux/irq.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/pm_opp.h>
@@ -116,6 +117,12 @@ void serial_trace_log(struct device *dev, const char *fmt, ...)
 #define BYTES_PER_FIFO_WORD		4U
 
 #define DMA_RX_BUF_SIZE		4096
+/* RX DMA buffers the port cycles through, the next is armed before the last is pushed */
+#define DMA_RX_BUFS		2
+
+static unsigned int rx_stale_chars = STALE_TIMEOUT;
+module_param(rx_stale_chars, uint, 0644);
+MODULE_PARM_DESC(rx_stale_chars, "Idle characters ending an RX DMA buffer early");
 
 struct qcom_geni_device_data {
 	bool console;
@@ -146,6 +153,13 @@ struct qcom_geni_serial_port {
 	unsigned int baud;
 	unsigned long clk_rate;
 	void *rx_buf;
+	void *rx_dma_buf;
+	unsigned int rx_dma_idx;
+	ktime_t rx_dma_armed;
+	u64 rx_dma_bufs;
+	u64 rx_dropped;
+	u32 rx_latency_us;
+	u32 rx_latency_max_us;
 	u32 loopback;
 	bool brk;
 
@@ -668,22 +682,24 @@ static void handle_rx_console(struct uart_port *uport, u32 bytes, bool drop)
 }
 #endif /* CONFIG_SERIAL_QCOM_GENI_CONSOLE */
 
-static void handle_rx_uart(struct uart_port *uport, u32 bytes, bool drop)
+static void handle_rx_uart(struct uart_port *uport, const u8 *buf, u32 bytes,
+			   bool drop)
 {
 	struct qcom_geni_serial_port *port = to_dev_port(uport);
 	struct tty_port *tport = &uport->state->port;
 	int ret;
 
-	ret = tty_insert_flip_string(tport, port->rx_buf, bytes);
+	ret = tty_insert_flip_string(tport, buf, bytes);
 	if (ret != bytes) {
-		dev_err(uport->dev, "%s:Unable to push data ret %d_bytes %d\n",
-				__func__, ret, bytes);
-		WARN_ON_ONCE(1);
+		dev_err_ratelimited(uport->dev, "%s:Unable to push data ret %d_bytes %d\n",
+				    __func__, ret, bytes);
+		port->rx_dropped += bytes - ret;
+		uport->icount.buf_overrun++;
 	}
 	uport->icount.rx += ret;
 	tty_flip_buffer_push(tport);
 
-	trace_serial_transmit_data_rx(uport->dev, port->rx_buf, bytes);
+	trace_serial_transmit_data_rx(uport->dev, buf, bytes);
 }
 
 static unsigned int qcom_geni_serial_tx_empty(struct uart_port *uport)
@@ -896,31 +912,54 @@ static void qcom_geni_serial_stop_rx_dma(struct uart_port *uport)
 	trace_serial_info(uport->dev, __func__, "Done");
 }
 
-static void qcom_geni_serial_start_rx_dma(struct uart_port *uport)
+static void *qcom_geni_serial_rx_dma_buf(struct qcom_geni_serial_port *port)
+{
+	return port->rx_dma_buf + port->rx_dma_idx * DMA_RX_BUF_SIZE;
+}
+
+static int qcom_geni_serial_arm_rx_dma(struct uart_port *uport)
 {
 	struct qcom_geni_serial_port *port = to_dev_port(uport);
 	int ret;
 
-	trace_serial_info(uport->dev, __func__, "start");
-	if (qcom_geni_serial_secondary_active(uport))
-		qcom_geni_serial_stop_rx_dma(uport);
-
-	geni_se_setup_s_cmd(&port->se, UART_START_READ, UART_PARAM_RFR_OPEN);
-
-	ret = geni_se_rx_dma_prep(&port->se, port->rx_buf,
+	ret = geni_se_rx_dma_prep(&port->se, qcom_geni_serial_rx_dma_buf(port),
 				  DMA_RX_BUF_SIZE,
 				  &port->rx_dma_addr);
 	if (ret) {
 		dev_err(uport->dev, "unable to start RX SE DMA: %d\n", ret);
 		qcom_geni_serial_stop_rx_dma(uport);
+		return ret;
 	}
+	port->rx_dma_armed = ktime_get();
+
+	return 0;
+}
+
+static void qcom_geni_serial_start_rx_dma(struct uart_port *uport)
+{
+	struct qcom_geni_serial_port *port = to_dev_port(uport);
+
+	trace_serial_info(uport->dev, __func__, "start");
+	if (qcom_geni_serial_secondary_active(uport))
+		qcom_geni_serial_stop_rx_dma(uport);
+
+	geni_se_setup_s_cmd(&port->se, UART_START_READ, UART_PARAM_RFR_OPEN);
+
+	qcom_geni_serial_arm_rx_dma(uport);
 }
 
+/*
+ * Called when a buffer is full, or on RX_EOT once the line has been idle
+ * for rx_stale_chars characters.  The next buffer is armed before the data
+ * is pushed to the tty layer, so that the RX FIFO only has to hold what
+ * arrives while the DMA is re-programmed.
+ */
 static void qcom_geni_serial_handle_rx_dma(struct uart_port *uport, bool drop)
 {
 	struct qcom_geni_serial_port *port = to_dev_port(uport);
-	u32 rx_in;
-	int ret;
+	ktime_t armed = port->rx_dma_armed;
+	u32 rx_in, latency;
+	u8 *buf;
 
 	if (!qcom_geni_serial_secondary_active(uport))
 		return;
@@ -932,21 +971,24 @@ static void qcom_geni_serial_handle_rx_dma(struct uart_port *uport, bool drop)
 	port->rx_dma_addr = 0;
 
 	rx_in = readl(uport->membase + SE_DMA_RX_LEN_IN);
+	buf = qcom_geni_serial_rx_dma_buf(port);
+	port->rx_dma_idx = (port->rx_dma_idx + 1) % DMA_RX_BUFS;
+	if (qcom_geni_serial_arm_rx_dma(uport))
+		return;
+
 	if (!rx_in) {
 		dev_warn(uport->dev, "serial engine reports 0 RX bytes in!\n");
 		return;
 	}
 
 	if (!drop)
-		handle_rx_uart(uport, rx_in, drop);
+		handle_rx_uart(uport, buf, rx_in, drop);
 
-	ret = geni_se_rx_dma_prep(&port->se, port->rx_buf,
-				  DMA_RX_BUF_SIZE,
-				  &port->rx_dma_addr);
-	if (ret) {
-		dev_err(uport->dev, "unable to start RX SE DMA: %d\n", ret);
-		qcom_geni_serial_stop_rx_dma(uport);
-	}
+	/* time the oldest byte of the buffer may have waited for the tty */
+	latency = min_t(s64, ktime_us_delta(ktime_get(), armed), U32_MAX);
+	port->rx_latency_us = latency;
+	port->rx_latency_max_us = max(port->rx_latency_max_us, latency);
+	port->rx_dma_bufs++;
 }
 
 static void qcom_geni_serial_start_rx(struct uart_port *uport)
@@ -1210,7 +1252,7 @@ static void qcom_geni_serial_shutdown(struct uart_port *uport)
 static int qcom_geni_serial_port_setup(struct uart_port *uport)
 {
 	struct qcom_geni_serial_port *port = to_dev_port(uport);
-	u32 rxstale = DEFAULT_BITS_PER_CHAR * STALE_TIMEOUT;
+	u32 rxstale = DEFAULT_BITS_PER_CHAR * READ_ONCE(rx_stale_chars);
 	u32 proto;
 	u32 pin_swap;
 	int ret;
@@ -1696,6 +1738,83 @@ static const struct uart_ops qcom_geni_uart_pops = {
 	.pm = qcom_geni_serial_pm,
 };
 
+static struct qcom_geni_serial_port *qcom_geni_serial_tty_port(struct device *dev)
+{
+	struct tty_port *tport = dev_get_drvdata(dev);
+	struct uart_state *state = container_of(tport, struct uart_state, port);
+
+	return to_dev_port(state->uart_port);
+}
+
+static ssize_t rx_dma_buffers_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct qcom_geni_serial_port *port = qcom_geni_serial_tty_port(dev);
+
+	return sysfs_emit(buf, "%llu\n", READ_ONCE(port->rx_dma_bufs));
+}
+static DEVICE_ATTR_RO(rx_dma_buffers);
+
+static ssize_t rx_dropped_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct qcom_geni_serial_port *port = qcom_geni_serial_tty_port(dev);
+
+	return sysfs_emit(buf, "%llu\n", READ_ONCE(port->rx_dropped));
+}
+static DEVICE_ATTR_RO(rx_dropped);
+
+static ssize_t rx_overruns_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct qcom_geni_serial_port *port = qcom_geni_serial_tty_port(dev);
+
+	return sysfs_emit(buf, "%u\n", READ_ONCE(port->uport.icount.overrun));
+}
+static DEVICE_ATTR_RO(rx_overruns);
+
+static ssize_t rx_latency_us_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	struct qcom_geni_serial_port *port = qcom_geni_serial_tty_port(dev);
+
+	return sysfs_emit(buf, "%u\n", READ_ONCE(port->rx_latency_us));
+}
+static DEVICE_ATTR_RO(rx_latency_us);
+
+static ssize_t rx_latency_max_us_show(struct device *dev,
+				      struct device_attribute *attr, char *buf)
+{
+	struct qcom_geni_serial_port *port = qcom_geni_serial_tty_port(dev);
+
+	return sysfs_emit(buf, "%u\n", READ_ONCE(port->rx_latency_max_us));
+}
+
+/* any write resets the maximum */
+static ssize_t rx_latency_max_us_store(struct device *dev,
+				       struct device_attribute *attr,
+				       const char *buf, size_t count)
+{
+	struct qcom_geni_serial_port *port = qcom_geni_serial_tty_port(dev);
+
+	WRITE_ONCE(port->rx_latency_max_us, 0);
+	return count;
+}
+static DEVICE_ATTR_RW(rx_latency_max_us);
+
+static struct attribute *qcom_geni_serial_attrs[] = {
+	&dev_attr_rx_dma_buffers.attr,
+	&dev_attr_rx_dropped.attr,
+	&dev_attr_rx_overruns.attr,
+	&dev_attr_rx_latency_us.attr,
+	&dev_attr_rx_latency_max_us.attr,
+	NULL
+};
+
+static struct attribute_group qcom_geni_serial_attr_group = {
+	.attrs = qcom_geni_serial_attrs,
+};
+
 static int qcom_geni_serial_probe(struct platform_device *pdev)
 {
 	int ret = 0;
@@ -1757,10 +1876,11 @@ static int qcom_geni_serial_probe(struct platform_device *pdev)
 	port->tx_fifo_width = DEF_FIFO_WIDTH_BITS;
 
 	if (!data->console) {
-		port->rx_buf = devm_kzalloc(uport->dev,
-					    DMA_RX_BUF_SIZE, GFP_KERNEL);
-		if (!port->rx_buf)
+		port->rx_dma_buf = devm_kcalloc(uport->dev, DMA_RX_BUFS,
+						DMA_RX_BUF_SIZE, GFP_KERNEL);
+		if (!port->rx_dma_buf)
 			return -ENOMEM;
+		uport->attr_group = &qcom_geni_serial_attr_group;
 	}
 
 	ret = geni_icc_get(&port->se, NULL);
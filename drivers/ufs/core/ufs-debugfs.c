@@ -57,6 +57,31 @@ static int ufs_debugfs_stats_show(struct seq_file *s, void *data)
 }
 DEFINE_SHOW_ATTRIBUTE(ufs_debugfs_stats);
 
+#ifdef CONFIG_SCSI_UFS_CRYPTO
+static int ufs_debugfs_crypto_stats_show(struct seq_file *s, void *data)
+{
+	struct ufs_hba *hba = hba_from_file(s->file);
+	struct ufs_crypto_stats *st = &hba->crypto_stats;
+	s64 reqs = atomic64_read(&st->reqs);
+	s64 programs = atomic64_read(&st->programs);
+
+	seq_printf(s, "Keyslots: %u\n", hba->crypto_profile.num_slots);
+	seq_printf(s, "Requests with a keyslot: %lld\n", reqs);
+	seq_printf(s, "Keyslot hits: %lld\n", max(reqs - programs, 0LL));
+	seq_printf(s, "Keyslot programs: %lld\n", programs);
+	seq_printf(s, "Keyslot evictions: %lld\n",
+		   (s64)atomic64_read(&st->evictions));
+	seq_printf(s, "Keyslot errors: %lld\n", (s64)atomic64_read(&st->errors));
+	seq_printf(s, "Program time avg (us): %lld\n", programs ?
+		   div64_s64(atomic64_read(&st->program_time_ns), programs) /
+		   NSEC_PER_USEC : 0);
+	seq_printf(s, "Program time max (us): %lld\n",
+		   (s64)atomic64_read(&st->program_time_max_ns) / NSEC_PER_USEC);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(ufs_debugfs_crypto_stats);
+#endif
+
 static int ee_usr_mask_get(void *data, u64 *val)
 {
 	struct ufs_hba *hba = data;
@@ -204,6 +229,9 @@ static const struct file_operations ufs_saved_err_fops = {
 
 static const struct ufs_debugfs_attr ufs_attrs[] = {
 	{ "stats", 0400, &ufs_debugfs_stats_fops },
+#ifdef CONFIG_SCSI_UFS_CRYPTO
+	{ "crypto_stats", 0400, &ufs_debugfs_crypto_stats_fops },
+#endif
 	{ "saved_err", 0600, &ufs_saved_err_fops },
 	{ "saved_uic_err", 0600, &ufs_saved_err_fops },
 	{ }
@@ -59,9 +59,12 @@ static int ufshcd_crypto_keyslot_program(struct blk_crypto_profile *profile,
 	const struct ufs_crypto_alg_entry *alg =
 			&ufs_crypto_algs[key->crypto_cfg.crypto_mode];
 	u8 data_unit_mask = key->crypto_cfg.data_unit_size / 512;
+	struct ufs_crypto_stats *stats = &hba->crypto_stats;
 	int i;
 	int cap_idx = -1;
 	union ufs_crypto_cfg_entry cfg = {};
+	ktime_t start;
+	s64 time_ns;
 	int err;
 
 	BUILD_BUG_ON(UFS_CRYPTO_KEY_SIZE_INVALID != 0);
@@ -92,10 +95,27 @@ static int ufshcd_crypto_keyslot_program(struct blk_crypto_profile *profile,
 		}
 	}
 
+	/*
+	 * The time includes ungating the clocks and, with a vendor
+	 * program_key(), the call into the secure world.
+	 */
+	start = ktime_get();
 	err = ufshcd_program_key(hba, key, &cfg, slot);
+	time_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
 
 	memzero_explicit(&cfg, sizeof(cfg));
-	return err;
+
+	if (err) {
+		atomic64_inc(&stats->errors);
+		return err;
+	}
+
+	atomic64_inc(&stats->programs);
+	atomic64_add(time_ns, &stats->program_time_ns);
+	/* Keyslot programming is serialized by the crypto profile */
+	if (time_ns > atomic64_read(&stats->program_time_max_ns))
+		atomic64_set(&stats->program_time_max_ns, time_ns);
+	return 0;
 }
 
 static int ufshcd_clear_keyslot(struct ufs_hba *hba, int slot)
@@ -115,8 +135,14 @@ static int ufshcd_crypto_keyslot_evict(struct blk_crypto_profile *profile,
 {
 	struct ufs_hba *hba =
 		container_of(profile, struct ufs_hba, crypto_profile);
+	int err;
 
-	return ufshcd_clear_keyslot(hba, slot);
+	err = ufshcd_clear_keyslot(hba, slot);
+	if (err)
+		atomic64_inc(&hba->crypto_stats.errors);
+	else
+		atomic64_inc(&hba->crypto_stats.evictions);
+	return err;
 }
 
 bool ufshcd_crypto_enable(struct ufs_hba *hba)
@@ -2295,15 +2295,34 @@ static void ufshcd_update_monitor(struct ufs_hba *hba, const struct ufshcd_lrb *
 	spin_unlock_irqrestore(hba->host->host_lock, flags);
 }
 
+/*
+ * Ring the legacy doorbell for all requests prepared since it was last rung,
+ * with a single register write.
+ */
+static void ufshcd_ring_doorbell(struct ufs_hba *hba)
+	__must_hold(&hba->outstanding_lock)
+{
+	unsigned long tags = hba->pending_doorbell;
+
+	if (!tags)
+		return;
+
+	hba->pending_doorbell = 0;
+	hba->outstanding_reqs |= tags;
+	ufshcd_writel(hba, tags, REG_UTP_TRANSFER_REQ_DOOR_BELL);
+}
+
 /**
  * ufshcd_send_command - Send SCSI or device management commands
  * @hba: per adapter instance
  * @task_tag: Task tag of the command
  * @hwq: pointer to hardware queue instance
+ * @ring: ring the doorbell now; false defers it to the next call that does,
+ *	or to ufshcd_commit_rqs(). Only used with the legacy doorbell.
  */
 static inline
 void ufshcd_send_command(struct ufs_hba *hba, unsigned int task_tag,
-			 struct ufs_hw_queue *hwq)
+			 struct ufs_hw_queue *hwq, bool ring)
 {
 	struct ufshcd_lrb *lrbp = &hba->lrb[task_tag];
 	unsigned long flags;
@@ -2332,13 +2351,30 @@ void ufshcd_send_command(struct ufs_hba *hba, unsigned int task_tag,
 		if (hba->vops && hba->vops->setup_xfer_req)
 			hba->vops->setup_xfer_req(hba, lrbp->task_tag,
 						  !!lrbp->cmd);
-		__set_bit(lrbp->task_tag, &hba->outstanding_reqs);
-		ufshcd_writel(hba, 1 << lrbp->task_tag,
-			      REG_UTP_TRANSFER_REQ_DOOR_BELL);
+		/*
+		 * A tag only joins outstanding_reqs once its doorbell bit is
+		 * set, or completion handling would take it as already done.
+		 */
+		__set_bit(lrbp->task_tag, &hba->pending_doorbell);
+		if (ring)
+			ufshcd_ring_doorbell(hba);
 		spin_unlock_irqrestore(&hba->outstanding_lock, flags);
 	}
 }
 
+static void ufshcd_commit_rqs(struct Scsi_Host *host, u16 hwq)
+{
+	struct ufs_hba *hba = shost_priv(host);
+	unsigned long flags;
+
+	if (is_mcq_enabled(hba))
+		return;
+
+	spin_lock_irqsave(&hba->outstanding_lock, flags);
+	ufshcd_ring_doorbell(hba);
+	spin_unlock_irqrestore(&hba->outstanding_lock, flags);
+}
+
 /**
  * ufshcd_copy_sense_data - Copy sense data in case of check condition
  * @lrbp: pointer to local reference block
@@ -2967,6 +3003,38 @@ static void ufshcd_init_lrb(struct ufs_hba *hba, struct ufshcd_lrb *lrb, int i)
 	lrb->ucd_prdt_dma_addr = cmd_desc_element_addr + prdt_offset;
 }
 
+/*
+ * Interrupt aggregation counter threshold. Adaptive aggregation uses a lower
+ * one, so that moderately deep queues already reach it.
+ */
+static u8 ufshcd_intr_aggr_cnt(struct ufs_hba *hba)
+{
+	if (hba->caps & UFSHCD_CAP_INTR_AGGR_ADAPTIVE)
+		return hba->nutrs / 4;
+
+	return hba->nutrs - 1;
+}
+
+/*
+ * Whether a SCSI command should interrupt on completion by itself rather
+ * than wait for the aggregation counter or timeout.
+ */
+static bool ufshcd_need_intr_cmd(struct ufs_hba *hba)
+{
+	if (!ufshcd_is_intr_aggr_allowed(hba))
+		return true;
+
+	if (!(hba->caps & UFSHCD_CAP_INTR_AGGR_ADAPTIVE))
+		return false;
+
+	/* Aggregation only applies to the legacy doorbell */
+	if (is_mcq_enabled(hba))
+		return true;
+
+	return hweight_long(READ_ONCE(hba->outstanding_reqs)) <
+		ufshcd_intr_aggr_cnt(hba);
+}
+
 /**
  * ufshcd_queuecommand - main entry point for SCSI requests
  * @host: SCSI host pointer
@@ -3035,9 +3103,9 @@ static int ufshcd_queuecommand(struct Scsi_Host *host, struct scsi_cmnd *cmd)
 	lrbp->cmd = cmd;
 	lrbp->task_tag = tag;
 	lrbp->lun = ufshcd_scsi_to_upiu_lun(cmd->device->lun);
-	lrbp->intr_cmd = !ufshcd_is_intr_aggr_allowed(hba);
+	lrbp->intr_cmd = ufshcd_need_intr_cmd(hba);
 
-	ufshcd_prepare_lrbp_crypto(scsi_cmd_to_rq(cmd), lrbp);
+	ufshcd_prepare_lrbp_crypto(hba, scsi_cmd_to_rq(cmd), lrbp);
 
 	lrbp->req_abort_skip = false;
 
@@ -3052,9 +3120,18 @@ static int ufshcd_queuecommand(struct Scsi_Host *host, struct scsi_cmnd *cmd)
 	if (is_mcq_enabled(hba))
 		hwq = ufshcd_mcq_req_to_hwq(hba, scsi_cmd_to_rq(cmd));
 
-	ufshcd_send_command(hba, tag, hwq);
+	/* Ring once for a whole batch of requests from the block layer */
+	ufshcd_send_command(hba, tag, hwq, cmd->flags & SCMD_LAST);
 
 out:
+	/*
+	 * The block layer doesn't call ->commit_rqs() after a last request
+	 * that was accepted, even if it was completed right away without
+	 * being sent.
+	 */
+	if (cmd->flags & SCMD_LAST)
+		ufshcd_commit_rqs(host, 0);
+
 	if (ufs_trigger_eh()) {
 		unsigned long flags;
 
@@ -3073,7 +3150,7 @@ static int ufshcd_compose_dev_cmd(struct ufs_hba *hba,
 	lrbp->task_tag = tag;
 	lrbp->lun = 0; /* device management cmd is not specific to any LUN */
 	lrbp->intr_cmd = true; /* No interrupt aggregation */
-	ufshcd_prepare_lrbp_crypto(NULL, lrbp);
+	ufshcd_prepare_lrbp_crypto(hba, NULL, lrbp);
 	hba->dev_cmd.type = cmd_type;
 
 	return ufshcd_compose_devman_upiu(hba, lrbp);
@@ -3315,7 +3392,7 @@ static int ufshcd_exec_dev_cmd(struct ufs_hba *hba,
 
 	ufshcd_add_query_upiu_trace(hba, UFS_QUERY_SEND, lrbp->ucd_req_ptr);
 
-	ufshcd_send_command(hba, tag, hba->dev_cmd_queue);
+	ufshcd_send_command(hba, tag, hba->dev_cmd_queue, true);
 	err = ufshcd_wait_for_dev_cmd(hba, lrbp, timeout);
 	ufshcd_add_query_upiu_trace(hba, err ? UFS_QUERY_ERR : UFS_QUERY_COMP,
 				    (struct utp_upiu_req *)lrbp->ucd_rsp_ptr);
@@ -4775,7 +4852,8 @@ int ufshcd_make_hba_operational(struct ufs_hba *hba)
 
 	/* Configure interrupt aggregation */
 	if (ufshcd_is_intr_aggr_allowed(hba))
-		ufshcd_config_intr_aggr(hba, hba->nutrs - 1, INT_AGGR_DEF_TO);
+		ufshcd_config_intr_aggr(hba, ufshcd_intr_aggr_cnt(hba),
+					INT_AGGR_DEF_TO);
 	else
 		ufshcd_disable_intr_aggr(hba);
 
@@ -7244,7 +7322,7 @@ static int ufshcd_issue_devman_upiu_cmd(struct ufs_hba *hba,
 	lrbp->task_tag = tag;
 	lrbp->lun = 0;
 	lrbp->intr_cmd = true;
-	ufshcd_prepare_lrbp_crypto(NULL, lrbp);
+	ufshcd_prepare_lrbp_crypto(hba, NULL, lrbp);
 	hba->dev_cmd.type = cmd_type;
 
 	if (hba->ufs_version <= ufshci_version(1, 1))
@@ -7274,7 +7352,7 @@ static int ufshcd_issue_devman_upiu_cmd(struct ufs_hba *hba,
 
 	ufshcd_add_query_upiu_trace(hba, UFS_QUERY_SEND, lrbp->ucd_req_ptr);
 
-	ufshcd_send_command(hba, tag, hba->dev_cmd_queue);
+	ufshcd_send_command(hba, tag, hba->dev_cmd_queue, true);
 	/*
 	 * ignore the returning value here - ufshcd_check_query_response is
 	 * bound to fail since dev_cmd.query and dev_cmd.type were left empty.
@@ -7418,7 +7496,7 @@ int ufshcd_advanced_rpmb_req_handler(struct ufs_hba *hba, struct utp_upiu_req *r
 	lrbp->lun = UFS_UPIU_RPMB_WLUN;
 
 	lrbp->intr_cmd = true;
-	ufshcd_prepare_lrbp_crypto(NULL, lrbp);
+	ufshcd_prepare_lrbp_crypto(hba, NULL, lrbp);
 	hba->dev_cmd.type = DEV_CMD_TYPE_RPMB;
 
 	/* Advanced RPMB starts from UFS 4.0, so its command type is UTP_CMD_TYPE_UFS_STORAGE */
@@ -7449,7 +7527,7 @@ int ufshcd_advanced_rpmb_req_handler(struct ufs_hba *hba, struct utp_upiu_req *r
 
 	hba->dev_cmd.complete = &wait;
 
-	ufshcd_send_command(hba, tag, hba->dev_cmd_queue);
+	ufshcd_send_command(hba, tag, hba->dev_cmd_queue, true);
 
 	err = ufshcd_wait_for_dev_cmd(hba, lrbp, ADVANCED_RPMB_REQ_TIMEOUT);
 
@@ -9029,6 +9107,7 @@ static const struct scsi_host_template ufshcd_driver_template = {
 	.proc_name		= UFSHCD,
 	.map_queues		= ufshcd_map_queues,
 	.queuecommand		= ufshcd_queuecommand,
+	.commit_rqs		= ufshcd_commit_rqs,
 	.mq_poll		= ufshcd_poll,
 	.slave_alloc		= ufshcd_slave_alloc,
 	.slave_configure	= ufshcd_slave_configure,
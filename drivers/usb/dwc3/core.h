@@ -725,6 +725,9 @@ struct dwc3_event_buffer {
  *		isochronous START TRANSFER command failure workaround
  * @start_cmd_status: the status of testing START TRANSFER command with
  *		combo_num = 'b00
+ * @ioc_interval: on bulk IN, interrupt on completion of every Nth request
+ *		only. 0 or 1 interrupts for every request.
+ * @ioc_count: requests prepared since the last one that interrupts
  */
 struct dwc3_ep {
 	struct usb_ep		endpoint;
@@ -784,6 +787,9 @@ struct dwc3_ep {
 	/* For isochronous START TRANSFER workaround only */
 	u8			combo_num;
 	int			start_cmd_status;
+
+	u32			ioc_interval;
+	u32			ioc_count;
 };
 
 enum dwc3_phy {
@@ -937,6 +943,7 @@ struct dwc3_hwparams {
  *	or unaligned OUT)
  * @direction: IN or OUT direction flag
  * @mapped: true when request has been dma-mapped
+ * @no_interrupt: true when the request doesn't interrupt on completion
  */
 struct dwc3_request {
 	struct usb_request	request;
@@ -967,6 +974,7 @@ struct dwc3_request {
 	unsigned int		needs_extra_trb:1;
 	unsigned int		direction:1;
 	unsigned int		mapped:1;
+	unsigned int		no_interrupt:1;
 };
 
 /*
@@ -998,6 +998,8 @@ void dwc3_debugfs_create_endpoint_dir(struct dwc3_ep *dep)
 
 		debugfs_create_file(name, 0444, dir, dep, fops);
 	}
+
+	debugfs_create_u32("ioc_interval", 0644, dir, &dep->ioc_interval);
 }
 
 void dwc3_debugfs_remove_endpoint_dir(struct dwc3_ep *dep)
@@ -893,6 +893,7 @@ static int __dwc3_gadget_ep_enable(struct dwc3_ep *dep, unsigned int action)
 
 		dep->type = usb_endpoint_type(desc);
 		dep->flags |= DWC3_EP_ENABLED;
+		dep->ioc_count = 0;
 
 		reg = dwc3_readl(dwc->regs, DWC3_DALEPENA);
 		reg |= DWC3_DALEPENA_EP(dep->number);
@@ -1230,7 +1231,7 @@ static void dwc3_prepare_one_trb(struct dwc3_ep *dep,
 	dma_addr_t		dma;
 	unsigned int		stream_id = req->request.stream_id;
 	unsigned int		short_not_ok = req->request.short_not_ok;
-	unsigned int		no_interrupt = req->request.no_interrupt;
+	unsigned int		no_interrupt = req->no_interrupt;
 	unsigned int		is_last = req->request.is_last;
 	struct dwc3		*dwc = dep->dwc;
 	struct usb_gadget	*gadget = dwc->gadget;
@@ -1481,7 +1482,7 @@ static int dwc3_prepare_trbs_sg(struct dwc3_ep *dep,
 
 				/* Check if previous requests already set IOC */
 				list_for_each_entry(r, &dep->started_list, list) {
-					if (r != req && !r->request.no_interrupt)
+					if (r != req && !r->no_interrupt)
 						break;
 
 					if (r == req)
@@ -1529,6 +1530,45 @@ static int dwc3_prepare_trbs_linear(struct dwc3_ep *dep,
 	return dwc3_prepare_last_sg(dep, req, req->request.length, 0);
 }
 
+/**
+ * dwc3_gadget_ep_no_interrupt - decide whether a request interrupts
+ * @dep: The endpoint that the request belongs to
+ * @req: The request about to be prepared
+ *
+ * Besides the requests the function driver asked not to interrupt, a bulk IN
+ * endpoint with an @ioc_interval only interrupts on every Nth request. The
+ * ones in between are given back when the next interrupting request
+ * completes, so one must follow in the same kick: the last pending request
+ * always interrupts, and so does one that could leave too few TRBs to start
+ * preparing the next.
+ *
+ * Return true if the request must not set IOC.
+ */
+static bool dwc3_gadget_ep_no_interrupt(struct dwc3_ep *dep,
+		struct dwc3_request *req)
+{
+	u32 interval = READ_ONCE(dep->ioc_interval);
+
+	if (req->request.no_interrupt)
+		return true;
+
+	if (interval < 2 || !dep->direction || dep->stream_capable ||
+	    !usb_endpoint_xfer_bulk(dep->endpoint.desc))
+		return false;
+
+	/* This request's TRBs, a possible ZLP, and room for the next one */
+	if (list_is_last(&req->list, &dep->pending_list) ||
+	    dwc3_calc_trbs_left(dep) < max(req->num_pending_sgs, 1U) + 4)
+		goto interrupt;
+
+	if (++dep->ioc_count < interval)
+		return true;
+
+interrupt:
+	dep->ioc_count = 0;
+	return false;
+}
+
 /*
  * dwc3_prepare_trbs - setup TRBs from requests
  * @dep: endpoint for which requests are being prepared
@@ -1588,6 +1628,7 @@ static int dwc3_prepare_trbs(struct dwc3_ep *dep)
 		req->start_sg		= req->sg;
 		req->num_queued_sgs	= 0;
 		req->num_pending_sgs	= req->request.num_mapped_sgs;
+		req->no_interrupt	= dwc3_gadget_ep_no_interrupt(dep, req);
 
 		if (req->num_pending_sgs > 0) {
 			ret = dwc3_prepare_trbs_sg(dep, req);
@@ -3496,7 +3537,7 @@ static int dwc3_gadget_ep_cleanup_completed_request(struct dwc3_ep *dep,
 	 * needs to check and return the status of the completed TRBs associated
 	 * with the request. Use the status of the last TRB of the request.
 	 */
-	if (req->request.no_interrupt) {
+	if (req->no_interrupt) {
 		struct dwc3_trb *trb;
 
 		trb = dwc3_ep_prev_trb(dep, dep->trb_dequeue);
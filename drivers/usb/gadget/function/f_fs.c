@@ -946,16 +946,25 @@ static ssize_t ffs_epfile_io(struct file *file, struct ffs_io_data *io_data)
 	struct ffs_ep *ep;
 	char *data = NULL;
 	ssize_t ret, data_len = -EINVAL;
+	bool nowait = io_data->kiocb->ki_flags & IOCB_NOWAIT;
+	bool nonblock = (file->f_flags & O_NONBLOCK) || nowait;
 	int halt;
 
 	/* Are we still active? */
 	if (WARN_ON(epfile->ffs->state != FFS_ACTIVE))
 		return -ENODEV;
 
+	/*
+	 * A synchronous transfer always sleeps until the host is done with
+	 * it, so RWF_NOWAIT can only be honoured for queued ones.
+	 */
+	if (nowait && !io_data->aio)
+		return -EAGAIN;
+
 	/* Wait for endpoint to be enabled */
 	ep = epfile->ep;
 	if (!ep) {
-		if (file->f_flags & O_NONBLOCK)
+		if (nonblock)
 			return -EAGAIN;
 
 		ret = wait_event_interruptible(
@@ -970,7 +979,7 @@ static ssize_t ffs_epfile_io(struct file *file, struct ffs_io_data *io_data)
 		return -EINVAL;
 
 	/* We will be using request and read_buffer */
-	ret = ffs_mutex_lock(&epfile->mutex, file->f_flags & O_NONBLOCK);
+	ret = ffs_mutex_lock(&epfile->mutex, nonblock);
 	if (ret)
 		goto error;
 
@@ -1159,6 +1168,13 @@ ffs_epfile_open(struct inode *inode, struct file *file)
 	file->private_data = epfile;
 	ffs_data_opened(epfile->ffs);
 
+	/*
+	 * Asynchronous I/O only sleeps for the endpoint and its mutex, both
+	 * of which are given up on under IOCB_NOWAIT, so io_uring can queue
+	 * transfers inline instead of punting them to a worker.
+	 */
+	file->f_mode |= FMODE_NOWAIT;
+
 	return stream_open(inode, file);
 }
 
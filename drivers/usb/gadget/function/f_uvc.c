@@ -982,8 +982,8 @@ static void uvc_function_unbind(struct usb_configuration *c,
 
 	uvcg_info(f, "%s()\n", __func__);
 
-	if (video->async_wq)
-		destroy_workqueue(video->async_wq);
+	if (video->kworker)
+		kthread_destroy_worker(video->kworker);
 
 	/*
 	 * If we know we're connected via v4l2, then there should be a cleanup
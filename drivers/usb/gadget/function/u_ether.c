@@ -66,6 +66,7 @@ struct eth_dev {
 	atomic_t		tx_qlen;
 
 	struct sk_buff_head	rx_frames;
+	struct napi_struct	napi;
 
 	unsigned		qmult;
 
@@ -218,58 +219,91 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 	return retval;
 }
 
+/*
+ * Hand the frames unwrapped by rx_complete() to the stack, in batches so
+ * that GRO can merge the datagrams of an aggregated transfer.
+ */
+static int eth_napi_poll(struct napi_struct *napi, int budget)
+{
+	struct eth_dev	*dev = container_of(napi, struct eth_dev, napi);
+	struct sk_buff	*skb;
+	int		work_done = 0;
+
+	while (work_done < budget) {
+		skb = skb_dequeue(&dev->rx_frames);
+		if (!skb)
+			break;
+		work_done++;
+
+		if (ETH_HLEN > skb->len || skb->len > GETHER_MAX_ETH_FRAME_LEN) {
+			dev->net->stats.rx_errors++;
+			dev->net->stats.rx_length_errors++;
+			DBG(dev, "rx length %d\n", skb->len);
+			dev_kfree_skb_any(skb);
+			continue;
+		}
+		skb->protocol = eth_type_trans(skb, dev->net);
+		dev->net->stats.rx_packets++;
+		dev->net->stats.rx_bytes += skb->len;
+
+		/* no buffer copies needed, unless hardware can't
+		 * use skb buffers.
+		 */
+		napi_gro_receive(napi, skb);
+	}
+
+	if (work_done < budget)
+		napi_complete_done(napi, work_done);
+
+	return work_done;
+}
+
 static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	struct sk_buff	*skb = req->context, *skb2;
 	struct eth_dev	*dev = ep->driver_data;
 	int		status = req->status;
+	struct sk_buff_head frames;
+	unsigned long	flags;
 
 	switch (status) {
 
 	/* normal completion */
 	case 0:
 		skb_put(skb, req->actual);
+		skb_queue_head_init(&frames);
 
 		if (dev->unwrap) {
-			unsigned long	flags;
-
 			spin_lock_irqsave(&dev->lock, flags);
 			if (dev->port_usb) {
 				status = dev->unwrap(dev->port_usb,
 							skb,
-							&dev->rx_frames);
+							&frames);
 			} else {
 				dev_kfree_skb_any(skb);
 				status = -ENOTCONN;
 			}
 			spin_unlock_irqrestore(&dev->lock, flags);
 		} else {
-			skb_queue_tail(&dev->rx_frames, skb);
+			skb_queue_tail(&frames, skb);
 		}
 		skb = NULL;
 
-		skb2 = skb_dequeue(&dev->rx_frames);
-		while (skb2) {
-			if (status < 0
-					|| ETH_HLEN > skb2->len
-					|| skb2->len > GETHER_MAX_ETH_FRAME_LEN) {
+		/* the frames already unwrapped from a bad transfer go too */
+		if (status < 0) {
+			while ((skb2 = __skb_dequeue(&frames))) {
 				dev->net->stats.rx_errors++;
 				dev->net->stats.rx_length_errors++;
 				DBG(dev, "rx length %d\n", skb2->len);
 				dev_kfree_skb_any(skb2);
-				goto next_frame;
 			}
-			skb2->protocol = eth_type_trans(skb2, dev->net);
-			dev->net->stats.rx_packets++;
-			dev->net->stats.rx_bytes += skb2->len;
-
-			/* no buffer copies needed, unless hardware can't
-			 * use skb buffers.
-			 */
-			status = netif_rx(skb2);
-next_frame:
-			skb2 = skb_dequeue(&dev->rx_frames);
+			break;
 		}
+
+		spin_lock_irqsave(&dev->rx_frames.lock, flags);
+		skb_queue_splice_tail(&frames, &dev->rx_frames);
+		spin_unlock_irqrestore(&dev->rx_frames.lock, flags);
+		napi_schedule(&dev->napi);
 		break;
 
 	/* software-driven interface shutdown */
@@ -536,8 +570,21 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 		unsigned long	flags;
 
 		spin_lock_irqsave(&dev->lock, flags);
-		if (dev->port_usb)
+		if (dev->port_usb) {
+			bool	flush = skb && !netdev_xmit_more() &&
+					!atomic_read(&dev->tx_qlen);
+
 			skb = dev->wrap(dev->port_usb, skb);
+
+			/* Multi frame protocols hold frames back to aggregate
+			 * them, until the transfer fills up or a timer fires.
+			 * Waiting only pays while the IN queue is busy, so with
+			 * nothing in flight and no frame queued behind this one
+			 * send what was gathered now.
+			 */
+			if (!skb && flush && dev->port_usb->supports_multi_frame)
+				skb = dev->wrap(dev->port_usb, NULL);
+		}
 		spin_unlock_irqrestore(&dev->lock, flags);
 		if (!skb) {
 			/* Multi frame CDC protocols may store the frame for
@@ -617,6 +664,8 @@ static int eth_open(struct net_device *net)
 	struct gether	*link;
 
 	DBG(dev, "%s\n", __func__);
+	skb_queue_purge(&dev->rx_frames);
+	napi_enable(&dev->napi);
 	if (netif_carrier_ok(dev->net))
 		eth_start(dev, GFP_KERNEL);
 
@@ -675,6 +724,9 @@ static int eth_stop(struct net_device *net)
 	}
 	spin_unlock_irqrestore(&dev->lock, flags);
 
+	napi_disable(&dev->napi);
+	skb_queue_purge(&dev->rx_frames);
+
 	return 0;
 }
 
@@ -760,6 +812,7 @@ struct eth_dev *gether_setup_name(struct usb_gadget *g,
 
 	/* network device setup */
 	dev->net = net;
+	netif_napi_add(net, &dev->napi, eth_napi_poll);
 	dev->qmult = qmult;
 	snprintf(net->name, sizeof(net->name), "%s%%d", netname);
 
@@ -831,6 +884,7 @@ struct net_device *gether_setup_name_default(const char *netname)
 
 	/* network device setup */
 	dev->net = net;
+	netif_napi_add(net, &dev->napi, eth_napi_poll);
 	dev->qmult = QMULT_DEFAULT;
 	snprintf(net->name, sizeof(net->name), "%s%%d", netname);
 
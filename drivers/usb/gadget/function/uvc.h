@@ -9,6 +9,7 @@
 #ifndef _UVC_GADGET_H_
 #define _UVC_GADGET_H_
 
+#include <linux/kthread.h>
 #include <linux/list.h>
 #include <linux/mutex.h>
 #include <linux/spinlock.h>
@@ -87,8 +88,8 @@ struct uvc_video {
 	struct uvc_device *uvc;
 	struct usb_ep *ep;
 
-	struct work_struct pump;
-	struct workqueue_struct *async_wq;
+	struct kthread_work pump;
+	struct kthread_worker *kworker;
 
 	/* Frame parameters */
 	u8 bpp;
@@ -107,6 +108,7 @@ struct uvc_video {
 	spinlock_t req_lock;
 
 	unsigned int req_int_count;
+	unsigned int req_int_interval;
 
 	void (*encode) (struct usb_request *req, struct uvc_video *video,
 			struct uvc_buffer *buf);
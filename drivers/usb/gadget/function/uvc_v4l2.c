@@ -416,7 +416,7 @@ uvc_v4l2_qbuf(struct file *file, void *fh, struct v4l2_buffer *b)
 		return ret;
 
 	if (uvc->state == UVC_STATE_STREAMING)
-		queue_work(video->async_wq, &video->pump);
+		kthread_queue_work(video->kworker, &video->pump);
 
 	return ret;
 }
@@ -9,6 +9,7 @@
 #include <linux/kernel.h>
 #include <linux/device.h>
 #include <linux/errno.h>
+#include <linux/sched.h>
 #include <linux/usb/ch9.h>
 #include <linux/usb/gadget.h>
 #include <linux/usb/video.h>
@@ -129,15 +130,104 @@ uvc_video_encode_bulk(struct usb_request *req, struct uvc_video *video,
 		video->payload_size = 0;
 }
 
+/*
+ * Point up to @nents entries from @sg at the next *@len bytes of the video
+ * buffer, without copying them.  Returns the number of entries used and
+ * leaves the number of bytes that didn't fit in *@len.
+ */
+static unsigned int
+uvc_video_encode_sg(struct uvc_buffer *buf, struct scatterlist *sg,
+		unsigned int nents, unsigned int *len)
+{
+	unsigned int sg_left, part;
+	struct scatterlist *iter;
+	unsigned int i;
+
+	for_each_sg(sg, iter, nents, i) {
+		if (!*len || !buf->sg || !buf->sg->length)
+			break;
+
+		sg_left = buf->sg->length - buf->offset;
+		part = min_t(unsigned int, *len, sg_left);
+
+		sg_set_page(iter, sg_page(buf->sg), part, buf->offset);
+
+		if (part == sg_left) {
+			buf->offset = 0;
+			buf->sg = sg_next(buf->sg);
+		} else {
+			buf->offset += part;
+		}
+		*len -= part;
+	}
+
+	return i;
+}
+
+static void
+uvc_video_encode_bulk_sg(struct usb_request *req, struct uvc_video *video,
+		struct uvc_buffer *buf)
+{
+	unsigned int pending = buf->bytesused - video->queue.buf_used;
+	struct uvc_request *ureq = req->context;
+	struct scatterlist *sg = ureq->sgt.sgl;
+	unsigned int len = video->req_size;
+	unsigned int header_len = 0;
+	unsigned int num_sgs = 0;
+	unsigned int data_len;
+
+	sg_init_table(sg, ureq->sgt.nents);
+
+	/* Add a header at the beginning of the payload. */
+	if (video->payload_size == 0) {
+		header_len = uvc_video_encode_header(video, buf, ureq->header,
+						     len);
+		sg_set_buf(sg, ureq->header, header_len);
+		video->payload_size += header_len;
+		len -= header_len;
+		sg = sg_next(sg);
+		num_sgs++;
+	}
+
+	/* Process video data. */
+	len = min3(video->max_payload_size - video->payload_size, len, pending);
+	data_len = len;
+	num_sgs += uvc_video_encode_sg(buf, sg, ureq->sgt.nents - num_sgs, &len);
+	data_len -= len;
+
+	req->buf = NULL;
+	req->sg = ureq->sgt.sgl;
+	req->num_sgs = num_sgs;
+	req->length = header_len + data_len;
+
+	video->queue.buf_used += data_len;
+	video->payload_size += data_len;
+	req->zero = video->payload_size == video->max_payload_size;
+
+	if (buf->bytesused == video->queue.buf_used || !buf->sg) {
+		video->queue.buf_used = 0;
+		buf->state = UVC_BUF_STATE_DONE;
+		buf->offset = 0;
+		list_del(&buf->queue);
+		video->fid ^= UVC_STREAM_FID;
+		ureq->last_buf = buf;
+
+		video->payload_size = 0;
+	}
+
+	if (video->payload_size == video->max_payload_size ||
+	    video->queue.flags & UVC_QUEUE_DROP_INCOMPLETE)
+		video->payload_size = 0;
+}
+
 static void
 uvc_video_encode_isoc_sg(struct usb_request *req, struct uvc_video *video,
 		struct uvc_buffer *buf)
 {
 	unsigned int pending = buf->bytesused - video->queue.buf_used;
 	struct uvc_request *ureq = req->context;
-	struct scatterlist *sg, *iter;
+	struct scatterlist *sg;
 	unsigned int len = video->req_size;
-	unsigned int sg_left, part = 0;
 	unsigned int i;
 	int header_len;
 
@@ -157,25 +247,7 @@ uvc_video_encode_isoc_sg(struct usb_request *req, struct uvc_video *video,
 		len + header_len : video->req_size;
 
 	/* Init the pending sgs with payload */
-	sg = sg_next(sg);
-
-	for_each_sg(sg, iter, ureq->sgt.nents - 1, i) {
-		if (!len || !buf->sg || !buf->sg->length)
-			break;
-
-		sg_left = buf->sg->length - buf->offset;
-		part = min_t(unsigned int, len, sg_left);
-
-		sg_set_page(iter, sg_page(buf->sg), part, buf->offset);
-
-		if (part == sg_left) {
-			buf->offset = 0;
-			buf->sg = sg_next(buf->sg);
-		} else {
-			buf->offset += part;
-		}
-		len -= part;
-	}
+	i = uvc_video_encode_sg(buf, sg_next(sg), ureq->sgt.nents - 1, &len);
 
 	/* Assign the video data with header. */
 	req->buf = NULL;
@@ -250,6 +322,12 @@ static int uvcg_video_ep_queue(struct uvc_video *video, struct usb_request *req)
 	return ret;
 }
 
+/* Default number of requests queued between two completion interrupts */
+static unsigned int uvc_video_int_interval(struct uvc_video *video)
+{
+	return DIV_ROUND_UP(video->uvc_num_requests, 4);
+}
+
 static void
 uvc_video_complete(struct usb_ep *ep, struct usb_request *req)
 {
@@ -266,6 +344,9 @@ uvc_video_complete(struct usb_ep *ep, struct usb_request *req)
 	case -EXDEV:
 		uvcg_dbg(&video->uvc->func, "VS request missed xfer.\n");
 		queue->flags |= UVC_QUEUE_DROP_INCOMPLETE;
+		/* We refilled too late, interrupt more often from now on. */
+		WRITE_ONCE(video->req_int_interval,
+			   max(video->req_int_interval / 2, 1U));
 		break;
 
 	case -ESHUTDOWN:	/* disconnect from host. */
@@ -281,6 +362,12 @@ uvc_video_complete(struct usb_ep *ep, struct usb_request *req)
 	}
 
 	if (ureq->last_buf) {
+		/* A whole frame went out, slowly back off to the default. */
+		if (!req->status &&
+		    video->req_int_interval < uvc_video_int_interval(video))
+			WRITE_ONCE(video->req_int_interval,
+				   video->req_int_interval + 1);
+
 		uvcg_complete_buffer(&video->queue, ureq->last_buf);
 		ureq->last_buf = NULL;
 	}
@@ -290,7 +377,7 @@ uvc_video_complete(struct usb_ep *ep, struct usb_request *req)
 	spin_unlock_irqrestore(&video->req_lock, flags);
 
 	if (uvc->state == UVC_STATE_STREAMING)
-		queue_work(video->async_wq, &video->pump);
+		kthread_queue_work(video->kworker, &video->pump);
 }
 
 static int
@@ -381,7 +468,7 @@ uvc_video_alloc_requests(struct uvc_video *video)
  * This function fills the available USB requests (listed in req_free) with
  * video data from the queued buffers.
  */
-static void uvcg_video_pump(struct work_struct *work)
+static void uvcg_video_pump(struct kthread_work *work)
 {
 	struct uvc_video *video = container_of(work, struct uvc_video, pump);
 	struct uvc_video_queue *queue = &video->queue;
@@ -450,13 +537,15 @@ static void uvcg_video_pump(struct work_struct *work)
 		 *   ASAP in case it doesn't get started already in the next
 		 *   iteration of this loop.
 		 *
-		 * - Four times over the length of the requests queue (as
-		 *   indicated by video->uvc_num_requests), as a trade-off
-		 *   between latency and interrupt load.
+		 * - Every video->req_int_interval requests, as a trade-off
+		 *   between latency and interrupt load. This starts at four
+		 *   times over the length of the requests queue (as indicated
+		 *   by video->uvc_num_requests), and is shortened by the
+		 *   completion handler when the host misses transfers.
 		 */
 		if (list_empty(&video->req_free) || buf_done ||
 		    !(video->req_int_count %
-		       DIV_ROUND_UP(video->uvc_num_requests, 4))) {
+		       READ_ONCE(video->req_int_interval))) {
 			video->req_int_count = 0;
 			req->no_interrupt = 0;
 		} else {
@@ -501,7 +590,7 @@ int uvcg_video_enable(struct uvc_video *video, int enable)
 	}
 
 	if (!enable) {
-		cancel_work_sync(&video->pump);
+		kthread_cancel_work_sync(&video->pump);
 		uvcg_queue_cancel(&video->queue, 0);
 
 		for (i = 0; i < video->uvc_num_requests; ++i)
@@ -520,15 +609,17 @@ int uvcg_video_enable(struct uvc_video *video, int enable)
 		return ret;
 
 	if (video->max_payload_size) {
-		video->encode = uvc_video_encode_bulk;
+		video->encode = video->queue.use_sg ?
+			uvc_video_encode_bulk_sg : uvc_video_encode_bulk;
 		video->payload_size = 0;
 	} else
 		video->encode = video->queue.use_sg ?
 			uvc_video_encode_isoc_sg : uvc_video_encode_isoc;
 
 	video->req_int_count = 0;
+	video->req_int_interval = uvc_video_int_interval(video);
 
-	queue_work(video->async_wq, &video->pump);
+	kthread_queue_work(video->kworker, &video->pump);
 
 	return ret;
 }
@@ -538,14 +629,21 @@ int uvcg_video_enable(struct uvc_video *video, int enable)
  */
 int uvcg_video_init(struct uvc_video *video, struct uvc_device *uvc)
 {
+	struct kthread_worker *kworker;
+
 	INIT_LIST_HEAD(&video->req_free);
 	spin_lock_init(&video->req_lock);
-	INIT_WORK(&video->pump, uvcg_video_pump);
-
-	/* Allocate a work queue for asynchronous video pump handler. */
-	video->async_wq = alloc_workqueue("uvcgadget", WQ_UNBOUND | WQ_HIGHPRI, 0);
-	if (!video->async_wq)
-		return -EINVAL;
+	kthread_init_work(&video->pump, uvcg_video_pump);
+
+	/*
+	 * Run the video pump on a dedicated realtime thread, so that refilling
+	 * the endpoint after a completion doesn't wait behind other work.
+	 */
+	kworker = kthread_create_worker(0, "UVCG");
+	if (IS_ERR(kworker))
+		return PTR_ERR(kworker);
+	sched_set_fifo(kworker->task);
+	video->kworker = kworker;
 
 	video->uvc = uvc;
 	video->fcc = V4L2_PIX_FMT_YUYV;
@@ -324,6 +324,13 @@ static const struct vm_operations_struct gh_vcpu_ops = {
 	.fault = gh_vcpu_fault,
 };
 
+/*
+ * Only the gh_vcpu_run page is mapped, and it describes one exit at a time.
+ * Writes that userspace wants handled without a trip through GH_VCPU_RUN are
+ * better served by an ioeventfd, which completes in the kernel. Reads must be
+ * answered before the vCPU can resume, so they can't be queued for another
+ * thread to finish later.
+ */
 static int gh_vcpu_mmap(struct file *file, struct vm_area_struct *vma)
 {
 	vma->vm_ops = &gh_vcpu_ops;
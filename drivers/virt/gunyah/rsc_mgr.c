@@ -5,6 +5,10 @@
 
 #include <linux/of.h>
 #include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/mutex.h>
 #include <linux/sched.h>
 #include <linux/gunyah.h>
@@ -101,12 +105,14 @@ struct gh_rm_connection {
 		 * @seq: Sequence ID for the main message.
 		 * @rm_error: For request/reply sequences with standard replies
 		 * @seq_done: Signals caller that the RM reply has been received
+		 * @start: When the request was handed to the msgq
 		 */
 		struct {
 			int ret;
 			u16 seq;
 			enum gh_rm_error rm_error;
 			struct completion seq_done;
+			ktime_t start;
 		} reply;
 
 		/**
@@ -120,6 +126,20 @@ struct gh_rm_connection {
 	};
 };
 
+/**
+ * struct gh_rm_msg_stats - Round trip statistics of one RM message-id
+ * @count: Number of calls which got a reply
+ * @errors: Number of those replies which carried an RM error
+ * @total_ns: Sum of the round trip times
+ * @max_ns: Longest round trip time
+ */
+struct gh_rm_msg_stats {
+	u64 count;
+	u64 errors;
+	u64 total_ns;
+	u64 max_ns;
+};
+
 /**
  * struct gh_rm - private data for communicating w/Gunyah resource manager
  * @dev: pointer to RM platform device
@@ -134,6 +154,9 @@ struct gh_rm_connection {
  * @cache: cache for allocating Tx messages
  * @send_lock: synchronization to allow only one request to be sent at a time
  * @nh: notifier chain for clients interested in RM notification messages
+ * @stats_xarray: struct gh_rm_msg_stats of each message-id, indexed by the id
+ * @stats_lock: protects the contents of the entries in @stats_xarray
+ * @debugfs: debugfs directory of the RM statistics
  * @miscdev: /dev/gunyah
  * @irq_domain: Domain to translate Gunyah hwirqs to Linux irqs
  */
@@ -153,6 +176,10 @@ struct gh_rm {
 	struct mutex send_lock;
 	struct blocking_notifier_head nh;
 
+	struct xarray stats_xarray;
+	spinlock_t stats_lock;
+	struct dentry *debugfs;
+
 	struct miscdevice miscdev;
 	struct irq_domain *irq_domain;
 };
@@ -528,11 +555,21 @@ static void gh_rm_msgq_rx_data(struct mbox_client *cl, void *mssg)
 	gh_rm_try_complete_connection(rm);
 }
 
+static void gh_rm_free_msgs(struct gh_rm *rm, struct gh_msgq_tx_data *msg)
+{
+	struct gh_msgq_tx_data *next;
+
+	for (; msg; msg = next) {
+		next = msg->next;
+		kmem_cache_free(rm->cache, msg);
+	}
+}
+
 static void gh_rm_msgq_tx_done(struct mbox_client *cl, void *mssg, int r)
 {
 	struct gh_rm *rm = container_of(cl, struct gh_rm, msgq_client);
 
-	kmem_cache_free(rm->cache, mssg);
+	gh_rm_free_msgs(rm, mssg);
 	rm->last_tx_ret = r;
 }
 
@@ -542,7 +579,7 @@ static int gh_rm_send_request(struct gh_rm *rm, u32 message_id,
 {
 	size_t buf_size_remaining = req_buf_size;
 	const void *req_buf_curr = req_buf;
-	struct gh_msgq_tx_data *msg;
+	struct gh_msgq_tx_data *msg, *first = NULL, **tail = &first;
 	struct gh_rm_rpc_hdr *hdr, hdr_template;
 	u32 cont_fragments = 0;
 	size_t payload_size;
@@ -565,15 +602,12 @@ static int gh_rm_send_request(struct gh_rm *rm, u32 message_id,
 	hdr_template.seq = cpu_to_le16(connection->reply.seq);
 	hdr_template.msg_id = cpu_to_le32(message_id);
 
-	ret = mutex_lock_interruptible(&rm->send_lock);
-	if (ret)
-		return ret;
-
+	/* Build all the fragments up front so they go out as one msgq burst */
 	do {
 		msg = kmem_cache_zalloc(rm->cache, GFP_KERNEL);
 		if (!msg) {
-			ret = -ENOMEM;
-			goto out;
+			gh_rm_free_msgs(rm, first);
+			return -ENOMEM;
 		}
 
 		/* Fill header */
@@ -591,48 +625,75 @@ static int gh_rm_send_request(struct gh_rm *rm, u32 message_id,
 		msg->push = !buf_size_remaining;
 		msg->length = sizeof(*hdr) + payload_size;
 
-		ret = mbox_send_message(gh_msgq_chan(&rm->msgq), msg);
-		if (ret < 0) {
-			kmem_cache_free(rm->cache, msg);
-			break;
-		}
-
-		if (rm->last_tx_ret) {
-			ret = rm->last_tx_ret;
-			break;
-		}
+		*tail = msg;
+		tail = &msg->next;
 
 		hdr_template.type = FIELD_PREP(RM_RPC_TYPE_MASK, RM_RPC_TYPE_CONTINUATION) |
 					FIELD_PREP(RM_RPC_FRAGMENTS_MASK, cont_fragments);
 	} while (buf_size_remaining);
 
-out:
+	ret = mutex_lock_interruptible(&rm->send_lock);
+	if (ret) {
+		gh_rm_free_msgs(rm, first);
+		return ret;
+	}
+
+	ret = mbox_send_message(gh_msgq_chan(&rm->msgq), first);
+	if (ret < 0)
+		gh_rm_free_msgs(rm, first);
+	else if (rm->last_tx_ret)
+		ret = rm->last_tx_ret;
+
 	mutex_unlock(&rm->send_lock);
 	return ret < 0 ? ret : 0;
 }
 
+static void gh_rm_account_call(struct gh_rm *rm, struct gh_rm_connection *connection)
+{
+	u64 elapsed = ktime_to_ns(ktime_sub(ktime_get(), connection->reply.start));
+	u32 message_id = le32_to_cpu(connection->msg_id);
+	struct gh_rm_msg_stats *stats, *old;
+
+	stats = xa_load(&rm->stats_xarray, message_id);
+	if (!stats) {
+		stats = kzalloc(sizeof(*stats), GFP_KERNEL);
+		if (!stats)
+			return;
+		old = xa_cmpxchg(&rm->stats_xarray, message_id, NULL, stats, GFP_KERNEL);
+		if (old) {
+			kfree(stats);
+			if (xa_is_err(old))
+				return;
+			stats = old;
+		}
+	}
+
+	spin_lock(&rm->stats_lock);
+	stats->count++;
+	if (connection->reply.rm_error != GH_RM_ERROR_OK)
+		stats->errors++;
+	stats->total_ns += elapsed;
+	stats->max_ns = max(stats->max_ns, elapsed);
+	spin_unlock(&rm->stats_lock);
+}
+
 /**
- * gh_rm_call: Achieve request-response type communication with RPC
+ * gh_rm_call_async: Send a request to the Resource Manager without waiting for the reply
  * @rm: Pointer to Gunyah resource manager internal data
  * @message_id: The RM RPC message-id
  * @req_buf: Request buffer that contains the payload
  * @req_buf_size: Total size of the payload
- * @resp_buf: Pointer to a response buffer
- * @resp_buf_size: Size of the response buffer
  *
- * Make a request to the Resource Manager and wait for reply back. For a successful
- * response, the function returns the payload. The size of the payload is set in
- * resp_buf_size. The resp_buf must be freed by the caller when 0 is returned
- * and resp_buf_size != 0.
- *
- * req_buf should be not NULL for req_buf_size >0. If req_buf_size == 0,
- * req_buf *can* be NULL and no additional payload is sent.
+ * Replies are matched to requests by sequence number, so any number of calls
+ * may be outstanding at once. The returned handle must be passed to
+ * gh_rm_call_wait() exactly once, which also frees it. gh_rm_call_done() tells
+ * whether the reply has arrived without blocking.
  *
- * Context: Process context. Will sleep waiting for reply.
- * Return: 0 on success. <0 if error.
+ * Context: Process context.
+ * Return: a handle for the call on success, ERR_PTR() if the request wasn't sent.
  */
-int gh_rm_call(struct gh_rm *rm, u32 message_id, const void *req_buf, size_t req_buf_size,
-		void **resp_buf, size_t *resp_buf_size)
+struct gh_rm_connection *gh_rm_call_async(struct gh_rm *rm, u32 message_id,
+					  const void *req_buf, size_t req_buf_size)
 {
 	struct gh_rm_connection *connection;
 	u32 seq_id;
@@ -640,12 +701,11 @@ int gh_rm_call(struct gh_rm *rm, u32 message_id, const void *req_buf, size_t req
 
 	/* message_id 0 is reserved. req_buf_size implies req_buf is not NULL */
 	if (!rm || !message_id || (!req_buf && req_buf_size))
-		return -EINVAL;
-
+		return ERR_PTR(-EINVAL);
 
 	connection = kzalloc(sizeof(*connection), GFP_KERNEL);
 	if (!connection)
-		return -ENOMEM;
+		return ERR_PTR(-ENOMEM);
 
 	connection->type = RM_RPC_TYPE_REPLY;
 	connection->msg_id = cpu_to_le32(message_id);
@@ -660,9 +720,48 @@ int gh_rm_call(struct gh_rm *rm, u32 message_id, const void *req_buf, size_t req
 	connection->reply.seq = lower_16_bits(seq_id);
 
 	/* Send the request to the Resource Manager */
+	connection->reply.start = ktime_get();
 	ret = gh_rm_send_request(rm, message_id, req_buf, req_buf_size, connection);
 	if (ret < 0)
-		goto out;
+		goto erase;
+
+	return connection;
+
+erase:
+	xa_erase(&rm->call_xarray, connection->reply.seq);
+free:
+	kfree(connection);
+	return ERR_PTR(ret);
+}
+
+/**
+ * gh_rm_call_done: Check whether the reply to an asynchronous call has arrived
+ * @connection: Handle returned by gh_rm_call_async()
+ *
+ * Return: true if gh_rm_call_wait() would not block.
+ */
+bool gh_rm_call_done(struct gh_rm_connection *connection)
+{
+	return completion_done(&connection->reply.seq_done);
+}
+
+/**
+ * gh_rm_call_wait: Wait for the reply to an asynchronous call
+ * @rm: Pointer to Gunyah resource manager internal data
+ * @connection: Handle returned by gh_rm_call_async()
+ * @resp_buf: Pointer to a response buffer
+ * @resp_buf_size: Size of the response buffer
+ *
+ * The response is returned as for gh_rm_call(). @connection is freed.
+ *
+ * Context: Process context. Will sleep waiting for reply.
+ * Return: 0 on success. <0 if error.
+ */
+int gh_rm_call_wait(struct gh_rm *rm, struct gh_rm_connection *connection,
+		    void **resp_buf, size_t *resp_buf_size)
+{
+	u32 message_id = le32_to_cpu(connection->msg_id);
+	int ret = 0;
 
 	/* Wait for response. Uninterruptible because rollback based on what RM did to VM
 	 * requires us to know how RM handled the call.
@@ -677,6 +776,8 @@ int gh_rm_call(struct gh_rm *rm, u32 message_id, const void *req_buf, size_t req
 		goto out;
 	}
 
+	gh_rm_account_call(rm, connection);
+
 	/* Got a response, did resource manager give us an error? */
 	if (connection->reply.rm_error != GH_RM_ERROR_OK) {
 		dev_warn(rm->dev, "RM rejected message %08x. Error: %d\n", message_id,
@@ -700,11 +801,63 @@ int gh_rm_call(struct gh_rm *rm, u32 message_id, const void *req_buf, size_t req
 
 out:
 	xa_erase(&rm->call_xarray, connection->reply.seq);
-free:
 	kfree(connection);
 	return ret;
 }
 
+/**
+ * gh_rm_call: Achieve request-response type communication with RPC
+ * @rm: Pointer to Gunyah resource manager internal data
+ * @message_id: The RM RPC message-id
+ * @req_buf: Request buffer that contains the payload
+ * @req_buf_size: Total size of the payload
+ * @resp_buf: Pointer to a response buffer
+ * @resp_buf_size: Size of the response buffer
+ *
+ * Make a request to the Resource Manager and wait for reply back. For a successful
+ * response, the function returns the payload. The size of the payload is set in
+ * resp_buf_size. The resp_buf must be freed by the caller when 0 is returned
+ * and resp_buf_size != 0.
+ *
+ * req_buf should be not NULL for req_buf_size >0. If req_buf_size == 0,
+ * req_buf *can* be NULL and no additional payload is sent.
+ *
+ * Context: Process context. Will sleep waiting for reply.
+ * Return: 0 on success. <0 if error.
+ */
+int gh_rm_call(struct gh_rm *rm, u32 message_id, const void *req_buf, size_t req_buf_size,
+		void **resp_buf, size_t *resp_buf_size)
+{
+	struct gh_rm_connection *connection;
+
+	connection = gh_rm_call_async(rm, message_id, req_buf, req_buf_size);
+	if (IS_ERR(connection))
+		return PTR_ERR(connection);
+
+	return gh_rm_call_wait(rm, connection, resp_buf, resp_buf_size);
+}
+
+static int gh_rm_stats_show(struct seq_file *s, void *unused)
+{
+	struct gh_rm *rm = s->private;
+	struct gh_rm_msg_stats *stats, snap;
+	unsigned long message_id;
+
+	seq_puts(s, "msg_id     count      errors     avg_ns     max_ns\n");
+	xa_for_each(&rm->stats_xarray, message_id, stats) {
+		spin_lock(&rm->stats_lock);
+		snap = *stats;
+		spin_unlock(&rm->stats_lock);
+
+		seq_printf(s, "%08lx   %-10llu %-10llu %-10llu %llu\n", message_id,
+			   snap.count, snap.errors,
+			   snap.count ? div64_u64(snap.total_ns, snap.count) : 0,
+			   snap.max_ns);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(gh_rm_stats);
 
 int gh_rm_notifier_register(struct gh_rm *rm, struct notifier_block *nb)
 {
@@ -813,6 +966,8 @@ static int gh_rm_drv_probe(struct platform_device *pdev)
 	mutex_init(&rm->send_lock);
 	BLOCKING_INIT_NOTIFIER_HEAD(&rm->nh);
 	xa_init_flags(&rm->call_xarray, XA_FLAGS_ALLOC);
+	xa_init(&rm->stats_xarray);
+	spin_lock_init(&rm->stats_lock);
 	rm->cache = kmem_cache_create("gh_rm", struct_size(msg, data, GH_MSGQ_MAX_MSG_SIZE), 0,
 		SLAB_HWCACHE_ALIGN, NULL);
 	if (!rm->cache)
@@ -867,6 +1022,9 @@ static int gh_rm_drv_probe(struct platform_device *pdev)
 	if (ret)
 		goto err_irq_domain;
 
+	rm->debugfs = debugfs_create_dir("gunyah_rm", NULL);
+	debugfs_create_file("latency", 0400, rm->debugfs, rm, &gh_rm_stats_fops);
+
 	return 0;
 err_irq_domain:
 	irq_domain_remove(rm->irq_domain);
@@ -880,12 +1038,19 @@ static int gh_rm_drv_probe(struct platform_device *pdev)
 static int gh_rm_drv_remove(struct platform_device *pdev)
 {
 	struct gh_rm *rm = platform_get_drvdata(pdev);
+	struct gh_rm_msg_stats *stats;
+	unsigned long message_id;
 
+	debugfs_remove_recursive(rm->debugfs);
 	misc_deregister(&rm->miscdev);
 	irq_domain_remove(rm->irq_domain);
 	gh_msgq_remove(&rm->msgq);
 	kmem_cache_destroy(rm->cache);
 
+	xa_for_each(&rm->stats_xarray, message_id, stats)
+		kfree(stats);
+	xa_destroy(&rm->stats_xarray);
+
 	return 0;
 }
 
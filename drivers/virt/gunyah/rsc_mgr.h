@@ -13,6 +13,13 @@ struct gh_rm;
 int gh_rm_call(struct gh_rm *rsc_mgr, u32 message_id, const void *req_buf, size_t req_buf_size,
 		void **resp_buf, size_t *resp_buf_size);
 
+struct gh_rm_connection;
+struct gh_rm_connection *gh_rm_call_async(struct gh_rm *rsc_mgr, u32 message_id,
+					  const void *req_buf, size_t req_buf_size);
+bool gh_rm_call_done(struct gh_rm_connection *connection);
+int gh_rm_call_wait(struct gh_rm *rsc_mgr, struct gh_rm_connection *connection,
+		    void **resp_buf, size_t *resp_buf_size);
+
 int gh_rm_platform_pre_mem_share(struct gh_rm *rm, struct gh_rm_mem_parcel *mem_parcel);
 int gh_rm_platform_post_mem_reclaim(struct gh_rm *rm, struct gh_rm_mem_parcel *mem_parcel);
 
@@ -10,6 +10,7 @@
 #include <linux/file.h>
 #include <linux/gunyah_rsc_mgr.h>
 #include <linux/gunyah_vm_mgr.h>
+#include <linux/hash.h>
 #include <linux/miscdevice.h>
 #include <linux/module.h>
 #include <linux/xarray.h>
@@ -335,10 +336,42 @@ static struct gh_vm_io_handler *gh_vm_mgr_find_io_hdlr(struct gh_vm *ghvm, u64 a
 	return container_of(node, struct gh_vm_io_handler, node);
 }
 
+/*
+ * Handlers in the tree never compare equal to each other, so at most one of
+ * them matches an access and a cached handler that matches is the one the tree
+ * lookup would have found.
+ */
+static bool gh_vm_io_handler_match(struct gh_vm_io_handler *io_hdlr, u64 addr,
+				   u64 len, u64 data)
+{
+	return io_hdlr->addr == addr && (!io_hdlr->len || io_hdlr->len == len) &&
+	       (!io_hdlr->datamatch || io_hdlr->data == data);
+}
+
+static u32 gh_vm_mmio_cache_slot(u64 addr)
+{
+	return hash_64(addr, GH_VM_MMIO_CACHE_BITS);
+}
+
 int gh_vm_mmio_write(struct gh_vm *ghvm, u64 addr, u32 len, u64 data)
 {
 	struct gh_vm_io_handler *io_hdlr = NULL;
-	int ret;
+	u32 slot = gh_vm_mmio_cache_slot(addr);
+	int ret, idx;
+
+	/*
+	 * Doorbell writes mostly hit a handful of addresses: try the cache
+	 * without taking mmio_handler_lock or walking the tree.
+	 */
+	idx = srcu_read_lock(&ghvm->mmio_srcu);
+	io_hdlr = srcu_dereference(ghvm->mmio_cache[slot], &ghvm->mmio_srcu);
+	if (io_hdlr && gh_vm_io_handler_match(io_hdlr, addr, len, data) &&
+	    io_hdlr->ops && io_hdlr->ops->write) {
+		ret = io_hdlr->ops->write(io_hdlr, addr, len, data);
+		srcu_read_unlock(&ghvm->mmio_srcu, idx);
+		return ret;
+	}
+	srcu_read_unlock(&ghvm->mmio_srcu, idx);
 
 	down_read(&ghvm->mmio_handler_lock);
 	io_hdlr = gh_vm_mgr_find_io_hdlr(ghvm, addr, len, data);
@@ -347,6 +380,8 @@ int gh_vm_mmio_write(struct gh_vm *ghvm, u64 addr, u32 len, u64 data)
 		goto out;
 	}
 
+	/* Removal clears the cache under the write lock, so this can't go stale */
+	rcu_assign_pointer(ghvm->mmio_cache[slot], io_hdlr);
 	ret = io_hdlr->ops->write(io_hdlr, addr, len, data);
 
 out:
@@ -372,9 +407,17 @@ EXPORT_SYMBOL_GPL(gh_vm_add_io_handler);
 
 void gh_vm_remove_io_handler(struct gh_vm *ghvm, struct gh_vm_io_handler *io_hdlr)
 {
+	int i;
+
 	down_write(&ghvm->mmio_handler_lock);
 	rb_erase(&io_hdlr->node, &ghvm->mmio_handler_root);
+	for (i = 0; i < ARRAY_SIZE(ghvm->mmio_cache); i++)
+		if (rcu_access_pointer(ghvm->mmio_cache[i]) == io_hdlr)
+			RCU_INIT_POINTER(ghvm->mmio_cache[i], NULL);
 	up_write(&ghvm->mmio_handler_lock);
+
+	/* Wait for cached lookups that may still be using the handler */
+	synchronize_srcu(&ghvm->mmio_srcu);
 }
 EXPORT_SYMBOL_GPL(gh_vm_remove_io_handler);
 
@@ -447,11 +490,18 @@ static void gh_vm_stop(struct gh_vm *ghvm)
 static __must_check struct gh_vm *gh_vm_alloc(struct gh_rm *rm)
 {
 	struct gh_vm *ghvm;
+	int ret;
 
 	ghvm = kzalloc(sizeof(*ghvm), GFP_KERNEL);
 	if (!ghvm)
 		return ERR_PTR(-ENOMEM);
 
+	ret = init_srcu_struct(&ghvm->mmio_srcu);
+	if (ret) {
+		kfree(ghvm);
+		return ERR_PTR(ret);
+	}
+
 	ghvm->parent = gh_rm_get(rm);
 	ghvm->vmid = GH_VMID_INVAL;
 	ghvm->rm = rm;
@@ -714,6 +764,7 @@ static void gh_vm_free(struct work_struct *work)
 
 	gh_rm_put(ghvm->rm);
 	mmdrop(ghvm->mm);
+	cleanup_srcu_struct(&ghvm->mmio_srcu);
 	kfree(ghvm);
 }
 
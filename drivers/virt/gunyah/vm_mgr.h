@@ -13,6 +13,7 @@
 #include <linux/miscdevice.h>
 #include <linux/mutex.h>
 #include <linux/rwsem.h>
+#include <linux/srcu.h>
 #include <linux/wait.h>
 
 #include <uapi/linux/gunyah.h>
@@ -34,6 +35,9 @@ struct gh_vm_mem {
 	unsigned long npages;
 };
 
+/* Hot MMIO handlers are cached in a small hash table indexed by address */
+#define GH_VM_MMIO_CACHE_BITS	3
+
 struct gh_vm {
 	u16 vmid;
 	struct gh_rm *rm;
@@ -59,6 +63,8 @@ struct gh_vm {
 	struct list_head resource_tickets;
 	struct rb_root mmio_handler_root;
 	struct rw_semaphore mmio_handler_lock;
+	struct srcu_struct mmio_srcu;
+	struct gh_vm_io_handler __rcu *mmio_cache[1 << GH_VM_MMIO_CACHE_BITS];
 };
 
 int gh_vm_mem_alloc(struct gh_vm *ghvm, struct gh_userspace_memory_region *region, bool lend);
@@ -17,6 +17,34 @@ static bool pages_are_mergeable(struct page *a, struct page *b)
 	return page_to_pfn(a) + 1 == page_to_pfn(b);
 }
 
+/*
+ * Returns the number of physically contiguous pages at the start of @pages,
+ * at most @nr. A hugetlb folio is always mapped whole and in order, so the
+ * remainder of one is taken in a single step. The pages of any other large
+ * folio may be PTE-mapped in any order and are checked one by one.
+ */
+static unsigned long gh_vm_mem_contig_pages(struct page **pages, unsigned long nr)
+{
+	unsigned long i = 0, step;
+	struct folio *folio;
+
+	while (i < nr) {
+		if (i && !pages_are_mergeable(pages[i - 1], pages[i]))
+			break;
+
+		folio = page_folio(pages[i]);
+		if (folio_test_hugetlb(folio)) {
+			step = folio_nr_pages(folio) -
+			       (page_to_pfn(pages[i]) - folio_pfn(folio));
+			i += min(step, nr - i);
+		} else {
+			i++;
+		}
+	}
+
+	return i;
+}
+
 static bool gh_vm_mem_overlap(struct gh_vm_mem *a, u64 addr, u64 size)
 {
 	u64 a_end = a->guest_phys_addr + (a->npages << PAGE_SHIFT);
@@ -95,14 +123,20 @@ struct gh_vm_mem *gh_vm_mem_find_by_addr(struct gh_vm *ghvm, u64 guest_phys_addr
 	return mapping;
 }
 
+/*
+ * The whole region is pinned here and lent or shared as one memparcel when the
+ * VM starts. Lending it piecemeal on first access would need the hypervisor to
+ * report guest stage-2 faults on memory it does not own yet, and the vCPU run
+ * states in this interface have no such exit, so memory cannot be demand
+ * lent.
+ */
 int gh_vm_mem_alloc(struct gh_vm *ghvm, struct gh_userspace_memory_region *region, bool lend)
 {
 	struct gh_vm_mem *mapping, *tmp_mapping;
-	struct page *curr_page, *prev_page;
 	struct gh_rm_mem_parcel *parcel;
-	int i, j, pinned, ret = 0;
+	unsigned long i, j, nr;
+	int pinned, ret = 0;
 	unsigned int gup_flags;
-	size_t entry_size;
 	u16 vmid;
 
 	if (!region->memory_size || !PAGE_ALIGNED(region->memory_size) ||
@@ -206,10 +240,10 @@ int gh_vm_mem_alloc(struct gh_vm *ghvm, struct gh_userspace_memory_region *regio
 		parcel->acl_entries[1].perms = GH_RM_ACL_R | GH_RM_ACL_W | GH_RM_ACL_X;
 	}
 
-	parcel->n_mem_entries = 1;
-	for (i = 1; i < mapping->npages; i++) {
-		if (!pages_are_mergeable(mapping->pages[i - 1], mapping->pages[i]))
-			parcel->n_mem_entries++;
+	parcel->n_mem_entries = 0;
+	for (i = 0; i < mapping->npages; i += nr) {
+		nr = gh_vm_mem_contig_pages(&mapping->pages[i], mapping->npages - i);
+		parcel->n_mem_entries++;
 	}
 
 	parcel->mem_entries = kvcalloc(parcel->n_mem_entries,
@@ -221,24 +255,12 @@ int gh_vm_mem_alloc(struct gh_vm *ghvm, struct gh_userspace_memory_region *regio
 	}
 
 	/* reduce number of entries by combining contiguous pages into single memory entry */
-	prev_page = mapping->pages[0];
-	parcel->mem_entries[0].phys_addr = cpu_to_le64(page_to_phys(prev_page));
-	entry_size = PAGE_SIZE;
-	for (i = 1, j = 0; i < mapping->npages; i++) {
-		curr_page = mapping->pages[i];
-		if (pages_are_mergeable(prev_page, curr_page)) {
-			entry_size += PAGE_SIZE;
-		} else {
-			parcel->mem_entries[j].size = cpu_to_le64(entry_size);
-			j++;
-			parcel->mem_entries[j].phys_addr =
-				cpu_to_le64(page_to_phys(curr_page));
-			entry_size = PAGE_SIZE;
-		}
-
-		prev_page = curr_page;
+	for (i = 0, j = 0; i < mapping->npages; i += nr, j++) {
+		nr = gh_vm_mem_contig_pages(&mapping->pages[i], mapping->npages - i);
+		parcel->mem_entries[j].phys_addr =
+			cpu_to_le64(page_to_phys(mapping->pages[i]));
+		parcel->mem_entries[j].size = cpu_to_le64(nr << PAGE_SHIFT);
 	}
-	parcel->mem_entries[j].size = cpu_to_le64(entry_size);
 
 	list_add(&mapping->list, &ghvm->memory_mappings);
 	mutex_unlock(&ghvm->mm_lock);
@@ -8,6 +8,8 @@
 #include <linux/prefetch.h>
 #include <linux/sched/mm.h>
 #include <linux/dax.h>
+#include <linux/fadvise.h>
+#include <linux/pagemap.h>
 #include <trace/events/erofs.h>
 
 void erofs_unmap_metabuf(struct erofs_buf *buf)
@@ -445,10 +447,88 @@ static int erofs_file_mmap(struct file *file, struct vm_area_struct *vma)
 #define erofs_file_mmap	generic_file_readonly_mmap
 #endif
 
+#ifdef CONFIG_EROFS_FS_ZIP
+/* the range of POSIX_FADV_WILLNEED read ahead by each worker */
+#define EROFS_WILLNEED_CHUNK	SZ_2M
+
+struct erofs_willneed_work {
+	struct work_struct work;
+	struct file *file;
+	pgoff_t index;
+	unsigned long nr_pages;
+};
+
+static void erofs_willneed_workfn(struct work_struct *work)
+{
+	struct erofs_willneed_work *ww =
+		container_of(work, struct erofs_willneed_work, work);
+	struct file *file = ww->file;
+	DEFINE_READAHEAD(ractl, file, &file->f_ra, file->f_mapping, ww->index);
+
+	page_cache_ra_unbounded(&ractl, ww->nr_pages, 0);
+	fput(file);
+	kfree(ww);
+}
+
+/*
+ * POSIX_FADV_WILLNEED on a compressed file reads the whole range ahead, not
+ * only a readahead window of it, and does so from unbound workers, a chunk
+ * each, so that the chunks are read and decompressed in parallel and
+ * fadvise() returns without waiting for any of it.  Later reads then find
+ * the data decompressed in the page cache, which cachestat() can tell.
+ */
+static int erofs_file_fadvise(struct file *file, loff_t offset, loff_t len,
+			      int advice)
+{
+	struct inode *inode = file_inode(file);
+	pgoff_t index, end_index;
+	loff_t isize, endbyte;
+
+	if (advice != POSIX_FADV_WILLNEED ||
+	    !erofs_inode_is_data_compressed(EROFS_I(inode)->datalayout))
+		return generic_fadvise(file, offset, len, advice);
+
+	if (offset < 0 || len < 0)
+		return -EINVAL;
+
+	isize = i_size_read(inode);
+	if (!isize || offset >= isize)
+		return 0;
+	endbyte = (u64)offset + (u64)len;
+	if (!len || endbyte < len || endbyte > isize)
+		endbyte = isize;
+
+	index = offset >> PAGE_SHIFT;
+	end_index = DIV_ROUND_UP_ULL(endbyte, PAGE_SIZE);
+	while (index < end_index) {
+		struct erofs_willneed_work *ww;
+
+		ww = kmalloc(sizeof(*ww), GFP_KERNEL);
+		if (!ww)
+			return -ENOMEM;
+		INIT_WORK(&ww->work, erofs_willneed_workfn);
+		ww->file = get_file(file);
+		ww->index = index;
+		ww->nr_pages = min_t(unsigned long, end_index - index,
+				     EROFS_WILLNEED_CHUNK >> PAGE_SHIFT);
+		index += ww->nr_pages;
+		queue_work(system_unbound_wq, &ww->work);
+	}
+	return 0;
+}
+#endif
+
 const struct file_operations erofs_file_fops = {
 	.llseek		= generic_file_llseek,
 	.read_iter	= erofs_file_read_iter,
 	.mmap		= erofs_file_mmap,
 	.get_unmapped_area = thp_get_unmapped_area,
 	.splice_read	= filemap_splice_read,
+#ifdef CONFIG_EROFS_FS_ZIP
+	.fadvise	= erofs_file_fadvise,
+#endif
+#ifdef CONFIG_EROFS_FS_PAGE_CACHE_SHARE
+	.open		= erofs_ishare_open,
+	.release	= erofs_ishare_release,
+#endif
 };
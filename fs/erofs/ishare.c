@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Page cache sharing between regular files of identical content.
+ *
+ * Files carrying the same "trusted.erofs.fingerprint" xattr in filesystems
+ * mounted into the same domain are considered to have the same content.  The
+ * first one opened becomes the owner, and later opens of the others read
+ * through its page cache instead of caching (and decompressing) their own
+ * copy of the data.
+ */
+#include <linux/hash.h>
+#include <linux/hashtable.h>
+#include <linux/jhash.h>
+#include "internal.h"
+#include "xattr.h"
+
+#define EROFS_ISHARE_XATTR_NAME		"erofs.fingerprint"
+#define EROFS_ISHARE_FP_MAXSIZE		64
+
+static DEFINE_MUTEX(erofs_ishare_lock);
+static DEFINE_HASHTABLE(erofs_ishare_table, 8);
+
+static u32 erofs_ishare_hash(struct erofs_domain *domain, const u8 *fp,
+			     unsigned int len)
+{
+	return jhash(fp, len, hash_ptr(domain, 32));
+}
+
+/* returns false if the inode has no (usable) fingerprint */
+static bool erofs_ishare_init_fp(struct inode *inode)
+{
+	struct erofs_inode *vi = EROFS_I(inode);
+	u8 *fp;
+	int len;
+
+	if (test_bit(EROFS_I_ISHARE_INITED_BIT, &vi->flags))
+		return vi->ishare_fp;
+
+	fp = kmalloc(EROFS_ISHARE_FP_MAXSIZE, GFP_KERNEL);
+	if (!fp)
+		return false;
+
+	len = erofs_getxattr(inode, EROFS_XATTR_INDEX_TRUSTED,
+			     EROFS_ISHARE_XATTR_NAME, fp,
+			     EROFS_ISHARE_FP_MAXSIZE);
+	/* don't retry on -ENOMEM or -EIO, just don't share this time */
+	if (len < 0 && len != -ENODATA && len != -ERANGE) {
+		kfree(fp);
+		return false;
+	}
+
+	mutex_lock(&erofs_ishare_lock);
+	if (!test_bit(EROFS_I_ISHARE_INITED_BIT, &vi->flags)) {
+		if (len > 0) {
+			vi->ishare_fp = fp;
+			vi->ishare_fplen = len;
+			fp = NULL;
+		}
+		set_bit(EROFS_I_ISHARE_INITED_BIT, &vi->flags);
+	}
+	mutex_unlock(&erofs_ishare_lock);
+	kfree(fp);
+	return vi->ishare_fp;
+}
+
+/**
+ * erofs_ishare_open - Read a newly opened file through a shared page cache
+ * @inode: the inode being opened
+ * @file: the file being opened
+ *
+ * Points @file at the page cache of a cached inode of the same domain and
+ * fingerprint, if there is one, or registers @inode as the owner of the
+ * fingerprint otherwise.  The owner and its filesystem are pinned until
+ * @file is released.
+ */
+int erofs_ishare_open(struct inode *inode, struct file *file)
+{
+	struct erofs_sb_info *sbi = EROFS_I_SB(inode);
+	struct erofs_inode *vi = EROFS_I(inode), *ovi;
+	struct inode *owner = NULL;
+	struct super_block *osb = NULL;
+	u32 hash;
+
+	if (!test_opt(&sbi->opt, INODE_SHARE) || !sbi->domain ||
+	    IS_DAX(inode) || (file->f_flags & O_DIRECT))
+		return 0;
+
+	if (!erofs_ishare_init_fp(inode))
+		return 0;
+
+	hash = erofs_ishare_hash(sbi->domain, vi->ishare_fp, vi->ishare_fplen);
+	mutex_lock(&erofs_ishare_lock);
+	hash_for_each_possible(erofs_ishare_table, ovi, ishare_node, hash) {
+		struct inode *oi = &ovi->vfs_inode;
+
+		if (EROFS_I_SB(oi)->domain != sbi->domain ||
+		    ovi->ishare_fplen != vi->ishare_fplen ||
+		    memcmp(ovi->ishare_fp, vi->ishare_fp, vi->ishare_fplen) ||
+		    i_size_read(oi) != i_size_read(inode))
+			continue;
+		if (ovi == vi)
+			break;
+
+		/* the owner may be on its way out, don't share then */
+		if (atomic_inc_not_zero(&oi->i_sb->s_active)) {
+			osb = oi->i_sb;
+			owner = igrab(oi);
+		}
+		break;
+	}
+	if (!osb && !ovi)
+		hash_add(erofs_ishare_table, &vi->ishare_node, hash);
+	mutex_unlock(&erofs_ishare_lock);
+
+	if (!owner) {
+		/* both references must be dropped without erofs_ishare_lock */
+		if (osb)
+			deactivate_super(osb);
+		return 0;
+	}
+
+	file->f_mapping = owner->i_mapping;
+	file->private_data = owner;
+	return 0;
+}
+
+int erofs_ishare_release(struct inode *inode, struct file *file)
+{
+	struct inode *owner = file->private_data;
+	struct super_block *osb;
+
+	if (!owner)
+		return 0;
+
+	osb = owner->i_sb;
+	iput(owner);
+	deactivate_super(osb);
+	return 0;
+}
+
+void erofs_ishare_evict(struct inode *inode)
+{
+	struct erofs_inode *vi = EROFS_I(inode);
+
+	if (!vi->ishare_fp)
+		return;
+
+	mutex_lock(&erofs_ishare_lock);
+	hash_del(&vi->ishare_node);
+	mutex_unlock(&erofs_ishare_lock);
+	kfree(vi->ishare_fp);
+	vi->ishare_fp = NULL;
+}
@@ -1351,6 +1351,130 @@ static int z_erofs_decompress_pcluster(struct z_erofs_decompress_backend *be,
 	return err;
 }
 
+static void z_erofs_decompress_one(struct z_erofs_decompress_backend *be,
+				   struct z_erofs_pcluster *pcl, bool eio)
+{
+	be->pcl = pcl;
+	z_erofs_decompress_pcluster(be, eio ? -EIO : 0);
+	if (z_erofs_is_inline_pcluster(pcl))
+		z_erofs_free_pcluster(pcl);
+	else
+		erofs_workgroup_put(&pcl->obj);
+}
+
+/* don't bother waking up helpers for fewer pclusters than this */
+#define Z_EROFS_PARALLEL_MIN_PCLUSTERS	4
+
+struct z_erofs_decompress_helper {
+	struct work_struct work;
+	struct z_erofs_decompress_split *split;
+};
+
+/*
+ * A chain of pclusters shared by the caller and a number of helpers queued
+ * to z_erofs_workqueue.  Each of them takes the next undecompressed pcluster
+ * off the chain until it runs dry, so whoever is done with a pcluster first
+ * picks up the next one.
+ */
+struct z_erofs_decompress_split {
+	struct super_block *sb;
+	spinlock_t lock;
+	z_erofs_next_pcluster_t head;
+	refcount_t ref;
+	bool eio;
+	struct z_erofs_decompress_helper helpers[];
+};
+
+static struct z_erofs_pcluster *
+z_erofs_split_next(struct z_erofs_decompress_split *s)
+{
+	struct z_erofs_pcluster *pcl = NULL;
+
+	spin_lock(&s->lock);
+	if (s->head != Z_EROFS_PCLUSTER_TAIL) {
+		DBG_BUGON(s->head == Z_EROFS_PCLUSTER_NIL);
+		pcl = container_of(s->head, struct z_erofs_pcluster, next);
+		/* pcl->next is reset once the pcluster is decompressed */
+		s->head = READ_ONCE(pcl->next);
+	}
+	spin_unlock(&s->lock);
+	return pcl;
+}
+
+static void z_erofs_split_run(struct z_erofs_decompress_split *s,
+			      struct page **pagepool)
+{
+	struct z_erofs_decompress_backend be = {
+		.sb = s->sb,
+		.pagepool = pagepool,
+		.decompressed_secondary_bvecs =
+			LIST_HEAD_INIT(be.decompressed_secondary_bvecs),
+	};
+	struct z_erofs_pcluster *pcl;
+
+	while ((pcl = z_erofs_split_next(s)))
+		z_erofs_decompress_one(&be, pcl, s->eio);
+
+	if (refcount_dec_and_test(&s->ref))
+		kfree(s);
+}
+
+static void z_erofs_decompress_helper_work(struct work_struct *work)
+{
+	struct z_erofs_decompress_helper *h =
+		container_of(work, struct z_erofs_decompress_helper, work);
+	struct page *pagepool = NULL;
+
+	z_erofs_split_run(h->split, &pagepool);
+	erofs_release_pages(&pagepool);
+}
+
+/*
+ * Spread a long chain, e.g. from a large sequential readahead, over several
+ * CPUs.  The caller doesn't wait for the helpers: each folio is unlocked by
+ * whoever decompresses its last pcluster.
+ */
+static bool z_erofs_decompress_parallel(const struct z_erofs_decompressqueue *io,
+					struct page **pagepool)
+{
+	struct erofs_sb_info *const sbi = EROFS_SB(io->sb);
+	unsigned int max = min(READ_ONCE(sbi->opt.max_decompress_workers),
+			       num_online_cpus() - 1);
+	z_erofs_next_pcluster_t owned = io->head;
+	struct z_erofs_decompress_split *s;
+	unsigned int nr = 0, i;
+
+	if (!max)
+		return false;
+
+	/* one helper for every two pclusters, up to @max of them */
+	while (owned != Z_EROFS_PCLUSTER_TAIL && nr < 2 * max) {
+		owned = READ_ONCE(container_of(owned, struct z_erofs_pcluster,
+					       next)->next);
+		++nr;
+	}
+	if (nr < Z_EROFS_PARALLEL_MIN_PCLUSTERS)
+		return false;
+
+	s = kmalloc(struct_size(s, helpers, nr / 2), GFP_NOWAIT | __GFP_NOWARN);
+	if (!s)
+		return false;
+
+	s->sb = io->sb;
+	spin_lock_init(&s->lock);
+	s->head = io->head;
+	refcount_set(&s->ref, nr / 2 + 1);
+	s->eio = io->eio;
+	for (i = 0; i < nr / 2; ++i) {
+		s->helpers[i].split = s;
+		INIT_WORK(&s->helpers[i].work, z_erofs_decompress_helper_work);
+		queue_work(z_erofs_workqueue, &s->helpers[i].work);
+	}
+
+	z_erofs_split_run(s, pagepool);
+	return true;
+}
+
 static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 				     struct page **pagepool)
 {
@@ -1361,18 +1485,18 @@ static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 			LIST_HEAD_INIT(be.decompressed_secondary_bvecs),
 	};
 	z_erofs_next_pcluster_t owned = io->head;
+	struct z_erofs_pcluster *pcl;
+
+	if (z_erofs_decompress_parallel(io, pagepool))
+		return;
 
 	while (owned != Z_EROFS_PCLUSTER_TAIL) {
 		DBG_BUGON(owned == Z_EROFS_PCLUSTER_NIL);
 
-		be.pcl = container_of(owned, struct z_erofs_pcluster, next);
-		owned = READ_ONCE(be.pcl->next);
+		pcl = container_of(owned, struct z_erofs_pcluster, next);
+		owned = READ_ONCE(pcl->next);
 
-		z_erofs_decompress_pcluster(&be, io->eio ? -EIO : 0);
-		if (z_erofs_is_inline_pcluster(be.pcl))
-			z_erofs_free_pcluster(be.pcl);
-		else
-			erofs_workgroup_put(&be.pcl->obj);
+		z_erofs_decompress_one(&be, pcl, io->eio);
 	}
 }
 
@@ -55,6 +55,9 @@ struct fuse_dax_mapping {
 	/* Is this mapping read-only or read-write */
 	bool writable;
 
+	/* Used since the reclaimer last looked at it */
+	bool referenced;
+
 	/* reference count when the mapping is used by dax iomap. */
 	refcount_t refcnt;
 };
@@ -118,6 +121,26 @@ __kick_dmap_free_worker(struct fuse_conn_dax *fcd, unsigned long delay_ms)
 				   msecs_to_jiffies(delay_ms));
 }
 
+/*
+ * Free enough ranges to get back over the threshold in one go, rather than
+ * a fixed chunk per pass, which is slow to catch up on large windows.
+ */
+static unsigned long fuse_dax_reclaim_chunk(struct fuse_conn_dax *fcd)
+{
+	unsigned long free_threshold, nr_free;
+
+	spin_lock(&fcd->lock);
+	free_threshold = max_t(unsigned long, fcd->nr_ranges * FUSE_DAX_RECLAIM_THRESHOLD / 100,
+			     1);
+	nr_free = max_t(long, fcd->nr_free_ranges, 0);
+	spin_unlock(&fcd->lock);
+
+	if (nr_free >= free_threshold)
+		return FUSE_DAX_RECLAIM_CHUNK;
+	return max_t(unsigned long, free_threshold - nr_free,
+		     FUSE_DAX_RECLAIM_CHUNK);
+}
+
 static void kick_dmap_free_worker(struct fuse_conn_dax *fcd,
 				  unsigned long delay_ms)
 {
@@ -418,6 +441,8 @@ static void fuse_fill_iomap(struct inode *inode, loff_t pos, loff_t length,
 		 * shared/exclusive.
 		 */
 		refcount_inc(&dmap->refcnt);
+		if (!READ_ONCE(dmap->referenced))
+			WRITE_ONCE(dmap->referenced, true);
 
 		/* iomap->private should be NULL */
 		WARN_ON_ONCE(iomap->private);
@@ -1139,7 +1164,10 @@ static int try_to_free_dmap_chunks(struct fuse_conn_dax *fcd,
 	unsigned long start_idx = 0, end_idx = 0;
 	struct inode *inode = NULL;
 
-	/* Pick first busy range and free it for now*/
+	/*
+	 * Pick the first busy range not used since the last pass, giving
+	 * ranges that were used a second chance at the tail of the list.
+	 */
 	while (1) {
 		if (nr_freed >= nr_to_free)
 			break;
@@ -1158,6 +1186,13 @@ static int try_to_free_dmap_chunks(struct fuse_conn_dax *fcd,
 			if (refcount_read(&pos->refcnt) > 1)
 				continue;
 
+			if (READ_ONCE(pos->referenced)) {
+				WRITE_ONCE(pos->referenced, false);
+				list_move_tail(&pos->busy_list,
+					       &fcd->busy_ranges);
+				continue;
+			}
+
 			inode = igrab(pos->inode);
 			/*
 			 * This inode is going away. That will free
@@ -1194,7 +1229,7 @@ static void fuse_dax_free_mem_worker(struct work_struct *work)
 	int ret;
 	struct fuse_conn_dax *fcd = container_of(work, struct fuse_conn_dax,
 						 free_work.work);
-	ret = try_to_free_dmap_chunks(fcd, FUSE_DAX_RECLAIM_CHUNK);
+	ret = try_to_free_dmap_chunks(fcd, fuse_dax_reclaim_chunk(fcd));
 	if (ret) {
 		pr_debug("fuse: try_to_free_dmap_chunks() failed with err=%d\n",
 			 ret);
@@ -2285,6 +2285,44 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 		}
 		fdput(f);
 		break;
+	case FUSE_DEV_IOC_BACKING_OPEN: {
+		struct fuse_backing_map map;
+
+		res = -EOPNOTSUPP;
+		if (!IS_ENABLED(CONFIG_FUSE_PASSTHROUGH))
+			break;
+
+		fud = fuse_get_dev(file);
+		res = -EPERM;
+		if (!fud)
+			break;
+
+		res = -EFAULT;
+		if (copy_from_user(&map, (void __user *)arg, sizeof(map)))
+			break;
+
+		res = fuse_backing_open(fud->fc, &map);
+		break;
+	}
+	case FUSE_DEV_IOC_BACKING_CLOSE: {
+		int backing_id;
+
+		res = -EOPNOTSUPP;
+		if (!IS_ENABLED(CONFIG_FUSE_PASSTHROUGH))
+			break;
+
+		fud = fuse_get_dev(file);
+		res = -EPERM;
+		if (!fud)
+			break;
+
+		res = -EFAULT;
+		if (get_user(backing_id, (__u32 __user *)arg))
+			break;
+
+		res = fuse_backing_close(fud->fc, backing_id);
+		break;
+	}
 	default:
 		res = -ENOTTY;
 		break;
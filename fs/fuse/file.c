@@ -147,7 +147,9 @@ struct fuse_file *fuse_file_open(struct fuse_mount *fm, u64 nodeid,
 		if (!err) {
 			ff->fh = outarg.fh;
 			ff->open_flags = outarg.open_flags;
-
+#ifdef CONFIG_FUSE_PASSTHROUGH
+			ff->backing_id = outarg.padding;
+#endif
 		} else if (err != -ENOSYS) {
 			fuse_file_free(ff);
 			return ERR_PTR(err);
@@ -194,10 +196,77 @@ static void fuse_link_write_file(struct file *file)
 	spin_unlock(&fi->lock);
 }
 
-void fuse_finish_open(struct inode *inode, struct file *file)
+/*
+ * Files of an inode either all go through the page cache or all pass reads
+ * and writes through to a backing file, as nothing keeps the page cache
+ * coherent with the backing files.  Direct I/O files may be mixed with both.
+ */
+static int fuse_file_io_open(struct file *file, struct inode *inode)
+{
+	struct fuse_file *ff = file->private_data;
+	struct fuse_conn *fc = get_fuse_conn(inode);
+	struct fuse_inode *fi = get_fuse_inode(inode);
+	int err = 0;
+
+	if (!S_ISREG(inode->i_mode))
+		return 0;
+
+	if (ff->open_flags & FOPEN_PASSTHROUGH) {
+		spin_lock(&fi->lock);
+		if (fi->iocachectr > 0)
+			err = -ETXTBSY;
+		else
+			fi->iocachectr--;
+		spin_unlock(&fi->lock);
+		if (err)
+			return err;
+
+		ff->iomode = FUSE_IOM_PASSTHROUGH;
+		err = fuse_passthrough_open(inode, file);
+	} else if (fc->passthrough && !(ff->open_flags & FOPEN_DIRECT_IO)) {
+		spin_lock(&fi->lock);
+		if (fi->iocachectr < 0)
+			err = -ETXTBSY;
+		else
+			fi->iocachectr++;
+		spin_unlock(&fi->lock);
+		if (!err)
+			ff->iomode = FUSE_IOM_CACHED;
+	}
+
+	if (err)
+		pr_debug("failed to open file in %s mode (err=%i)\n",
+			 ff->open_flags & FOPEN_PASSTHROUGH ? "passthrough" :
+			 "cached", err);
+
+	return err;
+}
+
+static void fuse_file_io_release(struct fuse_file *ff, struct fuse_inode *fi)
+{
+	fuse_passthrough_release(ff);
+
+	if (ff->iomode == FUSE_IOM_NONE)
+		return;
+
+	spin_lock(&fi->lock);
+	if (ff->iomode == FUSE_IOM_PASSTHROUGH)
+		fi->iocachectr++;
+	else
+		fi->iocachectr--;
+	spin_unlock(&fi->lock);
+	ff->iomode = FUSE_IOM_NONE;
+}
+
+int fuse_finish_open(struct inode *inode, struct file *file)
 {
 	struct fuse_file *ff = file->private_data;
 	struct fuse_conn *fc = get_fuse_conn(inode);
+	int err;
+
+	err = fuse_file_io_open(file, inode);
+	if (err)
+		return err;
 
 	if (ff->open_flags & FOPEN_STREAM)
 		stream_open(inode, file);
@@ -216,6 +285,8 @@ void fuse_finish_open(struct inode *inode, struct file *file)
 	}
 	if ((file->f_mode & FMODE_WRITE) && fc->writeback_cache)
 		fuse_link_write_file(file);
+
+	return 0;
 }
 
 int fuse_open_common(struct inode *inode, struct file *file, bool isdir)
@@ -250,8 +321,12 @@ int fuse_open_common(struct inode *inode, struct file *file, bool isdir)
 		fuse_set_nowrite(inode);
 
 	err = fuse_do_open(fm, get_node_id(inode), file, isdir);
-	if (!err)
-		fuse_finish_open(inode, file);
+	if (!err) {
+		err = fuse_finish_open(inode, file);
+		if (err)
+			fuse_sync_release(get_fuse_inode(inode),
+					  file->private_data, file->f_flags);
+	}
 
 	if (is_wb_truncate || dax_truncate)
 		fuse_release_nowrite(inode);
@@ -280,6 +355,7 @@ static void fuse_prepare_release(struct fuse_inode *fi, struct fuse_file *ff,
 
 	/* Inode is NULL on error path of fuse_create_open() */
 	if (likely(fi)) {
+		fuse_file_io_release(ff, fi);
 		spin_lock(&fi->lock);
 		list_del(&ff->write_entry);
 		spin_unlock(&fi->lock);
@@ -1630,6 +1706,9 @@ static ssize_t fuse_file_read_iter(struct kiocb *iocb, struct iov_iter *to)
 	if (FUSE_IS_DAX(inode))
 		return fuse_dax_read_iter(iocb, to);
 
+	if (fuse_file_passthrough(ff))
+		return fuse_passthrough_read_iter(iocb, to);
+
 	if (!(ff->open_flags & FOPEN_DIRECT_IO))
 		return fuse_cache_read_iter(iocb, to);
 	else
@@ -1648,12 +1727,38 @@ static ssize_t fuse_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
 	if (FUSE_IS_DAX(inode))
 		return fuse_dax_write_iter(iocb, from);
 
+	if (fuse_file_passthrough(ff))
+		return fuse_passthrough_write_iter(iocb, from);
+
 	if (!(ff->open_flags & FOPEN_DIRECT_IO))
 		return fuse_cache_write_iter(iocb, from);
 	else
 		return fuse_direct_write_iter(iocb, from);
 }
 
+static ssize_t fuse_splice_read(struct file *in, loff_t *ppos,
+				struct pipe_inode_info *pipe, size_t len,
+				unsigned int flags)
+{
+	struct fuse_file *ff = in->private_data;
+
+	if (fuse_file_passthrough(ff))
+		return fuse_passthrough_splice_read(in, ppos, pipe, len, flags);
+
+	return filemap_splice_read(in, ppos, pipe, len, flags);
+}
+
+static ssize_t fuse_splice_write(struct pipe_inode_info *pipe, struct file *out,
+				 loff_t *ppos, size_t len, unsigned int flags)
+{
+	struct fuse_file *ff = out->private_data;
+
+	if (fuse_file_passthrough(ff))
+		return fuse_passthrough_splice_write(pipe, out, ppos, len, flags);
+
+	return iter_file_splice_write(pipe, out, ppos, len, flags);
+}
+
 static void fuse_writepage_free(struct fuse_writepage_args *wpa)
 {
 	struct fuse_args_pages *ap = &wpa->ia.ap;
@@ -2472,6 +2577,9 @@ static int fuse_file_mmap(struct file *file, struct vm_area_struct *vma)
 	if (FUSE_IS_DAX(file_inode(file)))
 		return fuse_dax_mmap(file, vma);
 
+	if (fuse_file_passthrough(ff))
+		return fuse_passthrough_mmap(file, vma);
+
 	if (ff->open_flags & FOPEN_DIRECT_IO) {
 		/*
 		 * Can't provide the coherency needed for MAP_SHARED
@@ -3222,8 +3330,8 @@ static const struct file_operations fuse_file_operations = {
 	.lock		= fuse_file_lock,
 	.get_unmapped_area = thp_get_unmapped_area,
 	.flock		= fuse_file_flock,
-	.splice_read	= filemap_splice_read,
-	.splice_write	= iter_file_splice_write,
+	.splice_read	= fuse_splice_read,
+	.splice_write	= fuse_splice_write,
 	.unlocked_ioctl	= fuse_file_ioctl,
 	.compat_ioctl	= fuse_file_compat_ioctl,
 	.poll		= fuse_file_poll,
@@ -3254,6 +3362,7 @@ void fuse_init_file_inode(struct inode *inode, unsigned int flags)
 	INIT_LIST_HEAD(&fi->write_files);
 	INIT_LIST_HEAD(&fi->queued_writes);
 	fi->writectr = 0;
+	fi->iocachectr = 0;
 	init_waitqueue_head(&fi->page_waitq);
 	fi->writepages = RB_ROOT;
 
@@ -35,9 +35,12 @@
 /** Default max number of pages that can be used in a single read request */
 #define FUSE_DEFAULT_MAX_PAGES_PER_REQ 32
 
-/** Maximum of max_pages received in init_out */
+/** Default maximum of max_pages received in init_out */
 #define FUSE_MAX_MAX_PAGES 256
 
+/** Upper bound of the max_pages_limit module parameter */
+#define FUSE_MAX_PAGES_LIMIT 4096
+
 /** Bias for fi->writectr, meaning new writepages must not be sent */
 #define FUSE_NOWRITE INT_MIN
 
@@ -47,6 +50,26 @@
 /** Number of dentries for each connection in the control filesystem */
 #define FUSE_CTL_NUM_DENTRIES 5
 
+/*
+ * Passthrough protocol of FUSE 7.40, for <linux/fuse.h> predating it.  The
+ * backing id is returned by the server in what older headers call the
+ * padding of struct fuse_open_out.
+ */
+#ifndef FUSE_PASSTHROUGH
+#define FUSE_PASSTHROUGH	(1ULL << 37)
+#define FOPEN_PASSTHROUGH	(1 << 7)
+
+struct fuse_backing_map {
+	int32_t		fd;
+	uint32_t	flags;
+	uint64_t	padding;
+};
+
+#define FUSE_DEV_IOC_BACKING_OPEN	_IOW(FUSE_DEV_IOC_MAGIC, 1, \
+					     struct fuse_backing_map)
+#define FUSE_DEV_IOC_BACKING_CLOSE	_IOW(FUSE_DEV_IOC_MAGIC, 2, uint32_t)
+#endif
+
 /** List of active connections */
 extern struct list_head fuse_conn_list;
 
@@ -128,6 +151,10 @@ struct fuse_inode {
 
 			/* List of writepage requestst (pending or sent) */
 			struct rb_root writepages;
+
+			/* Number of opens using the page cache, or minus the
+			 * number of passthrough opens.  Protected by fi->lock */
+			int iocachectr;
 		};
 
 		/* readdir cache (directory only) */
@@ -193,6 +220,13 @@ struct fuse_conn;
 struct fuse_mount;
 struct fuse_release_args;
 
+/** I/O mode taken by an open file, see fuse_file_io_open() */
+enum fuse_file_iomode {
+	FUSE_IOM_NONE,
+	FUSE_IOM_CACHED,
+	FUSE_IOM_PASSTHROUGH,
+};
+
 /** FUSE specific file data */
 struct fuse_file {
 	/** Fuse connection for this file */
@@ -246,6 +280,30 @@ struct fuse_file {
 
 	/** Has flock been performed on this file? */
 	bool flock:1;
+
+	/** Page cache use accounted in fi->iocachectr */
+	enum fuse_file_iomode iomode;
+
+#ifdef CONFIG_FUSE_PASSTHROUGH
+	/** Backing id returned by open, if FOPEN_PASSTHROUGH */
+	int backing_id;
+
+	/** Backing file that reads and writes are passed through to */
+	struct file *passthrough;
+
+	/** Credentials of the server that registered the backing file */
+	const struct cred *cred;
+#endif
+};
+
+/** A backing file registered with FUSE_DEV_IOC_BACKING_OPEN */
+struct fuse_backing {
+	struct file *file;
+	struct cred *cred;
+
+	/** refcount */
+	refcount_t count;
+	struct rcu_head rcu;
 };
 
 /** One input argument of a request */
@@ -818,6 +876,12 @@ struct fuse_conn {
 	/* Is statx not implemented by fs? */
 	unsigned int no_statx:1;
 
+	/* Reads and writes may be passed through to backing files */
+	unsigned int passthrough:1;
+
+	/** Maximum stack depth of the backing files */
+	int max_stack_depth;
+
 	/** The number of requests waiting for completion */
 	atomic_t num_waiting;
 
@@ -867,6 +931,11 @@ struct fuse_conn {
 
 	/* New writepages go into this bucket */
 	struct fuse_sync_bucket __rcu *curr_bucket;
+
+#ifdef CONFIG_FUSE_PASSTHROUGH
+	/** IDR for backing files ids, protected by lock */
+	struct idr backing_files_map;
+#endif
 };
 
 /*
@@ -1038,7 +1107,7 @@ int fuse_open_common(struct inode *inode, struct file *file, bool isdir);
 
 struct fuse_file *fuse_file_alloc(struct fuse_mount *fm);
 void fuse_file_free(struct fuse_file *ff);
-void fuse_finish_open(struct inode *inode, struct file *file);
+int fuse_finish_open(struct inode *inode, struct file *file);
 
 void fuse_sync_release(struct fuse_inode *fi, struct fuse_file *ff,
 		       unsigned int flags);
@@ -1355,4 +1424,47 @@ struct fuse_file *fuse_file_open(struct fuse_mount *fm, u64 nodeid,
 void fuse_file_release(struct inode *inode, struct fuse_file *ff,
 		       unsigned int open_flags, fl_owner_t id, bool isdir);
 
+/* passthrough.c */
+
+#ifdef CONFIG_FUSE_PASSTHROUGH
+static inline bool fuse_file_passthrough(struct fuse_file *ff)
+{
+	return ff->passthrough;
+}
+
+void fuse_backing_files_init(struct fuse_conn *fc);
+void fuse_backing_files_free(struct fuse_conn *fc);
+int fuse_passthrough_open(struct inode *inode, struct file *file);
+void fuse_passthrough_release(struct fuse_file *ff);
+#else
+static inline bool fuse_file_passthrough(struct fuse_file *ff)
+{
+	return false;
+}
+
+static inline void fuse_backing_files_init(struct fuse_conn *fc) {}
+static inline void fuse_backing_files_free(struct fuse_conn *fc) {}
+
+static inline int fuse_passthrough_open(struct inode *inode,
+					struct file *file)
+{
+	return -EINVAL;
+}
+
+static inline void fuse_passthrough_release(struct fuse_file *ff) {}
+#endif
+
+/* Only called with CONFIG_FUSE_PASSTHROUGH, see fuse_file_passthrough() */
+int fuse_backing_open(struct fuse_conn *fc, struct fuse_backing_map *map);
+int fuse_backing_close(struct fuse_conn *fc, int backing_id);
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *iter);
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *iter);
+ssize_t fuse_passthrough_splice_read(struct file *in, loff_t *ppos,
+				     struct pipe_inode_info *pipe,
+				     size_t len, unsigned int flags);
+ssize_t fuse_passthrough_splice_write(struct pipe_inode_info *pipe,
+				      struct file *out, loff_t *ppos,
+				      size_t len, unsigned int flags);
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma);
+
 #endif /* _FS_FUSE_I_H */
@@ -0,0 +1,327 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * FUSE passthrough to backing files.
+ *
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * A server may register an open file with FUSE_DEV_IOC_BACKING_OPEN and
+ * return the id it gets for it with FOPEN_PASSTHROUGH from OPEN or CREATE.
+ * Reads, writes, splice and mmap of the FUSE file then go straight to the
+ * backing file with the credentials of the server, while open, release and
+ * all metadata operations keep going to the server.
+ */
+
+#include "fuse_i.h"
+
+#include <linux/file.h>
+#include <linux/idr.h>
+#include <linux/splice.h>
+#include <linux/uio.h>
+
+static struct fuse_backing *fuse_backing_get(struct fuse_backing *fb)
+{
+	if (fb && refcount_inc_not_zero(&fb->count))
+		return fb;
+	return NULL;
+}
+
+static void fuse_backing_free(struct fuse_backing *fb)
+{
+	if (fb->file)
+		fput(fb->file);
+	put_cred(fb->cred);
+	kfree_rcu(fb, rcu);
+}
+
+static void fuse_backing_put(struct fuse_backing *fb)
+{
+	if (fb && refcount_dec_and_test(&fb->count))
+		fuse_backing_free(fb);
+}
+
+void fuse_backing_files_init(struct fuse_conn *fc)
+{
+	idr_init(&fc->backing_files_map);
+}
+
+static int fuse_backing_id_free(int id, void *p, void *data)
+{
+	struct fuse_backing *fb = p;
+
+	WARN_ON_ONCE(refcount_read(&fb->count) != 1);
+	fuse_backing_free(fb);
+	return 0;
+}
+
+void fuse_backing_files_free(struct fuse_conn *fc)
+{
+	idr_for_each(&fc->backing_files_map, fuse_backing_id_free, NULL);
+	idr_destroy(&fc->backing_files_map);
+}
+
+static struct fuse_backing *fuse_backing_lookup(struct fuse_conn *fc,
+						int backing_id)
+{
+	struct fuse_backing *fb;
+
+	rcu_read_lock();
+	fb = idr_find(&fc->backing_files_map, backing_id);
+	fb = fuse_backing_get(fb);
+	rcu_read_unlock();
+
+	return fb;
+}
+
+int fuse_backing_open(struct fuse_conn *fc, struct fuse_backing_map *map)
+{
+	struct file *file;
+	struct super_block *backing_sb;
+	struct fuse_backing *fb = NULL;
+	int res;
+
+	/* The backing file is accessed with the credentials of the server */
+	res = -EPERM;
+	if (!fc->passthrough || !capable(CAP_SYS_ADMIN))
+		goto out;
+
+	res = -EINVAL;
+	if (map->flags || map->padding)
+		goto out;
+
+	file = fget(map->fd);
+	res = -EBADF;
+	if (!file)
+		goto out;
+
+	res = -EOPNOTSUPP;
+	if (!S_ISREG(file_inode(file)->i_mode) ||
+	    !file->f_op->read_iter || !file->f_op->write_iter)
+		goto out_fput;
+
+	backing_sb = file_inode(file)->i_sb;
+	res = -ELOOP;
+	if (backing_sb->s_stack_depth >= fc->max_stack_depth)
+		goto out_fput;
+
+	fb = kmalloc(sizeof(struct fuse_backing), GFP_KERNEL);
+	res = -ENOMEM;
+	if (!fb)
+		goto out_fput;
+
+	fb->cred = prepare_creds();
+	if (!fb->cred) {
+		kfree(fb);
+		fb = NULL;
+		goto out_fput;
+	}
+	fb->file = file;
+	refcount_set(&fb->count, 1);
+
+	idr_preload(GFP_KERNEL);
+	spin_lock(&fc->lock);
+	res = idr_alloc_cyclic(&fc->backing_files_map, fb, 1, 0, GFP_ATOMIC);
+	spin_unlock(&fc->lock);
+	idr_preload_end();
+	if (res < 0) {
+		fuse_backing_free(fb);
+		fb = NULL;
+	}
+out:
+	pr_debug("%s: fb=0x%p, ret=%i\n", __func__, fb, res);
+
+	return res;
+
+out_fput:
+	fput(file);
+	goto out;
+}
+
+int fuse_backing_close(struct fuse_conn *fc, int backing_id)
+{
+	struct fuse_backing *fb;
+
+	if (!fc->passthrough || !capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	if (backing_id <= 0)
+		return -EINVAL;
+
+	spin_lock(&fc->lock);
+	fb = idr_remove(&fc->backing_files_map, backing_id);
+	spin_unlock(&fc->lock);
+	if (!fb)
+		return -ENOENT;
+
+	/* Files already opened with it keep their own backing file */
+	fuse_backing_put(fb);
+
+	return 0;
+}
+
+/*
+ * Open a backing file for @file, with the path of @file so that it is what
+ * shows in /proc/<pid>/maps for mappings of it.
+ */
+int fuse_passthrough_open(struct inode *inode, struct file *file)
+{
+	struct fuse_file *ff = file->private_data;
+	struct fuse_conn *fc = get_fuse_conn(inode);
+	struct fuse_backing *fb;
+	struct file *backing_file;
+	int err;
+
+	if (!fc->passthrough || FUSE_IS_DAX(inode))
+		return -EINVAL;
+
+	fb = fuse_backing_lookup(fc, ff->backing_id);
+	if (!fb)
+		return -ENOENT;
+
+	backing_file = backing_file_open(&file->f_path, file->f_flags,
+					 &fb->file->f_path, fb->cred);
+	err = PTR_ERR_OR_ZERO(backing_file);
+	if (!err) {
+		ff->passthrough = backing_file;
+		ff->cred = get_cred(fb->cred);
+	}
+	fuse_backing_put(fb);
+
+	return err;
+}
+
+void fuse_passthrough_release(struct fuse_file *ff)
+{
+	if (!ff->passthrough)
+		return;
+
+	fput(ff->passthrough);
+	ff->passthrough = NULL;
+	put_cred(ff->cred);
+	ff->cred = NULL;
+}
+
+static rwf_t fuse_iocb_to_rwf(int ifl)
+{
+	rwf_t flags = 0;
+
+	if (ifl & IOCB_NOWAIT)
+		flags |= RWF_NOWAIT;
+	if (ifl & IOCB_HIPRI)
+		flags |= RWF_HIPRI;
+	if (ifl & IOCB_DSYNC)
+		flags |= RWF_DSYNC;
+	if (ifl & IOCB_SYNC)
+		flags |= RWF_SYNC;
+
+	return flags;
+}
+
+/*
+ * Async kiocbs are completed synchronously, the backing file is usually on
+ * a local filesystem where that costs little.
+ */
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *iter)
+{
+	struct file *file = iocb->ki_filp;
+	struct fuse_file *ff = file->private_data;
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!iov_iter_count(iter))
+		return 0;
+
+	old_cred = override_creds(ff->cred);
+	ret = vfs_iter_read(ff->passthrough, iter, &iocb->ki_pos,
+			    fuse_iocb_to_rwf(iocb->ki_flags));
+	revert_creds(old_cred);
+	if (ret >= 0)
+		file_accessed(file);
+
+	return ret;
+}
+
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *iter)
+{
+	struct file *file = iocb->ki_filp;
+	struct inode *inode = file_inode(file);
+	struct fuse_file *ff = file->private_data;
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!iov_iter_count(iter))
+		return 0;
+
+	inode_lock(inode);
+	old_cred = override_creds(ff->cred);
+	file_start_write(ff->passthrough);
+	ret = vfs_iter_write(ff->passthrough, iter, &iocb->ki_pos,
+			     fuse_iocb_to_rwf(iocb->ki_flags));
+	file_end_write(ff->passthrough);
+	revert_creds(old_cred);
+	if (ret > 0)
+		fuse_write_update_attr(inode, iocb->ki_pos, ret);
+	inode_unlock(inode);
+
+	return ret;
+}
+
+ssize_t fuse_passthrough_splice_read(struct file *in, loff_t *ppos,
+				     struct pipe_inode_info *pipe,
+				     size_t len, unsigned int flags)
+{
+	struct fuse_file *ff = in->private_data;
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	old_cred = override_creds(ff->cred);
+	ret = vfs_splice_read(ff->passthrough, ppos, pipe, len, flags);
+	revert_creds(old_cred);
+	if (ret >= 0)
+		file_accessed(in);
+
+	return ret;
+}
+
+ssize_t fuse_passthrough_splice_write(struct pipe_inode_info *pipe,
+				      struct file *out, loff_t *ppos,
+				      size_t len, unsigned int flags)
+{
+	struct fuse_file *ff = out->private_data;
+	struct inode *inode = file_inode(out);
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	inode_lock(inode);
+	old_cred = override_creds(ff->cred);
+	file_start_write(ff->passthrough);
+	ret = iter_file_splice_write(pipe, ff->passthrough, ppos, len, flags);
+	file_end_write(ff->passthrough);
+	revert_creds(old_cred);
+	if (ret > 0)
+		fuse_write_update_attr(inode, *ppos, ret);
+	inode_unlock(inode);
+
+	return ret;
+}
+
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fuse_file *ff = file->private_data;
+	const struct cred *old_cred;
+	int ret;
+
+	if (!ff->passthrough->f_op->mmap)
+		return -ENODEV;
+
+	if (WARN_ON(file != vma->vm_file))
+		return -EIO;
+
+	vma_set_file(vma, ff->passthrough);
+
+	old_cred = override_creds(ff->cred);
+	ret = call_mmap(vma->vm_file, vma);
+	revert_creds(old_cred);
+	file_accessed(file);
+
+	return ret;
+}
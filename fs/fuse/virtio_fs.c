@@ -16,7 +16,10 @@
 #include <linux/fs_context.h>
 #include <linux/fs_parser.h>
 #include <linux/highmem.h>
+#include <linux/group_cpus.h>
+#include <linux/interrupt.h>
 #include <linux/uio.h>
+#include <linux/virtio_ring.h>
 #include "fuse_i.h"
 
 /* Used to help calculate the FUSE connection's max_pages limit for a request's
@@ -25,6 +28,11 @@
  */
 #define FUSE_HEADER_OVERHEAD    4
 
+/* Largest request, in pages, sent with indirect descriptors.  The indirect
+ * table of such a request is a GFP_ATOMIC allocation of 16 bytes per page.
+ */
+#define VIRTIO_FS_MAX_INDIRECT_PAGES	1024
+
 /* List of virtio-fs device instances and a lock for the list. Also provides
  * mutual exclusion in device removal and mounting path
  */
@@ -61,6 +69,7 @@ struct virtio_fs {
 	struct virtio_fs_vq *vqs;
 	unsigned int nvqs;               /* number of virtqueues */
 	unsigned int num_request_queues; /* number of request queues */
+	unsigned int *mq_map;            /* request queue of each cpu */
 	struct dax_device *dax_dev;
 
 	/* DAX memory window where file contents are mapped */
@@ -165,6 +174,7 @@ static void release_virtio_fs_obj(struct kref *ref)
 {
 	struct virtio_fs *vfs = container_of(ref, struct virtio_fs, refcount);
 
+	kfree(vfs->mq_map);
 	kfree(vfs->vqs);
 	kfree(vfs);
 }
@@ -689,10 +699,52 @@ static void virtio_fs_init_vq(struct virtio_fs_vq *fsvq, char *name,
 	}
 }
 
+/*
+ * Map each CPU to a request queue, following the interrupt affinity of the
+ * queues if the transport spread them, so that requests complete on the CPU
+ * (or close to the CPU) that submitted them.
+ */
+static void virtio_fs_map_queues(struct virtio_device *vdev,
+				 struct virtio_fs *fs)
+{
+	const struct cpumask *mask;
+	struct cpumask *masks;
+	unsigned int q, cpu;
+
+	for_each_possible_cpu(cpu)
+		fs->mq_map[cpu] = VQ_REQUEST;
+
+	if (!vdev->config->get_vq_affinity)
+		goto fallback;
+
+	for (q = 0; q < fs->num_request_queues; q++) {
+		mask = vdev->config->get_vq_affinity(vdev, VQ_REQUEST + q);
+		if (!mask)
+			goto fallback;
+
+		for_each_cpu(cpu, mask)
+			fs->mq_map[cpu] = VQ_REQUEST + q;
+	}
+
+	return;
+fallback:
+	/* Spread the CPUs evenly over the queues */
+	masks = group_cpus_evenly(fs->num_request_queues);
+	if (!masks)
+		return;
+
+	for (q = 0; q < fs->num_request_queues; q++)
+		for_each_cpu(cpu, &masks[q])
+			fs->mq_map[cpu] = VQ_REQUEST + q;
+	kfree(masks);
+}
+
 /* Initialize virtqueues */
 static int virtio_fs_setup_vqs(struct virtio_device *vdev,
 			       struct virtio_fs *fs)
 {
+	/* Only the request queues can be spread over the CPUs */
+	struct irq_affinity desc = { .pre_vectors = VQ_REQUEST };
 	struct virtqueue **vqs;
 	vq_callback_t **callbacks;
 	const char **names;
@@ -704,11 +756,20 @@ static int virtio_fs_setup_vqs(struct virtio_device *vdev,
 	if (fs->num_request_queues == 0)
 		return -EINVAL;
 
+	/* More queues than CPUs are no use */
+	fs->num_request_queues = min_t(unsigned int, fs->num_request_queues,
+				       nr_cpu_ids);
 	fs->nvqs = VQ_REQUEST + fs->num_request_queues;
 	fs->vqs = kcalloc(fs->nvqs, sizeof(fs->vqs[VQ_HIPRIO]), GFP_KERNEL);
 	if (!fs->vqs)
 		return -ENOMEM;
 
+	fs->mq_map = kcalloc(nr_cpu_ids, sizeof(*fs->mq_map), GFP_KERNEL);
+	if (!fs->mq_map) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
 	vqs = kmalloc_array(fs->nvqs, sizeof(vqs[VQ_HIPRIO]), GFP_KERNEL);
 	callbacks = kmalloc_array(fs->nvqs, sizeof(callbacks[VQ_HIPRIO]),
 					GFP_KERNEL);
@@ -733,20 +794,24 @@ static int virtio_fs_setup_vqs(struct virtio_device *vdev,
 		names[i] = fs->vqs[i].name;
 	}
 
-	ret = virtio_find_vqs(vdev, fs->nvqs, vqs, callbacks, names, NULL);
+	ret = virtio_find_vqs(vdev, fs->nvqs, vqs, callbacks, names, &desc);
 	if (ret < 0)
 		goto out;
 
 	for (i = 0; i < fs->nvqs; i++)
 		fs->vqs[i].vq = vqs[i];
 
+	virtio_fs_map_queues(vdev, fs);
 	virtio_fs_start_all_queues(fs);
 out:
 	kfree(names);
 	kfree(callbacks);
 	kfree(vqs);
-	if (ret)
+	if (ret) {
+		kfree(fs->mq_map);
+		fs->mq_map = NULL;
 		kfree(fs->vqs);
+	}
 	return ret;
 }
 
@@ -886,8 +951,6 @@ static int virtio_fs_probe(struct virtio_device *vdev)
 	if (ret < 0)
 		goto out;
 
-	/* TODO vq affinity */
-
 	ret = virtio_fs_setup_dax(vdev, fs);
 	if (ret < 0)
 		goto out_vqs;
@@ -906,6 +969,7 @@ static int virtio_fs_probe(struct virtio_device *vdev)
 out_vqs:
 	virtio_reset_device(vdev);
 	virtio_fs_cleanup_vqs(vdev);
+	kfree(fs->mq_map);
 	kfree(fs->vqs);
 
 out:
@@ -1234,7 +1298,7 @@ static int virtio_fs_enqueue_req(struct virtio_fs_vq *fsvq,
 static void virtio_fs_wake_pending_and_unlock(struct fuse_iqueue *fiq)
 __releases(fiq->lock)
 {
-	unsigned int queue_id = VQ_REQUEST; /* TODO multiqueue */
+	unsigned int queue_id;
 	struct virtio_fs *fs;
 	struct fuse_req *req;
 	struct virtio_fs_vq *fsvq;
@@ -1248,6 +1312,7 @@ __releases(fiq->lock)
 	spin_unlock(&fiq->lock);
 
 	fs = fiq->priv;
+	queue_id = fs->mq_map[raw_smp_processor_id()];
 
 	pr_debug("%s: opcode %u unique %#llx nodeid %#llx in.len %u out.len %u\n",
 		  __func__, req->in.h.opcode, req->in.h.unique,
@@ -1459,7 +1524,15 @@ static int virtio_fs_get_tree(struct fs_context *fsc)
 	fc->auto_submounts = true;
 	fc->sync_fs = true;
 
-	/* Tell FUSE to split requests that exceed the virtqueue's size */
+	/*
+	 * Tell FUSE to split requests that exceed the virtqueue's size, unless
+	 * a request takes a single descriptor pointing to an indirect table.
+	 */
+	if (virtio_has_feature(fs->vqs[VQ_REQUEST].vq->vdev,
+			       VIRTIO_RING_F_INDIRECT_DESC))
+		virtqueue_size = max_t(unsigned int, virtqueue_size,
+				       VIRTIO_FS_MAX_INDIRECT_PAGES +
+				       FUSE_HEADER_OVERHEAD);
 	fc->max_pages_limit = min_t(unsigned int, fc->max_pages_limit,
 				    virtqueue_size - FUSE_HEADER_OVERHEAD);
 
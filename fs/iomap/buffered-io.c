@@ -93,6 +93,49 @@ static inline bool ifs_block_is_dirty(struct folio *folio,
 	return test_bit(block + blks_per_folio, ifs->state);
 }
 
+/*
+ * Find the next run of dirty blocks in the folio from *range_start, up to
+ * range_end.  Returns its length and moves *range_start to its start, or
+ * returns 0 if there is none.
+ */
+static unsigned ifs_find_dirty_range(struct folio *folio,
+		struct iomap_folio_state *ifs, u64 *range_start, u64 range_end)
+{
+	struct inode *inode = folio->mapping->host;
+	unsigned start_blk =
+		offset_in_folio(folio, *range_start) >> inode->i_blkbits;
+	unsigned end_blk = min_not_zero(
+		offset_in_folio(folio, range_end) >> inode->i_blkbits,
+		i_blocks_per_folio(inode, folio));
+	unsigned nblks = 1;
+
+	while (!ifs_block_is_dirty(folio, ifs, start_blk))
+		if (++start_blk == end_blk)
+			return 0;
+
+	while (start_blk + nblks < end_blk) {
+		if (!ifs_block_is_dirty(folio, ifs, start_blk + nblks))
+			break;
+		nblks++;
+	}
+
+	*range_start = folio_pos(folio) + (start_blk << inode->i_blkbits);
+	return nblks << inode->i_blkbits;
+}
+
+static unsigned iomap_find_dirty_range(struct folio *folio, u64 *range_start,
+		u64 range_end)
+{
+	struct iomap_folio_state *ifs = folio->private;
+
+	if (*range_start >= range_end)
+		return 0;
+
+	if (ifs)
+		return ifs_find_dirty_range(folio, ifs, range_start, range_end);
+	return range_end - *range_start;
+}
+
 static void ifs_clear_range_dirty(struct folio *folio,
 		struct iomap_folio_state *ifs, size_t off, size_t len)
 {
@@ -1730,12 +1773,12 @@ iomap_can_add_to_ioend(struct iomap_writepage_ctx *wpc, loff_t offset,
  * first; otherwise finish off the current ioend and start another.
  */
 static void
-iomap_add_to_ioend(struct inode *inode, loff_t pos, struct folio *folio,
-		struct iomap_folio_state *ifs, struct iomap_writepage_ctx *wpc,
-		struct writeback_control *wbc, struct list_head *iolist)
+iomap_add_to_ioend(struct inode *inode, loff_t pos, unsigned len,
+		struct folio *folio, struct iomap_folio_state *ifs,
+		struct iomap_writepage_ctx *wpc, struct writeback_control *wbc,
+		struct list_head *iolist)
 {
 	sector_t sector = iomap_sector(&wpc->iomap, pos);
-	unsigned len = i_blocksize(inode);
 	size_t poff = offset_in_folio(folio, pos);
 
 	if (!wpc->ioend || !iomap_can_add_to_ioend(wpc, pos, sector)) {
@@ -1778,10 +1821,10 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 {
 	struct iomap_folio_state *ifs = folio->private;
 	struct iomap_ioend *ioend, *next;
-	unsigned len = i_blocksize(inode);
 	unsigned nblocks = i_blocks_per_folio(inode, folio);
 	u64 pos = folio_pos(folio);
-	int error = 0, count = 0, i;
+	unsigned dirty_len;
+	int error = 0, count = 0;
 	LIST_HEAD(submit_list);
 
 	WARN_ON_ONCE(end_pos <= pos);
@@ -1794,26 +1837,40 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 	WARN_ON_ONCE(ifs && atomic_read(&ifs->write_bytes_pending) != 0);
 
 	/*
-	 * Walk through the folio to find areas to write back. If we
-	 * run off the end of the current map or find the current map
-	 * invalid, grab a new one.
+	 * Walk through the folio to find runs of dirty blocks to write back,
+	 * and add as much of each to the ioend as the current map covers.  If
+	 * we run off the end of the current map or find the current map
+	 * invalid, grab a new one.  With large folios this adds a run of
+	 * blocks to the bio at once instead of a block at a time.
 	 */
-	for (i = 0; i < nblocks && pos < end_pos; i++, pos += len) {
-		if (ifs && !ifs_block_is_dirty(folio, ifs, i))
-			continue;
-
-		error = wpc->ops->map_blocks(wpc, inode, pos);
-		if (error)
-			break;
-		trace_iomap_writepage_map(inode, &wpc->iomap);
-		if (WARN_ON_ONCE(wpc->iomap.type == IOMAP_INLINE))
-			continue;
-		if (wpc->iomap.type == IOMAP_HOLE)
-			continue;
-		iomap_add_to_ioend(inode, pos, folio, ifs, wpc, wbc,
-				 &submit_list);
-		count++;
+	end_pos = min_t(u64, round_up(end_pos, i_blocksize(inode)),
+			folio_pos(folio) + folio_size(folio));
+	while ((dirty_len = iomap_find_dirty_range(folio, &pos, end_pos))) {
+		while (dirty_len) {
+			unsigned map_len;
+
+			error = wpc->ops->map_blocks(wpc, inode, pos);
+			if (error)
+				goto map_done;
+			trace_iomap_writepage_map(inode, &wpc->iomap);
+
+			map_len = min_t(u64, dirty_len,
+				wpc->iomap.offset + wpc->iomap.length - pos);
+			if (WARN_ON_ONCE(!map_len)) {
+				error = -EIO;
+				goto map_done;
+			}
+			if (wpc->iomap.type != IOMAP_HOLE &&
+			    !WARN_ON_ONCE(wpc->iomap.type == IOMAP_INLINE)) {
+				iomap_add_to_ioend(inode, pos, map_len, folio,
+						   ifs, wpc, wbc, &submit_list);
+				count++;
+			}
+			pos += map_len;
+			dirty_len -= map_len;
+		}
 	}
+map_done:
 	if (count)
 		wpc->ioend->io_folios++;
 
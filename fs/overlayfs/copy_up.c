@@ -19,6 +19,7 @@
 #include <linux/fdtable.h>
 #include <linux/ratelimit.h>
 #include <linux/exportfs.h>
+#include <linux/workqueue.h>
 #include "overlayfs.h"
 
 #define OVL_COPY_UP_CHUNK_SIZE (1 << 20)
@@ -37,6 +38,11 @@ static int ovl_ccup_get(char *buf, const struct kernel_param *param)
 module_param_call(check_copy_up, ovl_ccup_set, ovl_ccup_get, NULL, 0644);
 MODULE_PARM_DESC(check_copy_up, "Obsolete; does nothing");
 
+static bool ovl_lazy_data_copy_up;
+module_param_named(lazy_data_copy_up, ovl_lazy_data_copy_up, bool, 0644);
+MODULE_PARM_DESC(lazy_data_copy_up,
+		 "Copy up data of metacopy files opened for write in the background");
+
 static bool ovl_must_copy_xattr(const char *name)
 {
 	return !strcmp(name, XATTR_POSIX_ACL_ACCESS) ||
@@ -1168,6 +1174,79 @@ static bool ovl_open_need_copy_up(struct dentry *dentry, int flags)
 	return true;
 }
 
+struct ovl_data_copy_up_work {
+	struct work_struct work;
+	struct dentry *dentry;
+};
+
+static void ovl_data_copy_up_workfn(struct work_struct *work)
+{
+	struct ovl_data_copy_up_work *dw =
+		container_of(work, struct ovl_data_copy_up_work, work);
+	struct dentry *dentry = dw->dentry;
+	struct super_block *sb = dentry->d_sb;
+	int err;
+
+	err = ovl_want_write(dentry);
+	if (!err) {
+		err = ovl_copy_up_flags(dentry, O_WRONLY);
+		ovl_drop_write(dentry);
+	}
+	/* Not fatal, the first write will retry the copy up */
+	if (err)
+		pr_warn_ratelimited("background data copy up of %pd2 failed (%i)\n",
+				    dentry, err);
+
+	ovl_clear_flag(OVL_DATA_COPY_UP, d_inode(dentry));
+	dput(dentry);
+	deactivate_super(sb);
+	kfree(dw);
+}
+
+/*
+ * Open for write of a metacopy file only copies up the metadata and leaves
+ * copying the data to a worker.  Until the data is copied up, reads of the
+ * file are served from the lower data file and operations that modify data
+ * wait for the copy up in ovl_copy_up_with_data(), as the worker holds
+ * ovl_inode_lock() while copying.
+ */
+static bool ovl_lazy_copy_up(struct dentry *dentry, int flags)
+{
+	struct ovl_data_copy_up_work *dw;
+	struct inode *inode = d_inode(dentry);
+	int err;
+
+	if (!READ_ONCE(ovl_lazy_data_copy_up) ||
+	    !OVL_FS(dentry->d_sb)->config.metacopy ||
+	    !S_ISREG(inode->i_mode) || (flags & O_TRUNC))
+		return false;
+
+	/* Metadata only, if the file isn't copied up yet */
+	err = ovl_copy_up_flags(dentry, 0);
+	if (err || !ovl_dentry_needs_data_copy_up(dentry, flags))
+		return !err;
+
+	if (ovl_test_flag(OVL_DATA_COPY_UP, inode))
+		return true;
+
+	dw = kmalloc(sizeof(*dw), GFP_KERNEL);
+	if (!dw)
+		return false;
+
+	if (test_and_set_bit(OVL_DATA_COPY_UP, &OVL_I(inode)->flags)) {
+		kfree(dw);
+		return true;
+	}
+
+	/* The file may be closed and the overlay unmounted before we are done */
+	atomic_inc(&dentry->d_sb->s_active);
+	dw->dentry = dget(dentry);
+	INIT_WORK(&dw->work, ovl_data_copy_up_workfn);
+	queue_work(system_unbound_wq, &dw->work);
+
+	return true;
+}
+
 int ovl_maybe_copy_up(struct dentry *dentry, int flags)
 {
 	int err = 0;
@@ -1175,7 +1254,8 @@ int ovl_maybe_copy_up(struct dentry *dentry, int flags)
 	if (ovl_open_need_copy_up(dentry, flags)) {
 		err = ovl_want_write(dentry);
 		if (!err) {
-			err = ovl_copy_up_flags(dentry, flags);
+			if (!ovl_lazy_copy_up(dentry, flags))
+				err = ovl_copy_up_flags(dentry, flags);
 			ovl_drop_write(dentry);
 		}
 	}
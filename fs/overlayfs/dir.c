@@ -268,6 +268,7 @@ static int ovl_instantiate(struct dentry *dentry, struct inode *inode,
 	};
 
 	ovl_dir_modified(dentry->d_parent, false);
+	ovl_dir_cache_set(dentry->d_parent, &dentry->d_name, newdentry);
 	ovl_dentry_set_upper_alias(dentry);
 	ovl_dentry_init_reval(dentry, newdentry, NULL);
 
@@ -782,6 +783,7 @@ static int ovl_remove_and_whiteout(struct dentry *dentry,
 		goto out_d_drop;
 
 	ovl_dir_modified(dentry->d_parent, true);
+	ovl_dir_cache_remove(dentry->d_parent, &dentry->d_name);
 out_d_drop:
 	d_drop(dentry);
 out_dput_upper:
@@ -828,6 +830,8 @@ static int ovl_remove_upper(struct dentry *dentry, bool is_dir,
 	else
 		err = ovl_do_unlink(ofs, dir, upper);
 	ovl_dir_modified(dentry->d_parent, ovl_type_origin(dentry));
+	if (!err)
+		ovl_dir_cache_remove(dentry->d_parent, &dentry->d_name);
 
 	/*
 	 * Keeping this dentry hashed would mean having to release
@@ -1263,10 +1267,16 @@ static int ovl_rename(struct mnt_idmap *idmap, struct inode *olddir,
 			ovl_drop_nlink(new);
 	}
 
+	/* the rename exchanged olddentry and newdentry in the upper fs */
 	ovl_dir_modified(old->d_parent, ovl_type_origin(old) ||
 			 (!overwrite && ovl_type_origin(new)));
+	if (overwrite)
+		ovl_dir_cache_remove(old->d_parent, &old->d_name);
+	else
+		ovl_dir_cache_set(old->d_parent, &old->d_name, newdentry);
 	ovl_dir_modified(new->d_parent, ovl_type_origin(old) ||
 			 (d_inode(new) && ovl_type_origin(new)));
+	ovl_dir_cache_set(new->d_parent, &new->d_name, olddentry);
 
 	/* copy ctime: */
 	ovl_copyattr(d_inode(old));
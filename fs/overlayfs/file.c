@@ -151,6 +151,39 @@ static int ovl_real_fdget(const struct file *file, struct fd *real)
 	return ovl_real_fdget_meta(file, real, false);
 }
 
+/*
+ * Data of a file opened for write may still be copied up in the background,
+ * so wait for that (or do it) before modifying it.
+ */
+static int ovl_wait_data_copy_up(const struct file *file)
+{
+	struct dentry *dentry = file_dentry(file);
+	int err;
+
+	if (!(file->f_mode & FMODE_WRITE) ||
+	    likely(ovl_has_upperdata(d_inode(dentry))))
+		return 0;
+
+	err = ovl_want_write(dentry);
+	if (!err) {
+		err = ovl_copy_up_with_data(dentry);
+		ovl_drop_write(dentry);
+	}
+
+	return err;
+}
+
+static int ovl_real_fdget_write(const struct file *file, struct fd *real)
+{
+	int err;
+
+	err = ovl_wait_data_copy_up(file);
+	if (err)
+		return err;
+
+	return ovl_real_fdget(file, real);
+}
+
 static int ovl_open(struct inode *inode, struct file *file)
 {
 	struct dentry *dentry = file_dentry(file);
@@ -170,7 +203,11 @@ static int ovl_open(struct inode *inode, struct file *file)
 	/* No longer need these flags, so don't pass them on to underlying fs */
 	file->f_flags &= ~(O_CREAT | O_EXCL | O_NOCTTY | O_TRUNC);
 
-	ovl_path_realdata(dentry, &realpath);
+	/* Data copy up may be in progress, writes go to upper regardless */
+	if (ovl_open_flags_need_copy_up(file->f_flags))
+		ovl_path_upper(dentry, &realpath);
+	else
+		ovl_path_realdata(dentry, &realpath);
 	if (!realpath.dentry)
 		return -EIO;
 
@@ -378,7 +415,7 @@ static ssize_t ovl_write_iter(struct kiocb *iocb, struct iov_iter *iter)
 	if (ret)
 		goto out_unlock;
 
-	ret = ovl_real_fdget(file, &real);
+	ret = ovl_real_fdget_write(file, &real);
 	if (ret)
 		goto out_unlock;
 
@@ -478,7 +515,7 @@ static ssize_t ovl_splice_write(struct pipe_inode_info *pipe, struct file *out,
 	if (ret)
 		goto out_unlock;
 
-	ret = ovl_real_fdget(out, &real);
+	ret = ovl_real_fdget_write(out, &real);
 	if (ret)
 		goto out_unlock;
 
@@ -537,6 +574,11 @@ static int ovl_mmap(struct file *file, struct vm_area_struct *vma)
 	if (WARN_ON(file != vma->vm_file))
 		return -EIO;
 
+	/* The upper file of a writer may have no data yet, see ovl_open() */
+	ret = ovl_wait_data_copy_up(file);
+	if (ret)
+		return ret;
+
 	vma_set_file(vma, realfile);
 
 	old_cred = ovl_override_creds(file_inode(file)->i_sb);
@@ -561,7 +603,7 @@ static long ovl_fallocate(struct file *file, int mode, loff_t offset, loff_t len
 	if (ret)
 		goto out_unlock;
 
-	ret = ovl_real_fdget(file, &real);
+	ret = ovl_real_fdget_write(file, &real);
 	if (ret)
 		goto out_unlock;
 
@@ -623,7 +665,7 @@ static loff_t ovl_copyfile(struct file *file_in, loff_t pos_in,
 			goto out_unlock;
 	}
 
-	ret = ovl_real_fdget(file_out, &real_out);
+	ret = ovl_real_fdget_write(file_out, &real_out);
 	if (ret)
 		goto out_unlock;
 
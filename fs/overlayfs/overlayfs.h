@@ -53,6 +53,8 @@ enum ovl_inode_flag {
 	OVL_CONST_INO,
 	OVL_HAS_DIGEST,
 	OVL_VERIFIED_DIGEST,
+	/* Background data copy up queued or running */
+	OVL_DATA_COPY_UP,
 };
 
 enum ovl_entry_flag {
@@ -669,6 +671,9 @@ void ovl_cleanup_whiteouts(struct ovl_fs *ofs, struct dentry *upper,
 			   struct list_head *list);
 void ovl_cache_free(struct list_head *list);
 void ovl_dir_cache_free(struct inode *inode);
+void ovl_dir_cache_set(struct dentry *dir, const struct qstr *name,
+		       struct dentry *upper);
+void ovl_dir_cache_remove(struct dentry *dir, const struct qstr *name);
 int ovl_check_d_type_supported(const struct path *realpath);
 int ovl_workdir_cleanup(struct ovl_fs *ofs, struct inode *dir,
 			struct vfsmount *mnt, struct dentry *dentry, int level);
@@ -28,9 +28,22 @@ struct ovl_cache_entry {
 	char name[];
 };
 
+/*
+ * A merged dir cache is referenced by the inode and by every open dir file
+ * using it.  When inode numbers are stable across copy up, the inode keeps
+ * its reference after the last file is closed, so that reopening the dir
+ * doesn't merge the layers again, and changes made through the overlay
+ * update the idle cache in place.  It is rebuilt once the dir version or the
+ * ctime of the upper dir no longer match, and freed with the inode.
+ *
+ * Impure caches of real dirs are only referenced by the inode, with a zero
+ * refcount.
+ */
 struct ovl_dir_cache {
 	long refcount;
 	u64 version;
+	struct timespec64 upper_ctime;
+	bool persistent;
 	struct list_head entries;
 	struct rb_root root;
 };
@@ -235,16 +248,31 @@ void ovl_dir_cache_free(struct inode *inode)
 	}
 }
 
+/* Drops the reference of @inode to its dir cache */
+static void ovl_dir_cache_detach(struct inode *inode)
+{
+	struct ovl_dir_cache *cache = ovl_dir_cache(inode);
+
+	if (!cache)
+		return;
+
+	ovl_set_dir_cache(inode, NULL);
+	if (!cache->refcount || !--cache->refcount) {
+		ovl_cache_free(&cache->entries);
+		kfree(cache);
+	}
+}
+
 static void ovl_cache_put(struct ovl_dir_file *od, struct inode *inode)
 {
 	struct ovl_dir_cache *cache = od->cache;
 
 	WARN_ON(cache->refcount <= 0);
 	cache->refcount--;
-	if (!cache->refcount) {
-		if (ovl_dir_cache(inode) == cache)
-			ovl_set_dir_cache(inode, NULL);
-
+	if (cache->refcount == 1 && !cache->persistent &&
+	    ovl_dir_cache(inode) == cache) {
+		ovl_dir_cache_detach(inode);
+	} else if (!cache->refcount) {
 		ovl_cache_free(&cache->entries);
 		kfree(cache);
 	}
@@ -390,6 +418,21 @@ static void ovl_seek_cursor(struct ovl_dir_file *od, loff_t pos)
 	od->cursor = p;
 }
 
+static struct timespec64 ovl_dir_upper_ctime(struct dentry *dentry)
+{
+	struct dentry *upper = ovl_dentry_upper(dentry);
+
+	return upper ? inode_get_ctime(d_inode(upper)) : (struct timespec64) {};
+}
+
+static bool ovl_cache_valid(struct dentry *dentry, struct ovl_dir_cache *cache)
+{
+	struct timespec64 ctime = ovl_dir_upper_ctime(dentry);
+
+	return ovl_inode_version_get(d_inode(dentry)) == cache->version &&
+	       timespec64_equal(&ctime, &cache->upper_ctime);
+}
+
 static struct ovl_dir_cache *ovl_cache_get(struct dentry *dentry)
 {
 	int res;
@@ -397,18 +440,19 @@ static struct ovl_dir_cache *ovl_cache_get(struct dentry *dentry)
 	struct inode *inode = d_inode(dentry);
 
 	cache = ovl_dir_cache(inode);
-	if (cache && ovl_inode_version_get(inode) == cache->version) {
-		WARN_ON(!cache->refcount);
+	if (cache && cache->refcount && ovl_cache_valid(dentry, cache)) {
 		cache->refcount++;
 		return cache;
 	}
-	ovl_set_dir_cache(d_inode(dentry), NULL);
+	ovl_dir_cache_detach(inode);
 
 	cache = kzalloc(sizeof(struct ovl_dir_cache), GFP_KERNEL);
 	if (!cache)
 		return ERR_PTR(-ENOMEM);
 
-	cache->refcount = 1;
+	/* the inode's and the opener's */
+	cache->refcount = 2;
+	cache->persistent = ovl_same_dev(OVL_FS(dentry->d_sb));
 	INIT_LIST_HEAD(&cache->entries);
 	cache->root = RB_ROOT;
 
@@ -420,11 +464,120 @@ static struct ovl_dir_cache *ovl_cache_get(struct dentry *dentry)
 	}
 
 	cache->version = ovl_inode_version_get(inode);
+	cache->upper_ctime = ovl_dir_upper_ctime(dentry);
 	ovl_set_dir_cache(inode, cache);
 
 	return cache;
 }
 
+/*
+ * Returns the merged cache of @dir if it can be updated in place for the
+ * change just noted with ovl_dir_modified(): no open file has a cursor in
+ * it, and it was up to date before the change.  Otherwise the cache is left
+ * to be rebuilt on next use.
+ */
+static struct ovl_dir_cache *ovl_cache_get_idle(struct dentry *dir)
+{
+	struct inode *inode = d_inode(dir);
+	struct ovl_dir_cache *cache = ovl_dir_cache(inode);
+
+	if (!cache || cache->refcount != 1 ||
+	    cache->version + 1 != ovl_inode_version_get(inode))
+		return NULL;
+
+	return cache;
+}
+
+static struct ovl_cache_entry *ovl_cache_lookup(struct ovl_dir_cache *cache,
+						const struct qstr *name)
+{
+	struct ovl_cache_entry *p;
+
+	p = ovl_cache_entry_find(&cache->root, name->name, name->len);
+	if (p)
+		return p;
+
+	/* Entries only in the lowest layer aren't in the tree */
+	list_for_each_entry(p, &cache->entries, l_node) {
+		if (p->len == name->len && !memcmp(p->name, name->name, p->len))
+			return p;
+	}
+
+	return NULL;
+}
+
+static void ovl_cache_updated(struct dentry *dir, struct ovl_dir_cache *cache)
+{
+	cache->version = ovl_inode_version_get(d_inode(dir));
+	cache->upper_ctime = ovl_dir_upper_ctime(dir);
+}
+
+/*
+ * Notes in the merged cache of @dir that @name now refers to @upper, after
+ * a create or a rename to @name.
+ */
+void ovl_dir_cache_set(struct dentry *dir, const struct qstr *name,
+		       struct dentry *upper)
+{
+	struct ovl_dir_cache *cache = ovl_cache_get_idle(dir);
+	struct ovl_readdir_data rdd = {
+		.dentry = dir,
+		.is_upper = true,
+	};
+	struct rb_node **newp, *parent = NULL;
+	struct inode *realinode;
+	struct ovl_cache_entry *p;
+
+	if (!cache || !upper || d_is_negative(upper))
+		return;
+
+	realinode = d_inode(upper);
+	p = ovl_cache_lookup(cache, name);
+	if (p) {
+		p->type = fs_umode_to_dtype(realinode->i_mode);
+		p->real_ino = realinode->i_ino;
+		/* Let ovl_iterate() look up d_ino again */
+		p->ino = 0;
+		p->is_upper = true;
+		p->is_whiteout = false;
+	} else {
+		p = ovl_cache_entry_new(&rdd, name->name, name->len,
+					realinode->i_ino,
+					fs_umode_to_dtype(realinode->i_mode));
+		if (!p)
+			return;
+
+		newp = &cache->root.rb_node;
+		ovl_cache_entry_find_link(name->name, name->len, &newp, &parent);
+		list_add_tail(&p->l_node, &cache->entries);
+		rb_link_node(&p->node, parent, newp);
+		rb_insert_color(&p->node, &cache->root);
+	}
+
+	ovl_cache_updated(dir, cache);
+}
+
+/*
+ * Notes in the merged cache of @dir that @name is gone, after an unlink or
+ * a rename from @name.  The entry is kept as a whiteout, so that the offsets
+ * of the other entries don't change.
+ */
+void ovl_dir_cache_remove(struct dentry *dir, const struct qstr *name)
+{
+	struct ovl_dir_cache *cache = ovl_cache_get_idle(dir);
+	struct ovl_cache_entry *p;
+
+	if (!cache)
+		return;
+
+	p = ovl_cache_lookup(cache, name);
+	if (!p || p->is_whiteout)
+		return;
+
+	p->is_whiteout = true;
+	ovl_cache_updated(dir, cache);
+}
+
 /* Map inode number to lower fs unique range */
 static u64 ovl_remap_lower_ino(u64 ino, int xinobits, int fsid,
 			       const char *name, int namelen, bool warn)
@@ -533,6 +533,113 @@ static int squashfs_readahead_fragment(struct page **page,
 	return error;
 }
 
+/* maximum number of datablocks of a readahead window decompressed at once */
+#define SQUASHFS_RA_MAX_JOBS	8
+
+struct squashfs_ra_ctl {
+	atomic_t		pending;
+	struct completion	done;
+};
+
+struct squashfs_ra_job {
+	struct work_struct	work;
+	struct squashfs_ra_ctl	*ctl;
+	struct inode		*inode;
+	struct page		**pages;
+	unsigned int		nr_pages;
+	unsigned int		expected;
+	u64			block;
+	int			bsize;
+	bool			last;
+};
+
+static void squashfs_readahead_block(struct squashfs_ra_job *job)
+{
+	struct inode *inode = job->inode;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	struct squashfs_page_actor *actor;
+	struct page *last_page;
+	int i, res;
+
+	actor = squashfs_page_actor_init_special(msblk, job->pages,
+						 job->nr_pages, job->expected);
+	if (!actor)
+		goto out;
+
+	res = squashfs_read_data(inode->i_sb, job->block, job->bsize, NULL,
+				 actor);
+
+	last_page = squashfs_page_actor_free(actor);
+
+	if (res == job->expected) {
+		int bytes;
+
+		/* Last page (if present) may have trailing bytes not filled */
+		bytes = res % PAGE_SIZE;
+		if (job->last && bytes && last_page)
+			memzero_page(last_page, bytes, PAGE_SIZE - bytes);
+
+		for (i = 0; i < job->nr_pages; i++) {
+			flush_dcache_page(job->pages[i]);
+			SetPageUptodate(job->pages[i]);
+		}
+	}
+
+out:
+	for (i = 0; i < job->nr_pages; i++) {
+		unlock_page(job->pages[i]);
+		put_page(job->pages[i]);
+	}
+}
+
+static void squashfs_readahead_work(struct work_struct *work)
+{
+	struct squashfs_ra_job *job =
+		container_of(work, struct squashfs_ra_job, work);
+	struct squashfs_ra_ctl *ctl = job->ctl;
+
+	squashfs_readahead_block(job);
+	if (atomic_dec_and_test(&ctl->pending))
+		complete(&ctl->done);
+}
+
+/*
+ * Decompress the datablocks collected so far, all but the first one on
+ * other CPUs.  Each datablock only touches its own pages, and there are
+ * no more of them than decompressors, so they don't wait on each other.
+ */
+static void squashfs_readahead_run(struct squashfs_ra_job *jobs,
+				   unsigned int nr)
+{
+	struct squashfs_ra_ctl ctl;
+	unsigned int i;
+
+	if (nr > 1) {
+		atomic_set(&ctl.pending, nr - 1);
+		init_completion(&ctl.done);
+		for (i = 1; i < nr; i++) {
+			jobs[i].ctl = &ctl;
+			INIT_WORK(&jobs[i].work, squashfs_readahead_work);
+			queue_work(system_unbound_wq, &jobs[i].work);
+		}
+	}
+
+	if (nr)
+		squashfs_readahead_block(&jobs[0]);
+
+	if (nr > 1)
+		wait_for_completion(&ctl.done);
+}
+
+static unsigned int squashfs_readahead_nr_jobs(struct squashfs_sb_info *msblk,
+					       struct readahead_control *ractl)
+{
+	unsigned int nr = readahead_length(ractl) >> msblk->block_log;
+
+	nr = min3(nr, num_online_cpus(), (unsigned int)SQUASHFS_RA_MAX_JOBS);
+	return min_t(unsigned int, nr, msblk->max_thread_num) ?: 1;
+}
+
 static void squashfs_readahead(struct readahead_control *ractl)
 {
 	struct inode *inode = ractl->mapping->host;
@@ -541,8 +648,8 @@ static void squashfs_readahead(struct readahead_control *ractl)
 	unsigned short shift = msblk->block_log - PAGE_SHIFT;
 	loff_t start = readahead_pos(ractl) & ~mask;
 	size_t len = readahead_length(ractl) + readahead_pos(ractl) - start;
-	struct squashfs_page_actor *actor;
-	unsigned int nr_pages = 0;
+	unsigned int nr_pages = 0, nr_jobs, queued = 0;
+	struct squashfs_ra_job *jobs, *job;
 	struct page **pages;
 	int i;
 	loff_t file_end = i_size_read(inode) >> msblk->block_log;
@@ -550,16 +657,25 @@ static void squashfs_readahead(struct readahead_control *ractl)
 
 	readahead_expand(ractl, start, (len | mask) + 1);
 
-	pages = kmalloc_array(max_pages, sizeof(void *), GFP_KERNEL);
-	if (!pages)
-		return;
+	nr_jobs = squashfs_readahead_nr_jobs(msblk, ractl);
+	jobs = kcalloc(nr_jobs, sizeof(*jobs), GFP_KERNEL);
+	pages = kmalloc_array(nr_jobs * max_pages, sizeof(void *), GFP_KERNEL);
+	if (!jobs || !pages) {
+		/* fall back to one datablock at a time */
+		kfree(jobs);
+		kfree(pages);
+		nr_jobs = 1;
+		jobs = kzalloc(sizeof(*jobs), GFP_KERNEL);
+		pages = kmalloc_array(max_pages, sizeof(void *), GFP_KERNEL);
+		if (!jobs || !pages)
+			goto out;
+	}
 
 	for (;;) {
 		pgoff_t index;
 		int res, bsize;
 		u64 block = 0;
 		unsigned int expected;
-		struct page *last_page;
 
 		expected = start >> msblk->block_log == file_end ?
 			   (i_size_read(inode) & (msblk->block_size - 1)) :
@@ -567,21 +683,23 @@ static void squashfs_readahead(struct readahead_control *ractl)
 
 		max_pages = (expected + PAGE_SIZE - 1) >> PAGE_SHIFT;
 
-		nr_pages = __readahead_batch(ractl, pages, max_pages);
+		job = &jobs[queued];
+		job->pages = pages + (queued << shift);
+		nr_pages = __readahead_batch(ractl, job->pages, max_pages);
 		if (!nr_pages)
 			break;
 
 		if (readahead_pos(ractl) >= i_size_read(inode))
 			goto skip_pages;
 
-		index = pages[0]->index >> shift;
+		index = job->pages[0]->index >> shift;
 
-		if ((pages[nr_pages - 1]->index >> shift) != index)
+		if ((job->pages[nr_pages - 1]->index >> shift) != index)
 			goto skip_pages;
 
 		if (index == file_end && squashfs_i(inode)->fragment_block !=
 						SQUASHFS_INVALID_BLK) {
-			res = squashfs_readahead_fragment(pages, nr_pages,
+			res = squashfs_readahead_fragment(job->pages, nr_pages,
 							  expected);
 			if (res)
 				goto skip_pages;
@@ -592,45 +710,31 @@ static void squashfs_readahead(struct readahead_control *ractl)
 		if (bsize == 0)
 			goto skip_pages;
 
-		actor = squashfs_page_actor_init_special(msblk, pages, nr_pages,
-							 expected);
-		if (!actor)
-			goto skip_pages;
-
-		res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
-
-		last_page = squashfs_page_actor_free(actor);
-
-		if (res == expected) {
-			int bytes;
+		job->inode = inode;
+		job->nr_pages = nr_pages;
+		job->expected = expected;
+		job->block = block;
+		job->bsize = bsize;
+		job->last = index == file_end;
 
-			/* Last page (if present) may have trailing bytes not filled */
-			bytes = res % PAGE_SIZE;
-			if (index == file_end && bytes && last_page)
-				memzero_page(last_page, bytes,
-					     PAGE_SIZE - bytes);
-
-			for (i = 0; i < nr_pages; i++) {
-				flush_dcache_page(pages[i]);
-				SetPageUptodate(pages[i]);
-			}
-		}
-
-		for (i = 0; i < nr_pages; i++) {
-			unlock_page(pages[i]);
-			put_page(pages[i]);
+		if (++queued == nr_jobs) {
+			squashfs_readahead_run(jobs, queued);
+			queued = 0;
 		}
 	}
 
-	kfree(pages);
-	return;
+	squashfs_readahead_run(jobs, queued);
+	goto out;
 
 skip_pages:
+	squashfs_readahead_run(jobs, queued);
 	for (i = 0; i < nr_pages; i++) {
-		unlock_page(pages[i]);
-		put_page(pages[i]);
+		unlock_page(job->pages[i]);
+		put_page(job->pages[i]);
 	}
+out:
 	kfree(pages);
+	kfree(jobs);
 }
 
 const struct address_space_operations squashfs_aops = {
@@ -86,11 +86,14 @@ static bool is_hash_block_verified(struct fsverity_info *vi, struct page *hpage,
  * only ascend the tree until an already-verified hash block is seen, and then
  * verify the path to that block.
  *
+ * If @data_hash is not NULL, it is the already computed hash of the block.
+ *
  * Return: %true if the data block is valid, else %false.
  */
 static bool
 verify_data_block(struct inode *inode, struct fsverity_info *vi,
-		  const void *data, u64 data_pos, unsigned long max_ra_pages)
+		  const void *data, u64 data_pos, unsigned long max_ra_pages,
+		  const u8 *data_hash)
 {
 	const struct merkle_tree_params *params = &vi->tree_params;
 	const unsigned int hsize = params->digest_size;
@@ -222,7 +225,9 @@ verify_data_block(struct inode *inode, struct fsverity_info *vi,
 	}
 
 	/* Finally, verify the data block. */
-	if (fsverity_hash_block(params, inode, data, real_hash) != 0)
+	if (data_hash)
+		memcpy(real_hash, data_hash, hsize);
+	else if (fsverity_hash_block(params, inode, data, real_hash) != 0)
 		goto error;
 	if (memcmp(want_hash, real_hash, hsize) != 0)
 		goto corrupted;
@@ -248,8 +253,12 @@ verify_data_blocks(struct folio *data_folio, size_t len, size_t offset,
 {
 	struct inode *inode = data_folio->mapping->host;
 	struct fsverity_info *vi = inode->i_verity_info;
-	const unsigned int block_size = vi->tree_params.block_size;
+	const struct merkle_tree_params *params = &vi->tree_params;
+	const unsigned int block_size = params->block_size;
+	const bool hash_2x =
+		crypto_shash_mb_max_msgs(params->hash_alg->tfm) >= 2;
 	u64 pos = (u64)data_folio->index << PAGE_SHIFT;
+	u8 hashes[2][FS_VERITY_MAX_DIGEST_SIZE];
 
 	if (WARN_ON_ONCE(len <= 0 || !IS_ALIGNED(len | offset, block_size)))
 		return false;
@@ -257,12 +266,41 @@ verify_data_blocks(struct folio *data_folio, size_t len, size_t offset,
 			 folio_test_uptodate(data_folio)))
 		return false;
 	do {
-		void *data;
+		void *data, *data2;
 		bool valid;
 
-		data = kmap_local_folio(data_folio, offset);
-		valid = verify_data_block(inode, vi, data, pos + offset,
-					  max_ra_pages);
+		/*
+		 * Hash the next two data blocks together if the hash algorithm
+		 * can interleave them, then walk the tree for each of them.
+		 */
+		if (hash_2x && len >= 2 * block_size &&
+		    pos + offset + block_size < inode->i_size) {
+			data = kmap_local_folio(data_folio, offset);
+			data2 = kmap_local_folio(data_folio,
+						 offset + block_size);
+			valid = !fsverity_hash_2_blocks(params, inode, data,
+							data2, hashes[0],
+							hashes[1]);
+			kunmap_local(data2);
+			if (valid)
+				valid = verify_data_block(inode, vi, data,
+							  pos + offset,
+							  max_ra_pages,
+							  hashes[0]);
+			kunmap_local(data);
+			if (!valid)
+				return false;
+			offset += block_size;
+			len -= block_size;
+
+			data = kmap_local_folio(data_folio, offset);
+			valid = verify_data_block(inode, vi, data, pos + offset,
+						  max_ra_pages, hashes[1]);
+		} else {
+			data = kmap_local_folio(data_folio, offset);
+			valid = verify_data_block(inode, vi, data, pos + offset,
+						  max_ra_pages, NULL);
+		}
 		kunmap_local(data);
 		if (!valid)
 			return false;
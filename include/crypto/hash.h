@@ -197,6 +197,10 @@ struct shash_desc {
  * @final: see struct ahash_alg
  * @finup: see struct ahash_alg
  * @digest: see struct ahash_alg
+ * @finup_mb: **[optional]** Finish hashing @num_msgs messages of the same
+ *	      length, each continuing from the state in @desc, which is left
+ *	      unchanged.  Only called with 2 <= @num_msgs <= @mb_max_msgs, and
+ *	      may return -EOPNOTSUPP to have the messages hashed one by one.
  * @export: see struct ahash_alg
  * @import: see struct ahash_alg
  * @setkey: see struct ahash_alg
@@ -217,6 +221,7 @@ struct shash_desc {
  * @descsize: Size of the operational state for the message digest. This state
  * 	      size is the memory size that needs to be allocated for
  *	      shash_desc.__ctx
+ * @mb_max_msgs: Number of messages @finup_mb can hash at once, 0 without it
  * @stat: Statistics for hash algorithm.
  * @base: internally used
  * @halg: see struct hash_alg_common
@@ -231,6 +236,9 @@ struct shash_alg {
 		     unsigned int len, u8 *out);
 	int (*digest)(struct shash_desc *desc, const u8 *data,
 		      unsigned int len, u8 *out);
+	int (*finup_mb)(struct shash_desc *desc, const u8 * const data[],
+			unsigned int len, u8 * const outs[],
+			unsigned int num_msgs);
 	int (*export)(struct shash_desc *desc, void *out);
 	int (*import)(struct shash_desc *desc, const void *in);
 	int (*setkey)(struct crypto_shash *tfm, const u8 *key,
@@ -240,6 +248,7 @@ struct shash_alg {
 	int (*clone_tfm)(struct crypto_shash *dst, struct crypto_shash *src);
 
 	unsigned int descsize;
+	unsigned int mb_max_msgs;
 
 	union {
 		struct HASH_ALG_COMMON;
@@ -1056,4 +1065,60 @@ static inline void shash_desc_zero(struct shash_desc *desc)
 			 sizeof(*desc) + crypto_shash_descsize(desc->tfm));
 }
 
+/**
+ * crypto_shash_mb_max_msgs() - number of messages hashed at once
+ * @tfm: hash transformation object
+ *
+ * Return: the largest number of messages crypto_shash_finup_mb() hashes in
+ *	   parallel with @tfm, 1 if it hashes them one after another
+ */
+static inline unsigned int crypto_shash_mb_max_msgs(struct crypto_shash *tfm)
+{
+	return crypto_shash_alg(tfm)->mb_max_msgs ?: 1;
+}
+
+/**
+ * crypto_shash_finup_mb() - finish hashing several messages at once
+ * @desc: hash state each message continues from, left unchanged
+ * @data: data of each message
+ * @len: length of the data of each message
+ * @outs: output buffer for the digest of each message
+ * @num_msgs: number of messages
+ *
+ * Computes the same digests as crypto_shash_finup() on a copy of @desc for
+ * each message.  Algorithms that support it interleave up to
+ * crypto_shash_mb_max_msgs() messages, which is faster than hashing them
+ * one after another, e.g. for the blocks of a Merkle tree.
+ *
+ * Context: Any context.
+ * Return: 0 if the message digests were computed; < 0 if an error occurred
+ */
+static inline int crypto_shash_finup_mb(struct shash_desc *desc,
+					const u8 * const data[],
+					unsigned int len, u8 * const outs[],
+					unsigned int num_msgs)
+{
+	struct shash_alg *alg = crypto_shash_alg(desc->tfm);
+	unsigned int i;
+	int err;
+
+	if (num_msgs > 1 && num_msgs <= crypto_shash_mb_max_msgs(desc->tfm)) {
+		err = alg->finup_mb(desc, data, len, outs, num_msgs);
+		if (err != -EOPNOTSUPP)
+			return err;
+	}
+
+	for (i = 0; i < num_msgs; i++) {
+		SHASH_DESC_ON_STACK(tmp, desc->tfm);
+
+		memcpy(tmp, desc,
+		       sizeof(*desc) + crypto_shash_descsize(desc->tfm));
+		err = crypto_shash_finup(tmp, data[i], len, outs[i]);
+		shash_desc_zero(tmp);
+		if (err)
+			return err;
+	}
+	return 0;
+}
+
 #endif	/* _CRYPTO_HASH_H */
@@ -96,6 +96,7 @@ struct cpuidle_device {
 	unsigned int		poll_time_limit:1;
 	unsigned int		cpu;
 	ktime_t			next_hrtimer;
+	ktime_t			next_irq;
 
 	int			last_state_idx;
 	u64			last_residency_ns;
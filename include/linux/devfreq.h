@@ -21,6 +21,7 @@
 #define DEVFREQ_GOV_POWERSAVE		"powersave"
 #define DEVFREQ_GOV_USERSPACE		"userspace"
 #define DEVFREQ_GOV_PASSIVE		"passive"
+#define DEVFREQ_GOV_BW_HWMON		"bw_hwmon"
 
 /* DEVFREQ notifier interface */
 #define DEVFREQ_TRANSITION_NOTIFIER	(0)
@@ -294,6 +295,31 @@ struct devfreq_simple_ondemand_data {
 	unsigned int downdifferential;
 };
 
+/**
+ * struct devfreq_bw_hwmon_data - ``void *data`` fed to struct devfreq
+ *	and devfreq_add_device
+ * @bytes_per_cycle:	Bytes the bus moves per clock cycle. Must be set.
+ * @io_percent:		Share of the bus capacity the measured traffic should
+ *			use at the chosen frequency. Specify 0 to use the
+ *			default. Valid value = 0 to 100.
+ * @hyst_ms:		How long the traffic must stay low before the
+ *			frequency is lowered. Specify 0 to use the default.
+ * @last_high:		Managed by the governor, jiffies of the last window
+ *			that needed at least the current frequency.
+ *
+ * The device using the bw_hwmon governor reports the bytes counted by its
+ * bandwidth monitor in busy_time and the window it counted them over, in
+ * microseconds, in total_time of struct devfreq_dev_status.
+ */
+struct devfreq_bw_hwmon_data {
+	unsigned int bytes_per_cycle;
+	unsigned int io_percent;
+	unsigned int hyst_ms;
+
+	/* private */
+	unsigned long last_high;
+};
+
 enum devfreq_parent_dev_type {
 	DEVFREQ_PARENT_DEV,
 	CPUFREQ_PARENT_DEV,
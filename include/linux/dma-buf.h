@@ -501,6 +501,7 @@ struct dma_buf {
 	struct dma_buf_sysfs_entry {
 		struct kobject kobj;
 		struct dma_buf *dmabuf;
+		struct dma_buf_exporter_stats *exporter;
 	} *sysfs_entry;
 #endif
 };
@@ -652,6 +653,20 @@ dma_buf_attachment_is_dynamic(struct dma_buf_attachment *attach)
 	return !!attach->importer_ops;
 }
 
+/**
+ * dma_buf_trace_id - identity of a DMA-buf in tracepoints
+ * @dmabuf: the DMA-buf, may be NULL
+ *
+ * Returns the inode number of the DMA-buf, which is unique for the lifetime
+ * of the system and is what userspace sees as st_ino of the buffer's fds, or
+ * 0 for a NULL @dmabuf. Drivers emit it in their tracepoints so that a buffer
+ * can be followed from one device to the next.
+ */
+static inline u64 dma_buf_trace_id(const struct dma_buf *dmabuf)
+{
+	return dmabuf ? file_inode(dmabuf->file)->i_ino : 0;
+}
+
 struct dma_buf_attachment *dma_buf_attach(struct dma_buf *dmabuf,
 					  struct device *dev);
 struct dma_buf_attachment *
@@ -667,6 +682,7 @@ struct dma_buf *dma_buf_export(const struct dma_buf_export_info *exp_info);
 
 int dma_buf_fd(struct dma_buf *dmabuf, int flags);
 struct dma_buf *dma_buf_get(int fd);
+struct dma_buf *dma_buf_get_file(struct file *file);
 void dma_buf_put(struct dma_buf *dmabuf);
 
 struct sg_table *dma_buf_map_attachment(struct dma_buf_attachment *,
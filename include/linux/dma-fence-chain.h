@@ -19,6 +19,9 @@
  * @base: fence base class
  * @prev: previous fence of the chain
  * @prev_seqno: original previous seqno before garbage collection
+ * @skip: older node of the same timeline, to leap over a run of nodes
+ * @skip_span: number of nodes @skip leaps over, 1 if there is none
+ * @release_next: next node to free while releasing a chain
  * @fence: encapsulated fence
  * @lock: spinlock for fence handling
  */
@@ -26,6 +29,9 @@ struct dma_fence_chain {
 	struct dma_fence base;
 	struct dma_fence __rcu *prev;
 	u64 prev_seqno;
+	struct dma_fence __rcu *skip;
+	u32 skip_span;
+	struct dma_fence_chain *release_next;
 	struct dma_fence *fence;
 	union {
 		/**
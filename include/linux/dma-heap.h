@@ -20,14 +20,19 @@ struct dma_heap;
 /**
  * struct dma_heap_ops - ops to operate on a given heap
  * @allocate:		allocate dmabuf and return struct dma_buf ptr
+ * @prefetch:		optional, get ready to hand out len bytes soon
+ * @drain:		optional, release len bytes worth of earlier prefetches
  *
  * allocate returns dmabuf on success, ERR_PTR(-errno) on error.
+ * prefetch and drain return 0 on success, -errno on error.
  */
 struct dma_heap_ops {
 	struct dma_buf *(*allocate)(struct dma_heap *heap,
 				    unsigned long len,
 				    unsigned long fd_flags,
 				    unsigned long heap_flags);
+	int (*prefetch)(struct dma_heap *heap, unsigned long len);
+	int (*drain)(struct dma_heap *heap, unsigned long len);
 };
 
 /**
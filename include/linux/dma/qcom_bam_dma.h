@@ -6,11 +6,43 @@
 #ifndef _QCOM_BAM_DMA_H
 #define _QCOM_BAM_DMA_H
 
+#include <linux/dmaengine.h>
 #include <asm/byteorder.h>
 
 #define DMA_PREP_LOCK	BIT(0)
 #define DMA_PREP_UNLOCK	BIT(1)
 
+/*
+ * Only interrupt at the last descriptor of each batch of transactions
+ * written to the descriptor FIFO, or when the FIFO is full, instead of at
+ * the end of every transaction with a callback or DMA_PREP_INTERRUPT.
+ * Callbacks of the other transactions of the batch run from the same
+ * interrupt.
+ */
+#define BAM_CONFIG_IRQ_MODERATION	BIT(0)
+
+/*
+ * struct bam_slave_config - BAM specific channel configuration, passed
+ * through dma_slave_config.peripheral_config.
+ *
+ * @flags - BAM_CONFIG_* flags.
+ */
+struct bam_slave_config {
+	u32 flags;
+};
+
+#if IS_ENABLED(CONFIG_QCOM_BAM_DMA)
+enum dma_status bam_dma_poll(struct dma_chan *chan, dma_cookie_t cookie,
+			     unsigned int timeout_us);
+#else
+static inline enum dma_status bam_dma_poll(struct dma_chan *chan,
+					   dma_cookie_t cookie,
+					   unsigned int timeout_us)
+{
+	return DMA_ERROR;
+}
+#endif
+
 /*
  * This data type corresponds to the native Command Element
  * supported by BAM DMA Engine.
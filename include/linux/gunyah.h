@@ -38,9 +38,21 @@ struct gh_resource {
 
 #define GH_MSGQ_MAX_MSG_SIZE		240
 
+/**
+ * struct gh_msgq_tx_data - A message to send on a Gunyah message queue
+ * @length: Number of bytes in @data
+ * @push: Notify the receiver once this message is queued
+ * @next: Optional, further messages to send as part of the same burst
+ * @data: The message
+ *
+ * A chain of messages linked by @next is sent by a single mbox_send_message()
+ * of the first one, and tx done is reported once for the whole chain. Setting
+ * @push only on the last message of the chain rings the receiver once.
+ */
 struct gh_msgq_tx_data {
 	size_t length;
 	bool push;
+	struct gh_msgq_tx_data *next;
 	char data[];
 };
 
@@ -55,6 +67,8 @@ struct gh_msgq {
 
 	/* msgq private */
 	int last_ret; /* Linux error, not GH_STATUS_* */
+	spinlock_t tx_lock; /* protects tx_next */
+	struct gh_msgq_tx_data *tx_next; /* rest of the burst being sent */
 	struct mbox_chan mbox_chan;
 	struct mbox_controller mbox;
 	struct tasklet_struct txdone_tasklet;
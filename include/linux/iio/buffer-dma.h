@@ -43,6 +43,8 @@ enum iio_block_state {
  * @queue: Parent DMA buffer queue
  * @kref: kref used to manage the lifetime of block
  * @state: Current state of the block
+ * @dmabuf_entry: Entry in the queue's list of blocks exported as DMABUF
+ * @fd: File descriptor the block was enqueued with, if exported as DMABUF
  */
 struct iio_dma_buffer_block {
 	/* May only be accessed by the owner of the block */
@@ -65,6 +67,10 @@ struct iio_dma_buffer_block {
 	 * queue->list_lock if the block is not owned by the core.
 	 */
 	enum iio_block_state state;
+
+	/* Must not be accessed outside the core. Protected by queue->lock. */
+	struct list_head dmabuf_entry;
+	int fd;
 };
 
 /**
@@ -96,6 +102,8 @@ struct iio_dma_buffer_queue_fileio {
  * @outgoing: List of buffers on the outgoing queue
  * @active: Whether the buffer is currently active
  * @fileio: FileIO state
+ * @dmabufs: List of blocks exported as DMABUF, fileio is not available as long
+ *   as there are any
  */
 struct iio_dma_buffer_queue {
 	struct iio_buffer buffer;
@@ -110,6 +118,7 @@ struct iio_dma_buffer_queue {
 	bool active;
 
 	struct iio_dma_buffer_queue_fileio fileio;
+	struct list_head dmabufs;
 };
 
 /**
@@ -137,10 +146,18 @@ size_t iio_dma_buffer_data_available(struct iio_buffer *buffer);
 int iio_dma_buffer_set_bytes_per_datum(struct iio_buffer *buffer, size_t bpd);
 int iio_dma_buffer_set_length(struct iio_buffer *buffer, unsigned int length);
 int iio_dma_buffer_request_update(struct iio_buffer *buffer);
+int iio_dma_buffer_alloc_dmabuf(struct iio_buffer *buffer, size_t size);
+int iio_dma_buffer_enqueue_dmabuf(struct iio_buffer *buffer,
+	const struct iio_dmabuf *dmabuf);
+int iio_dma_buffer_dequeue_dmabuf(struct iio_buffer *buffer,
+	struct iio_dmabuf *dmabuf, bool nonblock);
 
 int iio_dma_buffer_init(struct iio_dma_buffer_queue *queue,
 	struct device *dma_dev, const struct iio_dma_buffer_ops *ops);
 void iio_dma_buffer_exit(struct iio_dma_buffer_queue *queue);
 void iio_dma_buffer_release(struct iio_dma_buffer_queue *queue);
 
+int devm_iio_dma_buffer_sw_setup(struct device *dev, struct iio_dev *indio_dev,
+	struct device *dma_dev);
+
 #endif
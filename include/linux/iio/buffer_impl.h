@@ -18,6 +18,13 @@ struct iio_buffer;
  */
 #define INDIO_BUFFER_FLAG_FIXED_WATERMARK BIT(0)
 
+/**
+ * INDIO_BUFFER_FLAG_BLOCK_WAKEUP - The buffer wakes up its readers itself once
+ *   a block of samples is complete, instead of the core doing so for every
+ *   sample stored to it.
+ */
+#define INDIO_BUFFER_FLAG_BLOCK_WAKEUP BIT(1)
+
 /**
  * struct iio_buffer_access_funcs - access functions for buffers.
  * @store_to:		actually store stuff to the buffer
@@ -39,6 +46,11 @@ struct iio_buffer;
  *                      device stops sampling. Calles are balanced with @enable.
  * @release:		called when the last reference to the buffer is dropped,
  *			should free all resources allocated by the buffer.
+ * @alloc_dmabuf:	allocate a block of the buffer and export it as a DMABUF,
+ *			returns a file descriptor for it.
+ * @enqueue_dmabuf:	queue a DMABUF allocated by @alloc_dmabuf to be filled.
+ * @dequeue_dmabuf:	dequeue the oldest filled DMABUF, waiting for one
+ *			unless nonblock is set.
  * @modes:		Supported operating modes by this buffer type
  * @flags:		A bitmask combination of INDIO_BUFFER_FLAG_*
  *
@@ -68,6 +80,12 @@ struct iio_buffer_access_funcs {
 
 	void (*release)(struct iio_buffer *buffer);
 
+	int (*alloc_dmabuf)(struct iio_buffer *buffer, size_t size);
+	int (*enqueue_dmabuf)(struct iio_buffer *buffer,
+			      const struct iio_dmabuf *dmabuf);
+	int (*dequeue_dmabuf)(struct iio_buffer *buffer,
+			      struct iio_dmabuf *dmabuf, bool nonblock);
+
 	unsigned int modes;
 	unsigned int flags;
 };
@@ -281,6 +281,10 @@ struct irq_affinity_notify {
  *			of interrupt sets
  * @priv:		Private data for usage by @calc_sets, usually a
  *			pointer to driver/device specific data.
+ * @by_capacity:	Spread the vectors by CPU capacity, giving fewer of
+ *			them to the CPUs of lower capacity on asymmetric
+ *			systems. Also enabled for all devices by the
+ *			irqaffinity_capacity boot option.
  */
 struct irq_affinity {
 	unsigned int	pre_vectors;
@@ -289,6 +293,7 @@ struct irq_affinity {
 	unsigned int	set_size[IRQ_AFFINITY_MAX_SETS];
 	void		(*calc_sets)(struct irq_affinity *, unsigned int nvecs);
 	void		*priv;
+	bool		by_capacity;
 };
 
 /**
@@ -816,6 +821,14 @@ static inline void init_irq_proc(void)
 void irq_timings_enable(void);
 void irq_timings_disable(void);
 u64 irq_timings_next_event(u64 now);
+u64 irq_timings_next_irq_event(unsigned int irq, u64 now);
+#else
+static inline void irq_timings_enable(void) { }
+static inline void irq_timings_disable(void) { }
+static inline u64 irq_timings_next_irq_event(unsigned int irq, u64 now)
+{
+	return U64_MAX;
+}
 #endif
 
 struct seq_file;
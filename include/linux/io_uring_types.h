@@ -176,6 +176,8 @@ struct io_submit_state {
 	unsigned short		submit_nr;
 	unsigned int		cqes_count;
 	struct blk_plug		plug;
+	/* zerocopy send notification shared within the batch */
+	struct io_kiocb		*zc_notif;
 };
 
 struct io_ev_fd {
@@ -367,6 +369,8 @@ struct io_ring_ctx {
 	struct callback_head		poll_wq_task_work;
 	struct list_head		defer_list;
 	unsigned			sq_thread_idle;
+	/* time in ns the SQPOLL thread spent on this ring */
+	u64				sq_work_time;
 	/* protected by ->completion_lock */
 	unsigned			evfd_last_cq_tail;
 
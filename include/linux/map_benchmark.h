@@ -15,6 +15,12 @@
 #define DMA_MAP_TO_DEVICE       1
 #define DMA_MAP_FROM_DEVICE     2
 
+#define DMA_MAP_SINGLE_MODE     0 /* dma_map_single() of contiguous pages */
+#define DMA_MAP_SG_MODE         1 /* dma_map_sgtable() of scattered pages */
+#define DMA_MAP_DMABUF_MODE     2 /* map attachment of a dma-buf heap buffer */
+
+#define DMA_MAP_HEAP_NAME_LEN   32
+
 struct map_benchmark {
 	__u64 avg_map_100ns; /* average map latency in 100ns */
 	__u64 map_stddev; /* standard deviation of map latency */
@@ -27,5 +33,15 @@ struct map_benchmark {
 	__u32 dma_dir; /* DMA data direction */
 	__u32 dma_trans_ns; /* time for DMA transmission in ns */
 	__u32 granule;  /* how many PAGE_SIZE will do map/unmap once a time */
+	__u32 dma_mode; /* what kind of buffer is mapped, DMA_MAP_*_MODE */
+	char heap_name[DMA_MAP_HEAP_NAME_LEN]; /* heap for DMA_MAP_DMABUF_MODE */
+	__u64 map_p50_100ns; /* median map latency in 100ns */
+	__u64 map_p90_100ns;
+	__u64 map_p99_100ns;
+	__u64 map_max_100ns;
+	__u64 unmap_p50_100ns; /* as above */
+	__u64 unmap_p90_100ns;
+	__u64 unmap_p99_100ns;
+	__u64 unmap_max_100ns;
 };
 #endif /* _KERNEL_DMA_BENCHMARK_H */
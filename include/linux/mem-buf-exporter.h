@@ -21,12 +21,16 @@ struct mem_buf_vmperm;
  * @lookup: Returns the mem_buf_vmperm data structure contained somewhere
  * in the exporter's private_data, or a negative number on error.
  * @attach: The exporter's normal dma_buf_attach callback
+ * @invalidate: Optional. Drops any device mappings the exporter keeps
+ * beyond dma_buf_unmap_attachment(), and the pins they hold. Called
+ * before the VM permissions of the dmabuf change.
  * @dma_ops: The exporter's standard dma_buf callbacks, except for
  * attach which must be NULL.
  */
 struct mem_buf_dma_buf_ops {
 	struct mem_buf_vmperm *(*lookup)(struct dma_buf *dmabuf);
 	int (*attach)(struct dma_buf *dmabuf, struct dma_buf_attachment *a);
+	void (*invalidate)(struct dma_buf *dmabuf);
 	struct dma_buf_ops dma_ops;
 };
 
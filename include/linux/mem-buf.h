@@ -115,6 +115,8 @@ int mem_buf_reclaim(struct dma_buf *dmabuf);
 #if IS_ENABLED(CONFIG_QCOM_MEM_BUF)
 
 void *mem_buf_alloc(struct mem_buf_allocation_data *alloc_data);
+int mem_buf_alloc_batch(struct mem_buf_allocation_data *alloc_data,
+			const size_t *sizes, unsigned int nr_entries, void **membufs);
 void mem_buf_free(void *membuf);
 struct gh_sgl_desc *mem_buf_get_sgl(void *membuf);
 int mem_buf_current_vmid(void);
@@ -125,6 +127,13 @@ static inline void *mem_buf_alloc(struct mem_buf_allocation_data *alloc_data)
 	return ERR_PTR(-ENODEV);
 }
 
+static inline int mem_buf_alloc_batch(struct mem_buf_allocation_data *alloc_data,
+				      const size_t *sizes, unsigned int nr_entries,
+				      void **membufs)
+{
+	return -ENODEV;
+}
+
 static inline void mem_buf_free(void *membuf) {}
 
 static inline struct gh_sgl_desc *mem_buf_get_sgl(void *membuf)
@@ -52,11 +52,14 @@ enum mhi_callback {
  * @MHI_EOB: End of buffer for bulk transfer
  * @MHI_EOT: End of transfer
  * @MHI_CHAIN: Linked transfer
+ * @MHI_DEFER_DB: Don't ring the channel doorbell, a later transfer queued
+ *		  without this flag or mhi_queue_flush() will
  */
 enum mhi_flags {
 	MHI_EOB = BIT(0),
 	MHI_EOT = BIT(1),
 	MHI_CHAIN = BIT(2),
+	MHI_DEFER_DB = BIT(3),
 };
 
 /**
@@ -813,4 +816,14 @@ int mhi_queue_skb(struct mhi_device *mhi_dev, enum dma_data_direction dir,
  */
 bool mhi_queue_is_full(struct mhi_device *mhi_dev, enum dma_data_direction dir);
 
+/**
+ * mhi_queue_flush - Ring the doorbell for buffers queued with MHI_DEFER_DB
+ * @mhi_dev: Device associated with the channels
+ * @dir: DMA direction for the channel
+ *
+ * Lets the device know about all the buffers queued so far with a single
+ * doorbell write, instead of one per buffer.
+ */
+void mhi_queue_flush(struct mhi_device *mhi_dev, enum dma_data_direction dir);
+
 #endif /* _MHI_H_ */
@@ -139,6 +139,7 @@ struct genpd_power_state {
 	s64 residency_ns;
 	u64 usage;
 	u64 rejected;
+	u64 residency_miss;
 	struct fwnode_handle *fwnode;
 	u64 idle_time;
 	void *data;
@@ -31,6 +31,13 @@
  * on the target.
  */
 #define DMA_ATTR_QTI_SMMU_PROXY_MAP	(1UL << 18)
+/*
+ * DMA_ATTR_QTI_PERSISTENT_MAP: Keep the mapping of a dma-buf heap buffer
+ * across unmap for as long as the attachment exists, so that mapping it again
+ * doesn't touch the IOMMU page tables. Idle mappings may still be torn down
+ * under memory pressure.
+ */
+#define DMA_ATTR_QTI_PERSISTENT_MAP	(1UL << 19)
 
 #ifndef DMA_ATTR_SYS_CACHE
 /* Attributes are not supported, so render them ineffective. */
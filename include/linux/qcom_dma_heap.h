@@ -37,6 +37,9 @@
 
 #define QCOM_DMA_HEAP_FLAG_SECURE	BIT(31)
 
+struct device;
+struct dma_heap;
+
 bool qcom_is_dma_buf_file(struct file *file);
 
 struct dma_buf_heap_prefetch_region {
@@ -50,6 +53,17 @@ int qcom_secure_system_heap_prefetch(struct dma_buf_heap_prefetch_region *region
 int qcom_secure_system_heap_drain(struct dma_buf_heap_prefetch_region *regions,
 				  size_t nr_regions);
 
+int qcom_system_heap_prefetch(struct dma_buf_heap_prefetch_region *regions,
+			      size_t nr_regions);
+
+int qcom_system_heap_drain(struct dma_buf_heap_prefetch_region *regions,
+			   size_t nr_regions);
+
+struct dma_buf *qcom_cma_heap_alloc_unzeroed(struct dma_heap *heap, size_t len,
+					     u32 fd_flags, struct device *consumer);
+
+int qcom_dma_heap_mark_written(struct dma_buf *dmabuf);
+
 /**
  * dma_buf_heap_hyp_assign - wrapper function for hyp-assigning a dma_buf
  * @buf:		dma_buf to hyp-assign away from HLOS
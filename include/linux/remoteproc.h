@@ -460,11 +460,14 @@ enum rproc_crash_type {
  *				recovery
  * @RPROC_COREDUMP_INLINE:	Read segments directly from device memory. Stall
  *				recovery until all segments are read
+ * @RPROC_COREDUMP_AUTO:	Copy dump to separate buffer if the memory is
+ *				readily available, otherwise read it inline
  */
 enum rproc_dump_mechanism {
 	RPROC_COREDUMP_DISABLED,
 	RPROC_COREDUMP_ENABLED,
 	RPROC_COREDUMP_INLINE,
+	RPROC_COREDUMP_AUTO,
 };
 
 /**
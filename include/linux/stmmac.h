@@ -135,6 +135,9 @@ struct stmmac_rxq_cfg {
 	u8 pkt_route;
 	bool use_prio;
 	u32 prio;
+	/* CPU the NAPI thread of the queue is bound to in threaded mode */
+	bool use_napi_cpu;
+	u32 napi_cpu;
 };
 
 struct stmmac_txq_cfg {
@@ -149,6 +152,8 @@ struct stmmac_txq_cfg {
 	bool use_prio;
 	u32 prio;
 	int tbs_en;
+	bool use_napi_cpu;
+	u32 napi_cpu;
 };
 
 /* FPE link state */
@@ -221,6 +226,7 @@ struct dwmac4_addrs {
 #define STMMAC_FLAG_RX_CLK_RUNS_IN_LPI		BIT(10)
 #define STMMAC_FLAG_EN_TX_LPI_CLOCKGATING	BIT(11)
 #define STMMAC_FLAG_HWTSTAMP_CORRECT_LATENCY	BIT(12)
+#define STMMAC_FLAG_NAPI_THREADED		BIT(13)
 
 struct plat_stmmacenet_data {
 	u32 snps_id;
@@ -271,6 +277,8 @@ struct plat_stmmacenet_data {
 	u32 tx_queues_to_use;
 	u8 rx_sched_algorithm;
 	u8 tx_sched_algorithm;
+	/* SCHED_FIFO priority of the NAPI threads, 0 to leave them SCHED_OTHER */
+	u32 napi_rt_prio;
 	struct stmmac_rxq_cfg rx_queues_cfg[MTL_MAX_RX_QUEUES];
 	struct stmmac_txq_cfg tx_queues_cfg[MTL_MAX_TX_QUEUES];
 	void (*fix_mac_speed)(void *priv, unsigned int speed, unsigned int mode);
@@ -137,6 +137,8 @@ struct io_tlb_mem {
 #ifdef CONFIG_DEBUG_FS
 	atomic_long_t total_used;
 	atomic_long_t used_hiwater;
+	atomic_long_t bounced_to_dev;
+	atomic_long_t bounced_from_dev;
 #endif
 };
 
@@ -19,6 +19,7 @@ struct poll_table_struct;
 struct v4l2_ctrl;
 struct v4l2_ctrl_handler;
 struct v4l2_ctrl_helper;
+struct v4l2_ctrl_request_pool;
 struct v4l2_fh;
 struct v4l2_fwnode_device_properties;
 struct v4l2_subdev;
@@ -392,6 +393,8 @@ struct v4l2_ctrl_ref {
  *		completed it is removed from this list.
  * @req_obj:	The &struct media_request_object, used to link into a
  *		&struct media_request. This request object has a refcount.
+ * @req_pool:	For the parent control handler, the request objects kept
+ *		for reuse, if v4l2_ctrl_request_pool_init() was called.
  */
 struct v4l2_ctrl_handler {
 	struct mutex _lock;
@@ -408,6 +411,7 @@ struct v4l2_ctrl_handler {
 	struct list_head requests;
 	struct list_head requests_queued;
 	struct media_request_object req_obj;
+	struct v4l2_ctrl_request_pool *req_pool;
 };
 
 /**
@@ -1344,6 +1348,25 @@ int v4l2_ctrl_request_setup(struct media_request *req,
 void v4l2_ctrl_request_complete(struct media_request *req,
 				struct v4l2_ctrl_handler *parent);
 
+/**
+ * v4l2_ctrl_request_pool_init - Keep request objects of a handler for reuse
+ *
+ * @hdl: The parent control handler
+ * @slots: Number of request objects to allocate now and keep around
+ *
+ * Without a pool, every request that sets or returns controls of @hdl gets
+ * a copy of the handler allocated, and freed again when the request is
+ * reinitialized or released. With one, up to @slots of these copies are
+ * allocated up front and recycled, including the storage for the control
+ * values, so that streaming with requests doesn't allocate per frame.
+ * Requests beyond @slots still allocate their own copy.
+ *
+ * Call this after all controls have been added to @hdl. The pool is freed
+ * together with @hdl.
+ */
+int v4l2_ctrl_request_pool_init(struct v4l2_ctrl_handler *hdl,
+				unsigned int slots);
+
 /**
  * v4l2_ctrl_request_hdl_find - Find the control handler in the request
  *
@@ -734,6 +734,27 @@ long int video_usercopy(struct file *file, unsigned int cmd,
 long int video_ioctl2(struct file *file,
 		      unsigned int cmd, unsigned long int arg);
 
+struct io_uring_cmd;
+
+/**
+ * video_uring_cmd - Handles a V4L2 io_uring command.
+ *
+ * @file: Pointer to struct &file.
+ * @ioucmd: Pointer to struct &io_uring_cmd.
+ * @issue_flags: io_uring issue flags.
+ *
+ * Issues %VIDIOC_QBUF and %VIDIOC_DQBUF from an io_uring
+ * ``IORING_OP_URING_CMD``, with the ioctl as ``cmd_op`` and the user address
+ * of the struct &v4l2_buffer in the first 8 bytes of the command area.  The
+ * result of the ioctl is the result of the command.
+ *
+ * .. note::
+ *
+ *    This routine should be used only inside the V4L2 core.
+ */
+int video_uring_cmd(struct file *file, struct io_uring_cmd *ioucmd,
+		    unsigned int issue_flags);
+
 /*
  * The user space interpretation of the 'v4l2_event' differs
  * based on the 'time_t' definition on 32-bit architectures, so
@@ -17,8 +17,8 @@
 
 /**
  * struct v4l2_m2m_ops - mem-to-mem device driver callbacks
- * @device_run:	required. Begin the actual job (transaction) inside this
- *		callback.
+ * @device_run:	required unless @device_run_batch is set. Begin the actual
+ *		job (transaction) inside this callback.
  *		The job does NOT have to end before this callback returns
  *		(and it will be the usual case). When the job finishes,
  *		v4l2_m2m_job_finish() or v4l2_m2m_buf_done_and_job_finish()
@@ -38,13 +38,24 @@
  *		if the transaction ended normally.
  *		This function does not have to (and will usually not) wait
  *		until the device enters a state when it can be stopped.
+ * @device_run_batch: optional, used instead of @device_run if that is not set
+ *		or v4l2_m2m_set_max_batch() was called. Begin one job for each of the @num instances whose
+ *		private data is in @priv, as a single transaction if the
+ *		hardware allows. The array is only valid during the call. The
+ *		next batch is run once v4l2_m2m_job_finish() or
+ *		v4l2_m2m_buf_done_and_job_finish() has been called for all of
+ *		them, in any order.
  */
 struct v4l2_m2m_ops {
 	void (*device_run)(void *priv);
 	int (*job_ready)(void *priv);
 	void (*job_abort)(void *priv);
+	void (*device_run_batch)(void **priv, unsigned int num);
 };
 
+/* Largest batch of jobs v4l2_m2m_set_max_batch() accepts */
+#define V4L2_M2M_MAX_BATCH	16
+
 struct video_device;
 struct v4l2_m2m_dev;
 
@@ -138,6 +149,8 @@ struct v4l2_m2m_buffer {
  * running instance or NULL if no instance is running
  *
  * @m2m_dev: opaque pointer to the internal data to handle M2M context
+ *
+ * Always returns NULL for devices which run jobs in batches.
  */
 void *v4l2_m2m_get_curr_priv(struct v4l2_m2m_dev *m2m_dev);
 
@@ -511,6 +524,23 @@ unsigned long v4l2_m2m_get_unmapped_area(struct file *file, unsigned long addr,
  */
 struct v4l2_m2m_dev *v4l2_m2m_init(const struct v4l2_m2m_ops *m2m_ops);
 
+/**
+ * v4l2_m2m_set_max_batch() - run jobs of several instances at once
+ *
+ * @m2m_dev: opaque pointer to the internal data to handle M2M context
+ * @max_batch: maximum number of jobs per batch, up to %V4L2_M2M_MAX_BATCH
+ *
+ * For hardware that can take several frames per submission. From then on,
+ * the ready jobs of up to @max_batch instances are handed to
+ * &v4l2_m2m_ops.device_run_batch together instead of one by one to
+ * &v4l2_m2m_ops.device_run, with each instance getting at most one job per
+ * batch and instances taking turns in the order they became ready.
+ *
+ * Must be called before any context is created.
+ */
+int v4l2_m2m_set_max_batch(struct v4l2_m2m_dev *m2m_dev,
+			   unsigned int max_batch);
+
 #if defined(CONFIG_MEDIA_CONTROLLER)
 void v4l2_m2m_unregister_media_controller(struct v4l2_m2m_dev *m2m_dev);
 int v4l2_m2m_register_media_controller(struct v4l2_m2m_dev *m2m_dev,
@@ -21,6 +21,7 @@
 #include <media/frame_vector.h>
 
 #define VB2_MAX_FRAME	(32)
+#define VB2_DMABUF_CACHE_SIZE	(VB2_MAX_FRAME / 2)
 #define VB2_MAX_PLANES	(8)
 
 /**
@@ -86,6 +87,9 @@ struct vb2_buffer;
  *		dmabuf.
  * @unmap_dmabuf: releases access control to the dmabuf - allocator is notified
  *		  that this driver is done using the dmabuf for now.
+ * @move_dmabuf: hand the attached and mapped dmabuf in @buf_priv over to
+ *		 @vb, another buffer of the same queue; optional, but the
+ *		 queue only caches dmabuf attachments if it is provided.
  * @prepare:	called every time the buffer is passed from userspace to the
  *		driver, useful for cache synchronisation, optional.
  * @finish:	called every time the buffer is passed back from the driver
@@ -140,6 +144,7 @@ struct vb2_mem_ops {
 	void		(*detach_dmabuf)(void *buf_priv);
 	int		(*map_dmabuf)(void *buf_priv);
 	void		(*unmap_dmabuf)(void *buf_priv);
+	void		(*move_dmabuf)(void *buf_priv, struct vb2_buffer *vb);
 
 	void		*(*vaddr)(struct vb2_buffer *vb, void *buf_priv);
 	void		*(*cookie)(struct vb2_buffer *vb, void *buf_priv);
@@ -477,6 +482,22 @@ struct vb2_buf_ops {
 	void (*copy_timestamp)(struct vb2_buffer *vb, const void *pb);
 };
 
+/**
+ * struct vb2_dmabuf_cache_entry - an attached dmabuf no buffer is using
+ * @dbuf:	the dmabuf, holding a reference
+ * @mem_priv:	allocator private data of the attachment, which is mapped
+ * @dev:	device the dmabuf is attached to
+ * @length:	length the dmabuf was attached with
+ * @stamp:	when the entry was added, for evicting the oldest one
+ */
+struct vb2_dmabuf_cache_entry {
+	struct dma_buf			*dbuf;
+	void				*mem_priv;
+	struct device			*dev;
+	unsigned int			length;
+	unsigned long			stamp;
+};
+
 /**
  * struct vb2_queue - a videobuf2 queue.
  *
@@ -579,6 +600,10 @@ struct vb2_buf_ops {
  *		when a buffer with the %V4L2_BUF_FLAG_LAST is dequeued.
  * @fileio:	file io emulator internal data, used only if emulator is active
  * @threadio:	thread io internal data, used only if thread is active
+ * @dmabuf_cache: dmabufs recently dropped by a buffer of the queue, still
+ *		attached and mapped, to be taken over by the next buffer that
+ *		is queued with them
+ * @dmabuf_stamp: counter for &vb2_dmabuf_cache_entry.stamp
  * @name:	queue name, used for logging purpose. Initialized automatically
  *		if left empty by drivers.
  */
@@ -643,6 +668,9 @@ struct vb2_queue {
 	struct vb2_fileio_data		*fileio;
 	struct vb2_threadio_data	*threadio;
 
+	struct vb2_dmabuf_cache_entry	dmabuf_cache[VB2_DMABUF_CACHE_SIZE];
+	unsigned long			dmabuf_stamp;
+
 	char				name[32];
 
 #ifdef CONFIG_VIDEO_ADV_DEBUG
@@ -22,6 +22,13 @@ int rpmh_write_batch(const struct device *dev, enum rpmh_state state,
 
 void rpmh_invalidate(const struct device *dev);
 
+void rpmh_txn_begin(void);
+
+bool rpmh_txn_queue(const struct device *dev, enum rpmh_state state,
+		    const struct tcs_cmd *cmd, u32 n);
+
+int rpmh_txn_commit(void);
+
 #else
 
 static inline int rpmh_write(const struct device *dev, enum rpmh_state state,
@@ -42,6 +49,18 @@ static inline void rpmh_invalidate(const struct device *dev)
 {
 }
 
+static inline void rpmh_txn_begin(void)
+{
+}
+
+static inline bool rpmh_txn_queue(const struct device *dev,
+				  enum rpmh_state state,
+				  const struct tcs_cmd *cmd, u32 n)
+{ return false; }
+
+static inline int rpmh_txn_commit(void)
+{ return 0; }
+
 #endif /* CONFIG_QCOM_RPMH */
 
 #endif /* __SOC_QCOM_RPMH_H__ */
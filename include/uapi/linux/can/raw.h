@@ -65,6 +65,53 @@ enum {
 	CAN_RAW_FD_FRAMES,	/* allow CAN FD frames (default:off) */
 	CAN_RAW_JOIN_FILTERS,	/* all filters must match to trigger */
 	CAN_RAW_XL_FRAMES,	/* allow CAN XL frames (default:off) */
+	CAN_RAW_RX_RING,	/* mmap()able receive ring           */
 };
 
+/* CAN_RAW_RX_RING
+ *
+ * Received frames are stored in a ring of block_nr blocks of block_size
+ * bytes each, mapped with mmap() on the socket, instead of being queued
+ * for recvmsg().  Each block starts with a struct can_raw_block_desc and
+ * is handed to user space, by setting its status to CAN_RAW_BLK_USER, once
+ * it is full or retire_tov milliseconds after its first frame.  User space
+ * walks the frames of the block and gives it back by setting its status to
+ * CAN_RAW_BLK_KERNEL.  Frames arriving while the next block is still owned
+ * by user space are dropped and counted in the next block handed out.
+ * Setting a block_nr of 0 removes the ring again.
+ */
+struct can_raw_ring_req {
+	__u32 block_size;	/* multiple of the page size */
+	__u32 block_nr;		/* number of blocks, 0 to remove the ring */
+	__u32 retire_tov;	/* ms, 0 for the default of 8 ms */
+};
+
+#define CAN_RAW_BLK_KERNEL	0
+#define CAN_RAW_BLK_USER	1
+
+struct can_raw_block_desc {
+	__u32 status;		/* CAN_RAW_BLK_* */
+	__u32 num_frames;	/* number of frames in the block */
+	__u32 offset_to_first;	/* from the start of the block */
+	__u32 blk_len;		/* bytes used, including this descriptor */
+	__u64 seq_num;		/* increments with every block handed out */
+	__u32 dropped;		/* frames dropped since the previous block */
+	__u32 reserved;
+};
+
+/* frame flags, matching the msg_flags set by recvmsg() */
+#define CAN_RAW_FRAME_LOCAL	0x1	/* MSG_DONTROUTE: sent on this host */
+#define CAN_RAW_FRAME_OWN	0x2	/* MSG_CONFIRM: sent by this socket */
+
+struct can_raw_frame_hdr {
+	__u32 next_offset;	/* from this header, 0 for the last frame */
+	__u32 len;		/* bytes of CAN (FD/XL) frame after the header */
+	__u64 tstamp;		/* software receive time, ns (CLOCK_REALTIME) */
+	__u64 hwtstamp;		/* hardware timestamp in ns, 0 if none */
+	__s32 ifindex;		/* receiving interface */
+	__u32 flags;		/* CAN_RAW_FRAME_* */
+};
+
+#define CAN_RAW_RING_ALIGN	8
+
 #endif /* !_UAPI_CAN_RAW_H */
@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+/*
+ * DMABUF Heaps prefetch/drain Userspace API
+ *
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+#ifndef _UAPI_LINUX_DMABUF_HEAP_PREFETCH_H
+#define _UAPI_LINUX_DMABUF_HEAP_PREFETCH_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+#include <linux/dma-heap.h>
+
+/**
+ * struct dma_heap_prefetch_data - metadata passed from userspace to warm up
+ *				   or release a heap's page pools
+ * @len:	number of bytes the heap should get ready to hand out, or
+ *		no longer needs to keep around
+ * @flags:	reserved, must be 0
+ *
+ * Provided by userspace as an argument to the ioctl
+ */
+struct dma_heap_prefetch_data {
+	__u64 len;
+	__u64 flags;
+};
+
+/**
+ * DOC: DMA_HEAP_IOCTL_PREFETCH - hint that an allocation of len bytes is coming
+ *
+ * Takes a dma_heap_prefetch_data struct and returns 0 once the request has
+ * been queued. The heap fills its pools in the background and keeps them
+ * filled until a matching DMA_HEAP_IOCTL_DRAIN is issued.
+ */
+#define DMA_HEAP_IOCTL_PREFETCH	_IOW(DMA_HEAP_IOC_MAGIC, 0x1,\
+				     struct dma_heap_prefetch_data)
+
+/**
+ * DOC: DMA_HEAP_IOCTL_DRAIN - release len bytes worth of earlier prefetches
+ *
+ * Takes a dma_heap_prefetch_data struct and returns 0 on success.
+ */
+#define DMA_HEAP_IOCTL_DRAIN	_IOW(DMA_HEAP_IOC_MAGIC, 0x2,\
+				     struct dma_heap_prefetch_data)
+
+#endif /* _UAPI_LINUX_DMABUF_HEAP_PREFETCH_H */
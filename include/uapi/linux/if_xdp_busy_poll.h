@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+/*
+ * AF_XDP busy-poll control and statistics Userspace API
+ *
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+#ifndef _UAPI_LINUX_IF_XDP_BUSY_POLL_H
+#define _UAPI_LINUX_IF_XDP_BUSY_POLL_H
+
+#include <linux/types.h>
+#include <linux/if_xdp.h>
+
+/*
+ * XDP sockets are non-blocking, so by default recvmsg() and sendmsg()
+ * busy poll the NAPI context of the socket for a single pass of
+ * SO_BUSY_POLL_BUDGET packets.  Setting this int option makes recvmsg()
+ * keep polling until a descriptor is on the RX ring or the SO_BUSY_POLL
+ * timeout of the socket runs out.  Needs an RX ring.
+ */
+#define XDP_BUSY_POLL_WAIT		9
+
+/* getsockopt: struct xdp_busy_poll_stats, for sockets with an RX ring */
+#define XDP_BUSY_POLL_STATISTICS	10
+
+/**
+ * struct xdp_busy_poll_stats - busy polling done on behalf of a socket
+ * @polls:	busy-poll loops run from recvmsg() and sendmsg()
+ * @empty_polls: loops which put nothing on the RX ring
+ * @rx_descs:	descriptors put on the RX ring during the loops
+ * @poll_ns:	time spent in the loops
+ */
+struct xdp_busy_poll_stats {
+	__u64 polls;
+	__u64 empty_polls;
+	__u64 rx_descs;
+	__u64 poll_ns;
+};
+
+#endif /* _UAPI_LINUX_IF_XDP_BUSY_POLL_H */
@@ -5,6 +5,34 @@
 #ifndef _UAPI_IIO_BUFFER_H_
 #define _UAPI_IIO_BUFFER_H_
 
+#include <linux/types.h>
+
+/**
+ * struct iio_dmabuf_alloc_req - Descriptor for allocating an IIO DMABUF
+ * @size:	size of the DMABUF in bytes
+ * @resv:	reserved, must be zero
+ */
+struct iio_dmabuf_alloc_req {
+	__u64 size;
+	__u64 resv;
+};
+
+/**
+ * struct iio_dmabuf - Descriptor of an enqueued or dequeued IIO DMABUF
+ * @fd:		file descriptor of the DMABUF
+ * @flags:	reserved, must be zero
+ * @bytes_used:	must be zero on enqueue, number of bytes of samples the
+ *		DMABUF holds on dequeue
+ */
+struct iio_dmabuf {
+	__u32 fd;
+	__u32 flags;
+	__u64 bytes_used;
+};
+
 #define IIO_BUFFER_GET_FD_IOCTL			_IOWR('i', 0x91, int)
+#define IIO_BUFFER_DMABUF_ALLOC_IOCTL		_IOW('i', 0x92, struct iio_dmabuf_alloc_req)
+#define IIO_BUFFER_DMABUF_ENQUEUE_IOCTL		_IOW('i', 0x93, struct iio_dmabuf)
+#define IIO_BUFFER_DMABUF_DEQUEUE_IOCTL		_IOR('i', 0x94, struct iio_dmabuf)
 
 #endif /* _UAPI_IIO_BUFFER_H_ */
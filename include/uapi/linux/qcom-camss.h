@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+/*
+ * Qualcomm CAMSS V4L2 events Userspace API
+ *
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+#ifndef _UAPI_LINUX_QCOM_CAMSS_H
+#define _UAPI_LINUX_QCOM_CAMSS_H
+
+#include <linux/types.h>
+#include <linux/videodev2.h>
+
+/*
+ * Sent on a capture video node while a frame is being written, every
+ * progress_lines lines, when that module parameter of the driver is set.
+ * The event data is a struct camss_event_frame_progress.
+ */
+#define V4L2_EVENT_CAMSS_FRAME_PROGRESS	(V4L2_EVENT_PRIVATE_START + 1)
+
+/**
+ * struct camss_event_frame_progress - partially written frame
+ * @index:	index of the vb2 buffer being written
+ * @sequence:	sequence number the buffer will be returned with
+ * @lines:	number of lines written from the top of the frame
+ * @height:	height of the frame in lines
+ */
+struct camss_event_frame_progress {
+	__u32	index;
+	__u32	sequence;
+	__u32	lines;
+	__u32	height;
+};
+
+#endif /* _UAPI_LINUX_QCOM_CAMSS_H */
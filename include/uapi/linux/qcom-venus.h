@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+/*
+ * Qualcomm Venus V4L2 controls Userspace API
+ *
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+#ifndef _UAPI_LINUX_QCOM_VENUS_H
+#define _UAPI_LINUX_QCOM_VENUS_H
+
+#include <linux/v4l2-controls.h>
+
+#define V4L2_CID_MPEG_VENUS_BASE	(V4L2_CID_CODEC_BASE | 0x2000)
+
+/*
+ * Decoder low-latency mode.  When set before streaming starts, frames are
+ * output in decode order without display delay, the session is marked
+ * realtime and the core clock is held at its highest rate while it runs.
+ */
+#define V4L2_CID_MPEG_VENUS_DEC_LOW_LATENCY	(V4L2_CID_MPEG_VENUS_BASE + 0)
+
+/*
+ * Read-only. Time in microseconds from queueing the bitstream of the last
+ * decoded frame to the firmware until the frame was returned, updated for
+ * every capture buffer in low-latency mode.  Subscribe to V4L2_EVENT_CTRL
+ * on it to get the latency of each frame.
+ */
+#define V4L2_CID_MPEG_VENUS_DEC_LATENCY		(V4L2_CID_MPEG_VENUS_BASE + 1)
+
+/*
+ * Encoder QP map.  A dma-buf file descriptor holding one signed QP delta
+ * per 16x16 macroblock of the frame, in raster order, or -1 for none.  The
+ * map is used by the firmware in place, every raw buffer queued from then
+ * on is encoded with it, so the buffer must not be written while frames
+ * queued with it are in flight.  Setting it before streaming starts enables
+ * QP maps for the session.
+ */
+#define V4L2_CID_MPEG_VENUS_ENC_QP_MAP		(V4L2_CID_MPEG_VENUS_BASE + 2)
+
+#endif /* _UAPI_LINUX_QCOM_VENUS_H */
@@ -0,0 +1,116 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+/*
+ * rpmsg char device batched I/O and receive ring Userspace API
+ *
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+#ifndef _UAPI_LINUX_RPMSG_BATCH_H
+#define _UAPI_LINUX_RPMSG_BATCH_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/* set in rpmsg_msg.flags when a message didn't fit in its buffer */
+#define RPMSG_MSG_TRUNC		(1 << 0)
+
+/**
+ * struct rpmsg_msg - one message of a batch
+ * @buf:	user pointer to the message
+ * @len:	size of @buf, updated to the length of the received message
+ * @flags:	RPMSG_MSG_* flags, set on receive, must be 0 on send
+ */
+struct rpmsg_msg {
+	__u64 buf;
+	__u32 len;
+	__u32 flags;
+};
+
+/* don't wait for the first message of a receive batch */
+#define RPMSG_MMSG_DONTWAIT	(1 << 0)
+
+/**
+ * struct rpmsg_mmsg - a batch of messages
+ * @msgs:	user pointer to an array of struct rpmsg_msg
+ * @count:	number of entries in @msgs
+ * @flags:	RPMSG_MMSG_* flags
+ */
+struct rpmsg_mmsg {
+	__u64 msgs;
+	__u32 count;
+	__u32 flags;
+};
+
+/**
+ * DOC: RPMSG_RECV_MMSG_IOCTL - receive up to count queued messages
+ *
+ * Waits for the first message, unless the file is non-blocking or
+ * RPMSG_MMSG_DONTWAIT is set, then returns the number of messages received
+ * without waiting for more.
+ */
+#define RPMSG_RECV_MMSG_IOCTL	_IOW(0xb5, 0x10, struct rpmsg_mmsg)
+
+/**
+ * DOC: RPMSG_SEND_MMSG_IOCTL - send count messages
+ *
+ * Returns the number of messages sent, which is less than count if sending
+ * one of them failed after others were sent, or an error if none was.
+ */
+#define RPMSG_SEND_MMSG_IOCTL	_IOW(0xb5, 0x11, struct rpmsg_mmsg)
+
+/**
+ * struct rpmsg_ring_setup - receive ring to set up on an endpoint
+ * @size:	size of the data area, a power of two multiple of the page size
+ * @flags:	reserved, must be 0
+ */
+struct rpmsg_ring_setup {
+	__u32 size;
+	__u32 flags;
+};
+
+/**
+ * DOC: RPMSG_SETUP_RING_IOCTL - receive messages through a shared ring
+ *
+ * Once set up, messages received on the endpoint are written to a ring that
+ * is mapped with mmap() of the endpoint device at offset 0, instead of being
+ * queued for read(). The mapping starts with a struct rpmsg_ring_hdr page,
+ * followed by the data area. Poll reports EPOLLIN while the ring isn't
+ * empty. The ring lasts until the endpoint device is closed.
+ */
+#define RPMSG_SETUP_RING_IOCTL	_IOW(0xb5, 0x12, struct rpmsg_ring_setup)
+
+/**
+ * struct rpmsg_ring_hdr - header of a receive ring
+ * @head:	producer offset, written by the kernel
+ * @tail:	consumer offset, written by userspace
+ * @size:	size of the data area
+ * @data_offset: offset of the data area in the mapping
+ * @dropped:	number of messages dropped because the ring was full
+ *
+ * @head and @tail are free running, the data of a record at offset o is at
+ * data_offset + (o & (size - 1)). Each record is a struct rpmsg_ring_rec
+ * followed by the message, padded to 8 bytes. The kernel releases a record
+ * by updating @head after writing it, userspace by updating @tail after
+ * reading it.
+ */
+struct rpmsg_ring_hdr {
+	__u32 head;
+	__u32 tail;
+	__u32 size;
+	__u32 data_offset;
+	__u32 dropped;
+};
+
+/* a record filling the end of the data area, to skip */
+#define RPMSG_RING_REC_PAD	(1 << 0)
+
+/**
+ * struct rpmsg_ring_rec - header of a record in a receive ring
+ * @len:	length of the message following the header, or of the padding
+ * @flags:	RPMSG_RING_REC_* flags
+ */
+struct rpmsg_ring_rec {
+	__u32 len;
+	__u32 flags;
+};
+
+#endif /* _UAPI_LINUX_RPMSG_BATCH_H */
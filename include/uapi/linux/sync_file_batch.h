@@ -0,0 +1,79 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+/*
+ * Batched sync_file merge and wait Userspace API
+ *
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+#ifndef _UAPI_LINUX_SYNC_FILE_BATCH_H
+#define _UAPI_LINUX_SYNC_FILE_BATCH_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+#include <linux/sync_file.h>
+
+/* Most fds a single SYNC_IOC_MERGE_ARRAY or SYNC_IOC_WAIT may take */
+#define SYNC_FILE_BATCH_MAX_FDS	256
+
+/**
+ * struct sync_merge_array_data - data passed to merge a set of sync_files
+ * @name:	name of the new fence
+ * @fds:	pointer to an array of @num_fds __s32 sync_file fds
+ * @num_fds:	number of entries in @fds
+ * @fence:	returns the fd of the new sync_file
+ * @flags:	reserved, must be 0
+ * @pad:	padding for 64-bit alignment, must be 0
+ */
+struct sync_merge_array_data {
+	char	name[32];
+	__u64	fds;
+	__u32	num_fds;
+	__s32	fence;
+	__u32	flags;
+	__u32	pad;
+};
+
+/* Return as soon as any of the fences signals, instead of all of them */
+#define SYNC_WAIT_ANY	(1 << 0)
+
+/**
+ * struct sync_wait_data - data passed to wait on a set of sync_files
+ * @fds:	pointer to an array of @num_fds __s32 sync_file fds
+ * @num_fds:	number of entries in @fds
+ * @flags:	SYNC_WAIT_* flags
+ * @timeout_ns:	how long to wait at most, 0 to only poll, negative to wait
+ *		without a timeout
+ * @first_signaled: with SYNC_WAIT_ANY, returns the index in @fds of a fence
+ *		which signaled
+ * @pad:	padding for 64-bit alignment, must be 0
+ */
+struct sync_wait_data {
+	__u64	fds;
+	__u32	num_fds;
+	__u32	flags;
+	__s64	timeout_ns;
+	__u32	first_signaled;
+	__u32	pad;
+};
+
+/**
+ * DOC: SYNC_IOC_MERGE_ARRAY - merge any number of sync_files
+ *
+ * Takes a struct sync_merge_array_data.  Creates a new sync_file holding a
+ * single flattened array of the pending fences of all the sync_files in
+ * fds, keeping only the latest fence of each context, and returns its fd in
+ * fence.  The sync_file the ioctl is issued on is only the entry point, and
+ * is not merged unless it is listed in fds as well.
+ */
+#define SYNC_IOC_MERGE_ARRAY	_IOWR(SYNC_IOC_MAGIC, 6, struct sync_merge_array_data)
+
+/**
+ * DOC: SYNC_IOC_WAIT - wait for several sync_files at once
+ *
+ * Takes a struct sync_wait_data and waits for all, or with SYNC_WAIT_ANY any,
+ * of the sync_files in fds to signal.  Returns 0 once they did, or -ETIME if
+ * the timeout expired first.  As with SYNC_IOC_MERGE_ARRAY, the sync_file
+ * the ioctl is issued on is only the entry point.
+ */
+#define SYNC_IOC_WAIT		_IOWR(SYNC_IOC_MAGIC, 7, struct sync_wait_data)
+
+#endif /* _UAPI_LINUX_SYNC_FILE_BATCH_H */
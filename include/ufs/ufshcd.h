@@ -744,6 +744,14 @@ enum ufshcd_caps {
 	 * WriteBooster when scaling the clock down.
 	 */
 	UFSHCD_CAP_WB_WITH_CLK_SCALING			= 1 << 12,
+
+	/*
+	 * With UFSHCD_CAP_INTR_AGGR and the legacy doorbell, aggregate
+	 * completions only while enough requests are outstanding to reach a
+	 * lower counter threshold, and interrupt on each completion otherwise,
+	 * so that a shallow queue doesn't wait for the aggregation timeout.
+	 */
+	UFSHCD_CAP_INTR_AGGR_ADAPTIVE			= 1 << 13,
 };
 
 struct ufs_hba_variant_params {
@@ -772,6 +780,26 @@ struct ufs_hba_monitor {
 	bool enabled;
 };
 
+/**
+ * struct ufs_crypto_stats - inline encryption keyslot statistics
+ * @reqs: requests issued with a keyslot
+ * @programs: keys programmed into a keyslot, i.e. keyslot misses
+ * @evictions: keyslots cleared
+ * @errors: failed keyslot programs and evictions
+ * @program_time_ns: total time spent programming keys
+ * @program_time_max_ns: longest time spent programming one key
+ *
+ * Requests that found their key already in a keyslot are @reqs - @programs.
+ */
+struct ufs_crypto_stats {
+	atomic64_t reqs;
+	atomic64_t programs;
+	atomic64_t evictions;
+	atomic64_t errors;
+	atomic64_t program_time_ns;
+	atomic64_t program_time_max_ns;
+};
+
 /**
  * struct ufshcd_res_info_t - MCQ related resource regions
  *
@@ -838,8 +866,10 @@ enum ufshcd_mcq_opr {
  * @ahit: value of Auto-Hibernate Idle Timer register.
  * @lrb: local reference block
  * @outstanding_tasks: Bits representing outstanding task requests
- * @outstanding_lock: Protects @outstanding_reqs.
+ * @outstanding_lock: Protects @outstanding_reqs and @pending_doorbell.
  * @outstanding_reqs: Bits representing outstanding transfer requests
+ * @pending_doorbell: Transfer requests prepared but not yet rung, until the
+ *	last request of a batch from the block layer is queued
  * @capabilities: UFS Controller Capabilities
  * @mcq_capabilities: UFS Multi Circular Queue capabilities
  * @nutrs: Transfer Request Queue depth supported by controller
@@ -919,6 +949,7 @@ enum ufshcd_mcq_opr {
  * @crypto_cap_array: Array of crypto capabilities
  * @crypto_cfg_register: Start of the crypto cfg array
  * @crypto_profile: the crypto profile of this hba (if applicable)
+ * @crypto_stats: keyslot usage and programming statistics
  * @debugfs_root: UFS controller debugfs root directory
  * @debugfs_ee_work: used to restore ee_ctrl_mask after a delay
  * @debugfs_ee_rate_limit_ms: user configurable delay after which to restore
@@ -976,6 +1007,7 @@ struct ufs_hba {
 	unsigned long outstanding_tasks;
 	spinlock_t outstanding_lock;
 	unsigned long outstanding_reqs;
+	unsigned long pending_doorbell;
 
 	u32 capabilities;
 	int nutrs;
@@ -1079,6 +1111,7 @@ struct ufs_hba {
 	union ufs_crypto_cap_entry *crypto_cap_array;
 	u32 crypto_cfg_register;
 	struct blk_crypto_profile crypto_profile;
+	struct ufs_crypto_stats crypto_stats;
 #endif
 #ifdef CONFIG_DEBUG_FS
 	struct dentry *debugfs_root;
@@ -151,6 +151,8 @@ __cold void io_uring_show_fdinfo(struct seq_file *m, struct file *f)
 
 	seq_printf(m, "SqThread:\t%d\n", sq_pid);
 	seq_printf(m, "SqThreadCpu:\t%d\n", sq_cpu);
+	seq_printf(m, "SqWorkTime:\t%llu\n",
+		   div_u64(READ_ONCE(ctx->sq_work_time), NSEC_PER_USEC));
 	seq_printf(m, "UserFiles:\t%u\n", ctx->nr_user_files);
 	for (i = 0; has_lock && i < ctx->nr_user_files; i++) {
 		struct file *f = io_file_from_index(&ctx->file_table, i);
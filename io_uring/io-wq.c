@@ -16,6 +16,7 @@
 #include <linux/task_work.h>
 #include <linux/audit.h>
 #include <linux/mmu_context.h>
+#include <linux/sched/topology.h>
 #include <uapi/linux/io_uring.h>
 
 #include "io-wq.h"
@@ -123,10 +124,47 @@ struct io_wq {
 	struct io_wq_work *hash_tail[IO_WQ_NR_HASH_BUCKETS];
 
 	cpumask_var_t cpu_mask;
+	/* cpu_mask is the default one, not one set by the user */
+	bool default_mask;
 };
 
 static enum cpuhp_state io_wq_online;
 
+static unsigned long io_wq_max_capacity(void)
+{
+	unsigned long max_cap = 0;
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu)
+		max_cap = max(max_cap, arch_scale_cpu_capacity(cpu));
+	return max_cap;
+}
+
+/*
+ * Whether a CPU is part of the default affinity of workers.  On systems with
+ * CPUs of different capacity, e.g. big.LITTLE, workers are kept off the CPUs
+ * of less than half the highest capacity: punted work is usually the part of
+ * a request that blocks or copies, and it takes several times as long there.
+ * A mask set with IORING_REGISTER_IOWQ_AFF still goes.
+ */
+static bool io_wq_cpu_default(unsigned int cpu, unsigned long max_cap)
+{
+	return arch_scale_cpu_capacity(cpu) >= max_cap / 2;
+}
+
+static void io_wq_default_cpumask(struct io_wq *wq)
+{
+	unsigned long max_cap = io_wq_max_capacity();
+	unsigned int cpu;
+
+	cpumask_copy(wq->cpu_mask, cpu_possible_mask);
+	for_each_possible_cpu(cpu) {
+		if (!io_wq_cpu_default(cpu, max_cap))
+			cpumask_clear_cpu(cpu, wq->cpu_mask);
+	}
+	wq->default_mask = true;
+}
+
 struct io_cb_cancel_data {
 	work_cancel_fn *fn;
 	void *data;
@@ -1169,7 +1207,7 @@ struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 
 	if (!alloc_cpumask_var(&wq->cpu_mask, GFP_KERNEL))
 		goto err;
-	cpumask_copy(wq->cpu_mask, cpu_possible_mask);
+	io_wq_default_cpumask(wq);
 	wq->acct[IO_WQ_ACCT_BOUND].max_workers = bounded;
 	wq->acct[IO_WQ_ACCT_UNBOUND].max_workers =
 				task_rlimit(current, RLIMIT_NPROC);
@@ -1287,11 +1325,13 @@ struct online_data {
 static bool io_wq_worker_affinity(struct io_worker *worker, void *data)
 {
 	struct online_data *od = data;
+	struct io_wq *wq = worker->wq;
 
-	if (od->online)
-		cpumask_set_cpu(od->cpu, worker->wq->cpu_mask);
-	else
-		cpumask_clear_cpu(od->cpu, worker->wq->cpu_mask);
+	if (!od->online)
+		cpumask_clear_cpu(od->cpu, wq->cpu_mask);
+	else if (!wq->default_mask ||
+		 io_wq_cpu_default(od->cpu, io_wq_max_capacity()))
+		cpumask_set_cpu(od->cpu, wq->cpu_mask);
 	return false;
 }
 
@@ -1328,10 +1368,12 @@ int io_wq_cpu_affinity(struct io_uring_task *tctx, cpumask_var_t mask)
 		return -EINVAL;
 
 	rcu_read_lock();
-	if (mask)
+	if (mask) {
 		cpumask_copy(tctx->io_wq->cpu_mask, mask);
-	else
-		cpumask_copy(tctx->io_wq->cpu_mask, cpu_possible_mask);
+		tctx->io_wq->default_mask = false;
+	} else {
+		io_wq_default_cpumask(tctx->io_wq);
+	}
 	rcu_read_unlock();
 
 	return 0;
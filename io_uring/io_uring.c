@@ -2317,6 +2317,8 @@ static void io_submit_state_end(struct io_ring_ctx *ctx)
 
 	if (unlikely(state->link.head))
 		io_queue_sqe_fallback(state->link.head);
+	if (state->zc_notif)
+		io_notif_coalesce_end(ctx);
 	/* flush only after queuing links as they can generate completions */
 	io_submit_flush_completions(ctx);
 	if (state->plug_started)
@@ -1030,7 +1030,8 @@ void io_send_zc_cleanup(struct io_kiocb *req)
 }
 
 #define IO_ZC_FLAGS_COMMON (IORING_RECVSEND_POLL_FIRST | IORING_RECVSEND_FIXED_BUF)
-#define IO_ZC_FLAGS_VALID  (IO_ZC_FLAGS_COMMON | IORING_SEND_ZC_REPORT_USAGE)
+#define IO_ZC_FLAGS_VALID  (IO_ZC_FLAGS_COMMON | IORING_SEND_ZC_REPORT_USAGE | \
+			    IORING_SEND_ZC_COALESCE)
 
 int io_send_zc_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
@@ -1044,18 +1045,25 @@ int io_send_zc_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 	if (req->flags & REQ_F_CQE_SKIP)
 		return -EINVAL;
 
-	notif = zc->notif = io_alloc_notif(ctx);
-	if (!notif)
-		return -ENOMEM;
-	notif->cqe.user_data = req->cqe.user_data;
-	notif->cqe.res = 0;
-	notif->cqe.flags = IORING_CQE_F_NOTIF;
+	zc->flags = READ_ONCE(sqe->ioprio);
+	if (unlikely(zc->flags & ~IO_ZC_FLAGS_VALID))
+		return -EINVAL;
+
+	if (zc->flags & IORING_SEND_ZC_COALESCE) {
+		notif = zc->notif = io_notif_coalesce(req, zc->flags);
+		if (!notif)
+			return -ENOMEM;
+	} else {
+		notif = zc->notif = io_alloc_notif(ctx);
+		if (!notif)
+			return -ENOMEM;
+		notif->cqe.user_data = req->cqe.user_data;
+		notif->cqe.res = 0;
+		notif->cqe.flags = IORING_CQE_F_NOTIF;
+	}
 	req->flags |= REQ_F_NEED_CLEANUP;
 
-	zc->flags = READ_ONCE(sqe->ioprio);
 	if (unlikely(zc->flags & ~IO_ZC_FLAGS_COMMON)) {
-		if (zc->flags & ~IO_ZC_FLAGS_VALID)
-			return -EINVAL;
 		if (zc->flags & IORING_SEND_ZC_REPORT_USAGE) {
 			io_notif_set_extended(notif);
 			io_notif_to_data(notif)->zc_report = true;
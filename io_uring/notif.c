@@ -84,3 +84,62 @@ struct io_kiocb *io_alloc_notif(struct io_ring_ctx *ctx)
 	refcount_set(&nd->uarg.refcnt, 1);
 	return notif;
 }
+
+/*
+ * Zerocopy sends to the same file with the same flags within a submission
+ * batch share a notification when they ask for it with
+ * IORING_SEND_ZC_COALESCE, so a single CQE tells that the buffers of all of
+ * them may be reused.  That CQE carries the user_data of the last of the
+ * sends and their number in ->res, which gives the range of them if they
+ * use consecutive user_data.
+ */
+struct io_kiocb *io_notif_coalesce(struct io_kiocb *req, unsigned int flags)
+	__must_hold(&req->ctx->uring_lock)
+{
+	struct io_ring_ctx *ctx = req->ctx;
+	struct io_submit_state *state = &ctx->submit_state;
+	bool fixed = req->flags & REQ_F_FIXED_FILE;
+	struct io_kiocb *notif = state->zc_notif;
+	struct io_notif_data *nd;
+
+	if (notif) {
+		nd = io_notif_to_data(notif);
+		if (nd->coalesce_fd == req->cqe.fd &&
+		    nd->coalesce_fixed == fixed &&
+		    nd->coalesce_flags == flags &&
+		    nd->nr_coalesced < IO_NOTIF_COALESCE_MAX) {
+			/* the sends hold a reference each, as for their own */
+			refcount_inc(&nd->uarg.refcnt);
+			notif->cqe.user_data = req->cqe.user_data;
+			notif->cqe.res = ++nd->nr_coalesced;
+			return notif;
+		}
+		io_notif_coalesce_end(ctx);
+	}
+
+	notif = io_alloc_notif(ctx);
+	if (!notif)
+		return NULL;
+	nd = io_notif_to_data(notif);
+	nd->coalesce_fd = req->cqe.fd;
+	nd->coalesce_fixed = fixed;
+	nd->coalesce_flags = flags;
+	nd->nr_coalesced = 1;
+	notif->cqe.user_data = req->cqe.user_data;
+	notif->cqe.res = 1;
+	notif->cqe.flags = IORING_CQE_F_NOTIF;
+
+	/* and the batch holds one until it ends */
+	refcount_inc(&nd->uarg.refcnt);
+	state->zc_notif = notif;
+	return notif;
+}
+
+void io_notif_coalesce_end(struct io_ring_ctx *ctx)
+	__must_hold(&ctx->uring_lock)
+{
+	struct io_submit_state *state = &ctx->submit_state;
+
+	io_notif_flush(state->zc_notif);
+	state->zc_notif = NULL;
+}
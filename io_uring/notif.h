@@ -9,6 +9,12 @@
 
 #define IO_NOTIF_UBUF_FLAGS	(SKBFL_ZEROCOPY_FRAG | SKBFL_DONT_ORPHAN)
 #define IO_NOTIF_SPLICE_BATCH	32
+#define IO_NOTIF_COALESCE_MAX	64
+
+/* share one notification between the zerocopy sends of a batch */
+#ifndef IORING_SEND_ZC_COALESCE
+#define IORING_SEND_ZC_COALESCE	(1U << 15)
+#endif
 
 struct io_notif_data {
 	struct file		*file;
@@ -17,10 +23,17 @@ struct io_notif_data {
 	bool			zc_report;
 	bool			zc_used;
 	bool			zc_copied;
+	/* what sends must match to share the notification */
+	bool			coalesce_fixed;
+	int			coalesce_fd;
+	unsigned int		coalesce_flags;
+	unsigned int		nr_coalesced;
 };
 
 struct io_kiocb *io_alloc_notif(struct io_ring_ctx *ctx);
 void io_notif_set_extended(struct io_kiocb *notif);
+struct io_kiocb *io_notif_coalesce(struct io_kiocb *req, unsigned int flags);
+void io_notif_coalesce_end(struct io_ring_ctx *ctx);
 
 static inline struct io_notif_data *io_notif_to_data(struct io_kiocb *notif)
 {
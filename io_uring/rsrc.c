@@ -8,6 +8,7 @@
 #include <linux/nospec.h>
 #include <linux/hugetlb.h>
 #include <linux/compat.h>
+#include <linux/dma-buf.h>
 #include <linux/io_uring.h>
 
 #include <uapi/linux/io_uring.h>
@@ -138,8 +139,11 @@ static void io_buffer_unmap(struct io_ring_ctx *ctx, struct io_mapped_ubuf **slo
 	unsigned int i;
 
 	if (imu != &dummy_ubuf) {
-		for (i = 0; i < imu->nr_bvecs; i++)
-			unpin_user_page(imu->bvec[i].bv_page);
+		if (imu->dmabuf)
+			dma_buf_put(imu->dmabuf);
+		else
+			for (i = 0; i < imu->nr_bvecs; i++)
+				unpin_user_page(imu->bvec[i].bv_page);
 		if (imu->acct_pages)
 			io_unaccount_mem(ctx, imu->acct_pages);
 		kvfree(imu);
@@ -912,6 +916,129 @@ struct page **io_pin_pages(unsigned long ubuf, unsigned long len, int *npages)
 	return pages;
 }
 
+#ifdef CONFIG_DMA_SHARED_BUFFER
+/*
+ * Buffers mmap'ed from a dma-buf, e.g. from a dma-heap, usually are
+ * VM_PFNMAP mappings that can't be pinned.  Returns the dma-buf if the whole
+ * of [ubuf, ubuf + len) is in a single mapping of one, along with the offset
+ * of @ubuf into it.
+ */
+static struct dma_buf *io_buffer_get_dmabuf(unsigned long ubuf, size_t len,
+					    unsigned long *offset)
+{
+	struct vm_area_struct *vma;
+	struct dma_buf *dmabuf = NULL;
+
+	mmap_read_lock(current->mm);
+	vma = vma_lookup(current->mm, ubuf);
+	if (vma && vma->vm_file && ubuf + len <= vma->vm_end) {
+		dmabuf = dma_buf_get_file(vma->vm_file);
+		if (IS_ERR(dmabuf))
+			dmabuf = NULL;
+		else
+			*offset = ubuf - vma->vm_start +
+				  (vma->vm_pgoff << PAGE_SHIFT);
+	}
+	mmap_read_unlock(current->mm);
+	return dmabuf;
+}
+
+static struct page *io_dmabuf_vaddr_to_page(void *vaddr)
+{
+	if (is_vmalloc_addr(vaddr))
+		return vmalloc_to_page(vaddr);
+	if (virt_addr_valid(vaddr))
+		return virt_to_page(vaddr);
+	return NULL;
+}
+
+/*
+ * The pages of the buffer are found through a kernel mapping of it, which
+ * works for heaps backed by struct pages like the system heap.  They stay
+ * around for as long as we hold the dma-buf, so unlike user memory they are
+ * neither pinned nor accounted.
+ */
+static int io_sqe_dmabuf_register(struct iovec *iov, struct dma_buf *dmabuf,
+				  unsigned long offset,
+				  struct io_mapped_ubuf **pimu)
+{
+	struct io_mapped_ubuf *imu = NULL;
+	struct iosys_map map;
+	size_t size = iov->iov_len;
+	unsigned long off = offset & ~PAGE_MASK;
+	int ret, nr_pages, i;
+	void *vaddr;
+
+	if (offset > dmabuf->size || size > dmabuf->size - offset) {
+		dma_buf_put(dmabuf);
+		return -EFAULT;
+	}
+
+	ret = dma_buf_vmap_unlocked(dmabuf, &map);
+	if (ret) {
+		dma_buf_put(dmabuf);
+		return ret;
+	}
+
+	ret = -EOPNOTSUPP;
+	if (map.is_iomem)
+		goto done;
+
+	ret = -ENOMEM;
+	nr_pages = PAGE_ALIGN(off + size) >> PAGE_SHIFT;
+	imu = kvmalloc(struct_size(imu, bvec, nr_pages), GFP_KERNEL);
+	if (!imu)
+		goto done;
+
+	ret = 0;
+	imu->nr_bvecs = nr_pages;
+	vaddr = map.vaddr + (offset & PAGE_MASK);
+	for (i = 0; i < nr_pages; i++) {
+		struct page *page = io_dmabuf_vaddr_to_page(vaddr);
+		size_t vec_len;
+
+		if (!page) {
+			ret = -EOPNOTSUPP;
+			break;
+		}
+		vec_len = min_t(size_t, size, PAGE_SIZE - off);
+		bvec_set_page(&imu->bvec[i], page, vec_len, off);
+		off = 0;
+		size -= vec_len;
+		vaddr += PAGE_SIZE;
+	}
+	if (ret)
+		goto done;
+
+	/* store original address for later verification */
+	imu->ubuf = (unsigned long) iov->iov_base;
+	imu->ubuf_end = imu->ubuf + iov->iov_len;
+	imu->acct_pages = 0;
+	imu->dmabuf = dmabuf;
+	*pimu = imu;
+done:
+	dma_buf_vunmap_unlocked(dmabuf, &map);
+	if (ret) {
+		kvfree(imu);
+		dma_buf_put(dmabuf);
+	}
+	return ret;
+}
+#else
+static struct dma_buf *io_buffer_get_dmabuf(unsigned long ubuf, size_t len,
+					    unsigned long *offset)
+{
+	return NULL;
+}
+
+static int io_sqe_dmabuf_register(struct iovec *iov, struct dma_buf *dmabuf,
+				  unsigned long offset,
+				  struct io_mapped_ubuf **pimu)
+{
+	return -EOPNOTSUPP;
+}
+#endif
+
 static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 				  struct io_mapped_ubuf **pimu,
 				  struct page **last_hpage)
@@ -922,11 +1049,17 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 	size_t size;
 	int ret, nr_pages, i;
 	struct folio *folio = NULL;
+	struct dma_buf *dmabuf;
 
 	*pimu = (struct io_mapped_ubuf *)&dummy_ubuf;
 	if (!iov->iov_base)
 		return 0;
 
+	dmabuf = io_buffer_get_dmabuf((unsigned long) iov->iov_base,
+				      iov->iov_len, &off);
+	if (dmabuf)
+		return io_sqe_dmabuf_register(iov, dmabuf, off, pimu);
+
 	ret = -ENOMEM;
 	pages = io_pin_pages((unsigned long) iov->iov_base, iov->iov_len,
 				&nr_pages);
@@ -978,6 +1111,7 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 	imu->ubuf = (unsigned long) iov->iov_base;
 	imu->ubuf_end = imu->ubuf + iov->iov_len;
 	imu->nr_bvecs = nr_pages;
+	imu->dmabuf = NULL;
 	*pimu = imu;
 	ret = 0;
 
@@ -54,6 +54,8 @@ struct io_mapped_ubuf {
 	u64		ubuf_end;
 	unsigned int	nr_bvecs;
 	unsigned long	acct_pages;
+	/* set if the bvecs are pages of a dma-buf, which holds them */
+	struct dma_buf	*dmabuf;
 	struct bio_vec	bvec[] __counted_by(nr_bvecs);
 };
 
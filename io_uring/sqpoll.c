@@ -18,6 +18,9 @@
 #include "sqpoll.h"
 
 #define IORING_SQPOLL_CAP_ENTRIES_VALUE 8
+#define IORING_SQPOLL_CAP_ENTRIES_MAX	64
+/* fraction of the idle period spun when submissions come in further apart */
+#define IORING_SQPOLL_IDLE_SHRINK	8
 
 enum {
 	IO_SQ_THREAD_SHOULD_STOP = 0,
@@ -164,18 +167,34 @@ static inline bool io_sqd_events_pending(struct io_sq_data *sqd)
 	return READ_ONCE(sqd->state);
 }
 
+/*
+ * Rings sharing a thread get a share of each pass in proportion to the size
+ * of their SQ, so a ring set up for more traffic isn't held to the pace of
+ * the smallest one.
+ */
+static unsigned int io_sq_cap_entries(struct io_ring_ctx *ctx)
+{
+	return clamp_t(unsigned int, ctx->sq_entries / 16,
+		       IORING_SQPOLL_CAP_ENTRIES_VALUE,
+		       IORING_SQPOLL_CAP_ENTRIES_MAX);
+}
+
 static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 {
-	unsigned int to_submit;
+	unsigned int to_submit, cap;
 	int ret = 0;
 
 	to_submit = io_sqring_entries(ctx);
 	/* if we're handling multiple rings, cap submit size for fairness */
-	if (cap_entries && to_submit > IORING_SQPOLL_CAP_ENTRIES_VALUE)
-		to_submit = IORING_SQPOLL_CAP_ENTRIES_VALUE;
+	if (cap_entries) {
+		cap = io_sq_cap_entries(ctx);
+		if (to_submit > cap)
+			to_submit = cap;
+	}
 
 	if (!wq_list_empty(&ctx->iopoll_list) || to_submit) {
 		const struct cred *creds = NULL;
+		u64 start = ktime_get_ns();
 
 		if (ctx->sq_creds != current_cred())
 			creds = override_creds(ctx->sq_creds);
@@ -197,11 +216,36 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 			wake_up(&ctx->sqo_sq_wait);
 		if (creds)
 			revert_creds(creds);
+		WRITE_ONCE(ctx->sq_work_time,
+			   ctx->sq_work_time + ktime_get_ns() - start);
 	}
 
 	return ret;
 }
 
+static void io_sqd_update_idle_gap(struct io_sq_data *sqd)
+{
+	unsigned long gap = jiffies - sqd->last_work;
+
+	/* only count the gaps between bursts, not passes within one */
+	if (gap) {
+		gap = min_t(unsigned long, gap, 2UL * sqd->sq_thread_idle + 1);
+		sqd->idle_gap = (sqd->idle_gap * 7 + gap) / 8;
+	}
+	sqd->last_work = jiffies;
+}
+
+/*
+ * Submissions that usually come in further apart than the idle period never
+ * find the thread still spinning, so stop spinning early in that case.
+ */
+static unsigned long io_sqd_idle(struct io_sq_data *sqd)
+{
+	if (sqd->idle_gap > sqd->sq_thread_idle)
+		return max(sqd->sq_thread_idle / IORING_SQPOLL_IDLE_SHRINK, 1U);
+	return sqd->sq_thread_idle;
+}
+
 static bool io_sqd_handle_event(struct io_sq_data *sqd)
 {
 	bool did_sig = false;
@@ -255,7 +299,7 @@ static int io_sq_thread(void *data)
 		if (io_sqd_events_pending(sqd) || signal_pending(current)) {
 			if (io_sqd_handle_event(sqd))
 				break;
-			timeout = jiffies + sqd->sq_thread_idle;
+			timeout = jiffies + io_sqd_idle(sqd);
 		}
 
 		cap_entries = !list_is_singular(&sqd->ctx_list);
@@ -265,12 +309,17 @@ static int io_sq_thread(void *data)
 			if (!sqt_spin && (ret > 0 || !wq_list_empty(&ctx->iopoll_list)))
 				sqt_spin = true;
 		}
+		/* don't let the first ring always go first */
+		if (cap_entries)
+			list_rotate_left(&sqd->ctx_list);
 		if (io_run_task_work())
 			sqt_spin = true;
 
 		if (sqt_spin || !time_after(jiffies, timeout)) {
-			if (sqt_spin)
-				timeout = jiffies + sqd->sq_thread_idle;
+			if (sqt_spin) {
+				io_sqd_update_idle_gap(sqd);
+				timeout = jiffies + io_sqd_idle(sqd);
+			}
 			if (unlikely(need_resched())) {
 				mutex_unlock(&sqd->lock);
 				cond_resched();
@@ -317,7 +366,7 @@ static int io_sq_thread(void *data)
 		}
 
 		finish_wait(&sqd->wait, &wait);
-		timeout = jiffies + sqd->sq_thread_idle;
+		timeout = jiffies + io_sqd_idle(sqd);
 	}
 
 	io_uring_cancel_generic(true, sqd);
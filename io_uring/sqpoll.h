@@ -12,6 +12,9 @@ struct io_sq_data {
 	struct wait_queue_head	wait;
 
 	unsigned		sq_thread_idle;
+	/* moving average of the jiffies between bursts of submissions */
+	unsigned long		idle_gap;
+	unsigned long		last_work;
 	int			sq_cpu;
 	pid_t			task_pid;
 	pid_t			task_tgid;
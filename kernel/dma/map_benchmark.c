@@ -8,7 +8,10 @@
 #include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/device.h>
+#include <linux/dma-buf.h>
+#include <linux/dma-heap.h>
 #include <linux/dma-mapping.h>
+#include <linux/fcntl.h>
 #include <linux/kernel.h>
 #include <linux/kthread.h>
 #include <linux/map_benchmark.h>
@@ -16,9 +19,17 @@
 #include <linux/module.h>
 #include <linux/pci.h>
 #include <linux/platform_device.h>
+#include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/timekeeping.h>
 
+/*
+ * Latency histogram buckets, in units of 100ns: four linear buckets per
+ * power of two, which is enough to read percentiles off to within 25%.
+ */
+#define MAP_HIST_SUB_SHIFT	2
+#define MAP_HIST_BUCKETS	((64 - MAP_HIST_SUB_SHIFT + 1) << MAP_HIST_SUB_SHIFT)
+
 struct map_benchmark_data {
 	struct map_benchmark bparam;
 	struct device *dev;
@@ -29,41 +40,258 @@ struct map_benchmark_data {
 	atomic64_t sum_sq_map;
 	atomic64_t sum_sq_unmap;
 	atomic64_t loops;
+	atomic64_t map_hist[MAP_HIST_BUCKETS];
+	atomic64_t unmap_hist[MAP_HIST_BUCKETS];
 };
 
+/* One thread's buffer, in whichever form the benchmark maps it */
+struct map_benchmark_buf {
+	void *virt;
+	u64 size;
+	dma_addr_t dma_addr;
+	struct sg_table sgt;
+	struct dma_heap *heap;
+	struct dma_buf *dmabuf;
+	struct dma_buf_attachment *attach;
+	struct sg_table *attach_sgt;
+};
+
+static unsigned int map_hist_bucket(u64 val)
+{
+	unsigned int lg;
+
+	if (val < (1 << MAP_HIST_SUB_SHIFT))
+		return val;
+
+	lg = ilog2(val);
+	return ((lg - MAP_HIST_SUB_SHIFT + 1) << MAP_HIST_SUB_SHIFT) +
+	       ((val >> (lg - MAP_HIST_SUB_SHIFT)) & ((1 << MAP_HIST_SUB_SHIFT) - 1));
+}
+
+/* Returns the largest value which falls in @bucket */
+static u64 map_hist_bucket_max(unsigned int bucket)
+{
+	unsigned int lg, sub;
+
+	if (bucket < (1 << MAP_HIST_SUB_SHIFT))
+		return bucket;
+
+	lg = (bucket >> MAP_HIST_SUB_SHIFT) + MAP_HIST_SUB_SHIFT - 1;
+	sub = bucket & ((1 << MAP_HIST_SUB_SHIFT) - 1);
+	return (((u64)(sub + (1 << MAP_HIST_SUB_SHIFT) + 1)) << (lg - MAP_HIST_SUB_SHIFT)) - 1;
+}
+
+static u64 map_hist_percentile(atomic64_t *hist, u64 loops, unsigned int pct)
+{
+	u64 target = div64_u64(loops * pct + 99, 100);
+	u64 seen = 0;
+	int i;
+
+	for (i = 0; i < MAP_HIST_BUCKETS; i++) {
+		seen += atomic64_read(&hist[i]);
+		if (seen >= target)
+			return map_hist_bucket_max(i);
+	}
+
+	return map_hist_bucket_max(MAP_HIST_BUCKETS - 1);
+}
+
+static u64 map_hist_max(atomic64_t *hist)
+{
+	int i;
+
+	for (i = MAP_HIST_BUCKETS - 1; i > 0; i--)
+		if (atomic64_read(&hist[i]))
+			break;
+
+	return map_hist_bucket_max(i);
+}
+
+static void map_benchmark_free_buf(struct map_benchmark_data *map,
+				   struct map_benchmark_buf *mbuf)
+{
+	struct scatterlist *sg;
+	int i;
+
+	switch (map->bparam.dma_mode) {
+	case DMA_MAP_SINGLE_MODE:
+		free_pages_exact(mbuf->virt, mbuf->size);
+		break;
+	case DMA_MAP_SG_MODE:
+		for_each_sgtable_sg(&mbuf->sgt, sg, i)
+			if (sg_page(sg))
+				__free_page(sg_page(sg));
+		sg_free_table(&mbuf->sgt);
+		break;
+	case DMA_MAP_DMABUF_MODE:
+		if (!IS_ENABLED(CONFIG_DMABUF_HEAPS))
+			break;
+		if (!IS_ERR_OR_NULL(mbuf->attach))
+			dma_buf_detach(mbuf->dmabuf, mbuf->attach);
+		if (!IS_ERR_OR_NULL(mbuf->dmabuf))
+			dma_buf_put(mbuf->dmabuf);
+		if (mbuf->heap)
+			dma_heap_put(mbuf->heap);
+		break;
+	}
+}
+
+static int map_benchmark_alloc_buf(struct map_benchmark_data *map,
+				   struct map_benchmark_buf *mbuf)
+{
+	struct scatterlist *sg;
+	struct page *page;
+	int ret, i;
+
+	switch (map->bparam.dma_mode) {
+	case DMA_MAP_SINGLE_MODE:
+		mbuf->virt = alloc_pages_exact(mbuf->size, GFP_KERNEL);
+		return mbuf->virt ? 0 : -ENOMEM;
+	case DMA_MAP_SG_MODE:
+		/* Separately allocated pages, as a video or camera buffer has */
+		ret = sg_alloc_table(&mbuf->sgt, map->bparam.granule, GFP_KERNEL);
+		if (ret)
+			return ret;
+
+		for_each_sgtable_sg(&mbuf->sgt, sg, i) {
+			page = alloc_page(GFP_KERNEL);
+			if (!page) {
+				map_benchmark_free_buf(map, mbuf);
+				return -ENOMEM;
+			}
+			sg_set_page(sg, page, PAGE_SIZE, 0);
+		}
+		return 0;
+	case DMA_MAP_DMABUF_MODE:
+		if (!IS_ENABLED(CONFIG_DMABUF_HEAPS))
+			return -EOPNOTSUPP;
+
+		mbuf->heap = dma_heap_find(map->bparam.heap_name);
+		if (!mbuf->heap)
+			return -ENODEV;
+
+		mbuf->dmabuf = dma_heap_buffer_alloc(mbuf->heap, mbuf->size,
+						     O_RDWR, 0);
+		if (IS_ERR(mbuf->dmabuf)) {
+			ret = PTR_ERR(mbuf->dmabuf);
+			map_benchmark_free_buf(map, mbuf);
+			return ret;
+		}
+
+		mbuf->attach = dma_buf_attach(mbuf->dmabuf, map->dev);
+		if (IS_ERR(mbuf->attach)) {
+			ret = PTR_ERR(mbuf->attach);
+			map_benchmark_free_buf(map, mbuf);
+			return ret;
+		}
+		return 0;
+	}
+
+	return -EINVAL;
+}
+
+/*
+ * for a non-coherent device, if we don't stain them in the cache, this will
+ * give an underestimate of the real-world overhead of BIDIRECTIONAL or
+ * TO_DEVICE mappings; 66 means evertything goes well! 66 is lucky.
+ */
+static void map_benchmark_stain_buf(struct map_benchmark_data *map,
+				    struct map_benchmark_buf *mbuf)
+{
+	struct scatterlist *sg;
+	int i;
+
+	if (map->dir == DMA_FROM_DEVICE)
+		return;
+
+	switch (map->bparam.dma_mode) {
+	case DMA_MAP_SINGLE_MODE:
+		memset(mbuf->virt, 0x66, mbuf->size);
+		break;
+	case DMA_MAP_SG_MODE:
+		for_each_sgtable_sg(&mbuf->sgt, sg, i)
+			memset(page_address(sg_page(sg)), 0x66, PAGE_SIZE);
+		break;
+	case DMA_MAP_DMABUF_MODE:
+		/* The heap owns CPU access to the buffer */
+		break;
+	}
+}
+
+static int map_benchmark_map_buf(struct map_benchmark_data *map,
+				 struct map_benchmark_buf *mbuf)
+{
+	int ret;
+
+	switch (map->bparam.dma_mode) {
+	case DMA_MAP_SINGLE_MODE:
+		mbuf->dma_addr = dma_map_single(map->dev, mbuf->virt,
+						mbuf->size, map->dir);
+		if (unlikely(dma_mapping_error(map->dev, mbuf->dma_addr)))
+			return -ENOMEM;
+		return 0;
+	case DMA_MAP_SG_MODE:
+		return dma_map_sgtable(map->dev, &mbuf->sgt, map->dir, 0);
+	case DMA_MAP_DMABUF_MODE:
+		if (!IS_ENABLED(CONFIG_DMABUF_HEAPS))
+			return -EOPNOTSUPP;
+
+		mbuf->attach_sgt = dma_buf_map_attachment_unlocked(mbuf->attach,
+								   map->dir);
+		if (IS_ERR(mbuf->attach_sgt)) {
+			ret = PTR_ERR(mbuf->attach_sgt);
+			mbuf->attach_sgt = NULL;
+			return ret;
+		}
+		return 0;
+	}
+
+	return -EINVAL;
+}
+
+static void map_benchmark_unmap_buf(struct map_benchmark_data *map,
+				    struct map_benchmark_buf *mbuf)
+{
+	switch (map->bparam.dma_mode) {
+	case DMA_MAP_SINGLE_MODE:
+		dma_unmap_single(map->dev, mbuf->dma_addr, mbuf->size, map->dir);
+		break;
+	case DMA_MAP_SG_MODE:
+		dma_unmap_sgtable(map->dev, &mbuf->sgt, map->dir, 0);
+		break;
+	case DMA_MAP_DMABUF_MODE:
+		if (!IS_ENABLED(CONFIG_DMABUF_HEAPS))
+			break;
+		dma_buf_unmap_attachment_unlocked(mbuf->attach,
+						  mbuf->attach_sgt, map->dir);
+		break;
+	}
+}
+
 static int map_benchmark_thread(void *data)
 {
-	void *buf;
-	dma_addr_t dma_addr;
+	struct map_benchmark_buf mbuf = { };
 	struct map_benchmark_data *map = data;
 	int npages = map->bparam.granule;
-	u64 size = npages * PAGE_SIZE;
 	int ret = 0;
 
-	buf = alloc_pages_exact(size, GFP_KERNEL);
-	if (!buf)
-		return -ENOMEM;
+	mbuf.size = npages * PAGE_SIZE;
+	ret = map_benchmark_alloc_buf(map, &mbuf);
+	if (ret)
+		return ret;
 
 	while (!kthread_should_stop())  {
 		u64 map_100ns, unmap_100ns, map_sq, unmap_sq;
 		ktime_t map_stime, map_etime, unmap_stime, unmap_etime;
 		ktime_t map_delta, unmap_delta;
 
-		/*
-		 * for a non-coherent device, if we don't stain them in the
-		 * cache, this will give an underestimate of the real-world
-		 * overhead of BIDIRECTIONAL or TO_DEVICE mappings;
-		 * 66 means evertything goes well! 66 is lucky.
-		 */
-		if (map->dir != DMA_FROM_DEVICE)
-			memset(buf, 0x66, size);
+		map_benchmark_stain_buf(map, &mbuf);
 
 		map_stime = ktime_get();
-		dma_addr = dma_map_single(map->dev, buf, size, map->dir);
-		if (unlikely(dma_mapping_error(map->dev, dma_addr))) {
-			pr_err("dma_map_single failed on %s\n",
-				dev_name(map->dev));
-			ret = -ENOMEM;
+		ret = map_benchmark_map_buf(map, &mbuf);
+		if (unlikely(ret)) {
+			pr_err("dma mapping failed on %s: %d\n",
+				dev_name(map->dev), ret);
 			goto out;
 		}
 		map_etime = ktime_get();
@@ -73,7 +301,7 @@ static int map_benchmark_thread(void *data)
 		ndelay(map->bparam.dma_trans_ns);
 
 		unmap_stime = ktime_get();
-		dma_unmap_single(map->dev, dma_addr, size, map->dir);
+		map_benchmark_unmap_buf(map, &mbuf);
 		unmap_etime = ktime_get();
 		unmap_delta = ktime_sub(unmap_etime, unmap_stime);
 
@@ -88,6 +316,8 @@ static int map_benchmark_thread(void *data)
 		atomic64_add(unmap_100ns, &map->sum_unmap_100ns);
 		atomic64_add(map_sq, &map->sum_sq_map);
 		atomic64_add(unmap_sq, &map->sum_sq_unmap);
+		atomic64_inc(&map->map_hist[map_hist_bucket(map_100ns)]);
+		atomic64_inc(&map->unmap_hist[map_hist_bucket(unmap_100ns)]);
 		atomic64_inc(&map->loops);
 
 		/*
@@ -108,7 +338,7 @@ static int map_benchmark_thread(void *data)
 	}
 
 out:
-	free_pages_exact(buf, size);
+	map_benchmark_free_buf(map, &mbuf);
 	return ret;
 }
 
@@ -148,6 +378,10 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 	atomic64_set(&map->sum_sq_map, 0);
 	atomic64_set(&map->sum_sq_unmap, 0);
 	atomic64_set(&map->loops, 0);
+	for (i = 0; i < MAP_HIST_BUCKETS; i++) {
+		atomic64_set(&map->map_hist[i], 0);
+		atomic64_set(&map->unmap_hist[i], 0);
+	}
 
 	for (i = 0; i < threads; i++) {
 		get_task_struct(tsk[i]);
@@ -188,6 +422,16 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 				map->bparam.avg_unmap_100ns;
 		map->bparam.map_stddev = int_sqrt64(map_variance);
 		map->bparam.unmap_stddev = int_sqrt64(unmap_variance);
+
+		/* latency percentiles */
+		map->bparam.map_p50_100ns = map_hist_percentile(map->map_hist, loops, 50);
+		map->bparam.map_p90_100ns = map_hist_percentile(map->map_hist, loops, 90);
+		map->bparam.map_p99_100ns = map_hist_percentile(map->map_hist, loops, 99);
+		map->bparam.map_max_100ns = map_hist_max(map->map_hist);
+		map->bparam.unmap_p50_100ns = map_hist_percentile(map->unmap_hist, loops, 50);
+		map->bparam.unmap_p90_100ns = map_hist_percentile(map->unmap_hist, loops, 90);
+		map->bparam.unmap_p99_100ns = map_hist_percentile(map->unmap_hist, loops, 99);
+		map->bparam.unmap_max_100ns = map_hist_max(map->unmap_hist);
 	}
 
 out:
@@ -238,6 +482,22 @@ static long map_benchmark_ioctl(struct file *file, unsigned int cmd,
 			return -EINVAL;
 		}
 
+		switch (map->bparam.dma_mode) {
+		case DMA_MAP_SINGLE_MODE:
+		case DMA_MAP_SG_MODE:
+			break;
+		case DMA_MAP_DMABUF_MODE:
+			if (!IS_ENABLED(CONFIG_DMABUF_HEAPS)) {
+				pr_err("dma-buf heaps are not supported\n");
+				return -EOPNOTSUPP;
+			}
+			map->bparam.heap_name[DMA_MAP_HEAP_NAME_LEN - 1] = '\0';
+			break;
+		default:
+			pr_err("invalid mapping mode\n");
+			return -EINVAL;
+		}
+
 		switch (map->bparam.dma_dir) {
 		case DMA_MAP_BIDIRECTIONAL:
 			map->dir = DMA_BIDIRECTIONAL;
@@ -379,3 +639,4 @@ module_exit(map_benchmark_cleanup);
 
 MODULE_AUTHOR("Barry Song <song.bao.hua@hisilicon.com>");
 MODULE_DESCRIPTION("dma_map benchmark driver");
+MODULE_IMPORT_NS(DMA_BUF);
@@ -851,6 +851,27 @@ static unsigned int swiotlb_align_offset(struct device *dev,
 		(align_mask | (IO_TLB_SIZE - 1));
 }
 
+#ifdef CONFIG_DEBUG_FS
+/*
+ * Count the bytes copied through @mem.  A restricted DMA pool belongs to the
+ * device(s) named in its reserved-memory node, so its counters give the bounce
+ * traffic of those devices; the default pool counts everyone else.
+ */
+static void account_bounce(struct io_tlb_mem *mem, size_t size,
+			   enum dma_data_direction dir)
+{
+	if (dir == DMA_TO_DEVICE)
+		atomic_long_add(size, &mem->bounced_to_dev);
+	else
+		atomic_long_add(size, &mem->bounced_from_dev);
+}
+#else /* !CONFIG_DEBUG_FS */
+static void account_bounce(struct io_tlb_mem *mem, size_t size,
+			   enum dma_data_direction dir)
+{
+}
+#endif /* CONFIG_DEBUG_FS */
+
 /*
  * Bounce: copy the swiotlb buffer from or back to the original dma location
  */
@@ -895,6 +916,8 @@ static void swiotlb_bounce(struct device *dev, phys_addr_t tlb_addr, size_t size
 		size = alloc_size;
 	}
 
+	account_bounce(dev->dma_io_tlb_mem, size, dir);
+
 	if (PageHighMem(pfn_to_page(pfn))) {
 		unsigned int offset = orig_addr & ~PAGE_MASK;
 		struct page *page;
@@ -1607,15 +1630,35 @@ static int io_tlb_hiwater_set(void *data, u64 val)
 	return 0;
 }
 
+static int io_tlb_bounced_get(void *data, u64 *val)
+{
+	*val = atomic_long_read(data);
+	return 0;
+}
+
+static int io_tlb_bounced_set(void *data, u64 val)
+{
+	/* Only allow setting to zero */
+	if (val != 0)
+		return -EINVAL;
+
+	atomic_long_set(data, val);
+	return 0;
+}
+
 DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_used, io_tlb_used_get, NULL, "%llu\n");
 DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_hiwater, io_tlb_hiwater_get,
 				io_tlb_hiwater_set, "%llu\n");
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_bounced, io_tlb_bounced_get,
+				io_tlb_bounced_set, "%llu\n");
 
 static void swiotlb_create_debugfs_files(struct io_tlb_mem *mem,
 					 const char *dirname)
 {
 	atomic_long_set(&mem->total_used, 0);
 	atomic_long_set(&mem->used_hiwater, 0);
+	atomic_long_set(&mem->bounced_to_dev, 0);
+	atomic_long_set(&mem->bounced_from_dev, 0);
 
 	mem->debugfs = debugfs_create_dir(dirname, io_tlb_default_mem.debugfs);
 	if (!mem->nslabs)
@@ -1626,6 +1669,10 @@ static void swiotlb_create_debugfs_files(struct io_tlb_mem *mem,
 			&fops_io_tlb_used);
 	debugfs_create_file("io_tlb_used_hiwater", 0600, mem->debugfs, mem,
 			&fops_io_tlb_hiwater);
+	debugfs_create_file("io_tlb_bounced_to_dev", 0600, mem->debugfs,
+			&mem->bounced_to_dev, &fops_io_tlb_bounced);
+	debugfs_create_file("io_tlb_bounced_from_dev", 0600, mem->debugfs,
+			&mem->bounced_from_dev, &fops_io_tlb_bounced);
 }
 
 static int __init swiotlb_create_default_debugfs(void)
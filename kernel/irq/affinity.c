@@ -8,6 +8,16 @@
 #include <linux/slab.h>
 #include <linux/cpu.h>
 #include <linux/group_cpus.h>
+#include <linux/sched/topology.h>
+
+static bool irq_affinity_capacity __ro_after_init;
+
+static int __init irq_affinity_capacity_setup(char *str)
+{
+	irq_affinity_capacity = true;
+	return 1;
+}
+__setup("irqaffinity_capacity", irq_affinity_capacity_setup);
 
 static void default_calc_sets(struct irq_affinity *affd, unsigned int affvecs)
 {
@@ -15,6 +25,120 @@ static void default_calc_sets(struct irq_affinity *affd, unsigned int affvecs)
 	affd->set_size[0] = affvecs;
 }
 
+/* The possible CPUs of one capacity and the groups they are split into */
+struct irq_capacity_class {
+	unsigned long	capacity;
+	unsigned long	total;
+	unsigned int	ncpus;
+	unsigned int	ngrps;
+	unsigned int	base;
+	unsigned int	seen;
+};
+
+static struct irq_capacity_class *
+irq_capacity_class(struct irq_capacity_class *classes, unsigned int nclasses,
+		   unsigned long capacity)
+{
+	unsigned int c;
+
+	for (c = 0; c < nclasses; c++) {
+		if (classes[c].capacity == capacity)
+			return &classes[c];
+	}
+	return NULL;
+}
+
+/*
+ * Split the possible CPUs into @numgrps groups, each class of CPUs of the
+ * same capacity getting a share of the groups proportional to its summed
+ * capacity: CPUs of lower capacity share fewer vectors between more CPUs.
+ * Every CPU is in a group, so that each one still has a vector to use.
+ *
+ * Returns NULL when spreading evenly gives the same result, that is on
+ * symmetric systems, when there are fewer groups than capacity classes, or
+ * enough groups for every CPU to get its own.
+ */
+static struct cpumask *group_cpus_by_capacity(unsigned int numgrps)
+{
+	struct irq_capacity_class *classes, *cl, *big, *little;
+	unsigned int nclasses = 0, ncpus = 0, sum = 0, c;
+	struct cpumask *masks = NULL;
+	unsigned long total = 0;
+	int cpu;
+
+	classes = kcalloc(num_possible_cpus(), sizeof(*classes), GFP_KERNEL);
+	if (!classes)
+		return NULL;
+
+	for_each_possible_cpu(cpu) {
+		unsigned long capacity = arch_scale_cpu_capacity(cpu);
+
+		cl = irq_capacity_class(classes, nclasses, capacity);
+		if (!cl) {
+			cl = &classes[nclasses++];
+			cl->capacity = capacity;
+		}
+		cl->ncpus++;
+		cl->total += capacity;
+		total += capacity;
+		ncpus++;
+	}
+
+	if (nclasses < 2 || numgrps < nclasses || numgrps >= ncpus)
+		goto out;
+
+	for (c = 0; c < nclasses; c++) {
+		cl = &classes[c];
+		cl->ngrps = clamp_t(unsigned int,
+				    numgrps * cl->total / total,
+				    1, cl->ncpus);
+		sum += cl->ngrps;
+	}
+
+	/* hand out the rounding leftovers to the biggest CPUs first */
+	while (sum != numgrps) {
+		big = NULL;
+		little = NULL;
+		for (c = 0; c < nclasses; c++) {
+			cl = &classes[c];
+			if (cl->ngrps < cl->ncpus &&
+			    (!big || cl->capacity > big->capacity))
+				big = cl;
+			if (cl->ngrps > 1 &&
+			    (!little || cl->capacity < little->capacity))
+				little = cl;
+		}
+		if (sum < numgrps) {
+			big->ngrps++;
+			sum++;
+		} else {
+			little->ngrps--;
+			sum--;
+		}
+	}
+
+	masks = kcalloc(numgrps, sizeof(*masks), GFP_KERNEL);
+	if (!masks)
+		goto out;
+
+	for (c = 0, sum = 0; c < nclasses; c++) {
+		classes[c].base = sum;
+		sum += classes[c].ngrps;
+	}
+
+	/* consecutive CPUs of a class share a group, like cluster siblings */
+	for_each_possible_cpu(cpu) {
+		cl = irq_capacity_class(classes, nclasses,
+					arch_scale_cpu_capacity(cpu));
+		cpumask_set_cpu(cpu, &masks[cl->base + cl->seen * cl->ngrps /
+					    cl->ncpus]);
+		cl->seen++;
+	}
+out:
+	kfree(classes);
+	return masks;
+}
+
 /**
  * irq_create_affinity_masks - Create affinity masks for multiqueue spreading
  * @nvecs:	The total number of vectors
@@ -71,7 +195,12 @@ irq_create_affinity_masks(unsigned int nvecs, struct irq_affinity *affd)
 	for (i = 0, usedvecs = 0; i < affd->nr_sets; i++) {
 		unsigned int this_vecs = affd->set_size[i];
 		int j;
-		struct cpumask *result = group_cpus_evenly(this_vecs);
+		struct cpumask *result = NULL;
+
+		if (affd->by_capacity || irq_affinity_capacity)
+			result = group_cpus_by_capacity(this_vecs);
+		if (!result)
+			result = group_cpus_evenly(this_vecs);
 
 		if (!result) {
 			kfree(masks);
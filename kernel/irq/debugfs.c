@@ -3,6 +3,7 @@
 
 #include <linux/irqdomain.h>
 #include <linux/irq.h>
+#include <linux/sched/topology.h>
 #include <linux/uaccess.h>
 
 #include "internals.h"
@@ -242,6 +243,44 @@ void irq_add_debugfs_entry(unsigned int irq, struct irq_desc *desc)
 						 &dfs_irq_ops);
 }
 
+#ifdef CONFIG_SMP
+/*
+ * One line per managed interrupt: its affinity mask and the summed capacity
+ * of the CPUs in it, to check how the vectors of devices got spread.
+ */
+static int irq_managed_affinity_show(struct seq_file *m, void *p)
+{
+	struct irq_desc *desc;
+	unsigned long capacity;
+	int irq, cpu;
+
+	irq_lock_sparse();
+	for_each_active_irq(irq) {
+		desc = irq_to_desc(irq);
+		if (!desc)
+			continue;
+
+		raw_spin_lock_irq(&desc->lock);
+		if (irqd_affinity_is_managed(&desc->irq_data)) {
+			const struct cpumask *msk;
+
+			msk = irq_data_get_affinity_mask(&desc->irq_data);
+			capacity = 0;
+			for_each_cpu(cpu, msk)
+				capacity += arch_scale_cpu_capacity(cpu);
+			seq_printf(m, "%d %s %*pbl %lu\n", irq,
+				   desc->dev_name ? : "-",
+				   cpumask_pr_args(msk), capacity);
+		}
+		raw_spin_unlock_irq(&desc->lock);
+	}
+	irq_unlock_sparse();
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(irq_managed_affinity);
+#endif
+
 static int __init irq_debugfs_init(void)
 {
 	struct dentry *root_dir;
@@ -252,6 +291,10 @@ static int __init irq_debugfs_init(void)
 	irq_domain_debugfs_init(root_dir);
 
 	irq_dir = debugfs_create_dir("irqs", root_dir);
+#ifdef CONFIG_SMP
+	debugfs_create_file("managed_affinity", 0444, root_dir, NULL,
+			    &irq_managed_affinity_fops);
+#endif
 
 	irq_lock_sparse();
 	for_each_active_irq(irq)
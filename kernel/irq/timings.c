@@ -12,6 +12,8 @@
 #include <linux/irq.h>
 #include <linux/math64.h>
 #include <linux/log2.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <trace/events/irq.h>
 
@@ -23,15 +25,21 @@ DEFINE_PER_CPU(struct irq_timings, irq_timings);
 
 static DEFINE_IDR(irqt_stats);
 
+/*
+ * Enabling is reference counted, for the users of irq_timings_next_event(),
+ * irq_timings_next_irq_event() and the debugfs interface to share it.
+ */
 void irq_timings_enable(void)
 {
-	static_branch_enable(&irq_timing_enabled);
+	static_branch_inc(&irq_timing_enabled);
 }
+EXPORT_SYMBOL_GPL(irq_timings_enable);
 
 void irq_timings_disable(void)
 {
-	static_branch_disable(&irq_timing_enabled);
+	static_branch_dec(&irq_timing_enabled);
 }
+EXPORT_SYMBOL_GPL(irq_timings_disable);
 
 /*
  * The main goal of this algorithm is to predict the next interrupt
@@ -292,6 +300,12 @@ struct irqt_stat {
 	int	timings[IRQ_TIMINGS_SIZE];
 	int	circ_timings[IRQ_TIMINGS_SIZE];
 	int	count;
+	/* inter-arrival histogram, with the ema_time slots as buckets */
+	u64	hist[PREDICTION_BUFFER_SIZE];
+	/* intervals too long to be predictable, ending a sequence */
+	u64	resets;
+	/* next event predicted when the debugfs stats were last read */
+	s64	next_delta;
 };
 
 /*
@@ -455,9 +469,12 @@ static __always_inline void __irq_timings_store(int irq, struct irqt_stat *irqs,
 
 	if (index > PREDICTION_BUFFER_SIZE - 1) {
 		irqs->count = 0;
+		irqs->resets++;
 		return;
 	}
 
+	irqs->hist[index]++;
+
 	/*
 	 * Store the index as an element of the pattern in another
 	 * circular array.
@@ -501,12 +518,33 @@ static inline void irq_timings_store(int irq, struct irqt_stat *irqs, u64 ts)
 	 */
 	if (interval >= NSEC_PER_SEC) {
 		irqs->count = 0;
+		irqs->resets++;
 		return;
 	}
 
 	__irq_timings_store(irq, irqs, interval);
 }
 
+/*
+ * Inject measured irq/timestamp recorded on this CPU to the pattern
+ * prediction model while decrementing the counter because we consume the
+ * data from our circular buffer.
+ */
+static void irq_timings_consume(void)
+{
+	struct irq_timings *irqts = this_cpu_ptr(&irq_timings);
+	struct irqt_stat __percpu *s;
+	u64 ts;
+	int i, irq;
+
+	for_each_irqts(i, irqts) {
+		irq = irq_timing_decode(irqts->values[i], &ts);
+		s = idr_find(&irqt_stats, irq);
+		if (s)
+			irq_timings_store(irq, this_cpu_ptr(s), ts);
+	}
+}
+
 /**
  * irq_timings_next_event - Return when the next event is supposed to arrive
  *
@@ -539,7 +577,7 @@ u64 irq_timings_next_event(u64 now)
 	struct irqt_stat *irqs;
 	struct irqt_stat __percpu *s;
 	u64 ts, next_evt = U64_MAX;
-	int i, irq = 0;
+	int i;
 
 	/*
 	 * This function must be called with the local irq disabled in
@@ -560,17 +598,8 @@ u64 irq_timings_next_event(u64 now)
 	 * in a nicer way with the proper circular array structure
 	 * type but with the cost of extra computation in the
 	 * interrupt handler hot path. We choose efficiency.
-	 *
-	 * Inject measured irq/timestamp to the pattern prediction
-	 * model while decrementing the counter because we consume the
-	 * data from our circular buffer.
 	 */
-	for_each_irqts(i, irqts) {
-		irq = irq_timing_decode(irqts->values[i], &ts);
-		s = idr_find(&irqt_stats, irq);
-		if (s)
-			irq_timings_store(irq, this_cpu_ptr(s), ts);
-	}
+	irq_timings_consume();
 
 	/*
 	 * Look in the list of interrupts' statistics, the earliest
@@ -591,6 +620,38 @@ u64 irq_timings_next_event(u64 now)
 	return next_evt;
 }
 
+/**
+ * irq_timings_next_irq_event - Return when an interrupt is supposed to arrive
+ * @irq: interrupt number
+ * @now: current time, from local_clock()
+ *
+ * Lets a driver waiting for @irq choose between polling and sleeping. The
+ * timings are per CPU and only the ones of the current CPU are used, so
+ * this is meant to be called on the CPU @irq is affine to, with the local
+ * irq disabled, and after irq_timings_enable().
+ *
+ * Returns a nanosec time based estimation of the next @irq, @now if it is
+ * overdue, U64_MAX if it can't be predicted.
+ */
+u64 irq_timings_next_irq_event(unsigned int irq, u64 now)
+{
+	struct irqt_stat __percpu *s;
+	u64 ts;
+
+	lockdep_assert_irqs_disabled();
+
+	irq_timings_consume();
+
+	s = idr_find(&irqt_stats, irq);
+	if (!s)
+		return U64_MAX;
+
+	ts = __irq_timings_next_event(this_cpu_ptr(s), irq, now);
+
+	return ts <= now ? now : ts;
+}
+EXPORT_SYMBOL_GPL(irq_timings_next_irq_event);
+
 void irq_timings_free(int irq)
 {
 	struct irqt_stat __percpu *s;
@@ -633,6 +694,106 @@ int irq_timings_alloc(int irq)
 	return 0;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static DEFINE_MUTEX(irq_timings_debugfs_lock);
+static bool irq_timings_debugfs_enabled;
+
+/* The timings are consumed and predicted on the CPUs that recorded them */
+static void irq_timings_predict_local(void *info)
+{
+	struct irqt_stat __percpu *s;
+	struct irqt_stat *irqs;
+	u64 now = local_clock();
+	u64 ts;
+	int irq;
+
+	irq_timings_consume();
+
+	idr_for_each_entry(&irqt_stats, s, irq) {
+		irqs = this_cpu_ptr(s);
+		ts = __irq_timings_next_event(irqs, irq, now);
+		if (ts == U64_MAX)
+			irqs->next_delta = -1;
+		else
+			irqs->next_delta = ts > now ? ts - now : 0;
+	}
+}
+
+/*
+ * One line per interrupt and CPU it fired on: the time to its predicted
+ * next occurrence in us (-1 if unpredictable), the number of sequences it
+ * ended, and the histogram of its inter-arrival times.
+ */
+static int irq_timings_stats_show(struct seq_file *m, void *p)
+{
+	struct irqt_stat __percpu *s;
+	struct irqt_stat *irqs;
+	int irq, cpu, i;
+
+	seq_puts(m, "# irq cpu next_us resets hist");
+	for (i = 0; i < PREDICTION_BUFFER_SIZE; i++)
+		seq_printf(m, " <%uus", PREDICTION_FACTOR << (i + 1));
+	seq_putc(m, '\n');
+
+	mutex_lock(&irq_timings_debugfs_lock);
+	on_each_cpu(irq_timings_predict_local, NULL, 1);
+
+	idr_for_each_entry(&irqt_stats, s, irq) {
+		for_each_online_cpu(cpu) {
+			irqs = per_cpu_ptr(s, cpu);
+			if (!irqs->last_ts && !irqs->resets)
+				continue;
+
+			seq_printf(m, "%d %d %lld %llu", irq, cpu,
+				   irqs->next_delta < 0 ? -1LL :
+				   div_s64(irqs->next_delta, NSEC_PER_USEC),
+				   irqs->resets);
+			for (i = 0; i < PREDICTION_BUFFER_SIZE; i++)
+				seq_printf(m, " %llu", irqs->hist[i]);
+			seq_putc(m, '\n');
+		}
+	}
+	mutex_unlock(&irq_timings_debugfs_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(irq_timings_stats);
+
+static int irq_timings_enable_get(void *data, u64 *val)
+{
+	*val = READ_ONCE(irq_timings_debugfs_enabled);
+	return 0;
+}
+
+static int irq_timings_enable_set(void *data, u64 val)
+{
+	mutex_lock(&irq_timings_debugfs_lock);
+	if (val && !irq_timings_debugfs_enabled)
+		irq_timings_enable();
+	else if (!val && irq_timings_debugfs_enabled)
+		irq_timings_disable();
+	irq_timings_debugfs_enabled = val;
+	mutex_unlock(&irq_timings_debugfs_lock);
+
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(irq_timings_enable_fops, irq_timings_enable_get,
+			 irq_timings_enable_set, "%llu\n");
+
+static int __init irq_timings_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("irq_timings", NULL);
+	debugfs_create_file("enable", 0644, dir, NULL,
+			    &irq_timings_enable_fops);
+	debugfs_create_file("stats", 0444, dir, NULL, &irq_timings_stats_fops);
+
+	return 0;
+}
+late_initcall(irq_timings_debugfs_init);
+#endif
+
 #ifdef CONFIG_TEST_IRQ_TIMINGS
 struct timings_intervals {
 	u64 *intervals;
@@ -183,6 +183,28 @@ static FORCE_INLINE void LZ4_wildCopy(void *dstPtr,
 	} while (d < e);
 }
 
+/*
+ * LZ4_wildCopy() moving 16 bytes per step while it can, which 64-bit cores
+ * do with a single load and store pair.  It overwrites no more than
+ * LZ4_wildCopy() does, but requires dstPtr - srcPtr >= 16 when copying
+ * within the output.
+ */
+static FORCE_INLINE void LZ4_wideCopy(void *dstPtr,
+	const void *srcPtr, void *dstEnd)
+{
+	BYTE *d = (BYTE *)dstPtr;
+	const BYTE *s = (const BYTE *)srcPtr;
+	BYTE *const e = (BYTE *)dstEnd;
+
+	while (e - d >= 16) {
+		LZ4_memcpy(d, s, 16);
+		d += 16;
+		s += 16;
+	}
+	if (d < e)
+		LZ4_wildCopy(d, s, e);
+}
+
 static FORCE_INLINE unsigned int LZ4_NbCommonBytes(register size_t val)
 {
 #if LZ4_LITTLE_ENDIAN
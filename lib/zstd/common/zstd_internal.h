@@ -177,6 +177,15 @@ static void ZSTD_copy16(void* dst, const void* src) {
     vst1q_u8((uint8_t*)dst, vld1q_u8((const uint8_t*)src));
 #elif defined(ZSTD_ARCH_X86_SSE2)
     _mm_storeu_si128((__m128i*)dst, _mm_loadu_si128((const __m128i*)src));
+#elif defined(__aarch64__)
+    /* The kernel is built with general registers only on arm64: a pair of
+     * 64-bit loads before the stores becomes a single ldp/stp, without the
+     * round trip through the stack of the bounce buffer below, and keeps
+     * the memmove() semantics. */
+    U64 const lo = MEM_read64(src);
+    U64 const hi = MEM_read64((const BYTE*)src + 8);
+    MEM_write64(dst, lo);
+    MEM_write64((BYTE*)dst + 8, hi);
 #elif defined(__clang__)
     ZSTD_memmove(dst, src, 16);
 #else
@@ -59,6 +59,7 @@
 #include <linux/can/core.h>
 #include <linux/can/skb.h>
 #include <linux/can/can-ml.h>
+#include <linux/hash.h>
 #include <linux/ratelimit.h>
 #include <net/net_namespace.h>
 #include <net/sock.h>
@@ -407,6 +408,88 @@ static struct hlist_head *can_rcv_list_find(canid_t *can_id, canid_t *mask,
 	return &dev_rcv_lists->rx[RX_FIL];
 }
 
+static inline struct hlist_head *can_fil_group_list(struct can_fil_group *group,
+						    canid_t can_id)
+{
+	return &group->rx[hash_32(can_id & group->mask, CAN_FIL_HASH_BITS)];
+}
+
+static struct can_fil_group *can_fil_group_find(struct can_dev_rcv_lists *dev_rcv_lists,
+						canid_t mask)
+{
+	struct can_fil_group *group;
+
+	hlist_for_each_entry(group, &dev_rcv_lists->rx_fil_groups, list) {
+		if (group->mask == mask)
+			return group;
+	}
+
+	return NULL;
+}
+
+/**
+ * can_fil_list_get - determine filterlist for a can_id/mask filter
+ * @can_id: reduced CAN identifier of the filter
+ * @mask: consistency checked CAN mask of the filter
+ * @dev_rcv_lists: pointer to the device filter struct
+ *
+ * Description:
+ *  Filters, that are neither inverted nor subscribe a single can_id, are
+ *  grouped by their mask and hashed by their can_id in the group. This way
+ *  the receive path only looks up one hash bucket per distinct mask instead
+ *  of testing every filter, which keeps the cost per frame independent of
+ *  the number of filters as long as they use a few different masks.
+ *
+ *  The filter is accounted to the group, which is created if needed. When
+ *  that fails the filter goes to the plain rx[RX_FIL] filterlist.
+ *
+ * Return:
+ *  Pointer to the filterlist to add the filter to.
+ */
+static struct hlist_head *can_fil_list_get(canid_t can_id, canid_t mask,
+					   struct can_dev_rcv_lists *dev_rcv_lists)
+{
+	struct can_fil_group *group;
+
+	group = can_fil_group_find(dev_rcv_lists, mask);
+	if (!group) {
+		group = kzalloc(sizeof(*group), GFP_ATOMIC);
+		if (!group)
+			return &dev_rcv_lists->rx[RX_FIL];
+
+		group->mask = mask;
+		hlist_add_head_rcu(&group->list, &dev_rcv_lists->rx_fil_groups);
+	}
+	group->entries++;
+
+	return can_fil_group_list(group, can_id);
+}
+
+static void can_fil_group_put(struct can_fil_group *group)
+{
+	if (--group->entries)
+		return;
+
+	hlist_del_rcu(&group->list);
+	kfree_rcu(group, rcu);
+}
+
+static struct receiver *can_rcv_list_search(struct hlist_head *rcv_list,
+					    canid_t can_id, canid_t mask,
+					    void (*func)(struct sk_buff *, void *),
+					    void *data)
+{
+	struct receiver *rcv;
+
+	hlist_for_each_entry(rcv, rcv_list, list) {
+		if (rcv->can_id == can_id && rcv->mask == mask &&
+		    rcv->func == func && rcv->data == data)
+			return rcv;
+	}
+
+	return NULL;
+}
+
 /**
  * can_rx_register - subscribe CAN frames from a specific interface
  * @net: the applicable net namespace
@@ -463,6 +546,8 @@ int can_rx_register(struct net *net, struct net_device *dev, canid_t can_id,
 
 	dev_rcv_lists = can_dev_rcv_lists_find(net, dev);
 	rcv_list = can_rcv_list_find(&can_id, &mask, dev_rcv_lists);
+	if (rcv_list == &dev_rcv_lists->rx[RX_FIL])
+		rcv_list = can_fil_list_get(can_id, mask, dev_rcv_lists);
 
 	rcv->can_id = can_id;
 	rcv->mask = mask;
@@ -515,6 +600,7 @@ void can_rx_unregister(struct net *net, struct net_device *dev, canid_t can_id,
 	struct hlist_head *rcv_list;
 	struct can_rcv_lists_stats *rcv_lists_stats = net->can.rcv_lists_stats;
 	struct can_dev_rcv_lists *dev_rcv_lists;
+	struct can_fil_group *group = NULL;
 
 	if (dev && dev->type != ARPHRD_CAN)
 		return;
@@ -529,13 +615,19 @@ void can_rx_unregister(struct net *net, struct net_device *dev, canid_t can_id,
 
 	/* Search the receiver list for the item to delete.  This should
 	 * exist, since no receiver may be unregistered that hasn't
-	 * been registered before.
+	 * been registered before.  Filters of the rx[RX_FIL] filterlist
+	 * are in their mask group, unless it couldn't be allocated.
 	 */
-	hlist_for_each_entry_rcu(rcv, rcv_list, list) {
-		if (rcv->can_id == can_id && rcv->mask == mask &&
-		    rcv->func == func && rcv->data == data)
-			break;
+	if (rcv_list == &dev_rcv_lists->rx[RX_FIL]) {
+		group = can_fil_group_find(dev_rcv_lists, mask);
+		if (group)
+			rcv = can_rcv_list_search(can_fil_group_list(group, can_id),
+						  can_id, mask, func, data);
+		if (!rcv)
+			group = NULL;
 	}
+	if (!rcv)
+		rcv = can_rcv_list_search(rcv_list, can_id, mask, func, data);
 
 	/* Check for bugs in CAN protocol implementations using af_can.c:
 	 * 'rcv' will be NULL if no matching list item was found for removal.
@@ -550,6 +642,8 @@ void can_rx_unregister(struct net *net, struct net_device *dev, canid_t can_id,
 	}
 
 	hlist_del_rcu(&rcv->list);
+	if (group)
+		can_fil_group_put(group);
 	dev_rcv_lists->entries--;
 
 	if (rcv_lists_stats->rcv_entries > 0)
@@ -576,6 +670,7 @@ static inline void deliver(struct sk_buff *skb, struct receiver *rcv)
 static int can_rcv_filter(struct can_dev_rcv_lists *dev_rcv_lists, struct sk_buff *skb)
 {
 	struct receiver *rcv;
+	struct can_fil_group *group;
 	int matches = 0;
 	struct can_frame *cf = (struct can_frame *)skb->data;
 	canid_t can_id = cf->can_id;
@@ -601,6 +696,15 @@ static int can_rcv_filter(struct can_dev_rcv_lists *dev_rcv_lists, struct sk_buf
 	}
 
 	/* check for can_id/mask entries */
+	hlist_for_each_entry_rcu(group, &dev_rcv_lists->rx_fil_groups, list) {
+		hlist_for_each_entry_rcu(rcv, can_fil_group_list(group, can_id), list) {
+			if ((can_id & rcv->mask) == rcv->can_id) {
+				deliver(skb, rcv);
+				matches++;
+			}
+		}
+	}
+
 	hlist_for_each_entry_rcu(rcv, &dev_rcv_lists->rx[RX_FIL], list) {
 		if ((can_id & rcv->mask) == rcv->can_id) {
 			deliver(skb, rcv);
@@ -60,6 +60,18 @@ struct receiver {
 	struct rcu_head rcu;
 };
 
+/* can_id/mask receivers sharing the same mask, hashed by their can_id */
+#define CAN_FIL_HASH_BITS 5
+#define CAN_FIL_HASH_SZ (1 << CAN_FIL_HASH_BITS)
+
+struct can_fil_group {
+	struct hlist_node list;
+	canid_t mask;
+	unsigned int entries;
+	struct hlist_head rx[CAN_FIL_HASH_SZ];
+	struct rcu_head rcu;
+};
+
 /* statistic structures */
 
 /* can be reset e.g. by can_init_stats() */
@@ -286,6 +286,8 @@ struct j1939_session {
 		unsigned int dpo;
 	} pkt;
 	struct hrtimer txtimer, rxtimer;
+	/* rx_deadline - later expiry of rxtimer set by data packets, 0 if none */
+	ktime_t rx_deadline;
 };
 
 struct j1939_sock {
@@ -707,11 +707,31 @@ static inline void j1939_tp_set_rxtimeout(struct j1939_session *session,
 					  int msec)
 {
 	j1939_session_rxtimer_cancel(session);
+	WRITE_ONCE(session->rx_deadline, 0);
 	j1939_session_get(session);
 	hrtimer_start(&session->rxtimer, ms_to_ktime(msec),
 		      HRTIMER_MODE_REL_SOFT);
 }
 
+/* Every data packet of a session pushes its rx timeout further out. Instead
+ * of cancelling and restarting the timer for each of them, only record the
+ * new deadline while the pending timer expires before it; j1939_tp_rxtimer()
+ * then re-arms itself for the deadline.
+ */
+static void j1939_tp_extend_rxtimeout(struct j1939_session *session,
+				      int msec)
+{
+	ktime_t deadline = ktime_add_ms(ktime_get(), msec);
+
+	if (hrtimer_is_queued(&session->rxtimer) &&
+	    !ktime_after(hrtimer_get_expires(&session->rxtimer), deadline)) {
+		WRITE_ONCE(session->rx_deadline, deadline);
+		return;
+	}
+
+	j1939_tp_set_rxtimeout(session, msec);
+}
+
 static int j1939_session_tx_rts(struct j1939_session *session)
 {
 	u8 dat[8];
@@ -1228,6 +1248,17 @@ static enum hrtimer_restart j1939_tp_rxtimer(struct hrtimer *hrtimer)
 						     struct j1939_session,
 						     rxtimer);
 	struct j1939_priv *priv = session->priv;
+	ktime_t deadline;
+
+	/* data came in since the timer was started */
+	deadline = READ_ONCE(session->rx_deadline);
+	if (deadline) {
+		WRITE_ONCE(session->rx_deadline, 0);
+		if (ktime_before(ktime_get(), deadline)) {
+			hrtimer_set_expires(hrtimer, deadline);
+			return HRTIMER_RESTART;
+		}
+	}
 
 	if (session->state == J1939_SESSION_WAITING_ABORT) {
 		netdev_alert(priv->ndev, "%s: 0x%p: abort rx timeout. Force session deactivation\n",
@@ -1919,13 +1950,13 @@ static void j1939_xtp_rx_dat_one(struct j1939_session *session,
 		j1939_session_completed(session);
 	} else if (remain) {
 		if (!session->transmission)
-			j1939_tp_set_rxtimeout(session, 750);
+			j1939_tp_extend_rxtimeout(session, 750);
 	} else if (do_cts_eoma) {
 		j1939_tp_set_rxtimeout(session, 1250);
 		if (!session->transmission)
 			j1939_tp_schedule_txtimer(session, 0);
 	} else {
-		j1939_tp_set_rxtimeout(session, 750);
+		j1939_tp_extend_rxtimeout(session, 750);
 	}
 	session->last_cmd = 0xff;
 	consume_skb(se_skb);
@@ -294,9 +294,21 @@ static inline void can_rcvlist_proc_show_one(struct seq_file *m, int idx,
 					     struct net_device *dev,
 					     struct can_dev_rcv_lists *dev_rcv_lists)
 {
-	if (!hlist_empty(&dev_rcv_lists->rx[idx])) {
+	struct can_fil_group *group;
+	unsigned int i;
+
+	/* can_id/mask entries are mostly kept in groups of the same mask */
+	if (!hlist_empty(&dev_rcv_lists->rx[idx]) ||
+	    (idx == RX_FIL && !hlist_empty(&dev_rcv_lists->rx_fil_groups))) {
 		can_print_recv_banner(m);
 		can_print_rcvlist(m, &dev_rcv_lists->rx[idx], dev);
+		if (idx != RX_FIL)
+			return;
+
+		hlist_for_each_entry_rcu(group, &dev_rcv_lists->rx_fil_groups, list) {
+			for (i = 0; i < CAN_FIL_HASH_SZ; i++)
+				can_print_rcvlist(m, &group->rx[i], dev);
+		}
 	} else
 		seq_printf(m, "  (%s: no entry)\n", DNAME(dev));
 
@@ -53,6 +53,8 @@
 #include <linux/can/dev.h> /* for can_is_canxl_dev_mtu() */
 #include <linux/can/skb.h>
 #include <linux/can/raw.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
 #include <net/sock.h>
 #include <net/net_namespace.h>
 
@@ -80,6 +82,23 @@ struct uniqframe {
 	unsigned int join_rx_count;
 };
 
+/* mmap()able receive ring, see CAN_RAW_RX_RING in linux/can/raw.h */
+struct raw_ring {
+	void *buf;
+	unsigned int block_size;
+	unsigned int block_nr;
+	unsigned long tov;		/* in jiffies */
+	spinlock_t lock;		/* protects the fields below */
+	unsigned int cur;		/* block being filled */
+	unsigned int offset;		/* next free byte in it, 0 if not open */
+	struct can_raw_frame_hdr *last;	/* last frame in it */
+	u64 seq;
+	u32 dropped;
+	struct timer_list timer;	/* retires a partly filled block */
+	struct sock *sk;
+	atomic_t mapped;
+};
+
 struct raw_sock {
 	struct sock sk;
 	int bound;
@@ -97,6 +116,7 @@ struct raw_sock {
 	struct can_filter *filter; /* pointer to filter(s) */
 	can_err_mask_t err_mask;
 	struct uniqframe __percpu *uniq;
+	struct raw_ring __rcu *rx_ring;
 };
 
 static LIST_HEAD(raw_notifier_list);
@@ -121,11 +141,119 @@ static inline struct raw_sock *raw_sk(const struct sock *sk)
 	return (struct raw_sock *)sk;
 }
 
+#define RAW_RING_DESC_LEN	ALIGN(sizeof(struct can_raw_block_desc), \
+				      CAN_RAW_RING_ALIGN)
+#define RAW_RING_HDR_LEN	ALIGN(sizeof(struct can_raw_frame_hdr), \
+				      CAN_RAW_RING_ALIGN)
+#define RAW_RING_DEFAULT_TOV	8 /* ms */
+
+static struct can_raw_block_desc *raw_ring_block(struct raw_ring *ring,
+						 unsigned int idx)
+{
+	return ring->buf + (size_t)idx * ring->block_size;
+}
+
+/* Called with ring->lock held. Returns false if the block is still owned by
+ * user space.
+ */
+static bool raw_ring_open_block(struct raw_ring *ring)
+{
+	struct can_raw_block_desc *desc = raw_ring_block(ring, ring->cur);
+
+	if (smp_load_acquire(&desc->status) != CAN_RAW_BLK_KERNEL)
+		return false;
+
+	desc->num_frames = 0;
+	desc->offset_to_first = RAW_RING_DESC_LEN;
+	desc->blk_len = 0;
+	desc->seq_num = ring->seq++;
+	desc->dropped = ring->dropped;
+	ring->dropped = 0;
+
+	ring->offset = RAW_RING_DESC_LEN;
+	ring->last = NULL;
+	mod_timer(&ring->timer, jiffies + ring->tov);
+
+	return true;
+}
+
+/* Called with ring->lock held, hands the current block to user space */
+static void raw_ring_close_block(struct raw_ring *ring)
+{
+	struct can_raw_block_desc *desc = raw_ring_block(ring, ring->cur);
+
+	desc->blk_len = ring->offset;
+	smp_store_release(&desc->status, CAN_RAW_BLK_USER);
+
+	ring->cur = (ring->cur + 1) % ring->block_nr;
+	ring->offset = 0;
+	ring->last = NULL;
+}
+
+static void raw_ring_retire(struct timer_list *t)
+{
+	struct raw_ring *ring = from_timer(ring, t, timer);
+	bool wake = false;
+
+	spin_lock_bh(&ring->lock);
+	if (ring->offset && ring->last) {
+		raw_ring_close_block(ring);
+		wake = true;
+	}
+	spin_unlock_bh(&ring->lock);
+
+	if (wake)
+		ring->sk->sk_data_ready(ring->sk);
+}
+
+static void raw_ring_rcv(struct raw_ring *ring, struct sk_buff *skb,
+			 unsigned int flags)
+{
+	unsigned int len = RAW_RING_HDR_LEN + skb->len;
+	struct can_raw_frame_hdr *hdr;
+	bool wake = false;
+
+	spin_lock(&ring->lock);
+
+	if (ring->offset && ring->offset + len > ring->block_size) {
+		raw_ring_close_block(ring);
+		wake = true;
+	}
+
+	if (!ring->offset && !raw_ring_open_block(ring)) {
+		ring->dropped++;
+		goto out;
+	}
+
+	hdr = (void *)raw_ring_block(ring, ring->cur) + ring->offset;
+	hdr->next_offset = 0;
+	hdr->len = skb->len;
+	hdr->tstamp = skb->tstamp ? ktime_to_ns(skb->tstamp) :
+				    ktime_get_real_ns();
+	hdr->hwtstamp = ktime_to_ns(skb_hwtstamps(skb)->hwtstamp);
+	hdr->ifindex = skb->dev->ifindex;
+	hdr->flags = flags;
+	memcpy((void *)hdr + RAW_RING_HDR_LEN, skb->data, skb->len);
+
+	if (ring->last)
+		ring->last->next_offset = (void *)hdr - (void *)ring->last;
+	ring->last = hdr;
+	raw_ring_block(ring, ring->cur)->num_frames++;
+	ring->offset += ALIGN(len, CAN_RAW_RING_ALIGN);
+
+out:
+	spin_unlock(&ring->lock);
+
+	if (wake)
+		ring->sk->sk_data_ready(ring->sk);
+}
+
 static void raw_rcv(struct sk_buff *oskb, void *data)
 {
 	struct sock *sk = (struct sock *)data;
 	struct raw_sock *ro = raw_sk(sk);
 	struct sockaddr_can *addr;
+	struct raw_ring *ring;
 	struct sk_buff *skb;
 	unsigned int *pflags;
 
@@ -157,6 +285,15 @@ static void raw_rcv(struct sk_buff *oskb, void *data)
 			return;
 	}
 
+	/* copy the frame straight into the mmap()ed ring, if there is one */
+	ring = rcu_dereference(ro->rx_ring);
+	if (ring) {
+		raw_ring_rcv(ring, oskb,
+			     (oskb->sk ? CAN_RAW_FRAME_LOCAL : 0) |
+			     (oskb->sk == sk ? CAN_RAW_FRAME_OWN : 0));
+		return;
+	}
+
 	/* clone the given skb to be able to enqueue it into the rcv queue */
 	skb = skb_clone(oskb, GFP_ATOMIC);
 	if (!skb)
@@ -336,6 +473,150 @@ static int raw_notifier(struct notifier_block *nb, unsigned long msg,
 	return NOTIFY_DONE;
 }
 
+static void raw_free_ring(struct raw_sock *ro)
+{
+	struct raw_ring *ring;
+
+	ring = rcu_replace_pointer(ro->rx_ring, NULL,
+				   lockdep_sock_is_held(&ro->sk));
+	if (!ring)
+		return;
+
+	/* wait for raw_rcv() to be done with it */
+	synchronize_net();
+	timer_shutdown_sync(&ring->timer);
+	vfree(ring->buf);
+	kfree(ring);
+}
+
+static int raw_set_ring(struct sock *sk, struct can_raw_ring_req *req)
+{
+	struct raw_sock *ro = raw_sk(sk);
+	struct raw_ring *ring;
+	size_t size;
+
+	ring = rcu_dereference_protected(ro->rx_ring, lockdep_sock_is_held(sk));
+	if (ring && atomic_read(&ring->mapped))
+		return -EBUSY;
+
+	if (!req->block_nr) {
+		raw_free_ring(ro);
+		return 0;
+	}
+
+	if (ring)
+		return -EBUSY;
+
+	/* every block must hold at least one frame of the largest kind */
+	if (!req->block_size || !PAGE_ALIGNED(req->block_size) ||
+	    req->block_size < RAW_RING_DESC_LEN + RAW_RING_HDR_LEN + CANXL_MTU)
+		return -EINVAL;
+
+	if (check_mul_overflow((size_t)req->block_size, (size_t)req->block_nr,
+			       &size) || size > INT_MAX)
+		return -EINVAL;
+
+	ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+
+	/* zeroed, so every block starts out as CAN_RAW_BLK_KERNEL */
+	ring->buf = vmalloc_user(size);
+	if (!ring->buf) {
+		kfree(ring);
+		return -ENOMEM;
+	}
+
+	ring->block_size = req->block_size;
+	ring->block_nr = req->block_nr;
+	ring->tov = msecs_to_jiffies(req->retire_tov ?: RAW_RING_DEFAULT_TOV);
+	spin_lock_init(&ring->lock);
+	timer_setup(&ring->timer, raw_ring_retire, 0);
+	ring->sk = sk;
+	atomic_set(&ring->mapped, 0);
+
+	rcu_assign_pointer(ro->rx_ring, ring);
+
+	return 0;
+}
+
+static void raw_ring_vm_open(struct vm_area_struct *vma)
+{
+	struct raw_ring *ring = vma->vm_private_data;
+
+	atomic_inc(&ring->mapped);
+}
+
+static void raw_ring_vm_close(struct vm_area_struct *vma)
+{
+	struct raw_ring *ring = vma->vm_private_data;
+
+	atomic_dec(&ring->mapped);
+}
+
+static const struct vm_operations_struct raw_ring_vm_ops = {
+	.open	= raw_ring_vm_open,
+	.close	= raw_ring_vm_close,
+};
+
+static int raw_mmap(struct file *file, struct socket *sock,
+		    struct vm_area_struct *vma)
+{
+	struct sock *sk = sock->sk;
+	struct raw_sock *ro = raw_sk(sk);
+	struct raw_ring *ring;
+	int err = -EINVAL;
+
+	if (vma->vm_pgoff)
+		return -EINVAL;
+
+	lock_sock(sk);
+
+	ring = rcu_dereference_protected(ro->rx_ring, lockdep_sock_is_held(sk));
+	if (!ring ||
+	    vma->vm_end - vma->vm_start !=
+	    (size_t)ring->block_size * ring->block_nr)
+		goto out;
+
+	err = remap_vmalloc_range(vma, ring->buf, 0);
+	if (err)
+		goto out;
+
+	vma->vm_private_data = ring;
+	vma->vm_ops = &raw_ring_vm_ops;
+	atomic_inc(&ring->mapped);
+
+out:
+	release_sock(sk);
+	return err;
+}
+
+static __poll_t raw_poll(struct file *file, struct socket *sock,
+			 poll_table *wait)
+{
+	struct raw_sock *ro = raw_sk(sock->sk);
+	__poll_t mask = datagram_poll(file, sock, wait);
+	struct can_raw_block_desc *desc;
+	struct raw_ring *ring;
+
+	rcu_read_lock();
+	ring = rcu_dereference(ro->rx_ring);
+	if (ring) {
+		/* the block before the one being filled is the oldest one
+		 * handed out, unless user space has given it back already
+		 */
+		spin_lock_bh(&ring->lock);
+		desc = raw_ring_block(ring, (ring->cur + ring->block_nr - 1) %
+					    ring->block_nr);
+		if (smp_load_acquire(&desc->status) != CAN_RAW_BLK_KERNEL)
+			mask |= EPOLLIN | EPOLLRDNORM;
+		spin_unlock_bh(&ring->lock);
+	}
+	rcu_read_unlock();
+
+	return mask;
+}
+
 static int raw_init(struct sock *sk)
 {
 	struct raw_sock *ro = raw_sk(sk);
@@ -356,6 +637,7 @@ static int raw_init(struct sock *sk)
 	ro->fd_frames        = 0;
 	ro->xl_frames        = 0;
 	ro->join_filters     = 0;
+	RCU_INIT_POINTER(ro->rx_ring, NULL);
 
 	/* alloc_percpu provides zero'ed memory */
 	ro->uniq = alloc_percpu(struct uniqframe);
@@ -405,6 +687,8 @@ static int raw_release(struct socket *sock)
 	if (ro->count > 1)
 		kfree(ro->filter);
 
+	raw_free_ring(ro);
+
 	ro->ifindex = 0;
 	ro->bound = 0;
 	ro->dev = NULL;
@@ -708,6 +992,22 @@ static int raw_setsockopt(struct socket *sock, int level, int optname,
 
 		break;
 
+	case CAN_RAW_RX_RING: {
+		struct can_raw_ring_req req;
+
+		if (optlen != sizeof(req))
+			return -EINVAL;
+
+		if (copy_from_sockptr(&req, optval, optlen))
+			return -EFAULT;
+
+		lock_sock(sk);
+		err = raw_set_ring(sk, &req);
+		release_sock(sk);
+
+		break;
+	}
+
 	default:
 		return -ENOPROTOOPT;
 	}
@@ -961,7 +1261,7 @@ static const struct proto_ops raw_ops = {
 	.socketpair    = sock_no_socketpair,
 	.accept        = sock_no_accept,
 	.getname       = raw_getname,
-	.poll          = datagram_poll,
+	.poll          = raw_poll,
 	.ioctl         = raw_sock_no_ioctlcmd,
 	.gettstamp     = sock_gettstamp,
 	.listen        = sock_no_listen,
@@ -970,7 +1270,7 @@ static const struct proto_ops raw_ops = {
 	.getsockopt    = raw_getsockopt,
 	.sendmsg       = raw_sendmsg,
 	.recvmsg       = raw_recvmsg,
-	.mmap          = sock_no_mmap,
+	.mmap          = raw_mmap,
 };
 
 static struct proto raw_proto __read_mostly = {
@@ -1475,6 +1475,74 @@ struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 	return ssk;
 }
 
+/* latency-aware variant of the above, used by the "latency" scheduler;
+ * picks the subflow expected to deliver the next burst first: half its
+ * smoothed RTT plus the time its pacing rate needs to drain what is already
+ * queued on it and the burst itself. A bloated queue on a cellular link
+ * inflates both terms, so traffic moves to the other path as soon as the
+ * queue builds up, rather than once its send buffer is full.
+ */
+struct sock *mptcp_subflow_get_send_lat(struct mptcp_sock *msk)
+{
+	struct subflow_send_info send_info[SSK_MODE_MAX];
+	struct mptcp_subflow_context *subflow;
+	struct sock *sk = (struct sock *)msk;
+	int i, nr_active = 0;
+	struct sock *ssk;
+	long tout = 0;
+	u64 delay;
+	int burst;
+
+	for (i = 0; i < SSK_MODE_MAX; ++i) {
+		send_info[i].ssk = NULL;
+		send_info[i].linger_time = -1;
+	}
+
+	burst = min_t(int, MPTCP_SEND_BURST_SIZE, mptcp_wnd_end(msk) - msk->snd_nxt);
+	burst = max(burst, 0);
+
+	mptcp_for_each_subflow(msk, subflow) {
+		bool backup = subflow->backup || subflow->request_bkup;
+		unsigned long pace;
+
+		trace_mptcp_subflow_get_send(subflow);
+		ssk = mptcp_subflow_tcp_sock(subflow);
+		if (!mptcp_subflow_active(subflow))
+			continue;
+
+		tout = max(tout, mptcp_timeout_from_subflow(subflow));
+		nr_active += !backup;
+		pace = READ_ONCE(ssk->sk_pacing_rate);
+		if (!pace)
+			continue;
+
+		/* srtt_us is stored << 3 */
+		delay = (u64)(READ_ONCE(tcp_sk(ssk)->srtt_us) >> 4) * NSEC_PER_USEC;
+		delay += div64_ul((u64)(READ_ONCE(ssk->sk_wmem_queued) + burst) *
+				  NSEC_PER_SEC, pace);
+		if (delay < send_info[backup].linger_time) {
+			send_info[backup].ssk = ssk;
+			send_info[backup].linger_time = delay;
+		}
+	}
+	__mptcp_set_timeout(sk, tout);
+
+	/* pick the best backup if no other subflow is active */
+	if (!nr_active)
+		send_info[SSK_MODE_ACTIVE].ssk = send_info[SSK_MODE_BACKUP].ssk;
+
+	/* as above, wait for the best subflow rather than filling a slower
+	 * one, which would only add head-of-line blocking at the receiver
+	 */
+	ssk = send_info[SSK_MODE_ACTIVE].ssk;
+	if (!ssk || !sk_stream_memory_free(ssk))
+		return NULL;
+
+	if (burst)
+		msk->snd_burst = burst;
+	return ssk;
+}
+
 static void mptcp_push_release(struct sock *ssk, struct mptcp_sendmsg_info *info)
 {
 	tcp_push(ssk, 0, info->mss_now, tcp_sk(ssk)->nonagle, info->size_goal);
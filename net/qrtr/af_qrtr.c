@@ -122,6 +122,7 @@ static DEFINE_XARRAY_ALLOC(qrtr_ports);
  * @qrtr_tx_lock: lock for qrtr_tx_flow inserts
  * @rx_queue: receive queue
  * @item: list item for broadcast list
+ * @rcu: for freeing the node after lockless lookups are done with it
  */
 struct qrtr_node {
 	struct mutex ep_lock;
@@ -134,6 +135,7 @@ struct qrtr_node {
 
 	struct sk_buff_head rx_queue;
 	struct list_head item;
+	struct rcu_head rcu;
 };
 
 /**
@@ -194,15 +196,7 @@ static void __qrtr_node_release(struct kref *kref)
 		radix_tree_iter_delete(&node->qrtr_tx_flow, &iter, slot);
 		kfree(flow);
 	}
-	kfree(node);
-}
-
-/* Increment reference to node. */
-static struct qrtr_node *qrtr_node_acquire(struct qrtr_node *node)
-{
-	if (node)
-		kref_get(&node->ref);
-	return node;
+	kfree_rcu(node, rcu);
 }
 
 /* Decrement reference to node and release as necessary. */
@@ -234,8 +228,8 @@ static void qrtr_tx_resume(struct qrtr_node *node, struct sk_buff *skb)
 	if (flow) {
 		spin_lock(&flow->resume_tx.lock);
 		flow->pending = 0;
+		wake_up_locked(&flow->resume_tx);
 		spin_unlock(&flow->resume_tx.lock);
-		wake_up_interruptible_all(&flow->resume_tx);
 	}
 
 	consume_skb(skb);
@@ -268,19 +262,28 @@ static int qrtr_tx_wait(struct qrtr_node *node, int dest_node, int dest_port,
 	if (type != QRTR_TYPE_DATA)
 		return 0;
 
-	mutex_lock(&node->qrtr_tx_lock);
+	/* Flows are only freed with the node, so once created they can be
+	 * looked up without the lock.
+	 */
+	rcu_read_lock();
 	flow = radix_tree_lookup(&node->qrtr_tx_flow, key);
+	rcu_read_unlock();
+
 	if (!flow) {
-		flow = kzalloc(sizeof(*flow), GFP_KERNEL);
-		if (flow) {
-			init_waitqueue_head(&flow->resume_tx);
-			if (radix_tree_insert(&node->qrtr_tx_flow, key, flow)) {
-				kfree(flow);
-				flow = NULL;
+		mutex_lock(&node->qrtr_tx_lock);
+		flow = radix_tree_lookup(&node->qrtr_tx_flow, key);
+		if (!flow) {
+			flow = kzalloc(sizeof(*flow), GFP_KERNEL);
+			if (flow) {
+				init_waitqueue_head(&flow->resume_tx);
+				if (radix_tree_insert(&node->qrtr_tx_flow, key, flow)) {
+					kfree(flow);
+					flow = NULL;
+				}
 			}
 		}
+		mutex_unlock(&node->qrtr_tx_lock);
 	}
-	mutex_unlock(&node->qrtr_tx_lock);
 
 	/* Set confirm_rx if we where unable to find and allocate a flow */
 	if (!flow)
@@ -393,14 +396,15 @@ static int qrtr_node_enqueue(struct qrtr_node *node, struct sk_buff *skb,
 static struct qrtr_node *qrtr_node_lookup(unsigned int nid)
 {
 	struct qrtr_node *node;
-	unsigned long flags;
 
-	mutex_lock(&qrtr_node_lock);
-	spin_lock_irqsave(&qrtr_nodes_lock, flags);
+	/* A node being released drops out of the tree before it is freed,
+	 * after a grace period; until then only its reference can be dead.
+	 */
+	rcu_read_lock();
 	node = radix_tree_lookup(&qrtr_nodes, nid);
-	node = qrtr_node_acquire(node);
-	spin_unlock_irqrestore(&qrtr_nodes_lock, flags);
-	mutex_unlock(&qrtr_node_lock);
+	if (node && !kref_get_unless_zero(&node->ref))
+		node = NULL;
+	rcu_read_unlock();
 
 	return node;
 }
@@ -425,33 +429,29 @@ static void qrtr_node_assign(struct qrtr_node *node, unsigned int nid)
 }
 
 /**
- * qrtr_endpoint_post() - post incoming data
+ * qrtr_endpoint_post_skb() - post incoming packet without copying it
  * @ep: endpoint handle
- * @data: data pointer
- * @len: size of data in bytes
+ * @skb: the packet, QRTR header included, in the linear part of the skb
+ *
+ * The skb is consumed in all cases.
  *
  * Return: 0 on success; negative error code on failure
  */
-int qrtr_endpoint_post(struct qrtr_endpoint *ep, const void *data, size_t len)
+int qrtr_endpoint_post_skb(struct qrtr_endpoint *ep, struct sk_buff *skb)
 {
 	struct qrtr_node *node = ep->node;
+	struct qrtr_cb *cb = (struct qrtr_cb *)skb->cb;
+	const void *data = skb->data;
+	size_t len = skb_headlen(skb);
 	const struct qrtr_hdr_v1 *v1;
 	const struct qrtr_hdr_v2 *v2;
 	struct qrtr_sock *ipc;
-	struct sk_buff *skb;
-	struct qrtr_cb *cb;
 	size_t size;
 	unsigned int ver;
 	size_t hdrlen;
 
-	if (len == 0 || len & 3)
-		return -EINVAL;
-
-	skb = __netdev_alloc_skb(NULL, len, GFP_ATOMIC | __GFP_NOWARN);
-	if (!skb)
-		return -ENOMEM;
-
-	cb = (struct qrtr_cb *)skb->cb;
+	if (len == 0 || len & 3 || skb_is_nonlinear(skb))
+		goto err;
 
 	/* Version field in v1 is little endian, so this works for both cases */
 	ver = *(u8*)data;
@@ -512,7 +512,8 @@ int qrtr_endpoint_post(struct qrtr_endpoint *ep, const void *data, size_t len)
 	    cb->type != QRTR_TYPE_RESUME_TX)
 		goto err;
 
-	skb_put_data(skb, data + hdrlen, size);
+	skb_pull(skb, hdrlen);
+	skb_trim(skb, size);
 
 	qrtr_node_assign(node, cb->src_node);
 
@@ -520,7 +521,7 @@ int qrtr_endpoint_post(struct qrtr_endpoint *ep, const void *data, size_t len)
 		/* Remote node endpoint can bridge other distant nodes */
 		const struct qrtr_ctrl_pkt *pkt;
 
-		pkt = data + hdrlen;
+		pkt = (const struct qrtr_ctrl_pkt *)skb->data;
 		qrtr_node_assign(node, le32_to_cpu(pkt->server.node));
 	}
 
@@ -546,6 +547,31 @@ int qrtr_endpoint_post(struct qrtr_endpoint *ep, const void *data, size_t len)
 	return -EINVAL;
 
 }
+EXPORT_SYMBOL_GPL(qrtr_endpoint_post_skb);
+
+/**
+ * qrtr_endpoint_post() - post incoming data
+ * @ep: endpoint handle
+ * @data: data pointer
+ * @len: size of data in bytes
+ *
+ * Return: 0 on success; negative error code on failure
+ */
+int qrtr_endpoint_post(struct qrtr_endpoint *ep, const void *data, size_t len)
+{
+	struct sk_buff *skb;
+
+	if (len == 0 || len & 3)
+		return -EINVAL;
+
+	skb = __netdev_alloc_skb(NULL, len, GFP_ATOMIC | __GFP_NOWARN);
+	if (!skb)
+		return -ENOMEM;
+
+	skb_put_data(skb, data, len);
+
+	return qrtr_endpoint_post_skb(ep, skb);
+}
 EXPORT_SYMBOL_GPL(qrtr_endpoint_post);
 
 /**
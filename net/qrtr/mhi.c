@@ -8,17 +8,147 @@
 #include <linux/mod_devicetable.h>
 #include <linux/module.h>
 #include <linux/skbuff.h>
+#include <linux/workqueue.h>
+#include <net/page_pool/helpers.h>
 #include <net/sock.h>
 
 #include "qrtr.h"
 
+static bool rx_zero_copy;
+module_param(rx_zero_copy, bool, 0444);
+MODULE_PARM_DESC(rx_zero_copy,
+		 "Receive into pre-posted page pool buffers instead of copying");
+
+/* Same as the MHI core uses for the buffers it queues itself */
+#define QRTR_MHI_MAX_MTU	0xffff
+#define QRTR_MHI_POOL_SIZE	64
+#define QRTR_MHI_REFILL_DELAY	msecs_to_jiffies(50)
+
 struct qrtr_mhi_dev {
 	struct qrtr_endpoint ep;
 	struct mhi_device *mhi_dev;
 	struct device *dev;
 	struct completion prepared;
+
+	/* zero-copy receive */
+	struct page_pool *pool;
+	spinlock_t pool_lock;		/* serializes allocations from the pool */
+	unsigned int buf_len;
+	unsigned int truesize;
+	struct delayed_work refill;
 };
 
+/* Keep the DL channel filled with empty buffers. Returns false if it had to
+ * stop because no buffer could be allocated.
+ */
+static bool qcom_mhi_qrtr_rx_refill(struct qrtr_mhi_dev *qdev)
+{
+	struct mhi_device *mhi_dev = qdev->mhi_dev;
+	struct page *page;
+	bool ret = true;
+	int queued = 0;
+	int n;
+
+	spin_lock_bh(&qdev->pool_lock);
+	n = mhi_get_free_desc_count(mhi_dev, DMA_FROM_DEVICE);
+	while (n-- > 0) {
+		page = page_pool_dev_alloc_pages(qdev->pool);
+		if (!page) {
+			ret = false;
+			break;
+		}
+
+		if (mhi_queue_buf(mhi_dev, DMA_FROM_DEVICE, page_address(page),
+				  qdev->buf_len, MHI_EOT | MHI_DEFER_DB)) {
+			page_pool_put_full_page(qdev->pool, page, false);
+			break;
+		}
+		queued++;
+	}
+	if (queued)
+		mhi_queue_flush(mhi_dev, DMA_FROM_DEVICE);
+	spin_unlock_bh(&qdev->pool_lock);
+
+	return ret;
+}
+
+static void qcom_mhi_qrtr_refill_work(struct work_struct *work)
+{
+	struct qrtr_mhi_dev *qdev = container_of(to_delayed_work(work),
+						 struct qrtr_mhi_dev, refill);
+
+	if (!qcom_mhi_qrtr_rx_refill(qdev))
+		schedule_delayed_work(&qdev->refill, QRTR_MHI_REFILL_DELAY);
+}
+
+/* The packet is passed on in the buffer it was received into, which goes back
+ * to the pool once the skb is freed.
+ */
+static void qcom_mhi_qrtr_rx_zc(struct qrtr_mhi_dev *qdev,
+				struct mhi_result *mhi_res)
+{
+	struct page *page = virt_to_page(mhi_res->buf_addr);
+	struct sk_buff *skb;
+	int rc;
+
+	/* channel is being reset, don't queue buffers again */
+	if (mhi_res->transaction_status == -ENOTCONN) {
+		page_pool_put_full_page(qdev->pool, page, false);
+		return;
+	}
+
+	if (mhi_res->transaction_status) {
+		page_pool_put_full_page(qdev->pool, page, false);
+		goto refill;
+	}
+
+	skb = build_skb(mhi_res->buf_addr, qdev->truesize);
+	if (!skb) {
+		page_pool_put_full_page(qdev->pool, page, false);
+		goto refill;
+	}
+	skb_mark_for_recycle(skb);
+	skb_put(skb, mhi_res->bytes_xferd);
+
+	rc = qrtr_endpoint_post_skb(&qdev->ep, skb);
+	if (rc == -EINVAL)
+		dev_err(qdev->dev, "invalid ipcrouter packet\n");
+
+refill:
+	if (!qcom_mhi_qrtr_rx_refill(qdev))
+		schedule_delayed_work(&qdev->refill, QRTR_MHI_REFILL_DELAY);
+}
+
+static int qcom_mhi_qrtr_rx_zc_init(struct qrtr_mhi_dev *qdev)
+{
+	struct page_pool_params pp_params = {};
+	unsigned int size;
+
+	qdev->buf_len = qdev->mhi_dev->mhi_cntrl->buffer_len ?: QRTR_MHI_MAX_MTU;
+	size = SKB_DATA_ALIGN(qdev->buf_len) +
+	       SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+
+	/* The MHI core maps the buffers itself */
+	pp_params.order = get_order(size);
+	pp_params.pool_size = QRTR_MHI_POOL_SIZE;
+	pp_params.nid = dev_to_node(qdev->dev);
+	pp_params.dev = qdev->dev;
+
+	qdev->pool = page_pool_create(&pp_params);
+	if (IS_ERR(qdev->pool)) {
+		int rc = PTR_ERR(qdev->pool);
+
+		qdev->pool = NULL;
+		return rc;
+	}
+
+	qdev->truesize = PAGE_SIZE << pp_params.order;
+	spin_lock_init(&qdev->pool_lock);
+	INIT_DELAYED_WORK(&qdev->refill, qcom_mhi_qrtr_refill_work);
+
+	return 0;
+}
+
 /* From MHI to QRTR */
 static void qcom_mhi_qrtr_dl_callback(struct mhi_device *mhi_dev,
 				      struct mhi_result *mhi_res)
@@ -26,6 +156,11 @@ static void qcom_mhi_qrtr_dl_callback(struct mhi_device *mhi_dev,
 	struct qrtr_mhi_dev *qdev = dev_get_drvdata(&mhi_dev->dev);
 	int rc;
 
+	if (qdev && qdev->pool) {
+		qcom_mhi_qrtr_rx_zc(qdev, mhi_res);
+		return;
+	}
+
 	if (!qdev || mhi_res->transaction_status)
 		return;
 
@@ -93,22 +228,39 @@ static int qcom_mhi_qrtr_probe(struct mhi_device *mhi_dev,
 	qdev->ep.xmit = qcom_mhi_qrtr_send;
 	init_completion(&qdev->prepared);
 
+	if (rx_zero_copy) {
+		rc = qcom_mhi_qrtr_rx_zc_init(qdev);
+		if (rc)
+			return rc;
+	}
+
 	dev_set_drvdata(&mhi_dev->dev, qdev);
 	rc = qrtr_endpoint_register(&qdev->ep, QRTR_EP_NID_AUTO);
 	if (rc)
-		return rc;
+		goto destroy_pool;
 
 	/* start channels */
-	rc = mhi_prepare_for_transfer_autoqueue(mhi_dev);
+	if (qdev->pool)
+		rc = mhi_prepare_for_transfer(mhi_dev);
+	else
+		rc = mhi_prepare_for_transfer_autoqueue(mhi_dev);
 	if (rc) {
 		qrtr_endpoint_unregister(&qdev->ep);
-		return rc;
+		goto destroy_pool;
 	}
+
+	if (qdev->pool && !qcom_mhi_qrtr_rx_refill(qdev))
+		schedule_delayed_work(&qdev->refill, QRTR_MHI_REFILL_DELAY);
 	complete_all(&qdev->prepared);
 
 	dev_dbg(qdev->dev, "Qualcomm MHI QRTR driver probed\n");
 
 	return 0;
+
+destroy_pool:
+	if (qdev->pool)
+		page_pool_destroy(qdev->pool);
+	return rc;
 }
 
 static void qcom_mhi_qrtr_remove(struct mhi_device *mhi_dev)
@@ -116,7 +268,12 @@ static void qcom_mhi_qrtr_remove(struct mhi_device *mhi_dev)
 	struct qrtr_mhi_dev *qdev = dev_get_drvdata(&mhi_dev->dev);
 
 	qrtr_endpoint_unregister(&qdev->ep);
+	/* hands the queued buffers back with -ENOTCONN */
 	mhi_unprepare_from_transfer(mhi_dev);
+	if (qdev->pool) {
+		cancel_delayed_work_sync(&qdev->refill);
+		page_pool_destroy(qdev->pool);
+	}
 	dev_set_drvdata(&mhi_dev->dev, NULL);
 }
 
@@ -29,6 +29,8 @@ void qrtr_endpoint_unregister(struct qrtr_endpoint *ep);
 
 int qrtr_endpoint_post(struct qrtr_endpoint *ep, const void *data, size_t len);
 
+int qrtr_endpoint_post_skb(struct qrtr_endpoint *ep, struct sk_buff *skb);
+
 int qrtr_ns_init(void);
 
 void qrtr_ns_remove(void);
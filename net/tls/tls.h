@@ -38,6 +38,7 @@
 #include <asm/byteorder.h>
 #include <linux/types.h>
 #include <linux/skmsg.h>
+#include <net/netns/generic.h>
 #include <net/tls.h>
 #include <net/tls_prot.h>
 
@@ -51,6 +52,31 @@
 #define TLS_DEC_STATS(net, field)				\
 	SNMP_DEC_STATS((net)->mib.tls_statistics, field)
 
+/* Counters of the software implementation kept outside the SNMP MIB */
+enum {
+	TLS_SW_MIB_TX_ZC_RECORD,	/* TlsTxSwZcRecord */
+	TLS_SW_MIB_TX_SMALL_RECORD,	/* TlsTxSwSmallRecord */
+	__TLS_SW_MIB_MAX
+};
+
+struct tls_sw_mib {
+	unsigned long mibs[__TLS_SW_MIB_MAX];
+};
+
+struct tls_net {
+	DEFINE_SNMP_STAT(struct tls_sw_mib, sw_statistics);
+};
+
+extern unsigned int tls_net_id;
+
+static inline struct tls_net *tls_net(const struct net *net)
+{
+	return net_generic(net, tls_net_id);
+}
+
+#define TLS_SW_INC_STATS(net, field)				\
+	SNMP_INC_STATS(tls_net(net)->sw_statistics, field)
+
 struct tls_cipher_desc {
 	unsigned int nonce;
 	unsigned int iv;
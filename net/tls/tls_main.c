@@ -1083,19 +1083,30 @@ static size_t tls_get_info_size(const struct sock *sk)
 	return size;
 }
 
+unsigned int tls_net_id __read_mostly;
+
 static int __net_init tls_init_net(struct net *net)
 {
+	struct tls_net *tn = tls_net(net);
 	int err;
 
 	net->mib.tls_statistics = alloc_percpu(struct linux_tls_mib);
 	if (!net->mib.tls_statistics)
 		return -ENOMEM;
 
+	tn->sw_statistics = alloc_percpu(struct tls_sw_mib);
+	if (!tn->sw_statistics) {
+		err = -ENOMEM;
+		goto err_free_stats;
+	}
+
 	err = tls_proc_init(net);
 	if (err)
-		goto err_free_stats;
+		goto err_free_sw_stats;
 
 	return 0;
+err_free_sw_stats:
+	free_percpu(tn->sw_statistics);
 err_free_stats:
 	free_percpu(net->mib.tls_statistics);
 	return err;
@@ -1104,12 +1115,15 @@ static int __net_init tls_init_net(struct net *net)
 static void __net_exit tls_exit_net(struct net *net)
 {
 	tls_proc_fini(net);
+	free_percpu(tls_net(net)->sw_statistics);
 	free_percpu(net->mib.tls_statistics);
 }
 
 static struct pernet_operations tls_proc_ops = {
 	.init = tls_init_net,
 	.exit = tls_exit_net,
+	.id = &tls_net_id,
+	.size = sizeof(struct tls_net),
 };
 
 static struct tcp_ulp_ops tcp_tls_ulp_ops __read_mostly = {
@@ -25,8 +25,15 @@ static const struct snmp_mib tls_mib_list[] = {
 	SNMP_MIB_SENTINEL
 };
 
+static const struct snmp_mib tls_sw_mib_list[] = {
+	SNMP_MIB_ITEM("TlsTxSwZcRecord", TLS_SW_MIB_TX_ZC_RECORD),
+	SNMP_MIB_ITEM("TlsTxSwSmallRecord", TLS_SW_MIB_TX_SMALL_RECORD),
+	SNMP_MIB_SENTINEL
+};
+
 static int tls_statistics_seq_show(struct seq_file *seq, void *v)
 {
+	unsigned long sw_buf[__TLS_SW_MIB_MAX] = {};
 	unsigned long buf[LINUX_MIB_TLSMAX] = {};
 	struct net *net = seq->private;
 	int i;
@@ -35,6 +42,12 @@ static int tls_statistics_seq_show(struct seq_file *seq, void *v)
 	for (i = 0; tls_mib_list[i].name; i++)
 		seq_printf(seq, "%-32s\t%lu\n", tls_mib_list[i].name, buf[i]);
 
+	snmp_get_cpu_field_batch(sw_buf, tls_sw_mib_list,
+				 tls_net(net)->sw_statistics);
+	for (i = 0; tls_sw_mib_list[i].name; i++)
+		seq_printf(seq, "%-32s\t%lu\n", tls_sw_mib_list[i].name,
+			   sw_buf[i]);
+
 	return 0;
 }
 #endif
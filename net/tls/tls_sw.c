@@ -48,6 +48,20 @@
 
 #include "tls.h"
 
+static bool prefer_async_crypto;
+module_param(prefer_async_crypto, bool, 0644);
+MODULE_PARM_DESC(prefer_async_crypto,
+		 "Prefer asynchronous AEAD implementations, such as crypto engines, for new software kTLS sessions");
+
+static bool dynamic_record_size;
+module_param(dynamic_record_size, bool, 0644);
+MODULE_PARM_DESC(dynamic_record_size,
+		 "Send one-segment records while the TCP congestion window is small");
+
+/* Full records are used once the congestion window holds this many */
+#define TLS_DYN_RECORDS_PER_CWND	4
+#define TLS_DYN_MIN_PAYLOAD		512
+
 struct tls_decrypt_arg {
 	struct_group(inargs,
 	bool zc;
@@ -971,6 +985,32 @@ static int tls_sw_push_pending_record(struct sock *sk, int flags)
 				   &copied, flags);
 }
 
+/* A record can only be decrypted once all of it has arrived. While the
+ * congestion window is too small to carry several full records, at the start
+ * of a connection or when it restarts after idling, a full record spreads over
+ * more than one round trip. Records of one segment are decrypted as they land.
+ * Bulk transfers grow the window quickly and go back to full records.
+ */
+static int tls_sw_record_room(struct sock *sk, struct tls_prot_info *prot,
+			      struct sk_msg *msg_pl)
+{
+	int size = TLS_MAX_PAYLOAD_SIZE;
+
+	if (READ_ONCE(dynamic_record_size)) {
+		u32 mss = tcp_current_mss(sk);
+
+		if ((u64)tcp_snd_cwnd(tcp_sk(sk)) * mss <
+		    TLS_DYN_RECORDS_PER_CWND * TLS_MAX_PAYLOAD_SIZE)
+			size = max_t(int, mss - prot->overhead_size,
+				     TLS_DYN_MIN_PAYLOAD);
+	}
+
+	if (size < TLS_MAX_PAYLOAD_SIZE && !msg_pl->sg.size)
+		TLS_SW_INC_STATS(sock_net(sk), TLS_SW_MIB_TX_SMALL_RECORD);
+
+	return max_t(int, size - msg_pl->sg.size, 0);
+}
+
 static int tls_sw_sendmsg_splice(struct sock *sk, struct msghdr *msg,
 				 struct sk_msg *msg_pl, size_t try_to_copy,
 				 ssize_t *copied)
@@ -1059,7 +1099,7 @@ static int tls_sw_sendmsg_locked(struct sock *sk, struct msghdr *msg,
 		orig_size = msg_pl->sg.size;
 		full_record = false;
 		try_to_copy = msg_data_left(msg);
-		record_room = TLS_MAX_PAYLOAD_SIZE - msg_pl->sg.size;
+		record_room = tls_sw_record_room(sk, prot, msg_pl);
 		if (try_to_copy >= record_room) {
 			try_to_copy = record_room;
 			full_record = true;
@@ -1091,6 +1131,9 @@ static int tls_sw_sendmsg_locked(struct sock *sk, struct msghdr *msg,
 			if (ret < 0)
 				goto send_end;
 			tls_ctx->pending_open_record_frags = true;
+			if (!orig_size)
+				TLS_SW_INC_STATS(sock_net(sk),
+						 TLS_SW_MIB_TX_ZC_RECORD);
 
 			if (sk_msg_full(msg_pl))
 				full_record = true;
@@ -1110,6 +1153,9 @@ static int tls_sw_sendmsg_locked(struct sock *sk, struct msghdr *msg,
 
 			num_zc++;
 			copied += try_to_copy;
+			if (!orig_size)
+				TLS_SW_INC_STATS(sock_net(sk),
+						 TLS_SW_MIB_TX_ZC_RECORD);
 
 			sk_msg_sg_copy_set(msg_pl, first);
 			ret = bpf_exec_tx_verdict(msg_pl, sk, full_record,
@@ -2657,6 +2703,25 @@ static struct tls_sw_context_rx *init_ctx_rx(struct tls_context *ctx)
 	return sw_ctx_rx;
 }
 
+/* Crypto engines are asynchronous and usually rank below the CPU's own
+ * instructions. Asking for an asynchronous implementation first moves record
+ * encryption and decryption off the CPU, with several records in flight on
+ * TX and, for TLS 1.2, on RX.
+ */
+static struct crypto_aead *tls_alloc_aead(const char *name)
+{
+	struct crypto_aead *aead;
+
+	if (READ_ONCE(prefer_async_crypto)) {
+		aead = crypto_alloc_aead(name, CRYPTO_ALG_ASYNC,
+					 CRYPTO_ALG_ASYNC);
+		if (!IS_ERR(aead))
+			return aead;
+	}
+
+	return crypto_alloc_aead(name, 0, 0);
+}
+
 int tls_set_sw_offload(struct sock *sk, struct tls_context *ctx, int tx)
 {
 	struct tls_context *tls_ctx = tls_get_ctx(sk);
@@ -2750,7 +2815,7 @@ int tls_set_sw_offload(struct sock *sk, struct tls_context *ctx, int tx)
 	}
 
 	if (!*aead) {
-		*aead = crypto_alloc_aead(cipher_desc->cipher_name, 0, 0);
+		*aead = tls_alloc_aead(cipher_desc->cipher_name);
 		if (IS_ERR(*aead)) {
 			rc = PTR_ERR(*aead);
 			*aead = NULL;
@@ -820,6 +820,57 @@ static bool xsk_no_wakeup(struct sock *sk)
 #endif
 }
 
+#ifdef CONFIG_NET_RX_BUSY_POLL
+static bool xsk_busy_loop_end(void *p, unsigned long start_time)
+{
+	struct xdp_sock *xs = p;
+
+	return !xskq_prod_is_empty(xs->rx) ||
+	       sk_busy_loop_timeout(&xs->sk, start_time);
+}
+#endif
+
+/* Sockets are non-blocking, so this is a single pass over the NAPI context
+ * unless XDP_BUSY_POLL_WAIT asks the RX side to keep polling until there is
+ * something on the RX ring. The RX queue accounts for the time spent and the
+ * descriptors the loop produced.
+ */
+static void xsk_busy_loop(struct xdp_sock *xs, bool rx)
+{
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	unsigned int napi_id = READ_ONCE(xs->sk.sk_napi_id);
+	struct xdp_busy_poll_stats *stats;
+	struct xsk_queue *q = xs->rx;
+	u32 prod, descs;
+	bool wait;
+	u64 start;
+
+	if (!q) {
+		sk_busy_loop(&xs->sk, 1);
+		return;
+	}
+	if (napi_id < MIN_NAPI_ID)
+		return;
+
+	wait = rx && READ_ONCE(q->busy_poll_wait);
+	prod = READ_ONCE(q->ring->producer);
+	start = ktime_get_ns();
+
+	napi_busy_loop(napi_id, wait ? xsk_busy_loop_end : NULL, xs,
+		       READ_ONCE(xs->sk.sk_prefer_busy_poll),
+		       READ_ONCE(xs->sk.sk_busy_poll_budget) ?: BUSY_POLL_BUDGET);
+
+	/* Racy if several threads poll the same socket, like the ring stats */
+	stats = &q->busy_poll;
+	stats->poll_ns += ktime_get_ns() - start;
+	descs = READ_ONCE(q->ring->producer) - prod;
+	stats->rx_descs += descs;
+	stats->polls++;
+	if (!descs)
+		stats->empty_polls++;
+#endif
+}
+
 static int xsk_check_common(struct xdp_sock *xs)
 {
 	if (unlikely(!xsk_is_bound(xs)))
@@ -849,7 +900,7 @@ static int __xsk_sendmsg(struct socket *sock, struct msghdr *m, size_t total_len
 	if (sk_can_busy_loop(sk)) {
 		if (xs->zc)
 			__sk_mark_napi_id_once(sk, xsk_pool_get_napi_id(xs->pool));
-		sk_busy_loop(sk, 1); /* only support non-blocking sockets */
+		xsk_busy_loop(xs, false);
 	}
 
 	if (xs->zc && xsk_no_wakeup(sk))
@@ -891,7 +942,7 @@ static int __xsk_recvmsg(struct socket *sock, struct msghdr *m, size_t len, int
 		return -EOPNOTSUPP;
 
 	if (sk_can_busy_loop(sk))
-		sk_busy_loop(sk, 1); /* only support non-blocking sockets */
+		xsk_busy_loop(xs, true);
 
 	if (xsk_no_wakeup(sk))
 		return 0;
@@ -1349,6 +1400,24 @@ static int xsk_setsockopt(struct socket *sock, int level, int optname,
 		mutex_unlock(&xs->mutex);
 		return err;
 	}
+	case XDP_BUSY_POLL_WAIT:
+	{
+		int wait;
+
+		if (optlen < sizeof(wait))
+			return -EINVAL;
+		if (copy_from_sockptr(&wait, optval, sizeof(wait)))
+			return -EFAULT;
+
+		mutex_lock(&xs->mutex);
+		if (!xs->rx) {
+			mutex_unlock(&xs->mutex);
+			return -EINVAL;
+		}
+		WRITE_ONCE(xs->rx->busy_poll_wait, !!wait);
+		mutex_unlock(&xs->mutex);
+		return 0;
+	}
 	default:
 		break;
 	}
@@ -1480,6 +1549,29 @@ static int xsk_getsockopt(struct socket *sock, int level, int optname,
 
 		return 0;
 	}
+	case XDP_BUSY_POLL_STATISTICS:
+	{
+		struct xdp_busy_poll_stats stats;
+
+		if (len < sizeof(stats))
+			return -EINVAL;
+
+		mutex_lock(&xs->mutex);
+		if (!xs->rx) {
+			mutex_unlock(&xs->mutex);
+			return -EINVAL;
+		}
+		stats = xs->rx->busy_poll;
+		mutex_unlock(&xs->mutex);
+
+		len = sizeof(stats);
+		if (copy_to_user(optval, &stats, len))
+			return -EFAULT;
+		if (put_user(len, optlen))
+			return -EFAULT;
+
+		return 0;
+	}
 	case XDP_OPTIONS:
 	{
 		struct xdp_options opts = {};
@@ -8,6 +8,7 @@
 
 #include <linux/types.h>
 #include <linux/if_xdp.h>
+#include <linux/if_xdp_busy_poll.h>
 #include <net/xdp_sock.h>
 #include <net/xsk_buff_pool.h>
 
@@ -46,6 +47,9 @@ struct xsk_queue {
 	u64 invalid_descs;
 	u64 queue_empty_descs;
 	size_t ring_vmalloc_size;
+	/* Busy polling of the socket, only kept on the RX queue */
+	bool busy_poll_wait;
+	struct xdp_busy_poll_stats busy_poll;
 };
 
 struct parsed_desc {
@@ -11,6 +11,8 @@
 #include <linux/slab.h>
 #include <linux/poll.h>
 #include <linux/idr.h>
+#include <linux/uio.h>
+#include <linux/xarray.h>
 #include <linux/of.h>
 #include <linux/fs.h>
 #include <linux/uaccess.h>
@@ -60,6 +62,8 @@ do {										\
  * @ch_name:	audio channel to match to
  * @audio_pkt_major: Major number of audio pkt driver
  * @audio_pkt_class: audio pkt class pointer
+ * @pa_cache:	fd to physical address translations, protected by @lock
+ * @pa_cache_gen: msm_audio_mem generation @pa_cache is valid for
  */
 struct audio_pkt_device {
 	gpr_device_t *adev;
@@ -77,6 +81,14 @@ struct audio_pkt_device {
 
 	dev_t audio_pkt_major;
 	struct class *audio_pkt_class;
+
+	struct xarray pa_cache;
+	unsigned long pa_cache_gen;
+};
+
+struct audio_pkt_pa {
+	dma_addr_t paddr;
+	size_t len;
 };
 
 struct audio_pkt_apm_cmd_shared_mem_map_regions_t {
@@ -112,6 +124,17 @@ struct audio_pkt_clnt_ch {
 #define dev_to_audpkt_dev(_dev) container_of(_dev, struct audio_pkt_device, dev)
 #define cdev_to_audpkt_dev(_cdev) container_of(_cdev, struct audio_pkt_device, cdev)
 
+static void audio_pkt_pa_cache_flush(struct audio_pkt_device *audpkt_dev)
+{
+	struct audio_pkt_pa *pa;
+	unsigned long fd;
+
+	xa_for_each(&audpkt_dev->pa_cache, fd, pa) {
+		xa_erase(&audpkt_dev->pa_cache, fd);
+		kfree(pa);
+	}
+}
+
 /**
  * audio_pkt_open() - open() syscall for the audio_pkt device
  * inode:	Pointer to the inode structure.
@@ -160,6 +183,10 @@ int audio_pkt_release(struct inode *inode, struct file *file)
 	wake_up_interruptible(&audpkt_dev->readq);
 	spin_unlock_irqrestore(&audpkt_dev->queue_lock, flags);
 
+	mutex_lock(&audpkt_dev->lock);
+	audio_pkt_pa_cache_flush(audpkt_dev);
+	mutex_unlock(&audpkt_dev->lock);
+
 	put_device(dev);
 	file->private_data = NULL;
 	q6apm_close_all();
@@ -179,32 +206,24 @@ int audio_pkt_release(struct inode *inode, struct file *file)
  * userspace client do a read() system call. All input arguments are
  * validated by the virtual file system before calling this function.
  */
-ssize_t audio_pkt_read(struct file *file, char __user *buf,
-		       size_t count, loff_t *ppos)
+static struct sk_buff *audio_pkt_dequeue(struct audio_pkt_device *audpkt_dev,
+					 bool nonblock)
 {
-	struct audio_pkt_device *audpkt_dev = file->private_data;
 	unsigned long flags;
 	struct sk_buff *skb;
-	int use;
-	uint32_t *temp;
-
-	if (!audpkt_dev) {
-		AUDIO_PKT_ERR("invalid device handle\n");
-		return -EINVAL;
-	}
 
 	spin_lock_irqsave(&audpkt_dev->queue_lock, flags);
 	/* Wait for data in the queue */
 	if (skb_queue_empty(&audpkt_dev->queue)) {
 		spin_unlock_irqrestore(&audpkt_dev->queue_lock, flags);
 
-		if (file->f_flags & O_NONBLOCK)
-			return -EAGAIN;
+		if (nonblock)
+			return ERR_PTR(-EAGAIN);
 
 		/* Wait until we get data or the endpoint goes away */
 		if (wait_event_interruptible(audpkt_dev->readq,
 					!skb_queue_empty(&audpkt_dev->queue)))
-			return -ERESTARTSYS;
+			return ERR_PTR(-ERESTARTSYS);
 
 		spin_lock_irqsave(&audpkt_dev->queue_lock, flags);
 	}
@@ -212,24 +231,131 @@ ssize_t audio_pkt_read(struct file *file, char __user *buf,
 	skb = skb_dequeue(&audpkt_dev->queue);
 	spin_unlock_irqrestore(&audpkt_dev->queue_lock, flags);
 	if (!skb)
-		return -EFAULT;
+		return ERR_PTR(-EFAULT);
+
+	return skb;
+}
+
+ssize_t audio_pkt_read(struct file *file, char __user *buf,
+		       size_t count, loff_t *ppos)
+{
+	struct audio_pkt_device *audpkt_dev = file->private_data;
+	struct sk_buff *skb;
+	int use;
+
+	if (!audpkt_dev) {
+		AUDIO_PKT_ERR("invalid device handle\n");
+		return -EINVAL;
+	}
+
+	skb = audio_pkt_dequeue(audpkt_dev, file->f_flags & O_NONBLOCK);
+	if (IS_ERR(skb))
+		return PTR_ERR(skb);
 
 	use = min_t(size_t, count, skb->len);
 	if (copy_to_user(buf, skb->data, use))
 		use = -EFAULT;
-	temp = (uint32_t *) skb->data;
 	kfree_skb(skb);
 
 	return use;
 }
 
+/**
+ * audio_pkt_read_iter() - readv() syscall for the audio_pkt device
+ * iocb:	Pointer to the kiocb of the read.
+ * to:		Userspace buffers to read into.
+ *
+ * Reads one response packet into each of the buffers. Only waits for the
+ * first one, and returns the number of bytes read once no more packets are
+ * queued.
+ */
+static ssize_t audio_pkt_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+	struct audio_pkt_device *audpkt_dev = iocb->ki_filp->private_data;
+	bool nonblock = iocb->ki_filp->f_flags & O_NONBLOCK;
+	struct sk_buff *skb;
+	ssize_t total = 0;
+	size_t use;
+
+	if (!audpkt_dev) {
+		AUDIO_PKT_ERR("invalid device handle\n");
+		return -EINVAL;
+	}
+
+	if (!user_backed_iter(to))
+		return -EINVAL;
+
+	while (iov_iter_count(to)) {
+		/* Skip empty buffers rather than dropping a packet into them */
+		if (!iter_iov_len(to)) {
+			iov_iter_advance(to, 0);
+			continue;
+		}
+
+		skb = audio_pkt_dequeue(audpkt_dev, nonblock || total);
+		if (IS_ERR(skb))
+			return total ? total : PTR_ERR(skb);
+
+		use = min_t(size_t, iter_iov_len(to), skb->len);
+		if (copy_to_user(iter_iov_addr(to), skb->data, use)) {
+			kfree_skb(skb);
+			return total ? total : -EFAULT;
+		}
+		kfree_skb(skb);
+
+		iov_iter_advance(to, iter_iov_len(to));
+		total += use;
+	}
+
+	return total;
+}
+
 /**
  * audpkt_update_physical_addr - Update physical address
  * audpkt_hdr:	Pointer to the file structure.
  */
-int audpkt_chk_and_update_physical_addr(struct audio_gpr_pkt *gpr_pkt)
+static int audpkt_get_phy_addr(struct audio_pkt_device *audpkt_dev, int fd,
+			       dma_addr_t *paddr)
+{
+	unsigned long gen = msm_audio_mem_get_generation();
+	struct audio_pkt_pa *pa;
+	int ret;
+
+	lockdep_assert_held(&audpkt_dev->lock);
+
+	if (audpkt_dev->pa_cache_gen != gen) {
+		audio_pkt_pa_cache_flush(audpkt_dev);
+		audpkt_dev->pa_cache_gen = gen;
+	}
+
+	pa = xa_load(&audpkt_dev->pa_cache, fd);
+	if (pa) {
+		*paddr = pa->paddr;
+		return 0;
+	}
+
+	pa = kmalloc(sizeof(*pa), GFP_KERNEL);
+	if (!pa)
+		return -ENOMEM;
+
+	ret = msm_audio_get_phy_addr(fd, &pa->paddr, &pa->len);
+	if (ret < 0) {
+		kfree(pa);
+		return ret;
+	}
+
+	*paddr = pa->paddr;
+
+	/* Failing to cache the translation only makes the next lookup slower */
+	if (fd < 0 || xa_err(xa_store(&audpkt_dev->pa_cache, fd, pa, GFP_KERNEL)))
+		kfree(pa);
+
+	return 0;
+}
+
+int audpkt_chk_and_update_physical_addr(struct audio_pkt_device *audpkt_dev,
+					struct audio_gpr_pkt *gpr_pkt)
 {
-	size_t pa_len = 0;
 	dma_addr_t paddr = 0;
 	int ret = 0;
 
@@ -237,9 +363,9 @@ int audpkt_chk_and_update_physical_addr(struct audio_gpr_pkt *gpr_pkt)
 				APM_MEMORY_MAP_BIT_MASK_IS_OFFSET_MODE) {
 
 		/* TODO: move physical address mapping to use DMA-BUF heaps */
-		ret = msm_audio_get_phy_addr(
+		ret = audpkt_get_phy_addr(audpkt_dev,
 				(int) gpr_pkt->audpkt_mem_map.mmap_payload.shm_addr_lsw,
-				&paddr, &pa_len);
+				&paddr);
 		if (ret < 0) {
 			AUDIO_PKT_ERR("%s Get phy. address failed, ret %d\n",
 					__func__, ret);
@@ -265,48 +391,109 @@ int audpkt_chk_and_update_physical_addr(struct audio_gpr_pkt *gpr_pkt)
  * userspace client do a write() system call. All input arguments are
  * validated by the virtual file system before calling this function.
  */
-ssize_t audio_pkt_write(struct file *file, const char __user *buf,
-			size_t count, loff_t *ppos)
+static int audio_pkt_send(struct audio_pkt_device *audpkt_dev,
+			  const char __user *buf, size_t count)
 {
-	struct audio_pkt_device *audpkt_dev = file->private_data;
 	struct gpr_hdr *audpkt_hdr = NULL;
 	void *kbuf;
 	int ret;
 
-	if (!audpkt_dev)  {
-		AUDIO_PKT_ERR("invalid device handle\n");
+	if (count < sizeof(*audpkt_hdr))
 		return -EINVAL;
-	}
 
 	kbuf = memdup_user(buf, count);
 	if (IS_ERR(kbuf))
 		return PTR_ERR(kbuf);
 
+	if (mutex_lock_interruptible(&audpkt_dev->lock)) {
+		ret = -ERESTARTSYS;
+		goto free_kbuf;
+	}
+
 	audpkt_hdr = (struct gpr_hdr *) kbuf;
 	if (audpkt_hdr->opcode == APM_CMD_SHARED_MEM_MAP_REGIONS) {
-		ret = audpkt_chk_and_update_physical_addr((struct audio_gpr_pkt *) audpkt_hdr);
+		if (count < sizeof(struct audio_gpr_pkt)) {
+			ret = -EINVAL;
+			goto unlock;
+		}
+
+		ret = audpkt_chk_and_update_physical_addr(audpkt_dev,
+				(struct audio_gpr_pkt *) audpkt_hdr);
 		if (ret < 0) {
 			AUDIO_PKT_ERR("Update Physical Address Failed -%d\n", ret);
-			return ret;
+			goto unlock;
 		}
 	}
 
-	if (mutex_lock_interruptible(&audpkt_dev->lock)) {
-		ret = -ERESTARTSYS;
-		goto free_kbuf;
-	}
 	ret = gpr_send_pkt(audpkt_dev->adev, (struct gpr_pkt *) kbuf);
-	if (ret < 0) {
+	if (ret < 0)
 		AUDIO_PKT_ERR("APR Send Packet Failed ret -%d\n", ret);
-		return ret;
-	}
-	mutex_unlock(&audpkt_dev->lock);
 
+unlock:
+	mutex_unlock(&audpkt_dev->lock);
 free_kbuf:
 	kfree(kbuf);
+	return ret;
+}
+
+ssize_t audio_pkt_write(struct file *file, const char __user *buf,
+			size_t count, loff_t *ppos)
+{
+	struct audio_pkt_device *audpkt_dev = file->private_data;
+	int ret;
+
+	if (!audpkt_dev)  {
+		AUDIO_PKT_ERR("invalid device handle\n");
+		return -EINVAL;
+	}
+
+	ret = audio_pkt_send(audpkt_dev, buf, count);
+
 	return ret < 0 ? ret : count;
 }
 
+/**
+ * audio_pkt_write_iter() - writev() syscall for the audio_pkt device
+ * iocb:	Pointer to the kiocb of the write.
+ * from:	Userspace buffers to write.
+ *
+ * Sends each of the buffers as one GPR packet, so that a whole batch of
+ * commands takes a single syscall. Stops at the first packet that fails and
+ * returns the number of bytes sent before it, if any.
+ */
+static ssize_t audio_pkt_write_iter(struct kiocb *iocb, struct iov_iter *from)
+{
+	struct audio_pkt_device *audpkt_dev = iocb->ki_filp->private_data;
+	ssize_t total = 0;
+	size_t len;
+	int ret;
+
+	if (!audpkt_dev)  {
+		AUDIO_PKT_ERR("invalid device handle\n");
+		return -EINVAL;
+	}
+
+	if (!user_backed_iter(from))
+		return -EINVAL;
+
+	while (iov_iter_count(from)) {
+		len = iter_iov_len(from);
+		if (!len) {
+			iov_iter_advance(from, 0);
+			continue;
+		}
+
+		ret = audio_pkt_send(audpkt_dev, iter_iov_addr(from), len);
+		if (ret < 0)
+			return total ? total : ret;
+
+		iov_iter_advance(from, len);
+		total += len;
+	}
+
+	return total;
+}
+
 /**
  * audio_pkt_poll() - poll() syscall for the audio_pkt device
  * file:	Pointer to the file structure.
@@ -349,6 +536,8 @@ static const struct file_operations audio_pkt_fops = {
 	.release = audio_pkt_release,
 	.read = audio_pkt_read,
 	.write = audio_pkt_write,
+	.read_iter = audio_pkt_read_iter,
+	.write_iter = audio_pkt_write_iter,
 	.poll = audio_pkt_poll,
 };
 
@@ -449,6 +638,7 @@ static int audio_pkt_probe(gpr_device_t *adev)
 	dev_set_name(audpkt_dev->dev, audpkt_dev->dev_name);
 
 	mutex_init(&audpkt_dev->lock);
+	xa_init(&audpkt_dev->pa_cache);
 
 	spin_lock_init(&audpkt_dev->queue_lock);
 	skb_queue_head_init(&audpkt_dev->queue);
@@ -10,7 +10,7 @@
 #include <linux/delay.h>
 #include <linux/slab.h>
 #include <linux/mutex.h>
-#include <linux/list.h>
+#include <linux/hashtable.h>
 #include <linux/cdev.h>
 #include <linux/device.h>
 #include <linux/dma-mapping.h>
@@ -23,6 +23,7 @@
 #include <linux/of_reserved_mem.h>
 #include <linux/ioctl.h>
 #include <linux/platform_device.h>
+#include <linux/xarray.h>
 #include <linux/firmware/qcom/qcom_scm.h>
 #include <soc/qcom/secure_buffer.h>
 #include "msm_audio_mem.h"
@@ -41,7 +42,8 @@ struct msm_audio_mem_private {
 	bool smmu_enabled;
 	struct device *cb_dev;
 	u8 device_status;
-	struct list_head alloc_list;
+	/* allocations, hashed by dma_buf */
+	DECLARE_HASHTABLE(alloc_hash, 6);
 	struct mutex list_mutex;
 	u64 smmu_sid_bits;
 	char *driver_name;
@@ -52,31 +54,40 @@ struct msm_audio_mem_private {
 	struct cdev cdev;
 };
 
+/*
+ * A buffer imported more than once shares the attachment and mapping of the
+ * first import, @refcnt counts the imports.
+ */
 struct msm_audio_alloc_data {
 	size_t len;
+	dma_addr_t addr;
+	unsigned int refcnt;
+	bool kmapped;
 	struct iosys_map *vmap;
 	struct dma_buf *dma_buf;
 	struct dma_buf_attachment *attach;
 	struct sg_table *table;
-	struct list_head list;
+	struct hlist_node node;
 };
 
 struct msm_audio_mem_fd_list_private {
 	struct mutex list_mutex;
-	/*list to store fd, phy. addr and handle data */
-	struct list_head fd_list;
+	/* fd, phy. addr and handle data, indexed by fd */
+	struct xarray fds;
 };
 
 static struct msm_audio_mem_fd_list_private msm_audio_mem_fd_list = {0,};
 static bool msm_audio_mem_fd_list_init;
 
+/* Bumped whenever fd entries are removed, see msm_audio_mem_get_generation() */
+static atomic_long_t msm_audio_mem_generation;
+
 struct msm_audio_fd_data {
 	int fd;
 	size_t plen;
 	void *handle;
 	dma_addr_t paddr;
 	struct device *dev;
-	struct list_head list;
 	bool hyp_assign;
 };
 
@@ -90,17 +101,42 @@ static void msm_audio_mem_add_allocation(
 	 * of allocations is always protected
 	 */
 	mutex_lock(&(msm_audio_mem_data->list_mutex));
-	list_add_tail(&(alloc_data->list),
-		      &(msm_audio_mem_data->alloc_list));
+	hash_add(msm_audio_mem_data->alloc_hash, &alloc_data->node,
+		 (unsigned long)alloc_data->dma_buf);
 	mutex_unlock(&(msm_audio_mem_data->list_mutex));
 }
 
+static struct msm_audio_alloc_data *msm_audio_mem_find_allocation(
+	struct msm_audio_mem_private *mem_data, struct dma_buf *dma_buf)
+	__must_hold(&mem_data->list_mutex)
+{
+	struct msm_audio_alloc_data *alloc_data;
+
+	hash_for_each_possible(mem_data->alloc_hash, alloc_data, node,
+			       (unsigned long)dma_buf) {
+		if (alloc_data->dma_buf == dma_buf)
+			return alloc_data;
+	}
+
+	return NULL;
+}
+
 static int msm_audio_mem_map_kernel(struct dma_buf *dma_buf,
 	struct msm_audio_mem_private *mem_data, struct iosys_map *iosys_vmap)
 {
 	int rc = 0;
 	struct msm_audio_alloc_data *alloc_data = NULL;
 
+	/* Already mapped by an earlier import of the same buffer */
+	mutex_lock(&(mem_data->list_mutex));
+	alloc_data = msm_audio_mem_find_allocation(mem_data, dma_buf);
+	if (alloc_data && alloc_data->kmapped) {
+		mutex_unlock(&(mem_data->list_mutex));
+		kfree(iosys_vmap);
+		return 0;
+	}
+	mutex_unlock(&(mem_data->list_mutex));
+
 	rc = dma_buf_begin_cpu_access(dma_buf, DMA_BIDIRECTIONAL);
 	if (rc) {
 		pr_err("%s: kmap dma_buf_begin_cpu_access fail\n", __func__);
@@ -119,12 +155,10 @@ static int msm_audio_mem_map_kernel(struct dma_buf *dma_buf,
 	 * for mapping kernel virtual address is available.
 	 */
 	mutex_lock(&(mem_data->list_mutex));
-	list_for_each_entry(alloc_data, &(mem_data->alloc_list),
-			    list) {
-		if (alloc_data->dma_buf == dma_buf) {
-			alloc_data->vmap = iosys_vmap;
-			break;
-		}
+	alloc_data = msm_audio_mem_find_allocation(mem_data, dma_buf);
+	if (alloc_data) {
+		alloc_data->vmap = iosys_vmap;
+		alloc_data->kmapped = true;
 	}
 	mutex_unlock(&(mem_data->list_mutex));
 
@@ -142,6 +176,18 @@ static int msm_audio_dma_buf_map(struct dma_buf *dma_buf,
 	struct iosys_map *iosys_vmap = NULL;
 	struct device *cb_dev = mem_data->cb_dev;
 
+	/* Reuse the attachment and mapping of an earlier import */
+	mutex_lock(&(mem_data->list_mutex));
+	alloc_data = msm_audio_mem_find_allocation(mem_data, dma_buf);
+	if (alloc_data) {
+		alloc_data->refcnt++;
+		*addr = alloc_data->addr;
+		*len = alloc_data->len;
+		mutex_unlock(&(mem_data->list_mutex));
+		return 0;
+	}
+	mutex_unlock(&(mem_data->list_mutex));
+
 	iosys_vmap = kzalloc(sizeof(*iosys_vmap), GFP_KERNEL);
 	if (!iosys_vmap)
 		return -ENOMEM;
@@ -153,6 +199,7 @@ static int msm_audio_dma_buf_map(struct dma_buf *dma_buf,
 	}
 	alloc_data->dma_buf = dma_buf;
 	alloc_data->len = dma_buf->size;
+	alloc_data->refcnt = 1;
 	*len = dma_buf->size;
 
 	/* Attach the dma_buf to context bank device */
@@ -193,10 +240,13 @@ static int msm_audio_dma_buf_map(struct dma_buf *dma_buf,
 			goto detach_dma_buf;
 		}
 		alloc_data->vmap = iosys_vmap;
+		alloc_data->kmapped = true;
 	} else {
 		*addr = MSM_AUDIO_MEM_PHYS_ADDR(alloc_data);
+		kfree(iosys_vmap);
 	}
 
+	alloc_data->addr = *addr;
 	msm_audio_mem_add_allocation(mem_data, alloc_data);
 	return rc;
 
@@ -215,43 +265,27 @@ static int msm_audio_dma_buf_unmap(struct dma_buf *dma_buf, struct msm_audio_mem
 {
 	int rc = 0;
 	struct msm_audio_alloc_data *alloc_data = NULL;
-	struct list_head *ptr, *next;
-	bool found = false;
 	struct device *cb_dev = mem_data->cb_dev;
 
-	/*
-	 * Though list_for_each_safe is delete safe, lock
-	 * should be explicitly acquired to avoid race condition
-	 * on adding elements to the list.
-	 */
 	mutex_lock(&(mem_data->list_mutex));
-	list_for_each_safe(ptr, next,
-			    &(mem_data->alloc_list)) {
+	alloc_data = msm_audio_mem_find_allocation(mem_data, dma_buf);
+	if (alloc_data) {
+		dma_buf_unmap_attachment(alloc_data->attach,
+					 alloc_data->table,
+					 DMA_BIDIRECTIONAL);
 
-		alloc_data = list_entry(ptr, struct msm_audio_alloc_data,
-					list);
+		dma_buf_detach(alloc_data->dma_buf,
+			       alloc_data->attach);
 
-		if (alloc_data->dma_buf == dma_buf) {
-			found = true;
-			dma_buf_unmap_attachment(alloc_data->attach,
-						 alloc_data->table,
-						 DMA_BIDIRECTIONAL);
+		dma_buf_put(alloc_data->dma_buf);
 
-			dma_buf_detach(alloc_data->dma_buf,
-				       alloc_data->attach);
-
-			dma_buf_put(alloc_data->dma_buf);
-
-			list_del(&(alloc_data->list));
-			kfree(alloc_data->vmap);
-			kfree(alloc_data);
-			alloc_data = NULL;
-			break;
-		}
+		hash_del(&alloc_data->node);
+		kfree(alloc_data->vmap);
+		kfree(alloc_data);
 	}
 	mutex_unlock(&(mem_data->list_mutex));
 
-	if (!found) {
+	if (!alloc_data) {
 		dev_err(cb_dev,
 			"%s: cannot find allocation, dma_buf %pK\n",
 			__func__, dma_buf);
@@ -296,13 +330,9 @@ static int msm_audio_mem_unmap_kernel(struct dma_buf *dma_buf,
 	 * for unmapping kernel virtual address is available.
 	 */
 	mutex_lock(&(mem_data->list_mutex));
-	list_for_each_entry(alloc_data, &(mem_data->alloc_list),
-			    list) {
-		if (alloc_data->dma_buf == dma_buf) {
-			iosys_vmap = alloc_data->vmap;
-			break;
-		}
-	}
+	alloc_data = msm_audio_mem_find_allocation(mem_data, dma_buf);
+	if (alloc_data)
+		iosys_vmap = alloc_data->vmap;
 	mutex_unlock(&(mem_data->list_mutex));
 
 	if (!iosys_vmap) {
@@ -362,50 +392,47 @@ static int msm_audio_mem_map_buf(struct dma_buf *dma_buf, dma_addr_t *paddr,
 void msm_audio_fd_list_debug(void)
 {
 	struct msm_audio_fd_data *msm_audio_fd_data = NULL;
+	unsigned long fd;
 
-	list_for_each_entry(msm_audio_fd_data,
-			&msm_audio_mem_fd_list.fd_list, list) {
+	xa_for_each(&msm_audio_mem_fd_list.fds, fd, msm_audio_fd_data) {
 		pr_debug("%s fd %d handle %pK phy. addr %pK\n", __func__,
 			msm_audio_fd_data->fd, msm_audio_fd_data->handle,
 			(void *)msm_audio_fd_data->paddr);
 	}
 }
 
-void msm_audio_update_fd_list(struct msm_audio_fd_data *msm_audio_fd_data)
+int msm_audio_update_fd_list(struct msm_audio_fd_data *msm_audio_fd_data)
 {
-	struct msm_audio_fd_data *msm_audio_fd_data1 = NULL;
+	int ret;
+
+	if (msm_audio_fd_data->fd < 0)
+		return -EINVAL;
 
 	mutex_lock(&(msm_audio_mem_fd_list.list_mutex));
-	list_for_each_entry(msm_audio_fd_data1,
-			&msm_audio_mem_fd_list.fd_list, list) {
-		if (msm_audio_fd_data1->fd == msm_audio_fd_data->fd) {
-			pr_err("%s fd already present, not updating the list\n",
-				__func__);
-			mutex_unlock(&(msm_audio_mem_fd_list.list_mutex));
-			return;
-		}
-	}
-	list_add_tail(&msm_audio_fd_data->list, &msm_audio_mem_fd_list.fd_list);
+	ret = xa_insert(&msm_audio_mem_fd_list.fds, msm_audio_fd_data->fd,
+			msm_audio_fd_data, GFP_KERNEL);
+	if (ret == -EBUSY)
+		pr_err("%s fd already present, not updating the list\n",
+			__func__);
 	mutex_unlock(&(msm_audio_mem_fd_list.list_mutex));
+
+	return ret;
 }
 
-void msm_audio_delete_fd_entry(void *handle)
+void msm_audio_delete_fd_entry(int fd)
 {
 	struct msm_audio_fd_data *msm_audio_fd_data = NULL;
-	struct list_head *ptr, *next;
+
+	if (fd < 0)
+		return;
 
 	mutex_lock(&(msm_audio_mem_fd_list.list_mutex));
-	list_for_each_safe(ptr, next,
-			&msm_audio_mem_fd_list.fd_list) {
-		msm_audio_fd_data = list_entry(ptr, struct msm_audio_fd_data,
-					list);
-		if (msm_audio_fd_data->handle == handle) {
-			pr_debug("%s deleting handle %pK entry from list\n",
-				__func__, handle);
-			list_del(&(msm_audio_fd_data->list));
-			kfree(msm_audio_fd_data);
-			break;
-		}
+	msm_audio_fd_data = xa_erase(&msm_audio_mem_fd_list.fds, fd);
+	if (msm_audio_fd_data) {
+		pr_debug("%s deleting fd %d entry from list\n",
+			__func__, fd);
+		kfree(msm_audio_fd_data);
+		atomic_long_inc(&msm_audio_mem_generation);
 	}
 	mutex_unlock(&(msm_audio_mem_fd_list.list_mutex));
 }
@@ -419,40 +446,51 @@ int msm_audio_get_phy_addr(int fd, dma_addr_t *paddr, size_t *pa_len)
 		pr_err("%s Invalid paddr param status %d\n", __func__, status);
 		return status;
 	}
+	if (fd < 0)
+		return status;
+
 	pr_debug("%s, fd %d\n", __func__, fd);
 	mutex_lock(&(msm_audio_mem_fd_list.list_mutex));
-	list_for_each_entry(msm_audio_fd_data,
-			&msm_audio_mem_fd_list.fd_list, list) {
-		if (msm_audio_fd_data->fd == fd) {
-			*paddr = msm_audio_fd_data->paddr;
-			*pa_len = msm_audio_fd_data->plen;
-			status = 0;
-			pr_debug("%s Found fd %d paddr %pK\n",
-				__func__, fd, paddr);
-			mutex_unlock(&(msm_audio_mem_fd_list.list_mutex));
-			return status;
-		}
+	msm_audio_fd_data = xa_load(&msm_audio_mem_fd_list.fds, fd);
+	if (msm_audio_fd_data) {
+		*paddr = msm_audio_fd_data->paddr;
+		*pa_len = msm_audio_fd_data->plen;
+		status = 0;
+		pr_debug("%s Found fd %d paddr %pK\n",
+			__func__, fd, paddr);
 	}
 	mutex_unlock(&(msm_audio_mem_fd_list.list_mutex));
 	return status;
 }
 EXPORT_SYMBOL_GPL(msm_audio_get_phy_addr);
 
+/**
+ * msm_audio_mem_get_generation -
+ *        Get the generation of the fd to physical address mappings
+ *
+ * Changes whenever a mapping is removed, so that a caller caching results of
+ * msm_audio_get_phy_addr() knows when to drop them.
+ */
+unsigned long msm_audio_mem_get_generation(void)
+{
+	return atomic_long_read(&msm_audio_mem_generation);
+}
+EXPORT_SYMBOL_GPL(msm_audio_mem_get_generation);
+
 int msm_audio_set_hyp_assign(int fd, bool assign)
 {
 	struct msm_audio_fd_data *msm_audio_fd_data = NULL;
 	int status = -EINVAL;
 
+	if (fd < 0)
+		return status;
+
 	mutex_lock(&(msm_audio_mem_fd_list.list_mutex));
-	list_for_each_entry(msm_audio_fd_data,
-			&msm_audio_mem_fd_list.fd_list, list) {
-		if (msm_audio_fd_data->fd == fd) {
-			status = 0;
-			pr_debug("%s Found fd %d\n", __func__, fd);
-			msm_audio_fd_data->hyp_assign = assign;
-			mutex_unlock(&(msm_audio_mem_fd_list.list_mutex));
-			return status;
-		}
+	msm_audio_fd_data = xa_load(&msm_audio_mem_fd_list.fds, fd);
+	if (msm_audio_fd_data) {
+		status = 0;
+		pr_debug("%s Found fd %d\n", __func__, fd);
+		msm_audio_fd_data->hyp_assign = assign;
 	}
 	mutex_unlock(&(msm_audio_mem_fd_list.list_mutex));
 	return status;
@@ -462,15 +500,15 @@ void msm_audio_get_handle(int fd, void **handle)
 {
 	struct msm_audio_fd_data *msm_audio_fd_data = NULL;
 
+	if (fd < 0)
+		return;
+
 	pr_debug("%s fd %d\n", __func__, fd);
 	mutex_lock(&(msm_audio_mem_fd_list.list_mutex));
-	list_for_each_entry(msm_audio_fd_data,
-			&msm_audio_mem_fd_list.fd_list, list) {
-		if (msm_audio_fd_data->fd == fd) {
-			*handle = (struct dma_buf *)msm_audio_fd_data->handle;
-			pr_debug("%s handle %pK\n", __func__, *handle);
-			break;
-		}
+	msm_audio_fd_data = xa_load(&msm_audio_mem_fd_list.fds, fd);
+	if (msm_audio_fd_data) {
+		*handle = (struct dma_buf *)msm_audio_fd_data->handle;
+		pr_debug("%s handle %pK\n", __func__, *handle);
 	}
 	mutex_unlock(&(msm_audio_mem_fd_list.list_mutex));
 }
@@ -541,6 +579,7 @@ static int msm_audio_mem_import(struct dma_buf **dma_buf, int fd,
  */
 static int msm_audio_mem_free(struct dma_buf *dma_buf, struct msm_audio_mem_private *mem_data)
 {
+	struct msm_audio_alloc_data *alloc_data;
 	int ret = 0;
 
 	if (!dma_buf) {
@@ -548,6 +587,17 @@ static int msm_audio_mem_free(struct dma_buf *dma_buf, struct msm_audio_mem_priv
 		return -EINVAL;
 	}
 
+	/* Only drop the reference of this import if the buffer is shared */
+	mutex_lock(&(mem_data->list_mutex));
+	alloc_data = msm_audio_mem_find_allocation(mem_data, dma_buf);
+	if (alloc_data && alloc_data->refcnt > 1) {
+		alloc_data->refcnt--;
+		mutex_unlock(&(mem_data->list_mutex));
+		dma_buf_put(dma_buf);
+		return 0;
+	}
+	mutex_unlock(&(mem_data->list_mutex));
+
 	if (mem_data->smmu_enabled) {
 		ret = msm_audio_mem_unmap_kernel(dma_buf, mem_data);
 		if (ret)
@@ -588,13 +638,12 @@ static int msm_audio_hyp_unassign(struct msm_audio_fd_data *msm_audio_fd_data)
 void msm_audio_mem_crash_handler(void)
 {
 	struct msm_audio_fd_data *msm_audio_fd_data = NULL;
-	struct list_head *ptr, *next;
 	void *handle = NULL;
 	struct msm_audio_mem_private *mem_data = NULL;
+	unsigned long fd;
 
 	mutex_lock(&(msm_audio_mem_fd_list.list_mutex));
-	list_for_each_entry(msm_audio_fd_data,
-		&msm_audio_mem_fd_list.fd_list, list) {
+	xa_for_each(&msm_audio_mem_fd_list.fds, fd, msm_audio_fd_data) {
 		handle = msm_audio_fd_data->handle;
 		mem_data = dev_get_drvdata(msm_audio_fd_data->dev);
 		/*  clean if CMA was used*/
@@ -602,14 +651,10 @@ void msm_audio_mem_crash_handler(void)
 			msm_audio_hyp_unassign(msm_audio_fd_data);
 		if (handle)
 			msm_audio_mem_free(handle, mem_data);
-	}
-	list_for_each_safe(ptr, next,
-		&msm_audio_mem_fd_list.fd_list) {
-		msm_audio_fd_data = list_entry(ptr, struct msm_audio_fd_data,
-						list);
-		list_del(&(msm_audio_fd_data->list));
+		xa_erase(&msm_audio_mem_fd_list.fds, fd);
 		kfree(msm_audio_fd_data);
 	}
+	atomic_long_inc(&msm_audio_mem_generation);
 	mutex_unlock(&(msm_audio_mem_fd_list.list_mutex));
 }
 EXPORT_SYMBOL_GPL(msm_audio_mem_crash_handler);
@@ -639,7 +684,7 @@ static int msm_audio_mem_release(struct inode *inode, struct file *file)
 static long msm_audio_mem_ioctl(struct file *file, unsigned int ioctl_num,
 				unsigned long __user ioctl_param)
 {
-	void *mem_handle;
+	void *mem_handle = NULL;
 	dma_addr_t paddr;
 	size_t pa_len = 0;
 	struct iosys_map *iosys_vmap = NULL;
@@ -678,7 +723,11 @@ static long msm_audio_mem_ioctl(struct file *file, unsigned int ioctl_num,
 		msm_audio_fd_data->paddr = paddr;
 		msm_audio_fd_data->plen = pa_len;
 		msm_audio_fd_data->dev = mem_data->cb_dev;
-		msm_audio_update_fd_list(msm_audio_fd_data);
+		if (msm_audio_update_fd_list(msm_audio_fd_data)) {
+			/* Drop the reference taken by this import again */
+			msm_audio_mem_free(mem_handle, mem_data);
+			kfree(msm_audio_fd_data);
+		}
 		break;
 	case IOCTL_UNMAP_PHYS_ADDR:
 		msm_audio_get_handle((int)ioctl_param, &mem_handle);
@@ -687,7 +736,7 @@ static long msm_audio_mem_ioctl(struct file *file, unsigned int ioctl_num,
 			pr_err("%s Ion free failed %d\n", __func__, ret);
 			return ret;
 		}
-		msm_audio_delete_fd_entry(mem_handle);
+		msm_audio_delete_fd_entry((int)ioctl_param);
 		break;
 	case IOCTL_MAP_HYP_ASSIGN:
 		ret = msm_audio_get_phy_addr((int)ioctl_param, &paddr, &pa_len);
@@ -869,11 +918,11 @@ static int msm_audio_mem_probe(struct platform_device *pdev)
 	msm_audio_mem_data->cb_dev = dev;
 	dev_set_drvdata(dev, msm_audio_mem_data);
 	if (!msm_audio_mem_fd_list_init) {
-		INIT_LIST_HEAD(&msm_audio_mem_fd_list.fd_list);
+		xa_init(&msm_audio_mem_fd_list.fds);
 		mutex_init(&(msm_audio_mem_fd_list.list_mutex));
 		msm_audio_mem_fd_list_init = true;
 	}
-	INIT_LIST_HEAD(&msm_audio_mem_data->alloc_list);
+	hash_init(msm_audio_mem_data->alloc_hash);
 	mutex_init(&(msm_audio_mem_data->list_mutex));
 	rc = msm_audio_mem_reg_chrdev(msm_audio_mem_data);
 	if (rc) {
@@ -10,5 +10,6 @@
 #include <uapi/sound/qcom/msm_audio.h>
 
 int msm_audio_get_phy_addr(int fd, dma_addr_t *paddr, size_t *pa_len);
+unsigned long msm_audio_mem_get_generation(void);
 void msm_audio_mem_crash_handler(void);
 #endif /* _LINUX_MSM_AUDIO_MEM_H */
@@ -31,6 +31,28 @@ struct apm_graph_mgmt_cmd {
 
 static struct q6apm *g_apm;
 
+/*
+ * Opening a graph on the DSP takes a while, so keep graphs open for this long
+ * after their last user went away in case they are used again.
+ */
+static unsigned int graph_idle_ms;
+module_param(graph_idle_ms, uint, 0644);
+MODULE_PARM_DESC(graph_idle_ms, "Time to keep unused graphs open on the DSP, in ms");
+
+static void q6apm_put_audioreach_graph(struct kref *ref);
+
+static void q6apm_graph_idle_work(struct work_struct *work)
+{
+	struct audioreach_graph *graph = container_of(to_delayed_work(work),
+						      struct audioreach_graph,
+						      idle_work);
+	struct q6apm *apm = graph->apm;
+
+	mutex_lock(&apm->graph_lock);
+	kref_put(&graph->refcount, q6apm_put_audioreach_graph);
+	mutex_unlock(&apm->graph_lock);
+}
+
 int q6apm_send_cmd_sync(struct q6apm *apm, struct gpr_pkt *pkt, uint32_t rsp_opcode)
 {
 	gpr_device_t *gdev = apm->gdev;
@@ -45,34 +67,44 @@ static struct audioreach_graph *q6apm_get_audioreach_graph(struct q6apm *apm, ui
 	struct audioreach_graph *graph;
 	int id;
 
+	mutex_lock(&apm->graph_lock);
+
 	mutex_lock(&apm->lock);
 	graph = idr_find(&apm->graph_idr, graph_id);
 	mutex_unlock(&apm->lock);
 
 	if (graph) {
-		kref_get(&graph->refcount);
-		return graph;
+		/* Take over the reference of a graph kept open while idle */
+		if (!cancel_delayed_work(&graph->idle_work))
+			kref_get(&graph->refcount);
+		goto unlock;
 	}
 
 	info = idr_find(&apm->graph_info_idr, graph_id);
 
-	if (!info)
-		return ERR_PTR(-ENODEV);
+	if (!info) {
+		graph = ERR_PTR(-ENODEV);
+		goto unlock;
+	}
 
 	graph = kzalloc(sizeof(*graph), GFP_KERNEL);
-	if (!graph)
-		return ERR_PTR(-ENOMEM);
+	if (!graph) {
+		graph = ERR_PTR(-ENOMEM);
+		goto unlock;
+	}
 
 	graph->apm = apm;
 	graph->info = info;
 	graph->id = graph_id;
+	INIT_DELAYED_WORK(&graph->idle_work, q6apm_graph_idle_work);
 
 	graph->graph = audioreach_alloc_graph_pkt(apm, info);
 	if (IS_ERR(graph->graph)) {
 		void *err = graph->graph;
 
 		kfree(graph);
-		return ERR_CAST(err);
+		graph = ERR_CAST(err);
+		goto unlock;
 	}
 
 	mutex_lock(&apm->lock);
@@ -82,7 +114,8 @@ static struct audioreach_graph *q6apm_get_audioreach_graph(struct q6apm *apm, ui
 		kfree(graph->graph);
 		kfree(graph);
 		mutex_unlock(&apm->lock);
-		return ERR_PTR(id);
+		graph = ERR_PTR(id);
+		goto unlock;
 	}
 	mutex_unlock(&apm->lock);
 
@@ -90,9 +123,39 @@ static struct audioreach_graph *q6apm_get_audioreach_graph(struct q6apm *apm, ui
 
 	q6apm_send_cmd_sync(apm, graph->graph, 0);
 
+unlock:
+	mutex_unlock(&apm->graph_lock);
+
 	return graph;
 }
 
+static void q6apm_release_audioreach_graph(struct audioreach_graph *graph)
+{
+	struct q6apm *apm = graph->apm;
+
+	mutex_lock(&apm->graph_lock);
+	if (graph_idle_ms && kref_read(&graph->refcount) == 1)
+		queue_delayed_work(system_wq, &graph->idle_work,
+				   msecs_to_jiffies(graph_idle_ms));
+	else
+		kref_put(&graph->refcount, q6apm_put_audioreach_graph);
+	mutex_unlock(&apm->graph_lock);
+}
+
+/* Close the graphs kept open while idle right away */
+static void q6apm_flush_idle_graphs(struct q6apm *apm)
+{
+	struct audioreach_graph *graph;
+	int id;
+
+	mutex_lock(&apm->graph_lock);
+	idr_for_each_entry(&apm->graph_idr, graph, id) {
+		if (cancel_delayed_work(&graph->idle_work))
+			kref_put(&graph->refcount, q6apm_put_audioreach_graph);
+	}
+	mutex_unlock(&apm->graph_lock);
+}
+
 static int audioreach_graph_mgmt_cmd(struct audioreach_graph *graph, uint32_t opcode)
 {
 	struct audioreach_graph_info *info = graph->info;
@@ -176,6 +239,8 @@ void q6apm_close_all(void)
 {
 	struct gpr_pkt *pkt;
 
+	q6apm_flush_idle_graphs(g_apm);
+
 	pkt = audioreach_alloc_apm_cmd_pkt(0, APM_CMD_CLOSE_ALL, 0);
 	if (IS_ERR(pkt))
 		return;
@@ -660,7 +725,7 @@ struct q6apm_graph *q6apm_graph_open(struct device *dev, q6apm_cb cb,
 free_graph:
 	kfree(graph);
 put_ar_graph:
-	kref_put(&ar_graph->refcount, q6apm_put_audioreach_graph);
+	q6apm_release_audioreach_graph(ar_graph);
 	return ERR_PTR(ret);
 }
 EXPORT_SYMBOL_GPL(q6apm_graph_open);
@@ -670,7 +735,7 @@ int q6apm_graph_close(struct q6apm_graph *graph)
 	struct audioreach_graph *ar_graph = graph->ar_graph;
 
 	graph->ar_graph = NULL;
-	kref_put(&ar_graph->refcount, q6apm_put_audioreach_graph);
+	q6apm_release_audioreach_graph(ar_graph);
 	gpr_free_port(graph->port);
 	kfree(graph);
 
@@ -722,6 +787,11 @@ static int q6apm_audio_probe(struct snd_soc_component *component)
 
 static void q6apm_audio_remove(struct snd_soc_component *component)
 {
+	struct q6apm *apm = dev_get_drvdata(component->dev);
+
+	/* idle graphs still point at the topology */
+	q6apm_flush_idle_graphs(apm);
+
 	/* remove topology */
 	snd_soc_tplg_component_remove(component);
 }
@@ -747,6 +817,7 @@ static int apm_probe(gpr_device_t *gdev)
 	dev_set_drvdata(dev, apm);
 
 	mutex_init(&apm->lock);
+	mutex_init(&apm->graph_lock);
 	apm->dev = dev;
 	apm->gdev = gdev;
 	init_waitqueue_head(&apm->wait);
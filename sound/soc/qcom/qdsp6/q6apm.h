@@ -4,6 +4,7 @@
 #include <linux/types.h>
 #include <linux/slab.h>
 #include <linux/wait.h>
+#include <linux/workqueue.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/sched.h>
@@ -58,6 +59,8 @@ struct q6apm {
 
 	struct mutex cmd_lock;
 	struct mutex lock;
+	/* Serializes opening and closing of graphs on the DSP */
+	struct mutex graph_lock;
 	uint32_t state;
 
 	struct list_head widget_list;
@@ -89,6 +92,8 @@ struct audioreach_graph {
 	void *graph;
 	struct kref refcount;
 	struct q6apm *apm;
+	/* Holds a reference to keep an unused graph open for a while */
+	struct delayed_work idle_work;
 };
 
 typedef void (*q6apm_cb) (uint32_t opcode, uint32_t token,
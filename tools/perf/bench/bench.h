@@ -47,6 +47,9 @@ int bench_uprobe_baseline(int argc, const char **argv);
 int bench_uprobe_empty(int argc, const char **argv);
 int bench_uprobe_trace_printk(int argc, const char **argv);
 int bench_pmu_scan(int argc, const char **argv);
+int bench_ipc_qrtr(int argc, const char **argv);
+int bench_ipc_rpmsg(int argc, const char **argv);
+int bench_ipc_fastrpc(int argc, const char **argv);
 
 #define BENCH_FORMAT_DEFAULT_STR	"default"
 #define BENCH_FORMAT_DEFAULT		0
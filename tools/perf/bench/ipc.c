@@ -0,0 +1,661 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * ipc.c
+ *
+ * ipc: Benchmarks for the Qualcomm IPC paths
+ *
+ *  qrtr:    ping-pong between AF_QIPCRTR sockets, on the local node, or with
+ *           a remote echo service
+ *  rpmsg:   echo through rpmsg_char endpoints, e.g. over GLINK, to a remote
+ *           echo service
+ *  fastrpc: invokes of a remote method, the null invoke with size 0
+ *
+ * Each benchmark sweeps the given message sizes and numbers of threads, every
+ * thread doing --loop round trips, and reports for each pair the round trips
+ * per second and the percentiles of the round trip latency. The output only
+ * depends on the parameters, so that runs on different kernels compare.
+ *
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+#include <subcmd/parse-options.h>
+#include "bench.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <linux/qrtr.h>
+#include <linux/time64.h>
+#include <misc/fastrpc.h>
+
+#ifndef AF_QIPCRTR
+#define AF_QIPCRTR	42
+#endif
+
+#define IPC_MAX_THREADS		64
+#define IPC_MAX_SWEEP		16
+#define IPC_TIMEOUT_MS		1000
+
+#define FASTRPC_SCALARS(method, in, out) \
+		((((method) & 0x1f) << 24) | (((in) & 0xff) << 16) | \
+		 (((out) & 0xff) << 8))
+
+static unsigned int loops = 10000;
+static const char *sizes_str = "64,512,4096";
+static const char *threads_str = "1,2,4";
+
+/* qrtr */
+static int qrtr_node = -1;
+static int qrtr_port = -1;
+
+/* rpmsg */
+static const char *rpmsg_devices = "/dev/rpmsg0";
+
+/* fastrpc */
+static const char *fastrpc_device = "/dev/fastrpc-adsp";
+static const char *fastrpc_shell;
+static unsigned int fastrpc_handle;
+static unsigned int fastrpc_method;
+static int fastrpc_fd = -1;
+
+#define IPC_COMMON_OPTIONS						\
+	OPT_UINTEGER('l', "loop", &loops,				\
+		     "Specify number of round trips per thread"),	\
+	OPT_STRING('s', "sizes", &sizes_str, "list",			\
+		   "Specify comma separated message sizes in bytes"),	\
+	OPT_STRING('t', "threads", &threads_str, "list",		\
+		   "Specify comma separated numbers of threads")
+
+static const struct option qrtr_options[] = {
+	IPC_COMMON_OPTIONS,
+	OPT_INTEGER('n', "node", &qrtr_node,
+		    "Node of a remote echo service, local ping-pong by default"),
+	OPT_INTEGER('p', "port", &qrtr_port, "Port of the remote echo service"),
+	OPT_END()
+};
+
+static const struct option rpmsg_options[] = {
+	IPC_COMMON_OPTIONS,
+	OPT_STRING('d', "devices", &rpmsg_devices, "list",
+		   "Specify comma separated rpmsg_char endpoint devices of a remote echo service, used round robin by the threads"),
+	OPT_END()
+};
+
+static const struct option fastrpc_options[] = {
+	IPC_COMMON_OPTIONS,
+	OPT_STRING('d', "device", &fastrpc_device, "path",
+		   "Specify the fastrpc device"),
+	OPT_STRING('S', "shell", &fastrpc_shell, "path",
+		   "Create a user process from this shell, attach to the guest process by default"),
+	OPT_UINTEGER('H', "handle", &fastrpc_handle,
+		     "Specify the remote handle to invoke"),
+	OPT_UINTEGER('m', "method", &fastrpc_method,
+		     "Specify the method to invoke, taking one input buffer, or none with size 0"),
+	OPT_END()
+};
+
+static const char * const bench_ipc_qrtr_usage[] = {
+	"perf bench ipc qrtr <options>",
+	NULL
+};
+
+static const char * const bench_ipc_rpmsg_usage[] = {
+	"perf bench ipc rpmsg <options>",
+	NULL
+};
+
+static const char * const bench_ipc_fastrpc_usage[] = {
+	"perf bench ipc fastrpc <options>",
+	NULL
+};
+
+struct ipc_bench;
+
+struct ipc_worker {
+	const struct ipc_bench	*bench;
+	pthread_t		thread;
+	unsigned int		nr;
+	size_t			size;
+	void			*buf;
+	uint64_t		*lat;
+	int			fd;
+	int			peer_fd;
+	pthread_t		peer_thread;
+	struct sockaddr_qrtr	peer;
+	int			err;
+};
+
+struct ipc_bench {
+	const char	*name;
+	int		(*setup)(struct ipc_worker *w);
+	int		(*round_trip)(struct ipc_worker *w);
+	void		(*cleanup)(struct ipc_worker *w);
+};
+
+static pthread_barrier_t start_barrier;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static int parse_list(const char *str, unsigned long *vals, const char *what)
+{
+	char *end;
+	int n = 0;
+
+	while (*str) {
+		if (n == IPC_MAX_SWEEP) {
+			fprintf(stderr, "Too many %s, at most %d\n", what,
+				IPC_MAX_SWEEP);
+			return -1;
+		}
+		vals[n++] = strtoul(str, &end, 0);
+		if (end == str || (*end && *end != ',')) {
+			fprintf(stderr, "Invalid %s: %s\n", what, str);
+			return -1;
+		}
+		str = *end ? end + 1 : end;
+	}
+
+	return n;
+}
+
+/* waits for a message on @fd for at most IPC_TIMEOUT_MS */
+static int wait_readable(int fd)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	int ret;
+
+	ret = poll(&pfd, 1, IPC_TIMEOUT_MS);
+	if (ret < 0)
+		return -errno;
+	return ret ? 0 : -ETIMEDOUT;
+}
+
+static void *qrtr_echo_thread(void *arg)
+{
+	struct ipc_worker *w = arg;
+	struct sockaddr_qrtr from;
+	socklen_t len;
+	unsigned int i;
+	ssize_t ret;
+
+	for (i = 0; i < loops; i++) {
+		if (wait_readable(w->peer_fd))
+			break;
+		len = sizeof(from);
+		ret = recvfrom(w->peer_fd, w->buf, w->size ?: 1, 0,
+			       (struct sockaddr *)&from, &len);
+		if (ret < 0)
+			break;
+		if (sendto(w->peer_fd, w->buf, ret, 0,
+			   (struct sockaddr *)&from, len) < 0)
+			break;
+	}
+
+	return NULL;
+}
+
+/* opens a socket, bound to an ephemeral port of the local node for @addr */
+static int qrtr_socket(struct sockaddr_qrtr *addr)
+{
+	socklen_t len = sizeof(*addr);
+	int fd, err;
+
+	fd = socket(AF_QIPCRTR, SOCK_DGRAM, 0);
+	if (fd < 0)
+		return -errno;
+
+	if (!addr)
+		return fd;
+
+	/* port 0 binds to an ephemeral one */
+	if (getsockname(fd, (struct sockaddr *)addr, &len) < 0 ||
+	    bind(fd, (struct sockaddr *)addr, sizeof(*addr)) < 0 ||
+	    getsockname(fd, (struct sockaddr *)addr, &len) < 0) {
+		err = -errno;
+		close(fd);
+		return err;
+	}
+
+	return fd;
+}
+
+static int qrtr_setup(struct ipc_worker *w)
+{
+	int ret;
+
+	w->fd = qrtr_socket(NULL);
+	if (w->fd < 0)
+		return w->fd;
+
+	if (qrtr_node >= 0) {
+		w->peer.sq_family = AF_QIPCRTR;
+		w->peer.sq_node = qrtr_node;
+		w->peer.sq_port = qrtr_port;
+		return 0;
+	}
+
+	w->peer_fd = qrtr_socket(&w->peer);
+	if (w->peer_fd < 0)
+		return w->peer_fd;
+
+	ret = pthread_create(&w->peer_thread, NULL, qrtr_echo_thread, w);
+	if (ret) {
+		close(w->peer_fd);
+		w->peer_fd = -1;
+		return -ret;
+	}
+
+	return 0;
+}
+
+static int qrtr_round_trip(struct ipc_worker *w)
+{
+	ssize_t ret;
+
+	if (sendto(w->fd, w->buf, w->size, 0, (struct sockaddr *)&w->peer,
+		   sizeof(w->peer)) < 0)
+		return -errno;
+
+	ret = wait_readable(w->fd);
+	if (ret)
+		return ret;
+
+	ret = recv(w->fd, w->buf, w->size ?: 1, 0);
+	return ret < 0 ? -errno : 0;
+}
+
+static void qrtr_cleanup(struct ipc_worker *w)
+{
+	if (w->peer_fd >= 0) {
+		pthread_join(w->peer_thread, NULL);
+		close(w->peer_fd);
+	}
+	if (w->fd >= 0)
+		close(w->fd);
+}
+
+static int rpmsg_setup(struct ipc_worker *w)
+{
+	const char *dev = rpmsg_devices, *p;
+	unsigned int count = 1, i;
+	char path[256];
+	size_t len;
+
+	for (p = rpmsg_devices; (p = strchr(p, ',')); p++)
+		count++;
+
+	/* the thread's device, round robin */
+	for (i = 0; i < w->nr % count; i++)
+		dev = strchr(dev, ',') + 1;
+
+	len = strcspn(dev, ",");
+	if (len >= sizeof(path))
+		return -ENAMETOOLONG;
+	memcpy(path, dev, len);
+	path[len] = '\0';
+
+	w->fd = open(path, O_RDWR);
+	return w->fd < 0 ? -errno : 0;
+}
+
+static int rpmsg_round_trip(struct ipc_worker *w)
+{
+	ssize_t ret;
+
+	if (write(w->fd, w->buf, w->size) < 0)
+		return -errno;
+
+	ret = wait_readable(w->fd);
+	if (ret)
+		return ret;
+
+	ret = read(w->fd, w->buf, w->size ?: 1);
+	return ret < 0 ? -errno : 0;
+}
+
+static void rpmsg_cleanup(struct ipc_worker *w)
+{
+	if (w->fd >= 0)
+		close(w->fd);
+}
+
+/* opens the device and sets up the remote process shared by the threads */
+static int fastrpc_open(void)
+{
+	struct fastrpc_init_create init = { .filefd = -1 };
+	struct stat st;
+	void *shell = NULL;
+	int fd, shell_fd, ret = 0;
+
+	fd = open(fastrpc_device, O_RDWR);
+	if (fd < 0)
+		return -errno;
+
+	if (!fastrpc_shell) {
+		if (ioctl(fd, FASTRPC_IOCTL_INIT_ATTACH) < 0)
+			ret = -errno;
+		goto out;
+	}
+
+	shell_fd = open(fastrpc_shell, O_RDONLY);
+	if (shell_fd < 0) {
+		ret = -errno;
+		goto out;
+	}
+
+	if (fstat(shell_fd, &st) < 0) {
+		ret = -errno;
+	} else if (!(shell = malloc(st.st_size))) {
+		ret = -ENOMEM;
+	} else if (read(shell_fd, shell, st.st_size) != st.st_size) {
+		ret = -EIO;
+	} else {
+		init.file = (uintptr_t)shell;
+		init.filelen = st.st_size;
+		if (ioctl(fd, FASTRPC_IOCTL_INIT_CREATE, &init) < 0)
+			ret = -errno;
+	}
+	free(shell);
+	close(shell_fd);
+out:
+	if (ret) {
+		close(fd);
+		return ret;
+	}
+
+	fastrpc_fd = fd;
+	return 0;
+}
+
+static int fastrpc_setup(struct ipc_worker *w)
+{
+	w->fd = fastrpc_fd;
+	return 0;
+}
+
+static int fastrpc_round_trip(struct ipc_worker *w)
+{
+	struct fastrpc_invoke_args args = {
+		.ptr = (uintptr_t)w->buf,
+		.length = w->size,
+		.fd = -1,
+	};
+	struct fastrpc_invoke inv = {
+		.handle = fastrpc_handle,
+		.sc = FASTRPC_SCALARS(fastrpc_method, w->size ? 1 : 0, 0),
+		.args = w->size ? (uintptr_t)&args : 0,
+	};
+
+	return ioctl(w->fd, FASTRPC_IOCTL_INVOKE, &inv) < 0 ? -errno : 0;
+}
+
+static void *worker_thread(void *arg)
+{
+	struct ipc_worker *w = arg;
+	uint64_t start;
+	unsigned int i;
+
+	pthread_barrier_wait(&start_barrier);
+
+	for (i = 0; i < loops; i++) {
+		start = now_ns();
+		w->err = w->bench->round_trip(w);
+		if (w->err)
+			break;
+		w->lat[i] = now_ns() - start;
+	}
+
+	return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void print_header(const struct ipc_bench *bench)
+{
+	if (bench_format != BENCH_FORMAT_DEFAULT)
+		return;
+
+	printf("# Running 'ipc/%s' benchmark:\n", bench->name);
+	printf("# Executed %u round trips per thread\n\n", loops);
+	printf("%8s %8s %12s %10s %10s %10s %10s %10s\n", "size", "threads",
+	       "ops/sec", "MB/sec", "p50(usec)", "p90(usec)", "p99(usec)",
+	       "max(usec)");
+}
+
+static void print_result(size_t size, unsigned int nr_threads, uint64_t *lat,
+			 unsigned long n, uint64_t runtime_ns)
+{
+	double ops = n * (double)NSEC_PER_SEC / runtime_ns;
+
+	qsort(lat, n, sizeof(*lat), cmp_u64);
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("%8zu %8u %12.0f %10.2f %10.1f %10.1f %10.1f %10.1f\n",
+		       size, nr_threads, ops, ops * size / (1024 * 1024),
+		       lat[n / 2] / 1000.0, lat[n * 9 / 10] / 1000.0,
+		       lat[n * 99 / 100] / 1000.0, lat[n - 1] / 1000.0);
+		break;
+	case BENCH_FORMAT_SIMPLE:
+		printf("%zu %u %.0f %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
+		       size, nr_threads, ops, lat[n / 2], lat[n * 9 / 10],
+		       lat[n * 99 / 100], lat[n - 1]);
+		break;
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+}
+
+static int run_one(const struct ipc_bench *bench, size_t size,
+		   unsigned int nr_threads)
+{
+	struct ipc_worker workers[IPC_MAX_THREADS];
+	unsigned int i, started = 0;
+	unsigned long n = 0;
+	uint64_t *lat, start, runtime;
+	int err = 0;
+
+	lat = calloc((size_t)nr_threads * loops, sizeof(*lat));
+	if (!lat)
+		return -ENOMEM;
+
+	memset(workers, 0, sizeof(workers));
+	for (i = 0; i < nr_threads; i++) {
+		workers[i].bench = bench;
+		workers[i].nr = i;
+		workers[i].size = size;
+		workers[i].fd = -1;
+		workers[i].peer_fd = -1;
+		workers[i].lat = lat + (size_t)i * loops;
+	}
+
+	for (i = 0; i < nr_threads; i++) {
+		struct ipc_worker *w = &workers[i];
+
+		w->buf = calloc(1, size ?: 1);
+		if (!w->buf) {
+			err = -ENOMEM;
+			break;
+		}
+		err = bench->setup(w);
+		if (err)
+			break;
+	}
+
+	if (!err) {
+		pthread_barrier_init(&start_barrier, NULL, nr_threads + 1);
+		for (i = 0; i < nr_threads; i++) {
+			err = -pthread_create(&workers[i].thread, NULL,
+					      worker_thread, &workers[i]);
+			if (err)
+				break;
+			started++;
+		}
+		if (err) {
+			fprintf(stderr, "Failed to create threads: %s\n",
+				strerror(-err));
+			exit(1);
+		}
+
+		start = now_ns();
+		pthread_barrier_wait(&start_barrier);
+		for (i = 0; i < started; i++)
+			pthread_join(workers[i].thread, NULL);
+		runtime = now_ns() - start;
+		pthread_barrier_destroy(&start_barrier);
+
+		/* compact the samples of the threads */
+		for (i = 0; i < nr_threads; i++) {
+			if (workers[i].err) {
+				err = workers[i].err;
+				continue;
+			}
+			memmove(lat + n, workers[i].lat, loops * sizeof(*lat));
+			n += loops;
+		}
+	}
+
+	for (i = 0; i < nr_threads; i++) {
+		if (bench->cleanup)
+			bench->cleanup(&workers[i]);
+		free(workers[i].buf);
+	}
+
+	if (err)
+		fprintf(stderr, "ipc/%s: size %zu, %u threads: %s\n",
+			bench->name, size, nr_threads, strerror(-err));
+	else
+		print_result(size, nr_threads, lat, n, runtime);
+
+	free(lat);
+	return err;
+}
+
+static int run_sweep(const struct ipc_bench *bench)
+{
+	unsigned long sizes[IPC_MAX_SWEEP], threads[IPC_MAX_SWEEP];
+	int nr_sizes, nr_threads, i, j, err = 0;
+
+	nr_sizes = parse_list(sizes_str, sizes, "sizes");
+	nr_threads = parse_list(threads_str, threads, "threads");
+	if (nr_sizes < 0 || nr_threads < 0)
+		return -1;
+
+	for (j = 0; j < nr_threads; j++) {
+		if (!threads[j] || threads[j] > IPC_MAX_THREADS) {
+			fprintf(stderr, "Number of threads must be 1 to %d\n",
+				IPC_MAX_THREADS);
+			return -1;
+		}
+	}
+	if (!loops) {
+		fprintf(stderr, "Number of loops must not be 0\n");
+		return -1;
+	}
+
+	print_header(bench);
+	for (i = 0; i < nr_sizes; i++) {
+		for (j = 0; j < nr_threads; j++) {
+			if (run_one(bench, sizes[i], threads[j]))
+				err = -1;
+		}
+	}
+
+	return err;
+}
+
+static const struct ipc_bench qrtr_bench = {
+	.name		= "qrtr",
+	.setup		= qrtr_setup,
+	.round_trip	= qrtr_round_trip,
+	.cleanup	= qrtr_cleanup,
+};
+
+static const struct ipc_bench rpmsg_bench = {
+	.name		= "rpmsg",
+	.setup		= rpmsg_setup,
+	.round_trip	= rpmsg_round_trip,
+	.cleanup	= rpmsg_cleanup,
+};
+
+static const struct ipc_bench fastrpc_bench = {
+	.name		= "fastrpc",
+	.setup		= fastrpc_setup,
+	.round_trip	= fastrpc_round_trip,
+};
+
+int bench_ipc_qrtr(int argc, const char **argv)
+{
+	argc = parse_options(argc, argv, qrtr_options, bench_ipc_qrtr_usage, 0);
+	if (argc)
+		usage_with_options(bench_ipc_qrtr_usage, qrtr_options);
+
+	if (qrtr_node >= 0 && qrtr_port < 0) {
+		fprintf(stderr, "A remote node needs a --port\n");
+		return -1;
+	}
+
+	return run_sweep(&qrtr_bench);
+}
+
+int bench_ipc_rpmsg(int argc, const char **argv)
+{
+	argc = parse_options(argc, argv, rpmsg_options, bench_ipc_rpmsg_usage, 0);
+	if (argc)
+		usage_with_options(bench_ipc_rpmsg_usage, rpmsg_options);
+
+	return run_sweep(&rpmsg_bench);
+}
+
+int bench_ipc_fastrpc(int argc, const char **argv)
+{
+	int ret;
+
+	/* the null invoke by default */
+	sizes_str = "0,4096,65536";
+
+	argc = parse_options(argc, argv, fastrpc_options,
+			     bench_ipc_fastrpc_usage, 0);
+	if (argc)
+		usage_with_options(bench_ipc_fastrpc_usage, fastrpc_options);
+
+	if (!fastrpc_handle) {
+		fprintf(stderr, "A remote --handle to invoke is needed\n");
+		return -1;
+	}
+
+	ret = fastrpc_open();
+	if (ret) {
+		fprintf(stderr, "Failed to set up %s: %s\n", fastrpc_device,
+			strerror(-ret));
+		return -1;
+	}
+
+	ret = run_sweep(&fastrpc_bench);
+	close(fastrpc_fd);
+	return ret;
+}
@@ -11,3 +11,14 @@
 
 #endif
 
+#ifdef __aarch64__
+
+#define MEMCPY_FN(fn, name, desc)		\
+	void *fn(void *, const void *, size_t);
+
+#include "mem-memcpy-arm64-asm-def.h"
+
+#undef MEMCPY_FN
+
+#endif
+
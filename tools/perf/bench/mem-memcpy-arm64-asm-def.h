@@ -0,0 +1,9 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+MEMCPY_FN(memcpy_arm64_ldp,
+	"arm64-ldp",
+	"ldp/stp loop of the large copies in arch/arm64/lib/memcpy.S")
+
+MEMCPY_FN(memcpy_arm64_ldnp,
+	"arm64-ldnp",
+	"ldnp/stnp loop of the non-temporal copies in arch/arm64/lib/memcpy.S")
@@ -21,6 +21,12 @@ static char *directions[] = {
 	"FROM_DEVICE",
 };
 
+static char *modes[] = {
+	"SINGLE",
+	"SG",
+	"DMABUF",
+};
+
 int main(int argc, char **argv)
 {
 	struct map_benchmark map;
@@ -31,11 +37,14 @@ int main(int argc, char **argv)
 	int bits = 32, xdelay = 0, dir = DMA_MAP_BIDIRECTIONAL;
 	/* default granule 1 PAGESIZE */
 	int granule = 1;
+	/* default dma_map_single() of a contiguous buffer */
+	int mode = DMA_MAP_SINGLE_MODE;
+	char *heap = "system";
 
 	int cmd = DMA_MAP_BENCHMARK;
 	char *p;
 
-	while ((opt = getopt(argc, argv, "t:s:n:b:d:x:g:")) != -1) {
+	while ((opt = getopt(argc, argv, "t:s:n:b:d:x:g:m:H:")) != -1) {
 		switch (opt) {
 		case 't':
 			threads = atoi(optarg);
@@ -58,6 +67,12 @@ int main(int argc, char **argv)
 		case 'g':
 			granule = atoi(optarg);
 			break;
+		case 'm':
+			mode = atoi(optarg);
+			break;
+		case 'H':
+			heap = optarg;
+			break;
 		default:
 			return -1;
 		}
@@ -98,6 +113,17 @@ int main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (mode != DMA_MAP_SINGLE_MODE && mode != DMA_MAP_SG_MODE &&
+			mode != DMA_MAP_DMABUF_MODE) {
+		fprintf(stderr, "invalid mapping mode\n");
+		exit(1);
+	}
+
+	if (strlen(heap) >= DMA_MAP_HEAP_NAME_LEN) {
+		fprintf(stderr, "heap name too long\n");
+		exit(1);
+	}
+
 	fd = open("/sys/kernel/debug/dma_map_benchmark", O_RDWR);
 	if (fd == -1) {
 		perror("open");
@@ -112,18 +138,29 @@ int main(int argc, char **argv)
 	map.dma_dir = dir;
 	map.dma_trans_ns = xdelay;
 	map.granule = granule;
+	map.dma_mode = mode;
+	strcpy(map.heap_name, heap);
 
 	if (ioctl(fd, cmd, &map)) {
 		perror("ioctl");
 		exit(1);
 	}
 
-	printf("dma mapping benchmark: threads:%d seconds:%d node:%d dir:%s granule: %d\n",
-			threads, seconds, node, dir[directions], granule);
+	printf("dma mapping benchmark: threads:%d seconds:%d node:%d dir:%s granule: %d mode:%s\n",
+			threads, seconds, node, dir[directions], granule,
+			modes[mode]);
+	if (mode == DMA_MAP_DMABUF_MODE)
+		printf("heap:%s\n", heap);
 	printf("average map latency(us):%.1f standard deviation:%.1f\n",
 			map.avg_map_100ns/10.0, map.map_stddev/10.0);
+	printf("map latency(us) p50:%.1f p90:%.1f p99:%.1f max:%.1f\n",
+			map.map_p50_100ns/10.0, map.map_p90_100ns/10.0,
+			map.map_p99_100ns/10.0, map.map_max_100ns/10.0);
 	printf("average unmap latency(us):%.1f standard deviation:%.1f\n",
 			map.avg_unmap_100ns/10.0, map.unmap_stddev/10.0);
+	printf("unmap latency(us) p50:%.1f p90:%.1f p99:%.1f max:%.1f\n",
+			map.unmap_p50_100ns/10.0, map.unmap_p90_100ns/10.0,
+			map.unmap_p99_100ns/10.0, map.unmap_max_100ns/10.0);
 
 	return 0;
 }
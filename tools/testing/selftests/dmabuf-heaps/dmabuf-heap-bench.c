@@ -0,0 +1,319 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * dma-buf heaps allocation benchmark
+ *
+ * For each heap, or the ones given on the command line, and sizes from 4K
+ * to 64M, measures the latency percentiles of:
+ *  - allocation and free,
+ *  - mmap() and the first touch of every page,
+ *  - DMA_BUF_IOCTL_SYNC begin/end around a CPU access,
+ * then the allocation throughput with several threads contending on the
+ * heap. Heaps that can't be mapped, like secure ones, only report the
+ * allocation numbers, sizes a heap is too small for are skipped.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+
+#include <linux/dma-buf.h>
+#include <linux/dma-heap.h>
+
+#define DEVPATH "/dev/dma_heap"
+
+#define MAX_THREADS	8
+
+static const size_t sizes[] = {
+	4 << 10, 64 << 10, 1 << 20, 4 << 20, 16 << 20, 64 << 20,
+};
+
+static unsigned int iterations = 100;
+static unsigned int max_threads = MAX_THREADS;
+static unsigned int contention_ms = 1000;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int heap_open(const char *name)
+{
+	char buf[256];
+
+	snprintf(buf, sizeof(buf), "%s/%s", DEVPATH, name);
+	return open(buf, O_RDWR);
+}
+
+static int heap_alloc(int heap_fd, size_t len, int *dmabuf_fd)
+{
+	struct dma_heap_allocation_data data = {
+		.len = len,
+		.fd_flags = O_RDWR | O_CLOEXEC,
+	};
+	int ret;
+
+	ret = ioctl(heap_fd, DMA_HEAP_IOCTL_ALLOC, &data);
+	if (ret < 0)
+		return -errno;
+	*dmabuf_fd = (int)data.fd;
+	return 0;
+}
+
+static int dmabuf_sync(int fd, uint64_t flags)
+{
+	struct dma_buf_sync sync = {
+		.flags = flags | DMA_BUF_SYNC_RW,
+	};
+
+	return ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync);
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Sorts @samples and prints their percentiles in us */
+static void print_stats(const char *what, uint64_t *samples, unsigned int n)
+{
+	if (!n) {
+		printf("  %-12s n/a\n", what);
+		return;
+	}
+
+	qsort(samples, n, sizeof(*samples), cmp_u64);
+	printf("  %-12s p50 %9.1f  p90 %9.1f  p99 %9.1f  max %9.1f us\n", what,
+	       samples[n / 2] / 1000.0, samples[n * 9 / 10] / 1000.0,
+	       samples[n * 99 / 100] / 1000.0, samples[n - 1] / 1000.0);
+}
+
+/* Fewer iterations for the large sizes, to keep the run time reasonable */
+static unsigned int size_iterations(size_t size)
+{
+	unsigned int n = iterations;
+
+	if (size >= 16 << 20)
+		n /= 10;
+	return n ? n : 1;
+}
+
+static int bench_size(int heap_fd, size_t size)
+{
+	unsigned int n = size_iterations(size), i, mapped = 0;
+	uint64_t *alloc, *release, *touch, *sync;
+	long page_size = sysconf(_SC_PAGESIZE);
+	uint64_t start;
+	int ret = 0, fd;
+	size_t off;
+	char *p;
+
+	alloc = calloc(n, sizeof(*alloc));
+	release = calloc(n, sizeof(*release));
+	touch = calloc(n, sizeof(*touch));
+	sync = calloc(n, sizeof(*sync));
+	if (!alloc || !release || !touch || !sync) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < n; i++) {
+		start = now_ns();
+		ret = heap_alloc(heap_fd, size, &fd);
+		if (ret)
+			break;
+		alloc[i] = now_ns() - start;
+
+		start = now_ns();
+		p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (p != MAP_FAILED) {
+			for (off = 0; off < size; off += page_size)
+				p[off] = 1;
+			touch[mapped] = now_ns() - start;
+
+			start = now_ns();
+			dmabuf_sync(fd, DMA_BUF_SYNC_START);
+			p[0] = 2;
+			dmabuf_sync(fd, DMA_BUF_SYNC_END);
+			sync[mapped++] = now_ns() - start;
+
+			munmap(p, size);
+		}
+
+		start = now_ns();
+		close(fd);
+		release[i] = now_ns() - start;
+	}
+
+	if (!i) {
+		printf("  %zuK: allocation failed (%s), skipped\n", size >> 10,
+		       strerror(-ret));
+		goto out;
+	}
+	ret = 0;
+
+	printf(" %zuK (%u iterations)\n", size >> 10, i);
+	print_stats("alloc", alloc, i);
+	print_stats("free", release, i);
+	print_stats("mmap+touch", touch, mapped);
+	print_stats("sync", sync, mapped);
+out:
+	free(alloc);
+	free(release);
+	free(touch);
+	free(sync);
+	return ret;
+}
+
+struct contention_arg {
+	int heap_fd;
+	size_t size;
+	uint64_t deadline;
+	unsigned long allocs;
+	int error;
+};
+
+static void *contention_thread(void *data)
+{
+	struct contention_arg *arg = data;
+	int fd;
+
+	while (now_ns() < arg->deadline) {
+		arg->error = heap_alloc(arg->heap_fd, arg->size, &fd);
+		if (arg->error)
+			break;
+		close(fd);
+		arg->allocs++;
+	}
+
+	return NULL;
+}
+
+static void bench_contention(int heap_fd, size_t size)
+{
+	struct contention_arg args[MAX_THREADS];
+	pthread_t threads[MAX_THREADS];
+	unsigned int nr, i;
+	unsigned long total;
+	uint64_t deadline;
+
+	printf(" %zuK alloc+free throughput\n", size >> 10);
+	for (nr = 1; nr <= max_threads; nr *= 2) {
+		deadline = now_ns() + contention_ms * 1000000ULL;
+		for (i = 0; i < nr; i++) {
+			args[i] = (struct contention_arg) {
+				.heap_fd = heap_fd,
+				.size = size,
+				.deadline = deadline,
+			};
+			if (pthread_create(&threads[i], NULL, contention_thread,
+					   &args[i]))
+				break;
+		}
+		nr = i;
+
+		total = 0;
+		for (i = 0; i < nr; i++) {
+			pthread_join(threads[i], NULL);
+			total += args[i].allocs;
+		}
+		if (!nr || args[0].error) {
+			printf("  %u threads: failed\n", nr);
+			break;
+		}
+		printf("  %u threads: %10.0f allocs/s\n", nr,
+		       total * 1000.0 / contention_ms);
+	}
+}
+
+static void bench_heap(const char *name)
+{
+	unsigned int i;
+	int heap_fd;
+
+	heap_fd = heap_open(name);
+	if (heap_fd < 0) {
+		printf("open %s failed: %s\n", name, strerror(errno));
+		return;
+	}
+
+	printf("Benchmarking heap: %s\n", name);
+	printf("=======================================\n");
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+		bench_size(heap_fd, sizes[i]);
+	bench_contention(heap_fd, 4 << 10);
+	bench_contention(heap_fd, 1 << 20);
+
+	close(heap_fd);
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-n iterations] [-t max threads] [-d ms] [heap...]\n",
+	       prog);
+}
+
+int main(int argc, char **argv)
+{
+	struct dirent *dir;
+	DIR *d;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:t:d:h")) != -1) {
+		switch (opt) {
+		case 'n':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			max_threads = strtoul(optarg, NULL, 0);
+			if (max_threads > MAX_THREADS)
+				max_threads = MAX_THREADS;
+			break;
+		case 'd':
+			contention_ms = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : -1;
+		}
+	}
+
+	if (optind < argc) {
+		for (; optind < argc; optind++)
+			bench_heap(argv[optind]);
+		return 0;
+	}
+
+	d = opendir(DEVPATH);
+	if (!d) {
+		printf("No %s directory?\n", DEVPATH);
+		return -1;
+	}
+
+	while ((dir = readdir(d)) != NULL) {
+		if (!strncmp(dir->d_name, ".", 2))
+			continue;
+		if (!strncmp(dir->d_name, "..", 3))
+			continue;
+
+		bench_heap(dir->d_name);
+	}
+	closedir(d);
+
+	return 0;
+}
@@ -0,0 +1,417 @@
+// SPDX-License-Identifier: GPL-2.0
+
+/*
+ * Round-trip, marshalling and map/unmap benchmark for the fastrpc driver.
+ *
+ * Without arguments, the DSP utilities handle is queried for its
+ * attributes, a call every DSP image answers, to measure the bare
+ * INVOKE and INVOKEV2 round trip. With -H and -m, the given handle and
+ * method are treated as an echo service, taking one input and one output
+ * buffer of the same size, and are used to sweep argument sizes and the
+ * number of dma-buf fd arguments.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include <linux/dma-heap.h>
+#include <misc/fastrpc.h>
+
+#define KSFT_SKIP	4
+
+/* Not part of the uapi header; mirrors drivers/misc/fastrpc.c */
+struct fastrpc_invoke_v2 {
+	struct fastrpc_invoke inv;
+	__u64 crc;
+	__u64 perf_kernel;
+	__u64 perf_dsp;
+	__u64 poll_timeout;
+	__u32 reserved[18];
+};
+
+#define FASTRPC_IOCTL_INVOKEV2		_IOWR('R', 14, struct fastrpc_invoke_v2)
+
+#define FASTRPC_SCALARS(method, in, out) \
+	((((method) & 0x1f) << 24) | (((in) & 0xff) << 16) | (((out) & 0xff) << 8))
+
+#define DSP_UTILITIES_HANDLE	2
+#define DSP_MAX_ATTRIBUTES	256
+
+/* Must match PERF_KEY_MAX and FASTRPC_DSP_PERF_LIST in the driver */
+#define KERNEL_PERF_KEYS	11
+#define DSP_PERF_KEYS		12
+
+#define MAX_FDS			8
+#define MAX_SAMPLES		100000
+
+static const char * const kernel_perf_names[KERNEL_PERF_KEYS] = {
+	"count", "flush", "map", "copy", "link", "getargs", "putargs",
+	"invargs", "invoke", "argbuf_inuse", "argbuf_fallback",
+};
+
+static int iterations = 1000;
+static int rpc_fd = -1;
+static int heap_fd = -1;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void print_stats(const char *name, uint64_t *samples, int n)
+{
+	uint64_t sum = 0;
+	int i;
+
+	if (!n)
+		return;
+
+	for (i = 0; i < n; i++)
+		sum += samples[i];
+	qsort(samples, n, sizeof(*samples), cmp_u64);
+
+	printf("  %-32s avg %8.2f us  min %8.2f us  p50 %8.2f us  p99 %8.2f us\n",
+	       name, sum / 1000.0 / n, samples[0] / 1000.0,
+	       samples[n / 2] / 1000.0, samples[(n * 99) / 100] / 1000.0);
+}
+
+static void print_perf(const uint64_t *kernel, const uint64_t *dsp, int n)
+{
+	int i;
+
+	printf("    kernel perf (avg ns):");
+	for (i = 0; i < KERNEL_PERF_KEYS; i++)
+		printf(" %s=%llu", kernel_perf_names[i],
+		       (unsigned long long)(kernel[i] / n));
+	printf("\n    dsp perf (avg):");
+	for (i = 0; i < DSP_PERF_KEYS; i++)
+		printf(" %llu", (unsigned long long)(dsp[i] / n));
+	printf("\n");
+}
+
+/*
+ * Issue @inv @iterations times through INVOKE, then through INVOKEV2 with
+ * the perf counters enabled, and report both.
+ */
+static int bench_invoke(const char *name, struct fastrpc_invoke *inv)
+{
+	uint64_t kernel[KERNEL_PERF_KEYS], dsp[DSP_PERF_KEYS];
+	uint64_t kernel_sum[KERNEL_PERF_KEYS] = { 0 }, dsp_sum[DSP_PERF_KEYS] = { 0 };
+	struct fastrpc_invoke_v2 inv2;
+	uint64_t *samples, start;
+	char label[64];
+	int i, j, ret;
+
+	samples = calloc(iterations, sizeof(*samples));
+	if (!samples)
+		return -ENOMEM;
+
+	printf("%s\n", name);
+	for (i = 0; i < iterations; i++) {
+		start = now_ns();
+		ret = ioctl(rpc_fd, FASTRPC_IOCTL_INVOKE, inv);
+		samples[i] = now_ns() - start;
+		if (ret) {
+			printf("  FASTRPC_IOCTL_INVOKE failed: %s\n", strerror(errno));
+			goto out;
+		}
+	}
+	snprintf(label, sizeof(label), "INVOKE");
+	print_stats(label, samples, iterations);
+
+	memset(&inv2, 0, sizeof(inv2));
+	inv2.inv = *inv;
+	inv2.perf_kernel = (uintptr_t)kernel;
+	inv2.perf_dsp = (uintptr_t)dsp;
+	for (i = 0; i < iterations; i++) {
+		memset(kernel, 0, sizeof(kernel));
+		memset(dsp, 0, sizeof(dsp));
+		start = now_ns();
+		ret = ioctl(rpc_fd, FASTRPC_IOCTL_INVOKEV2, &inv2);
+		samples[i] = now_ns() - start;
+		if (ret) {
+			printf("  FASTRPC_IOCTL_INVOKEV2 failed: %s\n", strerror(errno));
+			goto out;
+		}
+		for (j = 0; j < KERNEL_PERF_KEYS; j++)
+			kernel_sum[j] += kernel[j];
+		for (j = 0; j < DSP_PERF_KEYS; j++)
+			dsp_sum[j] += dsp[j];
+	}
+	snprintf(label, sizeof(label), "INVOKEV2 (perf enabled)");
+	print_stats(label, samples, iterations);
+	print_perf(kernel_sum, dsp_sum, iterations);
+	ret = 0;
+out:
+	free(samples);
+	return ret;
+}
+
+static int bench_utilities(void)
+{
+	uint32_t attrs[DSP_MAX_ATTRIBUTES];
+	uint32_t len = DSP_MAX_ATTRIBUTES - 1;
+	struct fastrpc_invoke_args args[2] = { 0 };
+	struct fastrpc_invoke inv;
+
+	args[0].ptr = (uintptr_t)&len;
+	args[0].length = sizeof(len);
+	args[0].fd = -1;
+	args[1].ptr = (uintptr_t)&attrs[1];
+	args[1].length = len * sizeof(uint32_t);
+	args[1].fd = -1;
+
+	inv.handle = DSP_UTILITIES_HANDLE;
+	inv.sc = FASTRPC_SCALARS(0, 1, 1);
+	inv.args = (uintptr_t)args;
+
+	return bench_invoke("round trip: dsp utilities attribute query", &inv);
+}
+
+static int heap_alloc(size_t len)
+{
+	struct dma_heap_allocation_data data = {
+		.len = len,
+		.fd_flags = O_RDWR | O_CLOEXEC,
+	};
+
+	if (ioctl(heap_fd, DMA_HEAP_IOCTL_ALLOC, &data))
+		return -1;
+
+	return data.fd;
+}
+
+/* Echo @size bytes, through plain buffers or through @nfds dma-bufs */
+static int bench_echo(uint32_t handle, uint32_t method, size_t size, int nfds)
+{
+	struct fastrpc_invoke_args args[2 * MAX_FDS] = { 0 };
+	int fds[2 * MAX_FDS];
+	void *bufs[2 * MAX_FDS];
+	struct fastrpc_invoke inv;
+	int nargs = nfds ? nfds : 1;
+	char name[96];
+	int i, ret = 0;
+
+	for (i = 0; i < 2 * nargs; i++) {
+		fds[i] = -1;
+		bufs[i] = MAP_FAILED;
+	}
+
+	for (i = 0; i < 2 * nargs; i++) {
+		if (nfds) {
+			fds[i] = heap_alloc(size);
+			if (fds[i] < 0) {
+				ret = -errno;
+				goto out;
+			}
+			bufs[i] = mmap(NULL, size, PROT_READ | PROT_WRITE,
+				       MAP_SHARED, fds[i], 0);
+		} else {
+			bufs[i] = mmap(NULL, size, PROT_READ | PROT_WRITE,
+				       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		}
+		if (bufs[i] == MAP_FAILED) {
+			ret = -errno;
+			goto out;
+		}
+		memset(bufs[i], i, size);
+
+		args[i].ptr = (uintptr_t)bufs[i];
+		args[i].length = size;
+		args[i].fd = fds[i];
+	}
+
+	inv.handle = handle;
+	inv.sc = FASTRPC_SCALARS(method, nargs, nargs);
+	inv.args = (uintptr_t)args;
+
+	snprintf(name, sizeof(name), "echo: %zu bytes x %d in/out%s", size,
+		 nargs, nfds ? " dma-buf" : "");
+	ret = bench_invoke(name, &inv);
+out:
+	for (i = 0; i < 2 * nargs; i++) {
+		if (bufs[i] != MAP_FAILED)
+			munmap(bufs[i], size);
+		if (fds[i] >= 0)
+			close(fds[i]);
+	}
+	if (ret)
+		printf("echo: %zu bytes x %d: %s\n", size, nargs, strerror(-ret));
+	return ret;
+}
+
+static int bench_map_unmap(size_t size)
+{
+	struct fastrpc_mem_unmap unmap;
+	struct fastrpc_mem_map map;
+	uint64_t *samples, start;
+	void *va;
+	int fd, i, ret = 0;
+
+	fd = heap_alloc(size);
+	if (fd < 0)
+		return -errno;
+
+	va = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (va == MAP_FAILED) {
+		close(fd);
+		return -errno;
+	}
+
+	samples = calloc(iterations, sizeof(*samples));
+	if (!samples) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	printf("mem map/unmap: %zu bytes\n", size);
+	for (i = 0; i < iterations; i++) {
+		memset(&map, 0, sizeof(map));
+		map.fd = fd;
+		map.vaddrin = (uintptr_t)va;
+		map.length = size;
+
+		start = now_ns();
+		if (ioctl(rpc_fd, FASTRPC_IOCTL_MEM_MAP, &map)) {
+			ret = -errno;
+			break;
+		}
+
+		memset(&unmap, 0, sizeof(unmap));
+		unmap.fd = fd;
+		unmap.vaddr = map.vaddrout;
+		unmap.length = size;
+		if (ioctl(rpc_fd, FASTRPC_IOCTL_MEM_UNMAP, &unmap)) {
+			ret = -errno;
+			break;
+		}
+		samples[i] = now_ns() - start;
+	}
+	if (!ret)
+		print_stats("MEM_MAP + MEM_UNMAP", samples, iterations);
+	else
+		printf("  failed: %s\n", strerror(-ret));
+	free(samples);
+out:
+	munmap(va, size);
+	close(fd);
+	return ret;
+}
+
+static void usage(const char *prog)
+{
+	printf("usage: %s [-d device] [-n iterations] [-H handle -m method] [-s max size] [-f max fds]\n"
+	       "  -d  fastrpc device node (default /dev/fastrpc-cdsp)\n"
+	       "  -n  calls per measurement (default 1000)\n"
+	       "  -H  remote handle of an echo service in this process\n"
+	       "  -m  method of the echo service taking one in and one out buffer\n"
+	       "  -s  largest echo size to sweep up to (default 1 MiB)\n"
+	       "  -f  largest number of dma-buf fd pairs to sweep up to (default %d)\n",
+	       prog, MAX_FDS);
+}
+
+int main(int argc, char **argv)
+{
+	const char *device = "/dev/fastrpc-cdsp";
+	long handle = -1, method = -1;
+	size_t size, max_size = 1 << 20;
+	int max_fds = MAX_FDS;
+	int opt, nfds, ret;
+
+	while ((opt = getopt(argc, argv, "d:n:H:m:s:f:h")) != -1) {
+		switch (opt) {
+		case 'd':
+			device = optarg;
+			break;
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		case 'H':
+			handle = strtol(optarg, NULL, 0);
+			break;
+		case 'm':
+			method = strtol(optarg, NULL, 0);
+			break;
+		case 's':
+			max_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'f':
+			max_fds = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (iterations <= 0 || iterations > MAX_SAMPLES ||
+	    max_fds < 0 || max_fds > MAX_FDS || (handle < 0) != (method < 0)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	rpc_fd = open(device, O_RDWR);
+	if (rpc_fd < 0) {
+		printf("open %s failed: %s, skipping\n", device, strerror(errno));
+		return KSFT_SKIP;
+	}
+
+	if (ioctl(rpc_fd, FASTRPC_IOCTL_INIT_ATTACH)) {
+		printf("attach to the root PD failed: %s, skipping\n", strerror(errno));
+		close(rpc_fd);
+		return KSFT_SKIP;
+	}
+
+	ret = bench_utilities();
+	if (ret)
+		goto out;
+
+	heap_fd = open("/dev/dma_heap/system", O_RDWR);
+	if (heap_fd < 0)
+		printf("no system dma-buf heap, skipping dma-buf tests\n");
+
+	if (heap_fd >= 0) {
+		for (size = 4096; size <= max_size; size <<= 2)
+			bench_map_unmap(size);
+	}
+
+	if (handle < 0)
+		goto out;
+
+	for (size = 64; size <= max_size; size <<= 1) {
+		ret = bench_echo(handle, method, size, 0);
+		if (ret)
+			goto out;
+	}
+
+	for (nfds = 1; heap_fd >= 0 && nfds <= max_fds; nfds <<= 1) {
+		ret = bench_echo(handle, method, 4096, nfds);
+		if (ret)
+			goto out;
+	}
+
+out:
+	if (heap_fd >= 0)
+		close(heap_fd);
+	close(rpc_fd);
+	return ret ? 1 : 0;
+}
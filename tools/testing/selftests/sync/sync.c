@@ -40,6 +40,7 @@
 #include "sw_sync.h"
 
 #include <linux/sync_file.h>
+#include <linux/sync_file_batch.h>
 
 
 /* SW_SYNC ioctls */
@@ -81,6 +82,44 @@ int sync_merge(const char *name, int fd1, int fd2)
 	return data.fence;
 }
 
+int sync_merge_array(const char *name, int *fds, int num_fds)
+{
+	struct sync_merge_array_data data = {};
+	int err;
+
+	data.fds = (uint64_t)(unsigned long)fds;
+	data.num_fds = num_fds;
+	strncpy(data.name, name, sizeof(data.name) - 1);
+	data.name[sizeof(data.name) - 1] = '\0';
+
+	err = ioctl(fds[0], SYNC_IOC_MERGE_ARRAY, &data);
+	if (err < 0)
+		return err;
+
+	return data.fence;
+}
+
+int sync_wait_many(int *fds, int num_fds, int any, long long timeout_ns,
+		   int *first_signaled)
+{
+	struct sync_wait_data data = {};
+	int err;
+
+	data.fds = (uint64_t)(unsigned long)fds;
+	data.num_fds = num_fds;
+	data.flags = any ? SYNC_WAIT_ANY : 0;
+	data.timeout_ns = timeout_ns;
+
+	err = ioctl(fds[0], SYNC_IOC_WAIT, &data);
+	if (err < 0)
+		return err;
+
+	if (first_signaled)
+		*first_signaled = data.first_signaled;
+
+	return 0;
+}
+
 static struct sync_file_info *sync_file_info(int fd)
 {
 	struct sync_file_info *info;
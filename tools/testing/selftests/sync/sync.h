@@ -34,6 +34,9 @@
 
 int sync_wait(int fd, int timeout);
 int sync_merge(const char *name, int fd1, int fd2);
+int sync_merge_array(const char *name, int *fds, int num_fds);
+int sync_wait_many(int *fds, int num_fds, int any, long long timeout_ns,
+		   int *first_signaled);
 int sync_fence_size(int fd);
 int sync_fence_count_with_status(int fd, int status);
 
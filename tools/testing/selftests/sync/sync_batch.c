@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * sync fence batched merge and wait tests
+ *
+ * Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+
+#include <errno.h>
+
+#include "sync.h"
+#include "sw_sync.h"
+#include "synctest.h"
+
+#define NUM_TIMELINES	8
+
+int test_fence_merge_array(void)
+{
+	int timelines[NUM_TIMELINES], fences[NUM_TIMELINES + 1];
+	int merged, active, signaled, valid, i;
+
+	for (i = 0; i < NUM_TIMELINES; i++) {
+		timelines[i] = sw_sync_timeline_create();
+		valid = sw_sync_timeline_is_valid(timelines[i]);
+		ASSERT(valid, "Failure allocating timeline\n");
+
+		fences[i] = sw_sync_fence_create(timelines[i], "allocFence", 5);
+		valid = sw_sync_fence_is_valid(fences[i]);
+		ASSERT(valid, "Failure allocating fence\n");
+	}
+
+	/* A later point on the first timeline supersedes the earlier one */
+	fences[NUM_TIMELINES] = sw_sync_fence_create(timelines[0], "allocFence", 10);
+	valid = sw_sync_fence_is_valid(fences[NUM_TIMELINES]);
+	ASSERT(valid, "Failure allocating fence\n");
+
+	merged = sync_merge_array("mergeFence", fences, NUM_TIMELINES + 1);
+	valid = sw_sync_fence_is_valid(merged);
+	ASSERT(valid, "Failure merging fence array\n");
+
+	ASSERT(sync_fence_size(merged) == NUM_TIMELINES,
+	       "Wrong number of fences in merged array\n");
+
+	for (i = 0; i < NUM_TIMELINES; i++)
+		sw_sync_timeline_inc(timelines[i], 5);
+
+	active = sync_fence_count_with_status(merged, FENCE_STATUS_ACTIVE);
+	signaled = sync_fence_count_with_status(merged, FENCE_STATUS_SIGNALED);
+	ASSERT(active == 1 && signaled == NUM_TIMELINES - 1,
+	       "Merged fences did not signal properly!\n");
+
+	sw_sync_timeline_inc(timelines[0], 5);
+	ASSERT(sync_wait(merged, 0) > 0, "Merged fence did not signal!\n");
+
+	sw_sync_fence_destroy(merged);
+	for (i = 0; i <= NUM_TIMELINES; i++)
+		sw_sync_fence_destroy(fences[i]);
+	for (i = 0; i < NUM_TIMELINES; i++)
+		sw_sync_timeline_destroy(timelines[i]);
+
+	return 0;
+}
+
+int test_fence_wait_many(void)
+{
+	int timelines[NUM_TIMELINES], fences[NUM_TIMELINES];
+	int first, ret, i;
+
+	for (i = 0; i < NUM_TIMELINES; i++) {
+		timelines[i] = sw_sync_timeline_create();
+		fences[i] = sw_sync_fence_create(timelines[i], "allocFence", 5);
+		ASSERT(sw_sync_fence_is_valid(fences[i]),
+		       "Failure allocating fence\n");
+	}
+
+	ret = sync_wait_many(fences, NUM_TIMELINES, 1, 0, &first);
+	ASSERT(ret < 0 && errno == ETIME, "Polling unsignaled fences succeeded\n");
+
+	sw_sync_timeline_inc(timelines[3], 5);
+	ret = sync_wait_many(fences, NUM_TIMELINES, 1, 100000000, &first);
+	ASSERT(ret == 0 && first == 3, "Failure waiting for any fence\n");
+
+	ret = sync_wait_many(fences, NUM_TIMELINES, 0, 0, NULL);
+	ASSERT(ret < 0 && errno == ETIME, "Waiting for all fences succeeded early\n");
+
+	for (i = 0; i < NUM_TIMELINES; i++)
+		sw_sync_timeline_inc(timelines[i], 5);
+	ret = sync_wait_many(fences, NUM_TIMELINES, 0, -1, NULL);
+	ASSERT(ret == 0, "Failure waiting for all fences\n");
+
+	for (i = 0; i < NUM_TIMELINES; i++) {
+		sw_sync_fence_destroy(fences[i]);
+		sw_sync_timeline_destroy(timelines[i]);
+	}
+
+	return 0;
+}
@@ -88,7 +88,7 @@ int main(void)
 	ksft_print_header();
 
 	sync_api_supported();
-	ksft_set_plan(3 + 7);
+	ksft_set_plan(3 + 9);
 
 	ksft_print_msg("[RUN]\tTesting sync framework\n");
 
@@ -100,6 +100,8 @@ int main(void)
 	RUN_TEST(test_fence_one_timeline_merge);
 	RUN_TEST(test_fence_merge_same_fence);
 	RUN_TEST(test_fence_multi_timeline_wait);
+	RUN_TEST(test_fence_merge_array);
+	RUN_TEST(test_fence_wait_many);
 	RUN_TEST(test_stress_two_threads_shared_timeline);
 	RUN_TEST(test_consumer_stress_multi_producer_single_consumer);
 	RUN_TEST(test_merge_stress_random_merge);
@@ -55,6 +55,10 @@ int test_fence_merge_same_fence(void);
 /* Fence wait tests */
 int test_fence_multi_timeline_wait(void);
 
+/* Batched merge and wait tests */
+int test_fence_merge_array(void);
+int test_fence_wait_many(void);
+
 /* Stress test - parallelism */
 int test_stress_two_threads_shared_timeline(void);
 
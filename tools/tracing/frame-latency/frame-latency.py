@@ -0,0 +1,288 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0
+#
+# Copyright (c) 2024 Qualcomm Innovation Center, Inc. All rights reserved.
+#
+# Per frame latency of a camera -> DSP -> GPU -> display pipeline.
+#
+# Frames are followed by the identity of their DMA-bufs, as reported by the
+# tracepoints of the drivers on the way:
+#
+#   camss/camss_vfe_buf_done             the VFE filled a buffer
+#   fastrpc/fastrpc_invoke_start, _end   a DSP call using the buffer
+#   drm_msm_gpu/msm_gpu_submit_dmabuf    a GPU submit using the buffer
+#   drm_msm_gpu/msm_gpu_submit_retired   ... and its completion
+#   drm_msm_atomic/msm_atomic_flip       the buffer being flipped to
+#
+# A frame starts when the VFE fills a buffer. Every later call or submit that
+# uses one of the buffers of the frame adds the other buffers it uses to the
+# frame, so that the output of a DSP call is followed into the GPU and the
+# output of the GPU onto the display. A frame ends when one of its buffers is
+# flipped to. Stages a pipeline doesn't have are simply left out.
+#
+# Usage:
+#   frame-latency.py record [-d seconds] > trace.txt
+#   frame-latency.py report [-v] [trace.txt]
+#
+# "record" enables the events, with the mono trace clock so that the time of
+# the start of frame the VFE stamps buffers with can be compared to the trace
+# timestamps, and copies trace_pipe. "report" reads the text output of the
+# trace, from record, trace_pipe or "trace-cmd report", and prints latency
+# percentiles for each stage, and each frame with -v.
+
+import argparse
+import os
+import re
+import sys
+import time
+
+TRACEFS = "/sys/kernel/tracing"
+
+EVENTS = [
+    "camss/camss_vfe_buf_done",
+    "fastrpc/fastrpc_invoke_start",
+    "fastrpc/fastrpc_invoke_end",
+    "drm_msm_gpu/msm_gpu_submit_dmabuf",
+    "drm_msm_gpu/msm_gpu_submit_retired",
+    "drm_msm_atomic/msm_atomic_flip",
+]
+
+# stages, named after the mark that ends them
+STAGES = [
+    ("capture", "sensor start of frame -> VFE buffer done"),
+    ("dsp_queue", "-> DSP call start"),
+    ("dsp", "-> DSP call end"),
+    ("gpu_queue", "-> GPU submit"),
+    ("gpu", "-> GPU retire"),
+    ("display", "-> flip"),
+]
+
+LINE_RE = re.compile(r"^\s*(?P<task>.+?)-(?P<pid>\d+)\s+(?:\(.*?\)\s+)?"
+                     r"\[(?P<cpu>\d+)\]\s+(?:\S+\s+)?"
+                     r"(?P<ts>\d+\.\d+):\s+(?P<event>\w+):\s+(?P<args>.*)$")
+ARG_RE = re.compile(r"(\w+)(?::\s*|=)(\{[^}]*\}|\S+)")
+
+
+def parse_int(s):
+    try:
+        return int(s, 0)
+    except ValueError:
+        return None
+
+
+def parse_args(args):
+    fields = {}
+    for key, val in ARG_RE.findall(args):
+        if val.startswith("{"):
+            fields[key] = [v for v in map(parse_int, val[1:-1].split(","))
+                           if v]
+        else:
+            fields[key] = parse_int(val)
+    return fields
+
+
+class Frame:
+    def __init__(self, seq, dmabuf, start):
+        self.seq = seq
+        self.dmabufs = {dmabuf}
+        self.marks = {}
+        self.start = start
+        self.last = start
+        self.done = False
+
+    def mark(self, stage, ts):
+        if stage not in self.marks:
+            self.marks[stage] = ts
+        self.last = ts
+
+    def latencies(self):
+        lat = {}
+        prev = self.marks.get("sof")
+        for stage, _ in STAGES:
+            ts = self.start if stage == "capture" else self.marks.get(stage)
+            if ts is None:
+                continue
+            if prev is not None:
+                lat[stage] = ts - prev
+            prev = ts
+        first = self.marks.get("sof", self.start)
+        lat["total"] = self.last - first
+        return lat
+
+
+class Tracker:
+    def __init__(self, mono):
+        self.mono = mono
+        self.frames = []
+        self.owner = {}     # dmabuf -> frame it currently belongs to
+        self.calls = {}     # fastrpc ctxid -> frame
+        self.submits = {}   # GPU submit id -> frame
+
+    def claim(self, frame, dmabufs):
+        for d in dmabufs:
+            old = self.owner.get(d)
+            if old is not None and old is not frame:
+                old.dmabufs.discard(d)
+            self.owner[d] = frame
+            frame.dmabufs.add(d)
+
+    def lookup(self, dmabufs):
+        for d in dmabufs:
+            frame = self.owner.get(d)
+            if frame is not None and not frame.done:
+                return frame
+        return None
+
+    def event(self, name, ts, f):
+        if name == "camss_vfe_buf_done":
+            if not f.get("dmabuf"):
+                return
+            frame = Frame(f.get("sequence"), f["dmabuf"], ts)
+            if self.mono and f.get("timestamp"):
+                sof = f["timestamp"] / 1e9
+                if 0 <= ts - sof < 1:
+                    frame.marks["sof"] = sof
+            self.claim(frame, [f["dmabuf"]])
+            self.frames.append(frame)
+        elif name == "fastrpc_invoke_start":
+            frame = self.lookup(f.get("dmabufs", []))
+            if frame is None:
+                return
+            frame.mark("dsp_queue", ts)
+            self.calls[f.get("ctxid")] = frame
+        elif name == "fastrpc_invoke_end":
+            frame = self.calls.pop(f.get("ctxid"), None)
+            if frame is None or frame.done:
+                return
+            frame.mark("dsp", ts)
+            self.claim(frame, f.get("dmabufs", []))
+        elif name == "msm_gpu_submit_dmabuf":
+            submit = f.get("id")
+            frame = self.submits.get(submit)
+            if frame is None:
+                frame = self.lookup([f.get("dmabuf")])
+                if frame is None:
+                    return
+                frame.mark("gpu_queue", ts)
+                self.submits[submit] = frame
+            self.claim(frame, [f.get("dmabuf")])
+        elif name == "msm_gpu_submit_retired":
+            frame = self.submits.pop(f.get("id"), None)
+            if frame is None or frame.done:
+                return
+            frame.mark("gpu", ts)
+        elif name == "msm_atomic_flip":
+            frame = self.lookup([f.get("dmabuf")])
+            if frame is None:
+                return
+            frame.mark("display", ts)
+            frame.done = True
+
+
+def percentile(sorted_vals, p):
+    return sorted_vals[min(len(sorted_vals) - 1, len(sorted_vals) * p // 100)]
+
+
+def report(opts):
+    tracker = Tracker(opts.mono)
+    src = open(opts.file) if opts.file != "-" else sys.stdin
+
+    for line in src:
+        m = LINE_RE.match(line)
+        if not m:
+            continue
+        tracker.event(m.group("event"), float(m.group("ts")),
+                      parse_args(m.group("args")))
+
+    frames = [f for f in tracker.frames if f.done]
+    if not frames:
+        print("no complete frames found, are the events enabled?")
+        return 1
+
+    names = [s for s, _ in STAGES] + ["total"]
+    stats = {n: [] for n in names}
+
+    if opts.verbose:
+        print("%10s " % "sequence" + " ".join("%10s" % n for n in names))
+    for frame in frames:
+        lat = frame.latencies()
+        for n, v in lat.items():
+            stats[n].append(v * 1e6)
+        if opts.verbose:
+            print("%10s " % frame.seq +
+                  " ".join("%10.0f" % (lat[n] * 1e6) if n in lat
+                           else "%10s" % "-" for n in names))
+
+    print("%d frames, %d incomplete" % (len(frames),
+                                        len(tracker.frames) - len(frames)))
+    print("%-10s %10s %10s %10s %10s  (us)" % ("stage", "p50", "p90", "p99",
+                                               "max"))
+    for n in names:
+        vals = sorted(stats[n])
+        if not vals:
+            continue
+        print("%-10s %10.0f %10.0f %10.0f %10.0f" %
+              (n, percentile(vals, 50), percentile(vals, 90),
+               percentile(vals, 99), vals[-1]))
+    return 0
+
+
+def write(path, val):
+    with open(os.path.join(TRACEFS, path), "w") as f:
+        f.write(val)
+
+
+def record(opts):
+    write("trace_clock", "mono")
+    for event in EVENTS:
+        try:
+            write("events/%s/enable" % event, "1")
+        except OSError:
+            print("event %s not available" % event, file=sys.stderr)
+    write("trace", "")
+
+    end = time.monotonic() + opts.duration
+    try:
+        with open(os.path.join(TRACEFS, "trace_pipe")) as pipe:
+            os.set_blocking(pipe.fileno(), False)
+            while time.monotonic() < end:
+                data = pipe.read()
+                if data:
+                    sys.stdout.write(data)
+                else:
+                    time.sleep(0.1)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        for event in EVENTS:
+            try:
+                write("events/%s/enable" % event, "0")
+            except OSError:
+                pass
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Per frame latency of a camera to display pipeline")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    rec = sub.add_parser("record", help="record the events to stdout")
+    rec.add_argument("-d", "--duration", type=float, default=10,
+                     help="seconds to record for")
+
+    rep = sub.add_parser("report", help="report the latencies of a trace")
+    rep.add_argument("-v", "--verbose", action="store_true",
+                     help="print the latencies of every frame")
+    rep.add_argument("--no-mono", dest="mono", action="store_false",
+                     help="the trace isn't on the mono clock, don't "
+                     "report the capture stage")
+    rep.add_argument("file", nargs="?", default="-",
+                     help="trace to read, stdin by default")
+
+    opts = parser.parse_args()
+    return record(opts) if opts.cmd == "record" else report(opts)
+
+
+if __name__ == "__main__":
+    sys.exit(main())